@@ -0,0 +1,232 @@
+/**
+******************************************************************************
+* @file    platform.c
+* @author  William Xu
+* @version V1.0.0
+* @date    17-Oct-2026
+* @brief   This file provides all MICO Peripherals mapping table and platform
+*          specific functions for the Linux host.
+******************************************************************************
+*
+*  The MIT License
+*  Copyright (c) 2016 MXCHIP Inc.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy 
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights 
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is furnished
+*  to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in
+*  all copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+*  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR 
+*  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+******************************************************************************
+*/ 
+
+#include "mico_platform.h"
+#include "platform.h"
+#include "platform_config.h"
+#include "platform_peripheral.h"
+#include "PlatformLogging.h"
+
+/******************************************************
+*                      Macros
+******************************************************/
+
+/******************************************************
+*                    Constants
+******************************************************/
+
+/******************************************************
+*                   Enumerations
+******************************************************/
+
+/******************************************************
+*                 Type Definitions
+******************************************************/
+
+/******************************************************
+*                    Structures
+******************************************************/
+
+/******************************************************
+*               Function Declarations
+******************************************************/
+
+/******************************************************
+*               Variables Definitions
+******************************************************/
+
+const platform_gpio_t platform_gpio_pins[] =
+{
+  [MICO_SYS_LED]                      = { "SYS_LED" },
+  [MICO_RF_LED]                       = { "RF_LED" },
+  [BOOT_SEL]                          = { "BOOT_SEL" },
+  [MFG_SEL]                           = { "MFG_SEL" },
+  [EasyLink_BUTTON]                   = { "EASYLINK" },
+  [STDIO_UART_RX]                     = { "STDIO_RX" },
+  [STDIO_UART_TX]                     = { "STDIO_TX" },
+};
+
+const platform_pwm_t *platform_pwm_peripherals = NULL;
+
+const platform_i2c_t *platform_i2c_peripherals = NULL;
+
+platform_i2c_driver_t *platform_i2c_drivers = NULL;
+
+const platform_uart_t platform_uart_peripherals[] =
+{
+  [MICO_UART_1] =
+  {
+    .device                       = NULL,
+  },
+  [MICO_UART_2] =
+  {
+    .device                       = "mico_uart2",
+  },
+};
+platform_uart_driver_t platform_uart_drivers[MICO_UART_MAX];
+
+const platform_spi_t *platform_spi_peripherals = NULL;
+
+platform_spi_driver_t *platform_spi_drivers = NULL;
+
+const platform_adc_t *platform_adc_peripherals = NULL;
+
+/* Flash memory devices, each one backed by a file in HOST_FLASH_DIR */
+const platform_flash_t platform_flash_peripherals[] =
+{
+  [MICO_FLASH_EMBEDDED] =
+  {
+    .flash_type                   = FLASH_TYPE_EMBEDDED,
+    .flash_start_addr             = 0x08000000,
+    .flash_length                 = 0x80000,
+    .flash_file                   = "flash_embedded.bin",
+  },
+  [MICO_FLASH_SPI] =
+  {
+    .flash_type                   = FLASH_TYPE_SPI,
+    .flash_start_addr             = 0x000000,
+    .flash_length                 = 0x200000,
+    .flash_file                   = "flash_spi.bin",
+  },
+};
+
+platform_flash_driver_t platform_flash_drivers[MICO_FLASH_MAX];
+
+/* Logic partition on flash devices, same layout as MiCOKit-3165 */
+const mico_logic_partition_t mico_partitions[] =
+{
+  [MICO_PARTITION_BOOTLOADER] =
+  {
+    .partition_owner           = MICO_FLASH_EMBEDDED,
+    .partition_description     = "Bootloader",
+    .partition_start_addr      = 0x08000000,
+    .partition_length          =     0x8000,    //32k bytes
+    .partition_options         = PAR_OPT_READ_EN | PAR_OPT_WRITE_DIS,
+  },
+  [MICO_PARTITION_APPLICATION] =
+  {
+    .partition_owner           = MICO_FLASH_EMBEDDED,
+    .partition_description     = "Application",
+    .partition_start_addr      = 0x0800C000,
+    .partition_length          =    0x74000,   //464k bytes
+    .partition_options         = PAR_OPT_READ_EN | PAR_OPT_WRITE_DIS,
+  },
+  [MICO_PARTITION_RF_FIRMWARE] =
+  {
+    .partition_owner           = MICO_FLASH_SPI,
+    .partition_description     = "RF Firmware",
+    .partition_start_addr      = 0x2000,
+    .partition_length          = 0x3E000,  //248k bytes
+    .partition_options         = PAR_OPT_READ_EN | PAR_OPT_WRITE_DIS,
+  },
+  [MICO_PARTITION_OTA_TEMP] =
+  {
+    .partition_owner           = MICO_FLASH_SPI,
+    .partition_description     = "OTA Storage",
+    .partition_start_addr      = 0x40000,
+    .partition_length          = 0x70000, //448k bytes
+    .partition_options         = PAR_OPT_READ_EN | PAR_OPT_WRITE_EN,
+  },
+  [MICO_PARTITION_PARAMETER_1] =
+  {
+    .partition_owner           = MICO_FLASH_SPI,
+    .partition_description     = "PARAMETER1",
+    .partition_start_addr      = 0x0,
+    .partition_length          = 0x1000, // 4k bytes
+    .partition_options         = PAR_OPT_READ_EN | PAR_OPT_WRITE_EN,
+  },
+  [MICO_PARTITION_PARAMETER_2] =
+  {
+    .partition_owner           = MICO_FLASH_SPI,
+    .partition_description     = "PARAMETER2",
+    .partition_start_addr      = 0x1000,
+    .partition_length          = 0x1000, //4k bytes
+    .partition_options         = PAR_OPT_READ_EN | PAR_OPT_WRITE_EN,
+  },
+  [MICO_PARTITION_FILESYS] =
+  {
+    .partition_owner           = MICO_FLASH_SPI,
+    .partition_description     = "FILESYS",
+    .partition_start_addr      = 0x100000,
+    .partition_length          = 0x100000, //1M bytes
+    .partition_options         = PAR_OPT_READ_EN | PAR_OPT_WRITE_EN,
+  }
+};
+
+/******************************************************
+*               Function Definitions
+******************************************************/
+
+void init_platform( void )
+{
+  MicoGpioInitialize( (mico_gpio_t)MICO_SYS_LED, OUTPUT_PUSH_PULL );
+  MicoGpioOutputLow( (mico_gpio_t)MICO_SYS_LED );
+  MicoGpioInitialize( (mico_gpio_t)MICO_RF_LED, OUTPUT_OPEN_DRAIN_NO_PULL );
+  MicoGpioOutputHigh( (mico_gpio_t)MICO_RF_LED );
+
+  MicoGpioInitialize((mico_gpio_t)BOOT_SEL, INPUT_PULL_UP);
+  MicoGpioInitialize((mico_gpio_t)MFG_SEL, INPUT_PULL_UP);
+}
+
+void MicoSysLed(bool onoff)
+{
+  if (onoff) {
+    MicoGpioOutputLow( (mico_gpio_t)MICO_SYS_LED );
+  } else {
+    MicoGpioOutputHigh( (mico_gpio_t)MICO_SYS_LED );
+  }
+}
+
+void MicoRfLed(bool onoff)
+{
+  if (onoff) {
+    MicoGpioOutputLow( (mico_gpio_t)MICO_RF_LED );
+  } else {
+    MicoGpioOutputHigh( (mico_gpio_t)MICO_RF_LED );
+  }
+}
+
+bool MicoShouldEnterMFGMode(void)
+{
+  if(MicoGpioInputGet((mico_gpio_t)BOOT_SEL)==false && MicoGpioInputGet((mico_gpio_t)MFG_SEL)==false)
+    return true;
+  else
+    return false;
+}
+
+bool MicoShouldEnterBootloader(void)
+{
+  if(MicoGpioInputGet((mico_gpio_t)BOOT_SEL)==false && MicoGpioInputGet((mico_gpio_t)MFG_SEL)==true)
+    return true;
+  else
+    return false;
+}
@@ -0,0 +1,110 @@
+/**
+******************************************************************************
+* @file    platform_config.h
+* @author  William Xu
+* @version V1.0.0
+* @date    17-Oct-2026
+* @brief   This file provides common configuration for the host (POSIX) platform.
+******************************************************************************
+*
+*  The MIT License
+*  Copyright (c) 2016 MXCHIP Inc.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy 
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights 
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is furnished
+*  to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in
+*  all copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+*  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR 
+*  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+******************************************************************************
+*/ 
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/******************************************************
+*                      Macros
+******************************************************/
+
+/******************************************************
+*                    Constants
+******************************************************/
+
+#define HARDWARE_REVISION   "HOST_1"
+#define DEFAULT_NAME        "MiCO Host"
+#define MODEL               "MiCO-Host"
+
+/* MICO RTOS tick rate in Hz */
+#define MICO_DEFAULT_TICK_RATE_HZ                   (1000) 
+
+/************************************************************************
+ * Uncomment to disable watchdog. For debugging only */
+#define MICO_DISABLE_WATCHDOG
+
+/************************************************************************
+ * Uncomment to disable standard IO, i.e. printf(), etc. */
+//#define MICO_DISABLE_STDIO
+
+/************************************************************************
+ * Uncomment to disable MCU powersave API functions */
+#define MICO_DISABLE_MCU_POWERSAVE
+
+/************************************************************************
+ * Uncomment to enable MCU real time clock */
+#define MICO_ENABLE_MCU_RTC
+
+/************************************************************************
+ * Restore default and start easylink after press down EasyLink button for 3 seconds. */
+#define RestoreDefault_TimeOut                      (3000)
+
+/************************************************************************
+ * Nominal CPU clock reported to MiCO, the host runs at its own speed */
+#define MCU_CLOCK_HZ            (100000000)
+
+/************************************************************************
+ * How many bits are used in NVIC priority configuration, unused on host */
+#define CORTEX_NVIC_PRIO_BITS   (4)
+
+/************************************************************************
+ * Directory that holds the files backing every flash device, one file per
+ * device in platform_flash_peripherals[]. Can be overridden at run time with
+ * the MICO_HOST_FLASH_DIR environment variable. */
+#define HOST_FLASH_DIR                              "."
+
+/******************************************************
+*                   Enumerations
+******************************************************/
+
+/******************************************************
+*                 Type Definitions
+******************************************************/
+
+/******************************************************
+*                    Structures
+******************************************************/
+
+/******************************************************
+*                 Global Variables
+******************************************************/
+
+/******************************************************
+*               Function Declarations
+******************************************************/
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
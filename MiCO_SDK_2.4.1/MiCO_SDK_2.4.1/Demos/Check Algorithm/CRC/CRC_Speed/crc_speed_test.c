@@ -0,0 +1,136 @@
+/**
+******************************************************************************
+* @file    crc_speed_test.c
+* @author  William Xu
+* @version V1.0.0
+* @date    17-Oct-2026
+* @brief   CRC8 and CRC16 throughput test demo based on MiCO !
+******************************************************************************
+*
+*  The MIT License
+*  Copyright (c) 2016 MXCHIP Inc.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy 
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights 
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is furnished
+*  to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in
+*  all copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+*  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR 
+*  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+******************************************************************************
+*/ 
+
+#include "MICO.h"
+
+#define crc_speed_test_log(format, ...)  custom_log("Security", format, ##__VA_ARGS__)
+
+/* Demo Function:
+ * Measure the throughput of CRC8_Update( ) and CRC16_Update( ) with the
+ * engine selected by CRC_ENGINE, and check the results against the bit
+ * serial UpdateCRC8( ) and UpdateCRC16( ). Build again with another
+ * CRC_ENGINE to compare the engines. */
+
+#define TEST_BUFFER_SIZE    ( 4096 )
+#define TEST_TIME_MS        ( 1000 )
+
+extern uint8_t  UpdateCRC8( uint8_t crcIn, uint8_t byte );
+extern uint16_t UpdateCRC16( uint16_t crcIn, uint8_t byte );
+
+static const char *engine_name[] = { "bitwise", "nibble", "table", "slice-by-4" };
+
+static uint8_t test_buffer[TEST_BUFFER_SIZE];
+
+static bool crc_speed_test_verify( void )
+{
+  CRC8_Context crc8;
+  CRC16_Context crc16;
+  uint8_t result8, ref8 = 0;
+  uint16_t result16, ref16 = 0;
+  uint32_t i, len;
+
+  for( len = 0; len < 64; len++ )
+  {
+    ref8 = 0;
+    ref16 = 0;
+    for( i = 0; i < len; i++ )
+    {
+      ref8 = UpdateCRC8( ref8, test_buffer[i] );
+      ref16 = UpdateCRC16( ref16, test_buffer[i] );
+    }
+    ref16 = UpdateCRC16( ref16, 0 );
+    ref16 = UpdateCRC16( ref16, 0 );
+
+    /* Split the data, so the word and byte paths are both used */
+    CRC8_Init( &crc8 );
+    CRC8_Update( &crc8, test_buffer, len / 3 );
+    CRC8_Update( &crc8, test_buffer + len / 3, len - len / 3 );
+    CRC8_Final( &crc8, &result8 );
+
+    CRC16_Init( &crc16 );
+    CRC16_Update( &crc16, test_buffer, len / 3 );
+    CRC16_Update( &crc16, test_buffer + len / 3, len - len / 3 );
+    CRC16_Final( &crc16, &result16 );
+
+    if( result8 != ref8 || result16 != ref16 )
+    {
+      crc_speed_test_log( "Mismatch at length %d: CRC8 %02x/%02x, CRC16 %04x/%04x",
+                          (int)len, result8, ref8, result16, ref16 );
+      return false;
+    }
+  }
+  return true;
+}
+
+static void crc_speed_test_run( const char *name, bool is_crc16 )
+{
+  CRC8_Context crc8;
+  CRC16_Context crc16;
+  uint32_t start, elapsed, bytes = 0;
+
+  CRC8_Init( &crc8 );
+  CRC16_Init( &crc16 );
+  start = mico_get_time( );
+  do
+  {
+    if( is_crc16 )
+      CRC16_Update( &crc16, test_buffer, TEST_BUFFER_SIZE );
+    else
+      CRC8_Update( &crc8, test_buffer, TEST_BUFFER_SIZE );
+    bytes += TEST_BUFFER_SIZE;
+    elapsed = mico_get_time( ) - start;
+  } while( elapsed < TEST_TIME_MS );
+
+  crc_speed_test_log( "%s: %d KB in %d ms, %d.%02d MB/s", name, (int)( bytes / 1024 ), (int)elapsed,
+                      (int)( bytes / 1000 / elapsed ), (int)( bytes / 10 / elapsed % 100 ) );
+}
+
+int application_start( void )
+{
+  uint32_t i;
+
+  for( i = 0; i < TEST_BUFFER_SIZE; i++ )
+    test_buffer[i] = (uint8_t)( i * 7 + ( i >> 8 ) );
+
+  crc_speed_test_log( "CRC Speed Test Start, engine: %s", engine_name[CRC_ENGINE] );
+
+  if( crc_speed_test_verify( ) == false )
+  {
+    crc_speed_test_log( "CRC Speed Test failed!" );
+    return 0;
+  }
+
+  crc_speed_test_run( "CRC8 ", false );
+  crc_speed_test_run( "CRC16", true );
+
+  crc_speed_test_log( "CRC Speed Test finished!" );
+  return 0;
+}
@@ -71,7 +71,7 @@ void localTcpServer_thread(void *inContext)
 	  if (IsValidFD(j)) {
         inet_ntoa(ip_address, addr.s_ip );
         server_log("Client %s:%d connected, fd: %d", ip_address, addr.s_port, j);
-        if(kNoErr != mico_rtos_create_thread(NULL, MICO_APPLICATION_PRIORITY, "Local Clients", localTcpClient_thread, STACK_SIZE_LOCAL_TCP_CLIENT_THREAD, &j) ) 
+        if(kNoErr != mico_rtos_create_thread(NULL, MICO_APPLICATION_PRIORITY, "Local Clients", localTcpClient_thread, STACK_SIZE_LOCAL_TCP_CLIENT_THREAD, (void *)(intptr_t)j) ) 
           SocketClose(&j);
       }
     }
@@ -86,7 +86,7 @@ exit:
 void localTcpClient_thread(void *inFd)
 {
   OSStatus err;
-  int clientFd = *(int *)inFd;
+  int clientFd = (int)(intptr_t)inFd;
   uint8_t *inDataBuffer = NULL;
   int len;
   fd_set readfds;
@@ -94,13 +94,12 @@ void localTcpClient_thread(void *inFd)
   struct timeval_t t;
   int eventFd = -1;
   mico_queue_t queue;
-  socket_msg_t *msg;
   int sent_len, errno;
 
   inDataBuffer = malloc(wlanBufferLen);
   require_action(inDataBuffer, exit, err = kNoMemoryErr);
 
-  err = socket_queue_create(context, &queue);
+  err = socket_queue_create(context, &queue, clientFd);
   require_noerr( err, exit );
   eventFd = mico_create_event_fd(queue);
   if (eventFd < 0) {
@@ -124,22 +123,18 @@ void localTcpClient_thread(void *inFd)
         FD_SET(clientFd, &writeSet );
         t.tv_usec = 100*1000; // max wait 100ms.
         select(1, NULL, &writeSet, NULL, &t);
-        if((FD_ISSET( clientFd, &writeSet )) &&
-            (kNoErr == mico_rtos_pop_from_queue( &queue, &msg, 0))) {
-           sent_len = write(clientFd, msg->data, msg->len);
-           if (sent_len <= 0) {
+        if (FD_ISSET( clientFd, &writeSet )) {
+           sent_len = socket_queue_send(context, &queue, clientFd);
+           if (sent_len < 0) {
               len = sizeof(errno);
               getsockopt(clientFd, SOL_SOCKET, SO_ERROR, &errno, &len);
-              socket_msg_free(msg);
               server_log("write error, fd: %d, errno %d", clientFd, errno );
               if (errno != ENOMEM) {
                   goto exit_with_queue;
               }
-           } else {
-                  socket_msg_free(msg);
-              }
            }
         }
+    }
 
     /*Read data from tcp clients and process these data using HA protocol */ 
     if (FD_ISSET(clientFd, &readfds)) {
@@ -35,7 +35,7 @@ extern "C" {
 /*User provided configurations*/
 #define CONFIGURATION_VERSION               0x00000002 // if default configuration is changed, update this number
 #define MAX_QUEUE_NUM                       6  // 1 remote client, 5 local server
-#define MAX_QUEUE_LENGTH                    8  // each queue max 8 msg
+#define MAX_QUEUE_LENGTH                    8  // UART data kept for slow clients, in packages
 #define LOCAL_PORT                          8080
 #define DEAFULT_REMOTE_SERVER               "192.168.2.254"
 #define DEFAULT_REMOTE_SERVER_PORT          8080
@@ -43,6 +43,7 @@ extern "C" {
 #define UART_ONE_PACKAGE_LENGTH             1024
 #define wlanBufferLen                       1024
 #define UART_BUFFER_LENGTH                  2048
+#define SPP_RING_SIZE                       (MAX_QUEUE_LENGTH*UART_ONE_PACKAGE_LENGTH) // must be a power of 2
 
 #define LOCAL_TCP_SERVER_LOOPBACK_PORT      1000
 #define REMOTE_TCP_CLIENT_LOOPBACK_PORT     1002
@@ -63,11 +64,21 @@ extern "C" {
   #define STACK_SIZE_REMOTE_TCP_CLIENT_THREAD   0x260
 #endif
 
-typedef struct _socket_msg {
-  int ref;
-  int len;
-  uint8_t data[1];
-} socket_msg_t;
+/*Read position of a TCP connection in the UART data ring*/
+typedef struct {
+  mico_queue_t*     queue;      // doorbell, holds one token while data is pending
+  uint32_t          cursor;     // next byte to send, counted like spp_ring_t.head
+  bool              busy;       // sending straight from the ring, cursor is pinned
+  uint32_t          dropped;    // bytes skipped because the connection fell behind
+} spp_reader_t;
+
+/*UART data shared by all connections, received once and sent from in place*/
+typedef struct {
+  uint8_t*          buf;        // SPP_RING_SIZE bytes
+  uint32_t          head;       // bytes received from UART so far
+  spp_reader_t      reader[MAX_QUEUE_NUM];
+  mico_semaphore_t  space_sem;  // set when a reader releases ring space
+} spp_ring_t;
 
 /*Application's configuration stores in flash*/
 typedef struct
@@ -83,13 +94,16 @@ typedef struct
 
   /*IO settings*/
   uint32_t          USART_BaudRate;
+
+  /*New fields go last, a config saved before them gets their defaults on load*/
+  mico_dns_persist_t remoteServerAddr[1];   // Last address of remoteServerDomain, to connect before DNS answers
 } application_config_t;
 
 
 /*Running status*/
 typedef struct  {
-  /*Local clients port list*/
-  mico_queue_t*   socket_out_queue[MAX_QUEUE_NUM];
+  /*UART data and the connections reading it*/
+  spp_ring_t      ring;
   mico_mutex_t    queue_mtx;
 } current_app_status_t;
 
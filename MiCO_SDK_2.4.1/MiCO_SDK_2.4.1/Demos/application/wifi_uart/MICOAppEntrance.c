@@ -53,6 +53,7 @@ void appRestoreDefault_callback(void * const user_config_data, uint32_t size)
   appConfig->remoteServerEnable = true;
   sprintf(appConfig->remoteServerDomain, DEAFULT_REMOTE_SERVER);
   appConfig->remoteServerPort = DEFAULT_REMOTE_SERVER_PORT;
+  memset(appConfig->remoteServerAddr, 0x0, sizeof(appConfig->remoteServerAddr));
 }
 
 int application_start(void)
@@ -74,13 +75,22 @@ int application_start(void)
   /* mico system initialize */
   err = mico_system_init( mico_context );
   require_noerr( err, exit );
+
+  /* Keep the remote server's address in flash, the server is reached at once after a reboot */
+  if( strcmp( app_context->appConfig->remoteServerAddr[0].name, app_context->appConfig->remoteServerDomain ) ){
+    strncpy( app_context->appConfig->remoteServerAddr[0].name, app_context->appConfig->remoteServerDomain, MICO_DNS_NAME_LEN - 1 );
+    app_context->appConfig->remoteServerAddr[0].ip = 0;
+  }
+  err = mico_system_dns_persist( app_context->appConfig->remoteServerAddr, 1 );
+  require_noerr( err, exit );
   
   /* Initialize service dsicovery */
   err = MICOStartBonjourService( Station, app_context );
   require_noerr( err, exit );
 
   /* Protocol initialize */
-  sppProtocolInit( app_context );
+  err = sppProtocolInit( app_context );
+  require_noerr( err, exit );
 
   /*UART receive thread*/
   uart_config.baud_rate    = app_context->appConfig->USART_BaudRate;
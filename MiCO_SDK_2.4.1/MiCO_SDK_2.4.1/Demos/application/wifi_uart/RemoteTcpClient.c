@@ -28,27 +28,6 @@
 
 #define CLOUD_RETRY  1
 
-static bool _wifiConnected = false;
-static mico_semaphore_t  _wifiConnected_sem = NULL;
-
-void clientNotify_WifiStatusHandler(int event, void* arg )
-{
-  client_log_trace();
-  (void)arg;
-  switch (event) {
-  case NOTIFY_STATION_UP:
-    _wifiConnected = true;
-    mico_rtos_set_semaphore(&_wifiConnected_sem);
-    break;
-  case NOTIFY_STATION_DOWN:
-    _wifiConnected = false;
-    break;
-  default:
-    break;
-  }
-  return;
-}
-
 void remoteTcpClient_thread(void *inContext)
 {
   client_log_trace();
@@ -64,35 +43,26 @@ void remoteTcpClient_thread(void *inContext)
   uint8_t *inDataBuffer = NULL;
   int eventFd = -1;
   mico_queue_t queue;
-  socket_msg_t *msg;
-  LinkStatusTypeDef wifi_link;
   int sent_len, errno;
   
-  mico_rtos_init_semaphore(&_wifiConnected_sem, 1);
-  
-  /* Regisist notifications */
-  err = mico_system_notify_register( mico_notify_WIFI_STATUS_CHANGED, (void *)clientNotify_WifiStatusHandler, NULL );
-  require_noerr( err, exit ); 
-  
   inDataBuffer = malloc(wlanBufferLen);
   require_action(inDataBuffer, exit, err = kNoMemoryErr);
   
-  err = micoWlanGetLinkStatus( &wifi_link );
-  require_noerr( err, exit );
-  
-  if( wifi_link.is_connected == true )
-    _wifiConnected = true;
-  
   while(1) {
     if(remoteTcpClient_fd == -1 ) {
-      if(_wifiConnected == false){
-        require_action_quiet(mico_rtos_get_semaphore(&_wifiConnected_sem, 200000) == kNoErr, Continue, err = kTimeoutErr);
+      /* Connect as soon as the station has an address */
+      err = mico_system_ready_wait( mico_ready_IP, 200000 );
+      require_noerr_quiet( err, Continue );
+      /* The last known address is tried at once, while the name is looked up again */
+      if( mico_system_dns_last_known( context->appConfig->remoteServerDomain, &addr.s_ip ) == kNoErr ){
+        mico_system_dns_resolve_async( context->appConfig->remoteServerDomain, NULL, NULL );
+      }else{
+        err = mico_system_dns_resolve( context->appConfig->remoteServerDomain, &addr.s_ip, 10000 );
+        require_noerr(err, ReConnWithDelay);
       }
-      err = gethostbyname((char *)context->appConfig->remoteServerDomain, (uint8_t *)ipstr, 16);
-      require_noerr(err, ReConnWithDelay);
+      client_log("Remote server %s at %s", context->appConfig->remoteServerDomain, inet_ntoa( ipstr, addr.s_ip ) );
       
       remoteTcpClient_fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-      addr.s_ip = inet_addr(ipstr); 
       addr.s_port = context->appConfig->remoteServerPort;
       
       err = connect(remoteTcpClient_fd, &addr, sizeof(addr));
@@ -100,7 +70,7 @@ void remoteTcpClient_thread(void *inContext)
       client_log("Remote server connected at port: %d, fd: %d",  context->appConfig->remoteServerPort,
                  remoteTcpClient_fd);
       
-      err = socket_queue_create(context, &queue);
+      err = socket_queue_create(context, &queue, remoteTcpClient_fd);
       require_noerr( err, exit );
       eventFd = mico_create_event_fd(queue);
       if (eventFd < 0) {
@@ -121,22 +91,18 @@ void remoteTcpClient_thread(void *inContext)
         FD_SET(remoteTcpClient_fd, &writeSet );
         t.tv_usec = 100*1000; // max wait 100ms.
         select(1, NULL, &writeSet, NULL, &t);
-        if ((FD_ISSET(remoteTcpClient_fd, &writeSet )) && 
-            (kNoErr == mico_rtos_pop_from_queue( &queue, &msg, 0))) {
-           sent_len = write(remoteTcpClient_fd, msg->data, msg->len);
-           if (sent_len <= 0) {
+        if (FD_ISSET(remoteTcpClient_fd, &writeSet )) {
+           sent_len = socket_queue_send(context, &queue, remoteTcpClient_fd);
+           if (sent_len < 0) {
             len = sizeof(errno);
             getsockopt(remoteTcpClient_fd, SOL_SOCKET, SO_ERROR, &errno, &len);
       
-            socket_msg_free(msg);
             if (errno != ENOMEM) {
                 client_log("write error, fd: %d, errno %d", remoteTcpClient_fd,errno );
                 goto ReConnWithDelay;
             }
-           } else {
-                    socket_msg_free(msg);
-                }
-            }
+           }
+        }
       }
       /*recv wlan data using remote client fd*/
       if (FD_ISSET(remoteTcpClient_fd, &readfds)) {
@@ -25,25 +25,29 @@
 #include "SocketUtils.h"
 #include "debug.h"
 
-#define MAX_SOCK_MSG_LEN (10*1024)
-int sockmsg_len = 0;
+#define SPP_RING_MASK (SPP_RING_SIZE - 1)
+
 #define spp_log(M, ...) custom_log("SPP", M, ##__VA_ARGS__)
 #define spp_log_trace() custom_log_trace("SPP")
 
-void socket_msg_take(socket_msg_t*msg);
-void socket_msg_free(socket_msg_t*msg);
+static uint32_t spp_ring_tail(spp_ring_t *ring);
 
 
 OSStatus sppProtocolInit(app_context_t * const inContext)
 {
   int i;
+  spp_ring_t *ring = &inContext->appStatus.ring;
   
   spp_log_trace();
-  (void)inContext;
 
   for(i=0; i < MAX_QUEUE_NUM; i++) {
-    inContext->appStatus.socket_out_queue[i] = NULL;
+    ring->reader[i].queue = NULL;
   }
+  ring->head = 0;
+  ring->buf = malloc(SPP_RING_SIZE);
+  if (ring->buf == NULL)
+    return kNoMemoryErr;
+  mico_rtos_init_semaphore(&ring->space_sem, 1);
   mico_rtos_init_mutex(&inContext->appStatus.queue_mtx);
   return kNoErr;
 }
@@ -61,79 +65,90 @@ OSStatus sppWlanCommandProcess(unsigned char *inBuf, int *inBufLen, int inSocket
   return err;
 }
 
-OSStatus sppUartCommandProcess(uint8_t *inBuf, int inLen, app_context_t * const inContext)
+/* Oldest byte still wanted by a connection, anything before it can be overwritten */
+static uint32_t spp_ring_tail(spp_ring_t *ring)
 {
-  spp_log_trace();
-  OSStatus err = kNoErr;
+  uint32_t tail = ring->head;
   int i;
-  mico_queue_t* p_queue=NULL;
-  socket_msg_t *real_msg;
 
   for(i=0; i < MAX_QUEUE_NUM; i++) {
-    p_queue = inContext->appStatus.socket_out_queue[i];
-    if(p_queue  != NULL ){
-      break;
-    }
+    if (ring->reader[i].queue != NULL && (int32_t)(ring->reader[i].cursor - tail) < 0)
+      tail = ring->reader[i].cursor;
   }
-  if (p_queue == NULL)
-    return kNoErr;
-  
-  if (MAX_SOCK_MSG_LEN < sockmsg_len)
-    return kNoMemoryErr;
-  real_msg = (socket_msg_t*)malloc(sizeof(socket_msg_t) - 1 + inLen);
+  return tail;
+}
 
-  if (real_msg == NULL)
-    return kNoMemoryErr;
-  sockmsg_len += (sizeof(socket_msg_t) - 1 + inLen);
-  real_msg->len = inLen;
-  memcpy(real_msg->data, inBuf, inLen);
-  real_msg->ref = 0;
-  
-  mico_rtos_lock_mutex(&inContext->appStatus.queue_mtx);
-  socket_msg_take(real_msg);
-  for(i=0; i < MAX_QUEUE_NUM; i++) {
-    p_queue = inContext->appStatus.socket_out_queue[i];
-    if(p_queue  != NULL ){
-      socket_msg_take(real_msg);
-      if (kNoErr != mico_rtos_push_to_queue(p_queue, &real_msg, 0)) {
-        socket_msg_free(real_msg);
+/* Only one thread may fill the ring. Connections that fall a whole ring
+ * behind lose their oldest data, unless they are sending it right now. A
+ * send never blocks, so the UART is only held up for the time of one copy. */
+int spp_ring_reserve(app_context_t * const inContext, uint8_t **outBuf)
+{
+  spp_ring_t *ring = &inContext->appStatus.ring;
+  spp_reader_t *reader;
+  uint32_t space, keep_from;
+  int i, len = 0;
+
+  while(1) {
+    mico_rtos_lock_mutex(&inContext->appStatus.queue_mtx);
+    space = SPP_RING_SIZE - (ring->head - spp_ring_tail(ring));
+    if (space < UART_ONE_PACKAGE_LENGTH) {
+      keep_from = ring->head - (SPP_RING_SIZE - UART_ONE_PACKAGE_LENGTH);
+      for(i=0; i < MAX_QUEUE_NUM; i++) {
+        reader = &ring->reader[i];
+        if (reader->queue != NULL && reader->busy == false && (int32_t)(reader->cursor - keep_from) < 0) {
+          reader->dropped += keep_from - reader->cursor;
+          reader->cursor = keep_from;
+        }
+      }
+      space = SPP_RING_SIZE - (ring->head - spp_ring_tail(ring));
+    }
+    if (space > 0) {
+      len = Min(space, SPP_RING_SIZE - (ring->head & SPP_RING_MASK));
+      len = Min(len, UART_ONE_PACKAGE_LENGTH);
+      *outBuf = &ring->buf[ring->head & SPP_RING_MASK];
     }
+    mico_rtos_unlock_mutex(&inContext->appStatus.queue_mtx);
+    if (len > 0)
+      return len;
+    mico_rtos_get_semaphore(&ring->space_sem, 100);
   }
-  }        
-  socket_msg_free(real_msg);
-  mico_rtos_unlock_mutex(&inContext->appStatus.queue_mtx);
-  return err;
 }
 
-void socket_msg_take(socket_msg_t*msg)
+void spp_ring_commit(app_context_t * const inContext, int inLen)
 {
-    msg->ref++;
-}
+  spp_ring_t *ring = &inContext->appStatus.ring;
+  int i, token = 0;
 
-void socket_msg_free(socket_msg_t*msg)
-{
-    msg->ref--;
-    if (msg->ref == 0) {
-        sockmsg_len -= (sizeof(socket_msg_t) - 1 + msg->len);
-        free(msg);
-    
+  mico_rtos_lock_mutex(&inContext->appStatus.queue_mtx);
+  ring->head += inLen;
+  for(i=0; i < MAX_QUEUE_NUM; i++) {
+    if (ring->reader[i].queue != NULL) {
+      // a full doorbell has already been rung
+      mico_rtos_push_to_queue(ring->reader[i].queue, &token, 0);
     }
+  }
+  mico_rtos_unlock_mutex(&inContext->appStatus.queue_mtx);
 }
 
-int socket_queue_create(app_context_t * const inContext, mico_queue_t *queue)
+/* The connection is switched to non-blocking sends, see socket_queue_send() */
+int socket_queue_create(app_context_t * const inContext, mico_queue_t *queue, int fd)
 {
     OSStatus err;
-    int i;
-    mico_queue_t *p_queue;
+    int i, opt = 1;
+    spp_ring_t *ring = &inContext->appStatus.ring;
     
-    err = mico_rtos_init_queue(queue, "sockqueue", sizeof(int), MAX_QUEUE_LENGTH);
+    if (setsockopt(fd, SOL_SOCKET, SO_BLOCKMODE, &opt, sizeof(opt)) != 0)
+        return -1;
+    err = mico_rtos_init_queue(queue, "sockqueue", sizeof(int), 1);
     if (err != kNoErr)
         return -1;
     mico_rtos_lock_mutex(&inContext->appStatus.queue_mtx);
     for(i=0; i < MAX_QUEUE_NUM; i++) {
-        p_queue = inContext->appStatus.socket_out_queue[i];
-        if(p_queue == NULL ){
-            inContext->appStatus.socket_out_queue[i] = queue;
+        if(ring->reader[i].queue == NULL ){
+            ring->reader[i].queue = queue;
+            ring->reader[i].cursor = ring->head;
+            ring->reader[i].busy = false;
+            ring->reader[i].dropped = 0;
             mico_rtos_unlock_mutex(&inContext->appStatus.queue_mtx);
             return 0;
         }
@@ -146,22 +161,21 @@ int socket_queue_create(app_context_t * const inContext, mico_queue_t *queue)
 int socket_queue_delete(app_context_t * const inContext, mico_queue_t *queue)
 {
     int i;
-    socket_msg_t *msg;
     int ret = -1;
+    spp_ring_t *ring = &inContext->appStatus.ring;
 
     mico_rtos_lock_mutex(&inContext->appStatus.queue_mtx);
-    // remove queue
+    // remove reader, its data is released with it
     for(i=0; i < MAX_QUEUE_NUM; i++) {
-        if (queue == inContext->appStatus.socket_out_queue[i]) {
-            inContext->appStatus.socket_out_queue[i] = NULL;
+        if (queue == ring->reader[i].queue) {
+            if (ring->reader[i].dropped)
+                spp_log("Connection too slow, %u bytes dropped", (unsigned int)ring->reader[i].dropped);
+            ring->reader[i].queue = NULL;
             ret = 0;
         }
     }
     mico_rtos_unlock_mutex(&inContext->appStatus.queue_mtx);
-    // free queue buffer
-    while(kNoErr == mico_rtos_pop_from_queue( queue, &msg, 0)) {
-        socket_msg_free(msg);
-    }
+    mico_rtos_set_semaphore(&ring->space_sem);
 
     // deinit queue
     mico_rtos_deinit_queue(queue);
@@ -169,3 +183,53 @@ int socket_queue_delete(app_context_t * const inContext, mico_queue_t *queue)
     return ret;
 }
 
+/* Send what is pending for this connection up to the end of the ring, straight
+ * from the ring. The write does not block, so a slow connection does not pin
+ * the ring while the UART fills it: its data is dropped by spp_ring_reserve()
+ * instead. The doorbell is rung again if data is left, so the caller just waits
+ * on the event fd as before. Returns 0 if the socket could take nothing. */
+int socket_queue_send(app_context_t * const inContext, mico_queue_t *queue, int fd)
+{
+    spp_ring_t *ring = &inContext->appStatus.ring;
+    spp_reader_t *reader = NULL;
+    uint32_t cursor;
+    int i, token, len = 0, sent_len, sock_err;
+    socklen_t opt_len;
+
+    mico_rtos_pop_from_queue(queue, &token, 0);
+
+    mico_rtos_lock_mutex(&inContext->appStatus.queue_mtx);
+    for(i=0; i < MAX_QUEUE_NUM; i++) {
+        if (queue == ring->reader[i].queue)
+            reader = &ring->reader[i];
+    }
+    if (reader != NULL) {
+        cursor = reader->cursor;
+        len = Min(ring->head - cursor, SPP_RING_SIZE - (cursor & SPP_RING_MASK));
+        reader->busy = (len > 0);
+    }
+    mico_rtos_unlock_mutex(&inContext->appStatus.queue_mtx);
+    if (reader == NULL)
+        return -1;
+    if (len == 0)
+        return 0;
+
+    sent_len = write(fd, &ring->buf[cursor & SPP_RING_MASK], len);
+    if (sent_len < 0) {
+        opt_len = sizeof(sock_err);
+        getsockopt(fd, SOL_SOCKET, SO_ERROR, &sock_err, &opt_len);
+        if (sock_err == EAGAIN || sock_err == EWOULDBLOCK)
+            sent_len = 0;
+    }
+
+    mico_rtos_lock_mutex(&inContext->appStatus.queue_mtx);
+    reader->busy = false;
+    if (sent_len > 0)
+        reader->cursor += sent_len;
+    if (reader->cursor != ring->head)
+        mico_rtos_push_to_queue(queue, &token, 0);
+    mico_rtos_unlock_mutex(&inContext->appStatus.queue_mtx);
+    mico_rtos_set_semaphore(&ring->space_sem);
+
+    return sent_len;
+}
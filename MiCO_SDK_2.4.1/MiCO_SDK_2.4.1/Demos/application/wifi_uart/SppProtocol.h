@@ -28,13 +28,13 @@
 OSStatus sppProtocolInit(app_context_t * const inContext);
 int is_network_state(int state);
 OSStatus sppWlanCommandProcess(unsigned char *inBuf, int *inBufLen, int inSocketFd, app_context_t * const inContext);
-OSStatus sppUartCommandProcess(uint8_t *inBuf, int inLen, app_context_t * const inContext);
 
 
 void set_network_state(int state, int on);
-int socket_queue_create(app_context_t * const inContext, mico_queue_t *queue);
+int socket_queue_create(app_context_t * const inContext, mico_queue_t *queue, int fd);
 int socket_queue_delete(app_context_t * const inContext, mico_queue_t *queue);
-void socket_msg_free(socket_msg_t*msg);
-void socket_msg_take(socket_msg_t*msg);
+int socket_queue_send(app_context_t * const inContext, mico_queue_t *queue, int fd);
+int spp_ring_reserve(app_context_t * const inContext, uint8_t **outBuf);
+void spp_ring_commit(app_context_t * const inContext, int inLen);
 
 #endif
@@ -31,22 +31,17 @@ void uartRecv_thread(void *inContext)
 {
   uart_recv_log_trace();
   app_context_t *Context = inContext;
-  int recvlen;
+  int recvlen, len;
   uint8_t *inDataBuffer;
   
-  inDataBuffer = malloc(UART_ONE_PACKAGE_LENGTH);
-  require(inDataBuffer, exit);
-  
+  /* Receive straight into the ring the TCP connections send from */
   while(1) {
-    recvlen = _uart_get_one_packet(inDataBuffer, UART_ONE_PACKAGE_LENGTH);
+    len = spp_ring_reserve(Context, &inDataBuffer);
+    recvlen = _uart_get_one_packet(inDataBuffer, len);
     if (recvlen <= 0)
       continue; 
-    sppUartCommandProcess(inDataBuffer, recvlen, Context);
+    spp_ring_commit(Context, recvlen);
   }
-  
-exit:
-  if(inDataBuffer) free(inDataBuffer);
-  mico_rtos_delete_thread(NULL);
 }
 
 /* Packet format: BB 00 CMD(2B) Status(2B) datalen(2B) data(x) checksum(2B)
@@ -65,6 +60,7 @@ size_t _uart_get_one_packet(uint8_t* inBuf, int inBufLen)
    else{
      datalen = MicoUartGetLengthInBuffer( UART_FOR_APP );
      if(datalen){
+       datalen = Min(datalen, inBufLen);
        MicoUartRecv(UART_FOR_APP, inBuf, datalen, UART_RECV_TIMEOUT);
        return datalen;
      }
@@ -0,0 +1,248 @@
+/**
+******************************************************************************
+* @file    sflash_bench.c
+* @author  William Xu
+* @version V1.0.0
+* @date    17-Oct-2026
+* @brief   FatFs SPI flash driver write benchmark demo based on MiCO !
+******************************************************************************
+*
+*  The MIT License
+*  Copyright (c) 2016 MXCHIP Inc.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is furnished
+*  to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in
+*  all copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+*  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+*  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+******************************************************************************
+*/
+
+#include "MICO.h"
+#include "ff_gen_drv.h"
+#include "sflash_diskio.h"
+
+#define sflash_bench_log(M, ...) custom_log("SFLASH Bench", M, ##__VA_ARGS__)
+
+/* Demo Function:
+ * Format the FILESYS partition with each SPI flash driver in turn, the direct
+ * layout and the flash translation layer prototype, and measure the write
+ * throughput of FatFs and how many flash sectors each workload erases. */
+
+#define BENCH_CHUNK_LEN         ( 4096 )
+#define BENCH_SEQ_LEN           ( 256 * 1024 )
+#define BENCH_APPEND_LEN        ( 64 )
+#define BENCH_APPEND_COUNT      ( 1000 )
+#define BENCH_REWRITE_LEN       ( 16 * 1024 )
+#define BENCH_REWRITE_COUNT     ( 20 )
+
+/* Host only, counts the sectors the emulated flash has erased */
+extern const platform_flash_t platform_flash_peripherals[];
+
+typedef enum
+{
+  BENCH_SEQUENTIAL,   /* one file in BENCH_CHUNK_LEN writes */
+  BENCH_APPEND,       /* a log, every record is synced */
+  BENCH_REWRITE,      /* the same file written again from the start */
+} bench_kind_t;
+
+typedef struct
+{
+  const char    *name;
+  const char    *file;
+  bench_kind_t  kind;
+  uint32_t      bytes;
+} bench_run_t;
+
+static const bench_run_t bench_runs[] =
+{
+  { "Sequential 256KB", "seq.bin",     BENCH_SEQUENTIAL, BENCH_SEQ_LEN },
+  { "Append 64B+sync",  "append.log",  BENCH_APPEND,     BENCH_APPEND_LEN * BENCH_APPEND_COUNT },
+  { "Rewrite 16KB x20", "rewrite.bin", BENCH_REWRITE,    BENCH_REWRITE_LEN * BENCH_REWRITE_COUNT },
+};
+
+typedef struct
+{
+  const char          *name;
+  Diskio_drvTypeDef   *driver;
+} bench_layout_t;
+
+static const bench_layout_t bench_layouts[] =
+{
+  { "direct layout",           &SFLASHDISK_Driver },
+  { "flash translation layer", &SFLASHDISK_FTL_Driver },
+};
+
+static FATFS bench_fs;
+static FIL bench_file;
+static char bench_path[4];
+static uint8_t bench_buf[BENCH_CHUNK_LEN];
+
+static uint32_t bench_erase_count( void )
+{
+  mico_logic_partition_t *partition = MicoFlashGetInfo( MICO_PARTITION_FILESYS );
+
+  return platform_flash_erase_count( &platform_flash_peripherals[partition->partition_owner] );
+}
+
+/* Byte n of a file, so a sector that lands in the wrong place is found */
+static uint8_t bench_pattern( uint32_t n, uint32_t seed )
+{
+  return (uint8_t)( ( n >> 8 ) ^ n ^ seed );
+}
+
+static void bench_fill( uint8_t *buf, uint32_t from, uint32_t len, uint32_t seed )
+{
+  uint32_t i;
+
+  for( i = 0; i < len; i++ )
+    buf[i] = bench_pattern( from + i, seed );
+}
+
+static OSStatus bench_write( FIL *file, uint32_t from, uint32_t len, uint32_t seed )
+{
+  UINT written;
+
+  bench_fill( bench_buf, from, len, seed );
+  if( f_write( file, bench_buf, len, &written ) != FR_OK || written != len )
+    return kWriteErr;
+  return kNoErr;
+}
+
+static OSStatus bench_workload( const bench_run_t *run, uint32_t *seed )
+{
+  OSStatus err = kNoErr;
+  uint32_t pos, pass;
+
+  switch( run->kind ){
+    case BENCH_SEQUENTIAL:
+      require_action( f_open( &bench_file, run->file, FA_CREATE_ALWAYS | FA_WRITE ) == FR_OK, exit, err = kOpenErr );
+      for( pos = 0; pos < run->bytes && err == kNoErr; pos += BENCH_CHUNK_LEN )
+        err = bench_write( &bench_file, pos, BENCH_CHUNK_LEN, *seed );
+      f_close( &bench_file );
+      break;
+
+    case BENCH_APPEND:
+      require_action( f_open( &bench_file, run->file, FA_CREATE_ALWAYS | FA_WRITE ) == FR_OK, exit, err = kOpenErr );
+      for( pos = 0; pos < run->bytes && err == kNoErr; pos += BENCH_APPEND_LEN ){
+        err = bench_write( &bench_file, pos, BENCH_APPEND_LEN, *seed );
+        if( err == kNoErr && f_sync( &bench_file ) != FR_OK ) err = kWriteErr;
+      }
+      f_close( &bench_file );
+      break;
+
+    case BENCH_REWRITE:
+      for( pass = 0; pass < BENCH_REWRITE_COUNT && err == kNoErr; pass++ ){
+        *seed = pass;
+        require_action( f_open( &bench_file, run->file, FA_OPEN_ALWAYS | FA_WRITE ) == FR_OK, exit, err = kOpenErr );
+        for( pos = 0; pos < BENCH_REWRITE_LEN && err == kNoErr; pos += BENCH_CHUNK_LEN )
+          err = bench_write( &bench_file, pos, BENCH_CHUNK_LEN, *seed );
+        f_close( &bench_file );
+      }
+      break;
+  }
+
+exit:
+  return err;
+}
+
+/* Bytes of the file that differ from the pattern it was written with */
+static uint32_t bench_verify( const bench_run_t *run, uint32_t seed )
+{
+  uint32_t pos = 0, i, bad = 0, expected_len;
+  UINT got;
+
+  expected_len = run->kind == BENCH_REWRITE ? BENCH_REWRITE_LEN : run->bytes;
+  if( f_open( &bench_file, run->file, FA_READ ) != FR_OK ) return expected_len;
+  while( f_read( &bench_file, bench_buf, sizeof(bench_buf), &got ) == FR_OK && got > 0 ){
+    for( i = 0; i < got; i++ )
+      if( bench_buf[i] != bench_pattern( pos + i, seed ) ) bad++;
+    pos += got;
+  }
+  f_close( &bench_file );
+  if( pos != expected_len ) bad += pos > expected_len ? pos - expected_len : expected_len - pos;
+  return bad;
+}
+
+static bool bench_run( const bench_run_t *run )
+{
+  OSStatus err;
+  uint32_t start, elapsed, erases, seed = 0x5A, bad;
+
+  erases = bench_erase_count( );
+  start = mico_get_time( );
+  err = bench_workload( run, &seed );
+  /* The FTL collects garbage on sync, count that with the workload */
+  disk_ioctl( 0, CTRL_SYNC, NULL );
+  elapsed = mico_get_time( ) - start;
+  if( elapsed == 0 ) elapsed = 1;
+  erases = bench_erase_count( ) - erases;
+  bad = bench_verify( run, seed );
+
+  sflash_bench_log( "%-17s %4d KB in %5d ms, %4d KB/s, %5d sectors erased, %d.%02d per KB, %d bad bytes, err %d",
+                    run->name, (int)( run->bytes / 1024 ), (int)elapsed, (int)( run->bytes / elapsed * 1000 / 1024 ),
+                    (int)erases, (int)( erases * 1024 / run->bytes ), (int)( erases * 102400 / run->bytes % 100 ),
+                    (int)bad, (int)err );
+  return err == kNoErr && bad == 0;
+}
+
+static bool bench_layout( const bench_layout_t *layout, bool volume_left )
+{
+  mico_logic_partition_t *partition = MicoFlashGetInfo( MICO_PARTITION_FILESYS );
+  FRESULT res;
+  uint32_t i;
+  bool passed = false;
+
+  sflash_bench_log( "%s:", layout->name );
+  FATFS_LinkDriver( layout->driver, bench_path );
+
+  /* The layouts are not compatible, the FTL must refuse the volume of the direct layout */
+  if( volume_left && layout->driver == &SFLASHDISK_FTL_Driver ){
+    res = f_mount( &bench_fs, (TCHAR const*)bench_path, 1 );
+    f_mount( NULL, (TCHAR const*)bench_path, 0 );
+    sflash_bench_log( "Volume of the direct layout: %s (%d)", res == FR_OK ? "MOUNTED" : "refused", res );
+    require( res != FR_OK, exit );
+  }
+
+  require_noerr( MicoFlashErase( MICO_PARTITION_FILESYS, 0x0, partition->partition_length ), exit );
+  res = f_mount( &bench_fs, (TCHAR const*)bench_path, 0 );
+  require_action( res == FR_OK, exit, sflash_bench_log( "Mount failed: %d", res ) );
+  res = f_mkfs( (TCHAR const*)bench_path, 0, _MAX_SS );
+  require_action( res == FR_OK, exit, sflash_bench_log( "Format failed: %d", res ) );
+
+  passed = true;
+  for( i = 0; i < sizeof(bench_runs) / sizeof(bench_runs[0]); i++ )
+    passed &= bench_run( &bench_runs[i] );
+
+exit:
+  f_mount( NULL, (TCHAR const*)bench_path, 0 );
+  FATFS_UnLinkDriver( bench_path );
+  return passed;
+}
+
+int application_start( void )
+{
+  mico_logic_partition_t *partition = MicoFlashGetInfo( MICO_PARTITION_FILESYS );
+  uint32_t i;
+  bool passed = true;
+
+  sflash_bench_log( "SFLASH Bench Start, %d KB partition", (int)( partition->partition_length / 1024 ) );
+
+  /* Each layout leaves its volume behind for the next one */
+  for( i = 0; i < sizeof(bench_layouts) / sizeof(bench_layouts[0]) && passed; i++ )
+    passed &= bench_layout( &bench_layouts[i], i > 0 );
+
+  sflash_bench_log( "SFLASH Bench %s!", passed ? "finished" : "failed" );
+  return 0;
+}
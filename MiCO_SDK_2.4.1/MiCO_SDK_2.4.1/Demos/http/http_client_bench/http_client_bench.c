@@ -0,0 +1,327 @@
+/**
+******************************************************************************
+* @file    http_client_bench.c
+* @author  William Xu
+* @version V1.0.0
+* @date    17-Oct-2026
+* @brief   HTTP client request rate benchmark demo based on MiCO !
+******************************************************************************
+*
+*  The MIT License
+*  Copyright (c) 2016 MXCHIP Inc.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is furnished
+*  to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in
+*  all copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+*  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+*  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+******************************************************************************
+*/
+
+
+#include "MICO.h"
+#include "HTTPClientUtils.h"
+#include "SocketUtils.h"
+
+#define http_bench_log(M, ...) custom_log("HTTP Bench", M, ##__VA_ARGS__)
+
+/* Demo Function:
+ * Start a small HTTP/1.1 server on the loopback interface and measure how many
+ * requests per second HTTPClientUtils gets answered: with a new connection for
+ * every request, over kept connections, with pipelining, with chunked responses
+ * and with streamed request bodies. */
+
+#define BENCH_SERVER_IP         "127.0.0.1"
+#define BENCH_SERVER_PORT       ( 8090 )
+#define BENCH_SERVER_CLIENTS    ( 8 )
+#define BENCH_SERVER_BUF_LEN    ( 8192 )
+#define BENCH_BODY_LEN          ( 64 )
+#define BENCH_UPLOAD_LEN        ( 1024 )
+#define BENCH_REQUEST_COUNT     ( 2000 )
+
+/*
+ * Loopback test server
+ */
+
+typedef struct
+{
+  int     fd;
+  size_t  len;
+  char    buf[BENCH_SERVER_BUF_LEN];
+} bench_server_client_t;
+
+static bench_server_client_t bench_server_clients[BENCH_SERVER_CLIENTS];
+static const char bench_body[BENCH_BODY_LEN + 1] = "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef";
+
+/* Length of the request at the start of buf, 0 if it is not complete yet */
+static size_t bench_server_request_len( bench_server_client_t *client )
+{
+  char *end, *field, *body;
+  size_t headerLen, contentLength = 0;
+
+  client->buf[client->len] = 0;
+  end = strstr( client->buf, "\r\n\r\n" );
+  if( end == NULL ) return 0;
+  headerLen = end + 4 - client->buf;
+  body = end + 4;
+
+  if( strstr( client->buf, "Transfer-Encoding: chunked" ) && strstr( client->buf, "Transfer-Encoding: chunked" ) < end ){
+    /* The test bodies hold no CRLF, so the last chunk is easy to find */
+    end = strstr( body, "\r\n0\r\n\r\n" );
+    return end ? (size_t)( end + 7 - client->buf ) : 0;
+  }
+
+  field = strstr( client->buf, "Content-Length: " );
+  if( field && field < end )
+    contentLength = atoi( field + 16 );
+  return ( client->len >= headerLen + contentLength ) ? headerLen + contentLength : 0;
+}
+
+static OSStatus bench_server_respond( bench_server_client_t *client, size_t requestLen )
+{
+  OSStatus err = kNoErr;
+  char response[512];
+  int len;
+  bool close_connection = ( strstr( client->buf, "Connection: close" ) != NULL
+                           && strstr( client->buf, "Connection: close" ) < client->buf + requestLen );
+
+  if( strncmp( client->buf, "GET /chunked ", 13 ) == 0 ){
+    len = sprintf( response, "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+                             "10\r\n%.16s\r\n20;ext=1\r\n%.32s\r\n10\r\n%.16s\r\n0\r\nX-Trailer: 1\r\n\r\n",
+                             bench_body, bench_body, bench_body );
+  }else{
+    len = sprintf( response, "HTTP/1.1 200 OK\r\nContent-Length: %d\r\n%s\r\n%s",
+                   BENCH_BODY_LEN, close_connection ? "Connection: close\r\n" : "", bench_body );
+  }
+  err = SocketSend( client->fd, (uint8_t *)response, len );
+  require_noerr( err, exit );
+  require_action_quiet( !close_connection, exit, err = kConnectionErr );
+
+  client->len -= requestLen;
+  memmove( client->buf, client->buf + requestLen, client->len );
+
+exit:
+  return err;
+}
+
+static void bench_server_thread( void *arg )
+{
+  UNUSED_PARAMETER( arg );
+  OSStatus err = kNoErr;
+  struct sockaddr_t addr;
+  socklen_t addrLen;
+  fd_set readfds;
+  int listen_fd, fd, i, len;
+  size_t requestLen;
+  bench_server_client_t *client;
+
+  for( i = 0; i < BENCH_SERVER_CLIENTS; i++ )
+    bench_server_clients[i].fd = -1;
+
+  listen_fd = socket( AF_INET, SOCK_STREAM, IPPROTO_TCP );
+  require_action( IsValidSocket( listen_fd ), exit, err = kNoResourcesErr );
+  addr.s_ip = INADDR_ANY;
+  addr.s_port = BENCH_SERVER_PORT;
+  err = bind( listen_fd, &addr, sizeof(addr) );
+  require_noerr( err, exit );
+  err = listen( listen_fd, BENCH_SERVER_CLIENTS );
+  require_noerr( err, exit );
+
+  while( 1 ){
+    FD_ZERO( &readfds );
+    FD_SET( listen_fd, &readfds );
+    for( i = 0; i < BENCH_SERVER_CLIENTS; i++ )
+      if( bench_server_clients[i].fd >= 0 ) FD_SET( bench_server_clients[i].fd, &readfds );
+    select( 1, &readfds, NULL, NULL, NULL );
+
+    if( FD_ISSET( listen_fd, &readfds ) ){
+      addrLen = sizeof(addr);
+      fd = accept( listen_fd, &addr, &addrLen );
+      for( i = 0; i < BENCH_SERVER_CLIENTS && bench_server_clients[i].fd >= 0; i++ );
+      if( i < BENCH_SERVER_CLIENTS ){
+        bench_server_clients[i].fd = fd;
+        bench_server_clients[i].len = 0;
+      }else{
+        SocketClose( &fd );
+      }
+    }
+
+    for( i = 0; i < BENCH_SERVER_CLIENTS; i++ ){
+      client = &bench_server_clients[i];
+      if( client->fd < 0 || !FD_ISSET( client->fd, &readfds ) ) continue;
+      len = recv( client->fd, client->buf + client->len, BENCH_SERVER_BUF_LEN - 1 - client->len, 0 );
+      if( len <= 0 ){
+        SocketClose( &client->fd );
+        continue;
+      }
+      client->len += len;
+      /* Pipelined requests may have come in one read */
+      while( ( requestLen = bench_server_request_len( client ) ) > 0 ){
+        if( bench_server_respond( client, requestLen ) != kNoErr ){
+          SocketClose( &client->fd );
+          break;
+        }
+      }
+      if( client->fd >= 0 && client->len == BENCH_SERVER_BUF_LEN - 1 )
+        SocketClose( &client->fd );
+    }
+  }
+
+exit:
+  http_bench_log( "Server exit with err = %d", err );
+  mico_rtos_delete_thread( NULL );
+}
+
+/*
+ * Client side
+ */
+
+typedef struct
+{
+  const char *      name;
+  const char *      method;
+  const char *      path;
+  const char *      headers;
+  int               concurrency;
+  bool              upload;
+  size_t            expectedBody;
+} bench_mode_t;
+
+static const bench_mode_t bench_modes[] =
+{
+  { "new connection",   "GET",  "/",        "Connection: close\r\n", 2, false, BENCH_BODY_LEN },
+  { "keep-alive",       "GET",  "/",        NULL,                    2, false, BENCH_BODY_LEN },
+  { "pipelined",        "GET",  "/",        NULL,                    8, false, BENCH_BODY_LEN },
+  { "chunked response", "GET",  "/chunked", NULL,                    8, false, BENCH_BODY_LEN },
+  { "streamed upload",  "POST", "/upload",  NULL,                    2, true,  BENCH_BODY_LEN },
+};
+
+typedef struct
+{
+  const bench_mode_t *  mode;
+  HTTPClientRequest_t   requests[8];
+  size_t                uploaded[8];
+  size_t                received[8];
+  int                   sent;
+  int                   done;
+  int                   errors;
+  int                   badBodies;
+  mico_semaphore_t      finished;
+} bench_run_t;
+
+static bench_run_t bench_run;
+
+static int bench_send_body( HTTPClientRequest_t *request, uint8_t *buf, size_t len )
+{
+  size_t *uploaded = &bench_run.uploaded[request - bench_run.requests];
+
+  if( *uploaded + len > BENCH_UPLOAD_LEN ) len = BENCH_UPLOAD_LEN - *uploaded;
+  memset( buf, 'a', len );
+  *uploaded += len;
+  return len;
+}
+
+static void bench_send( int i );
+
+static void bench_on_event( HTTPClientRequest_t *request, HTTPClientEvent_t event, const uint8_t *data, size_t len )
+{
+  int i = request - bench_run.requests;
+
+  switch( event ){
+    case kHTTPClientEvent_Header:
+      break;
+    case kHTTPClientEvent_Body:
+      bench_run.received[i] += len;
+      break;
+    case kHTTPClientEvent_Done:
+    case kHTTPClientEvent_Error:
+      if( event == kHTTPClientEvent_Error )
+        bench_run.errors++;
+      else if( bench_run.received[i] != bench_run.mode->expectedBody || request->response->statusCode != 200 )
+        bench_run.badBodies++;
+      if( ++bench_run.done == BENCH_REQUEST_COUNT )
+        mico_rtos_set_semaphore( &bench_run.finished );
+      else if( bench_run.sent < BENCH_REQUEST_COUNT )
+        bench_send( i );
+      break;
+  }
+}
+
+static void bench_send( int i )
+{
+  const bench_mode_t *mode = bench_run.mode;
+  HTTPClientRequest_t *request = &bench_run.requests[i];
+
+  HTTPClientRequestInit( request, BENCH_SERVER_IP, BENCH_SERVER_PORT, false, mode->method, mode->path, bench_on_event, NULL );
+  request->headers = mode->headers;
+  if( mode->upload )
+    request->onSendBody = bench_send_body;  // bodyLen 0: sent in chunks
+  bench_run.uploaded[i] = 0;
+  bench_run.received[i] = 0;
+  bench_run.sent++;
+  if( HTTPClientSend( request ) != kNoErr ){
+    bench_run.errors++;
+    bench_run.done++;
+  }
+}
+
+static void bench_run_mode( const bench_mode_t *mode )
+{
+  uint32_t start, elapsed;
+  int free_memory, i;
+
+  memset( &bench_run, 0x0, sizeof(bench_run) );
+  bench_run.mode = mode;
+  mico_rtos_init_semaphore( &bench_run.finished, 1 );
+  free_memory = MicoGetMemoryInfo()->free_memory;
+
+  start = mico_get_time( );
+  for( i = 0; i < mode->concurrency; i++ )
+    bench_send( i );
+  mico_rtos_get_semaphore( &bench_run.finished, 60 * 1000 );
+  elapsed = mico_get_time( ) - start;
+  if( elapsed == 0 ) elapsed = 1;
+
+  /* Connections of the last run should not count against the next one */
+  HTTPClientCloseIdleConnections( );
+  mico_thread_msleep( 100 );
+
+  http_bench_log( "%-17s %5d requests/s, %d done, %d errors, %d bad responses, heap %d bytes",
+                  mode->name, (int)( bench_run.done * 1000 / elapsed ), bench_run.done, bench_run.errors,
+                  bench_run.badBodies, free_memory - MicoGetMemoryInfo()->free_memory );
+  mico_rtos_deinit_semaphore( &bench_run.finished );
+}
+
+int application_start( void )
+{
+  OSStatus err = kNoErr;
+  int i;
+
+  err = mico_rtos_create_thread( NULL, MICO_APPLICATION_PRIORITY, "Bench Server", bench_server_thread, 0x1000, NULL );
+  require_noerr( err, exit );
+  err = HTTPClientStart( );
+  require_noerr( err, exit );
+  mico_thread_msleep( 100 );
+
+  http_bench_log( "HTTP Client Bench Start, %d requests per run", BENCH_REQUEST_COUNT );
+  for( i = 0; i < sizeof(bench_modes) / sizeof(bench_modes[0]); i++ )
+    bench_run_mode( &bench_modes[i] );
+  http_bench_log( "HTTP Client Bench finished!" );
+
+exit:
+  if( err != kNoErr )
+    http_bench_log("Thread exit with err: %d", err);
+  mico_rtos_delete_thread( NULL );
+  return err;
+}
@@ -0,0 +1,218 @@
+/**
+******************************************************************************
+* @file    http_header_bench.c
+* @author  William Xu
+* @version V1.0.0
+* @date    17-Oct-2026
+* @brief   HTTP header receive and parse benchmark demo based on MiCO !
+******************************************************************************
+*
+*  The MIT License
+*  Copyright (c) 2016 MXCHIP Inc.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is furnished
+*  to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in
+*  all copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+*  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+*  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+******************************************************************************
+*/
+
+#include "MICO.h"
+#include "HTTPUtils.h"
+#include "platform_peripheral.h"
+
+#define http_header_bench_log(M, ...) custom_log("HTTP Header Bench", M, ##__VA_ARGS__)
+
+/* Demo Function:
+ * Feed HTTP response headers to HTTPUtils the way SocketReadHTTPHeader() gets
+ * them from read(): one byte, 16 bytes or a whole TCP segment (1460 bytes) at
+ * a time. After each piece findHeader() looks for the end of the header, then
+ * HTTPHeaderParse() parses it and Content-Type is looked up 64 times.
+ * Compare findHeader() resuming where it stopped with starting again from the
+ * first byte every time, and HTTPHeaderGetField() with HTTPGetHeaderField().
+ * Every way must find the same header end, length, persistence and
+ * Content-Type. */
+
+#define BENCH_ITERATIONS        ( 200 )
+#define BENCH_BUF_LEN           ( 4096 )
+#define BENCH_LOOKUPS           ( 64 )
+#define BENCH_BODY_LEN          ( 100 )
+#define BENCH_COOKIES           ( 32 )
+
+/*
+ * Headers
+ */
+
+static const char bench_small_header[] =
+  "HTTP/1.1 200 OK\r\n"
+  "Server: nginx/1.10.1\r\n"
+  "Date: Sat, 17 Oct 2026 08:00:00 GMT\r\n"
+  "Content-Type: application/json; charset=utf-8\r\n"
+  "Content-Length: 100\r\n"
+  "Connection: keep-alive\r\n"
+  "Cache-Control: no-cache, no-store, must-revalidate\r\n"
+  "Pragma: no-cache\r\n"
+  "Expires: 0\r\n"
+  "X-Request-Id: 6a1f4c2e-9b7d-4e3a-8c5f-2d1e0b9a8c7d\r\n"
+  "X-Frame-Options: SAMEORIGIN\r\n"
+  "X-Content-Type-Options: nosniff\r\n"
+  "Strict-Transport-Security: max-age=31536000; includeSubDomains\r\n"
+  "Access-Control-Allow-Origin: *\r\n"
+  "Access-Control-Allow-Headers: Content-Type, Authorization\r\n"
+  "Vary: Accept-Encoding\r\n"
+  "\r\n";
+
+/* Some servers end lines with a bare LF */
+static const char bench_lf_header[] =
+  "HTTP/1.0 200 OK\n"
+  "Content-Type: application/ota-stream\n"
+  "Content-Length: 100\n"
+  "\n";
+
+/* bench_small_header with BENCH_COOKIES cookies, filled in at start */
+static char bench_large_header[BENCH_BUF_LEN];
+
+typedef struct
+{
+  const char *  name;
+  const char *  header;
+  bool          persistent;
+} bench_header_t;
+
+static const bench_header_t bench_headers[] =
+{
+  { "small",          bench_small_header, true },
+  { "large",          bench_large_header, true },
+  { "LF only",        bench_lf_header,    false },
+};
+
+static const size_t bench_chunks[] = { 1, 16, 1460 };
+
+static char bench_stream[BENCH_BUF_LEN];
+
+/*
+ * Receive and parse
+ */
+
+typedef struct
+{
+  size_t        len;            /* header length found */
+  uint64_t      contentLength;
+  bool          persistent;
+  const char *  contentType;
+  size_t        contentTypeLen;
+} bench_result_t;
+
+/* false if the header was not found or did not parse */
+static bool bench_receive( HTTPHeader_t *header, size_t streamLen, size_t chunk, bool rescan, bool indexed,
+                           bench_result_t *result )
+{
+  char *end;
+  size_t n;
+  int i;
+
+  HTTPHeaderClear( header );
+  header->len = 0;
+  for( ;; ){
+    /* What findHeader() did before it kept a resume offset */
+    if( rescan ) header->scanOffset = 0;
+    if( findHeader( header, &end ) ) break;
+    if( header->len == streamLen ) return false;
+    n = streamLen - header->len < chunk ? streamLen - header->len : chunk;
+    memcpy( header->buf + header->len, bench_stream + header->len, n );
+    header->len += n;
+  }
+
+  header->len = (size_t)( end - header->buf );
+  if( HTTPHeaderParse( header ) != kNoErr ) return false;
+
+  result->len = header->len;
+  result->contentLength = header->contentLength;
+  result->persistent = header->persistent;
+  result->contentType = NULL;
+  for( i = 0; i < BENCH_LOOKUPS; i++ ){
+    if( indexed )
+      HTTPHeaderGetField( header, kHTTPHeaderField_ContentType, &result->contentType, &result->contentTypeLen );
+    else
+      HTTPGetHeaderField( header->buf, header->len, "Content-Type", NULL, NULL, &result->contentType,
+                          &result->contentTypeLen, NULL );
+  }
+  return result->contentType != NULL;
+}
+
+static bool bench_header( HTTPHeader_t *header, const bench_header_t *bench )
+{
+  bench_result_t result;
+  size_t headerLen = strlen( bench->header ), streamLen = headerLen + BENCH_BODY_LEN;
+  uint64_t start, elapsed[2];
+  bool ok = true;
+  int c, rescan, i;
+
+  /* The body follows the header in the stream, the last read takes some of it */
+  memcpy( bench_stream, bench->header, headerLen );
+  memset( bench_stream + headerLen, 'x', BENCH_BODY_LEN );
+
+  for( c = 0; c < sizeof(bench_chunks) / sizeof(bench_chunks[0]); c++ ){
+    for( rescan = 0; rescan < 2; rescan++ ){
+      if( !bench_receive( header, streamLen, bench_chunks[c], rescan, !rescan, &result )
+          || result.len != headerLen || result.contentLength != BENCH_BODY_LEN
+          || result.persistent != bench->persistent
+          || strncmp( result.contentType, strstr( bench->header, "Content-Type: " ) + 14, result.contentTypeLen ) != 0 ){
+        http_header_bench_log( "%s header in %d byte reads%s: WRONG RESULT", bench->name, (int)bench_chunks[c],
+                               rescan ? ", scanned from the start" : "" );
+        ok = false;
+        continue;
+      }
+
+      start = platform_get_nanosecond_clock_value( );
+      for( i = 0; i < BENCH_ITERATIONS; i++ )
+        bench_receive( header, streamLen, bench_chunks[c], rescan, !rescan, &result );
+      elapsed[rescan] = ( platform_get_nanosecond_clock_value( ) - start ) / BENCH_ITERATIONS;
+    }
+    if( ok )
+      http_header_bench_log( "%-7s %4d bytes, %4d byte reads: incremental + indexed %7d ns, from the start + scanned %8d ns",
+                             bench->name, (int)headerLen, (int)bench_chunks[c], (int)elapsed[0], (int)elapsed[1] );
+  }
+  return ok;
+}
+
+int application_start( void )
+{
+  HTTPHeader_t *header = NULL;
+  bool passed = false;
+  char *dst;
+  int i;
+
+  /* The large header: the small one with cookies before the blank line */
+  dst = bench_large_header + strlen( bench_small_header ) - 2;
+  memcpy( bench_large_header, bench_small_header, dst - bench_large_header );
+  for( i = 0; i < BENCH_COOKIES; i++ )
+    dst += sprintf( dst, "Set-Cookie: session%02d=4f2a9c1e7b3d5a8f6e0c2b4d; Path=/; HttpOnly; Secure\r\n", i );
+  strcpy( dst, "\r\n" );
+
+  header = HTTPHeaderCreate( BENCH_BUF_LEN );
+  require( header, exit );
+
+  http_header_bench_log( "HTTP Header Bench Start, %d iterations, %d Content-Type lookups each", BENCH_ITERATIONS, BENCH_LOOKUPS );
+  passed = true;
+  for( i = 0; i < sizeof(bench_headers) / sizeof(bench_headers[0]); i++ )
+    passed &= bench_header( header, &bench_headers[i] );
+
+exit:
+  http_header_bench_log( "HTTP Header Bench %s!", passed ? "finished" : "failed" );
+  if( header ) HTTPHeaderDestory( &header );
+  mico_rtos_delete_thread( NULL );
+  return 0;
+}
@@ -134,7 +134,7 @@ struct httpd_wsgi_call g_app_handlers[] = {
   {"/setting.htm", HTTPD_HDR_DEFORT, 0, web_send_wifisetting_page, NULL, NULL, NULL},
 };
 
-int g_app_handlers_no = sizeof(g_app_handlers)/sizeof(struct httpd_wsgi_call);
+static int g_app_handlers_no = sizeof(g_app_handlers)/sizeof(struct httpd_wsgi_call);
 
 static void app_http_register_handlers()
 {
@@ -0,0 +1,270 @@
+/**
+******************************************************************************
+* @file    httpd_bench.c
+* @author  William Xu
+* @version V1.0.0
+* @date    17-Oct-2026
+* @brief   HTTP server connection rate and latency benchmark demo based on MiCO !
+******************************************************************************
+*
+*  The MIT License
+*  Copyright (c) 2016 MXCHIP Inc.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is furnished
+*  to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in
+*  all copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+*  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+*  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+******************************************************************************
+*/
+
+#include "MICO.h"
+#include "SocketUtils.h"
+#include "platform_peripheral.h"
+#include <httpd.h>
+#include "httpd_priv.h"
+
+#define httpd_bench_log(M, ...) custom_log("HTTPD Bench", M, ##__VA_ARGS__)
+
+/* Demo Function:
+ * Start httpd and load it from client threads on the loopback interface.
+ * Measure how many connections and requests per second it serves, and the
+ * p50/p99 latency of a request, with a new connection for every request and
+ * over kept connections, with fewer and with more clients than httpd has
+ * connection slots (HTTPD_MAX_CLIENT_CONN). */
+
+#define BENCH_SERVER_IP         "127.0.0.1"
+#define BENCH_BODY_LEN          ( 64 )
+#define BENCH_REQUEST_COUNT     ( 2000 )
+#define BENCH_RESPONSE_LEN      ( 512 )
+
+/*
+ * Server side
+ */
+
+static const char bench_body[BENCH_BODY_LEN + 1] = "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef";
+
+static int bench_get_handler( httpd_request_t *req )
+{
+  OSStatus err = kNoErr;
+
+  err = httpd_send_all_header( req, HTTP_RES_200, BENCH_BODY_LEN, HTTP_CONTENT_PLAIN_TEXT_STR );
+  require_noerr( err, exit );
+  err = httpd_send_body( req->sock, (const unsigned char *)bench_body, BENCH_BODY_LEN );
+
+exit:
+  return err;
+}
+
+/* No HTTPD_HDR_ADD_CONN_CLOSE, so httpd keeps the connection unless asked to close */
+static struct httpd_wsgi_call bench_handlers[] =
+{
+  { "/bench", HTTPD_HDR_ADD_SERVER, 0, bench_get_handler, NULL, NULL, NULL },
+};
+
+/*
+ * Client side
+ */
+
+typedef struct
+{
+  const char *  name;
+  bool          keepAlive;
+  int           clients;
+} bench_mode_t;
+
+static const bench_mode_t bench_modes[] =
+{
+  { "new connection", false, 1 },
+  { "new connection", false, 4 },
+  { "new connection", false, 8 },
+  { "keep-alive",     true,  1 },
+  { "keep-alive",     true,  4 },
+  { "keep-alive",     true,  8 },
+};
+
+typedef struct
+{
+  const bench_mode_t *  mode;
+  uint32_t              latency[BENCH_REQUEST_COUNT];  // us, per request
+  int                   done;
+  int                   connections;
+  int                   errors;
+  mico_mutex_t          mutex;
+  mico_semaphore_t      finished;
+} bench_run_t;
+
+static bench_run_t bench_run;
+
+static uint32_t bench_now_us( void )
+{
+  return (uint32_t)( platform_get_nanosecond_clock_value( ) / 1000 );
+}
+
+static OSStatus bench_connect( int *fd )
+{
+  OSStatus err = kNoErr;
+  struct sockaddr_t addr;
+
+  *fd = socket( AF_INET, SOCK_STREAM, IPPROTO_TCP );
+  require_action( IsValidSocket( *fd ), exit, err = kNoResourcesErr );
+  addr.s_ip = inet_addr( BENCH_SERVER_IP );
+  addr.s_port = HTTP_PORT;
+  err = connect( *fd, &addr, sizeof(addr) );
+  require_noerr_action( err, exit, SocketClose( fd ) );
+
+exit:
+  return err;
+}
+
+/* Send one GET and read its whole response */
+static OSStatus bench_request( int fd, bool keepAlive )
+{
+  OSStatus err = kNoErr;
+  char response[BENCH_RESPONSE_LEN + 1];
+  char *end, *field;
+  int len, total = 0, expected = -1;
+  const char *request = keepAlive ? "GET /bench HTTP/1.1\r\nHost: bench\r\n\r\n"
+                                  : "GET /bench HTTP/1.1\r\nHost: bench\r\nConnection: close\r\n\r\n";
+
+  err = SocketSend( fd, (const uint8_t *)request, strlen( request ) );
+  require_noerr( err, exit );
+
+  while( expected < 0 || total < expected ){
+    len = recv( fd, response + total, BENCH_RESPONSE_LEN - total, 0 );
+    require_action_quiet( len > 0, exit, err = kConnectionErr );
+    total += len;
+    response[total] = 0;
+    if( expected < 0 && ( end = strstr( response, "\r\n\r\n" ) ) != NULL ){
+      require_action( strncmp( response, HTTP_RES_200, strlen( HTTP_RES_200 ) ) == 0, exit, err = kResponseErr );
+      field = strstr( response, "Content-Length: " );
+      require_action( field && field < end, exit, err = kResponseErr );
+      expected = end + 4 - response + atoi( field + 16 );
+    }
+    require_action( total < BENCH_RESPONSE_LEN || expected >= 0, exit, err = kSizeErr );
+  }
+  /* Pipelining is not used, so nothing may follow the body */
+  require_action( total == expected && memcmp( response + total - BENCH_BODY_LEN, bench_body, BENCH_BODY_LEN ) == 0,
+                  exit, err = kResponseErr );
+
+exit:
+  return err;
+}
+
+/* Take the next request of the run, -1 when all are taken */
+static int bench_next_request( void )
+{
+  int n;
+
+  mico_rtos_lock_mutex( &bench_run.mutex );
+  n = bench_run.done < BENCH_REQUEST_COUNT ? bench_run.done++ : -1;
+  mico_rtos_unlock_mutex( &bench_run.mutex );
+  return n;
+}
+
+static void bench_count( int *counter )
+{
+  mico_rtos_lock_mutex( &bench_run.mutex );
+  (*counter)++;
+  mico_rtos_unlock_mutex( &bench_run.mutex );
+}
+
+static void bench_client_thread( void *arg )
+{
+  UNUSED_PARAMETER( arg );
+  const bench_mode_t *mode = bench_run.mode;
+  int fd = -1, n;
+  uint32_t start;
+
+  while( ( n = bench_next_request( ) ) >= 0 ){
+    /* Connection setup is part of the latency when it is not kept */
+    start = bench_now_us( );
+    if( fd < 0 && bench_connect( &fd ) == kNoErr )
+      bench_count( &bench_run.connections );
+    if( fd < 0 || bench_request( fd, mode->keepAlive ) != kNoErr ){
+      bench_count( &bench_run.errors );
+      SocketClose( &fd );
+    }
+    bench_run.latency[n] = bench_now_us( ) - start;
+    if( !mode->keepAlive )
+      SocketClose( &fd );
+  }
+
+  SocketClose( &fd );
+  mico_rtos_set_semaphore( &bench_run.finished );
+  mico_rtos_delete_thread( NULL );
+}
+
+static int bench_compare( const void *a, const void *b )
+{
+  uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+  return x < y ? -1 : x > y;
+}
+
+static void bench_run_mode( const bench_mode_t *mode )
+{
+  uint32_t start, elapsed;
+  int i;
+
+  memset( &bench_run, 0x0, sizeof(bench_run) );
+  bench_run.mode = mode;
+  mico_rtos_init_mutex( &bench_run.mutex );
+  mico_rtos_init_semaphore( &bench_run.finished, mode->clients );
+
+  start = mico_get_time( );
+  for( i = 0; i < mode->clients; i++ )
+    mico_rtos_create_thread( NULL, MICO_APPLICATION_PRIORITY, "Bench Client", bench_client_thread, 0x1000, NULL );
+  for( i = 0; i < mode->clients; i++ )
+    mico_rtos_get_semaphore( &bench_run.finished, 60 * 1000 );
+  elapsed = mico_get_time( ) - start;
+  if( elapsed == 0 ) elapsed = 1;
+
+  qsort( bench_run.latency, BENCH_REQUEST_COUNT, sizeof(uint32_t), bench_compare );
+  httpd_bench_log( "%-14s x%d %5d connections/s, %5d requests/s, p50 %5d us, p99 %6d us, max %6d us, %d errors",
+                   mode->name, mode->clients, (int)( bench_run.connections * 1000 / elapsed ),
+                   (int)( BENCH_REQUEST_COUNT * 1000 / elapsed ), (int)bench_run.latency[BENCH_REQUEST_COUNT / 2],
+                   (int)bench_run.latency[BENCH_REQUEST_COUNT * 99 / 100], (int)bench_run.latency[BENCH_REQUEST_COUNT - 1],
+                   bench_run.errors );
+
+  /* Let httpd see the last connections close before the next run */
+  mico_thread_msleep( 100 );
+  mico_rtos_deinit_semaphore( &bench_run.finished );
+  mico_rtos_deinit_mutex( &bench_run.mutex );
+}
+
+int application_start( void )
+{
+  OSStatus err = kNoErr;
+  int i;
+
+  err = httpd_init( );
+  require_noerr( err, exit );
+  err = httpd_start( );
+  require_noerr( err, exit );
+  err = httpd_register_wsgi_handlers( bench_handlers, sizeof(bench_handlers) / sizeof(bench_handlers[0]) );
+  require_noerr( err, exit );
+  mico_thread_msleep( 100 );
+
+  httpd_bench_log( "HTTPD Bench Start, %d requests per run, %d connection slots", BENCH_REQUEST_COUNT, HTTPD_MAX_CLIENT_CONN );
+  for( i = 0; i < sizeof(bench_modes) / sizeof(bench_modes[0]); i++ )
+    bench_run_mode( &bench_modes[i] );
+  httpd_bench_log( "HTTPD Bench finished!" );
+
+exit:
+  if( err != kNoErr )
+    httpd_bench_log("Thread exit with err: %d", err);
+  mico_rtos_delete_thread( NULL );
+  return err;
+}
@@ -0,0 +1,268 @@
+/**
+******************************************************************************
+* @file    httpd_dispatch_bench.c
+* @author  William Xu
+* @version V1.0.0
+* @date    17-Oct-2026
+* @brief   HTTP server WSGI and SSI dispatch cost benchmark demo based on MiCO !
+******************************************************************************
+*
+*  The MIT License
+*  Copyright (c) 2016 MXCHIP Inc.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is furnished
+*  to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in
+*  all copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+*  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+*  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+******************************************************************************
+*/
+
+#include "MICO.h"
+#include "platform_peripheral.h"
+#include <httpd.h>
+#include "httpd_priv.h"
+
+#define dispatch_bench_log(M, ...) custom_log("Dispatch Bench", M, ##__VA_ARGS__)
+
+/* Demo Function:
+ * Check that httpd finds the right WSGI handler for exact and for
+ * APP_HTTP_FLAGS_NO_EXACT_MATCH (longest prefix) URIs, then measure how long
+ * httpd_wsgi() and httpd_ssi() take to find a handler as more handlers are
+ * registered. A scan of the handlers with httpd_validate_uri(), which is how
+ * httpd dispatched before, is timed next to it. No socket is used. */
+
+#define BENCH_LOOKUPS           ( 200000 )
+#define BENCH_MAX_HANDLERS      ( 32 )  /* MAX_WSGI_HANDLERS and MAX_REGISTERED_SSIS */
+#define BENCH_URI_LEN           ( 24 )
+
+static int bench_get_handler( httpd_request_t *req )
+{
+  UNUSED_PARAMETER( req );
+  return kNoErr;
+}
+
+static int bench_ssi_function( const httpd_request_t *req, const char *args, int conn, char *scratch )
+{
+  return kNoErr;
+}
+
+/*
+ * Matching rules
+ */
+
+static struct httpd_wsgi_call rule_handlers[] =
+{
+  { "/",           0, 0,                            bench_get_handler, NULL, NULL, NULL },
+  { "/api",        0, 0,                            bench_get_handler, NULL, NULL, NULL },
+  { "/api/status", 0, 0,                            bench_get_handler, NULL, NULL, NULL },
+  { "/api/v1",     0, APP_HTTP_FLAGS_NO_EXACT_MATCH, bench_get_handler, NULL, NULL, NULL },
+  { "/static",     0, APP_HTTP_FLAGS_NO_EXACT_MATCH, bench_get_handler, NULL, NULL, NULL },
+  { "/static/img", 0, APP_HTTP_FLAGS_NO_EXACT_MATCH, bench_get_handler, NULL, NULL, NULL },
+};
+
+typedef struct
+{
+  const char *  request;
+  const char *  handler;  /* NULL: no handler, the client gets a 404 */
+} rule_case_t;
+
+static const rule_case_t rule_cases[] =
+{
+  { "/",                    "/" },
+  { "/api",                 "/api" },
+  { "/api/",                "/api" },          /* trailing slashes */
+  { "/api//",               "/api" },
+  { "/api?id=1",            "/api" },          /* query */
+  { "/api/status?all",      "/api/status" },
+  { "/api/statusx",         NULL },            /* exact URIs are not prefixes */
+  { "/index.html",          NULL },
+  { "/api/v1",              "/api/v1" },
+  { "/api/v1/users?id=2",   "/api/v1" },
+  { "/static/img/logo.png", "/static/img" },   /* longest prefix wins */
+  { "/static/css/main.css", "/static" },
+  { "/staticfile",          "/static" },       /* a prefix, not a path segment */
+  { "/stat",                NULL },
+};
+
+static httpd_request_t bench_req;
+
+/* Handler httpd_wsgi() picked for uri, NULL if it answered with no handler */
+static const struct httpd_wsgi_call *bench_dispatch( const char *uri )
+{
+  strncpy( bench_req.filename, uri, HTTPD_MAX_URI_LENGTH );
+  bench_req.type = HTTPD_REQ_TYPE_GET;
+  bench_req.wsgi = NULL;
+  if( httpd_wsgi( &bench_req ) != HTTPD_DONE )
+    return NULL;
+  return bench_req.wsgi;
+}
+
+static int bench_check_rules( void )
+{
+  const struct httpd_wsgi_call *f;
+  int i, failed = 0;
+
+  httpd_register_wsgi_handlers( rule_handlers, sizeof(rule_handlers) / sizeof(rule_handlers[0]) );
+  for( i = 0; i < sizeof(rule_cases) / sizeof(rule_cases[0]); i++ ){
+    f = bench_dispatch( rule_cases[i].request );
+    if( f ? ( rule_cases[i].handler && strcmp( f->uri, rule_cases[i].handler ) == 0 ) : rule_cases[i].handler == NULL )
+      continue;
+    dispatch_bench_log( "%-22s went to %s, expected %s", rule_cases[i].request,
+                        f ? f->uri : "404", rule_cases[i].handler ? rule_cases[i].handler : "404" );
+    failed++;
+  }
+  httpd_unregister_wsgi_handlers( rule_handlers, sizeof(rule_handlers) / sizeof(rule_handlers[0]) );
+  dispatch_bench_log( "Matching rules: %d cases, %d failed", i, failed );
+  return failed;
+}
+
+/*
+ * Dispatch cost
+ */
+
+static struct httpd_wsgi_call bench_handlers[BENCH_MAX_HANDLERS];
+static char bench_uris[BENCH_MAX_HANDLERS][BENCH_URI_LEN];
+#define BENCH_SSI(n)    { "ssi_fn" #n, bench_ssi_function }
+static struct httpd_ssi_call bench_ssis[BENCH_MAX_HANDLERS] =
+{
+  BENCH_SSI(00), BENCH_SSI(01), BENCH_SSI(02), BENCH_SSI(03), BENCH_SSI(04), BENCH_SSI(05), BENCH_SSI(06), BENCH_SSI(07),
+  BENCH_SSI(08), BENCH_SSI(09), BENCH_SSI(10), BENCH_SSI(11), BENCH_SSI(12), BENCH_SSI(13), BENCH_SSI(14), BENCH_SSI(15),
+  BENCH_SSI(16), BENCH_SSI(17), BENCH_SSI(18), BENCH_SSI(19), BENCH_SSI(20), BENCH_SSI(21), BENCH_SSI(22), BENCH_SSI(23),
+  BENCH_SSI(24), BENCH_SSI(25), BENCH_SSI(26), BENCH_SSI(27), BENCH_SSI(28), BENCH_SSI(29), BENCH_SSI(30), BENCH_SSI(31),
+};
+static char bench_requests[BENCH_MAX_HANDLERS][HTTPD_MAX_URI_LENGTH];
+
+static const int bench_counts[] = { 1, 4, 8, 16, 32 };
+
+typedef enum
+{
+  BENCH_EXACT,    /* /api/v1/endpointNN, two of three with a query or trailing slash */
+  BENCH_PREFIX,   /* /files/dirNN as prefix of /files/dirNN/name.txt */
+  BENCH_MISS,     /* nothing registered for the request */
+  BENCH_SCAN,     /* exact requests, found with a scan of httpd_validate_uri() */
+  BENCH_SSI,      /* ssi_fnNN directives */
+} bench_kind_t;
+
+/* ns per lookup, 0 if a lookup went to the wrong handler */
+static uint32_t bench_time( bench_kind_t kind, int count )
+{
+  const struct httpd_wsgi_call *f = NULL;
+  uint64_t start, elapsed;
+  int i, n, j;
+
+  for( i = 0; i < count; i++ ){
+    switch( kind ){
+      case BENCH_EXACT:
+      case BENCH_SCAN:
+        sprintf( bench_requests[i], i % 3 == 1 ? "%s?id=%d" : i % 3 == 2 ? "%s/" : "%s", bench_uris[i], i );
+        break;
+      case BENCH_PREFIX:
+        sprintf( bench_requests[i], "%s/name%d.txt", bench_uris[i], i );
+        break;
+      case BENCH_MISS:
+        sprintf( bench_requests[i], "/missing/page%d", i );
+        break;
+      case BENCH_SSI:
+        sprintf( bench_requests[i], "%s arg%d", bench_ssis[i].name, i );
+        break;
+    }
+  }
+
+  start = platform_get_nanosecond_clock_value( );
+  for( n = 0, i = 0; n < BENCH_LOOKUPS; n++, i = ( i + 1 == count ) ? 0 : i + 1 ){
+    switch( kind ){
+      case BENCH_EXACT:
+      case BENCH_PREFIX:
+        f = bench_dispatch( bench_requests[i] );
+        if( f != &bench_handlers[i] ) return 0;
+        break;
+      case BENCH_MISS:
+        if( bench_dispatch( bench_requests[i] ) != NULL ) return 0;
+        break;
+      case BENCH_SCAN:
+        strncpy( bench_req.filename, bench_requests[i], HTTPD_MAX_URI_LENGTH );
+        for( j = 0; j < count; j++ )
+          if( httpd_validate_uri( bench_req.filename, bench_handlers[j].uri, bench_handlers[j].http_flags ) == 0 ) break;
+        if( j != i ) return 0;
+        break;
+      case BENCH_SSI:
+        if( httpd_ssi( bench_requests[i] ) != bench_ssi_function ) return 0;
+        break;
+    }
+  }
+  elapsed = platform_get_nanosecond_clock_value( ) - start;
+  return (uint32_t)( elapsed / BENCH_LOOKUPS );
+}
+
+static void bench_register( int count, int flags, const char *format )
+{
+  int i;
+
+  for( i = 0; i < count; i++ ){
+    sprintf( bench_uris[i], format, i );
+    bench_handlers[i].uri = bench_uris[i];
+    bench_handlers[i].http_flags = flags;
+    bench_handlers[i].get_handler = bench_get_handler;
+  }
+  httpd_register_wsgi_handlers( bench_handlers, count );
+}
+
+static bool bench_run( int count )
+{
+  uint32_t exact, prefix, miss, scan, ssi;
+  int i;
+
+  bench_register( count, 0, "/api/v1/endpoint%02d" );
+  exact = bench_time( BENCH_EXACT, count );
+  miss = bench_time( BENCH_MISS, count );
+  scan = bench_time( BENCH_SCAN, count );
+  httpd_unregister_wsgi_handlers( bench_handlers, count );
+
+  bench_register( count, APP_HTTP_FLAGS_NO_EXACT_MATCH, "/files/dir%02d" );
+  prefix = bench_time( BENCH_PREFIX, count );
+  httpd_unregister_wsgi_handlers( bench_handlers, count );
+
+  for( i = 0; i < count; i++ )
+    httpd_register_ssi( &bench_ssis[i] );
+  ssi = bench_time( BENCH_SSI, count );
+  for( i = 0; i < count; i++ )
+    httpd_unregister_ssi( &bench_ssis[i] );
+
+  dispatch_bench_log( "%2d handlers: exact %4d ns, prefix %4d ns, no handler %4d ns, scan %4d ns, ssi %4d ns",
+                      count, (int)exact, (int)prefix, (int)miss, (int)scan, (int)ssi );
+  return exact && prefix && miss && scan && ssi;
+}
+
+int application_start( void )
+{
+  OSStatus err = kNoErr;
+  bool passed = false;
+  int i;
+
+  err = httpd_init( );
+  require_noerr( err, exit );
+
+  dispatch_bench_log( "Dispatch Bench Start, %d lookups per run, 0 ns means a wrong handler", BENCH_LOOKUPS );
+  require_quiet( bench_check_rules( ) == 0, exit );
+
+  passed = true;
+  for( i = 0; i < sizeof(bench_counts) / sizeof(bench_counts[0]); i++ )
+    passed &= bench_run( bench_counts[i] );
+
+exit:
+  dispatch_bench_log( "Dispatch Bench %s!", passed ? "finished" : "failed" );
+  mico_rtos_delete_thread( NULL );
+  return err;
+}
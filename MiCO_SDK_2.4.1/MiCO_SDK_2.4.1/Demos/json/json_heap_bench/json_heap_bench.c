@@ -0,0 +1,255 @@
+/**
+******************************************************************************
+* @file    json_heap_bench.c
+* @author  William Xu
+* @version V1.0.0
+* @date    17-Oct-2026
+* @brief   json_c heap traffic benchmark demo based on MiCO !
+******************************************************************************
+*
+*  The MIT License
+*  Copyright (c) 2016 MXCHIP Inc.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is furnished
+*  to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in
+*  all copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+*  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+*  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+******************************************************************************
+*/
+
+#include "MICO.h"
+#include "json_c/json.h"
+#include "platform_peripheral.h"
+
+#define json_bench_log(M, ...) custom_log("JSON Bench", M, ##__VA_ARGS__)
+
+/* Demo Function:
+ * Count the heap calls and bytes json_c takes to build, print and parse a
+ * config server report, and to build large objects and arrays, and time
+ * them. The parsed report must print the same as the one built. The
+ * heap counters replace malloc() and friends, so this runs on the host only. */
+
+#define BENCH_ITERATIONS        ( 200 )
+#define BENCH_TOP_KEYS          ( 24 )
+#define BENCH_SECTORS           ( 4 )
+#define BENCH_BIG_COUNT         ( 1000 )
+
+/*
+ * Heap counters, host only: the program's malloc() family forwards to the C
+ * library after counting, so every heap call of json_c is seen.
+ */
+
+extern void *__libc_malloc( size_t size );
+extern void *__libc_calloc( size_t count, size_t size );
+extern void *__libc_realloc( void *ptr, size_t size );
+extern void __libc_free( void *ptr );
+
+typedef struct
+{
+  uint32_t  allocs;   /* malloc, calloc and realloc */
+  uint32_t  reallocs;
+  uint32_t  frees;
+  uint64_t  bytes;    /* requested by all of them */
+} bench_heap_t;
+
+static volatile bool bench_counting = false;
+static bench_heap_t bench_heap;
+
+void *malloc( size_t size )
+{
+  if( bench_counting ){
+    bench_heap.allocs++;
+    bench_heap.bytes += size;
+  }
+  return __libc_malloc( size );
+}
+
+void *calloc( size_t count, size_t size )
+{
+  if( bench_counting ){
+    bench_heap.allocs++;
+    bench_heap.bytes += count * size;
+  }
+  return __libc_calloc( count, size );
+}
+
+void *realloc( void *ptr, size_t size )
+{
+  if( bench_counting ){
+    bench_heap.allocs++;
+    bench_heap.reallocs++;
+    bench_heap.bytes += size;
+  }
+  return __libc_realloc( ptr, size );
+}
+
+void free( void *ptr )
+{
+  if( bench_counting && ptr )
+    bench_heap.frees++;
+  __libc_free( ptr );
+}
+
+/*
+ * Workloads
+ */
+
+static char bench_text[4096];
+static char bench_key[16];
+
+static json_object *bench_build_report( void )
+{
+  json_object *report, *sectors, *cells;
+  int i;
+
+  report = json_object_new_object( );
+  for( i = 0; i < BENCH_TOP_KEYS; i++ ){
+    sprintf( bench_key, "key%02d", i );
+    json_object_object_add( report, bench_key, i % 2 ? json_object_new_int( i * 1000 ) : json_object_new_string( "MiCOKit-3165" ) );
+  }
+
+  sectors = json_object_new_array( );
+  for( i = 0; i < BENCH_SECTORS; i++ ){
+    cells = json_object_new_array( );
+    config_server_create_string_cell( cells, "Device Name", "MiCOKit-3165 #1", "RW", NULL );
+    config_server_create_bool_cell( cells, "RF power save", false, "RW" );
+    config_server_create_number_cell( cells, "Baurdrate", 115200, "RW", NULL );
+    config_server_create_float_cell( cells, "Temperature", 26.5, "RO", NULL );
+    config_server_create_string_cell( cells, "IP address", "192.168.1.100", "RO", NULL );
+    config_server_create_string_cell( cells, "Firmware", "MICO_BASIC_1_0", "RO", NULL );
+    sprintf( bench_key, "Sector %d", i );
+    config_server_create_sector( sectors, bench_key, cells );
+  }
+  json_object_object_add( report, "C", sectors );
+  return report;
+}
+
+typedef enum
+{
+  BENCH_REPORT_BUILD,     /* build the report tree and drop it */
+  BENCH_REPORT_PRINT,     /* build and print it */
+  BENCH_REPORT_PARSE,     /* parse the printed report and drop it */
+  BENCH_BIG_OBJECT,       /* add BENCH_BIG_COUNT keys, look each up, replace every other */
+  BENCH_BIG_ARRAY,        /* add BENCH_BIG_COUNT elements */
+} bench_kind_t;
+
+typedef struct
+{
+  const char *    name;
+  bench_kind_t    kind;
+} bench_run_t;
+
+static const bench_run_t bench_runs[] =
+{
+  { "report build",       BENCH_REPORT_BUILD },
+  { "report build+print", BENCH_REPORT_PRINT },
+  { "report parse",       BENCH_REPORT_PARSE },
+  { "1000-key object",    BENCH_BIG_OBJECT },
+  { "1000-item array",    BENCH_BIG_ARRAY },
+};
+
+/* false if the workload went wrong */
+static bool bench_workload( bench_kind_t kind )
+{
+  json_object *obj, *val;
+  bool ok = true;
+  int i;
+
+  switch( kind ){
+    case BENCH_REPORT_BUILD:
+      obj = bench_build_report( );
+      break;
+    case BENCH_REPORT_PRINT:
+      obj = bench_build_report( );
+      ok = strcmp( json_object_to_json_string( obj ), bench_text ) == 0;
+      break;
+    case BENCH_REPORT_PARSE:
+      obj = json_tokener_parse( bench_text );
+      ok = obj && json_object_array_length( json_object_object_get( obj, "C" ) ) == BENCH_SECTORS;
+      break;
+    case BENCH_BIG_OBJECT:
+      obj = json_object_new_object( );
+      for( i = 0; i < BENCH_BIG_COUNT; i++ ){
+        sprintf( bench_key, "k%d", i );
+        json_object_object_add( obj, bench_key, json_object_new_int( i ) );
+      }
+      for( i = 0; i < BENCH_BIG_COUNT; i += 2 ){
+        sprintf( bench_key, "k%d", i );
+        json_object_object_add( obj, bench_key, json_object_new_int( -i ) );
+      }
+      for( i = 0; i < BENCH_BIG_COUNT && ok; i++ ){
+        sprintf( bench_key, "k%d", i );
+        val = json_object_object_get( obj, bench_key );
+        ok = val && json_object_get_int( val ) == ( i % 2 ? i : -i );
+      }
+      break;
+    case BENCH_BIG_ARRAY:
+      obj = json_object_new_array( );
+      for( i = 0; i < BENCH_BIG_COUNT; i++ )
+        json_object_array_add( obj, json_object_new_int( i ) );
+      ok = json_object_array_length( obj ) == BENCH_BIG_COUNT
+           && json_object_get_int( json_object_array_get_idx( obj, BENCH_BIG_COUNT - 1 ) ) == BENCH_BIG_COUNT - 1;
+      break;
+  }
+  json_object_put( obj );
+  return ok;
+}
+
+static bool bench_run( const bench_run_t *run )
+{
+  uint64_t start, elapsed;
+  bool ok = true;
+  int i;
+
+  /* Once outside the count, so one-off setup of json_c is not counted */
+  bench_workload( run->kind );
+
+  memset( &bench_heap, 0x0, sizeof(bench_heap) );
+  bench_counting = true;
+  start = platform_get_nanosecond_clock_value( );
+  for( i = 0; i < BENCH_ITERATIONS && ok; i++ )
+    ok = bench_workload( run->kind );
+  elapsed = platform_get_nanosecond_clock_value( ) - start;
+  bench_counting = false;
+
+  json_bench_log( "%-19s %5d allocations (%4d realloc), %6d bytes, %5d us, %d left allocated%s",
+                  run->name, (int)( bench_heap.allocs / BENCH_ITERATIONS ), (int)( bench_heap.reallocs / BENCH_ITERATIONS ),
+                  (int)( bench_heap.bytes / BENCH_ITERATIONS ), (int)( elapsed / 1000 / BENCH_ITERATIONS ),
+                  (int)( bench_heap.allocs - bench_heap.reallocs - bench_heap.frees ), ok ? "" : ", WRONG RESULT" );
+  return ok && bench_heap.allocs - bench_heap.reallocs == bench_heap.frees;
+}
+
+int application_start( void )
+{
+  json_object *report;
+  bool passed;
+  int i;
+
+  report = bench_build_report( );
+  strncpy( bench_text, json_object_to_json_string( report ), sizeof(bench_text) - 1 );
+  json_object_put( report );
+  report = json_tokener_parse( bench_text );
+  passed = report && strcmp( json_object_to_json_string( report ), bench_text ) == 0;
+  json_object_put( report );
+
+  json_bench_log( "JSON Bench Start, %d iterations, report of %d bytes%s", BENCH_ITERATIONS, strlen( bench_text ),
+                  passed ? "" : ", PARSED REPORT DIFFERS" );
+  for( i = 0; i < sizeof(bench_runs) / sizeof(bench_runs[0]); i++ )
+    passed &= bench_run( &bench_runs[i] );
+  json_bench_log( "JSON Bench %s!", passed ? "finished" : "failed" );
+
+  mico_rtos_delete_thread( NULL );
+  return 0;
+}
@@ -0,0 +1,291 @@
+/**
+******************************************************************************
+* @file    json_path_bench.c
+* @author  William Xu
+* @version V1.0.0
+* @date    17-Oct-2026
+* @brief   JSON field extraction benchmark demo based on MiCO !
+******************************************************************************
+*
+*  The MIT License
+*  Copyright (c) 2016 MXCHIP Inc.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is furnished
+*  to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in
+*  all copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+*  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+*  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+******************************************************************************
+*/
+
+#include "MICO.h"
+#include "json_c/json.h"
+#include "json_c/json_arena.h"
+#include "platform_peripheral.h"
+
+#define json_path_bench_log(M, ...) custom_log("JSON Path Bench", M, ##__VA_ARGS__)
+
+/* Demo Function:
+ * Pick the few fields the wechat_direct demo needs out of a cloud push and
+ * the two WeiXin replies, in four ways:
+ *  - json_tokener_parse() on the heap, then json_object_object_get()
+ *  - json_tokener_parse_arena() into a static arena, then json_object_object_get()
+ *  - json_path_extract() on the whole text
+ *  - json_path_scan() fed one byte at a time, as from a receive callback
+ * Check that all four find the same values, and time them. */
+
+#define BENCH_ITERATIONS        ( 2000 )
+#define BENCH_ARENA_SIZE        ( 8 * 1024 )
+#define BENCH_MAX_SLOTS         ( 4 )
+#define BENCH_STRING_LEN        ( 128 )
+
+/*
+ * Texts and the fields wanted from them, as in Demos/wechat_direct
+ */
+
+static const char bench_push[] =
+  "{\"asy_error_code\":0,\"asy_error_msg\":\"ok\",\"create_time\":1476700000,"
+  "\"hardware\":{\"model\":\"MiCOKit-3165\",\"firmware\":\"wechat_direct_1.0\"},"
+  "\"msg_id\":2095434112,\"msg_type\":\"set\",\"device_type\":\"gh_a1b2c3d4e5f6\","
+  "\"device_id\":\"gh_a1b2c3d4e5f6_8fe5e3bbfa3c2f4f\",\"user\":\"oV_6Ljk\\u5f00\\u5173\","
+  "\"services\":{\"operation_status\":{\"status\":0},\"outlet\":{\"port_on_off\":[true,false],"
+  "\"current\":[1.5,0.0]},\"air_conditioner\":{\"tempe_indoor\":26,\"fan_speed\":3}},"
+  "\"data\":\"\"}";
+
+static const char bench_token_reply[] =
+  "{\"access_token\":\"ACCESS_TOKEN_4ajnvm4OBSy7Xd9WYlqEqAwl8xaUeNsWSJpaxqbcSEpLGoGZuCL0dTZOxLhVr2pxk7XHF"
+  "BRMG8_Cbcdl\",\"expires_in\":7200}";
+
+static const char bench_qrcode_reply[] =
+  "{\"base_resp\":{\"errcode\":0,\"errmsg\":\"ok\"},\"deviceid\":\"gh_a1b2c3d4e5f6_8fe5e3bbfa3c2f4f\","
+  "\"qrticket\":\"http://we.qq.com/d/AQC8fnn4dWqzSLkX6y2w7lEHkDe2wFPYVQ3fWNK\","
+  "\"devicelicence\":\"0B5D2B3C9D24B85C3A51E8E60EA1A1E2A3E5F7C1D0A0E6F3B2C1D4E5F6A7B8C9D0E1F2A3B4C5D6\"}";
+
+typedef struct
+{
+  const char *            name;
+  const char *            text;
+  int                     slot_count;
+  const char *            paths[BENCH_MAX_SLOTS];
+  enum json_type          types[BENCH_MAX_SLOTS];
+} bench_text_t;
+
+static const bench_text_t bench_texts[] =
+{
+  { "cloud push",         bench_push,         4,
+    { "msg_id", "msg_type", "services.outlet", "services.outlet.port_on_off[0]" },
+    { json_type_int, json_type_string, json_type_boolean, json_type_boolean } },
+  { "access_token reply", bench_token_reply,  1,
+    { "access_token" },
+    { json_type_string } },
+  { "QR code reply",      bench_qrcode_reply, 2,
+    { "deviceid", "devicelicence" },
+    { json_type_string, json_type_string } },
+};
+
+typedef enum
+{
+  BENCH_TREE_HEAP,        /* json_tokener_parse, then json_object_object_get */
+  BENCH_TREE_ARENA,       /* json_tokener_parse_arena, then json_object_object_get */
+  BENCH_PATH_EXTRACT,     /* json_path_extract */
+  BENCH_PATH_BYTES,       /* json_path_scan, one byte at a time */
+  BENCH_METHOD_MAX
+} bench_method_t;
+
+static const char *bench_method_names[BENCH_METHOD_MAX] =
+{
+  "parse+get", "arena parse+get", "path extract", "path byte by byte"
+};
+
+static uint64_t bench_arena_buf[BENCH_ARENA_SIZE / sizeof(uint64_t)];
+static size_t bench_arena_used;
+static char bench_strings[BENCH_METHOD_MAX][BENCH_MAX_SLOTS][BENCH_STRING_LEN];
+static struct json_path_slot bench_slots[BENCH_METHOD_MAX][BENCH_MAX_SLOTS];
+
+static void bench_slots_init( const bench_text_t *text, bench_method_t method )
+{
+  struct json_path_slot *slot;
+  int i;
+
+  memset( bench_slots[method], 0x0, sizeof(bench_slots[method]) );
+  memset( bench_strings[method], 0x0, sizeof(bench_strings[method]) );
+  for( i = 0; i < text->slot_count; i++ ){
+    slot = &bench_slots[method][i];
+    slot->path = text->paths[i];
+    slot->type = text->types[i];
+    if( slot->type == json_type_string ){
+      slot->buf = bench_strings[method][i];
+      slot->size = BENCH_STRING_LEN;
+    }
+  }
+}
+
+/* Follow a path like "services.outlet.port_on_off[0]" down a parsed tree */
+static json_object *bench_tree_get( json_object *obj, const char *path )
+{
+  char key[32];
+  int len;
+
+  while( obj && *path ){
+    if( *path == '[' ){
+      obj = json_object_array_get_idx( obj, atoi( path + 1 ) );
+      path = strchr( path, ']' ) + 1;
+    } else {
+      if( *path == '.' ) path++;
+      len = strcspn( path, ".[" );
+      memcpy( key, path, len );
+      key[len] = 0;
+      obj = json_object_object_get( obj, key );
+      path += len;
+    }
+  }
+  return obj;
+}
+
+/* Fill the slots from a tree the way the wechat_direct demo read it before */
+static void bench_tree_fill( json_object *root, struct json_path_slot *slots, int slot_count )
+{
+  json_object *obj;
+  const char *str;
+  int i;
+
+  for( i = 0; i < slot_count; i++ ){
+    obj = bench_tree_get( root, slots[i].path );
+    if( obj == NULL ) continue;
+    slots[i].found = TRUE;
+    slots[i].found_type = json_object_get_type( obj );
+    switch( slots[i].type ){
+      case json_type_int:
+        slots[i].c_int64 = json_object_get_int64( obj );
+        break;
+      case json_type_boolean:
+        slots[i].c_boolean = json_object_get_boolean( obj );
+        break;
+      case json_type_string:
+        str = json_object_get_string( obj );
+        slots[i].len = strlen( str );
+        strncpy( slots[i].buf, str, slots[i].size - 1 );
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+/* false if the text could not be read */
+static bool bench_extract( const bench_text_t *text, bench_method_t method )
+{
+  struct json_path_slot *slots = bench_slots[method];
+  struct json_path_scanner scanner;
+  struct json_arena arena;
+  json_object *root;
+  enum json_path_status status = json_path_continue;
+  int i;
+
+  switch( method ){
+    case BENCH_TREE_HEAP:
+      root = json_tokener_parse( text->text );
+      if( root == NULL ) return false;
+      bench_tree_fill( root, slots, text->slot_count );
+      json_object_put( root );
+      break;
+    case BENCH_TREE_ARENA:
+      json_arena_init( &arena, bench_arena_buf, sizeof(bench_arena_buf) );
+      root = json_tokener_parse_arena( text->text, &arena );
+      if( root == NULL ) return false;
+      bench_tree_fill( root, slots, text->slot_count );
+      bench_arena_used = json_arena_used( &arena );
+      break;
+    case BENCH_PATH_EXTRACT:
+      if( json_path_extract( text->text, slots, text->slot_count ) < 0 ) return false;
+      break;
+    case BENCH_PATH_BYTES:
+      json_path_init( &scanner, slots, text->slot_count );
+      for( i = 0; text->text[i] && status == json_path_continue; i++ )
+        status = json_path_scan( &scanner, &text->text[i], 1 );
+      if( status != json_path_done ) return false;
+      break;
+    default:
+      return false;
+  }
+  return true;
+}
+
+/* The values a slot was read as, not where in the text it was found */
+static bool bench_slot_equal( const struct json_path_slot *a, const struct json_path_slot *b )
+{
+  if( a->found != b->found || a->found_type != b->found_type ) return false;
+  if( !a->found || a->found_type == json_type_object || a->found_type == json_type_array ) return true;
+  switch( a->type ){
+    case json_type_int:     return a->c_int64 == b->c_int64;
+    case json_type_boolean: return a->c_boolean == b->c_boolean;
+    case json_type_string:  return a->len == b->len && strcmp( a->buf, b->buf ) == 0;
+    default:                return true;
+  }
+}
+
+static bool bench_text( const bench_text_t *text )
+{
+  uint64_t start, elapsed[BENCH_METHOD_MAX];
+  bool ok = true;
+  int method, i;
+
+  for( method = 0; method < BENCH_METHOD_MAX; method++ ){
+    bench_slots_init( text, (bench_method_t)method );
+    if( !bench_extract( text, (bench_method_t)method ) ){
+      json_path_bench_log( "%s: %s could not read the text", text->name, bench_method_names[method] );
+      ok = false;
+    }
+    for( i = 0; i < text->slot_count; i++ ){
+      if( !bench_slots[method][i].found ){
+        json_path_bench_log( "%s: %s did not find %s", text->name, bench_method_names[method], text->paths[i] );
+        ok = false;
+      } else if( !bench_slot_equal( &bench_slots[method][i], &bench_slots[BENCH_TREE_HEAP][i] ) ){
+        json_path_bench_log( "%s: %s read %s differently", text->name, bench_method_names[method], text->paths[i] );
+        ok = false;
+      }
+    }
+  }
+  if( !ok ) return false;
+
+  for( method = 0; method < BENCH_METHOD_MAX; method++ ){
+    start = platform_get_nanosecond_clock_value( );
+    for( i = 0; i < BENCH_ITERATIONS; i++ ){
+      bench_slots_init( text, (bench_method_t)method );
+      bench_extract( text, (bench_method_t)method );
+    }
+    elapsed[method] = ( platform_get_nanosecond_clock_value( ) - start ) / BENCH_ITERATIONS;
+  }
+
+  json_path_bench_log( "%-18s %4d bytes, %d fields: parse+get %5d ns, arena parse+get %5d ns (%d bytes of arena), "
+                       "path extract %5d ns, path byte by byte %5d ns",
+                       text->name, strlen( text->text ), text->slot_count, (int)elapsed[BENCH_TREE_HEAP],
+                       (int)elapsed[BENCH_TREE_ARENA], (int)bench_arena_used, (int)elapsed[BENCH_PATH_EXTRACT],
+                       (int)elapsed[BENCH_PATH_BYTES] );
+  return true;
+}
+
+int application_start( void )
+{
+  bool passed = true;
+  int i;
+
+  json_path_bench_log( "JSON Path Bench Start, %d iterations, %d bytes of arena", BENCH_ITERATIONS, BENCH_ARENA_SIZE );
+  for( i = 0; i < sizeof(bench_texts) / sizeof(bench_texts[0]); i++ )
+    passed &= bench_text( &bench_texts[i] );
+  json_path_bench_log( "JSON Path Bench %s!", passed ? "finished" : "failed" );
+
+  mico_rtos_delete_thread( NULL );
+  return 0;
+}
@@ -0,0 +1,344 @@
+/**
+******************************************************************************
+* @file    ota_bench.c
+* @author  William Xu
+* @version V1.0.0
+* @date    17-Oct-2026
+* @brief   OTA receive and flash timing demo based on MiCO !
+******************************************************************************
+*
+*  The MIT License
+*  Copyright (c) 2016 MXCHIP Inc.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is furnished
+*  to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in
+*  all copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+*  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+*  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+******************************************************************************
+*/
+
+#include "MICO.h"
+#include "SocketUtils.h"
+#include "CheckSumUtils.h"
+#include "platform_peripheral.h"
+
+#define ota_bench_log(M, ...) custom_log("OTA Bench", M, ##__VA_ARGS__)
+
+/* Demo Function:
+ * Send an OTA image over a loopback TCP connection at several rates, and write
+ * it to the OTA partition as the config server does, over flash timed like a
+ * real SPI flash and holding an older image. Compare mico_ota_writer with the
+ * way the config server wrote images before it: erase the whole partition on
+ * the first chunk, then program every chunk before reading the next one.
+ * Measure the total time and the longest the receiver stopped reading, which
+ * on a device stalls the sender once the small TCP window is full. Check the
+ * image and its CRC16 read back, and that a transfer dropped halfway is
+ * followed by a good one. */
+
+#define BENCH_PORT              ( 8092 )
+#define BENCH_IMAGE_LEN         ( 300 * 1024 )
+#define BENCH_CHUNK_LEN         ( 1460 )    /* one TCP segment */
+#define BENCH_ERASE_US          ( 45000 )   /* 4 KB sector erase */
+#define BENCH_PAGE_US           ( 700 )     /* 256 byte page program */
+
+/* Host only, counts the sectors the emulated flash has erased */
+extern const platform_flash_t platform_flash_peripherals[];
+
+typedef enum
+{
+  BENCH_ERASE_FIRST,      /* erase the partition, then program each chunk as it comes */
+  BENCH_OTA_WRITER,       /* mico_ota_writer_* */
+} bench_method_t;
+
+typedef struct
+{
+  bench_method_t  method;
+  uint32_t        rate;     /* sender KB/s, 0 as fast as the receiver reads */
+} bench_run_t;
+
+static const bench_run_t bench_runs[] =
+{
+  { BENCH_ERASE_FIRST,  0 },
+  { BENCH_OTA_WRITER,   0 },
+  { BENCH_ERASE_FIRST,  200 },
+  { BENCH_OTA_WRITER,   200 },
+  { BENCH_ERASE_FIRST,  100 },
+  { BENCH_OTA_WRITER,   100 },
+  { BENCH_ERASE_FIRST,  50 },
+  { BENCH_OTA_WRITER,   50 },
+};
+
+static const char *bench_method_names[] = { "erase first", "ota writer" };
+
+typedef struct
+{
+  uint32_t          rate;
+  uint32_t          len;        /* bytes to send, less than the image to drop the connection */
+  mico_semaphore_t  done;
+} bench_sender_t;
+
+static bench_sender_t bench_sender;
+static uint8_t bench_buf[BENCH_CHUNK_LEN];
+static uint16_t bench_crc;
+
+/* Byte n of an image, seed 0 is the new image and any other an older one */
+static uint8_t bench_pattern( uint32_t n, uint32_t seed )
+{
+  return (uint8_t)( ( n >> 8 ) ^ ( n * 7 ) ^ seed );
+}
+
+static void bench_fill( uint8_t *buf, uint32_t from, uint32_t len, uint32_t seed )
+{
+  uint32_t i;
+
+  for( i = 0; i < len; i++ )
+    buf[i] = bench_pattern( from + i, seed );
+}
+
+static uint32_t bench_erase_count( void )
+{
+  mico_logic_partition_t *partition = MicoFlashGetInfo( MICO_PARTITION_OTA_TEMP );
+
+  return platform_flash_erase_count( &platform_flash_peripherals[partition->partition_owner] );
+}
+
+/*
+ * Sender
+ */
+
+static void bench_sender_thread( void *arg )
+{
+  UNUSED_PARAMETER( arg );
+  struct sockaddr_t addr;
+  uint8_t chunk[BENCH_CHUNK_LEN];
+  uint32_t start, sent = 0, len, due, now;
+  int fd;
+
+  fd = socket( AF_INET, SOCK_STREAM, IPPROTO_TCP );
+  require( IsValidSocket( fd ), exit );
+  addr.s_ip = inet_addr( "127.0.0.1" );
+  addr.s_port = BENCH_PORT;
+  require_noerr( connect( fd, &addr, sizeof(addr) ), exit );
+
+  start = mico_get_time( );
+  while( sent < bench_sender.len ){
+    /* Keep to the rate as a slower link would */
+    if( bench_sender.rate ){
+      due = start + (uint32_t)( (uint64_t)sent * 1000 / ( bench_sender.rate * 1024 ) );
+      now = mico_get_time( );
+      if( due > now )
+        mico_thread_msleep( due - now );
+    }
+    len = Min( BENCH_CHUNK_LEN, bench_sender.len - sent );
+    bench_fill( chunk, sent, len, 0 );
+    require_noerr( SocketSend( fd, chunk, len ), exit );
+    sent += len;
+  }
+
+exit:
+  SocketClose( &fd );
+  mico_rtos_set_semaphore( &bench_sender.done );
+  mico_rtos_delete_thread( NULL );
+}
+
+/*
+ * Receiver
+ */
+
+/* Read an image from the next connection into the OTA partition, false if it
+ * could not be written. A connection closed early leaves *received short. */
+static bool bench_receive( int listen_fd, bench_method_t method, uint32_t *received, uint32_t *longest_stall,
+                           uint16_t *crc )
+{
+  OSStatus err = kNoErr;
+  mico_logic_partition_t *partition = MicoFlashGetInfo( MICO_PARTITION_OTA_TEMP );
+  mico_ota_writer_t *writer = NULL;
+  CRC16_Context crc16;
+  struct sockaddr_t addr;
+  socklen_t addrLen = sizeof(addr);
+  uint32_t offset = 0, start;
+  int fd, len;
+
+  *received = 0;
+  *longest_stall = 0;
+  fd = accept( listen_fd, &addr, &addrLen );
+  require_action( IsValidSocket( fd ), exit, err = kConnectionErr );
+
+  if( method == BENCH_OTA_WRITER ){
+    err = mico_ota_writer_start( &writer, BENCH_IMAGE_LEN );
+    require_noerr( err, exit );
+  }
+  CRC16_Init( &crc16 );
+
+  while( ( len = recv( fd, bench_buf, sizeof(bench_buf), 0 ) ) > 0 ){
+    start = mico_get_time( );
+    if( method == BENCH_OTA_WRITER ){
+      err = mico_ota_writer_write( writer, bench_buf, len );
+    } else {
+      if( *received == 0 )
+        err = MicoFlashErase( MICO_PARTITION_OTA_TEMP, 0x0, partition->partition_length );
+      if( err == kNoErr )
+        err = MicoFlashWrite( MICO_PARTITION_OTA_TEMP, &offset, bench_buf, len );
+      CRC16_Update( &crc16, bench_buf, len );
+    }
+    require_noerr( err, exit );
+    *received += len;
+    *longest_stall = Max( *longest_stall, mico_get_time( ) - start );
+  }
+
+  if( *received == BENCH_IMAGE_LEN ){
+    if( method == BENCH_OTA_WRITER )
+      err = mico_ota_writer_finish( &writer, NULL, crc );
+    else
+      CRC16_Final( &crc16, crc );
+  }
+
+exit:
+  /* A dropped transfer is given up, as config_server does when the client goes away */
+  mico_ota_writer_abort( &writer );
+  SocketClose( &fd );
+  return err == kNoErr;
+}
+
+/* The partition holds the new image, read back */
+static bool bench_verify( void )
+{
+  uint8_t expected[BENCH_CHUNK_LEN];
+  uint32_t offset = 0, from, len;
+
+  while( offset < BENCH_IMAGE_LEN ){
+    from = offset;
+    len = Min( BENCH_CHUNK_LEN, BENCH_IMAGE_LEN - offset );
+    if( MicoFlashRead( MICO_PARTITION_OTA_TEMP, &offset, bench_buf, len ) != kNoErr )
+      return false;
+    bench_fill( expected, from, len, 0 );
+    if( memcmp( bench_buf, expected, len ) != 0 )
+      return false;
+  }
+  return true;
+}
+
+/* Leave an older image over the whole partition, without flash timing */
+static OSStatus bench_old_image( uint32_t seed )
+{
+  OSStatus err = kNoErr;
+  mico_logic_partition_t *partition = MicoFlashGetInfo( MICO_PARTITION_OTA_TEMP );
+  uint32_t offset = 0, len;
+
+  err = MicoFlashErase( MICO_PARTITION_OTA_TEMP, 0x0, partition->partition_length );
+  require_noerr( err, exit );
+  while( offset < partition->partition_length ){
+    len = Min( BENCH_CHUNK_LEN, partition->partition_length - offset );
+    bench_fill( bench_buf, offset, len, seed );
+    err = MicoFlashWrite( MICO_PARTITION_OTA_TEMP, &offset, bench_buf, len );
+    require_noerr( err, exit );
+  }
+
+exit:
+  return err;
+}
+
+static bool bench_transfer( int listen_fd, bench_method_t method, uint32_t rate, uint32_t len,
+                            uint32_t *received, uint32_t *longest_stall, uint16_t *crc )
+{
+  bool ok;
+
+  memset( &bench_sender, 0x0, sizeof(bench_sender) );
+  bench_sender.rate = rate;
+  bench_sender.len = len;
+  mico_rtos_init_semaphore( &bench_sender.done, 1 );
+  mico_rtos_create_thread( NULL, MICO_APPLICATION_PRIORITY, "OTA Sender", bench_sender_thread, 0x1000, NULL );
+  ok = bench_receive( listen_fd, method, received, longest_stall, crc );
+  mico_rtos_get_semaphore( &bench_sender.done, MICO_WAIT_FOREVER );
+  mico_rtos_deinit_semaphore( &bench_sender.done );
+  return ok;
+}
+
+static bool bench_run( int listen_fd, const bench_run_t *run, uint32_t seed )
+{
+  uint32_t received, longest_stall, erases, start, elapsed;
+  uint16_t crc = 0;
+  bool ok;
+
+  platform_flash_timing( 0, 0 );
+  if( bench_old_image( seed ) != kNoErr ) return false;
+  platform_flash_timing( BENCH_ERASE_US, BENCH_PAGE_US );
+
+  erases = bench_erase_count( );
+  start = mico_get_time( );
+  ok = bench_transfer( listen_fd, run->method, run->rate, BENCH_IMAGE_LEN, &received, &longest_stall, &crc );
+  elapsed = mico_get_time( ) - start;
+  erases = bench_erase_count( ) - erases;
+
+  platform_flash_timing( 0, 0 );
+  ok = ok && received == BENCH_IMAGE_LEN && crc == bench_crc && bench_verify( );
+  ota_bench_log( "%-11s %3d KB/s: %5d ms, longest stall %4d ms, %3d sectors erased%s",
+                 bench_method_names[run->method], (int)run->rate, (int)elapsed, (int)longest_stall,
+                 (int)erases, ok ? "" : ", IMAGE WRONG" );
+  return ok;
+}
+
+/* A transfer dropped halfway through the writer, then a whole one */
+static bool bench_dropped( int listen_fd )
+{
+  uint32_t received, longest_stall;
+  uint16_t crc = 0;
+  bool ok;
+
+  if( bench_old_image( 0x5A ) != kNoErr ) return false;
+  bench_transfer( listen_fd, BENCH_OTA_WRITER, 0, BENCH_IMAGE_LEN / 2, &received, &longest_stall, &crc );
+  ok = received == BENCH_IMAGE_LEN / 2;
+  ok = ok && bench_transfer( listen_fd, BENCH_OTA_WRITER, 0, BENCH_IMAGE_LEN, &received, &longest_stall, &crc );
+  ok = ok && received == BENCH_IMAGE_LEN && crc == bench_crc && bench_verify( );
+  ota_bench_log( "Transfer dropped at %d bytes, then a whole one: %s", BENCH_IMAGE_LEN / 2, ok ? "image good" : "IMAGE WRONG" );
+  return ok;
+}
+
+int application_start( void )
+{
+  mico_logic_partition_t *partition = MicoFlashGetInfo( MICO_PARTITION_OTA_TEMP );
+  CRC16_Context crc16;
+  struct sockaddr_t addr;
+  uint32_t offset, len;
+  bool passed = false;
+  int listen_fd = -1, i;
+
+  CRC16_Init( &crc16 );
+  for( offset = 0; offset < BENCH_IMAGE_LEN; offset += len ){
+    len = Min( BENCH_CHUNK_LEN, BENCH_IMAGE_LEN - offset );
+    bench_fill( bench_buf, offset, len, 0 );
+    CRC16_Update( &crc16, bench_buf, len );
+  }
+  CRC16_Final( &crc16, &bench_crc );
+
+  listen_fd = socket( AF_INET, SOCK_STREAM, IPPROTO_TCP );
+  require( IsValidSocket( listen_fd ), exit );
+  addr.s_ip = INADDR_ANY;
+  addr.s_port = BENCH_PORT;
+  require_noerr( bind( listen_fd, &addr, sizeof(addr) ), exit );
+  require_noerr( listen( listen_fd, 1 ), exit );
+
+  ota_bench_log( "OTA Bench Start, %d KB image, %d KB partition, %d us per sector erase, %d us per page",
+                 BENCH_IMAGE_LEN / 1024, (int)( partition->partition_length / 1024 ), BENCH_ERASE_US, BENCH_PAGE_US );
+  passed = bench_dropped( listen_fd );
+  for( i = 0; i < sizeof(bench_runs) / sizeof(bench_runs[0]); i++ )
+    passed &= bench_run( listen_fd, &bench_runs[i], i + 1 );
+
+exit:
+  ota_bench_log( "OTA Bench %s!", passed ? "finished" : "failed" );
+  SocketClose( &listen_fd );
+  mico_rtos_delete_thread( NULL );
+  return 0;
+}
@@ -0,0 +1,311 @@
+/**
+******************************************************************************
+* @file    para_storage_stress_test.c
+* @author  William Xu
+* @version V1.0.0
+* @date    17-Oct-2026
+* @brief   System config storage power cut stress test demo based on MiCO !
+******************************************************************************
+*
+*  The MIT License
+*  Copyright (c) 2016 MXCHIP Inc.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is furnished
+*  to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in
+*  all copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+*  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+*  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+******************************************************************************
+*/
+
+#include "MICO.h"
+#include "system.h"
+#include "CheckSumUtils.h"
+
+#include <sys/wait.h>
+
+#define para_stress_log(format, ...)  custom_log("ParaStorage", format, ##__VA_ARGS__)
+
+/* Demo Function:
+ * Every boot of the device is a child process, so it starts from what is on
+ * the file backed flash and nothing else. The children update the system and
+ * user config, and the emulated flash loses power in the middle of a random
+ * erase or write, or runs an OTA and the bootloader rewriting the boot table.
+ * The next boot has to load either the config before the update or the one
+ * after it, and the one after it when the power stayed on.
+ * Host (POSIX) build only. */
+
+#define TEST_USER_SIZE      ( 600 )
+#define TEST_USER_GROWTH    ( 64 )      // Bytes a newer firmware adds to the user config
+#define TEST_TRIALS         ( 3000 )
+#define TEST_MAX_CUT        ( 12 )      // Flash operations an update may get through before the cut
+#define TEST_UPDATES        ( 1000 )
+#define TEST_DEFAULT_BYTE   ( 0x5A )
+
+/* The layout before the log, see para_legacy_read() */
+#define LEGACY_USER_CONFIG_OFFSET   ( 0x400 )
+#define LEGACY_CRC_OFFSET           ( 0xE00 )
+
+/* What a boot found, the exit code of test_verify_boot() */
+enum
+{
+  TEST_BOOT_OLD,
+  TEST_BOOT_NEW,
+  TEST_BOOT_OTHER,        // Neither of them, the config is lost or mixed
+  TEST_BOOT_NO_SYSTEM,    // The system config is missing
+};
+
+pid_t fork( void );
+
+/* Host only */
+extern const platform_flash_t platform_flash_peripherals[];
+
+static uint8_t  old_user[TEST_USER_SIZE + TEST_USER_GROWTH], new_user[TEST_USER_SIZE + TEST_USER_GROWTH];
+static char     old_name[maxNameLen], new_name[maxNameLen];
+static uint32_t user_size = TEST_USER_SIZE;
+
+/* Fills the user config a newer firmware added */
+void appRestoreDefault_callback( void * const user_config_data, uint32_t size )
+{
+  memset( user_config_data, TEST_DEFAULT_BYTE, size );
+}
+
+/* Runs one boot of the device in a child process, and returns its exit code,
+   PLATFORM_FLASH_POWER_CUT_STATUS if the power failed */
+static int test_boot( int (*boot)( void ), uint32_t power_cut )
+{
+  pid_t pid;
+  int status;
+
+  pid = fork( );
+  if( pid == 0 ){
+    platform_flash_power_cut( power_cut );
+    _Exit( boot( ) );
+  }
+  if( pid < 0 || waitpid( pid, &status, 0 ) != pid || !WIFEXITED( status ) )
+    return -1;
+  return WEXITSTATUS( status );
+}
+
+static int test_erase_boot( void )
+{
+  MicoFlashErase( MICO_PARTITION_PARAMETER_1, 0x0, MicoFlashGetInfo( MICO_PARTITION_PARAMETER_1 )->partition_length );
+  MicoFlashErase( MICO_PARTITION_PARAMETER_2, 0x0, MicoFlashGetInfo( MICO_PARTITION_PARAMETER_2 )->partition_length );
+  return 0;
+}
+
+static int test_update_boot( void )
+{
+  mico_Context_t *context = mico_system_context_init( user_size );
+
+  memcpy( context->user_config_data, new_user, user_size );
+  strcpy( context->flashContentInRam.micoSystemConfig.name, new_name );
+  return mico_system_context_update( context ) == kNoErr ? 0 : 1;
+}
+
+/* An OTA stores a new boot table, the config itself stays the same */
+static int test_ota_boot( void )
+{
+  mico_Context_t *context = mico_system_context_init( user_size );
+  uint8_t *table = (uint8_t *)&context->flashContentInRam.bootTable;
+  uint32_t i;
+
+  for( i = 0; i < sizeof(boot_table_t); i++ )
+    table[i] = (uint8_t)rand( );
+  return mico_system_context_update( context ) == kNoErr ? 0 : 1;
+}
+
+/* After an update the bootloader clears the boot table, it rewrites the first sector of PARAMETER_1 */
+static int test_bootloader_boot( void )
+{
+  static uint8_t sector[4096];
+  uint32_t offset = 0x0;
+
+  MicoFlashRead( MICO_PARTITION_PARAMETER_1, &offset, sector, sizeof(sector) );
+  memset( sector, 0xFF, sizeof(boot_table_t) );
+  MicoFlashErase( MICO_PARTITION_PARAMETER_1, 0x0, sizeof(sector) );
+  offset = 0x0;
+  MicoFlashWrite( MICO_PARTITION_PARAMETER_1, &offset, sector, sizeof(sector) );
+  return 0;
+}
+
+static int test_verify_boot( void )
+{
+  mico_Context_t *context = mico_system_context_init( user_size );
+  mico_sys_config_t *sys = &context->flashContentInRam.micoSystemConfig;
+
+  if( sys->magic_number != SYS_MAGIC_NUMBR )
+    return TEST_BOOT_NO_SYSTEM;
+  if( memcmp( context->user_config_data, old_user, user_size ) == 0 && strcmp( sys->name, old_name ) == 0 )
+    return TEST_BOOT_OLD;
+  if( memcmp( context->user_config_data, new_user, user_size ) == 0 && strcmp( sys->name, new_name ) == 0 )
+    return TEST_BOOT_NEW;
+  return TEST_BOOT_OTHER;
+}
+
+/* A config written by a firmware from before the log: the same image in both partitions, with a CRC */
+static int test_legacy_boot( void )
+{
+  static flash_content_t content;
+  CRC16_Context crc_context;
+  uint16_t crc;
+  uint32_t offset;
+  mico_partition_t partition;
+
+  memset( &content, 0xFF, sizeof(content.bootTable) );
+  memset( &content.micoSystemConfig, 0x0, sizeof(content.micoSystemConfig) );
+  strcpy( content.micoSystemConfig.name, new_name );
+  content.micoSystemConfig.magic_number = SYS_MAGIC_NUMBR;
+
+  CRC16_Init( &crc_context );
+  CRC16_Update( &crc_context, &content.micoSystemConfig, sizeof(mico_sys_config_t) );
+  CRC16_Update( &crc_context, new_user, user_size );
+  CRC16_Final( &crc_context, &crc );
+
+  for( partition = MICO_PARTITION_PARAMETER_1; partition <= MICO_PARTITION_PARAMETER_2; partition++ ){
+    MicoFlashErase( partition, 0x0, 4096 );
+    offset = 0x0;
+    MicoFlashWrite( partition, &offset, (uint8_t *)&content, sizeof(content) );
+    offset = LEGACY_USER_CONFIG_OFFSET;
+    MicoFlashWrite( partition, &offset, new_user, user_size );
+    offset = LEGACY_CRC_OFFSET;
+    MicoFlashWrite( partition, &offset, (uint8_t *)&crc, sizeof(crc) );
+  }
+  return 0;
+}
+
+static int test_wear_boot( void )
+{
+  mico_Context_t *context = mico_system_context_init( user_size );
+  const platform_flash_t *flash = &platform_flash_peripherals[MicoFlashGetInfo( MICO_PARTITION_PARAMETER_1 )->partition_owner];
+  uint32_t i, erases;
+
+  erases = platform_flash_erase_count( flash );
+  for( i = 0; i < TEST_UPDATES; i++ ){
+    ((uint8_t *)context->user_config_data)[rand( ) % user_size]++;
+    mico_system_context_update( context );
+  }
+  para_stress_log( "%d one byte updates: %d sectors erased", TEST_UPDATES, (int)( platform_flash_erase_count( flash ) - erases ) );
+
+  erases = platform_flash_erase_count( flash );
+  for( i = 0; i < TEST_UPDATES; i++ )
+    mico_system_context_update( context );
+  /* mico_system_context_update() counts every update in the seed, one block still changes */
+  para_stress_log( "%d updates of the seed only: %d sectors erased", TEST_UPDATES, (int)( platform_flash_erase_count( flash ) - erases ) );
+  return 0;
+}
+
+/* The next update changes a few bytes, the whole user config, or the device name */
+static void test_next_config( void )
+{
+  int i;
+
+  memcpy( new_user, old_user, sizeof(new_user) );
+  strcpy( new_name, old_name );
+  if( rand( ) % 4 == 0 ){
+    for( i = 0; i < TEST_USER_SIZE; i++ )
+      new_user[i] = (uint8_t)rand( );
+  }else{
+    for( i = rand( ) % 20 + 1; i > 0; i-- )
+      new_user[rand( ) % TEST_USER_SIZE] = (uint8_t)rand( );
+  }
+  if( rand( ) % 3 == 0 )
+    sprintf( new_name, "dev-%d", rand( ) % 100000 );
+}
+
+static void test_keep_config( void )
+{
+  memcpy( old_user, new_user, sizeof(old_user) );
+  strcpy( old_name, new_name );
+}
+
+int application_start( void )
+{
+  int i, result, results[TEST_BOOT_NO_SYSTEM + 1] = { 0 }, cuts = 0;
+  bool passed = false, cut;
+  uint32_t start = mico_get_time( );
+
+  para_stress_log( "Para Storage Stress Test Start, %d trials, %d bytes user config", TEST_TRIALS, TEST_USER_SIZE );
+  srand( 1 );
+  require( test_boot( test_erase_boot, 0 ) == 0, exit );
+
+  /* A config from the old layout is converted on the first boot */
+  for( i = 0; i < TEST_USER_SIZE; i++ )
+    new_user[i] = (uint8_t)rand( );
+  strcpy( new_name, "legacy" );
+  test_boot( test_legacy_boot, 0 );
+  result = test_boot( test_verify_boot, 0 );
+  para_stress_log( "Legacy config %s", result == TEST_BOOT_NEW ? "converted" : "lost" );
+  require( result == TEST_BOOT_NEW, exit );
+  test_keep_config( );
+
+  for( i = 0; i < TEST_TRIALS; i++ ){
+    test_next_config( );
+    if( rand( ) % 10 == 0 ){
+      /* OTA and bootloader leave the config as it was */
+      memcpy( new_user, old_user, sizeof(new_user) );
+      strcpy( new_name, old_name );
+      result = test_boot( test_ota_boot, rand( ) % 4 ? 1 + rand( ) % TEST_MAX_CUT : 0 );
+      /* Only a boot table that was written completely starts the bootloader */
+      if( result == 0 )
+        result = test_boot( test_bootloader_boot, rand( ) % 2 ? 1 + rand( ) % 3 : 0 );
+    }else{
+      result = test_boot( test_update_boot, rand( ) % 4 ? 1 + rand( ) % TEST_MAX_CUT : 0 );
+    }
+    if( result == PLATFORM_FLASH_POWER_CUT_STATUS )
+      cuts++;
+
+    result = test_boot( test_verify_boot, 0 );
+    if( result < TEST_BOOT_OLD || result > TEST_BOOT_NO_SYSTEM ){
+      para_stress_log( "Trial %d: boot crashed", i );
+      goto exit;
+    }
+    results[result]++;
+    require_action( result <= TEST_BOOT_NEW, exit, para_stress_log( "Trial %d: config lost, %d", i, result ) );
+    if( result == TEST_BOOT_NEW )
+      test_keep_config( );
+  }
+  para_stress_log( "%d trials, %d power cuts: %d kept the old config, %d loaded the new one, %d lost it, %d ms",
+                   TEST_TRIALS, cuts, results[TEST_BOOT_OLD], results[TEST_BOOT_NEW],
+                   results[TEST_BOOT_OTHER] + results[TEST_BOOT_NO_SYSTEM], (int)( mico_get_time( ) - start ) );
+
+  test_boot( test_wear_boot, 0 );
+
+  /* A newer firmware with a larger user config keeps the old bytes and gets defaults for the rest.
+   * It is installed by an OTA, which leaves the only log in PARAMETER_2, and its first boot
+   * converting the config may lose power at any flash operation. */
+  for( i = 1, cut = true; cut; i++ ){
+    user_size = TEST_USER_SIZE;
+    test_next_config( );
+    require( test_boot( test_erase_boot, 0 ) == 0 && test_boot( test_update_boot, 0 ) == 0, exit );
+    require( test_boot( test_ota_boot, 0 ) == 0 && test_boot( test_bootloader_boot, 0 ) == 0, exit );
+    test_keep_config( );
+
+    user_size = TEST_USER_SIZE + TEST_USER_GROWTH;
+    memset( old_user + TEST_USER_SIZE, TEST_DEFAULT_BYTE, TEST_USER_GROWTH );
+    memcpy( new_user, old_user, sizeof(new_user) );
+    cut = test_boot( test_verify_boot, i ) == PLATFORM_FLASH_POWER_CUT_STATUS;
+    result = test_boot( test_verify_boot, 0 );
+    if( result != TEST_BOOT_OLD ){
+      para_stress_log( "Grown user config lost, power cut at flash operation %d: %d", i, result );
+      goto exit;
+    }
+  }
+  para_stress_log( "Grown user config kept, with defaults, power cut at each of its %d flash operations", i - 2 );
+  passed = true;
+
+exit:
+  para_stress_log( "Para Storage Stress Test %s!", passed ? "finished" : "failed" );
+  return 0;
+}
@@ -0,0 +1,269 @@
+/**
+******************************************************************************
+* @file    ring_buffer_stress_test.c
+* @author  William Xu
+* @version V1.0.0
+* @date    17-Oct-2026
+* @brief   Ring buffer producer/consumer stress test demo based on MiCO !
+******************************************************************************
+*
+*  The MIT License
+*  Copyright (c) 2016 MXCHIP Inc.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is furnished
+*  to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in
+*  all copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+*  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+*  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+******************************************************************************
+*/
+
+#include "MICO.h"
+#include "RingBufferUtils.h"
+
+#define ring_stress_log(format, ...)  custom_log("RingBuffer", format, ##__VA_ARGS__)
+
+/* Demo Function:
+ * A producer thread stands in for a UART RX DMA stream and pushes a byte
+ * sequence through a ring buffer in bursts of random length, the application
+ * thread takes it out again and checks every byte. The same stream is run
+ * through the copy, the zero copy span, the packet peek and the DMA/ISR APIs,
+ * with a power of two and an odd ring size, and the throughput and high
+ * watermark of each run are printed. */
+
+#define TEST_BYTES          ( 16 * 1024 * 1024 )
+#define TEST_MAX_BURST      ( 300 )
+#define TEST_RING_SIZE_MAX  ( 4096 )
+
+typedef enum
+{
+  TEST_MODE_COPY,         // ring_buffer_write( ) / ring_buffer_read( )
+  TEST_MODE_SPANS,        // Fill the write spans in place / check the read spans in place
+  TEST_MODE_PACKETS,      // Length prefixed packets, parsed with ring_buffer_peek( )
+  TEST_MODE_DMA,          // ring_buffer_dma_update( ) / ring_buffer_get_data( ), as the UART drivers do
+} test_mode_t;
+
+typedef struct
+{
+  const char *  name;
+  test_mode_t   mode;
+  uint32_t      ring_size;
+} test_run_t;
+
+static const test_run_t test_runs[] =
+{
+  { "copy,    4096 ring", TEST_MODE_COPY,    4096 },
+  { "copy,    4000 ring", TEST_MODE_COPY,    4000 },
+  { "spans,   4096 ring", TEST_MODE_SPANS,   4096 },
+  { "spans,   4000 ring", TEST_MODE_SPANS,   4000 },
+  { "packets, 4096 ring", TEST_MODE_PACKETS, 4096 },
+  { "dma,     4096 ring", TEST_MODE_DMA,     4096 },
+  { "dma,      512 ring", TEST_MODE_DMA,      512 },
+};
+
+static uint8_t          ring_data[TEST_RING_SIZE_MAX];
+static ring_buffer_t    ring;
+static test_mode_t      test_mode;
+static mico_semaphore_t data_sem;       // Set by the producer after it wrote
+static mico_semaphore_t space_sem;      // Set by the consumer after it read
+static mico_semaphore_t producer_done;
+
+/* Not a multiple of any ring size, so a byte in the wrong place shows up */
+static inline uint8_t test_byte( uint32_t seq )
+{
+  return (uint8_t)( seq % 251 );
+}
+
+static uint32_t test_random( uint32_t *seed )
+{
+  *seed = *seed * 1103515245 + 12345;
+  return *seed >> 16;
+}
+
+static void test_fill( ring_buffer_span_t span[2], uint32_t len, uint32_t *seq )
+{
+  uint32_t i;
+
+  for( i = 0; i < len; i++ )
+    *( i < span[0].length ? &span[0].data[i] : &span[1].data[i - span[0].length] ) = test_byte( (*seq)++ );
+}
+
+static void producer_thread( void *arg )
+{
+  ring_buffer_span_t span[2];
+  uint8_t burst[TEST_MAX_BURST];
+  uint32_t seq = 0, seed = 1, len, space, i;
+
+  UNUSED_PARAMETER( arg );
+
+  while( seq < TEST_BYTES )
+  {
+    len = test_random( &seed ) % TEST_MAX_BURST + 1;
+    if( len > TEST_BYTES - seq ) len = TEST_BYTES - seq;
+    if( test_mode == TEST_MODE_PACKETS && len > 256 ) len = 256;
+
+    space = ring_buffer_get_write_spans( &ring, span );
+    /* A packet goes in whole, with its length byte in front */
+    if( space < ( test_mode == TEST_MODE_PACKETS ? len + 1 : 1 ) )
+    {
+      mico_rtos_get_semaphore( &space_sem, 1 );
+      continue;
+    }
+    if( test_mode != TEST_MODE_PACKETS && len > space ) len = space;
+
+    switch( test_mode )
+    {
+      case TEST_MODE_COPY:
+        for( i = 0; i < len; i++ )
+          burst[i] = test_byte( seq + i );
+        seq += ring_buffer_write( &ring, burst, len );
+        break;
+
+      case TEST_MODE_SPANS:
+        test_fill( span, len, &seq );
+        ring_buffer_commit_write( &ring, len );
+        break;
+
+      case TEST_MODE_PACKETS:
+        span[0].data[0] = (uint8_t)( len - 1 );
+        if( span[0].length == 1 )
+        {
+          span[0] = span[1];
+          span[1].length = 0;
+        }
+        else
+        {
+          span[0].data++;
+          span[0].length--;
+        }
+        test_fill( span, len, &seq );
+        ring_buffer_commit_write( &ring, len + 1 );
+        break;
+
+      case TEST_MODE_DMA:
+        /* The DMA writes on, the ISR only learns the new position */
+        test_fill( span, len, &seq );
+        ring_buffer_dma_update( &ring, span[0].data - ring.buffer + len );
+        break;
+    }
+    mico_rtos_set_semaphore( &data_sem );
+  }
+
+  mico_rtos_set_semaphore( &producer_done );
+  mico_rtos_delete_thread( NULL );
+}
+
+/* Returns the number of bytes that were not what the producer wrote */
+static uint32_t test_check( const uint8_t *data, uint32_t len, uint32_t *seq )
+{
+  uint32_t i, errors = 0;
+
+  for( i = 0; i < len; i++ )
+    if( data[i] != test_byte( (*seq)++ ) ) errors++;
+  return errors;
+}
+
+static bool test_run( const test_run_t *run )
+{
+  ring_buffer_span_t span[2];
+  uint8_t burst[TEST_MAX_BURST];
+  uint8_t *data;
+  uint32_t seq = 0, seed = 7, errors = 0, len, used, start, elapsed;
+  OSStatus err;
+
+  ring_buffer_init( &ring, ring_data, run->ring_size );
+  test_mode = run->mode;
+  mico_rtos_init_semaphore( &data_sem, 1 );
+  mico_rtos_init_semaphore( &space_sem, 1 );
+  mico_rtos_init_semaphore( &producer_done, 1 );
+
+  start = mico_get_time( );
+  err = mico_rtos_create_thread( NULL, MICO_APPLICATION_PRIORITY, "Producer", producer_thread, 0x800, NULL );
+  require_noerr( err, exit );
+
+  while( seq < TEST_BYTES )
+  {
+    used = ring_buffer_get_read_spans( &ring, span );
+    if( used == 0 )
+    {
+      mico_rtos_get_semaphore( &data_sem, 1 );
+      continue;
+    }
+
+    switch( run->mode )
+    {
+      case TEST_MODE_COPY:
+        len = test_random( &seed ) % TEST_MAX_BURST + 1;
+        len = ring_buffer_read( &ring, burst, len );
+        errors += test_check( burst, len, &seq );
+        break;
+
+      case TEST_MODE_SPANS:
+        errors += test_check( span[0].data, span[0].length, &seq );
+        errors += test_check( span[1].data, span[1].length, &seq );
+        ring_buffer_consume( &ring, used );
+        break;
+
+      case TEST_MODE_PACKETS:
+        ring_buffer_peek( &ring, 0, burst, 1 );
+        len = burst[0] + 1;
+        if( used < len + 1 )
+        {
+          mico_rtos_get_semaphore( &data_sem, 1 );
+          continue;
+        }
+        /* Parse the packet where it is, then drop it */
+        len = ring_buffer_peek( &ring, 1, burst, len );
+        errors += test_check( burst, len, &seq );
+        ring_buffer_consume( &ring, len + 1 );
+        break;
+
+      case TEST_MODE_DMA:
+        ring_buffer_get_data( &ring, &data, &len );
+        errors += test_check( data, len, &seq );
+        ring_buffer_consume( &ring, len );
+        break;
+    }
+    mico_rtos_set_semaphore( &space_sem );
+  }
+
+  elapsed = mico_get_time( ) - start;
+  if( elapsed == 0 ) elapsed = 1;
+  mico_rtos_get_semaphore( &producer_done, MICO_WAIT_FOREVER );
+
+  ring_stress_log( "%s: %d KB in %d ms, %d.%02d MB/s, high watermark %d, %d bad bytes",
+                   run->name, TEST_BYTES / 1024, (int)elapsed,
+                   (int)( TEST_BYTES / 1000 / elapsed ), (int)( TEST_BYTES / 10 / elapsed % 100 ),
+                   (int)ring_buffer_high_watermark( &ring ), (int)errors );
+
+exit:
+  mico_rtos_deinit_semaphore( &data_sem );
+  mico_rtos_deinit_semaphore( &space_sem );
+  mico_rtos_deinit_semaphore( &producer_done );
+  return err == kNoErr && errors == 0;
+}
+
+int application_start( void )
+{
+  uint32_t i;
+  bool passed = true;
+
+  ring_stress_log( "Ring Buffer Stress Test Start, %d KB per run", TEST_BYTES / 1024 );
+
+  for( i = 0; i < sizeof(test_runs) / sizeof(test_runs[0]); i++ )
+    passed &= test_run( &test_runs[i] );
+
+  ring_stress_log( "Ring Buffer Stress Test %s!", passed ? "finished" : "failed" );
+  return 0;
+}
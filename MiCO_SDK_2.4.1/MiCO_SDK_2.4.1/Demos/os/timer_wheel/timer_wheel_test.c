@@ -0,0 +1,319 @@
+/**
+******************************************************************************
+* @file    timer_wheel_test.c
+* @author  William Xu
+* @version V1.0.0
+* @date    17-Oct-2026
+* @brief   System timer service test and benchmark demo based on MiCO !
+******************************************************************************
+*
+*  The MIT License
+*  Copyright (c) 2016 MXCHIP Inc.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is furnished
+*  to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in
+*  all copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+*  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+*  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+******************************************************************************
+*/
+
+#include "MICO.h"
+
+#define timer_test_log(format, ...)  custom_log("Timer test", format, ##__VA_ARGS__)
+
+/* Demo Function:
+ * Checks that system timers expire in time, in the fine and in a coarse
+ * wheel, never early, that periodic timers keep their period, and that a
+ * timer can be restarted and stopped by another timer's handler. Then
+ * 10000 timers, one per connection of a busy server, are started,
+ * restarted, stopped and left to expire, and the cost of each operation is
+ * printed, next to the cost of starting and stopping as many RTOS timers. */
+
+#define TEST_TICK           ( 10 )      // MICO_SYSTEM_TIMER_TICK
+#define TEST_MAX_LATE       ( 2 * TEST_TICK + 20 )
+#define BENCH_TIMERS        ( 10000 )
+#define BENCH_ROUNDS        ( 100 )
+
+typedef struct
+{
+  mico_system_timer_t   timer;
+  uint32_t              started;
+  uint32_t              delay;
+  volatile uint32_t     expired;    // mico_get_time( ) of the last expiry
+  volatile uint32_t     count;
+} test_timer_t;
+
+static test_timer_t       test_timers[8];
+static test_timer_t       bench_timers[BENCH_TIMERS];
+static mico_timer_t       rtos_timers[BENCH_TIMERS];
+static volatile uint32_t  bench_expired = 0;
+static volatile uint32_t  bench_early = 0;
+static volatile uint32_t  bench_late_max = 0;
+static volatile uint32_t  bench_first = 0;
+static volatile uint32_t  bench_last = 0;
+static int                failures = 0;
+
+static uint32_t test_random( uint32_t *seed )
+{
+  *seed = *seed * 1103515245 + 12345;
+  return *seed >> 8;
+}
+
+static void test_check( bool ok, const char *what )
+{
+  if( !ok ) failures++;
+  timer_test_log( "%s: %s", ok ? "pass" : "FAIL", what );
+}
+
+static void test_handler( void *arg )
+{
+  test_timer_t *t = arg;
+
+  t->expired = mico_get_time( );
+  t->count++;
+}
+
+static void test_start( test_timer_t *t, mico_system_timer_handler_t handler, uint32_t delay, uint32_t period )
+{
+  mico_system_timer_init( &t->timer, handler, t );
+  t->count = 0;
+  t->delay = delay;
+  t->started = mico_get_time( );
+  mico_system_timer_start( &t->timer, delay, period );
+}
+
+/* Restarts test_timers[1] with its own delay, stops test_timers[2] */
+static void test_restart_handler( void *arg )
+{
+  test_timer_t *t = arg;
+
+  t->expired = mico_get_time( );
+  t->count++;
+  test_timers[1].started = mico_get_time( );
+  mico_system_timer_start( &test_timers[1].timer, test_timers[1].delay, 0 );
+  mico_system_timer_stop( &test_timers[2].timer );
+}
+
+/* Stops itself on the fifth expiry */
+static void test_self_stop_handler( void *arg )
+{
+  test_timer_t *t = arg;
+
+  t->expired = mico_get_time( );
+  if( ++t->count == 5 )
+    mico_system_timer_stop( &t->timer );
+}
+
+static void bench_handler( void *arg )
+{
+  test_timer_t *t = arg;
+  uint32_t now = mico_get_time( ), late;
+
+  if( bench_expired++ == 0 )
+    bench_first = now;
+  bench_last = now;
+  if( now - t->started < t->delay )
+    bench_early++;
+  late = now - t->started - t->delay;
+  if( (int32_t)late > (int32_t)bench_late_max )
+    bench_late_max = late;
+}
+
+static void rtos_handler( void *arg )
+{
+  UNUSED_PARAMETER( arg );
+}
+
+static bool test_wait( volatile uint32_t *value, uint32_t expected, uint32_t timeout )
+{
+  uint32_t start = mico_get_time( );
+
+  while( *value < expected && mico_get_time( ) - start < timeout )
+    mico_thread_msleep( 5 );
+  return *value >= expected;
+}
+
+static void test_accuracy( void )
+{
+  static const uint32_t delays[] = { 0, 5, 15, 100, 630, 650, 2600, 5000 };
+  char text[96];
+  uint32_t i, taken;
+
+  /* 630 ms is in the fine wheel, the others after it are cascaded */
+  for( i = 0; i < 8; i++ )
+    test_start( &test_timers[i], test_handler, delays[i], 0 );
+  test_wait( &test_timers[7].count, 1, 6000 );
+  mico_thread_msleep( 50 );
+
+  for( i = 0; i < 8; i++ ){
+    taken = test_timers[i].expired - test_timers[i].started;
+    sprintf( text, "One-shot %d ms expired once, after %d ms", (int)delays[i], (int)taken );
+    test_check( test_timers[i].count == 1 && taken >= delays[i] && taken <= delays[i] + TEST_MAX_LATE, text );
+    test_check( !mico_system_timer_pending( &test_timers[i].timer ), "Not pending after it expired" );
+  }
+}
+
+static void test_periodic( void )
+{
+  char text[96];
+  uint32_t count;
+
+  test_start( &test_timers[0], test_handler, 50, 50 );
+  mico_thread_msleep( 1025 );
+  count = test_timers[0].count;
+  sprintf( text, "50 ms period, %d expiries in 1025 ms", (int)count );
+  test_check( count >= 19 && count <= 21 && mico_system_timer_pending( &test_timers[0].timer ), text );
+
+  mico_system_timer_stop( &test_timers[0].timer );
+  count = test_timers[0].count;
+  mico_thread_msleep( 200 );
+  test_check( test_timers[0].count == count && !mico_system_timer_pending( &test_timers[0].timer ), "Stopped, no more expiries" );
+
+  test_start( &test_timers[0], test_self_stop_handler, 20, 20 );
+  mico_thread_msleep( 300 );
+  test_check( test_timers[0].count == 5 && !mico_system_timer_pending( &test_timers[0].timer ), "Periodic timer stopped by its handler" );
+}
+
+static void test_restart( void )
+{
+  char text[96];
+  uint32_t taken;
+
+  /* Restarted 100 ms after it was started with 200 ms, expires 300 ms after the first start */
+  test_start( &test_timers[0], test_handler, 200, 0 );
+  mico_thread_msleep( 100 );
+  mico_system_timer_start( &test_timers[0].timer, 200, 0 );
+  test_wait( &test_timers[0].count, 1, 1000 );
+  taken = test_timers[0].expired - test_timers[0].started;
+  sprintf( text, "Restarted while pending, expired once after %d ms", (int)taken );
+  test_check( test_timers[0].count == 1 && taken >= 300 && taken <= 300 + TEST_MAX_LATE, text );
+
+  /* test_timers[0] restarts [1] before it is due and stops [2] */
+  test_start( &test_timers[1], test_handler, 150, 0 );
+  test_start( &test_timers[2], test_handler, 300, 0 );
+  test_start( &test_timers[0], test_restart_handler, 100, 0 );
+  mico_thread_msleep( 400 );
+  taken = test_timers[1].expired - test_timers[1].started;
+  sprintf( text, "Restarted and stopped by a handler, expired after %d ms", (int)taken );
+  test_check( test_timers[0].count == 1 && test_timers[1].count == 1 && test_timers[2].count == 0 &&
+              taken >= 150 && taken <= 150 + TEST_MAX_LATE, text );
+
+  test_check( mico_system_timer_start( &test_timers[3].timer, 0xFFFFFFFF, 0 ) == kRangeErr, "Delay beyond the last wheel refused" );
+}
+
+/* ns per operation, from ms for count operations */
+static int bench_ns( uint32_t ms, uint32_t count )
+{
+  return (int)( (uint64_t)ms * 1000000 / count );
+}
+
+static void test_benchmark( void )
+{
+  char text[128];
+  uint32_t seed = 1, i, round, start, ms_start, ms_restart, ms_pair;
+
+  timer_test_log( "%d timers, delays of 1 s to 10 min:", BENCH_TIMERS );
+
+  for( i = 0; i < BENCH_TIMERS; i++ ){
+    mico_system_timer_init( &bench_timers[i].timer, bench_handler, &bench_timers[i] );
+    bench_timers[i].delay = 1000 + test_random( &seed ) % ( 600 * 1000 );
+  }
+
+  start = mico_get_time( );
+  for( i = 0; i < BENCH_TIMERS; i++ )
+    mico_system_timer_start( &bench_timers[i].timer, bench_timers[i].delay, 0 );
+  ms_start = mico_get_time( ) - start;
+
+  /* An idle timeout restarted on every packet */
+  start = mico_get_time( );
+  for( round = 0; round < BENCH_ROUNDS; round++ )
+    for( i = 0; i < BENCH_TIMERS; i++ )
+      mico_system_timer_start( &bench_timers[i].timer, bench_timers[i].delay, 0 );
+  ms_restart = mico_get_time( ) - start;
+
+  /* A timeout for every request, stopped by the answer */
+  start = mico_get_time( );
+  for( round = 0; round < BENCH_ROUNDS; round++ ){
+    for( i = 0; i < BENCH_TIMERS; i++ )
+      mico_system_timer_stop( &bench_timers[i].timer );
+    for( i = 0; i < BENCH_TIMERS; i++ )
+      mico_system_timer_start( &bench_timers[i].timer, bench_timers[i].delay, 0 );
+  }
+  ms_pair = mico_get_time( ) - start;
+
+  timer_test_log( "  start   %6d ns, %d ms for %d timers", bench_ns( ms_start, BENCH_TIMERS ), (int)ms_start, BENCH_TIMERS );
+  timer_test_log( "  restart %6d ns, %d ms for %d restarts", bench_ns( ms_restart, BENCH_TIMERS * BENCH_ROUNDS ), (int)ms_restart, BENCH_TIMERS * BENCH_ROUNDS );
+  timer_test_log( "  stop + start %6d ns, %d ms for %d pairs", bench_ns( ms_pair, BENCH_TIMERS * BENCH_ROUNDS ), (int)ms_pair, BENCH_TIMERS * BENCH_ROUNDS );
+  system_timer_print( printf );
+
+  start = mico_get_time( );
+  for( i = 0; i < BENCH_TIMERS; i++ )
+    mico_system_timer_stop( &bench_timers[i].timer );
+  timer_test_log( "  stop all in %d ms", (int)( mico_get_time( ) - start ) );
+  test_check( bench_expired == 0, "None of the 10 min timers has expired" );
+
+  /* The same timers as RTOS timers */
+  for( i = 0; i < BENCH_TIMERS; i++ )
+    mico_init_timer( &rtos_timers[i], bench_timers[i].delay, rtos_handler, NULL );
+  start = mico_get_time( );
+  for( i = 0; i < BENCH_TIMERS; i++ )
+    mico_start_timer( &rtos_timers[i] );
+  ms_start = mico_get_time( ) - start;
+  start = mico_get_time( );
+  for( i = 0; i < BENCH_TIMERS; i++ )
+    mico_stop_timer( &rtos_timers[i] );
+  ms_pair = mico_get_time( ) - start;
+  for( i = 0; i < BENCH_TIMERS; i++ )
+    mico_deinit_timer( &rtos_timers[i] );
+  timer_test_log( "  RTOS timers: start %d ns, stop %d ns", bench_ns( ms_start, BENCH_TIMERS ), bench_ns( ms_pair, BENCH_TIMERS ) );
+
+  /* Expiries spread over 2 s, cascaded from the coarse wheel */
+  timer_test_log( "%d timers, delays of 1 to 3 s:", BENCH_TIMERS );
+  for( i = 0; i < BENCH_TIMERS; i++ ){
+    bench_timers[i].delay = 1000 + test_random( &seed ) % 2000;
+    bench_timers[i].started = mico_get_time( );
+    mico_system_timer_start( &bench_timers[i].timer, bench_timers[i].delay, 0 );
+  }
+  test_wait( &bench_expired, BENCH_TIMERS, 6000 );
+  sprintf( text, "%d expired, %d early, up to %d ms late", (int)bench_expired, (int)bench_early, (int)bench_late_max );
+  test_check( bench_expired == BENCH_TIMERS && bench_early == 0 && bench_late_max <= TEST_MAX_LATE, text );
+
+  /* All due in the same tick */
+  bench_expired = 0;
+  start = mico_get_time( );
+  for( i = 0; i < BENCH_TIMERS; i++ ){
+    bench_timers[i].delay = 1500;
+    bench_timers[i].started = start;
+    mico_system_timer_start( &bench_timers[i].timer, bench_timers[i].delay, 0 );
+  }
+  test_wait( &bench_expired, BENCH_TIMERS, 3000 );
+  sprintf( text, "%d due in one tick, handlers run in %d ms, %d ns each", (int)bench_expired,
+           (int)( bench_last - bench_first ), bench_ns( bench_last - bench_first, BENCH_TIMERS ) );
+  test_check( bench_expired == BENCH_TIMERS && bench_early == 0, text );
+  system_timer_print( printf );
+}
+
+int application_start( void )
+{
+  timer_test_log( "Timer Wheel Test Start" );
+
+  test_accuracy( );
+  test_periodic( );
+  test_restart( );
+  test_benchmark( );
+
+  timer_test_log( "Timer Wheel Test %s, %d failures!", failures ? "failed" : "finished", failures );
+  return 0;
+}
@@ -33,37 +33,19 @@
 
 #define dns_log(M, ...) custom_log("DNS", M, ##__VA_ARGS__)
 
-static mico_semaphore_t wait_sem = NULL;
 static char *domain = "www.baidu.com";
 
-static void micoNotify_WifiStatusHandler(WiFiEvent status, void* const inContext)
-{
-  switch (status) {
-  case NOTIFY_STATION_UP:
-    mico_rtos_set_semaphore(&wait_sem);
-    break;
-  case NOTIFY_STATION_DOWN:
-    break;
-  }
-}
-
 int application_start( void )
 {
   OSStatus err = kNoErr;
   char ipstr[16];
   
-  mico_rtos_init_semaphore( &wait_sem,1 );
-  
-  /*Register user function for MiCO nitification: WiFi status changed */
-  err = mico_system_notify_register( mico_notify_WIFI_STATUS_CHANGED, (void *)micoNotify_WifiStatusHandler, NULL );
-  require_noerr( err, exit ); 
-  
   /* Start MiCO system functions according to mico_config.h*/
   err = mico_system_init( mico_system_context_init( 0 ) );
   require_noerr( err, exit ); 
   
-  /* Wait for wlan connection*/
-  mico_rtos_get_semaphore( &wait_sem, MICO_WAIT_FOREVER );
+  /* Wait for wlan connection and an IP address */
+  mico_system_ready_wait( mico_ready_IP, MICO_WAIT_FOREVER );
   dns_log( "wifi connected successful" );
   
   /* Resolve DNS address */
@@ -72,8 +54,6 @@ int application_start( void )
   dns_log( "%s ip address is %s",domain, ipstr );
   
 exit:  
-  if( wait_sem != NULL)
-    mico_rtos_deinit_semaphore( &wait_sem );
   mico_rtos_delete_thread( NULL );
   return err;
 }
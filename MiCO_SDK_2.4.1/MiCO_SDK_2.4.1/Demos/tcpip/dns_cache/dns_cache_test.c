@@ -0,0 +1,356 @@
+/**
+******************************************************************************
+* @file    dns_cache_test.c
+* @author  William Xu
+* @version V1.0.0
+* @date    17-Oct-2026
+* @brief   System DNS resolver and cache test demo based on MiCO !
+******************************************************************************
+*
+*  The MIT License
+*  Copyright (c) 2016 MXCHIP Inc.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is furnished
+*  to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in
+*  all copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+*  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+*  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+******************************************************************************
+*/
+
+#include "MICO.h"
+
+#define dns_test_log(format, ...)  custom_log("DNS test", format, ##__VA_ARGS__)
+
+/* Demo Function:
+ * A DNS server stand-in thread answers on a local UDP port from a small
+ * zone table and counts the queries it gets, the system resolver is pointed
+ * at it with mico_system_dns_set_server( ). Every case checks the answer and
+ * how many queries reached the server: cache hits, TTL expiry, CNAME chains,
+ * negative caching from the SOA minimum, server failures, lookups of one
+ * name coalesced into one query, LRU eviction, the last known address kept
+ * in the application's configuration data, and a server that never answers. */
+
+#define TEST_SERVER_PORT    ( 10053 )
+#define TEST_WAITERS        ( 4 )
+#define TEST_CACHE_ENTRIES  ( 8 )     // MICO_DNS_CACHE_ENTRIES
+
+typedef struct
+{
+  const char *  name;
+  const char *  ip;         // NULL: the name does not exist
+  uint32_t      ttl;
+  const char *  cname;      // Answered as an alias of this name, with its address
+  uint32_t      delay;      // ms before the answer
+  uint16_t      rcode;
+  bool          silent;     // Never answered
+  bool          moving;     // The last byte of the address is the number of queries for it
+} test_zone_t;
+
+static const test_zone_t test_zone[] =
+{
+  { "a.test",      "10.0.0.1",  300 },
+  { "short.test",  "10.0.0.2",  1 },
+  { "alias.test",  NULL,        60,  "target.test" },
+  { "target.test", "10.0.0.3",  300 },
+  { "none.test",   NULL,        600 },                    // SOA minimum 2 s
+  { "fail.test",   NULL,        0,   NULL, 0,   2 },      // SERVFAIL
+  { "slow.test",   "10.0.0.4",  300, NULL, 300 },
+  { "silent.test", NULL,        0,   NULL, 0,   0, true },
+  { "moved.test",  "10.0.2.0",  300, NULL, 0,   0, false, true },
+  { "host.test",   "10.0.1.0",  300 },                    // host0.test to host9.test
+};
+
+#define TEST_SOA_MINIMUM    ( 2 )
+
+/* What the application keeps in flash, see mico_system_dns_persist( ) */
+typedef struct
+{
+  mico_dns_persist_t  dns[2];
+} test_config_t;
+
+static volatile uint32_t  server_queries = 0;
+static uint32_t           moved_queries = 0;
+static mico_semaphore_t   waiter_done;
+static volatile uint32_t  waiter_ip[TEST_WAITERS + 1];
+static volatile OSStatus  waiter_err[TEST_WAITERS + 1];
+static int                failures = 0;
+
+void appRestoreDefault_callback( void * const user_config_data, uint32_t size )
+{
+  memset( user_config_data, 0x0, size );
+}
+
+static const test_zone_t *test_zone_find( const char *name, int *index )
+{
+  uint32_t i;
+
+  *index = -1;
+  if( sscanf( name, "host%d.test", index ) == 1 )
+    name = "host.test";
+  for( i = 0; i < sizeof(test_zone) / sizeof(test_zone[0]); i++ ){
+    if( strcasecmp( test_zone[i].name, name ) == 0 )
+      return &test_zone[i];
+  }
+  return NULL;
+}
+
+static int test_write_ip( uint8_t *p, const char *ip, int last )
+{
+  unsigned int b[4];
+
+  sscanf( ip, "%u.%u.%u.%u", &b[0], &b[1], &b[2], &b[3] );
+  if( last >= 0 ) b[3] = last;
+  p[0] = b[0]; p[1] = b[1]; p[2] = b[2]; p[3] = b[3];
+  return 4;
+}
+
+static int test_write_name( uint8_t *start, const char *name )
+{
+  uint8_t *label = start, *p = start + 1;
+
+  for( ; ; name++ ){
+    if( *name == '.' || *name == 0 ){
+      *label = p - label - 1;
+      if( *name == 0 ) break;
+      label = p++;
+    }else{
+      *p++ = *name;
+    }
+  }
+  *p++ = 0;
+  return p - start;
+}
+
+static int test_write_rr( uint8_t *p, uint16_t type, uint32_t ttl, uint16_t rdlen )
+{
+  WriteBig16( p, type );
+  WriteBig16( p + 2, 1 );
+  WriteBig32( p + 4, ttl );
+  WriteBig16( p + 8, rdlen );
+  return 10;
+}
+
+/* Answers every query from test_zone, in the order they come */
+static void test_server_thread( void *arg )
+{
+  struct sockaddr_t addr;
+  socklen_t addr_len;
+  const test_zone_t *zone, *target;
+  uint8_t packet[512], *p;
+  char name[MICO_DNS_NAME_LEN];
+  int fd, len, offset, index, target_index, target_offset, n;
+
+  UNUSED_PARAMETER( arg );
+
+  fd = socket( AF_INET, SOCK_DGRM, IPPROTO_UDP );
+  addr.s_ip = INADDR_ANY;
+  addr.s_port = TEST_SERVER_PORT;
+  bind( fd, &addr, sizeof(addr) );
+
+  while( 1 ){
+    addr_len = sizeof(addr);
+    len = recvfrom( fd, packet, sizeof(packet), 0, &addr, &addr_len );
+    if( len <= 12 ) continue;
+    server_queries++;
+
+    /* The question name, label by label */
+    for( offset = 12, n = 0; offset < len && packet[offset] && n + packet[offset] + 1 < MICO_DNS_NAME_LEN; offset += packet[offset] + 1 ){
+      if( n ) name[n++] = '.';
+      memcpy( &name[n], &packet[offset + 1], packet[offset] );
+      n += packet[offset];
+    }
+    name[n] = 0;
+    offset += 5;
+
+    zone = test_zone_find( name, &index );
+    if( zone && zone->silent ) continue;
+    if( zone && zone->delay ) mico_thread_msleep( zone->delay );
+
+    WriteBig16( packet + 2, 0x8180 | ( zone ? zone->rcode : 3 ) );
+    WriteBig16( packet + 6, 0 );
+    WriteBig16( packet + 8, 0 );
+    WriteBig16( packet + 10, 0 );
+    p = packet + offset;
+
+    if( zone && zone->cname ){
+      target = test_zone_find( zone->cname, &target_index );
+      *p++ = 0xC0; *p++ = 12;
+      n = test_write_name( p + 10, zone->cname );
+      p += test_write_rr( p, 5, zone->ttl, n );
+      /* The address record points to the alias target in the CNAME record */
+      target_offset = p - packet;
+      p += n;
+      *p++ = 0xC0 | ( target_offset >> 8 ); *p++ = target_offset & 0xFF;
+      p += test_write_rr( p, 1, target->ttl, 4 );
+      p += test_write_ip( p, target->ip, -1 );
+      WriteBig16( packet + 6, 2 );
+    }else if( zone && zone->ip ){
+      *p++ = 0xC0; *p++ = 12;
+      p += test_write_rr( p, 1, zone->ttl, 4 );
+      p += test_write_ip( p, zone->ip, zone->moving ? (int)++moved_queries : index );
+      WriteBig16( packet + 6, 1 );
+    }else if( zone == NULL || zone->rcode == 0 ){
+      /* No such name, with the SOA record of the zone in the authority section */
+      WriteBig16( packet + 2, 0x8183 );
+      *p++ = 0xC0; *p++ = 12;
+      p += test_write_rr( p, 6, zone ? zone->ttl : 600, 2 + 20 );
+      *p++ = 0; *p++ = 0;
+      WriteBig32( p, 1 ); WriteBig32( p + 4, 3600 ); WriteBig32( p + 8, 600 );
+      WriteBig32( p + 12, 86400 ); WriteBig32( p + 16, TEST_SOA_MINIMUM );
+      p += 20;
+      WriteBig16( packet + 8, 1 );
+    }
+
+    sendto( fd, packet, p - packet, 0, &addr, sizeof(addr) );
+  }
+}
+
+static void test_check( bool ok, const char *what )
+{
+  if( !ok ) failures++;
+  dns_test_log( "%s: %s", ok ? "pass" : "FAIL", what );
+}
+
+/* Resolves hostname, and checks the answer and the number of queries the server got for it */
+static void test_resolve( const char *hostname, const char *ip, OSStatus expect, uint32_t queries, const char *what )
+{
+  char text[96];
+  uint32_t before = server_queries, got = 0;
+  OSStatus err;
+
+  err = mico_system_dns_resolve( hostname, &got, 3000 );
+  sprintf( text, "%s (%s, err %d, %d queries)", what, hostname, (int)err, (int)( server_queries - before ) );
+  test_check( err == expect && ( ip == NULL || got == inet_addr( (char *)ip ) ) && server_queries - before == queries, text );
+}
+
+static void test_waiter_thread( void *arg )
+{
+  uint32_t i = (uint32_t)(uintptr_t)arg, ip = 0;
+
+  waiter_err[i] = mico_system_dns_resolve( "slow.test", &ip, 3000 );
+  waiter_ip[i] = ip;
+  mico_rtos_set_semaphore( &waiter_done );
+  mico_rtos_delete_thread( NULL );
+}
+
+static void test_waiter_callback( const char *hostname, uint32_t ip, OSStatus err, void *arg )
+{
+  UNUSED_PARAMETER( hostname );
+  waiter_err[(uintptr_t)arg] = err;
+  waiter_ip[(uintptr_t)arg] = ip;
+  mico_rtos_set_semaphore( &waiter_done );
+}
+
+static void test_coalesce( void )
+{
+  uint32_t before = server_queries, i;
+  bool ok = true;
+
+  mico_rtos_init_semaphore( &waiter_done, TEST_WAITERS + 1 );
+  for( i = 0; i < TEST_WAITERS; i++ )
+    mico_rtos_create_thread( NULL, MICO_APPLICATION_PRIORITY, "DNS waiter", test_waiter_thread, 0x800, (void *)(uintptr_t)i );
+  mico_system_dns_resolve_async( "slow.test", test_waiter_callback, (void *)(uintptr_t)TEST_WAITERS );
+
+  for( i = 0; i < TEST_WAITERS + 1; i++ )
+    ok &= mico_rtos_get_semaphore( &waiter_done, 3000 ) == kNoErr;
+  for( i = 0; i < TEST_WAITERS + 1; i++ )
+    ok &= waiter_err[i] == kNoErr && waiter_ip[i] == inet_addr( "10.0.0.4" );
+  mico_rtos_deinit_semaphore( &waiter_done );
+
+  test_check( ok && server_queries - before == 1, "4 threads and a callback waiting for one name, one query" );
+}
+
+static void test_lru( void )
+{
+  char name[16];
+  int i;
+
+  mico_system_dns_flush( );
+  for( i = 0; i < TEST_CACHE_ENTRIES; i++ ){
+    sprintf( name, "host%d.test", i );
+    mico_system_dns_resolve( name, (uint32_t *)&waiter_ip[0], 3000 );
+    mico_thread_msleep( 2 );
+  }
+  test_resolve( "host0.test", "10.0.1.0", kNoErr, 0, "Cache full" );
+  mico_thread_msleep( 2 );
+  test_resolve( "host8.test", "10.0.1.8", kNoErr, 1, "One more name" );
+  test_resolve( "host0.test", "10.0.1.0", kNoErr, 0, "Used last, still cached" );
+  test_resolve( "host1.test", "10.0.1.1", kNoErr, 1, "Used longest ago, evicted" );
+}
+
+static void test_persist( mico_Context_t *context )
+{
+  test_config_t *config = mico_system_context_get_user_data( context );
+  uint32_t ip = 0, before = server_queries;
+
+  mico_system_dns_flush( );
+  strcpy( config->dns[0].name, "moved.test" );
+  config->dns[0].ip = inet_addr( "10.0.9.9" );
+  memset( &config->dns[1], 0x0, sizeof(config->dns[1]) );
+  mico_system_dns_persist( config->dns, 2 );
+
+  test_check( mico_system_dns_last_known( "moved.test", &ip ) == kNoErr && ip == inet_addr( "10.0.9.9" )
+              && server_queries == before, "Address from flash known before any query" );
+  test_resolve( "moved.test", "10.0.2.1", kNoErr, 1, "Address from flash is expired, asked again" );
+  test_check( config->dns[0].ip == inet_addr( "10.0.2.1" ), "New address written to the configuration" );
+  test_resolve( "a.test", "10.0.0.1", kNoErr, 1, "Other names" );
+  test_check( config->dns[1].name[0] == 0, "Other names not kept" );
+  mico_system_dns_persist( NULL, 0 );
+}
+
+int application_start( void )
+{
+  mico_Context_t *context;
+  uint32_t ip = 0, start;
+  OSStatus err;
+
+  dns_test_log( "DNS Cache Test Start" );
+
+  context = mico_system_context_init( sizeof(test_config_t) );
+  mico_rtos_create_thread( NULL, MICO_APPLICATION_PRIORITY, "DNS server", test_server_thread, 0x1000, NULL );
+  mico_system_dns_set_server( inet_addr( "127.0.0.1" ), TEST_SERVER_PORT );
+
+  test_resolve( "a.test", "10.0.0.1", kNoErr, 1, "First lookup" );
+  test_resolve( "a.test", "10.0.0.1", kNoErr, 0, "Cache hit" );
+  test_resolve( "A.Test", "10.0.0.1", kNoErr, 0, "Names are not case sensitive" );
+  test_resolve( "192.168.1.20", "192.168.1.20", kNoErr, 0, "Address literal" );
+  test_resolve( "alias.test", "10.0.0.3", kNoErr, 1, "CNAME followed" );
+
+  test_resolve( "short.test", "10.0.0.2", kNoErr, 1, "TTL 1 s" );
+  test_resolve( "short.test", "10.0.0.2", kNoErr, 0, "Within the TTL" );
+  mico_thread_msleep( 1100 );
+  test_resolve( "short.test", "10.0.0.2", kNoErr, 1, "TTL run out" );
+
+  test_resolve( "none.test", NULL, kNotFoundErr, 1, "NXDOMAIN" );
+  test_resolve( "none.test", NULL, kNotFoundErr, 0, "NXDOMAIN cached" );
+  mico_thread_msleep( TEST_SOA_MINIMUM * 1000 + 100 );
+  test_resolve( "none.test", NULL, kNotFoundErr, 1, "NXDOMAIN kept for the SOA minimum" );
+
+  test_resolve( "fail.test", NULL, kResponseErr, 1, "SERVFAIL" );
+  test_resolve( "fail.test", NULL, kResponseErr, 0, "SERVFAIL cached" );
+
+  test_coalesce( );
+  test_lru( );
+  test_persist( context );
+
+  /* Last, the resolver asks the silent server for several seconds */
+  start = mico_get_time( );
+  err = mico_system_dns_resolve( "silent.test", &ip, 500 );
+  test_check( err == kTimeoutErr && mico_get_time( ) - start < 1000, "No answer, caller timeout" );
+  test_check( mico_system_dns_last_known( "silent.test", &ip ) == kNotFoundErr, "No last known address" );
+
+  dns_test_log( "DNS Cache Test %s, %d failures!", failures ? "failed" : "finished", failures );
+  return 0;
+}
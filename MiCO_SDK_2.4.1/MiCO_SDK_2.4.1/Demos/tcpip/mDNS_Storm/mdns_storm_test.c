@@ -0,0 +1,239 @@
+/**
+******************************************************************************
+* @file    mdns_storm_test.c
+* @author  William Xu
+* @version V1.0.0
+* @date    17-Oct-2026
+* @brief   mDNS responder query load test demo based on MiCO !
+******************************************************************************
+*
+*  The MIT License
+*  Copyright (c) 2016 MXCHIP Inc.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy 
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights 
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is furnished
+*  to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in
+*  all copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+*  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR 
+*  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+******************************************************************************
+*/
+
+
+#include "MICO.h"
+
+#define mdns_storm_log(M, ...) custom_log("mDNS Storm", M, ##__VA_ARGS__)
+
+/* Demo Function:
+ * Register STORM_SERVICE_COUNT services and hand crafted queries straight to the mDNS
+ * responder as fast as it takes them, to measure how many queries per second
+ * it answers and how much heap it keeps while doing so. The answers are sent
+ * to the network as usual. */
+
+#define STORM_HOST          "StormHost.local."
+#define STORM_INSTANCE      "Storm Device"
+#define STORM_SERVICE_0     "_storm0._tcp.local."
+#define STORM_SERVICE_COUNT ( 32 )
+#define STORM_TXT           "MAC=c89346918152.Model=MiCOKit-3165.Protocol=com/.mxchip/.basic."
+
+#define TEST_TIME_MS        ( 1000 )
+
+#define STORM_TYPE_A        ( 1 )
+#define STORM_TYPE_PTR      ( 12 )
+
+extern void mdns_handler( int fd, uint8_t* pkt, int pkt_len );
+
+typedef struct
+{
+  const char *name;
+  uint8_t     packet[256];
+  int         len;
+} storm_query_t;
+
+static storm_query_t storm_queries[6];
+
+static uint8_t *storm_write_uint16( uint8_t *p, uint16_t data )
+{
+  *p++ = data >> 8;
+  *p++ = data & 0xFF;
+  return p;
+}
+
+static uint8_t *storm_write_name( uint8_t *p, const char *name )
+{
+  uint8_t *length;
+
+  while( *name ){
+    length = p++;
+    while( *name && *name != '.' )
+      *p++ = *name++;
+    *length = p - length - 1;
+    if( *name == '.' ) name++;
+  }
+  *p++ = 0;
+  return p;
+}
+
+static uint8_t *storm_write_header( uint8_t *p, uint16_t questions, uint16_t answers )
+{
+  memset( p, 0, 12 );
+  storm_write_uint16( p, 0x1234 );
+  storm_write_uint16( p + 4, questions );
+  storm_write_uint16( p + 6, answers );
+  return p + 12;
+}
+
+static uint8_t *storm_write_question( uint8_t *p, const char *name, uint16_t type )
+{
+  p = storm_write_name( p, name );
+  p = storm_write_uint16( p, type );
+  return storm_write_uint16( p, 1 );
+}
+
+static void storm_build_queries( void )
+{
+  storm_query_t *q = storm_queries;
+  uint8_t *p, *rdlength, *rdata;
+
+  q->name = "PTR one service";
+  p = storm_write_header( q->packet, 1, 0 );
+  p = storm_write_question( p, STORM_SERVICE_0, STORM_TYPE_PTR );
+  q->len = p - q->packet;
+  q++;
+
+  q->name = "A host";
+  p = storm_write_header( q->packet, 1, 0 );
+  p = storm_write_question( p, "stormhost.LOCAL.", STORM_TYPE_A );
+  q->len = p - q->packet;
+  q++;
+
+  q->name = "PTR services";
+  p = storm_write_header( q->packet, 1, 0 );
+  p = storm_write_question( p, "_services._dns-sd._udp.local.", STORM_TYPE_PTR );
+  q->len = p - q->packet;
+  q++;
+
+  /* Two services and the host in one query, the later names point back to ".local" */
+  q->name = "PTR x2 + A";
+  p = storm_write_header( q->packet, 3, 0 );
+  p = storm_write_question( p, STORM_SERVICE_0, STORM_TYPE_PTR );
+  *p++ = 7;
+  memcpy( p, "_storm1", 7 );
+  p += 7;
+  *p++ = 4;
+  memcpy( p, "_tcp", 4 );
+  p += 4;
+  p = storm_write_uint16( p, 0xC000 | 25 );
+  p = storm_write_uint16( p, STORM_TYPE_PTR );
+  p = storm_write_uint16( p, 1 );
+  *p++ = 9;
+  memcpy( p, "StormHost", 9 );
+  p += 9;
+  p = storm_write_uint16( p, 0xC000 | 25 );
+  p = storm_write_uint16( p, STORM_TYPE_A );
+  p = storm_write_uint16( p, 1 );
+  q->len = p - q->packet;
+  q++;
+
+  /* The querier already knows the answer */
+  q->name = "PTR known answer";
+  p = storm_write_header( q->packet, 1, 1 );
+  p = storm_write_question( p, STORM_SERVICE_0, STORM_TYPE_PTR );
+  p = storm_write_uint16( p, 0xC000 | 12 );
+  p = storm_write_uint16( p, STORM_TYPE_PTR );
+  p = storm_write_uint16( p, 1 );
+  p = storm_write_uint16( p, 0 );
+  p = storm_write_uint16( p, 1500 );
+  rdlength = p;
+  p += 2;
+  rdata = p;
+  *p++ = strlen( STORM_INSTANCE );
+  memcpy( p, STORM_INSTANCE, strlen( STORM_INSTANCE ) );
+  p += strlen( STORM_INSTANCE );
+  p = storm_write_uint16( p, 0xC000 | 12 );
+  storm_write_uint16( rdlength, p - rdata );
+  q->len = p - q->packet;
+  q++;
+
+  q->name = "PTR not ours";
+  p = storm_write_header( q->packet, 1, 0 );
+  p = storm_write_question( p, "_printer._tcp.local.", STORM_TYPE_PTR );
+  q->len = p - q->packet;
+}
+
+static void mdns_storm_register( int index )
+{
+  mdns_init_t init;
+  char service_name[32];
+
+  sprintf( service_name, "_storm%d._tcp.local.", index );
+  init.service_name = service_name;
+  init.host_name = STORM_HOST;
+  init.instance_name = STORM_INSTANCE;
+  init.txt_record = STORM_TXT;
+  init.service_port = 8080;
+  mdns_add_record( init, Station, 1500 );
+}
+
+static void mdns_storm_run( int fd, storm_query_t *q )
+{
+  uint8_t packet[256];
+  uint32_t start, elapsed, count = 0;
+  int free_memory = MicoGetMemoryInfo()->free_memory;
+
+  start = mico_get_time( );
+  do
+  {
+    /* The packet is copied each time, like a packet that comes from the socket */
+    memcpy( packet, q->packet, q->len );
+    mdns_handler( fd, packet, q->len );
+    count++;
+    elapsed = mico_get_time( ) - start;
+  } while( elapsed < TEST_TIME_MS );
+
+  mdns_storm_log( "%-18s %6d queries/s, heap %d bytes", q->name, (int)( count * 1000 / elapsed ),
+                  MicoGetMemoryInfo()->free_memory - free_memory );
+}
+
+int application_start( void )
+{
+  OSStatus err = kNoErr;
+  int fd, i;
+
+  /* Start MiCO system functions according to mico_config.h */
+  err = mico_system_init( mico_system_context_init( 0 ) );
+  require_noerr( err, exit );
+
+  /* Far more services than the responder used to have room for */
+  for( i = 0; i < STORM_SERVICE_COUNT; i++ )
+    mdns_storm_register( i );
+
+  /* Let the announcements go out first */
+  mico_thread_sleep( 2 );
+
+  fd = socket( AF_INET, SOCK_DGRM, IPPROTO_UDP );
+  require_action( IsValidSocket( fd ), exit, err = kNoResourcesErr );
+
+  storm_build_queries( );
+  mdns_storm_log( "mDNS Storm Test Start" );
+  for( i = 0; i < sizeof(storm_queries) / sizeof(storm_queries[0]); i++ )
+    mdns_storm_run( fd, &storm_queries[i] );
+  mdns_storm_log( "mDNS Storm Test finished!" );
+  close( fd );
+
+exit:
+  if( err != kNoErr )
+    mdns_storm_log("Thread exit with err: %d", err);
+  mico_rtos_delete_thread( NULL );
+  return err;
+}
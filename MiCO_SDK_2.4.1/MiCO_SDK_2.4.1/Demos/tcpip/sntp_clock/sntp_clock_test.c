@@ -0,0 +1,234 @@
+/**
+******************************************************************************
+* @file    sntp_clock_test.c
+* @author  William Xu
+* @version V1.0.0
+* @date    17-Oct-2026
+* @brief   SNTP time service test demo based on MiCO !
+******************************************************************************
+*
+*  The MIT License
+*  Copyright (c) 2016 MXCHIP Inc.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is furnished
+*  to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in
+*  all copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+*  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+*  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+******************************************************************************
+*/
+
+#include "MICO.h"
+#include "sntp.h"
+
+#define sntp_test_log(format, ...)  custom_log("SNTP test", format, ##__VA_ARGS__)
+
+/* Demo Function:
+ * Four NTP server stand-in threads answer on local UDP ports, from a
+ * reference time that starts at TEST_EPOCH. One adds a random delay on the
+ * way to it only, which the client cannot tell from an offset, one has the
+ * same delay both ways, one is 5 s wrong and one never answers. The time
+ * service is started with all four, and the test checks that:
+ * - the clock is set within TEST_MAX_ERROR of the reference time, by the two
+ *   good servers, the wrong one is outvoted;
+ * - the clock is read with ms resolution and never runs backwards;
+ * - the servers are polled again and again, the silent one after longer
+ *   and longer intervals;
+ * - a reference time that jumps ahead is followed by a step, and a small
+ *   jump back by a slew. */
+
+#define TEST_EPOCH          ( 1792195200000LL )   // 2026-10-17 00:00:00 UTC, in ms
+#define TEST_MAX_ERROR      ( 25 )
+#define NTP_UNIX_OFFSET     ( 2208988800U )
+
+typedef struct
+{
+  const char *        name;
+  uint16_t            port;
+  int32_t             offset;     // ms added to the reference time
+  uint32_t            delay;      // ms on the way to the server, and on the way back
+  uint32_t            jitter;     // Up to this many ms more, on the way to the server only
+  bool                silent;
+  volatile uint32_t   queries;
+} test_server_t;
+
+static test_server_t test_servers[] =
+{
+  { "jitter", 10123, 0,    10, 150 },
+  { "steady", 10124, 0,    30, 0 },
+  { "wrong",  10125, 5000, 5,  0 },
+  { "silent", 10126, 0,    0,  0, true },
+};
+
+#define TEST_SERVERS        ( sizeof(test_servers) / sizeof(test_servers[0]) )
+
+static volatile int64_t   test_shift = 0;     // ms the reference time has jumped
+static int                failures = 0;
+
+static int64_t test_reference( void )
+{
+  return TEST_EPOCH + mico_get_time( ) + test_shift;
+}
+
+static uint32_t test_random( uint32_t *seed )
+{
+  *seed = *seed * 1103515245 + 12345;
+  return *seed >> 16;
+}
+
+static void test_write_timestamp( uint8_t *p, int64_t ms )
+{
+  WriteBig32( p, (uint32_t)( ms / 1000 + NTP_UNIX_OFFSET ) );
+  WriteBig32( p + 4, (uint32_t)( ( (uint64_t)( ms % 1000 ) << 32 ) / 1000 ) );
+}
+
+static void test_server_thread( void *arg )
+{
+  test_server_t *server = arg;
+  struct sockaddr_t addr;
+  socklen_t addr_len;
+  uint8_t packet[48];
+  uint32_t seed = server->port;
+  int fd, len;
+
+  fd = socket( AF_INET, SOCK_DGRM, IPPROTO_UDP );
+  addr.s_ip = INADDR_ANY;
+  addr.s_port = server->port;
+  bind( fd, &addr, sizeof(addr) );
+
+  while( 1 ){
+    addr_len = sizeof(addr);
+    len = recvfrom( fd, packet, sizeof(packet), 0, &addr, &addr_len );
+    if( len < 48 ) continue;
+    server->queries++;
+    if( server->silent ) continue;
+
+    mico_thread_msleep( server->delay + ( server->jitter ? test_random( &seed ) % server->jitter : 0 ) );
+    memcpy( &packet[24], &packet[40], 8 );
+    packet[0] = 0x24;       // No leap warning, version 4, server
+    packet[1] = 2;          // Stratum
+    test_write_timestamp( &packet[16], test_reference( ) + server->offset - 1000 );
+    test_write_timestamp( &packet[32], test_reference( ) + server->offset );
+    test_write_timestamp( &packet[40], test_reference( ) + server->offset );
+    mico_thread_msleep( server->delay );
+    sendto( fd, packet, sizeof(packet), 0, &addr, sizeof(addr) );
+  }
+}
+
+static void test_check( bool ok, const char *what )
+{
+  if( !ok ) failures++;
+  sntp_test_log( "%s: %s", ok ? "pass" : "FAIL", what );
+}
+
+/* ms the clock is ahead of the reference time */
+static int32_t test_error( void )
+{
+  struct timeval_t utc;
+
+  if( sntp_time_get( &utc ) != kNoErr ) return 0x7FFFFFFF;
+  return (int32_t)( (int64_t)utc.tv_sec * 1000 + utc.tv_usec / 1000 - test_reference( ) );
+}
+
+/* Reads the clock for a while, returns false if it has run backwards */
+static bool test_monotonic( uint32_t ms, uint32_t *distinct )
+{
+  struct timeval_t utc;
+  int64_t now, last = 0;
+  uint32_t start = mico_get_time( );
+  bool ok = true;
+
+  *distinct = 0;
+  while( mico_get_time( ) - start < ms ){
+    sntp_time_get( &utc );
+    now = (int64_t)utc.tv_sec * 1000 + utc.tv_usec / 1000;
+    if( now < last ) ok = false;
+    if( now != last ) (*distinct)++;
+    last = now;
+    mico_thread_msleep( 0 );
+  }
+  return ok;
+}
+
+static void test_wait_updates( sntp_status_t *status, uint32_t updates, uint32_t timeout )
+{
+  uint32_t start = mico_get_time( );
+
+  do {
+    mico_thread_msleep( 100 );
+    sntp_client_status( status );
+  } while( status->updates < updates && mico_get_time( ) - start < timeout );
+}
+
+int application_start( void )
+{
+  sntp_server_t servers[TEST_SERVERS];
+  sntp_status_t status;
+  struct timeval_t utc;
+  char text[96];
+  uint32_t i, distinct, steps, queries;
+  int32_t error;
+
+  sntp_test_log( "SNTP Clock Test Start" );
+
+  for( i = 0; i < TEST_SERVERS; i++ ){
+    servers[i].hostname = "127.0.0.1";
+    servers[i].port = test_servers[i].port;
+    mico_rtos_create_thread( NULL, MICO_APPLICATION_PRIORITY, "NTP server", test_server_thread, 0x800, &test_servers[i] );
+  }
+
+  test_check( sntp_time_get( &utc ) == kNotPreparedErr, "No time before the first update" );
+
+  /* The stand-ins are on the loopback, no station address is needed */
+  mico_system_ready_set( mico_ready_IP );
+  sntp_client_set_servers( servers, TEST_SERVERS );
+  sntp_client_start( );
+
+  test_check( mico_system_ready_wait( mico_ready_TIME, 10000 ) == kNoErr, "mico_ready_TIME set" );
+  sntp_client_status( &status );
+  error = test_error( );
+  sprintf( text, "Clock set, error %d ms, %d servers used, delay %d ms", (int)error, (int)status.servers_used, (int)status.delay );
+  test_check( error <= TEST_MAX_ERROR && error >= -TEST_MAX_ERROR && status.servers_used == 2 && status.steps == 1, text );
+
+  test_check( test_monotonic( 1000, &distinct ) && distinct >= 900, "Read for 1 s, ms resolution, never backwards" );
+
+  queries = test_servers[0].queries;
+  test_wait_updates( &status, status.updates + 3, 20000 );
+  error = test_error( );
+  sprintf( text, "Polled again, %d updates, poll %d ms, error %d ms", (int)status.updates, (int)status.poll, (int)error );
+  test_check( test_servers[0].queries > queries && status.updates >= 4 && error <= TEST_MAX_ERROR && error >= -TEST_MAX_ERROR, text );
+
+  /* The reference jumps 3 s ahead */
+  steps = status.steps;
+  test_shift += 3000;
+  test_wait_updates( &status, status.updates + 1, 20000 );
+  error = test_error( );
+  sprintf( text, "Reference 3 s ahead, stepped, error %d ms", (int)error );
+  test_check( status.steps == steps + 1 && error <= TEST_MAX_ERROR && error >= -TEST_MAX_ERROR, text );
+
+  /* And 60 ms back, the clock slows down instead */
+  test_shift -= 60;
+  queries = status.updates;
+  test_check( test_monotonic( 10000, &distinct ), "Reference 60 ms back, never backwards while slewed" );
+  sntp_client_status( &status );
+  sprintf( text, "Slewed, offset %d ms, %d steps", (int)status.offset, (int)status.steps );
+  test_check( status.updates > queries && status.steps == steps + 1, text );
+
+  /* Retried after 1, 2, 4 and then every 8 s, SNTP_POLL_MAX */
+  sprintf( text, "Silent server asked %d times, the others %d times", (int)test_servers[3].queries, (int)test_servers[1].queries );
+  test_check( test_servers[3].queries <= 7 && test_servers[1].queries >= 5, text );
+
+  sntp_test_log( "SNTP Clock Test %s, %d failures!", failures ? "failed" : "finished", failures );
+  return 0;
+}
@@ -34,20 +34,8 @@
 
 #define tcp_client_log(M, ...) custom_log("TCP", M, ##__VA_ARGS__)
 
-static char tcp_remote_ip[16] = "192.168.6.239"; /*remote ip address*/
+static char tcp_remote_ip[64] = "192.168.6.239"; /*remote ip address or host name*/
 static int tcp_remote_port = 6000;               /*remote port*/
-static mico_semaphore_t wait_sem = NULL;
-
-static void micoNotify_WifiStatusHandler( WiFiEvent status, void* const inContext )
-{
-  switch ( status ) {
-  case NOTIFY_STATION_UP:
-    mico_rtos_set_semaphore( &wait_sem );
-    break;
-  case NOTIFY_STATION_DOWN:
-    break;
-  }
-}
 
 /*when client connected wlan success,create socket*/
 void tcp_client_thread( void *arg )
@@ -64,10 +52,13 @@ void tcp_client_thread( void *arg )
   buf = (char*)malloc( 1024 );
   require_action( buf, exit, err = kNoMemoryErr );
   
+  /* An address is returned at once, a host name is looked up once and then taken from the DNS cache */
+  err = mico_system_dns_resolve( tcp_remote_ip, &addr.s_ip, 10000 );
+  require_noerr( err, exit );
+  
   tcp_fd = socket( AF_INET, SOCK_STREAM, IPPROTO_TCP );
   require_action(IsValidSocket( tcp_fd ), exit, err = kNoResourcesErr );
   
-  addr.s_ip = inet_addr( tcp_remote_ip );
   addr.s_port = tcp_remote_port;
   
   tcp_client_log( "Connecting to server: ip=%s  port=%d!", tcp_remote_ip,tcp_remote_port );
@@ -113,18 +104,12 @@ int application_start( void )
 {
   OSStatus err = kNoErr;
   
-  mico_rtos_init_semaphore( &wait_sem,1 );
-  
-  /*Register user function for MiCO nitification: WiFi status changed */
-  err = mico_system_notify_register( mico_notify_WIFI_STATUS_CHANGED, (void *)micoNotify_WifiStatusHandler, NULL );
-  require_noerr( err, exit ); 
-  
   /* Start MiCO system functions according to mico_config.h */
   err = mico_system_init( mico_system_context_init( 0 ) );
   require_noerr( err, exit );
   
-  /* Wait for wlan connection*/
-  mico_rtos_get_semaphore( &wait_sem, MICO_WAIT_FOREVER );
+  /* Wait for wlan connection and an IP address */
+  mico_system_ready_wait( mico_ready_IP, MICO_WAIT_FOREVER );
   tcp_client_log( "wifi connected successful" );
   
   /* Start TCP client thread */
@@ -132,8 +117,6 @@ int application_start( void )
   require_noerr_string( err, exit, "ERROR: Unable to start the tcp client thread." );
   
 exit:
-  if( wait_sem != NULL)
-    mico_rtos_deinit_semaphore( &wait_sem );
   mico_rtos_delete_thread( NULL );
   return err;
 }
@@ -37,10 +37,15 @@ SOFTWARE.
 */
 
 #include "WeiXinAuth.h"
+#include "HTTPClientUtils.h"
 
 
 
 #define WeiXinAuth_log(M, ...) custom_log("WeiXinAuth", M, ##__VA_ARGS__)
+
+#define WEIXIN_TOKEN_SIZE         200
+#define WEIXIN_DEVICEID_SIZE      50
+#define WEIXIN_DEVICELICENCE_SIZE 300
      
  //data struct
 typedef struct _http_response_data{
@@ -66,7 +71,7 @@ int start_weixin_auth(void);//
 void weixin_https_client_thread(void *arg);
 void weixin_https_request();//ִ3request
 void updatetoken2NVRAM(char *token);
-void weixin_formatMACAddr(char *destAddr, char *srcAddr);
+static void weixin_formatMACAddr(char *destAddr, char *srcAddr);
 int checkNVRAM(char *token,char *deviceid,char *devicelicence);
 
 
@@ -106,51 +111,24 @@ void weixin_https_client_thread(void *arg)
 void weixin_https_request()
 {
   OSStatus err=kNoErr;
-  int client_fd = -1;
-  int ssl_errno = 0;
-  mico_ssl_t client_ssl = NULL;
-  fd_set readfds;
-  char ipstr[16];
-  struct sockaddr_t addr;
+  HTTPClientConnection_t client;
   HTTPHeader_t *httpHeader = NULL;
   char format_query[800]={0};//Сڴй©
-  char weixinapi_token[200]={0};
-  char deviceid[50]={0};
-  char devicelicence[300]={0};
+  char weixinapi_token[WEIXIN_TOKEN_SIZE]={0};
+  char deviceid[WEIXIN_DEVICEID_SIZE]={0};
+  char devicelicence[WEIXIN_DEVICELICENCE_SIZE]={0};
   int seq=WX_GETTOKEN;
   
-  //DNSipַ
-  while(1){
-    err = gethostbyname(WEIXIN_IOT_HOST, (uint8_t *)ipstr, 16);//пܻҪν
-    WeiXinAuth_log( "gethostbyname" );
-    sleep(1);
-    if(err==kNoErr)  break;
-  }
-  
-ssl_retry:
-  //HTTPHeaderCreateWithCallback set some callback functionsһַȥ 
+  /* All requests go one after another over one kept TLS connection, the host
+     address is looked up once. A failed request is sent again on a new
+     connection after a growing delay, see HTTPClientConnectionRequest */
+  HTTPClientConnectionInit( &client, WEIXIN_IOT_HOST, 443, true );
   httpHeader = HTTPHeaderCreateWithCallback( 1024, onReceivedData, onClearData, &g_response );
   require_action( httpHeader, exit, err = kNoMemoryErr );
   
-  client_fd = socket( AF_INET, SOCK_STREAM, IPPROTO_TCP );
-  addr.s_ip = inet_addr( ipstr );
-  addr.s_port = 443;//https˿
-  err = connect( client_fd, &addr, sizeof(addr) ); 
-  require_noerr_string( err, exit, "connect https server failed" );
-  
-  ssl_version_set(TLS_V1_2_MODE);//΢sslЭ汾
-  client_ssl = ssl_connect( client_fd, 0, NULL, &ssl_errno );
-  require_string( client_ssl != NULL, exit, "ERROR: ssl disconnect" );
-  FD_ZERO( &readfds );
-  FD_SET( client_fd, &readfds );
-  
-  WeiXinAuth_log( "ssl_connect successfully" );
-  seq=WX_GETTOKEN;
-  while(1)//Ҫ˳
+  while(seq != WX_EXIT)
   {
-    HTTPHeaderClear( httpHeader );//
-    memset(format_query,0,sizeof(format_query));//
-    sleep(2);//ȴͷ
+    memset(format_query,0,sizeof(format_query));
     if(seq == WX_GETTOKEN)
     {
       sprintf(format_query,WEIXIN_IOT_GETTOKEN_REQUEST,WEIXIN_appid,WEIXIN_secret);
@@ -176,53 +154,22 @@ ssl_retry:
           WeiXinAuth_log("WX_GETAUTH format_query=%s",format_query);
 	      free(postdata);
     }
-    else if(seq == WX_EXIT )
-    {
-      WeiXinAuth_log("wx_exit now");
-      goto exit;	
-    }
-    //443˿ڷHTTP Request 
-    ssl_send( client_ssl, format_query, strlen(format_query) );
-    select( client_fd + 1, &readfds, NULL, NULL, NULL );//ȵķʽ
-    WeiXinAuth_log("waiting..........");
-    if( FD_ISSET( client_fd, &readfds ) ){
-      err = SocketReadHTTPSHeader( client_ssl, httpHeader );
-      switch ( err ){
-      case kNoErr:
-        PrintHTTPHeader( httpHeader );
-        err = SocketReadHTTPSBody( client_ssl, httpHeader );//get body data
-        require_noerr( err, exit );
-        //get data and print
-        parseJSONData(g_response.content,seq,weixinapi_token,deviceid,devicelicence);
-        seq++;
-        break;
-      case EWOULDBLOCK:
-      case kNoSpaceErr:
-      case kConnectionErr:
-      default:
-          WeiXinAuth_log("ERROR: HTTP Header parse error: %d", err);
-          if( client_ssl ){
-               ssl_close( client_ssl );
-               client_ssl=NULL;
-          }
-          SocketClose( &client_fd );
-          client_fd=-1;
-          HTTPHeaderDestory( &httpHeader );
-          WeiXinAuth_log("retry after 2s......");
-          sleep(2);// retry after 2s
-          goto ssl_retry;
-      }
+    
+    err = HTTPClientConnectionRequest( &client, format_query, strlen(format_query), httpHeader );
+    if( err != kNoErr ){
+      WeiXinAuth_log("ERROR: request %d failed, err = %d", seq, err);
+      continue;
     }
+    PrintHTTPHeader( httpHeader );
+    parseJSONData(g_response.content,seq,weixinapi_token,deviceid,devicelicence);
+    seq++;
   }
+  WeiXinAuth_log("wx_exit now");
+  
 exit:
-  WeiXinAuth_log( "Exit: Client exit with err = %d, fd:%d", err, client_fd );
-  if( client_ssl )  ssl_close( client_ssl );
-  SocketClose( &client_fd );
+  WeiXinAuth_log( "Exit: Client exit with err = %d, %d requests on last connection", err, client.requestCount );
+  HTTPClientConnectionClose( &client );
   HTTPHeaderDestory( &httpHeader );
-  if(err!=kNoErr)
-  {
-    goto ssl_retry;//ȷɹ
-  }
 }
 //D0:BA:E4:07:61:D4
 //skip :
@@ -272,30 +219,26 @@ int checkNVRAM(char *token,char *deviceid,char *devicelicence)
 
 char *parseJSONData(char *jsondata,int num,char *token,char *deviceid,char *devicelicence)
 {
+  //only the fields needed are picked from the text, no json object is built
+  struct json_path_slot token_slots[] = {
+    JSON_PATH_SLOT_STRING("access_token", token, WEIXIN_TOKEN_SIZE),
+  };
+  struct json_path_slot qrcode_slots[] = {
+    JSON_PATH_SLOT_STRING("deviceid", deviceid, WEIXIN_DEVICEID_SIZE),
+    JSON_PATH_SLOT_STRING("devicelicence", devicelicence, WEIXIN_DEVICELICENCE_SIZE),
+  };
+  
   if(jsondata==NULL) return NULL;
   WeiXinAuth_log( "parseJSONData=%s",jsondata );
-  json_object *object= json_tokener_parse(jsondata);//ַת
   
   if(num==WX_GETTOKEN)
   {
-    json_object_object_foreach(object, key, val) {
-      if(!strcmp(key, "access_token")){
-        strcpy(token,json_object_get_string(val));
-        break;
-      }
-    }
+    json_path_extract(jsondata, token_slots, 1);
      updatetoken2NVRAM(token);
   }
   else if(num == WX_GETRQCODE)
   {
-    json_object_object_foreach(object, key, val) {
-      if(!strcmp(key, "deviceid")){
-        strcpy(deviceid,json_object_get_string(val));
-      }
-      if(!strcmp(key, "devicelicence")){
-        strcpy(devicelicence,json_object_get_string(val));
-      }
-    }
+    json_path_extract(jsondata, qrcode_slots, 2);
     
     updateQRCode2NVRAM(deviceid,devicelicence);
     WeiXinAuth_log("store deviceid=%s",deviceid);
@@ -306,9 +249,6 @@ char *parseJSONData(char *jsondata,int num,char *token,char *deviceid,char *devi
   	//nothing to do
   }
   
-  //parse finished,free memory
-  json_object_put(object);//free memory 
-  object=NULL;
   return NULL;
 }
 
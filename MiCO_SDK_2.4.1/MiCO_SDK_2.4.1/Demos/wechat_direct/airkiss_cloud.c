@@ -53,47 +53,38 @@ void ReceiveResponseCB(uint32_t taskid, uint32_t errcode, uint32_t funcid, const
 //֪ͨ΢Ϣ
 void ReceiveNotifyCB(uint32_t funcid, const uint8_t* body, uint32_t bodylen) {
   
-  json_object *recv_json_object = NULL;
-  json_object *item_obj = NULL;
-  json_object *item_obj_msg_id = NULL;
-  json_object *item_obj_msg_type = NULL;
+  // only the fields below are picked from the text, no json object is built
+  struct json_path_slot recv_slots[] = {
+    JSON_PATH_SLOT_INT("msg_id"),
+    JSON_PATH_SLOT_STRING("msg_type", (char*)g_recv_msg_type, sizeof(g_recv_msg_type)),
+    JSON_PATH_SLOT_BOOLEAN("services.outlet"),        // only tells whether it is there
+    JSON_PATH_SLOT_BOOLEAN("services.outlet.port_on_off[0]"),
+  };
   
   g_funcid = funcid;
-  //ַתjson
   airkiss_cloud_log("recv body:%s",body);
-  recv_json_object = json_tokener_parse((const char*)body);
+  memset(g_recv_msg_type, 0, sizeof(g_recv_msg_type));
   
-  if (NULL != recv_json_object){
+  if (json_path_extract((const char*)body, recv_slots, 4) >= 0){
     // get msg_id for ack
-    item_obj_msg_id = json_object_object_get(recv_json_object, "msg_id");
-    g_recv_msg_id = json_object_get_int64(item_obj_msg_id); 
+    g_recv_msg_id = recv_slots[0].c_int64; 
     airkiss_cloud_log("get msg id: %lld.", g_recv_msg_id);
     
     // get msg type,eg:"set"
-    item_obj_msg_type = json_object_object_get(recv_json_object, "msg_type");
-    memset(g_recv_msg_type, 0, sizeof(g_recv_msg_type));
-    strncpy((char*)g_recv_msg_type, json_object_get_string(item_obj_msg_type),8); // get msg_type for ack
     airkiss_cloud_log("get msg type: %s.", g_recv_msg_type);
     
     //get switch,˴ǶͱȽϸ
-    item_obj = json_object_object_get(recv_json_object, "services");
-    if(NULL != item_obj){
-      item_obj = json_object_object_get(item_obj, "outlet");
-      if(NULL != item_obj){
-        g_app_context->appConfig->power_switch = 
-          json_object_get_boolean(json_object_array_get_idx(json_object_object_get(item_obj, "port_on_off"),0));
-        
-        if(g_app_context->appConfig->power_switch){
-          hsb2rgb_led_open(120, 100, 50);//ɫ
-        }
-        else{
-          hsb2rgb_led_close();//ص
-        }
-        mico_rtos_set_semaphore( &g_msg_send_sem);//ackӦ֪ͨ壬֪״̬
+    if(recv_slots[2].found_type == json_type_object){
+      g_app_context->appConfig->power_switch = recv_slots[3].c_boolean;
+      
+      if(g_app_context->appConfig->power_switch){
+        hsb2rgb_led_open(120, 100, 50);//ɫ
+      }
+      else{
+        hsb2rgb_led_close();//ص
       }
+      mico_rtos_set_semaphore( &g_msg_send_sem);//ackӦ֪ͨ壬֪״̬
     }
-    // free memory of json object
-    json_object_put(recv_json_object);
   }
 }
 //֪֪ͨ豸¼״̬
@@ -117,21 +108,60 @@ void ReceiveEventCB(EventValue event_value) {
 extern ak_mutex_t m_task_mutex;
 extern ak_mutex_t m_malloc_mutex;//define in airkiss_porting_4004.c
 
+/* Reply to the last message with the current outlet status, returns its length or -1 */
+static int airkiss_status_report_build( char *buf, int size )
+{
+  struct json_writer w;
+
+  json_writer_init( &w, buf, size, NULL, NULL );
+  json_writer_begin_object( &w );
+  json_writer_key( &w, "asy_error_code" );
+  json_writer_int( &w, 0 );
+  json_writer_key( &w, "asy_error_msg" );
+  json_writer_string( &w, "ok" );
+  json_writer_key( &w, "msg_id" );
+  json_writer_int( &w, g_recv_msg_id );
+  json_writer_key( &w, "msg_type" );
+  json_writer_string( &w, (const char *)g_recv_msg_type );
+  json_writer_key( &w, "services" );
+  json_writer_begin_object( &w );
+    json_writer_key( &w, "operation_status" );
+    json_writer_begin_object( &w );
+    json_writer_key( &w, "status" );
+    json_writer_int( &w, 0 );
+    json_writer_end_object( &w );
+    json_writer_key( &w, "outlet" );
+    json_writer_begin_object( &w );
+    json_writer_key( &w, "port_on_off" );
+    json_writer_begin_array( &w );
+    json_writer_boolean( &w, g_app_context->appConfig->power_switch );
+    json_writer_boolean( &w, false );
+    json_writer_end_array( &w );
+    json_writer_key( &w, "port_in_use" );
+    json_writer_begin_array( &w );
+    json_writer_boolean( &w, true );
+    json_writer_boolean( &w, false );
+    json_writer_end_array( &w );
+    json_writer_end_object( &w );
+  json_writer_end_object( &w );
+  json_writer_end_object( &w );
+  return json_writer_finish( &w );
+}
+
 void airkiss_status_report_thread(void *arg) {
         uint32_t taskid = 0;
+        int len;
 #ifdef AIRKISS_SUPPORT_MULTITHREAD
 	for (;;) {
                 mico_rtos_get_semaphore( &g_msg_send_sem, MICO_WAIT_FOREVER );
                 airkiss_cloud_log( "set ok, ack && report current status." );
-                memset(m_statusCBmsg, 0, sizeof(m_statusCBmsg));
-                if(g_app_context->appConfig->power_switch){
-                  sprintf((char*)m_statusCBmsg, "{\"asy_error_code\": 0,\"asy_error_msg\": \"ok\",\"msg_id\":%lld,\"msg_type\":\"%s\",\"services\":{\"operation_status\":{\"status\":0},\"outlet\":{\"port_on_off\":[true,false],\"port_in_use\":[true,false]}}}", g_recv_msg_id, g_recv_msg_type);
-                }
-                else{
-                  sprintf((char*)m_statusCBmsg, "{\"asy_error_code\": 0,\"asy_error_msg\": \"ok\",\"msg_id\":%lld,\"msg_type\":\"%s\",\"services\":{\"operation_status\":{\"status\":0},\"outlet\":{\"port_on_off\":[false,false],\"port_in_use\":[true,false]}}}", g_recv_msg_id, g_recv_msg_type);
+                len = airkiss_status_report_build( (char *)m_statusCBmsg, sizeof(m_statusCBmsg) );
+                if( len < 0 ){
+                  airkiss_cloud_log("status msg does not fit");
+                  continue;
                 }
                 airkiss_cloud_log("send status msg: %s", m_statusCBmsg);
-		taskid = airkiss_cloud_sendmessage(g_funcid, (uint8_t *)m_statusCBmsg, strlen((const char *)m_statusCBmsg));
+		taskid = airkiss_cloud_sendmessage(g_funcid, (uint8_t *)m_statusCBmsg, len);
 	}
 #else
 	taskid = airkiss_cloud_sendmessage(g_funcid, (uint8_t *)m_statusCBmsg, strlen((const char *)m_statusCBmsg));
@@ -172,6 +202,7 @@ void task_execute_sdk_runloop() {
     //ϢƣiOS runloop
     uint32_t sleep_time;
 	airkiss_cloud_log("Everything is ready!!");
+	mico_system_boot_trace_mark( "wechat cloud ready" );
 	for (;;) {
 		sleep_time = airkiss_cloud_loop();
 		mico_thread_msleep(sleep_time);
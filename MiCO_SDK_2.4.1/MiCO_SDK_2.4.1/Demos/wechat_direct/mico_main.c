@@ -33,7 +33,6 @@
 
 app_context_t* g_app_context = NULL;
 mico_Context_t* g_mico_context = NULL;
-void check_linkstatus(void);//·
 
 /****************************************************************************/
 /* MICO system callback: Restore default configuration provided by application */
@@ -82,12 +81,14 @@ OSStatus application_start( void *arg )
   ûҪֻ豸*/
   /* Wait for wlan connection*/
   /* ·״̬*/
-  check_linkstatus();
+  mico_system_ready_wait( mico_ready_IP | mico_ready_DNS, MICO_NEVER_TIMEOUT );
   mico_main_log( "wifi connected successful" );
 
+  mico_system_boot_trace_begin( "weixin auth" );
   start_weixin_auth();//΢֤̣ȡdeviceiddevicelicense
   mico_rtos_get_semaphore(&g_app_context->appConfig->weixin_auth_sem,MICO_NEVER_TIMEOUT);
   
+  mico_system_boot_trace_end( "weixin auth" );
   mico_main_log( "deviceid and devicelicense is ready.............." );
   /* start wechat direct connection */
   ret = wechat_direct_connect();
@@ -98,19 +99,3 @@ exit:
   return err;
 }
 
-
-
-void check_linkstatus(void)
-{
-  int i=0;
-  do
-  {
-    LinkStatusTypeDef link_status={0};
-    micoWlanGetLinkStatus(&link_status);
-    msleep(1000);
-    i++;
-    //Ƿɹ
-    if (link_status.is_connected == 1 && i > 3)
-      break;
-  }while(1);
-}
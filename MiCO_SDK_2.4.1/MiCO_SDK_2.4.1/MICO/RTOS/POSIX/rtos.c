@@ -0,0 +1,918 @@
+/**
+******************************************************************************
+* @file    rtos.c
+* @author  William Xu
+* @version V1.0.0
+* @date    17-Oct-2026
+* @brief   Definitions of the MiCO RTOS abstraction layer on POSIX threads,
+*          used to run MiCO applications on a Linux host.
+******************************************************************************
+*
+*  The MIT License
+*  Copyright (c) 2016 MXCHIP Inc.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is furnished
+*  to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in
+*  all copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+*  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+*  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+******************************************************************************
+*/
+
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+
+#include "Common.h"
+#include "rtos.h"
+
+/******************************************************
+ *                      Macros
+ ******************************************************/
+
+/******************************************************
+ *                    Constants
+ ******************************************************/
+
+#define POSIX_OBJ_SEMAPHORE     (0x53454D41)    /* 'SEMA' */
+#define POSIX_OBJ_QUEUE         (0x51554555)    /* 'QUEU' */
+#define POSIX_OBJ_MUTEX         (0x4D555458)    /* 'MUTX' */
+
+/******************************************************
+ *                   Enumerations
+ ******************************************************/
+
+/******************************************************
+ *                 Type Definitions
+ ******************************************************/
+
+/* Common head of every object that can be turned into an event fd */
+typedef struct
+{
+    uint32_t        type;
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    int             event_rd;
+    int             event_wr;
+} posix_event_t;
+
+typedef struct
+{
+    posix_event_t   event;
+    uint32_t        count;
+    uint32_t        max_count;
+} posix_semaphore_t;
+
+typedef struct
+{
+    posix_event_t   event;
+    uint32_t        message_size;
+    uint32_t        length;
+    uint32_t        head;
+    uint32_t        count;
+    uint8_t*        buffer;
+} posix_queue_t;
+
+typedef struct
+{
+    uint32_t        type;
+    pthread_mutex_t lock;
+} posix_mutex_t;
+
+typedef struct
+{
+    pthread_t              handle;
+    mico_thread_function_t function;
+    void*                  arg;
+    char                   name[16];
+    bool                   detached;
+    bool                   finished;
+    pthread_mutex_t        lock;
+    pthread_cond_t         cond;
+} posix_thread_t;
+
+typedef struct _posix_timer_t
+{
+    struct _posix_timer_t* next;
+    uint32_t               period;
+    uint32_t               deadline;
+    bool                   running;
+    bool                   one_shot;
+    timer_handler_t        function;
+    void*                  arg;
+    void                   (*legacy_function)( void );
+} posix_timer_t;
+
+/******************************************************
+ *               Function Declarations
+ ******************************************************/
+
+static void* posix_thread_main( void* arg );
+static void* posix_timer_thread( void* arg );
+
+/******************************************************
+ *               Variables Definitions
+ ******************************************************/
+
+static __thread posix_thread_t* current_thread = NULL;
+
+static pthread_mutex_t  suspend_all_mutex;
+static pthread_once_t   rtos_once = PTHREAD_ONCE_INIT;
+static struct timespec  rtos_start_time;
+
+static pthread_mutex_t  timer_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   timer_cond;
+static posix_timer_t*   timer_list = NULL;
+static bool             timer_thread_started = false;
+
+/******************************************************
+ *               Function Definitions
+ ******************************************************/
+
+static void posix_rtos_init( void )
+{
+    pthread_mutexattr_t mattr;
+    pthread_condattr_t cattr;
+
+    clock_gettime( CLOCK_MONOTONIC, &rtos_start_time );
+
+    pthread_mutexattr_init( &mattr );
+    pthread_mutexattr_settype( &mattr, PTHREAD_MUTEX_RECURSIVE );
+    pthread_mutex_init( &suspend_all_mutex, &mattr );
+    pthread_mutexattr_destroy( &mattr );
+
+    pthread_condattr_init( &cattr );
+    pthread_condattr_setclock( &cattr, CLOCK_MONOTONIC );
+    pthread_cond_init( &timer_cond, &cattr );
+    pthread_condattr_destroy( &cattr );
+}
+
+static void posix_cond_init( pthread_cond_t* cond )
+{
+    pthread_condattr_t cattr;
+
+    pthread_condattr_init( &cattr );
+    pthread_condattr_setclock( &cattr, CLOCK_MONOTONIC );
+    pthread_cond_init( cond, &cattr );
+    pthread_condattr_destroy( &cattr );
+}
+
+static void posix_deadline( struct timespec* ts, uint32_t timeout_ms )
+{
+    clock_gettime( CLOCK_MONOTONIC, ts );
+    ts->tv_sec  += timeout_ms / 1000;
+    ts->tv_nsec += (long)( timeout_ms % 1000 ) * 1000000L;
+    if ( ts->tv_nsec >= 1000000000L )
+    {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+/* Wait on the object condition with its lock held, honouring MiCO timeouts */
+static OSStatus posix_event_wait( posix_event_t* event, const struct timespec* deadline, uint32_t timeout_ms )
+{
+    int ret;
+
+    if ( timeout_ms == MICO_NO_WAIT )
+        return kTimeoutErr;
+
+    if ( timeout_ms == MICO_WAIT_FOREVER )
+    {
+        pthread_cond_wait( &event->cond, &event->lock );
+        return kNoErr;
+    }
+
+    ret = pthread_cond_timedwait( &event->cond, &event->lock, deadline );
+    return ( ret == ETIMEDOUT ) ? kTimeoutErr : kNoErr;
+}
+
+static void posix_event_init( posix_event_t* event, uint32_t type )
+{
+    event->type = type;
+    event->event_rd = -1;
+    event->event_wr = -1;
+    pthread_mutex_init( &event->lock, NULL );
+    posix_cond_init( &event->cond );
+}
+
+static void posix_event_deinit( posix_event_t* event )
+{
+    event->type = 0;
+    pthread_cond_destroy( &event->cond );
+    pthread_mutex_destroy( &event->lock );
+}
+
+OSStatus posix_rtos_event_attach( mico_event handle, int read_fd, int write_fd )
+{
+    posix_event_t* event = (posix_event_t*) handle;
+    uint32_t pending = 0;
+
+    if ( event == NULL )
+        return kParamErr;
+    if ( event->type != POSIX_OBJ_SEMAPHORE && event->type != POSIX_OBJ_QUEUE )
+        return kTypeErr;
+
+    pthread_mutex_lock( &event->lock );
+    event->event_rd = read_fd;
+    event->event_wr = write_fd;
+    if ( event->type == POSIX_OBJ_SEMAPHORE )
+        pending = ( (posix_semaphore_t*) event )->count;
+    else
+        pending = ( (posix_queue_t*) event )->count;
+    if ( write_fd >= 0 )
+    {
+        while ( pending-- )
+            host_sys_signal_byte( write_fd );
+    }
+    pthread_mutex_unlock( &event->lock );
+    return kNoErr;
+}
+
+/******************************************************
+ *                      Threads
+ ******************************************************/
+
+OSStatus mico_rtos_create_thread( mico_thread_t* thread, uint8_t priority, const char* name, mico_thread_function_t function, uint32_t stack_size, void* arg )
+{
+    posix_thread_t* posix_thread;
+    pthread_attr_t attr;
+    OSStatus err = kNoErr;
+
+    UNUSED_PARAMETER( priority );
+    pthread_once( &rtos_once, posix_rtos_init );
+
+    posix_thread = calloc( 1, sizeof(posix_thread_t) );
+    if ( posix_thread == NULL )
+        return kNoMemoryErr;
+
+    posix_thread->function = function;
+    posix_thread->arg = arg;
+    posix_thread->detached = ( thread == NULL );
+    if ( name != NULL )
+        strncpy( posix_thread->name, name, sizeof(posix_thread->name) - 1 );
+    pthread_mutex_init( &posix_thread->lock, NULL );
+    pthread_cond_init( &posix_thread->cond, NULL );
+
+    if ( stack_size < POSIX_RTOS_MIN_STACK_SIZE )
+        stack_size = POSIX_RTOS_MIN_STACK_SIZE;
+
+    pthread_attr_init( &attr );
+    pthread_attr_setstacksize( &attr, stack_size );
+    pthread_attr_setdetachstate( &attr, PTHREAD_CREATE_DETACHED );
+
+    if ( thread != NULL )
+        *thread = posix_thread;
+
+    if ( pthread_create( &posix_thread->handle, &attr, posix_thread_main, posix_thread ) != 0 )
+    {
+        if ( thread != NULL )
+            *thread = NULL;
+        pthread_mutex_destroy( &posix_thread->lock );
+        pthread_cond_destroy( &posix_thread->cond );
+        free( posix_thread );
+        err = kGeneralErr;
+    }
+    pthread_attr_destroy( &attr );
+    return err;
+}
+
+static void posix_thread_finish( void* arg )
+{
+    posix_thread_t* posix_thread = (posix_thread_t*) arg;
+
+    pthread_mutex_lock( &posix_thread->lock );
+    posix_thread->finished = true;
+    pthread_cond_broadcast( &posix_thread->cond );
+    pthread_mutex_unlock( &posix_thread->lock );
+
+    /* Nobody holds a handle to a thread created without one, so it can go
+     * now. Handles returned to the caller stay valid for join/compare. */
+    if ( posix_thread->detached )
+    {
+        pthread_mutex_destroy( &posix_thread->lock );
+        pthread_cond_destroy( &posix_thread->cond );
+        free( posix_thread );
+    }
+}
+
+static void* posix_thread_main( void* arg )
+{
+    posix_thread_t* posix_thread = (posix_thread_t*) arg;
+
+    current_thread = posix_thread;
+    pthread_cleanup_push( posix_thread_finish, posix_thread );
+    posix_thread->function( posix_thread->arg );
+    pthread_cleanup_pop( 1 );
+    return NULL;
+}
+
+OSStatus mico_rtos_delete_thread( mico_thread_t* thread )
+{
+    posix_thread_t* posix_thread;
+
+    if ( thread == NULL || *thread == NULL || *thread == current_thread )
+    {
+        pthread_exit( NULL );
+    }
+
+    posix_thread = (posix_thread_t*) *thread;
+    pthread_cancel( posix_thread->handle );
+    return kNoErr;
+}
+
+/* There is no resume, so a thread that suspends itself never runs again.
+ * pthreads can not stop another thread from outside, that one keeps going. */
+void mico_rtos_suspend_thread( mico_thread_t* thread )
+{
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t  never = PTHREAD_COND_INITIALIZER;
+
+    if ( thread == NULL || *thread == NULL || *thread == current_thread )
+    {
+        pthread_mutex_lock( &lock );
+        while ( 1 )
+        {
+            pthread_cond_wait( &never, &lock );
+        }
+    }
+}
+
+void vTaskSuspendAll( void )
+{
+    pthread_once( &rtos_once, posix_rtos_init );
+    pthread_mutex_lock( &suspend_all_mutex );
+}
+
+long xTaskResumeAll( void )
+{
+    pthread_mutex_unlock( &suspend_all_mutex );
+    return 0;
+}
+
+OSStatus mico_rtos_thread_join( mico_thread_t* thread )
+{
+    posix_thread_t* posix_thread;
+
+    if ( thread == NULL || *thread == NULL )
+        return kParamErr;
+
+    posix_thread = (posix_thread_t*) *thread;
+    pthread_mutex_lock( &posix_thread->lock );
+    while ( !posix_thread->finished )
+        pthread_cond_wait( &posix_thread->cond, &posix_thread->lock );
+    pthread_mutex_unlock( &posix_thread->lock );
+    return kNoErr;
+}
+
+OSStatus mico_rtos_thread_force_awake( mico_thread_t* thread )
+{
+    UNUSED_PARAMETER( thread );
+    return kUnsupportedErr;
+}
+
+bool mico_rtos_is_current_thread( mico_thread_t* thread )
+{
+    if ( thread == NULL )
+        return false;
+    return ( *thread == current_thread );
+}
+
+void msleep( uint32_t milliseconds )
+{
+    struct timespec ts;
+
+    ts.tv_sec = milliseconds / 1000;
+    ts.tv_nsec = (long)( milliseconds % 1000 ) * 1000000L;
+    while ( nanosleep( &ts, &ts ) != 0 && errno == EINTR );
+}
+
+/******************************************************
+ *                     Semaphores
+ ******************************************************/
+
+OSStatus mico_rtos_init_semaphore( mico_semaphore_t* semaphore, int count )
+{
+    posix_semaphore_t* posix_semaphore;
+
+    if ( semaphore == NULL )
+        return kParamErr;
+    posix_semaphore = calloc( 1, sizeof(posix_semaphore_t) );
+    if ( posix_semaphore == NULL )
+        return kNoMemoryErr;
+
+    posix_event_init( &posix_semaphore->event, POSIX_OBJ_SEMAPHORE );
+    posix_semaphore->max_count = ( count > 0 ) ? (uint32_t) count : 1;
+    *semaphore = posix_semaphore;
+    return kNoErr;
+}
+
+OSStatus mico_rtos_set_semaphore( mico_semaphore_t* semaphore )
+{
+    posix_semaphore_t* posix_semaphore;
+    OSStatus err = kNoErr;
+
+    if ( semaphore == NULL || *semaphore == NULL )
+        return kNotInitializedErr;
+    posix_semaphore = (posix_semaphore_t*) *semaphore;
+
+    pthread_mutex_lock( &posix_semaphore->event.lock );
+    if ( posix_semaphore->count < posix_semaphore->max_count )
+    {
+        posix_semaphore->count++;
+        if ( posix_semaphore->event.event_wr >= 0 )
+            host_sys_signal_byte( posix_semaphore->event.event_wr );
+        pthread_cond_signal( &posix_semaphore->event.cond );
+    }
+    else
+    {
+        err = kOverrunErr;
+    }
+    pthread_mutex_unlock( &posix_semaphore->event.lock );
+    return err;
+}
+
+OSStatus mico_rtos_get_semaphore( mico_semaphore_t* semaphore, uint32_t timeout_ms )
+{
+    posix_semaphore_t* posix_semaphore;
+    struct timespec deadline;
+    OSStatus err = kNoErr;
+
+    if ( semaphore == NULL || *semaphore == NULL )
+        return kNotInitializedErr;
+    posix_semaphore = (posix_semaphore_t*) *semaphore;
+
+    posix_deadline( &deadline, timeout_ms );
+    pthread_mutex_lock( &posix_semaphore->event.lock );
+    while ( posix_semaphore->count == 0 )
+    {
+        err = posix_event_wait( &posix_semaphore->event, &deadline, timeout_ms );
+        if ( err != kNoErr && posix_semaphore->count == 0 )
+            goto exit;
+    }
+    err = kNoErr;
+    posix_semaphore->count--;
+    if ( posix_semaphore->event.event_rd >= 0 )
+        host_sys_consume_byte( posix_semaphore->event.event_rd );
+
+exit:
+    pthread_mutex_unlock( &posix_semaphore->event.lock );
+    return err;
+}
+
+OSStatus mico_rtos_deinit_semaphore( mico_semaphore_t* semaphore )
+{
+    posix_semaphore_t* posix_semaphore;
+
+    if ( semaphore == NULL || *semaphore == NULL )
+        return kNotInitializedErr;
+    posix_semaphore = (posix_semaphore_t*) *semaphore;
+
+    posix_event_deinit( &posix_semaphore->event );
+    free( posix_semaphore );
+    *semaphore = NULL;
+    return kNoErr;
+}
+
+/******************************************************
+ *                       Mutexes
+ ******************************************************/
+
+OSStatus mico_rtos_init_mutex( mico_mutex_t* mutex )
+{
+    posix_mutex_t* posix_mutex;
+    pthread_mutexattr_t attr;
+
+    if ( mutex == NULL )
+        return kParamErr;
+    posix_mutex = calloc( 1, sizeof(posix_mutex_t) );
+    if ( posix_mutex == NULL )
+        return kNoMemoryErr;
+
+    /* FreeRTOS builds of MiCO hand out recursive mutexes */
+    pthread_mutexattr_init( &attr );
+    pthread_mutexattr_settype( &attr, PTHREAD_MUTEX_RECURSIVE );
+    pthread_mutex_init( &posix_mutex->lock, &attr );
+    pthread_mutexattr_destroy( &attr );
+    posix_mutex->type = POSIX_OBJ_MUTEX;
+    *mutex = posix_mutex;
+    return kNoErr;
+}
+
+OSStatus mico_rtos_lock_mutex( mico_mutex_t* mutex )
+{
+    if ( mutex == NULL || *mutex == NULL )
+        return kNotInitializedErr;
+    pthread_mutex_lock( &( (posix_mutex_t*) *mutex )->lock );
+    return kNoErr;
+}
+
+OSStatus mico_rtos_unlock_mutex( mico_mutex_t* mutex )
+{
+    if ( mutex == NULL || *mutex == NULL )
+        return kNotInitializedErr;
+    if ( pthread_mutex_unlock( &( (posix_mutex_t*) *mutex )->lock ) != 0 )
+        return kGeneralErr;
+    return kNoErr;
+}
+
+OSStatus mico_rtos_deinit_mutex( mico_mutex_t* mutex )
+{
+    posix_mutex_t* posix_mutex;
+
+    if ( mutex == NULL || *mutex == NULL )
+        return kNotInitializedErr;
+    posix_mutex = (posix_mutex_t*) *mutex;
+    posix_mutex->type = 0;
+    pthread_mutex_destroy( &posix_mutex->lock );
+    free( posix_mutex );
+    *mutex = NULL;
+    return kNoErr;
+}
+
+/******************************************************
+ *                       Queues
+ ******************************************************/
+
+OSStatus mico_rtos_init_queue( mico_queue_t* queue, const char* name, uint32_t message_size, uint32_t number_of_messages )
+{
+    posix_queue_t* posix_queue;
+
+    UNUSED_PARAMETER( name );
+    if ( queue == NULL || message_size == 0 || number_of_messages == 0 )
+        return kParamErr;
+
+    posix_queue = calloc( 1, sizeof(posix_queue_t) + message_size * number_of_messages );
+    if ( posix_queue == NULL )
+        return kNoMemoryErr;
+
+    posix_event_init( &posix_queue->event, POSIX_OBJ_QUEUE );
+    posix_queue->message_size = message_size;
+    posix_queue->length = number_of_messages;
+    posix_queue->buffer = (uint8_t*) ( posix_queue + 1 );
+    *queue = posix_queue;
+    return kNoErr;
+}
+
+OSStatus mico_rtos_push_to_queue( mico_queue_t* queue, void* message, uint32_t timeout_ms )
+{
+    posix_queue_t* posix_queue;
+    struct timespec deadline;
+    uint32_t tail;
+    OSStatus err = kNoErr;
+
+    if ( queue == NULL || *queue == NULL )
+        return kNotInitializedErr;
+    posix_queue = (posix_queue_t*) *queue;
+
+    posix_deadline( &deadline, timeout_ms );
+    pthread_mutex_lock( &posix_queue->event.lock );
+    while ( posix_queue->count == posix_queue->length )
+    {
+        err = posix_event_wait( &posix_queue->event, &deadline, timeout_ms );
+        if ( err != kNoErr && posix_queue->count == posix_queue->length )
+            goto exit;
+    }
+    err = kNoErr;
+    tail = ( posix_queue->head + posix_queue->count ) % posix_queue->length;
+    memcpy( posix_queue->buffer + tail * posix_queue->message_size, message, posix_queue->message_size );
+    posix_queue->count++;
+    if ( posix_queue->event.event_wr >= 0 )
+        host_sys_signal_byte( posix_queue->event.event_wr );
+    pthread_cond_broadcast( &posix_queue->event.cond );
+
+exit:
+    pthread_mutex_unlock( &posix_queue->event.lock );
+    return err;
+}
+
+OSStatus mico_rtos_pop_from_queue( mico_queue_t* queue, void* message, uint32_t timeout_ms )
+{
+    posix_queue_t* posix_queue;
+    struct timespec deadline;
+    OSStatus err = kNoErr;
+
+    if ( queue == NULL || *queue == NULL )
+        return kNotInitializedErr;
+    posix_queue = (posix_queue_t*) *queue;
+
+    posix_deadline( &deadline, timeout_ms );
+    pthread_mutex_lock( &posix_queue->event.lock );
+    while ( posix_queue->count == 0 )
+    {
+        err = posix_event_wait( &posix_queue->event, &deadline, timeout_ms );
+        if ( err != kNoErr && posix_queue->count == 0 )
+            goto exit;
+    }
+    err = kNoErr;
+    memcpy( message, posix_queue->buffer + posix_queue->head * posix_queue->message_size, posix_queue->message_size );
+    posix_queue->head = ( posix_queue->head + 1 ) % posix_queue->length;
+    posix_queue->count--;
+    if ( posix_queue->event.event_rd >= 0 )
+        host_sys_consume_byte( posix_queue->event.event_rd );
+    pthread_cond_broadcast( &posix_queue->event.cond );
+
+exit:
+    pthread_mutex_unlock( &posix_queue->event.lock );
+    return err;
+}
+
+OSStatus mico_rtos_deinit_queue( mico_queue_t* queue )
+{
+    posix_queue_t* posix_queue;
+
+    if ( queue == NULL || *queue == NULL )
+        return kNotInitializedErr;
+    posix_queue = (posix_queue_t*) *queue;
+
+    posix_event_deinit( &posix_queue->event );
+    free( posix_queue );
+    *queue = NULL;
+    return kNoErr;
+}
+
+bool mico_rtos_is_queue_empty( mico_queue_t* queue )
+{
+    posix_queue_t* posix_queue;
+    bool empty;
+
+    if ( queue == NULL || *queue == NULL )
+        return true;
+    posix_queue = (posix_queue_t*) *queue;
+    pthread_mutex_lock( &posix_queue->event.lock );
+    empty = ( posix_queue->count == 0 );
+    pthread_mutex_unlock( &posix_queue->event.lock );
+    return empty;
+}
+
+OSStatus mico_rtos_is_queue_full( mico_queue_t* queue )
+{
+    posix_queue_t* posix_queue;
+    bool full;
+
+    if ( queue == NULL || *queue == NULL )
+        return false;
+    posix_queue = (posix_queue_t*) *queue;
+    pthread_mutex_lock( &posix_queue->event.lock );
+    full = ( posix_queue->count == posix_queue->length );
+    pthread_mutex_unlock( &posix_queue->event.lock );
+    return full;
+}
+
+/******************************************************
+ *                       Timers
+ ******************************************************/
+
+uint32_t mico_get_time( void )
+{
+    struct timespec now;
+
+    pthread_once( &rtos_once, posix_rtos_init );
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return (uint32_t)( ( now.tv_sec - rtos_start_time.tv_sec ) * 1000
+                     + ( now.tv_nsec - rtos_start_time.tv_nsec ) / 1000000L );
+}
+
+/* Called with timer_mutex held */
+static void timer_list_remove( posix_timer_t* timer )
+{
+    posix_timer_t** p;
+
+    for ( p = &timer_list; *p != NULL; p = &( *p )->next )
+    {
+        if ( *p == timer )
+        {
+            *p = timer->next;
+            break;
+        }
+    }
+    timer->next = NULL;
+    timer->running = false;
+}
+
+/* Called with timer_mutex held, keeps the list sorted by deadline */
+static void timer_list_insert( posix_timer_t* timer )
+{
+    posix_timer_t** p;
+
+    timer->deadline = mico_get_time( ) + timer->period;
+    timer->running = true;
+    for ( p = &timer_list; *p != NULL; p = &( *p )->next )
+    {
+        if ( (int32_t)( ( *p )->deadline - timer->deadline ) > 0 )
+            break;
+    }
+    timer->next = *p;
+    *p = timer;
+
+    if ( !timer_thread_started )
+    {
+        pthread_t thread;
+        pthread_attr_t attr;
+
+        pthread_attr_init( &attr );
+        pthread_attr_setdetachstate( &attr, PTHREAD_CREATE_DETACHED );
+        if ( pthread_create( &thread, &attr, posix_timer_thread, NULL ) == 0 )
+            timer_thread_started = true;
+        pthread_attr_destroy( &attr );
+    }
+    pthread_cond_signal( &timer_cond );
+}
+
+static void* posix_timer_thread( void* arg )
+{
+    posix_timer_t* timer;
+    struct timespec deadline;
+    timer_handler_t function;
+    void (*legacy_function)( void );
+    void* function_arg;
+    int32_t remain;
+
+    UNUSED_PARAMETER( arg );
+    pthread_mutex_lock( &timer_mutex );
+    while ( 1 )
+    {
+        if ( timer_list == NULL )
+        {
+            pthread_cond_wait( &timer_cond, &timer_mutex );
+            continue;
+        }
+
+        remain = (int32_t)( timer_list->deadline - mico_get_time( ) );
+        if ( remain > 0 )
+        {
+            posix_deadline( &deadline, (uint32_t) remain );
+            pthread_cond_timedwait( &timer_cond, &timer_mutex, &deadline );
+            continue;
+        }
+
+        /* Re-arm before the callback, so the handler may stop, reload or
+         * delete its own timer */
+        timer = timer_list;
+        timer_list_remove( timer );
+        function = timer->function;
+        function_arg = timer->arg;
+        legacy_function = timer->legacy_function;
+        if ( timer->one_shot )
+            free( timer );
+        else
+            timer_list_insert( timer );
+
+        pthread_mutex_unlock( &timer_mutex );
+        if ( legacy_function != NULL )
+            legacy_function( );
+        else
+            function( function_arg );
+        pthread_mutex_lock( &timer_mutex );
+    }
+    return NULL;
+}
+
+OSStatus mico_init_timer( mico_timer_t* timer, uint32_t time_ms, timer_handler_t function, void* arg )
+{
+    posix_timer_t* posix_timer;
+
+    if ( timer == NULL || function == NULL )
+        return kParamErr;
+    pthread_once( &rtos_once, posix_rtos_init );
+
+    posix_timer = calloc( 1, sizeof(posix_timer_t) );
+    if ( posix_timer == NULL )
+        return kNoMemoryErr;
+    posix_timer->period = ( time_ms > 0 ) ? time_ms : 1;
+    posix_timer->function = function;
+    posix_timer->arg = arg;
+
+    timer->handle = posix_timer;
+    timer->function = function;
+    timer->arg = arg;
+    return kNoErr;
+}
+
+OSStatus mico_start_timer( mico_timer_t* timer )
+{
+    posix_timer_t* posix_timer;
+
+    if ( timer == NULL || timer->handle == NULL )
+        return kNotInitializedErr;
+    posix_timer = (posix_timer_t*) timer->handle;
+
+    pthread_mutex_lock( &timer_mutex );
+    if ( posix_timer->running )
+        timer_list_remove( posix_timer );
+    timer_list_insert( posix_timer );
+    pthread_mutex_unlock( &timer_mutex );
+    return kNoErr;
+}
+
+OSStatus mico_stop_timer( mico_timer_t* timer )
+{
+    posix_timer_t* posix_timer;
+
+    if ( timer == NULL || timer->handle == NULL )
+        return kNotInitializedErr;
+    posix_timer = (posix_timer_t*) timer->handle;
+
+    pthread_mutex_lock( &timer_mutex );
+    if ( posix_timer->running )
+        timer_list_remove( posix_timer );
+    pthread_mutex_unlock( &timer_mutex );
+    return kNoErr;
+}
+
+OSStatus mico_reload_timer( mico_timer_t* timer )
+{
+    return mico_start_timer( timer );
+}
+
+OSStatus mico_deinit_timer( mico_timer_t* timer )
+{
+    if ( timer == NULL || timer->handle == NULL )
+        return kNotInitializedErr;
+
+    mico_stop_timer( timer );
+    free( timer->handle );
+    timer->handle = NULL;
+    return kNoErr;
+}
+
+bool mico_is_timer_running( mico_timer_t* timer )
+{
+    bool running;
+
+    if ( timer == NULL || timer->handle == NULL )
+        return false;
+    pthread_mutex_lock( &timer_mutex );
+    running = ( (posix_timer_t*) timer->handle )->running;
+    pthread_mutex_unlock( &timer_mutex );
+    return running;
+}
+
+/* Called with timer_mutex held */
+static void legacy_timer_remove( void (*psysTimerHandler)( void ) )
+{
+    posix_timer_t** p = &timer_list;
+    posix_timer_t* timer;
+
+    while ( *p != NULL )
+    {
+        timer = *p;
+        if ( timer->one_shot && timer->legacy_function == psysTimerHandler )
+        {
+            *p = timer->next;
+            free( timer );
+        }
+        else
+        {
+            p = &timer->next;
+        }
+    }
+}
+
+int SetTimer( unsigned long ms, void (*psysTimerHandler)( void ) )
+{
+    posix_timer_t* posix_timer;
+
+    if ( psysTimerHandler == NULL )
+        return kParamErr;
+    pthread_once( &rtos_once, posix_rtos_init );
+
+    posix_timer = calloc( 1, sizeof(posix_timer_t) );
+    if ( posix_timer == NULL )
+        return kNoMemoryErr;
+    posix_timer->period = (uint32_t) ms;
+    posix_timer->one_shot = true;
+    posix_timer->legacy_function = psysTimerHandler;
+
+    pthread_mutex_lock( &timer_mutex );
+    timer_list_insert( posix_timer );
+    pthread_mutex_unlock( &timer_mutex );
+    return kNoErr;
+}
+
+int SetTimer_uniq( unsigned long ms, void (*psysTimerHandler)( void ) )
+{
+    pthread_mutex_lock( &timer_mutex );
+    legacy_timer_remove( psysTimerHandler );
+    pthread_mutex_unlock( &timer_mutex );
+    return SetTimer( ms, psysTimerHandler );
+}
+
+int UnSetTimer( void (*psysTimerHandler)( void ) )
+{
+    pthread_mutex_lock( &timer_mutex );
+    legacy_timer_remove( psysTimerHandler );
+    pthread_mutex_unlock( &timer_mutex );
+    return kNoErr;
+}
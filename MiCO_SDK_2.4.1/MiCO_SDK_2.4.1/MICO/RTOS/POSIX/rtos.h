@@ -0,0 +1,67 @@
+/**
+******************************************************************************
+* @file    rtos.h
+* @author  William Xu
+* @version V1.0.0
+* @date    17-Oct-2026
+* @brief   Internal interfaces of the MiCO RTOS abstraction layer implemented
+*          on POSIX threads, shared with the host core (MICO/core/Host).
+******************************************************************************
+*
+*  The MIT License
+*  Copyright (c) 2016 MXCHIP Inc.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is furnished
+*  to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in
+*  all copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+*  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+*  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+******************************************************************************
+*/
+
+#pragma once
+
+#include "Common.h"
+#include "mico_rtos.h"
+#include "host_sys.h"
+
+/******************************************************
+ *                      Macros
+ ******************************************************/
+
+/******************************************************
+ *                    Constants
+ ******************************************************/
+
+/* Host threads run 64-bit code with glibc underneath, MiCO stack sizes tuned
+ * for a Cortex-M are far too small, so every thread gets at least this much. */
+#define POSIX_RTOS_MIN_STACK_SIZE   (256 * 1024)
+
+/******************************************************
+ *               Function Declarations
+ ******************************************************/
+
+/** @brief    Bind a pipe to a semaphore or a queue so it can be used in select()
+  *
+  * @Details  The pipe holds one byte per pending semaphore count or queued
+  *           message, so its read end is readable exactly while the event is
+  *           set. Used by mico_create_event_fd() in MICO/core/Host.
+  *
+  * @param    handle   : semaphore or queue handle
+  * @param    read_fd  : host read end of the pipe, -1 to detach
+  * @param    write_fd : host write end of the pipe, -1 to detach
+  *
+  * @return   kNoErr on success, kTypeErr if the handle is not a semaphore or queue
+  */
+OSStatus posix_rtos_event_attach( mico_event handle, int read_fd, int write_fd );
@@ -0,0 +1,404 @@
+/**
+******************************************************************************
+* @file    host_sys.c
+* @author  William Xu
+* @version V1.0.0
+* @date    17-Oct-2026
+* @brief   Host operating system calls used by the MiCO host port. MiCO's
+*          socket API defines read, write, close, select... with its own
+*          semantics, which interposes the C library ones in the final
+*          binary, so every shadowed call goes through syscall().
+******************************************************************************
+*
+*  The MIT License
+*  Copyright (c) 2016 MXCHIP Inc.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy 
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights 
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is furnished
+*  to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in
+*  all copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+*  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR 
+*  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+******************************************************************************
+*/ 
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <ifaddrs.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <netpacket/packet.h>
+
+#include "host_sys.h"
+
+/******************************************************
+ *                      Macros
+ ******************************************************/
+
+#define host_setsockopt( fd, level, name, val, len )  (int) syscall( SYS_setsockopt, fd, level, name, val, len )
+#define host_getsockopt( fd, level, name, val, len )  (int) syscall( SYS_getsockopt, fd, level, name, val, len )
+
+/******************************************************
+ *               Function Definitions
+ ******************************************************/
+
+int host_sys_errno( void )
+{
+    return errno;
+}
+
+int host_sys_pipe( int fds[2] )
+{
+    if ( pipe( fds ) < 0 )
+        return -1;
+    host_sys_set_nonblock( fds[0], true );
+    host_sys_set_nonblock( fds[1], true );
+    return 0;
+}
+
+int host_sys_open( const char* path )
+{
+    return open( path, O_RDWR | O_NOCTTY );
+}
+
+void host_sys_restart( char* const argv[] )
+{
+    fflush( NULL );
+    execv( "/proc/self/exe", argv );
+    _exit( 1 );
+}
+
+int host_sys_read( int fd, void* buf, size_t len )
+{
+    long ret;
+
+    do
+    {
+        ret = syscall( SYS_read, fd, buf, len );
+    } while ( ret < 0 && errno == EINTR );
+    return (int) ret;
+}
+
+int host_sys_write( int fd, const void* buf, size_t len )
+{
+    long ret;
+
+    do
+    {
+        ret = syscall( SYS_write, fd, buf, len );
+    } while ( ret < 0 && errno == EINTR );
+    return (int) ret;
+}
+
+int host_sys_close( int fd )
+{
+    return (int) syscall( SYS_close, fd );
+}
+
+int host_sys_set_nonblock( int fd, bool nonblock )
+{
+    int flags = fcntl( fd, F_GETFL, 0 );
+
+    if ( flags < 0 )
+        return -1;
+    flags = nonblock ? ( flags | O_NONBLOCK ) : ( flags & ~O_NONBLOCK );
+    return fcntl( fd, F_SETFL, flags );
+}
+
+int host_sys_poll( host_poll_t* fds, int count, int timeout_ms )
+{
+    struct pollfd pfds[count > 0 ? count : 1];
+    int i, ret;
+
+    for ( i = 0; i < count; i++ )
+    {
+        pfds[i].fd = fds[i].fd;
+        pfds[i].events = 0;
+        pfds[i].revents = 0;
+        if ( fds[i].events & HOST_POLL_IN )
+            pfds[i].events |= POLLIN;
+        if ( fds[i].events & HOST_POLL_OUT )
+            pfds[i].events |= POLLOUT;
+    }
+
+    do
+    {
+        ret = poll( pfds, count, timeout_ms );
+    } while ( ret < 0 && errno == EINTR );
+
+    for ( i = 0; i < count; i++ )
+    {
+        fds[i].revents = 0;
+        if ( pfds[i].revents & ( POLLIN | POLLHUP ) )
+            fds[i].revents |= HOST_POLL_IN;
+        if ( pfds[i].revents & POLLOUT )
+            fds[i].revents |= HOST_POLL_OUT;
+        if ( pfds[i].revents & ( POLLERR | POLLNVAL ) )
+            fds[i].revents |= HOST_POLL_ERR;
+    }
+    return ret;
+}
+
+int host_sys_signal_byte( int fd )
+{
+    char c = 0;
+    return host_sys_write( fd, &c, 1 );
+}
+
+int host_sys_consume_byte( int fd )
+{
+    char c;
+    return host_sys_read( fd, &c, 1 );
+}
+
+static void host_sys_sockaddr( struct sockaddr_in* sin, uint32_t ip, uint16_t port )
+{
+    memset( sin, 0, sizeof(struct sockaddr_in) );
+    sin->sin_family = AF_INET;
+    sin->sin_port = htons( port );
+    sin->sin_addr.s_addr = htonl( ip );
+}
+
+int host_sys_socket( bool stream )
+{
+    return (int) syscall( SYS_socket, AF_INET, stream ? SOCK_STREAM : SOCK_DGRAM, 0 );
+}
+
+int host_sys_bind( int fd, uint32_t ip, uint16_t port )
+{
+    struct sockaddr_in sin;
+
+    host_sys_sockaddr( &sin, ip, port );
+    return (int) syscall( SYS_bind, fd, &sin, sizeof(sin) );
+}
+
+int host_sys_connect( int fd, uint32_t ip, uint16_t port )
+{
+    struct sockaddr_in sin;
+    long ret;
+
+    host_sys_sockaddr( &sin, ip, port );
+    ret = syscall( SYS_connect, fd, &sin, sizeof(sin) );
+    if ( ret < 0 && errno == EINTR )
+    {
+        /* The connection keeps going in the background, wait for it */
+        struct pollfd pfd = { fd, POLLOUT, 0 };
+        int err = 0;
+        socklen_t len = sizeof(err);
+
+        while ( poll( &pfd, 1, -1 ) < 0 && errno == EINTR );
+        (void) host_getsockopt( fd, SOL_SOCKET, SO_ERROR, &err, &len );
+        errno = err;
+        ret = err ? -1 : 0;
+    }
+    return (int) ret;
+}
+
+int host_sys_listen( int fd, int backlog )
+{
+    return (int) syscall( SYS_listen, fd, backlog > 0 ? backlog : SOMAXCONN );
+}
+
+int host_sys_accept( int fd, uint32_t* ip, uint16_t* port )
+{
+    struct sockaddr_in sin;
+    socklen_t len = sizeof(sin);
+    long ret;
+
+    do
+    {
+        ret = syscall( SYS_accept, fd, &sin, &len );
+    } while ( ret < 0 && errno == EINTR );
+    if ( ret >= 0 )
+    {
+        if ( ip )   *ip = ntohl( sin.sin_addr.s_addr );
+        if ( port ) *port = ntohs( sin.sin_port );
+    }
+    return (int) ret;
+}
+
+int host_sys_send( int fd, const void* buf, size_t len, uint32_t ip, uint16_t port, bool to )
+{
+    struct sockaddr_in sin;
+    long ret;
+
+    host_sys_sockaddr( &sin, ip, port );
+    do
+    {
+        ret = syscall( SYS_sendto, fd, buf, len, MSG_NOSIGNAL, to ? &sin : NULL, to ? sizeof(sin) : 0 );
+    } while ( ret < 0 && errno == EINTR );
+    return (int) ret;
+}
+
+int host_sys_recv( int fd, void* buf, size_t len, uint32_t* ip, uint16_t* port )
+{
+    struct sockaddr_in sin;
+    socklen_t sin_len = sizeof(sin);
+    long ret;
+
+    memset( &sin, 0, sizeof(sin) );
+    do
+    {
+        ret = syscall( SYS_recvfrom, fd, buf, len, 0, &sin, &sin_len );
+    } while ( ret < 0 && errno == EINTR );
+    if ( ret >= 0 )
+    {
+        if ( ip )   *ip = ntohl( sin.sin_addr.s_addr );
+        if ( port ) *port = ntohs( sin.sin_port );
+    }
+    return (int) ret;
+}
+
+int host_sys_setsockopt( int fd, host_sockopt_t opt, int value )
+{
+    struct timeval tv;
+    struct ip_mreq mreq;
+
+    switch ( opt )
+    {
+        case HOST_OPT_REUSEADDR:
+            return host_setsockopt( fd, SOL_SOCKET, SO_REUSEADDR, &value, sizeof(value) );
+        case HOST_OPT_BROADCAST:
+            return host_setsockopt( fd, SOL_SOCKET, SO_BROADCAST, &value, sizeof(value) );
+        case HOST_OPT_KEEPALIVE:
+            return host_setsockopt( fd, SOL_SOCKET, SO_KEEPALIVE, &value, sizeof(value) );
+        case HOST_OPT_KEEPIDLE:
+            return host_setsockopt( fd, IPPROTO_TCP, TCP_KEEPIDLE, &value, sizeof(value) );
+        case HOST_OPT_KEEPINTVL:
+            return host_setsockopt( fd, IPPROTO_TCP, TCP_KEEPINTVL, &value, sizeof(value) );
+        case HOST_OPT_KEEPCNT:
+            return host_setsockopt( fd, IPPROTO_TCP, TCP_KEEPCNT, &value, sizeof(value) );
+        case HOST_OPT_RCVTIMEO:
+        case HOST_OPT_SNDTIMEO:
+            tv.tv_sec = value / 1000;
+            tv.tv_usec = ( value % 1000 ) * 1000;
+            return host_setsockopt( fd, SOL_SOCKET, opt == HOST_OPT_RCVTIMEO ? SO_RCVTIMEO : SO_SNDTIMEO, &tv, sizeof(tv) );
+        case HOST_OPT_ADD_MEMBERSHIP:
+        case HOST_OPT_DROP_MEMBERSHIP:
+            mreq.imr_multiaddr.s_addr = htonl( (uint32_t) value );
+            mreq.imr_interface.s_addr = htonl( INADDR_ANY );
+            return host_setsockopt( fd, IPPROTO_IP, opt == HOST_OPT_ADD_MEMBERSHIP ? IP_ADD_MEMBERSHIP : IP_DROP_MEMBERSHIP, &mreq, sizeof(mreq) );
+        default:
+            errno = ENOPROTOOPT;
+            return -1;
+    }
+}
+
+int host_sys_socket_error( int fd )
+{
+    int err = 0;
+    socklen_t len = sizeof(err);
+
+    if ( host_getsockopt( fd, SOL_SOCKET, SO_ERROR, &err, &len ) < 0 )
+        return errno;
+    return err;
+}
+
+int host_sys_socket_type( int fd )
+{
+    int type = 0;
+    socklen_t len = sizeof(type);
+
+    if ( host_getsockopt( fd, SOL_SOCKET, SO_TYPE, &type, &len ) < 0 )
+        return -1;
+    return type;
+}
+
+int host_sys_resolve( const char* name, uint32_t* ip )
+{
+    struct addrinfo hints, *res = NULL;
+    int ret;
+
+    memset( &hints, 0, sizeof(hints) );
+    hints.ai_family = AF_INET;
+    ret = getaddrinfo( name, NULL, &hints, &res );
+    if ( ret != 0 || res == NULL )
+        return -1;
+    *ip = ntohl( ( (struct sockaddr_in*) res->ai_addr )->sin_addr.s_addr );
+    freeaddrinfo( res );
+    return 0;
+}
+
+int host_sys_interface( uint32_t* ip, uint32_t* mask, uint8_t mac[6] )
+{
+    struct ifaddrs *list = NULL, *ifa;
+    const char* name = NULL;
+
+    if ( getifaddrs( &list ) != 0 )
+        return -1;
+
+    /* First IPv4 interface that is up and not a loopback wins */
+    for ( ifa = list; ifa != NULL; ifa = ifa->ifa_next )
+    {
+        if ( ifa->ifa_addr == NULL || ifa->ifa_addr->sa_family != AF_INET )
+            continue;
+        if ( !( ifa->ifa_flags & IFF_UP ) || ( ifa->ifa_flags & IFF_LOOPBACK ) )
+            continue;
+        name = ifa->ifa_name;
+        *ip = ntohl( ( (struct sockaddr_in*) ifa->ifa_addr )->sin_addr.s_addr );
+        *mask = ( ifa->ifa_netmask != NULL ) ? ntohl( ( (struct sockaddr_in*) ifa->ifa_netmask )->sin_addr.s_addr ) : 0xFFFFFF00;
+        break;
+    }
+
+    if ( name == NULL )
+    {
+        *ip = INADDR_LOOPBACK;
+        *mask = 0xFF000000;
+    }
+
+    memset( mac, 0, 6 );
+    for ( ifa = list; ifa != NULL && name != NULL; ifa = ifa->ifa_next )
+    {
+        if ( ifa->ifa_addr == NULL || ifa->ifa_addr->sa_family != AF_PACKET || strcmp( ifa->ifa_name, name ) != 0 )
+            continue;
+        memcpy( mac, ( (struct sockaddr_ll*) ifa->ifa_addr )->sll_addr, 6 );
+        break;
+    }
+
+    freeifaddrs( list );
+    return 0;
+}
+
+int host_sys_nameserver( uint32_t* ip )
+{
+    char line[128], addr[64];
+    struct in_addr in;
+    FILE* file;
+    int ret = -1;
+
+    file = fopen( "/etc/resolv.conf", "r" );
+    if ( file == NULL )
+        return -1;
+    while ( ret < 0 && fgets( line, sizeof(line), file ) != NULL )
+    {
+        if ( sscanf( line, " nameserver %63s", addr ) == 1 && inet_pton( AF_INET, addr, &in ) == 1 )
+        {
+            *ip = ntohl( in.s_addr );
+            ret = 0;
+        }
+    }
+    fclose( file );
+    return ret;
+}
@@ -0,0 +1,115 @@
+/**
+******************************************************************************
+* @file    host_sys.h
+* @author  William Xu
+* @version V1.0.0
+* @date    17-Oct-2026
+* @brief   Thin wrappers around the host operating system calls, shared by
+*          the POSIX RTOS port and the host MiCO core. Kept free of MiCO
+*          headers because MiCO's BSD socket names shadow the C library.
+******************************************************************************
+*
+*  The MIT License
+*  Copyright (c) 2016 MXCHIP Inc.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy 
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights 
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is furnished
+*  to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in
+*  all copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+*  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR 
+*  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+******************************************************************************
+*/ 
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/******************************************************
+ *                    Constants
+ ******************************************************/
+
+#define HOST_POLL_IN        (0x01)
+#define HOST_POLL_OUT       (0x02)
+#define HOST_POLL_ERR       (0x04)
+
+/******************************************************
+ *                   Enumerations
+ ******************************************************/
+
+typedef enum
+{
+    HOST_OPT_REUSEADDR,
+    HOST_OPT_BROADCAST,
+    HOST_OPT_KEEPALIVE,
+    HOST_OPT_KEEPIDLE,      /* seconds */
+    HOST_OPT_KEEPINTVL,     /* seconds */
+    HOST_OPT_KEEPCNT,
+    HOST_OPT_RCVTIMEO,      /* milliseconds */
+    HOST_OPT_SNDTIMEO,      /* milliseconds */
+    HOST_OPT_ADD_MEMBERSHIP,/* IPv4 group, host byte order */
+    HOST_OPT_DROP_MEMBERSHIP,
+} host_sockopt_t;
+
+/******************************************************
+ *                    Structures
+ ******************************************************/
+
+typedef struct
+{
+    int     fd;
+    uint8_t events;
+    uint8_t revents;
+} host_poll_t;
+
+/******************************************************
+ *               Function Declarations
+ ******************************************************/
+
+/* All calls return -1 on failure, host_sys_errno() then gives the reason.
+ * IPv4 addresses and ports are in host byte order, as in struct sockaddr_t */
+
+int  host_sys_errno( void );
+
+int  host_sys_pipe( int fds[2] );
+int  host_sys_open( const char* path );
+void host_sys_restart( char* const argv[] );
+int  host_sys_read( int fd, void* buf, size_t len );
+int  host_sys_write( int fd, const void* buf, size_t len );
+int  host_sys_close( int fd );
+int  host_sys_set_nonblock( int fd, bool nonblock );
+int  host_sys_poll( host_poll_t* fds, int count, int timeout_ms );
+
+/* One byte per pending event, used for MiCO event fds */
+int  host_sys_signal_byte( int fd );
+int  host_sys_consume_byte( int fd );
+
+int  host_sys_socket( bool stream );
+int  host_sys_bind( int fd, uint32_t ip, uint16_t port );
+int  host_sys_connect( int fd, uint32_t ip, uint16_t port );
+int  host_sys_listen( int fd, int backlog );
+int  host_sys_accept( int fd, uint32_t* ip, uint16_t* port );
+int  host_sys_send( int fd, const void* buf, size_t len, uint32_t ip, uint16_t port, bool to );
+int  host_sys_recv( int fd, void* buf, size_t len, uint32_t* ip, uint16_t* port );
+int  host_sys_setsockopt( int fd, host_sockopt_t opt, int value );
+int  host_sys_socket_error( int fd );
+int  host_sys_socket_type( int fd );
+int  host_sys_resolve( const char* name, uint32_t* ip );
+
+/* Address of the first non-loopback IPv4 interface, loopback if none is up */
+int  host_sys_interface( uint32_t* ip, uint32_t* mask, uint8_t mac[6] );
+
+/* First IPv4 nameserver in /etc/resolv.conf */
+int  host_sys_nameserver( uint32_t* ip );
@@ -0,0 +1,158 @@
+/**
+******************************************************************************
+* @file    mico_cli_cmd.c
+* @author  William Xu
+* @version V1.0.0
+* @date    17-Oct-2026
+* @brief   This file provides the CLI commands that the MiCO core library
+*          registers on the module, implemented for the host (POSIX) platform.
+******************************************************************************
+*
+*  The MIT License
+*  Copyright (c) 2016 MXCHIP Inc.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy 
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights 
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is furnished
+*  to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in
+*  all copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+*  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR 
+*  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+******************************************************************************
+*/ 
+
+#include "MICO.h"
+#include "mico_cli.h"
+#include "tftp_ota/tftp.h"
+
+/******************************************************
+ *               Function Definitions
+ ******************************************************/
+
+void wifistate_Command( CLI_ARGS )
+{
+  LinkStatusTypeDef link;
+
+  micoWlanGetLinkStatus( &link );
+  if ( link.is_connected )
+    cmd_printf( "Station connected: %s, channel %d, strength %d\r\n", link.ssid, link.channel, link.wifi_strength );
+  else
+    cmd_printf( "Station down\r\n" );
+}
+
+void wifidebug_Command( CLI_ARGS )
+{
+  if ( argc == 2 && !strcasecmp( argv[1], "on" ) ) {
+    wifimgr_debug_enable( true );
+  } else if ( argc == 2 && !strcasecmp( argv[1], "off" ) ) {
+    wifimgr_debug_enable( false );
+  } else {
+    cmd_printf( "Usage: wifidebug on/off\r\n" );
+  }
+}
+
+void wifiscan_Command( CLI_ARGS )
+{
+  micoWlanStartScan( );
+}
+
+void ifconfig_Command( CLI_ARGS )
+{
+  IPStatusTypedef para;
+
+  micoWlanGetIPStatus( &para, Station );
+  cmd_printf( "Station: IP %s, Mask %s, Gateway %s, DNS %s, MAC %s\r\n",
+              para.ip, para.mask, para.gate, para.dns, para.mac );
+}
+
+void arp_Command( CLI_ARGS )
+{
+  cmd_printf( "ARP is handled by the host kernel, see /proc/net/arp\r\n" );
+}
+
+void ping_Command( CLI_ARGS )
+{
+  cmd_printf( "ICMP needs raw sockets, use the host's ping\r\n" );
+}
+
+void dns_Command( CLI_ARGS )
+{
+  char ipstr[16];
+
+  if ( argc != 2 || !strcmp( argv[1], "show" ) || !strcmp( argv[1], "clean" ) ) {
+    cmd_printf( "Usage: dns <domain>\r\n" );
+    return;
+  }
+
+  if ( gethostbyname( argv[1], (uint8_t *)ipstr, sizeof(ipstr) ) == kNoErr )
+    cmd_printf( "%s: %s\r\n", argv[1], ipstr );
+  else
+    cmd_printf( "%s: not found\r\n", argv[1] );
+}
+
+void task_Command( CLI_ARGS )
+{
+  cmd_printf( "Threads are host threads, see /proc/%s/task\r\n", "self" );
+}
+
+void memory_show_Command( CLI_ARGS )
+{
+  micoMemInfo_t *info = MicoGetMemoryInfo( );
+
+  cmd_printf( "number of chunks %d\r\n", info->num_of_chunks );
+  cmd_printf( "total memory %d\r\n", info->total_memory );
+  cmd_printf( "free memory %d\r\n", info->free_memory );
+  cmd_printf( "allocated memory %d\r\n", info->allocted_memory );
+}
+
+void memory_dump_Command( CLI_ARGS )
+{
+  cmd_printf( "Not supported on the host platform\r\n" );
+}
+
+void memory_set_Command( CLI_ARGS )
+{
+  cmd_printf( "Not supported on the host platform\r\n" );
+}
+
+void memp_dump_Command( CLI_ARGS )
+{
+  cmd_printf( "No lwIP memory pools on the host platform\r\n" );
+}
+
+void driver_state_Command( CLI_ARGS )
+{
+  char version[40];
+
+  MicoGetRfVer( version, sizeof(version) );
+  cmd_printf( "wlan driver: %s\r\n", version );
+}
+
+/* The tftp client only comes as a Cortex-M object (tftp_ota/tftpc.o) */
+int tsend( tftp_file_info_t *fileinfo, uint32_t ipaddr )
+{
+  UNUSED_PARAMETER( fileinfo );
+  UNUSED_PARAMETER( ipaddr );
+  return -1;
+}
+
+int tget( tftp_file_info_t *fileinfo, uint32_t ipaddr )
+{
+  UNUSED_PARAMETER( fileinfo );
+  UNUSED_PARAMETER( ipaddr );
+  return -1;
+}
+
+void tftp_ota( void )
+{
+
+}
@@ -0,0 +1,115 @@
+/**
+******************************************************************************
+* @file    mico_core.c
+* @author  William Xu
+* @version V1.0.0
+* @date    17-Oct-2026
+* @brief   This file provides the MiCO core entry and information APIs for the
+*          host (POSIX) platform.
+******************************************************************************
+*
+*  The MIT License
+*  Copyright (c) 2016 MXCHIP Inc.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy 
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights 
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is furnished
+*  to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in
+*  all copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+*  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR 
+*  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+******************************************************************************
+*/ 
+
+#include <malloc.h>
+
+#include "MICO.h"
+#include "platform.h"
+#include "platform_config.h"
+
+#define core_log(M, ...) custom_log("CORE", M, ##__VA_ARGS__)
+
+/******************************************************
+ *                    Constants
+ ******************************************************/
+
+#define HOST_SYSTEM_LIB_VERSION     "31620002.HOST"
+#define HOST_RF_DRIVER_VERSION      "host-loopback-1.0"
+
+/******************************************************
+ *               Variables Definitions
+ ******************************************************/
+
+extern uint32_t app_stack_size;
+
+static micoMemInfo_t mico_mem_info;
+
+/******************************************************
+ *               Function Declarations
+ ******************************************************/
+
+extern int application_start( void );
+
+/******************************************************
+ *               Function Definitions
+ ******************************************************/
+
+static void application_thread_main( void *arg )
+{
+  UNUSED_PARAMETER( arg );
+  application_start( );
+  mico_rtos_delete_thread( NULL );
+}
+
+void mico_main( void )
+{
+  OSStatus err;
+
+  err = mico_rtos_create_thread( NULL, MICO_APPLICATION_PRIORITY, "app_thread", application_thread_main, app_stack_size, NULL );
+  require_noerr_action( err, exit, core_log("ERROR: Unable to start the application thread.") );
+
+  /* The application thread is detached, main() must not return while it runs */
+  mico_rtos_delete_thread( NULL );
+
+exit:
+  return;
+}
+
+void mxchipInit( void )
+{
+  /* No TCP/IP or RF driver thread, the host kernel owns the network */
+}
+
+char* system_lib_version( void )
+{
+  return HOST_SYSTEM_LIB_VERSION;
+}
+
+int wlan_driver_version( char* outVersion, uint8_t inLength )
+{
+  if ( outVersion == NULL || inLength == 0 )
+    return -1;
+  strncpy( outVersion, HOST_RF_DRIVER_VERSION, inLength - 1 );
+  outVersion[inLength - 1] = 0x0;
+  return 0;
+}
+
+micoMemInfo_t* mico_memory_info( void )
+{
+  struct mallinfo2 info = mallinfo2( );
+
+  mico_mem_info.num_of_chunks = (int) info.ordblks;
+  mico_mem_info.total_memory = (int) info.arena;
+  mico_mem_info.allocted_memory = (int) info.uordblks;
+  mico_mem_info.free_memory = (int) info.fordblks;
+  return &mico_mem_info;
+}
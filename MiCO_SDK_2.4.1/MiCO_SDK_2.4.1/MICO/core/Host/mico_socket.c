@@ -0,0 +1,622 @@
+/**
+******************************************************************************
+* @file    mico_socket.c
+* @author  William Xu
+* @version V1.0.0
+* @date    17-Oct-2026
+* @brief   MiCO BSD socket API on top of the host TCP/IP stack. MiCO fds
+*          are small indexes into a local table, so they fit MiCO's fd_set,
+*          and map to host sockets or to MiCO event pipes.
+******************************************************************************
+*
+*  The MIT License
+*  Copyright (c) 2016 MXCHIP Inc.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy 
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights 
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is furnished
+*  to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in
+*  all copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+*  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR 
+*  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+******************************************************************************
+*/ 
+
+#include <pthread.h>
+
+#include "MICO.h"
+#include "rtos.h"
+#include "host_sys.h"
+#include "mico_cli.h"
+
+/******************************************************
+ *                      Macros
+ ******************************************************/
+
+#define socket_log(M, ...) custom_log("SOCKET", M, ##__VA_ARGS__)
+
+/******************************************************
+ *                    Constants
+ ******************************************************/
+
+/* Every bit MiCO's fd_set can hold on this host */
+#define MICO_HOST_FD_MAX        ( NFDBITS * howmany( FD_SETSIZE, NFDBITS ) )
+
+/******************************************************
+ *                   Enumerations
+ ******************************************************/
+
+typedef enum
+{
+    HOST_FD_FREE = 0,
+    HOST_FD_SOCKET,
+    HOST_FD_EVENT,
+} host_fd_type_t;
+
+/******************************************************
+ *                 Type Definitions
+ ******************************************************/
+
+typedef struct
+{
+    host_fd_type_t  type;
+    int             host_fd;
+    int             event_wr;
+    mico_event      event;
+    int             error;
+} host_fd_t;
+
+/******************************************************
+ *               Variables Definitions
+ ******************************************************/
+
+static host_fd_t        fd_table[MICO_HOST_FD_MAX];
+static pthread_mutex_t  fd_table_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int tcp_keepalive_max_err = 5;
+static int tcp_keepalive_seconds = 10;
+
+/******************************************************
+ *               Function Declarations
+ ******************************************************/
+
+/* Notification hook, implemented in MICO/system/mico_system_notification.c */
+extern void dns_ip_set( uint8_t *hostname, uint32_t ip );
+
+/******************************************************
+ *               Function Definitions
+ ******************************************************/
+
+static int fd_alloc( host_fd_type_t type, int host_fd )
+{
+    int fd;
+
+    pthread_mutex_lock( &fd_table_mutex );
+    for ( fd = 0; fd < MICO_HOST_FD_MAX; fd++ )
+    {
+        if ( fd_table[fd].type == HOST_FD_FREE )
+        {
+            memset( &fd_table[fd], 0, sizeof(host_fd_t) );
+            fd_table[fd].type = type;
+            fd_table[fd].host_fd = host_fd;
+            fd_table[fd].event_wr = -1;
+            break;
+        }
+    }
+    pthread_mutex_unlock( &fd_table_mutex );
+    return ( fd < MICO_HOST_FD_MAX ) ? fd : -1;
+}
+
+static host_fd_t* fd_get( int fd, host_fd_type_t type )
+{
+    if ( fd < 0 || fd >= MICO_HOST_FD_MAX || fd_table[fd].type != type )
+        return NULL;
+    return &fd_table[fd];
+}
+
+static int fd_fail( host_fd_t* entry )
+{
+    entry->error = host_sys_errno( );
+    return -1;
+}
+
+int socket( int domain, int type, int protocol )
+{
+    int host_fd, fd;
+
+    UNUSED_PARAMETER( domain );
+    UNUSED_PARAMETER( protocol );
+
+    host_fd = host_sys_socket( type == SOCK_STREAM );
+    if ( host_fd < 0 )
+        return -1;
+
+    fd = fd_alloc( HOST_FD_SOCKET, host_fd );
+    if ( fd < 0 )
+    {
+        socket_log( "No free socket, max %d", MICO_HOST_FD_MAX );
+        host_sys_close( host_fd );
+        return -1;
+    }
+
+    /* lwIP in MiCO lets a listener be re-bound right after a restart */
+    host_sys_setsockopt( host_fd, HOST_OPT_REUSEADDR, 1 );
+    return fd;
+}
+
+int setsockopt( int sockfd, int level, int optname, const void *optval, socklen_t optlen )
+{
+    host_fd_t* entry = fd_get( sockfd, HOST_FD_SOCKET );
+    int value = 0;
+    int ret = 0;
+
+    if ( entry == NULL )
+        return -1;
+    if ( optval != NULL && optlen >= (socklen_t) sizeof(int) )
+        value = *(const int*) optval;
+    else if ( optval != NULL && optlen == 1 )
+        value = *(const uint8_t*) optval;
+
+    if ( level == IPPROTO_TCP )
+    {
+        switch ( optname )
+        {
+            case TCP_KEEPIDLE:      ret = host_sys_setsockopt( entry->host_fd, HOST_OPT_KEEPIDLE, value ); break;
+            case TCP_KEEPINTVL:     ret = host_sys_setsockopt( entry->host_fd, HOST_OPT_KEEPINTVL, value ); break;
+            case TCP_KEEPCNT:       ret = host_sys_setsockopt( entry->host_fd, HOST_OPT_KEEPCNT, value ); break;
+            case TCP_MAX_CONN_NUM:  break;
+            default:                entry->error = ENOPROTOOPT; return -1;
+        }
+    }
+    else
+    {
+        switch ( optname )
+        {
+            case SO_REUSEADDR:      ret = host_sys_setsockopt( entry->host_fd, HOST_OPT_REUSEADDR, value ); break;
+            case SO_BROADCAST:      ret = host_sys_setsockopt( entry->host_fd, HOST_OPT_BROADCAST, value ); break;
+            case SO_KEEPALIVE:      ret = host_sys_setsockopt( entry->host_fd, HOST_OPT_KEEPALIVE, value ); break;
+            case SO_BLOCKMODE:      ret = host_sys_set_nonblock( entry->host_fd, value != 0 ); break;
+            case SO_SNDTIMEO:       ret = host_sys_setsockopt( entry->host_fd, HOST_OPT_SNDTIMEO, value ); break;
+            case SO_RCVTIMEO:       ret = host_sys_setsockopt( entry->host_fd, HOST_OPT_RCVTIMEO, value ); break;
+            case IP_ADD_MEMBERSHIP: ret = host_sys_setsockopt( entry->host_fd, HOST_OPT_ADD_MEMBERSHIP, value ); break;
+            case IP_DROP_MEMBERSHIP:ret = host_sys_setsockopt( entry->host_fd, HOST_OPT_DROP_MEMBERSHIP, value ); break;
+            case SO_NO_CHECK:       break;
+            default:                entry->error = ENOPROTOOPT; return -1;
+        }
+    }
+
+    return ( ret < 0 ) ? fd_fail( entry ) : 0;
+}
+
+int getsockopt( int sockfd, int level, int optname, const void *optval, socklen_t *optlen )
+{
+    host_fd_t* entry = fd_get( sockfd, HOST_FD_SOCKET );
+    int value;
+
+    UNUSED_PARAMETER( level );
+    if ( entry == NULL || optval == NULL )
+        return -1;
+
+    switch ( optname )
+    {
+        case SO_ERROR:
+            value = entry->error ? entry->error : host_sys_socket_error( entry->host_fd );
+            entry->error = 0;
+            break;
+        case SO_TYPE:
+            value = host_sys_socket_type( entry->host_fd );
+            break;
+        default:
+            entry->error = ENOPROTOOPT;
+            return -1;
+    }
+
+    *(int*) optval = value;
+    if ( optlen )
+        *optlen = sizeof(int);
+    return 0;
+}
+
+int bind( int sockfd, const struct sockaddr_t *addr, socklen_t addrlen )
+{
+    host_fd_t* entry = fd_get( sockfd, HOST_FD_SOCKET );
+
+    UNUSED_PARAMETER( addrlen );
+    if ( entry == NULL || addr == NULL )
+        return -1;
+    if ( host_sys_bind( entry->host_fd, addr->s_ip, addr->s_port ) < 0 )
+        return fd_fail( entry );
+    return 0;
+}
+
+int connect( int sockfd, const struct sockaddr_t *addr, socklen_t addrlen )
+{
+    host_fd_t* entry = fd_get( sockfd, HOST_FD_SOCKET );
+
+    UNUSED_PARAMETER( addrlen );
+    if ( entry == NULL || addr == NULL )
+        return -1;
+    if ( host_sys_connect( entry->host_fd, addr->s_ip, addr->s_port ) < 0 )
+        return fd_fail( entry );
+    return 0;
+}
+
+int listen( int sockfd, int backlog )
+{
+    host_fd_t* entry = fd_get( sockfd, HOST_FD_SOCKET );
+
+    if ( entry == NULL )
+        return -1;
+    if ( host_sys_listen( entry->host_fd, backlog ) < 0 )
+        return fd_fail( entry );
+    return 0;
+}
+
+int accept( int sockfd, struct sockaddr_t *addr, socklen_t *addrlen )
+{
+    host_fd_t* entry = fd_get( sockfd, HOST_FD_SOCKET );
+    uint32_t ip = 0;
+    uint16_t port = 0;
+    int host_fd, fd;
+
+    if ( entry == NULL )
+        return -1;
+
+    host_fd = host_sys_accept( entry->host_fd, &ip, &port );
+    if ( host_fd < 0 )
+        return fd_fail( entry );
+
+    fd = fd_alloc( HOST_FD_SOCKET, host_fd );
+    if ( fd < 0 )
+    {
+        socket_log( "No free socket for client, max %d", MICO_HOST_FD_MAX );
+        host_sys_close( host_fd );
+        entry->error = ENFILE;
+        return -1;
+    }
+
+    if ( addr != NULL )
+    {
+        memset( addr, 0, sizeof(struct sockaddr_t) );
+        addr->s_ip = ip;
+        addr->s_port = port;
+    }
+    if ( addrlen != NULL )
+        *addrlen = sizeof(struct sockaddr_t);
+    return fd;
+}
+
+/* MiCO ignores nfds, every fd in the sets is checked. The sets are rewritten
+ * with the ready fds and the timeout is left untouched. */
+int select( int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds, struct timeval_t *timeout )
+{
+    host_poll_t polls[MICO_HOST_FD_MAX];
+    int fds[MICO_HOST_FD_MAX];
+    int count = 0, ready = 0;
+    int timeout_ms, fd, i;
+
+    UNUSED_PARAMETER( nfds );
+
+    for ( fd = 0; fd < MICO_HOST_FD_MAX; fd++ )
+    {
+        uint8_t events = 0;
+
+        if ( readfds && FD_ISSET( fd, readfds ) )
+            events |= HOST_POLL_IN;
+        if ( writefds && FD_ISSET( fd, writefds ) )
+            events |= HOST_POLL_OUT;
+        if ( exceptfds && FD_ISSET( fd, exceptfds ) )
+            events |= HOST_POLL_ERR;
+        if ( events == 0 || fd_table[fd].type == HOST_FD_FREE )
+            continue;
+
+        polls[count].fd = fd_table[fd].host_fd;
+        polls[count].events = events;
+        fds[count++] = fd;
+    }
+
+    if ( timeout == NULL )
+        timeout_ms = -1;
+    else
+        timeout_ms = (int)( timeout->tv_sec * 1000 + timeout->tv_usec / 1000 );
+
+    if ( host_sys_poll( polls, count, timeout_ms ) < 0 )
+        return -1;
+
+    if ( readfds )   FD_ZERO( readfds );
+    if ( writefds )  FD_ZERO( writefds );
+    if ( exceptfds ) FD_ZERO( exceptfds );
+
+    for ( i = 0; i < count; i++ )
+    {
+        bool hit = false;
+
+        if ( readfds && ( polls[i].events & HOST_POLL_IN )
+             && ( polls[i].revents & ( HOST_POLL_IN | HOST_POLL_ERR ) ) )
+        {
+            FD_SET( fds[i], readfds );
+            hit = true;
+        }
+        if ( writefds && ( polls[i].events & HOST_POLL_OUT )
+             && ( polls[i].revents & ( HOST_POLL_OUT | HOST_POLL_ERR ) ) )
+        {
+            FD_SET( fds[i], writefds );
+            hit = true;
+        }
+        if ( exceptfds && ( polls[i].events & HOST_POLL_ERR ) && ( polls[i].revents & HOST_POLL_ERR ) )
+        {
+            FD_SET( fds[i], exceptfds );
+            hit = true;
+        }
+        if ( hit )
+            ready++;
+    }
+    return ready;
+}
+
+ssize_t send( int sockfd, const void *buf, size_t len, int flags )
+{
+    host_fd_t* entry = fd_get( sockfd, HOST_FD_SOCKET );
+    int ret;
+
+    UNUSED_PARAMETER( flags );
+    if ( entry == NULL )
+        return -1;
+    ret = host_sys_send( entry->host_fd, buf, len, 0, 0, false );
+    return ( ret < 0 ) ? fd_fail( entry ) : ret;
+}
+
+int write( int sockfd, void *buf, size_t len )
+{
+    return send( sockfd, buf, len, 0 );
+}
+
+ssize_t sendto( int sockfd, const void *buf, size_t len, int flags,
+                const struct sockaddr_t *dest_addr, socklen_t addrlen )
+{
+    host_fd_t* entry = fd_get( sockfd, HOST_FD_SOCKET );
+    int ret;
+
+    UNUSED_PARAMETER( flags );
+    UNUSED_PARAMETER( addrlen );
+    if ( entry == NULL || dest_addr == NULL )
+        return -1;
+    ret = host_sys_send( entry->host_fd, buf, len, dest_addr->s_ip, dest_addr->s_port, true );
+    return ( ret < 0 ) ? fd_fail( entry ) : ret;
+}
+
+ssize_t recv( int sockfd, void *buf, size_t len, int flags )
+{
+    host_fd_t* entry = fd_get( sockfd, HOST_FD_SOCKET );
+    int ret;
+
+    UNUSED_PARAMETER( flags );
+    if ( entry == NULL )
+        return -1;
+    ret = host_sys_recv( entry->host_fd, buf, len, NULL, NULL );
+    return ( ret < 0 ) ? fd_fail( entry ) : ret;
+}
+
+int read( int sockfd, void *buf, size_t len )
+{
+    return recv( sockfd, buf, len, 0 );
+}
+
+ssize_t recvfrom( int sockfd, void *buf, size_t len, int flags,
+                  struct sockaddr_t *src_addr, socklen_t *addrlen )
+{
+    host_fd_t* entry = fd_get( sockfd, HOST_FD_SOCKET );
+    uint32_t ip = 0;
+    uint16_t port = 0;
+    int ret;
+
+    UNUSED_PARAMETER( flags );
+    if ( entry == NULL )
+        return -1;
+    ret = host_sys_recv( entry->host_fd, buf, len, &ip, &port );
+    if ( ret < 0 )
+        return fd_fail( entry );
+
+    if ( src_addr != NULL )
+    {
+        memset( src_addr, 0, sizeof(struct sockaddr_t) );
+        src_addr->s_ip = ip;
+        src_addr->s_port = port;
+    }
+    if ( addrlen != NULL )
+        *addrlen = sizeof(struct sockaddr_t);
+    return ret;
+}
+
+int close( int fd )
+{
+    host_fd_t* entry = fd_get( fd, HOST_FD_SOCKET );
+
+    if ( entry == NULL )
+        return mico_delete_event_fd( fd );
+
+    pthread_mutex_lock( &fd_table_mutex );
+    host_sys_close( entry->host_fd );
+    entry->type = HOST_FD_FREE;
+    pthread_mutex_unlock( &fd_table_mutex );
+    return 0;
+}
+
+int mico_create_event_fd( mico_event handle )
+{
+    int pipe_fds[2];
+    int fd;
+
+    if ( host_sys_pipe( pipe_fds ) < 0 )
+        return -1;
+
+    fd = fd_alloc( HOST_FD_EVENT, pipe_fds[0] );
+    if ( fd < 0 )
+        goto exit_with_pipe;
+
+    fd_table[fd].event_wr = pipe_fds[1];
+    fd_table[fd].event = handle;
+    if ( posix_rtos_event_attach( handle, pipe_fds[0], pipe_fds[1] ) != kNoErr )
+    {
+        fd_table[fd].type = HOST_FD_FREE;
+        goto exit_with_pipe;
+    }
+    return fd;
+
+exit_with_pipe:
+    host_sys_close( pipe_fds[0] );
+    host_sys_close( pipe_fds[1] );
+    return -1;
+}
+
+int mico_delete_event_fd( int fd )
+{
+    host_fd_t* entry = fd_get( fd, HOST_FD_EVENT );
+
+    if ( entry == NULL )
+        return -1;
+
+    posix_rtos_event_attach( entry->event, -1, -1 );
+    pthread_mutex_lock( &fd_table_mutex );
+    host_sys_close( entry->host_fd );
+    host_sys_close( entry->event_wr );
+    entry->type = HOST_FD_FREE;
+    pthread_mutex_unlock( &fd_table_mutex );
+    return 0;
+}
+
+uint32_t inet_addr( char *s )
+{
+    uint32_t ip = 0;
+    unsigned int part[4];
+    char tail;
+
+    if ( s == NULL || sscanf( s, "%u.%u.%u.%u%c", &part[0], &part[1], &part[2], &part[3], &tail ) != 4 )
+        return 0xFFFFFFFF;
+    for ( int i = 0; i < 4; i++ )
+    {
+        if ( part[i] > 255 )
+            return 0xFFFFFFFF;
+        ip = ( ip << 8 ) | part[i];
+    }
+    return ip;
+}
+
+char *inet_ntoa( char *s, uint32_t x )
+{
+    sprintf( s, "%u.%u.%u.%u", (unsigned int)( ( x >> 24 ) & 0xFF ), (unsigned int)( ( x >> 16 ) & 0xFF ),
+             (unsigned int)( ( x >> 8 ) & 0xFF ), (unsigned int)( x & 0xFF ) );
+    return s;
+}
+
+int gethostbyname( const char * name, uint8_t * addr, uint8_t addrLen )
+{
+    uint32_t ip;
+    char ipstr[16];
+
+    if ( name == NULL || addr == NULL )
+        return kParamErr;
+    if ( host_sys_resolve( name, &ip ) < 0 )
+        return ENSRNOTFOUND;
+    dns_ip_set( (uint8_t *) name, ip );
+
+    inet_ntoa( ipstr, ip );
+    strncpy( (char *) addr, ipstr, addrLen );
+    if ( addrLen > 0 )
+        addr[addrLen - 1] = 0;
+    return kNoErr;
+}
+
+void set_tcp_keepalive( int inMaxErrNum, int inSeconds )
+{
+    tcp_keepalive_max_err = inMaxErrNum;
+    tcp_keepalive_seconds = inSeconds;
+}
+
+void get_tcp_keepalive( int *outMaxErrNum, int *outSeconds )
+{
+    *outMaxErrNum = tcp_keepalive_max_err;
+    *outSeconds = tcp_keepalive_seconds;
+}
+
+/* No TLS stack is linked into the host build */
+void ssl_version_set( SSL_VERSION version )
+{
+    UNUSED_PARAMETER( version );
+}
+
+void ssl_set_cert( const char *_cert_pem, const char *private_key_pem )
+{
+    UNUSED_PARAMETER( _cert_pem );
+    UNUSED_PARAMETER( private_key_pem );
+}
+
+mico_ssl_t ssl_connect( int fd, int calen, char *ca, int *ssl_errno )
+{
+    UNUSED_PARAMETER( fd );
+    UNUSED_PARAMETER( calen );
+    UNUSED_PARAMETER( ca );
+    if ( ssl_errno )
+        *ssl_errno = kUnsupportedErr;
+    return NULL;
+}
+
+mico_ssl_t ssl_accept( int fd )
+{
+    UNUSED_PARAMETER( fd );
+    return NULL;
+}
+
+int ssl_send( mico_ssl_t ssl, void* data, size_t len )
+{
+    UNUSED_PARAMETER( ssl );
+    UNUSED_PARAMETER( data );
+    UNUSED_PARAMETER( len );
+    return -1;
+}
+
+int ssl_recv( mico_ssl_t ssl, void* data, size_t len )
+{
+    UNUSED_PARAMETER( ssl );
+    UNUSED_PARAMETER( data );
+    UNUSED_PARAMETER( len );
+    return -1;
+}
+
+int ssl_close( mico_ssl_t ssl )
+{
+    UNUSED_PARAMETER( ssl );
+    return 0;
+}
+
+int CyaSSL_get_fd( mico_ssl_t ssl )
+{
+    UNUSED_PARAMETER( ssl );
+    return -1;
+}
+
+void socket_show_Command( CLI_ARGS )
+{
+    int fd;
+
+    pthread_mutex_lock( &fd_table_mutex );
+    for ( fd = 0; fd < MICO_HOST_FD_MAX; fd++ )
+    {
+        if ( fd_table[fd].type == HOST_FD_SOCKET )
+            cmd_printf( "fd %d: %s socket, host fd %d, error %d\r\n", fd,
+                        host_sys_socket_type( fd_table[fd].host_fd ) == SOCK_STREAM ? "TCP" : "UDP",
+                        fd_table[fd].host_fd, fd_table[fd].error );
+        else if ( fd_table[fd].type == HOST_FD_EVENT )
+            cmd_printf( "fd %d: event, host fd %d\r\n", fd, fd_table[fd].host_fd );
+    }
+    pthread_mutex_unlock( &fd_table_mutex );
+}
@@ -0,0 +1,277 @@
+/**
+******************************************************************************
+* @file    mico_wlan.c
+* @author  William Xu
+* @version V1.0.0
+* @date    17-Oct-2026
+* @brief   This file provides the MiCO wlan APIs on the host (POSIX) platform.
+*          There is no RF here: the host network interface stands for a
+*          station that is always associated, so every connect request
+*          succeeds and reports the host's own address.
+******************************************************************************
+*
+*  The MIT License
+*  Copyright (c) 2016 MXCHIP Inc.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy 
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights 
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is furnished
+*  to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in
+*  all copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+*  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR 
+*  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+******************************************************************************
+*/ 
+
+#include "MICO.h"
+#include "host_sys.h"
+
+#define wlan_log(M, ...) custom_log("WLAN", M, ##__VA_ARGS__)
+
+/******************************************************
+ *                    Constants
+ ******************************************************/
+
+#define HOST_WLAN_SSID          "host"
+#define HOST_WLAN_STRENGTH      (100)
+
+/******************************************************
+ *               Variables Definitions
+ ******************************************************/
+
+static bool         wlan_station_up = false;
+static bool         wlan_softap_up = false;
+static char         wlan_ssid[33] = HOST_WLAN_SSID;
+
+/******************************************************
+ *               Function Declarations
+ ******************************************************/
+
+/* Notification hooks, implemented in MICO/system/mico_system_notification.c */
+extern void ApListCallback( ScanResult *pApList );
+extern void ApListAdvCallback( ScanResult_adv *pApAdvList );
+extern void WifiStatusHandler( WiFiEvent status );
+extern void connected_ap_info( apinfo_adv_t *ap_info, char *key, int key_len );
+extern void NetCallback( IPStatusTypedef *pnet );
+
+/******************************************************
+ *               Function Definitions
+ ******************************************************/
+
+static void wlan_fill_ip_status( IPStatusTypedef *outNetpara )
+{
+  uint32_t ip, mask, dns;
+  uint8_t mac[6];
+
+  memset( outNetpara, 0x0, sizeof(IPStatusTypedef) );
+  host_sys_interface( &ip, &mask, mac );
+  /* The host's own DNS server answers the queries of the MiCO resolver */
+  if( host_sys_nameserver( &dns ) < 0 )
+    dns = ( ip & mask ) | 0x1;
+
+  outNetpara->dhcp = DHCP_Client;
+  inet_ntoa( outNetpara->ip, ip );
+  inet_ntoa( outNetpara->mask, mask );
+  inet_ntoa( outNetpara->gate, ( ip & mask ) | 0x1 );
+  inet_ntoa( outNetpara->dns, dns );
+  inet_ntoa( outNetpara->broadcastip, ip | ~mask );
+  sprintf( outNetpara->mac, "%02X%02X%02X%02X%02X%02X", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5] );
+}
+
+/* Notifications are delivered from their own thread like on the module,
+ * never from inside the caller of micoWlanStart() */
+static void wlan_station_up_thread( void *arg )
+{
+  IPStatusTypedef ip_status;
+  apinfo_adv_t ap_info;
+
+  UNUSED_PARAMETER( arg );
+
+  memset( &ap_info, 0x0, sizeof(ap_info) );
+  strncpy( ap_info.ssid, wlan_ssid, sizeof(ap_info.ssid) );
+  ap_info.channel = 1;
+  ap_info.security = SECURITY_TYPE_NONE;
+
+  wlan_station_up = true;
+  WifiStatusHandler( NOTIFY_STATION_UP );
+  connected_ap_info( &ap_info, "", 0 );
+
+  wlan_fill_ip_status( &ip_status );
+  wlan_log( "Station up, IP address: %s", ip_status.ip );
+  NetCallback( &ip_status );
+
+  mico_rtos_delete_thread( NULL );
+}
+
+static void wlan_softap_up_thread( void *arg )
+{
+  UNUSED_PARAMETER( arg );
+  wlan_softap_up = true;
+  WifiStatusHandler( NOTIFY_AP_UP );
+  mico_rtos_delete_thread( NULL );
+}
+
+static OSStatus wlan_start( char mode, const char *ssid )
+{
+  mico_thread_function_t function = ( mode == Soft_AP ) ? wlan_softap_up_thread : wlan_station_up_thread;
+
+  if ( mode == Station ) {
+    memset( wlan_ssid, 0x0, sizeof(wlan_ssid) );
+    strncpy( wlan_ssid, ssid, 32 );
+  }
+  return mico_rtos_create_thread( NULL, MICO_NETWORK_WORKER_PRIORITY, "wlan", function, 0x800, NULL );
+}
+
+OSStatus micoWlanStart( network_InitTypeDef_st* inNetworkInitPara )
+{
+  if ( inNetworkInitPara == NULL )
+    return kParamErr;
+  return wlan_start( inNetworkInitPara->wifi_mode, inNetworkInitPara->wifi_ssid );
+}
+
+OSStatus micoWlanStartAdv( network_InitTypeDef_adv_st* inNetworkInitParaAdv )
+{
+  if ( inNetworkInitParaAdv == NULL )
+    return kParamErr;
+  return wlan_start( Station, inNetworkInitParaAdv->ap_info.ssid );
+}
+
+OSStatus micoWlanGetIPStatus( IPStatusTypedef *outNetpara, WiFi_Interface inInterface )
+{
+  UNUSED_PARAMETER( inInterface );
+  if ( outNetpara == NULL )
+    return kParamErr;
+
+  wlan_fill_ip_status( outNetpara );
+  return kNoErr;
+}
+
+OSStatus micoWlanGetLinkStatus( LinkStatusTypeDef *outStatus )
+{
+  if ( outStatus == NULL )
+    return kParamErr;
+
+  memset( outStatus, 0x0, sizeof(LinkStatusTypeDef) );
+  outStatus->is_connected = wlan_station_up;
+  if ( wlan_station_up ) {
+    outStatus->wifi_strength = HOST_WLAN_STRENGTH;
+    strncpy( (char *)outStatus->ssid, wlan_ssid, sizeof(outStatus->ssid) );
+    outStatus->channel = 1;
+  }
+  return kNoErr;
+}
+
+void micoWlanStartScan( void )
+{
+  ScanResult result = { 0, NULL };
+  ApListCallback( &result );
+}
+
+void micoWlanStartScanAdv( void )
+{
+  ScanResult_adv result = { 0, NULL };
+  ApListAdvCallback( &result );
+}
+
+OSStatus micoWlanPowerOff( void )
+{
+  return micoWlanSuspend( );
+}
+
+OSStatus micoWlanPowerOn( void )
+{
+  return kNoErr;
+}
+
+OSStatus micoWlanSuspend( void )
+{
+  micoWlanSuspendStation( );
+  micoWlanSuspendSoftAP( );
+  return kNoErr;
+}
+
+OSStatus micoWlanSuspendStation( void )
+{
+  if ( wlan_station_up ) {
+    wlan_station_up = false;
+    WifiStatusHandler( NOTIFY_STATION_DOWN );
+  }
+  return kNoErr;
+}
+
+OSStatus micoWlanSuspendSoftAP( void )
+{
+  if ( wlan_softap_up ) {
+    wlan_softap_up = false;
+    WifiStatusHandler( NOTIFY_AP_DOWN );
+  }
+  return kNoErr;
+}
+
+OSStatus micoWlanStartEasyLink( int inTimeout )
+{
+  UNUSED_PARAMETER( inTimeout );
+  return kUnsupportedErr;
+}
+
+OSStatus micoWlanStartEasyLinkPlus( int inTimeout )
+{
+  UNUSED_PARAMETER( inTimeout );
+  return kUnsupportedErr;
+}
+
+OSStatus micoWlanStopEasyLink( void )
+{
+  return kNoErr;
+}
+
+OSStatus micoWlanStopEasyLinkPlus( void )
+{
+  return kNoErr;
+}
+
+OSStatus micoWlanStartWPS( int inTimeout )
+{
+  UNUSED_PARAMETER( inTimeout );
+  return kUnsupportedErr;
+}
+
+OSStatus micoWlanStopWPS( void )
+{
+  return kNoErr;
+}
+
+OSStatus micoWlanStartAirkiss( int inTimeout )
+{
+  UNUSED_PARAMETER( inTimeout );
+  return kUnsupportedErr;
+}
+
+OSStatus micoWlanStopAirkiss( void )
+{
+  return kNoErr;
+}
+
+void micoWlanEnablePowerSave( void )
+{
+
+}
+
+void micoWlanDisablePowerSave( void )
+{
+
+}
+
+void wifimgr_debug_enable( bool enable )
+{
+  UNUSED_PARAMETER( enable );
+}
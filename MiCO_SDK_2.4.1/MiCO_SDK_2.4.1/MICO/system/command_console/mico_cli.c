@@ -435,6 +435,28 @@ static void uptime_Command(char *pcWriteBuffer, int xWriteBufferLen,int argc, ch
     cmd_printf("UP time %dms\r\n", mico_get_time());
 }
 
+static void boot_trace_Command(char *pcWriteBuffer, int xWriteBufferLen,int argc, char **argv)
+{
+    system_boot_trace_print( cli_printf );
+}
+
+static void ready_Command(char *pcWriteBuffer, int xWriteBufferLen,int argc, char **argv)
+{
+    system_ready_print( cli_printf );
+}
+
+static void dns_cache_Command(char *pcWriteBuffer, int xWriteBufferLen,int argc, char **argv)
+{
+    if( argc > 1 && strcmp( argv[1], "flush" ) == 0 )
+      mico_system_dns_flush( );
+    system_dns_print( cli_printf );
+}
+
+static void timers_Command(char *pcWriteBuffer, int xWriteBufferLen,int argc, char **argv)
+{
+    system_timer_print( cli_printf );
+}
+
 static void ota_Command(char *pcWriteBuffer, int xWriteBufferLen,int argc, char **argv)
 {
 extern void tftp_ota(void);
@@ -544,6 +566,10 @@ static const struct cli_command built_ins[] = {
   {"reboot", "reboot MiCO system", reboot},
   {"tftp",     "tftp",                        tftp_Command},
   {"time",     "system time",                 uptime_Command},
+  {"boottrace", "boot phase times",           boot_trace_Command},
+  {"ready",    "system readiness events",     ready_Command},
+  {"dnscache", "dns cache [flush]",           dns_cache_Command},
+  {"timers",   "system timer service",        timers_Command},
   {"ota",      "system ota",                  ota_Command},
   {"flash",    "Flash memory map",            partShow_Command},
 };
@@ -551,7 +577,7 @@ static const struct cli_command built_ins[] = {
 int cli_register_command(const struct cli_command *command)
 {
   int i;
-  if (!command->name || !command->function)
+  if (!command->name || !command->function || pCli == NULL)
     return 1;
   
   if (pCli->num_commands < MAX_COMMANDS) {
@@ -37,6 +37,9 @@
 #include "HTTPUtils.h"
 #include "StringUtils.h"
 #include "CheckSumUtils.h"
+#ifdef MICO_CLI_ENABLE
+#include "mico_cli.h"
+#endif
 
 #define config_log(M, ...) custom_log("CONFIG SERVER", M, ##__VA_ARGS__)
 #define config_log_trace() custom_log_trace("CONFIG SERVER")
@@ -48,17 +51,48 @@
 
 #define kMIMEType_MXCHIP_OTA    "application/ota-stream"
 
+#define CONFIG_CLIENT_HEADER_LEN     512
+#define CONFIG_CLIENT_MAX_BODY_LEN   2048    /* Largest JSON body accepted, OTA images are streamed */
+#define CONFIG_CLIENT_STALL_TIMEOUT  5000    /* ms a client may pause in the middle of a message or a response */
+#define CONFIG_CLIENT_MAX_OUTPUT     4096    /* Largest response kept while the client does not take it */
+#define CONFIG_CLIENT_FLASH_POLL     20      /* ms between checks whether the OTA writer takes more data */
+
 typedef struct _configContext_t{
-  uint32_t offset;
+  mico_ota_writer_t *ota_writer;
   bool     isFlashLocked;
-  CRC16_Context crc16_contex;
+  bool     isRefused;      /* Sent an OTA while another client owns the flash */
 } configContext_t;
 
+/* One connected client, served by the listener thread */
+typedef struct _config_client_t{
+  int             fd;
+  HTTPHeader_t    *httpHeader;
+  configContext_t httpContext;
+  uint32_t        lastActive;
+  size_t          memory;        /* RAM held for this client, for the CLI */
+  uint8_t         *out;          /* Response bytes the socket has not taken yet */
+  uint8_t         *outPtr;
+  size_t          outLen;
+  bool            closing;       /* Closed once the queued response is sent */
+} config_client_t;
+
+/* Snapshot of everything /config-read reports, taken under the config lock */
+typedef struct _config_report_t{
+  mico_sys_config_t sys;
+  char              name[50];
+  char              localIp[maxIpLen];
+  char              netMask[maxIpLen];
+  char              gateWay[maxIpLen];
+  char              dnsServer[maxIpLen];
+  char              rf_version[50];
+  json_object       *app_sector;
+  char              window[512];
+} config_report_t;
+
 extern OSStatus     ConfigIncommingJsonMessage( const char *input, bool *need_reboot, mico_Context_t * const inContext );
 extern json_object* ConfigCreateReportJsonMessage( mico_Context_t * const inContext );
 
 static void localConfiglistener_thread(void *inContext);
-static void localConfig_thread(void *inFd);
 static mico_Context_t *Context;
 static OSStatus _LocalConfigRespondInComingMessage(int fd, HTTPHeader_t* inHeader, mico_Context_t * const inContext);
 static OSStatus onReceivedData(struct _HTTPHeader_t * httpHeader, uint32_t pos, uint8_t * data, size_t len, void * userContext );
@@ -69,7 +103,12 @@ bool is_config_server_established = false;
 /* Defined in uAP config mode */
 extern OSStatus     ConfigIncommingJsonMessageUAP( const uint8_t *input, size_t size );
 
-static mico_semaphore_t close_listener_sem = NULL, close_client_sem[ MAX_TCP_CLIENT_PER_SERVER ] = { NULL };
+static mico_semaphore_t close_listener_sem = NULL;
+static mico_semaphore_t listener_started_sem = NULL;
+static config_client_t config_clients[ MAX_TCP_CLIENT_PER_SERVER ];
+/* Client writing an OTA image. flashContentInRam_mutex is recursive and every client
+   is served by the listener thread, so the lock alone does not keep the others out */
+static config_client_t *flash_owner = NULL;
 
 WEAK void config_server_delegate_report( json_object *app_menu, mico_Context_t *in_context )
 {
@@ -87,9 +126,32 @@ WEAK void config_server_delegate_recv( const char *key, json_object *value, bool
   return;  
 }
 
+#ifdef MICO_CLI_ENABLE
+static void config_server_Command(char *pcWriteBuffer, int xWriteBufferLen,int argc, char **argv)
+{
+  int i, clients = 0;
+  size_t total = 0;
+  uint32_t now = mico_get_time();
+  config_client_t *client;
+
+  cmd_printf("Config server %s, port %d\r\n", is_config_server_established ? "running" : "stopped", MICO_CONFIG_SERVER_PORT);
+  for( i = 0; i < MAX_TCP_CLIENT_PER_SERVER; i++ ){
+    client = &config_clients[i];
+    if( client->fd < 0 || client->httpHeader == NULL ) continue;
+    cmd_printf("  fd %d: %d bytes, idle %d ms\r\n", client->fd, (int)client->memory, (int)(now - client->lastActive));
+    total += client->memory;
+    clients++;
+  }
+  cmd_printf("%d/%d clients, %d bytes, body limit %d bytes\r\n", clients, MAX_TCP_CLIENT_PER_SERVER, (int)total, CONFIG_CLIENT_MAX_BODY_LEN);
+}
+
+static const struct cli_command config_server_clis[] = {
+  {"configserver", "show config server clients", config_server_Command},
+};
+#endif
+
 OSStatus config_server_start ( mico_Context_t *in_context )
 {
-  int i = 0;
   OSStatus err = kNoErr;
   
   require( in_context, exit );
@@ -100,12 +162,17 @@ OSStatus config_server_start ( mico_Context_t *in_context )
   is_config_server_established = true;
 
   close_listener_sem = NULL;
-  for (; i < MAX_TCP_CLIENT_PER_SERVER; i++)
-    close_client_sem[ i ] = NULL;
+#ifdef MICO_CLI_ENABLE
+  cli_register_command( &config_server_clis[0] );
+#endif
+  /* config_server_stop( ) can be called once the listener has its close semaphore */
+  mico_rtos_init_semaphore( &listener_started_sem, 1 );
   err = mico_rtos_create_thread( NULL, MICO_APPLICATION_PRIORITY, "Config Server", localConfiglistener_thread, STACK_SIZE_LOCAL_CONFIG_SERVER_THREAD, (void*)in_context );
+  if( err == kNoErr )
+    mico_rtos_get_semaphore( &listener_started_sem, MICO_WAIT_FOREVER );
+  mico_rtos_deinit_semaphore( &listener_started_sem );
+  listener_started_sem = NULL;
   require_noerr(err, exit);
-  
-  mico_thread_msleep(200);
 
 exit:
   return err;
@@ -113,18 +180,12 @@ exit:
 
 OSStatus config_server_stop( void )
 {
-  int i = 0;
   OSStatus err = kNoErr;
 
   if( !is_config_server_established )
     return kNoErr;
 
-  for (; i < MAX_TCP_CLIENT_PER_SERVER; i++){
-    if( close_client_sem[ i ] != NULL )
-      mico_rtos_set_semaphore( &close_client_sem[ i ] );
-  }
-  mico_thread_msleep(50);
-
+  /* The listener closes every client on its way out */
   if( close_listener_sem != NULL )
     mico_rtos_set_semaphore( &close_listener_sem );
 
@@ -134,24 +195,254 @@ OSStatus config_server_stop( void )
   return err;
 }
 
+static void config_client_close( config_client_t *client )
+{
+  config_log("Client fd: %d closed", client->fd);
+  SocketClose( &client->fd );
+  /* Clearing the header also drops an unfinished OTA and the flash lock */
+  HTTPHeaderDestory( &client->httpHeader );
+  if( client->out ) free( client->out );
+  client->out = client->outPtr = NULL;
+  client->outLen = 0;
+  client->fd = -1;
+}
+
+/* A response still queued also keeps the client busy */
+static bool config_client_in_message( config_client_t *client )
+{
+  return client->httpHeader->len || client->httpHeader->headerReceived || client->outLen;
+}
+
+/* An OTA image is only read while the writer takes it without waiting for flash */
+static bool config_client_flash_busy( config_client_t *client )
+{
+  return !mico_ota_writer_ready( client->httpContext.ota_writer );
+}
+
+static bool config_client_would_block( int fd )
+{
+  int so_error = 0;
+  socklen_t len = sizeof(so_error);
+
+  getsockopt( fd, SOL_SOCKET, SO_ERROR, &so_error, &len );
+  /* lwIP reports a full send buffer as ENOMEM */
+  return so_error == EAGAIN || so_error == EWOULDBLOCK || so_error == ENOMEM;
+}
+
+/* Sends what the socket takes now and queues the rest, the listener never waits for a client */
+static OSStatus config_client_send( config_client_t *client, const uint8_t *data, size_t len )
+{
+  OSStatus err = kNoErr;
+  uint8_t *out;
+  int n;
+
+  while( client->outLen == 0 && len ){
+    n = send( client->fd, (void *)data, len, 0 );
+    if( n < 0 && config_client_would_block( client->fd ) ) break;
+    require_action( n > 0, exit, err = kConnectionErr );
+    data += n;
+    len -= n;
+  }
+  require_quiet( len, exit );
+
+  require_action( client->outLen + len <= CONFIG_CLIENT_MAX_OUTPUT, exit, err = kNoSpaceErr );
+  out = malloc( client->outLen + len );
+  require_action( out, exit, err = kNoMemoryErr );
+  if( client->outLen ) memcpy( out, client->outPtr, client->outLen );
+  memcpy( out + client->outLen, data, len );
+  if( client->out ) free( client->out );
+  client->out = client->outPtr = out;
+  client->outLen += len;
+
+exit:
+  return err;
+}
+
+/* Called when the client socket is writable, sends the queued response */
+static OSStatus config_client_flush( config_client_t *client )
+{
+  OSStatus err = kNoErr;
+  int n;
+
+  while( client->outLen ){
+    n = send( client->fd, client->outPtr, client->outLen, 0 );
+    if( n < 0 && config_client_would_block( client->fd ) ) break;
+    require_action( n > 0, exit, err = kConnectionErr );
+    client->outPtr += n;
+    client->outLen -= n;
+    client->lastActive = mico_get_time();
+  }
+
+  if( client->outLen == 0 ){
+    free( client->out );
+    client->out = client->outPtr = NULL;
+  }
+
+exit:
+  client->memory = HTTPHeaderMemoryUsage( client->httpHeader ) + client->outLen;
+  return err;
+}
+
+static void config_client_open( int fd )
+{
+  int i, opt = 1;
+  config_client_t *client = NULL;
+
+  for( i = 0; i < MAX_TCP_CLIENT_PER_SERVER; i++ ){
+    if( config_clients[i].fd < 0 ){
+      client = &config_clients[i];
+      break;
+    }
+  }
+
+  /* All slots taken: a phone app that reconnects often leaves its old connection
+     behind, so make room by dropping the client that has been idle the longest */
+  if( client == NULL ){
+    for( i = 0; i < MAX_TCP_CLIENT_PER_SERVER; i++ ){
+      if( config_client_in_message( &config_clients[i] ) ) continue;
+      if( client == NULL || (int32_t)(config_clients[i].lastActive - client->lastActive) < 0 )
+        client = &config_clients[i];
+    }
+    if( client == NULL ){
+      config_log("No room for client fd: %d", fd);
+      SocketClose( &fd );
+      return;
+    }
+    config_client_close( client );
+  }
+
+  client->httpContext.ota_writer = NULL;
+  client->httpContext.isFlashLocked = false;
+  client->httpContext.isRefused = false;
+  client->httpHeader = HTTPHeaderCreateWithCallback( CONFIG_CLIENT_HEADER_LEN, onReceivedData, onClearHTTPHeader, client );
+  if( client->httpHeader == NULL ){
+    config_log("ERROR: No memory for client fd: %d", fd);
+    SocketClose( &fd );
+    return;
+  }
+  HTTPHeaderClear( client->httpHeader );
+  client->httpHeader->maxBodyLen = CONFIG_CLIENT_MAX_BODY_LEN;
+  client->fd = fd;
+  client->closing = false;
+  client->lastActive = mico_get_time();
+  client->memory = HTTPHeaderMemoryUsage( client->httpHeader );
+  setsockopt( fd, SOL_SOCKET, SO_BLOCKMODE, &opt, sizeof(opt) );
+}
+
+/* Answer a request that has to wait until the flash owner is done */
+static OSStatus config_client_respond_busy( config_client_t *client )
+{
+  OSStatus err;
+  uint8_t *httpResponse = NULL;
+  size_t httpResponseLen = 0;
+
+  err = CreateHTTPRespondMessageNoCopy( kStatusServiceUnavailable, NULL, 0, &httpResponse, &httpResponseLen );
+  require_noerr( err, exit );
+  err = config_client_send( client, httpResponse, httpResponseLen );
+
+exit:
+  if( httpResponse ) free( httpResponse );
+  return err;
+}
+
+/* Called when the client socket is readable, reads what is there and answers every complete request */
+static OSStatus config_client_serve( config_client_t *client )
+{
+  OSStatus err;
+  char *end;
+
+  client->lastActive = mico_get_time();
+
+  do{
+    err = SocketReadHTTPMessageStep( client->fd, client->httpHeader );
+    /* Answered as soon as its header is in, not after the whole image */
+    if( client->httpContext.isRefused ){
+      config_log("Flash is owned by fd: %d, OTA from fd: %d refused", flash_owner ? flash_owner->fd : -1, client->fd);
+      config_client_respond_busy( client );
+      err = kConnectionErr;
+      goto exit;
+    }
+    if( err == kInProgressErr ){
+      err = kNoErr;
+      break;
+    }
+
+    switch ( err )
+    {
+      case kNoErr:
+        err = _LocalConfigRespondInComingMessage( client->fd, client->httpHeader, Context );
+        require_noerr(err, exit);
+        HTTPHeaderClear( client->httpHeader );
+      break;
+
+      case kNoSpaceErr:
+        config_log("ERROR: Cannot fit HTTPHeader.");
+        goto exit;
+
+      case kSizeErr:
+        config_log("ERROR: Body is larger than %d bytes.", CONFIG_CLIENT_MAX_BODY_LEN);
+        goto exit;
+
+      case kConnectionErr:
+        // NOTE: kConnectionErr from SocketReadHTTPMessageStep means it's closed
+        config_log("ERROR: Connection closed.");
+        goto exit;
+
+      default:
+        config_log("ERROR: HTTP Header parse internal error: %d", err);
+        goto exit;
+    }
+    /* A pipelined request may already be complete in the header buffer, it is
+       answered once the socket has taken this response */
+  }while( client->outLen == 0 && client->httpHeader->len && findHeader( client->httpHeader, &end ) );
+
+exit:
+  client->memory = HTTPHeaderMemoryUsage( client->httpHeader ) + client->outLen;
+  return err;
+}
+
+/* The connection ends after a failed request or a response without keep-alive,
+   but not before the queued response is sent */
+static void config_client_end( config_client_t *client )
+{
+  if( client->outLen )
+    client->closing = true;
+  else
+    config_client_close( client );
+}
+
 void localConfiglistener_thread(void *inContext)
 {
   config_log_trace();
   OSStatus err = kUnknownErr;
-  int j;
+  int i, j;
   Context = inContext;
   struct sockaddr_t addr;
   int sockaddr_t_size;
-  fd_set readfds;
+  fd_set readfds, writefds;
+  struct timeval_t t;
+  bool client_in_message, flash_busy;
+  uint32_t now;
   char ip_address[16];
-  
+  char *end;
+  config_client_t *client;
+
   int localConfiglistener_fd = -1;
   int close_listener_fd = -1;
 
+  for( i = 0; i < MAX_TCP_CLIENT_PER_SERVER; i++ ){
+    config_clients[i].fd = -1;
+    config_clients[i].httpHeader = NULL;
+    config_clients[i].out = NULL;
+    config_clients[i].outLen = 0;
+  }
+
   mico_rtos_init_semaphore( &close_listener_sem, 1);
   close_listener_fd = mico_create_event_fd( close_listener_sem );
+  if( listener_started_sem != NULL )
+    mico_rtos_set_semaphore( &listener_started_sem );
 
-  /*Establish a TCP server fd that accept the tcp clients connections*/ 
+  /*Establish a TCP server fd that accept the tcp clients connections*/
   localConfiglistener_fd = socket( AF_INET, SOCK_STREAM, IPPROTO_TCP );
   require_action(IsValidSocket( localConfiglistener_fd ), exit, err = kNoResourcesErr );
   addr.s_ip = INADDR_ANY;
@@ -163,12 +454,35 @@ void localConfiglistener_thread(void *inContext)
   require_noerr( err, exit );
 
   config_log("Config Server established at port: %d, fd: %d", MICO_CONFIG_SERVER_PORT, localConfiglistener_fd);
-  
+  config_log("Free memory %d bytes", MicoGetMemoryInfo()->free_memory) ;
+
+  /* This thread serves the listener and every client, a client only costs its HTTP buffers.
+     It never blocks on a client: responses are queued until the socket is writable, and
+     the next request is only read once the response is out and the flash is ready. */
   while(1){
     FD_ZERO(&readfds);
+    FD_ZERO(&writefds);
     FD_SET(localConfiglistener_fd, &readfds);
     FD_SET(close_listener_fd, &readfds);
-    select(1, &readfds, NULL, NULL, NULL);
+    client_in_message = false;
+    flash_busy = false;
+    for( i = 0; i < MAX_TCP_CLIENT_PER_SERVER; i++ ){
+      client = &config_clients[i];
+      if( client->fd < 0 ) continue;
+      if( client->outLen )
+        FD_SET(client->fd, &writefds);
+      else if( config_client_flash_busy( client ) )
+        flash_busy = true;
+      else
+        FD_SET(client->fd, &readfds);
+      if( config_client_in_message( client ) )
+        client_in_message = true;
+    }
+
+    /* Wake up now and then to drop clients that stop in the middle of a message */
+    t.tv_sec = flash_busy ? 0 : 1;
+    t.tv_usec = flash_busy ? CONFIG_CLIENT_FLASH_POLL * 1000 : 0;
+    select(1, &readfds, &writefds, NULL, client_in_message ? &t : NULL);
 
     /* Check close requests */
     if(FD_ISSET(close_listener_fd, &readfds)){
@@ -183,13 +497,42 @@ void localConfiglistener_thread(void *inContext)
       if ( IsValidSocket( j ) ) {
         inet_ntoa(ip_address, addr.s_ip );
         config_log("Config Client %s:%d connected, fd: %d", ip_address, addr.s_port, j);
-        if(kNoErr !=  mico_rtos_create_thread(NULL, MICO_APPLICATION_PRIORITY, "Config Clients", localConfig_thread, STACK_SIZE_LOCAL_CONFIG_CLIENT_THREAD, (void *)j) )
-          SocketClose(&j);
+        config_client_open( j );
+      }
+    }
+
+    now = mico_get_time();
+    for( i = 0; i < MAX_TCP_CLIENT_PER_SERVER; i++ ){
+      client = &config_clients[i];
+      if( client->fd < 0 ) continue;
+      if( FD_ISSET(client->fd, &writefds) ){
+        if( config_client_flush( client ) != kNoErr ){
+          config_client_close( client );
+        }else if( client->outLen == 0 ){
+          if( client->closing )
+            config_client_close( client );
+          else if( client->httpHeader->len && findHeader( client->httpHeader, &end )
+                  && config_client_serve( client ) != kNoErr )
+            config_client_end( client );
+        }
+      }
+      else if( FD_ISSET(client->fd, &readfds) ){
+        if( config_client_serve( client ) != kNoErr )
+          config_client_end( client );
+      }
+      else if( config_client_in_message( client )
+              && now - client->lastActive > CONFIG_CLIENT_STALL_TIMEOUT ){
+        config_log("Client fd: %d timeout", client->fd);
+        config_client_close( client );
       }
     }
   }
 
 exit:
+    for( i = 0; i < MAX_TCP_CLIENT_PER_SERVER; i++ ){
+      if( config_clients[i].fd >= 0 )
+        config_client_close( &config_clients[i] );
+    }
     if( close_listener_sem != NULL ){
       mico_delete_event_fd( close_listener_fd );
       mico_rtos_deinit_semaphore( &close_listener_sem );
@@ -202,127 +545,16 @@ exit:
     return;
 }
 
-void localConfig_thread(void *inFd)
-{
-  OSStatus err;
-  int clientFd = (int)inFd;
-  int clientFdIsSet;
-  int close_sem_index;
-  fd_set readfds;
-  struct timeval_t t;
-  HTTPHeader_t *httpHeader = NULL;
-  int close_client_fd = -1;
-  configContext_t httpContext = {0, false, 0};
-
-  for( close_sem_index = 0; close_sem_index < MAX_TCP_CLIENT_PER_SERVER; close_sem_index++ ){
-    if( close_client_sem[close_sem_index] == NULL )
-      break;
-  }
-
-  if( close_sem_index == MAX_TCP_CLIENT_PER_SERVER){
-    mico_rtos_delete_thread(NULL);
-    return;
-  }
-
-  mico_rtos_init_semaphore( &close_client_sem[close_sem_index], 1);
-  close_client_fd = mico_create_event_fd( close_client_sem[close_sem_index] );
-
-  config_log_trace();
-  httpHeader = HTTPHeaderCreateWithCallback( 512, onReceivedData, onClearHTTPHeader, &httpContext );
-  require_action( httpHeader, exit, err = kNoMemoryErr );
-  HTTPHeaderClear( httpHeader );
-
-  t.tv_sec = 60;
-  t.tv_usec = 0;
-  config_log("Free memory %d bytes", MicoGetMemoryInfo()->free_memory) ; 
-
-  while(1){
-    FD_ZERO(&readfds);
-    FD_SET(clientFd, &readfds);
-    FD_SET(close_client_fd, &readfds);
-    clientFdIsSet = 0;
-
-    if(httpHeader->len == 0){
-      require(select(1, &readfds, NULL, NULL, &t) >= 0, exit);
-      clientFdIsSet = FD_ISSET(clientFd, &readfds);
-    }
-
-    /* Check close requests */
-    if(FD_ISSET(close_client_fd, &readfds)){
-      mico_rtos_get_semaphore( &close_client_sem[close_sem_index], 0 );
-      err = kConnectionErr;
-      goto exit;
-    }    
-  
-    if(clientFdIsSet||httpHeader->len){
-      err = SocketReadHTTPHeader( clientFd, httpHeader );
-
-      switch ( err )
-      {
-        case kNoErr:
-          // Read the rest of the HTTP body if necessary
-          //do{
-          err = SocketReadHTTPBody( clientFd, httpHeader );
-          
-          if(httpHeader->dataEndedbyClose == true){
-            err = _LocalConfigRespondInComingMessage( clientFd, httpHeader, Context );
-            require_noerr(err, exit);
-            err = kConnectionErr;
-            goto exit;
-          }else{
-            require_noerr(err, exit);
-            err = _LocalConfigRespondInComingMessage( clientFd, httpHeader, Context );
-            require_noerr(err, exit);
-          }
-
-          HTTPHeaderClear( httpHeader );
-        break;
-
-        case EWOULDBLOCK:
-            // NO-OP, keep reading
-        break;
-
-        case kNoSpaceErr:
-          config_log("ERROR: Cannot fit HTTPHeader.");
-          goto exit;
-        
-        case kConnectionErr:
-          // NOTE: kConnectionErr from SocketReadHTTPHeader means it's closed
-          config_log("ERROR: Connection closed.");
-          goto exit;
-
-        default:
-          config_log("ERROR: HTTP Header parse internal error: %d", err);
-          goto exit;
-      }
-    }
-  }
-
-exit:
-  config_log("Exit: Client exit with err = %d", err);
-  SocketClose(&clientFd);
-
-  if( close_client_sem[close_sem_index] != NULL )
-  {
-    mico_delete_event_fd( close_client_fd );
-    mico_rtos_deinit_semaphore( &close_client_sem[close_sem_index] );
-    close_client_sem[close_sem_index] = NULL;
-  };
-
-  HTTPHeaderDestory( &httpHeader );
-  mico_rtos_delete_thread(NULL);
-  return;
-}
-
 static OSStatus onReceivedData(struct _HTTPHeader_t * inHeader, uint32_t inPos, uint8_t * inData, size_t inLen, void * inUserContext )
 {
   OSStatus err = kUnknownErr;
   const char *    value;
   size_t          valueSize;
-  configContext_t *context = (configContext_t *)inUserContext;
+  config_client_t *client = (config_client_t *)inUserContext;
+  configContext_t *context = &client->httpContext;
   mico_logic_partition_t* ota_partition = MicoFlashGetInfo( MICO_PARTITION_OTA_TEMP );
 
-  err = HTTPGetHeaderField( inHeader->buf, inHeader->len, "Content-Type", NULL, NULL, &value, &valueSize, NULL );
+  err = HTTPHeaderGetField( inHeader, kHTTPHeaderField_ContentType, &value, &valueSize );
   if(err == kNoErr && strnicmpx( value, valueSize, kMIMEType_MXCHIP_OTA ) == 0){
     printf("%d/", inPos);
 
@@ -331,156 +563,210 @@ static OSStatus onReceivedData(struct _HTTPHeader_t * inHeader, uint32_t inPos,
       return kUnsupportedErr;
     }
 
+     /* Streamed and dropped until config_client_serve( ) refuses it */
+     if(inPos == 0 && flash_owner != NULL && flash_owner != client)
+       context->isRefused = true;
+     if(context->isRefused)
+       return kNoErr;
+
      if(inPos == 0){
-       context->offset = 0x0;
-       CRC16_Init( &context->crc16_contex );
-       mico_rtos_lock_mutex(&Context->flashContentInRam_mutex); //We are write the Flash content, no other write is possible
-       context->isFlashLocked = true;
-       err = MicoFlashErase( MICO_PARTITION_OTA_TEMP, 0x0, ota_partition->partition_length);
-       require_noerr(err, flashErrExit);
-       err = MicoFlashWrite( MICO_PARTITION_OTA_TEMP, &context->offset, (uint8_t *)inData, inLen);
-       require_noerr(err, flashErrExit);
-       CRC16_Update( &context->crc16_contex, inData, inLen);
-     }else{
-       err = MicoFlashWrite( MICO_PARTITION_OTA_TEMP, &context->offset, (uint8_t *)inData, inLen);
-       require_noerr(err, flashErrExit);
-       CRC16_Update( &context->crc16_contex, inData, inLen);
+       mico_ota_writer_abort( &context->ota_writer );
+       flash_owner = client;
+       if(context->isFlashLocked == false){
+         mico_rtos_lock_mutex(&Context->flashContentInRam_mutex); //We are write the Flash content, no other write is possible
+         context->isFlashLocked = true;
+       }
+       /* Sectors are erased as the image arrives, the flash thread programs while we receive */
+       err = mico_ota_writer_start( &context->ota_writer, inHeader->contentLength );
+       require_noerr(err, exit);
      }
+     require_action(context->ota_writer, exit, err = kStateErr);
+     err = mico_ota_writer_write( context->ota_writer, inData, inLen );
+     require_noerr(err, exit);
   }
   else{
     return kUnsupportedErr;
   }
 
+exit:
   if(err!=kNoErr)  config_log("onReceivedData");
   return err;
-
-flashErrExit:
-  mico_rtos_unlock_mutex(&Context->flashContentInRam_mutex);
-  return err;
 }
 
 static void onClearHTTPHeader(struct _HTTPHeader_t * inHeader, void * inUserContext )
 {
   UNUSED_PARAMETER(inHeader);
-  configContext_t *context = (configContext_t *)inUserContext;
+  config_client_t *client = (config_client_t *)inUserContext;
+  configContext_t *context = &client->httpContext;
 
+  mico_ota_writer_abort( &context->ota_writer );
   if(context->isFlashLocked == true){
     mico_rtos_unlock_mutex(&Context->flashContentInRam_mutex);
     context->isFlashLocked = false;
   }
+  if(flash_owner == client)
+    flash_owner = NULL;
+  context->isRefused = false;
  }
 
+static int config_report_discard(void *userdata, const char *data, int len)
+{
+  UNUSED_PARAMETER(userdata);
+  UNUSED_PARAMETER(data);
+  UNUSED_PARAMETER(len);
+  return 0;
+}
+
+static int config_report_send(void *userdata, const char *data, int len)
+{
+  return config_client_send( (config_client_t *)userdata, (const uint8_t *)data, len ) == kNoErr ? 0 : -1;
+}
+
+/* Fixed size fields in the flash image are not always NUL terminated */
+static void config_report_string_cell(struct json_writer *w, const char *name, const char *content, int max_len)
+{
+  json_writer_begin_object(w);
+  json_writer_key(w, "N");
+  json_writer_string(w, name);
+  json_writer_key(w, "C");
+  json_writer_string_len(w, content, strnlen(content, max_len));
+  json_writer_key(w, "P");
+  json_writer_string(w, "RW");
+  json_writer_end_object(w);
+}
+
+static void config_report_bool_cell(struct json_writer *w, const char *name, bool content)
+{
+  json_writer_begin_object(w);
+  json_writer_key(w, "N");
+  json_writer_string(w, name);
+  json_writer_key(w, "C");
+  json_writer_boolean(w, content);
+  json_writer_key(w, "P");
+  json_writer_string(w, "RW");
+  json_writer_end_object(w);
+}
+
+/* Same layout as the object tree config_server_create_sector() and the
+   config_server_create_*_cell() functions build */
+static void config_server_write_report(struct json_writer *w, config_report_t *report)
+{
+  json_writer_begin_object(w);
+  json_writer_key(w, "T");
+  json_writer_string(w, "Current Configuration");
+  json_writer_key(w, "N");
+  json_writer_string_len(w, report->name, strnlen(report->name, sizeof(report->name)));
+  json_writer_key(w, "C");
+  json_writer_begin_array(w);
+
+    /*Sector 1*/
+    json_writer_begin_object(w);
+    json_writer_key(w, "N");
+    json_writer_string(w, "MICO SYSTEM");
+    json_writer_key(w, "C");
+    json_writer_begin_array(w);
+    config_report_string_cell(w, "Device Name",    report->sys.name,     sizeof(report->sys.name));
+    config_report_bool_cell  (w, "RF power save",  report->sys.rfPowerSaveEnable);
+    config_report_bool_cell  (w, "MCU power save", report->sys.mcuPowerSaveEnable);
+    config_report_string_cell(w, "Wi-Fi",          report->sys.ssid,     sizeof(report->sys.ssid));
+    config_report_string_cell(w, "Password",       report->sys.user_key, sizeof(report->sys.user_key));
+    config_report_bool_cell  (w, "DHCP",           report->sys.dhcpEnable);
+    config_report_string_cell(w, "IP address",     report->localIp,      maxIpLen);
+    config_report_string_cell(w, "Net Mask",       report->netMask,      maxIpLen);
+    config_report_string_cell(w, "Gateway",        report->gateWay,      maxIpLen);
+    config_report_string_cell(w, "DNS Server",     report->dnsServer,    maxIpLen);
+    json_writer_end_array(w);
+    json_writer_end_object(w);
+
+    /*Sector 2*/
+    json_writer_begin_object(w);
+    json_writer_key(w, "N");
+    json_writer_string(w, "APPLICATION");
+    json_writer_key(w, "C");
+    json_writer_object(w, report->app_sector);
+    json_writer_end_object(w);
+
+  json_writer_end_array(w);
+  json_writer_key(w, "PO");
+  json_writer_string(w, PROTOCOL);
+  json_writer_key(w, "HD");
+  json_writer_string(w, HARDWARE_REVISION);
+  json_writer_key(w, "FW");
+  json_writer_string(w, FIRMWARE_REVISION);
+  json_writer_key(w, "RF");
+  json_writer_string_len(w, report->rf_version, strnlen(report->rf_version, sizeof(report->rf_version)));
+  json_writer_end_object(w);
+}
+
 OSStatus _LocalConfigRespondInComingMessage(int fd, HTTPHeader_t* inHeader, mico_Context_t * const inContext)
 {
   OSStatus err = kUnknownErr;
-  const char *  json_str;
   uint8_t *httpResponse = NULL;
   size_t httpResponseLen = 0;
-  json_object* report = NULL, *config = NULL;
+  json_object *config = NULL;
+  config_report_t *report = NULL;
+  struct json_writer writer;
+  int json_len;
   bool need_reboot = false;
   uint16_t crc;
-  configContext_t *http_context = (configContext_t *)inHeader->userContext;
+  uint32_t ota_len;
+  config_client_t *client = (config_client_t *)inHeader->userContext;
   mico_logic_partition_t* ota_partition = MicoFlashGetInfo( MICO_PARTITION_OTA_TEMP );
-  char name[50];
-
-  json_object *sectors, *sector = NULL;
 
   config_log_trace();
 
   if(HTTPHeaderMatchURL( inHeader, kCONFIGURLRead ) == kNoErr){    
-    //report = ConfigCreateReportJsonMessage( inContext );
+    report = malloc( sizeof(config_report_t) );
+    require_action( report, exit, err = kNoMemoryErr );
+    report->app_sector = json_object_new_array();
+    require_action( report->app_sector, exit, err = kNoMemoryErr );
 
+    /* Take a copy, so the lock is not held while the report is sent */
     mico_rtos_lock_mutex(&inContext->flashContentInRam_mutex);
-    snprintf(name, 50, "%s(%c%c%c%c%c%c)",MODEL, 
+    snprintf(report->name, sizeof(report->name), "%s(%c%c%c%c%c%c)",MODEL, 
                                           inContext->micoStatus.mac[9],  inContext->micoStatus.mac[10], 
                                           inContext->micoStatus.mac[12], inContext->micoStatus.mac[13],
                                           inContext->micoStatus.mac[15], inContext->micoStatus.mac[16]);
-    report = json_object_new_object();
-    require_action(report, exit, err = kNoMemoryErr);
-
-    sectors = json_object_new_array();
-    require( sectors, exit );
-
-    json_object_object_add(report, "T", json_object_new_string("Current Configuration"));
-    json_object_object_add(report, "N", json_object_new_string(name));
-    json_object_object_add(report, "C", sectors);
-
-    json_object_object_add(report, "PO", json_object_new_string(PROTOCOL));
-    json_object_object_add(report, "HD", json_object_new_string(HARDWARE_REVISION));
-    json_object_object_add(report, "FW", json_object_new_string(FIRMWARE_REVISION));
-    json_object_object_add(report, "RF", json_object_new_string(inContext->micoStatus.rf_version));
-
-    /*Sector 1*/
-    sector = json_object_new_array();
-    require( sector, exit );
-    err = config_server_create_sector(sectors, "MICO SYSTEM",    sector);
-    require_noerr(err, exit);
-
-      /*name cell*/
-      err = config_server_create_string_cell(sector, "Device Name",    inContext->flashContentInRam.micoSystemConfig.name,               "RW", NULL);
-      require_noerr(err, exit);
-
-      //RF power save switcher cell
-      err = config_server_create_bool_cell(sector, "RF power save",  inContext->flashContentInRam.micoSystemConfig.rfPowerSaveEnable,  "RW");
-      require_noerr(err, exit);
-
-      //MCU power save switcher cell
-      err = config_server_create_bool_cell(sector, "MCU power save", inContext->flashContentInRam.micoSystemConfig.mcuPowerSaveEnable, "RW");
-      require_noerr(err, exit);
-
-      /*SSID cell*/
-      err = config_server_create_string_cell(sector, "Wi-Fi",        inContext->flashContentInRam.micoSystemConfig.ssid,     "RW", NULL);
-      require_noerr(err, exit);
-      /*PASSWORD cell*/
-      err = config_server_create_string_cell(sector, "Password",     inContext->flashContentInRam.micoSystemConfig.user_key, "RW", NULL);
-      require_noerr(err, exit);
-      /*DHCP cell*/
-      err = config_server_create_bool_cell(sector, "DHCP",        inContext->flashContentInRam.micoSystemConfig.dhcpEnable,   "RW");
-      require_noerr(err, exit);
-      /*Local cell*/
-      err = config_server_create_string_cell(sector, "IP address",  inContext->micoStatus.localIp,   "RW", NULL);
-      require_noerr(err, exit);
-      /*Netmask cell*/
-      err = config_server_create_string_cell(sector, "Net Mask",    inContext->micoStatus.netMask,   "RW", NULL);
-      require_noerr(err, exit);
-      /*Gateway cell*/
-      err = config_server_create_string_cell(sector, "Gateway",     inContext->micoStatus.gateWay,   "RW", NULL);
-      require_noerr(err, exit);
-      /*DNS server cell*/
-      err = config_server_create_string_cell(sector, "DNS Server",  inContext->micoStatus.dnsServer, "RW", NULL);
-      require_noerr(err, exit);
-
-    /*Sector 2*/
-    sector = json_object_new_array();
-    require( sector, exit );
-    err = config_server_create_sector(sectors, "APPLICATION",    sector);
-    require_noerr(err, exit);
-
-    config_server_delegate_report( sector, inContext );
-
+    memcpy( &report->sys, &inContext->flashContentInRam.micoSystemConfig, sizeof(mico_sys_config_t) );
+    memcpy( report->localIp, inContext->micoStatus.localIp, maxIpLen );
+    memcpy( report->netMask, inContext->micoStatus.netMask, maxIpLen );
+    memcpy( report->gateWay, inContext->micoStatus.gateWay, maxIpLen );
+    memcpy( report->dnsServer, inContext->micoStatus.dnsServer, maxIpLen );
+    memcpy( report->rf_version, inContext->micoStatus.rf_version, sizeof(report->rf_version) );
+    config_server_delegate_report( report->app_sector, inContext );
     mico_rtos_unlock_mutex(&inContext->flashContentInRam_mutex);
 
-    json_str = json_object_to_json_string(report);
-    require_action( json_str, exit, err = kNoMemoryErr );
-    config_log("Send config object=%s", json_str);
-    err =  CreateSimpleHTTPMessageNoCopy( kMIMEType_JSON, strlen(json_str), &httpResponse, &httpResponseLen );
+    /* The text is produced twice through a small window and never held as a
+       whole: once to measure it for Content-Length, then onto the socket */
+    json_writer_init( &writer, report->window, sizeof(report->window), config_report_discard, NULL );
+    config_server_write_report( &writer, report );
+    json_len = json_writer_finish( &writer );
+    require_action( json_len > 0, exit, err = kUnknownErr );
+
+    err =  CreateSimpleHTTPMessageNoCopy( kMIMEType_JSON, json_len, &httpResponse, &httpResponseLen );
     require_noerr( err, exit );
     require( httpResponse, exit );
-    err = SocketSend( fd, httpResponse, httpResponseLen );
-    require_noerr( err, exit );
-    err = SocketSend( fd, (uint8_t *)json_str, strlen(json_str) );
-    require_noerr( err, exit );
-    config_log("Current configuration sent");
+
+    json_writer_init( &writer, report->window, sizeof(report->window), config_report_send, client );
+    json_writer_raw( &writer, (char *)httpResponse, httpResponseLen );
+    config_server_write_report( &writer, report );
+    require_action( json_writer_finish( &writer ) == (int)httpResponseLen + json_len, exit, err = kConnectionErr );
+    config_log("Current configuration sent, %d bytes", json_len);
     goto exit;
   }
   else if(HTTPHeaderMatchURL( inHeader, kCONFIGURLWrite ) == kNoErr){
+    if(inHeader->contentLength > 0 && flash_owner != NULL && flash_owner != client){
+      config_log("Flash is owned by fd: %d, configuration refused", flash_owner->fd);
+      err = config_client_respond_busy( client );
+      goto exit;
+    }
     if(inHeader->contentLength > 0){
       config_log("Recv new configuration, apply");
 
       err =  CreateSimpleHTTPOKMessage( &httpResponse, &httpResponseLen );
       require_noerr( err, exit );
       require( httpResponse, exit );
-      err = SocketSend( fd, httpResponse, httpResponseLen );
+      err = config_client_send( client, httpResponse, httpResponseLen );
       require_noerr( err, exit );
 
       config = json_tokener_parse(inHeader->extraDataPtr);
@@ -545,6 +831,11 @@ OSStatus _LocalConfigRespondInComingMessage(int fd, HTTPHeader_t* inHeader, mico
     goto exit;
   }
   else if(HTTPHeaderMatchURL( inHeader, kCONFIGURLWriteByUAP ) == kNoErr){
+    if(inHeader->contentLength > 0 && flash_owner != NULL && flash_owner != client){
+      config_log("Flash is owned by fd: %d, configuration refused", flash_owner->fd);
+      err = config_client_respond_busy( client );
+      goto exit;
+    }
     if(inHeader->contentLength > 0){
       config_log( "Recv new configuration from uAP, apply and connect to AP" );
       err = ConfigIncommingJsonMessageUAP( (uint8_t *)inHeader->extraDataPtr, inHeader->extraDataLen );
@@ -555,7 +846,7 @@ OSStatus _LocalConfigRespondInComingMessage(int fd, HTTPHeader_t* inHeader, mico
       require_noerr( err, exit );
       require( httpResponse, exit );
 
-      err = SocketSend( fd, httpResponse, httpResponseLen );
+      err = config_client_send( client, httpResponse, httpResponseLen );
       require_noerr( err, exit );
       sleep(1);
 
@@ -569,16 +860,12 @@ OSStatus _LocalConfigRespondInComingMessage(int fd, HTTPHeader_t* inHeader, mico
   else if(HTTPHeaderMatchURL( inHeader, kCONFIGURLOTA ) == kNoErr && ota_partition->partition_owner != MICO_FLASH_NONE){
     if(inHeader->contentLength > 0){
       config_log("Receive OTA data!");
-      CRC16_Final( &http_context->crc16_contex, &crc);
-      memset(&inContext->flashContentInRam.bootTable, 0, sizeof(boot_table_t));
-      inContext->flashContentInRam.bootTable.length = inHeader->contentLength;
-      inContext->flashContentInRam.bootTable.start_address = ota_partition->partition_start_addr;
-      inContext->flashContentInRam.bootTable.type = 'A';
-      inContext->flashContentInRam.bootTable.upgrade_type = 'U';
-      inContext->flashContentInRam.bootTable.crc = crc;
+      err = mico_ota_writer_finish( &client->httpContext.ota_writer, &ota_len, &crc );
+      require_noerr( err, exit );
+      require_action( ota_len == inHeader->contentLength, exit, err = kSizeErr );
       if( inContext->flashContentInRam.micoSystemConfig.configured != allConfigured )
         inContext->flashContentInRam.micoSystemConfig.easyLinkByPass = EASYLINK_SOFT_AP_BYPASS;
-      mico_system_context_update( inContext );
+      mico_ota_switch_to_new_fw( ota_len, crc );
       SocketClose( &fd );
       mico_system_power_perform( inContext, eState_Software_Reset );
       mico_thread_sleep( MICO_WAIT_FOREVER );
@@ -593,7 +880,10 @@ OSStatus _LocalConfigRespondInComingMessage(int fd, HTTPHeader_t* inHeader, mico
   if(inHeader->persistent == false)  //Return an err to close socket and exit the current thread
     err = kConnectionErr;
   if(httpResponse)  free(httpResponse);
-  if(report)        json_object_put(report);
+  if(report){
+    if(report->app_sector) json_object_put(report->app_sector);
+    free(report);
+  }
   if(config)        json_object_put(config);
 
   return err;
@@ -48,12 +48,13 @@ static bool               easylink_success = false; /**< true: connect to wlan,
 static uint32_t           easylinkIndentifier = 0; /**< Unique for an easylink instance. */
 static mico_config_source_t source = CONFIG_BY_NONE;
 static uint8_t            airkiss_random = 0x0;
+static mico_system_timer_t bonjour_remove_timer; /**< Removes the EasyLink bonjour record a while after EasyLink */
 
 /* Perform easylink and connect to wlan */
 static void easylink_thread(void *inContext);
 static OSStatus mico_easylink_bonjour_start( WiFi_Interface interface, mico_Context_t * const inContext );
 static OSStatus mico_easylink_bonjour_update( WiFi_Interface interface, mico_Context_t * const inContext );
-static void remove_bonjour_for_easylink(void);
+static void remove_bonjour_for_easylink(void *arg);
 static void airkiss_broadcast_thread(void *arg);
 
 
@@ -311,7 +312,9 @@ restart:
 
 exit:
   mico_system_delegate_config_will_stop( );
-  SetTimer( 60*1000 , remove_bonjour_for_easylink );
+  mico_system_timer_stop( &bonjour_remove_timer );
+  mico_system_timer_init( &bonjour_remove_timer, remove_bonjour_for_easylink, NULL );
+  mico_system_timer_start( &bonjour_remove_timer, 60*1000, 0 );
   mico_system_notify_remove( mico_notify_WIFI_STATUS_CHANGED, (void *)EasyLinkNotify_WifiStatusHandler );
   mico_system_notify_remove( mico_notify_EASYLINK_WPS_COMPLETED, (void *)EasyLinkNotify_EasyLinkCompleteHandler );
   mico_system_notify_remove( mico_notify_EASYLINK_GET_EXTRA_DATA, (void *)EasyLinkNotify_EasyLinkGetExtraDataHandler );
@@ -569,8 +572,9 @@ exit:
   return err;
 }
 
-static void remove_bonjour_for_easylink(void)
+static void remove_bonjour_for_easylink(void *arg)
 {
+  UNUSED_PARAMETER(arg);
   mdns_suspend_record( "_easylink_config._tcp.local.", Station, true );
 }
 
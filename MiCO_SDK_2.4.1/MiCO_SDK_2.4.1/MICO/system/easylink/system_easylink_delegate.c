@@ -27,7 +27,7 @@
 #define SYS_LED_TRIGGER_INTERVAL 100 
 #define SYS_LED_TRIGGER_INTERVAL_AFTER_EASYLINK 500 
 
-static mico_timer_t _Led_EL_timer;
+static mico_system_timer_t _Led_EL_timer;
 
 static void _led_EL_Timeout_handler( void* arg )
 {
@@ -38,10 +38,9 @@ static void _led_EL_Timeout_handler( void* arg )
 WEAK void mico_system_delegate_config_will_start( void )
 {
     /*Led trigger*/
-  mico_stop_timer(&_Led_EL_timer);
-  mico_deinit_timer( &_Led_EL_timer );
-  mico_init_timer(&_Led_EL_timer, SYS_LED_TRIGGER_INTERVAL, _led_EL_Timeout_handler, NULL);
-  mico_start_timer(&_Led_EL_timer);
+  mico_system_timer_stop(&_Led_EL_timer);
+  mico_system_timer_init(&_Led_EL_timer, _led_EL_Timeout_handler, NULL);
+  mico_system_timer_start(&_Led_EL_timer, SYS_LED_TRIGGER_INTERVAL, SYS_LED_TRIGGER_INTERVAL);
   return;
 }
 
@@ -52,8 +51,7 @@ WEAK void mico_system_delegate_soft_ap_will_start( void )
 
 WEAK void mico_system_delegate_config_will_stop( void )
 {
-  mico_stop_timer(&_Led_EL_timer);
-  mico_deinit_timer( &_Led_EL_timer );
+  mico_system_timer_stop(&_Led_EL_timer);
   MicoSysLed(true);
   return;
 }
@@ -62,10 +60,9 @@ WEAK void mico_system_delegate_config_recv_ssid ( char *ssid, char *key )
 {
   UNUSED_PARAMETER(ssid);
   UNUSED_PARAMETER(key);
-  mico_stop_timer(&_Led_EL_timer);
-  mico_deinit_timer( &_Led_EL_timer );
-  mico_init_timer(&_Led_EL_timer, SYS_LED_TRIGGER_INTERVAL_AFTER_EASYLINK, _led_EL_Timeout_handler, NULL);
-  mico_start_timer(&_Led_EL_timer);
+  mico_system_timer_stop(&_Led_EL_timer);
+  mico_system_timer_init(&_Led_EL_timer, _led_EL_Timeout_handler, NULL);
+  mico_system_timer_start(&_Led_EL_timer, SYS_LED_TRIGGER_INTERVAL_AFTER_EASYLINK, SYS_LED_TRIGGER_INTERVAL_AFTER_EASYLINK);
   return;
 }
 
@@ -27,15 +27,22 @@ static int mDNS_fd = -1;
 static bool bonjour_instance = false;
 
 typedef enum{
-  RECORD_REMOVED,
   RECORD_UPDATE,
   RECORD_REMOVE,
   RECORD_SUSPEND,
   RECORD_NORMAL,
 } mdns_record_state_t;
 
-typedef struct
+typedef struct _dns_sd_service_record_t
 {
+  struct _dns_sd_service_record_t* next;          // All records, in the order they were added
+  struct _dns_sd_service_record_t* service_next;  // Same bucket of service_table
+  struct _dns_sd_service_record_t* host_next;     // Same bucket of host_table
+  struct _dns_sd_service_record_t* want_next;     // Asked for by the query being answered
+  uint32_t            service_hash;
+  uint32_t            host_hash;
+  mico_system_timer_t announce_timer;     // Runs while count_down announcements are left
+  uint8_t             want;
   char*               hostname;
   char*               instance_name;
   char*               service_name;
@@ -46,6 +53,12 @@ typedef struct
   uint16_t            port;
   uint8_t             count_down;
   mdns_record_state_t state;
+  uint8_t*            answer;             // PTR, TXT, SRV and A records in a ready to send packet
+  uint16_t            answer_len;
+  uint16_t            answer_a;           // Offset of the A record in answer
+  uint16_t            answer_pointers[3]; // Offsets of the pointers back to the service name
+  uint32_t            answer_ip;
+  uint32_t            answer_mask;        // Netmask of the interface when answer was built
 } dns_sd_service_record_t;
 
 #define APP_Available_Offset               0
@@ -57,6 +70,23 @@ typedef struct
 
 #define SERVICE_QUERY_NAME             "_services._dns-sd._udp.local."
 
+#define MDNS_REPLY_SIZE                512
+#define DNS_NAME_MAX_JUMPS             16
+
+/* Records are found by a hash of their service name and of their host name */
+#define MDNS_HASH_SIZE                 16   // Power of 2
+#define DNS_HASH_INIT                  2166136261u
+#define DNS_HASH_PRIME                 16777619u
+
+/* Announcements are sent by a system timer of each record */
+#define MDNS_ANNOUNCE_INTERVAL         200  // ms
+#define MDNS_ANNOUNCE_COUNT            5
+
+/* What a query asks from a record */
+#define MDNS_WANT_SERVICE              0x01  // PTR, TXT, SRV and A
+#define MDNS_WANT_A                    0x02
+#define MDNS_WANT_ENUM                 0x04  // Listed in the answer to SERVICE_QUERY_NAME
+
 //#define mdns_utils_log(M, ...) custom_log("mDNS Utils", M, ##__VA_ARGS__)
 //#define mdns_utils_log_trace() custom_log_trace("mDNS Utils")
 
@@ -64,149 +94,374 @@ typedef struct
 #define mdns_utils_log_trace()
 
 
-static dns_sd_service_record_t   available_services[ MAX_RECORD_COUNT ];
-static uint8_t	available_service_count = MAX_RECORD_COUNT;
+static dns_sd_service_record_t *records = NULL;
+static dns_sd_service_record_t *service_table[ MDNS_HASH_SIZE ];
+static dns_sd_service_record_t *host_table[ MDNS_HASH_SIZE ];
+static uint8_t *reply_buf = NULL;
 
 static int dns_get_next_question( dns_message_iterator_t* iter, dns_question_t* q, dns_name_t* name );
-static int dns_compare_name_to_string( dns_name_t* name, const char* string );
+static int dns_get_next_record( dns_message_iterator_t* iter, dns_record_t* r, dns_name_t* name );
+static int dns_compare_name_to_string( dns_name_t* name, const char* string, const char* suffix );
+static uint32_t dns_hash_name( dns_name_t* name );
+static uint32_t dns_hash_string( const char* string );
 static int dns_create_message( dns_message_iterator_t* message, uint16_t size );
 static void dns_write_header( dns_message_iterator_t* iter, uint16_t id, uint16_t flags, uint16_t question_count, uint16_t answer_count, uint16_t authorative_count );
 static void dns_write_record( dns_message_iterator_t* iter, const char* name, uint16_t record_class, uint16_t record_type, uint32_t ttl, uint8_t* rdata );
 static void mdns_send_message(int fd, dns_message_iterator_t* message );
 static void dns_free_message( dns_message_iterator_t* message );
-static void mdns_process_query(int fd, dns_name_t* name, dns_question_t* question, dns_message_iterator_t* source );
-static void dns_write_record( dns_message_iterator_t* iter, const char* name, uint16_t record_class, uint16_t record_type, uint32_t ttl, uint8_t* rdata );
+static void mdns_send_reply( int fd, uint16_t id, dns_sd_service_record_t* wanted, uint32_t source );
+static int mdns_prepare_answer( dns_sd_service_record_t *record );
+static void mdns_clear_answer( dns_sd_service_record_t *record );
 static void dns_write_uint16( dns_message_iterator_t* iter, uint16_t data );
 static void dns_write_uint32( dns_message_iterator_t* iter, uint32_t data );
 static void dns_write_bytes( dns_message_iterator_t* iter, uint8_t* data, uint16_t length );
 static uint16_t dns_read_uint16( dns_message_iterator_t* iter );
+static uint32_t dns_read_uint32( dns_message_iterator_t* iter );
 static void dns_skip_name( dns_message_iterator_t* iter );
 static void dns_write_name( dns_message_iterator_t* iter, const char* src );
 
 static OSStatus start_bonjour_service(void);
 
 static mico_mutex_t bonjour_mutex = NULL;
-static mico_semaphore_t update_state_sem = NULL;
-static int update_state_fd = 0;
 static mico_thread_t mfi_bonjour_thread_handler;
 static void _bonjour_thread(void *arg);
 
-void process_dns_questions(int fd, dns_message_iterator_t* iter )
+/* Add a record to the list of records a query asks for, in the order they are found */
+static void mdns_want( dns_sd_service_record_t *record, uint8_t want,
+                       dns_sd_service_record_t **wanted, dns_sd_service_record_t **last )
+{
+  if ( record->want == 0 ){
+    record->want_next = NULL;
+    if ( *last ) (*last)->want_next = record;
+    else *wanted = record;
+    *last = record;
+  }
+  record->want |= want;
+}
+
+/* Read every question first and answer them together, so a query asking for several
+   services or a service and its host is answered by one packet */
+static void process_dns_questions( int fd, dns_message_iterator_t* iter, uint32_t source )
 {
   dns_name_t name;
+  dns_name_t rdata_name;
   dns_question_t question;
-  dns_message_iterator_t response;
-  IPStatusTypedef para;
-  int a = 0;
-  int question_processed;
-  uint32_t myip;
-  
-  memset( &response, 0, sizeof(dns_message_iterator_t) );
-  
-  for ( a = 0; a < htons(iter->header->question_count); ++a )
+  dns_record_t known;
+  dns_sd_service_record_t *record, *other;
+  dns_sd_service_record_t *wanted = NULL, *last = NULL;
+  uint32_t hash;
+  uint16_t count;
+  int a;
+
+  count = ntohs( iter->header->question_count );
+  for ( a = 0; a < count; ++a )
   {
-    if (iter->iter > iter->end)
-      break;
     if(dns_get_next_question( iter, &question, &name )==0)
       break;
-    question_processed = 0;
     switch ( question.question_type ){
     case RR_TYPE_PTR:
-      if ( available_services != NULL ){
-        // Check if its a query for all available services  
-        if ( dns_compare_name_to_string( &name, SERVICE_QUERY_NAME ) ){
-          int b = 0;
-          if(dns_create_message( &response, 512 )) {
-            dns_write_header(&response, iter->header->id, 0x8400, 0, available_service_count, 0 );          
-            for ( b = 0; b < available_service_count; ++b ){
-              dns_write_record( &response, SERVICE_QUERY_NAME, RR_CLASS_IN, RR_TYPE_PTR, 1500, (uint8_t*) available_services[b].service_name );
-            }
-            mdns_send_message(fd, &response );
-            dns_free_message( &response );
-            question_processed = 1;
+      // Check if its a query for all available services
+      if ( dns_compare_name_to_string( &name, SERVICE_QUERY_NAME, NULL ) ){
+        for ( record = records; record; record = record->next ){
+          if( record->state != RECORD_NORMAL ) continue;
+          // A service on both interfaces is listed once
+          for ( other = service_table[ record->service_hash & ( MDNS_HASH_SIZE - 1 ) ]; other; other = other->service_next ){
+            if ( other != record && ( other->want & MDNS_WANT_ENUM ) && other->service_hash == record->service_hash
+                && strcmp( other->service_name, record->service_name ) == 0 )
+              break;
           }
+          if ( other == NULL )
+            mdns_want( record, MDNS_WANT_ENUM, &wanted, &last );
         }
-        // else check if its one of our records
-        else {
-          int b = 0;
-          for ( b = 0; b < available_service_count; ++b ){
-            //printf("UDP multicast test: Recv a SERVICE Detail request: %s.\r\n", name);
-            if ( dns_compare_name_to_string( &name, available_services[b].service_name )){
-              
-              if( available_services[b].state != RECORD_NORMAL )
-                continue;
-
-              micoWlanGetIPStatus(&para, available_services[b].interface);
-              myip = htonl(inet_addr(para.ip));
-              if( myip == 0 || myip == 0xFFFFFFFF) continue;
-              
-              // Send the PTR, TXT, SRV and A records
-              if(dns_create_message( &response, 512 )){
-                dns_write_header( &response, iter->header->id, 0x8400, 0, 4, 0 );
-                //dns_write_record( &response, MFi_SERVICE_QUERY_NAME, RR_CLASS_IN, RR_TYPE_PTR, 1500, (u8*) available_services[b].service_name );
-                dns_write_record( &response, available_services[b].service_name, RR_CLASS_IN, RR_TYPE_PTR, available_services[b].ttl, (uint8_t*) available_services[b].instance_name );
-                dns_write_record( &response, available_services[b].instance_name, RR_CACHE_FLUSH|RR_CLASS_IN, RR_TYPE_TXT, available_services[b].ttl, (uint8_t*) available_services[b].txt_att );
-                dns_write_record( &response, available_services[b].instance_name, RR_CACHE_FLUSH|RR_CLASS_IN, RR_TYPE_SRV, available_services[b].ttl, (uint8_t*) &available_services[b]);
-                dns_write_record( &response, available_services[b].hostname, RR_CACHE_FLUSH|RR_CLASS_IN, RR_TYPE_A, available_services[b].ttl, (uint8_t*) &myip);
-                mdns_send_message(fd, &response );
-                dns_free_message( &response );
-                question_processed = 1;
-              }
-            }
-          }
+      }
+      // else check if its one of our records
+      else {
+        hash = dns_hash_name( &name );
+        for ( record = service_table[ hash & ( MDNS_HASH_SIZE - 1 ) ]; record; record = record->service_next ){
+          if( record->state == RECORD_NORMAL && record->service_hash == hash
+             && dns_compare_name_to_string( &name, record->service_name, NULL ) )
+            mdns_want( record, MDNS_WANT_SERVICE, &wanted, &last );
+        }
+      }
+      break;
+    case RR_QTYPE_ANY:
+    case RR_TYPE_A:
+      // The host is answered once per interface
+      hash = dns_hash_name( &name );
+      for ( record = host_table[ hash & ( MDNS_HASH_SIZE - 1 ) ]; record; record = record->host_next ){
+        if( record->host_hash != hash || !dns_compare_name_to_string( &name, record->hostname, NULL ) )
+          continue;
+        for ( other = host_table[ hash & ( MDNS_HASH_SIZE - 1 ) ]; other != record; other = other->host_next ){
+          if ( ( other->want & MDNS_WANT_A ) && other->interface == record->interface )
+            break;
         }
+        if ( other == record )
+          mdns_want( record, MDNS_WANT_A, &wanted, &last );
       }
       break;
+    default:
+      break;
+    }
+  }
+
+  /* Known answer suppression (RFC 6762 section 7.1): leave out the records the querier
+     already holds with at least half of their TTL left */
+  count = ntohs( iter->header->answer_count );
+  for ( a = 0; a < count && wanted; ++a )
+  {
+    if(dns_get_next_record( iter, &known, &name )==0)
+      break;
+    if ( known.record_type == RR_TYPE_PTR ){
+      rdata_name.start_of_name   = known.rdata.iter;
+      rdata_name.start_of_packet = (uint8_t*) iter->header;
+      rdata_name.end_of_packet   = iter->end;
+      for ( record = wanted; record; record = record->want_next ){
+        if ( ( record->want & MDNS_WANT_SERVICE ) && known.ttl >= record->ttl / 2
+            && dns_compare_name_to_string( &name, record->service_name, NULL )
+            && dns_compare_name_to_string( &rdata_name, record->instance_name, record->service_name ) )
+          record->want &= ~MDNS_WANT_SERVICE;
+        if ( ( record->want & MDNS_WANT_ENUM ) && known.ttl >= 1500 / 2
+            && dns_compare_name_to_string( &name, SERVICE_QUERY_NAME, NULL )
+            && dns_compare_name_to_string( &rdata_name, record->service_name, NULL ) )
+          record->want &= ~MDNS_WANT_ENUM;
+      }
     }
-    if (!question_processed ){
-      mdns_process_query(fd, &name, &question, iter);
+    else if ( known.record_type == RR_TYPE_A && known.rd_length == 4 ){
+      for ( record = wanted; record; record = record->want_next ){
+        if ( ( record->want & MDNS_WANT_A ) && record->answer != NULL
+            && known.ttl >= record->ttl / 2
+            && memcmp( known.rdata.iter, &record->answer_ip, 4 ) == 0
+            && dns_compare_name_to_string( &name, record->hostname, NULL ) )
+          record->want &= ~MDNS_WANT_A;
+      }
     }
   }
+
+  if ( wanted )
+    mdns_send_reply( fd, iter->header->id, wanted, source );
 }
 
-static void mdns_process_query(int fd, dns_name_t* name, 
-                               dns_question_t* question, dns_message_iterator_t* source )
+static void mdns_send_packet( int fd, uint8_t* packet, uint16_t length )
 {
-  dns_message_iterator_t response;
-  IPStatusTypedef para;
-  uint32_t myip;
-  int b = 0;
-  
-  memset( &response, 0, sizeof(dns_message_iterator_t) );
-  
-  switch ( question->question_type )
-  {
-  case RR_QTYPE_ANY:
-  case RR_TYPE_A:
-    for ( b = 0; b < available_service_count; ++b ){
-      if ( dns_compare_name_to_string( name, available_services[b].hostname ) ){				
-
-        micoWlanGetIPStatus(&para, available_services[b].interface);
-        myip = htonl(inet_addr(para.ip));
-        if( myip == 0 || myip == 0xFFFFFFFF) continue;
-
-        if(dns_create_message( &response, 256 )){
-          dns_write_header( &response, source->header->id, 0x8400, 0, 1, 0 );
-          dns_write_record( &response, available_services[b].hostname, RR_CLASS_IN | RR_CACHE_FLUSH, RR_TYPE_A, available_services[b].ttl, (uint8_t *)&myip);
-          mdns_send_message(fd, &response );
-          dns_free_message( &response );
-          return;
-        }
+  dns_message_iterator_t message;
+
+  message.header = (dns_message_header_t*) packet;
+  message.iter   = packet + length;
+  mdns_send_message( fd, &message );
+}
+
+static void mdns_flush_reply( int fd, dns_message_iterator_t* reply, uint16_t id, uint16_t* answers )
+{
+  if ( *answers == 0 ) return;
+  dns_write_header( reply, id, 0x8400, 0, *answers, 0 );
+  mdns_send_message( fd, reply );
+  reply->iter = (uint8_t *) reply->header + sizeof(dns_message_header_t);
+  *answers = 0;
+}
+
+/* Copy the records of a cached answer into the reply, the name pointers are moved to
+   where the service name lands */
+static void mdns_copy_answer( dns_message_iterator_t* reply, dns_sd_service_record_t *record, uint16_t from, uint16_t to )
+{
+  uint16_t offset = reply->iter - (uint8_t*) reply->header;
+  uint16_t pointer;
+  int i;
+
+  memcpy( reply->iter, record->answer + from, to - from );
+  for ( i = 0; i < 3; i++ ){
+    if ( record->answer_pointers[i] < from || record->answer_pointers[i] >= to ) continue;
+    pointer = 0xC000 | offset;
+    reply->iter[ record->answer_pointers[i] - from ]     = pointer >> 8;
+    reply->iter[ record->answer_pointers[i] - from + 1 ] = pointer & 0xFF;
+  }
+  reply->iter += to - from;
+}
+
+static bool mdns_answer_reaches( dns_sd_service_record_t *record, uint32_t source )
+{
+  return ( ( source ^ ntohl( record->answer_ip ) ) & record->answer_mask ) == 0;
+}
+
+static void mdns_send_reply( int fd, uint16_t id, dns_sd_service_record_t* wanted, uint32_t source )
+{
+  dns_message_iterator_t reply;
+  dns_sd_service_record_t *record, *other, *single = NULL;
+  uint16_t answers = 0;
+  uint16_t length;
+  int services = 0, others = 0;
+  bool on_link = false;
+
+  for ( record = wanted; record; record = record->want_next ){
+    // No address on the interface, nothing to answer with
+    if ( record->want && mdns_prepare_answer( record ) == 0 )
+      record->want = 0;
+    if ( record->want && source && mdns_answer_reaches( record, source ) )
+      on_link = true;
+  }
+
+  /* Answer with the records of the interface the querier is on. A querier on none of
+     our subnets gets everything, as it did before */
+  for ( record = wanted; record; record = record->want_next ){
+    if ( on_link && !mdns_answer_reaches( record, source ) )
+      record->want = 0;
+  }
+
+  for ( record = wanted; record; record = record->want_next ){
+    // The host address is already in the answer of a service on the same interface
+    if ( record->want & MDNS_WANT_A ){
+      for ( other = wanted; other; other = other->want_next ){
+        if ( ( other->want & MDNS_WANT_SERVICE ) && other->host_hash == record->host_hash
+            && other->interface == record->interface && strcmp( other->hostname, record->hostname ) == 0 )
+          break;
       }
-    }    
-  default:
-   break;;
+      if ( other )
+        record->want &= ~MDNS_WANT_A;
+    }
+    if ( record->want & MDNS_WANT_SERVICE ){
+      services++;
+      single = record;
+    }
+    else if ( record->want )
+      others++;
+  }
+
+  /* The common case: one service asked for, its answer is sent as it is */
+  if ( services == 1 && others == 0 ){
+    ((dns_message_header_t*) single->answer)->id = htons(id);
+    mdns_send_packet( fd, single->answer, single->answer_len );
+    single->want = 0;
+    return;
+  }
+
+  reply.header = (dns_message_header_t*) reply_buf;
+  reply.iter   = reply_buf + sizeof(dns_message_header_t);
+  reply.end    = reply_buf + MDNS_REPLY_SIZE;
+
+  for ( record = wanted; record; record = record->want_next ){
+    if ( !( record->want & MDNS_WANT_ENUM ) ) continue;
+    length = strlen( SERVICE_QUERY_NAME ) + strlen( record->service_name ) + 4 + 10;
+    if ( reply.iter + length > reply.end )
+      mdns_flush_reply( fd, &reply, id, &answers );
+    if ( reply.iter + length > reply.end ) continue;
+    dns_write_record( &reply, SERVICE_QUERY_NAME, RR_CLASS_IN, RR_TYPE_PTR, 1500, (uint8_t*) record->service_name );
+    answers++;
   }
+
+  for ( record = wanted; record; record = record->want_next ){
+    if ( record->want & MDNS_WANT_SERVICE ){
+      length = record->answer_len - sizeof(dns_message_header_t);
+      if ( reply.iter + length > reply.end )
+        mdns_flush_reply( fd, &reply, id, &answers );
+      if ( reply.iter + length > reply.end ){
+        // Too big to share a packet
+        ((dns_message_header_t*) record->answer)->id = htons(id);
+        mdns_send_packet( fd, record->answer, record->answer_len );
+      }
+      else {
+        mdns_copy_answer( &reply, record, sizeof(dns_message_header_t), record->answer_len );
+        answers += 4;
+      }
+    }
+    else if ( record->want & MDNS_WANT_A ){
+      length = record->answer_len - record->answer_a;
+      if ( reply.iter + length > reply.end )
+        mdns_flush_reply( fd, &reply, id, &answers );
+      mdns_copy_answer( &reply, record, record->answer_a, record->answer_len );
+      answers++;
+    }
+    record->want = 0;
+  }
+
+  mdns_flush_reply( fd, &reply, id, &answers );
 }
 
+/* Upper bound of the size of the PTR, TXT, SRV and A records of a service */
+static uint16_t mdns_answer_size( dns_sd_service_record_t *record )
+{
+  uint16_t service  = strlen( record->service_name ) + 2;
+  uint16_t instance = strlen( record->instance_name ) + 2;
+  uint16_t host     = strlen( record->hostname ) + 2;
+
+  return sizeof(dns_message_header_t)
+    + service + 10 + instance
+    + instance + 10 + strlen( record->txt_att ) + 2
+    + instance + 10 + 6 + host
+    + host + 10 + 4;
+}
+
+/* Write the records of a service, when pointers is given the offsets of the name
+   pointers and of the A record are stored so that the records can be moved */
+static void mdns_write_service_records( dns_message_iterator_t* iter, dns_sd_service_record_t *record, uint32_t ip, uint32_t ttl,
+                                        uint16_t* pointers, uint16_t* a_offset )
+{
+  dns_message_iterator_t name_iter;
+  uint8_t* start = (uint8_t*) iter->header;
+  uint8_t* record_start;
+  uint16_t instance_len;
+
+  record_start = iter->iter;
+  dns_write_record( iter, record->service_name, RR_CLASS_IN, RR_TYPE_PTR, ttl, (uint8_t*) record->instance_name );
+
+  // The PTR rdata is the instance name, which ends with a pointer to the service name
+  name_iter.header = iter->header;
+  name_iter.iter   = record_start;
+  name_iter.end    = iter->iter;
+  dns_skip_name( &name_iter );
+  instance_len = iter->iter - ( name_iter.iter + 10 );
+  if ( pointers ) pointers[0] = iter->iter - 2 - start;
+
+  record_start = iter->iter;
+  dns_write_record( iter, record->instance_name, RR_CACHE_FLUSH|RR_CLASS_IN, RR_TYPE_TXT, ttl, (uint8_t*) record->txt_att );
+  if ( pointers ) pointers[1] = record_start + instance_len - 2 - start;
+
+  record_start = iter->iter;
+  dns_write_record( iter, record->instance_name, RR_CACHE_FLUSH|RR_CLASS_IN, RR_TYPE_SRV, ttl, (uint8_t*) record );
+  if ( pointers ) pointers[2] = record_start + instance_len - 2 - start;
+
+  if ( a_offset ) *a_offset = iter->iter - start;
+  dns_write_record( iter, record->hostname, RR_CACHE_FLUSH|RR_CLASS_IN, RR_TYPE_A, ttl, (uint8_t*) &ip );
+}
+
+/* Build the answer of a service once, it is used until the record or the address changes */
+static int mdns_prepare_answer( dns_sd_service_record_t *record )
+{
+  dns_message_iterator_t answer;
+  IPStatusTypedef para;
+  uint32_t myip;
+
+  if ( record->answer != NULL ) return 1;
+
+  micoWlanGetIPStatus(&para, record->interface);
+  myip = htonl(inet_addr(para.ip));
+  if( myip == 0 || myip == 0xFFFFFFFF) return 0;
+
+  if ( dns_create_message( &answer, mdns_answer_size( record ) ) == 0 ) return 0;
+  dns_write_header( &answer, 0x0, 0x8400, 0, 4, 0 );
+  mdns_write_service_records( &answer, record, myip, record->ttl, record->answer_pointers, &record->answer_a );
+
+  record->answer     = (uint8_t*) answer.header;
+  record->answer_len = answer.iter - (uint8_t*) answer.header;
+  record->answer_ip  = myip;
+  record->answer_mask = inet_addr(para.mask);
+  return 1;
+}
+
+static void mdns_clear_answer( dns_sd_service_record_t *record )
+{
+  if ( record->answer ){
+    free( record->answer );
+    record->answer = NULL;
+  }
+}
 
 static int dns_get_next_question( dns_message_iterator_t* iter, dns_question_t* q, dns_name_t* name )
 {
   // Set the name pointers and then skip it
   name->start_of_name   = (uint8_t*) iter->iter;
   name->start_of_packet = (uint8_t*) iter->header;
+  name->end_of_packet   = iter->end;
   dns_skip_name( iter );
-  if (iter->iter > iter->end)
+  if (iter->iter + 4 > iter->end)
     return 0;
   
   // Read the type and class
@@ -215,52 +470,154 @@ static int dns_get_next_question( dns_message_iterator_t* iter, dns_question_t*
   return 1;
 }
 
-static int dns_compare_name_to_string( dns_name_t* name, const char* string )
+static int dns_get_next_record( dns_message_iterator_t* iter, dns_record_t* r, dns_name_t* name )
+{
+  name->start_of_name   = (uint8_t*) iter->iter;
+  name->start_of_packet = (uint8_t*) iter->header;
+  name->end_of_packet   = iter->end;
+  dns_skip_name( iter );
+  if (iter->iter + 10 > iter->end)
+    return 0;
+
+  r->record_type  = dns_read_uint16( iter );
+  r->record_class = dns_read_uint16( iter );
+  r->ttl          = dns_read_uint32( iter );
+  r->rd_length    = dns_read_uint16( iter );
+  if (iter->iter + r->rd_length > iter->end)
+    return 0;
+
+  r->rdata.header = iter->header;
+  r->rdata.iter   = iter->iter;
+  r->rdata.end    = iter->iter + r->rd_length;
+  iter->iter += r->rd_length;
+  return 1;
+}
+
+static uint8_t dns_lower( uint8_t c )
+{
+  return ( c >= 'A' && c <= 'Z' ) ? c + 'a' - 'A' : c;
+}
+
+static uint32_t dns_hash_byte( uint32_t hash, uint8_t c )
 {
+  return ( hash ^ c ) * DNS_HASH_PRIME;
+}
+
+/* FNV-1a of a name as it is on the wire, with the letters in lower case. A name in a
+   packet and the same name as a string give the same hash. Broken names give 0. */
+static uint32_t dns_hash_name( dns_name_t* name )
+{
+  uint8_t* buffer = name->start_of_name;
+  uint32_t hash = DNS_HASH_INIT;
   uint8_t section_length;
-  int finished = 0;
-  int result   = 1;
-  uint8_t* buffer 	  = name->start_of_name;
-  char *temp;
-  
-  while ( !finished )
+  int jumps = 0;
+  int i;
+
+  while ( buffer < name->end_of_packet )
   {
-    // Check if the name is compressed. If so, find the uncompressed version
-    while ( *buffer & 0xC0 )
+    if ( ( *buffer & 0xC0 ) == 0xC0 )
     {
-      uint16_t offset = ( *buffer++ ) << 8;
-      offset += *buffer;
-      offset &= 0x3FFF;
-      buffer = name->start_of_packet + offset;
+      if ( buffer + 1 >= name->end_of_packet || ++jumps > DNS_NAME_MAX_JUMPS ) return 0;
+      buffer = name->start_of_packet + ( ( ( buffer[0] & 0x3F ) << 8 ) | buffer[1] );
+      continue;
     }
-    
-    // Compare section
     section_length = *( buffer++ );
-    temp = malloc(section_length+1);
-    temp[section_length] = 0;
-    memcpy(temp, buffer, section_length );
-    free(temp);
-    if ( strncmp( (char*) buffer, string, section_length ) )
+    if ( ( section_length & 0xC0 ) || buffer + section_length > name->end_of_packet ) return 0;
+
+    hash = dns_hash_byte( hash, section_length );
+    if ( section_length == 0 ) return hash;
+    for ( i = 0; i < section_length; i++ )
+      hash = dns_hash_byte( hash, dns_lower( buffer[i] ) );
+    buffer += section_length;
+  }
+  return 0;
+}
+
+static uint32_t dns_hash_string( const char* string )
+{
+  const uint8_t* src = (const uint8_t*) string;
+  const uint8_t* end;
+  uint32_t hash = DNS_HASH_INIT;
+  uint8_t section_length;
+
+  while ( *src != 0 && *src != 0xC0 )
+  {
+    // The length goes first, so find the end of the section, '/' escapes the character after it
+    for ( end = src, section_length = 0; *end != '.' && *end != 0 && *end != 0xC0; end++, section_length++ )
     {
-      result	 = 0;
-      finished = 1;
+      if ( *end == '/' && end[1] != 0 ) end++;
     }
-    string += section_length + 1;
-    buffer += section_length;
-    
-    // Check if we've finished comparing
-    if ( *buffer == 0 || *string == 0 )
+
+    hash = dns_hash_byte( hash, section_length );
+    for ( ; src < end; src++ )
     {
-      finished = 1;
-      // Check if one of the strings has more data
-      if ( *buffer != 0 || *string != 0 )
-      {
-        result = 0;
-      }
+      if ( *src == '/' && src[1] != 0 ) src++;
+      hash = dns_hash_byte( hash, dns_lower( *src ) );
     }
+
+    if ( *src == '.' ) src++;
+  }
+  return dns_hash_byte( hash, 0 );
+}
+
+/* Compare a name in a received packet with a name as dns_write_string() takes it, nothing
+   is copied. Case is ignored as RFC 6762 section 16 asks. An instance name ends with the
+   0xC0 0x0C pointer to the service name, the comparison goes on with suffix from there. */
+static int dns_compare_name_to_string( dns_name_t* name, const char* string, const char* suffix )
+{
+  uint8_t* buffer = name->start_of_name;
+  const uint8_t* src = (const uint8_t*) string;
+  uint8_t section_length;
+  uint8_t c;
+  int jumps = 0;
+  int i;
+
+  if ( src == NULL ) return 0;
+
+  while ( 1 )
+  {
+    if ( buffer >= name->end_of_packet ) return 0;
+
+    // Follow compression pointers, a packet that points around in circles is not followed for long
+    if ( ( *buffer & 0xC0 ) == 0xC0 )
+    {
+      if ( buffer + 1 >= name->end_of_packet || ++jumps > DNS_NAME_MAX_JUMPS ) return 0;
+      buffer = name->start_of_packet + ( ( ( buffer[0] & 0x3F ) << 8 ) | buffer[1] );
+      continue;
+    }
+    if ( *buffer & 0xC0 ) return 0;
+
+    section_length = *( buffer++ );
+    if ( buffer + section_length > name->end_of_packet ) return 0;
+
+    if ( *src == 0xC0 )
+    {
+      src = (const uint8_t*) suffix;
+      if ( src == NULL ) return 0;
+    }
+
+    if ( section_length == 0 )
+      return *src == 0;
+
+    // Compare section, '/' escapes the character after it
+    for ( i = 0; i < section_length; i++ )
+    {
+      c = *src;
+      if ( c == '/' )
+        c = *++src;
+      else if ( c == '.' || c == 0xC0 )
+        return 0;
+      if ( c == 0 || dns_lower( c ) != dns_lower( buffer[i] ) )
+        return 0;
+      src++;
+    }
+    buffer += section_length;
+
+    if ( *src == '.' )
+      src++;
+    else if ( *src != 0 && *src != 0xC0 )
+      return 0;
   }
-  
-  return result;
 }
 
 static int dns_create_message( dns_message_iterator_t* message, uint16_t size )
@@ -286,14 +643,15 @@ static void dns_write_string( dns_message_iterator_t* iter, const char* src )
   uint8_t* segment_length_pointer;
   uint8_t  segment_length;
   
-  while ( *src != 0 && *src != 0xC0)
+  /* Compare as uint8_t, char is signed on some compilers */
+  while ( *src != 0 && (uint8_t) *src != 0xC0)
   {
     /* Remember where we need to store the segment length and reset the counter*/
     segment_length_pointer = iter->iter++;
     segment_length = 0;
     
     /* Copy bytes until '.' or end of string*/
-    while ( *src != '.' && *src != 0 && *src != 0xC0)
+    while ( *src != '.' && *src != 0 && (uint8_t) *src != 0xC0)
     {
       if (*src == '/')
         src++; // skip '/'
@@ -313,7 +671,7 @@ static void dns_write_string( dns_message_iterator_t* iter, const char* src )
     
   }
   
-  if (*src == 0xC0) { // compress name
+  if ((uint8_t) *src == 0xC0) { // compress name
     *iter->iter++ = *src++;
     *iter->iter++ = *src++;
   } else {
@@ -427,9 +785,16 @@ static uint16_t dns_read_uint16( dns_message_iterator_t* iter )
   return temp;
 }
 
+static uint32_t dns_read_uint32( dns_message_iterator_t* iter )
+{
+  uint32_t temp = (uint32_t) dns_read_uint16( iter ) << 16;
+  temp += dns_read_uint16( iter );
+  return temp;
+}
+
 static void dns_skip_name( dns_message_iterator_t* iter )
 {
-  while ( *iter->iter != 0 )
+  while ( iter->iter < iter->end && *iter->iter != 0 )
   {
     // Check if the name is compressed
     if ( *iter->iter & 0xC0 )
@@ -455,7 +820,7 @@ static void dns_write_name( dns_message_iterator_t* iter, const char* src )
 
 static bool is_service_match ( dns_sd_service_record_t *record, char *service_name, WiFi_Interface interface )
 {
-  if( record->state == RECORD_REMOVED || record->state == RECORD_REMOVE )
+  if( record->state == RECORD_REMOVE )
     return false;
 
   if( ( service_name == NULL || strcmp( record->service_name, service_name ) == 0 ) && record->interface == interface )
@@ -464,62 +829,58 @@ static bool is_service_match ( dns_sd_service_record_t *record, char *service_na
   return false;
 }
 
-static int find_record_by_service ( char *service_name, WiFi_Interface interface )
+static dns_sd_service_record_t* find_record_by_service ( char *service_name, WiFi_Interface interface )
 {
-  int i;
-  uint32_t insert_index = 0xFF;
+  dns_sd_service_record_t *record;
+  uint32_t hash = dns_hash_string( service_name );
 
-  for ( i = 0; i < available_service_count; i++ ){
-    if( is_service_match ( &available_services[i], service_name, interface ) ){
-      insert_index = i;
-      break;
-    }
-  }  
-  return insert_index;
+  for ( record = service_table[ hash & ( MDNS_HASH_SIZE - 1 ) ]; record; record = record->service_next ){
+    if( record->service_hash == hash && is_service_match ( record, service_name, interface ) )
+      return record;
+  }
+  return NULL;
 }
 
-static int find_empty_record ( void )
+static void mdns_link_record( dns_sd_service_record_t *record )
 {
-  int i;
-  uint32_t insert_index = 0xFF;
+  dns_sd_service_record_t **bucket;
 
-  for ( i = 0; i < available_service_count; i++ ){
-    if( available_services[i].state == RECORD_REMOVED ){
-      insert_index = i;
+  record->service_hash = dns_hash_string( record->service_name );
+  bucket = &service_table[ record->service_hash & ( MDNS_HASH_SIZE - 1 ) ];
+  record->service_next = *bucket;
+  *bucket = record;
+
+  record->host_hash = dns_hash_string( record->hostname );
+  bucket = &host_table[ record->host_hash & ( MDNS_HASH_SIZE - 1 ) ];
+  record->host_next = *bucket;
+  *bucket = record;
+}
+
+static void mdns_unlink_record( dns_sd_service_record_t *record )
+{
+  dns_sd_service_record_t **p;
+
+  for ( p = &service_table[ record->service_hash & ( MDNS_HASH_SIZE - 1 ) ]; *p; p = &(*p)->service_next ){
+    if ( *p == record ){
+      *p = record->service_next;
+      break;
+    }
+  }
+  for ( p = &host_table[ record->host_hash & ( MDNS_HASH_SIZE - 1 ) ]; *p; p = &(*p)->host_next ){
+    if ( *p == record ){
+      *p = record->host_next;
       break;
     }
   }
-  return insert_index;
 }
 
-static mico_thread_t _bonjour_announce_handler = NULL;
+static void mdns_announce_handler( void *arg );
 
-void _bonjour_send_anounce_thread(void *arg)
+/* Start announcing a record, the first announcement is sent at once */
+static void mdns_start_announce( dns_sd_service_record_t *record )
 {
-  uint32_t insert_index = 0xFF;
-  UNUSED_PARAMETER( arg );
-
-  while(1){
-    insert_index = 0xFF;
-    for ( int i = 0; i < available_service_count; i++ ){
-      if( available_services[i].state != RECORD_REMOVED && available_services[i].count_down != 0 ){
-        insert_index = i;
-        break;
-      }
-    }  
-
-    if( insert_index == 0xFF )
-      goto exit;
-    
-    mdns_utils_log( "sem trigger" );
-    mico_rtos_set_semaphore( &update_state_sem );
-    mico_thread_msleep(200);
-  }
-  
-exit:
-  _bonjour_announce_handler = NULL;
-  mico_rtos_delete_thread( NULL );
-  return;
+  record->count_down = MDNS_ANNOUNCE_COUNT;
+  mico_system_timer_start( &record->announce_timer, 0, MDNS_ANNOUNCE_INTERVAL );
 }
 
 static void _clean_record_resource( dns_sd_service_record_t *record )
@@ -540,52 +901,81 @@ static void _clean_record_resource( dns_sd_service_record_t *record )
     free(record->txt_att);
     record->txt_att = NULL;
   }
+  mdns_clear_answer( record );
 
 }
 
+static void mdns_free_record( dns_sd_service_record_t *record )
+{
+  dns_sd_service_record_t **p;
+
+  mico_system_timer_stop( &record->announce_timer );
+  mdns_unlink_record( record );
+  for ( p = &records; *p; p = &(*p)->next ){
+    if ( *p == record ){
+      *p = record->next;
+      break;
+    }
+  }
+  _clean_record_resource( record );
+  free( record );
+}
+
 
 OSStatus mdns_add_record( mdns_init_t init, WiFi_Interface interface, uint32_t time_to_live )
 {
   int len;
   OSStatus err = kNoErr;
-  uint32_t insert_index = 0xFF;
+  dns_sd_service_record_t *record, **p;
 
   if( bonjour_instance == false ){
     err = start_bonjour_service( );
     require_noerr(err, exit);
   }
   
-  insert_index = find_record_by_service ( init.service_name, interface );
-  if( insert_index == 0xFF)
-    insert_index = find_empty_record ( );
-
-  require_action( insert_index < available_service_count, exit, err = kNoResourcesErr);
-  
   mico_rtos_lock_mutex( &bonjour_mutex );
 
-  _clean_record_resource( &available_services[insert_index] );
+  record = find_record_by_service ( init.service_name, interface );
+  if( record == NULL ){
+    record = calloc( 1, sizeof(dns_sd_service_record_t) );
+    require_action( record, unlock, err = kNoMemoryErr );
+    mico_system_timer_init( &record->announce_timer, mdns_announce_handler, record );
+    for ( p = &records; *p; p = &(*p)->next );
+    *p = record;
+  }
+  else
+    mdns_unlink_record( record );
+
+  _clean_record_resource( record );
 
-  available_services[insert_index].interface = interface;
-  available_services[insert_index].service_name = (char*)__strdup(init.service_name);
-  available_services[insert_index].hostname = (char*)__strdup(init.host_name);
+  record->interface = interface;
+  record->service_name = (char*)__strdup(init.service_name);
+  record->hostname = (char*)__strdup(init.host_name);
 
   len = strlen(init.instance_name);
-  available_services[insert_index].instance_name = (char*)malloc(len+3);//// 0xc00c+\0
-  memcpy(available_services[insert_index].instance_name, init.instance_name, len);
-  available_services[insert_index].instance_name[len]= 0xc0;
-  available_services[insert_index].instance_name[len+1]= 0x0c;
-  available_services[insert_index].instance_name[len+2]= 0;
+  record->instance_name = (char*)malloc(len+3);//// 0xc00c+\0
+  if( record->instance_name ){
+    memcpy(record->instance_name, init.instance_name, len);
+    record->instance_name[len]= 0xc0;
+    record->instance_name[len+1]= 0x0c;
+    record->instance_name[len+2]= 0;
+  }
   
-  available_services[insert_index].txt_att = (char*)__strdup(init.txt_record);
+  record->txt_att = (char*)__strdup(init.txt_record);
 
-  available_services[insert_index].port = init.service_port;
-  available_services[insert_index].state = RECORD_UPDATE;
-  available_services[insert_index].count_down = 5;
-  available_services[insert_index].ttl = time_to_live;
-  
-  if( _bonjour_announce_handler == NULL)
-    mico_rtos_create_thread( &_bonjour_announce_handler, MICO_APPLICATION_PRIORITY, "Bonjour Announce", _bonjour_send_anounce_thread, 0x200, NULL );
+  if( !record->service_name || !record->hostname || !record->instance_name || !record->txt_att ){
+    mdns_free_record( record );
+    err = kNoMemoryErr;
+    goto unlock;
+  }
+  mdns_link_record( record );
+
+  record->port = init.service_port;
+  record->state = RECORD_UPDATE;
+  record->ttl = time_to_live;
+  mdns_start_announce( record );
 
+unlock:
   mico_rtos_unlock_mutex( &bonjour_mutex );
 
 exit:
@@ -595,31 +985,29 @@ exit:
 
 void mdns_update_txt_record( char *service_name, WiFi_Interface interface, char *txt_record )
 {
-  uint32_t insert_index = 0xFF;
+  dns_sd_service_record_t *record;
 
   if( bonjour_instance == false ) return;
 
-  insert_index = find_record_by_service ( service_name, interface );
-  if( insert_index == 0xFF ) return;
-
   mico_rtos_lock_mutex( &bonjour_mutex );
 
-  if(available_services[insert_index].txt_att)  free(available_services[insert_index].txt_att);
-  available_services[insert_index].txt_att = (char*)__strdup(txt_record);
-  available_services[insert_index].state = RECORD_UPDATE;
-  available_services[insert_index].count_down = 5;
+  record = find_record_by_service ( service_name, interface );
+  if( record == NULL ) goto exit;
 
-  if( _bonjour_announce_handler == NULL)
-    mico_rtos_create_thread( &_bonjour_announce_handler, MICO_APPLICATION_PRIORITY, "Bonjour Announce", _bonjour_send_anounce_thread, 0x200, NULL );
+  if(record->txt_att)  free(record->txt_att);
+  record->txt_att = (char*)__strdup(txt_record);
+  mdns_clear_answer( record );
+  record->state = RECORD_UPDATE;
+  mdns_start_announce( record );
 
+exit:
   mico_rtos_unlock_mutex( &bonjour_mutex );
 }
   
 
 void mdns_suspend_record( char *service_name, WiFi_Interface interface, bool will_remove )
 {
-  int i;
-  uint32_t insert_index = 0xFF;
+  dns_sd_service_record_t *record;
   
   mdns_utils_log( "Suspend %s@%d",  service_name, interface);
 
@@ -627,62 +1015,49 @@ void mdns_suspend_record( char *service_name, WiFi_Interface interface, bool wil
 
   mico_rtos_lock_mutex( &bonjour_mutex );
 
-  for ( i = 0; i < available_service_count; i++ ){
-    if( is_service_match ( &available_services[i], service_name, interface ) == false) 
+  for ( record = records; record; record = record->next ){
+    if( is_service_match ( record, service_name, interface ) == false) 
       continue;
     
-    mdns_utils_log( "Find index %d to suspend", i);
+    mdns_utils_log( "Find %s to suspend", record->service_name );
     if( will_remove == true )
-      available_services[i].state = RECORD_REMOVE;
-    else{
-      if( available_services[i].state != RECORD_REMOVE )
-        available_services[i].state = RECORD_SUSPEND;
-    }
-  
-    available_services[i].count_down = 5; 
-    insert_index = i;
+      record->state = RECORD_REMOVE;
+    else
+      record->state = RECORD_SUSPEND;
+    mdns_clear_answer( record );
+    mdns_start_announce( record );
   }
 
-  if( insert_index == 0xFF )
-    goto exit;
-
-  if( _bonjour_announce_handler == NULL)
-    mico_rtos_create_thread( &_bonjour_announce_handler, MICO_APPLICATION_PRIORITY, "Bonjour Announce", _bonjour_send_anounce_thread, 0x200, NULL );
-
-exit:
   mico_rtos_unlock_mutex( &bonjour_mutex );
   return;
 }
 
 void mdns_resume_record( char *service_name, WiFi_Interface interface )
 {
-  int i;
-  uint32_t insert_index = 0xFF;
+  dns_sd_service_record_t *record;
 
   if( bonjour_instance == false ) return;
 
   mico_rtos_lock_mutex( &bonjour_mutex );
 
-  for ( i = 0; i < available_service_count && is_service_match( &available_services[i], service_name, interface ); i++ ){
-    available_services[i].state = RECORD_UPDATE;
-    available_services[i].count_down = 5; 
-    insert_index = i;
-  }
-
-  if( insert_index == 0xFF )
-    goto exit;
+  for ( record = records; record; record = record->next ){
+    if( is_service_match ( record, service_name, interface ) == false) 
+      continue;
 
-  if( _bonjour_announce_handler == NULL)
-    mico_rtos_create_thread( &_bonjour_announce_handler, MICO_APPLICATION_PRIORITY, "Bonjour Announce", _bonjour_send_anounce_thread, 0x200, NULL );
+    record->state = RECORD_UPDATE;
+    mdns_clear_answer( record );
+    mdns_start_announce( record );
+  }
 
-exit:
   mico_rtos_unlock_mutex( &bonjour_mutex );
   return;
 }
 
-void mdns_handler(int fd, uint8_t* pkt, int pkt_len)
+static void mdns_handle_packet(int fd, uint8_t* pkt, int pkt_len, uint32_t source)
 {
   dns_message_iterator_t iter;
+
+  if ( pkt_len < (int)sizeof(dns_message_header_t) ) return;
   
   iter.header = (dns_message_header_t*) pkt;
   iter.iter   = (uint8_t*) iter.header + sizeof(dns_message_header_t);
@@ -694,46 +1069,93 @@ void mdns_handler(int fd, uint8_t* pkt, int pkt_len)
   }
   else
   {
-    process_dns_questions(fd, &iter );
+    process_dns_questions(fd, &iter, source );
   }
 }
 
-void bonjour_send_record(int record_index)
+void mdns_handler(int fd, uint8_t* pkt, int pkt_len)
+{
+  mdns_handle_packet( fd, pkt, pkt_len, 0 );
+}
+
+static void bonjour_send_record( dns_sd_service_record_t *record )
 {
   dns_message_iterator_t response;
   uint32_t myip;
   IPStatusTypedef para;
-  int ttl  = 0;
 
-  /* Send service and a ttl > 0 for a working record*/
-  if( available_services[record_index].state == RECORD_NORMAL || available_services[record_index].state == RECORD_UPDATE ){
-    ttl = available_services[record_index].ttl;
-    
+  /* Send service and the cached answer for a working record*/
+  if( record->state == RECORD_NORMAL || record->state == RECORD_UPDATE ){
     if(dns_create_message( &response, 512 )) {
-      dns_write_header(&response, 0x0, 0x8400, 0, available_service_count, 0 );          
-      dns_write_record( &response, SERVICE_QUERY_NAME, RR_CLASS_IN, RR_TYPE_PTR, 1500, (uint8_t*) available_services[record_index].service_name );
+      dns_write_header(&response, 0x0, 0x8400, 0, 1, 0 );
+      dns_write_record( &response, SERVICE_QUERY_NAME, RR_CLASS_IN, RR_TYPE_PTR, 1500, (uint8_t*) record->service_name );
       mdns_send_message(mDNS_fd, &response );
       dns_free_message( &response );
     }
+    if( mdns_prepare_answer( record ) ){
+      ((dns_message_header_t*) record->answer)->id = 0;
+      mdns_send_packet( mDNS_fd, record->answer, record->answer_len );
+    }
+    return;
   }
-  micoWlanGetIPStatus(&para, available_services[record_index].interface);
+
+  /* A ttl = 0 tells the others to forget the record */
+  micoWlanGetIPStatus(&para, record->interface);
   myip = htonl(inet_addr(para.ip));
   if( myip == 0 || myip == 0xFFFFFFFF) return;
 
-
-  if(dns_create_message( &response, 512 )){
-    mdns_utils_log( "TTL = %d",  ttl);
-    micoWlanGetIPStatus(&para, available_services[record_index].interface);
+  if(dns_create_message( &response, mdns_answer_size( record ) )){
     dns_write_header( &response, 0x0, 0x8400, 0, 4, 0 );
-    dns_write_record( &response, available_services[record_index].service_name, RR_CLASS_IN, RR_TYPE_PTR, ttl, (uint8_t*) available_services[record_index].instance_name );
-    dns_write_record( &response, available_services[record_index].instance_name, RR_CACHE_FLUSH|RR_CLASS_IN, RR_TYPE_TXT, ttl, (uint8_t*) available_services[record_index].txt_att );
-    dns_write_record( &response, available_services[record_index].instance_name, RR_CACHE_FLUSH|RR_CLASS_IN, RR_TYPE_SRV, ttl, (uint8_t*) &available_services[record_index]);
-    dns_write_record( &response, available_services[record_index].hostname, RR_CACHE_FLUSH|RR_CLASS_IN, RR_TYPE_A, ttl, (uint8_t*) &myip);
+    mdns_write_service_records( &response, record, myip, 0, NULL, NULL );
     mdns_send_message(mDNS_fd, &response );
     dns_free_message( &response );
   }
 }
 
+/* One announcement of a record, the timer is stopped after the last one */
+static void mdns_announce_record( dns_sd_service_record_t *record )
+{
+  switch ( record->state ){
+    case RECORD_REMOVE: 
+      mdns_utils_log( "Remove record %s", record->service_name );
+      bonjour_send_record( record );
+      if( --record->count_down == 0 ){
+        mdns_free_record( record );
+        return;
+      }
+      break;
+    case RECORD_SUSPEND:
+      mdns_utils_log( "Suspend record %s", record->service_name );
+      bonjour_send_record( record );
+      record->count_down--;       
+      break;
+    case RECORD_UPDATE:
+      mdns_utils_log( "Update record %s, cd: %d", record->service_name, record->count_down );
+      bonjour_send_record( record );
+      if( --record->count_down == 0)
+        record->state = RECORD_NORMAL;
+      break;
+    default:
+      record->count_down = 0;
+      break;
+  }
+
+  if( record->count_down == 0 )
+    mico_system_timer_stop( &record->announce_timer );
+}
+
+/* Runs in the timer service thread. The record may have been freed by another
+   thread after its timer expired, so it is only used if it is still listed */
+static void mdns_announce_handler( void *arg )
+{
+  dns_sd_service_record_t *record;
+
+  mico_rtos_lock_mutex( &bonjour_mutex );
+  for ( record = records; record && record != arg; record = record->next );
+  if ( record ) mdns_announce_record( record );
+  mico_rtos_unlock_mutex( &bonjour_mutex );
+}
+
 void BonjourNotify_WifiStatusHandler( WiFiEvent event, void *arg )
 {
   UNUSED_PARAMETER(arg);  
@@ -756,6 +1178,21 @@ void BonjourNotify_WifiStatusHandler( WiFiEvent event, void *arg )
   return;
 }
 
+/* A new address makes every cached answer stale */
+void BonjourNotify_DHCPCompletedHandler( IPStatusTypedef *pnet, void *arg )
+{
+  dns_sd_service_record_t *record;
+  UNUSED_PARAMETER(pnet);
+  UNUSED_PARAMETER(arg);
+
+  if( bonjour_instance == false ) return;
+
+  mico_rtos_lock_mutex( &bonjour_mutex );
+  for ( record = records; record; record = record->next )
+    mdns_clear_answer( record );
+  mico_rtos_unlock_mutex( &bonjour_mutex );
+}
+
 void BonjourNotify_SYSWillPoerOffHandler( void *arg )
 {
     UNUSED_PARAMETER(arg);  
@@ -774,16 +1211,15 @@ static OSStatus start_bonjour_service(void)
   if(bonjour_mutex == NULL)
     mico_rtos_init_mutex( &bonjour_mutex );
 
-  if(update_state_sem == NULL)
-    mico_rtos_init_semaphore( &update_state_sem, 1 );
-
-  update_state_fd = mico_create_event_fd( update_state_sem );
-
-  memset( available_services, 0x0, sizeof( available_services ) );
-
+  records = NULL;
+  memset( service_table, 0x0, sizeof( service_table ) );
+  memset( host_table, 0x0, sizeof( host_table ) );
   
   buf = malloc(1500);
   require_action(buf, exit, err =kNoMemoryErr);
+
+  reply_buf = malloc(MDNS_REPLY_SIZE);
+  require_action(reply_buf, exit, err =kNoMemoryErr);
   
   mDNS_fd = socket(AF_INET, SOCK_DGRM, IPPROTO_UDP);
   require_action(IsValidSocket( mDNS_fd ), exit, err = kNoResourcesErr );
@@ -798,6 +1234,8 @@ static OSStatus start_bonjour_service(void)
   require_noerr( err, exit );
   err = mico_system_notify_register( mico_notify_SYS_WILL_POWER_OFF, (void *)BonjourNotify_SYSWillPoerOffHandler, NULL );
   require_noerr( err, exit );
+  err = mico_system_notify_register( mico_notify_DHCP_COMPLETED, (void *)BonjourNotify_DHCPCompletedHandler, NULL );
+  require_noerr( err, exit );
 
   err = mico_rtos_create_thread(&mfi_bonjour_thread_handler, MICO_APPLICATION_PRIORITY, "Bonjour", _bonjour_thread, 0x500, NULL );
   require_noerr(err, exit);
@@ -810,66 +1248,26 @@ exit:
 
 void _bonjour_thread(void *arg)
 {
-  int i, con = -1;
-  struct timeval_t t;
+  int con = -1;
   fd_set readfds;
   struct sockaddr_t addr;
   socklen_t addrLen;
   //OSStatus err = kNoErr;
   UNUSED_PARAMETER( arg );
 
-  t.tv_sec = 1;
-  t.tv_usec = 0;
-  
+  /* Announcements are sent by the timers of the records, only queries are read here */
   while(1) {
     /*Check status on erery sockets on bonjour query */
     FD_ZERO(&readfds);
     FD_SET(mDNS_fd, &readfds);
-    FD_SET(update_state_fd, &readfds);
-    select(mDNS_fd + 1, &readfds, NULL, NULL, &t);
+    select(mDNS_fd + 1, &readfds, NULL, NULL, NULL);
 
-    if ( FD_ISSET( update_state_fd, &readfds ) ){ 
-      mdns_utils_log( "sem recved" );
-      mico_rtos_get_semaphore( &update_state_sem, 0 );
-      mico_rtos_lock_mutex( &bonjour_mutex );
-      for ( i = 0; i < available_service_count; i++ ){
-        switch ( available_services[i].state ){
-          case RECORD_REMOVE: 
-            mdns_utils_log( "Remove record %d", i );
-            bonjour_send_record( i );
-            available_services[i].count_down--;
-            if( available_services[i].count_down == 0){
-              _clean_record_resource( &available_services[i] );
-              available_services[i].state = RECORD_REMOVED;
-            }
-            break;
-          case RECORD_SUSPEND:
-            if( available_services[i].count_down ){
-              mdns_utils_log( "Suspend record %d", i );
-              bonjour_send_record( i );
-              if( available_services[i].count_down )
-                available_services[i].count_down--;       
-            }
-            break;
-          case RECORD_UPDATE:
-            mdns_utils_log( "Update record %d, cd: %d", i, available_services[i].count_down );
-            bonjour_send_record( i );
-            available_services[i].count_down--;
-            if( available_services[i].count_down == 0)
-              available_services[i].state = RECORD_NORMAL;
-            break;
-          default:
-            break;
-        }
-      }
-      mico_rtos_unlock_mutex( &bonjour_mutex );
-    }
-    
     /*Read data from udp and send data back */ 
     if (FD_ISSET(mDNS_fd, &readfds)) {
+      addrLen = sizeof(addr);
       con = recvfrom(mDNS_fd, buf, 1500, 0, &addr, &addrLen); 
       mico_rtos_lock_mutex( &bonjour_mutex );
-      mdns_handler(mDNS_fd, (uint8_t *)buf, con);
+      mdns_handle_packet(mDNS_fd, (uint8_t *)buf, con, addr.s_ip);
       mico_rtos_unlock_mutex( &bonjour_mutex );
     }
   }
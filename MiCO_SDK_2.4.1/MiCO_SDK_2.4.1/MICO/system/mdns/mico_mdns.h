@@ -30,8 +30,6 @@
 /**************************************************************************************************************
  * INCLUDES
  **************************************************************************************************************/
-#define MAX_RECORD_COUNT 4
-
 
 #define DNS_MESSAGE_IS_A_RESPONSE           0x8000
 #define DNS_MESSAGE_OPCODE                  0x7800
@@ -95,6 +93,7 @@ typedef struct
 {
   uint8_t* start_of_name;
   uint8_t* start_of_packet; // Used for compressed names;
+  uint8_t* end_of_packet;   // Names are never read past it
 } dns_name_t;
 
 typedef struct
@@ -0,0 +1,133 @@
+/**
+******************************************************************************
+* @file    mico_system_boot_trace.c
+* @author  William Xu
+* @version V1.0.0
+* @date    17-Oct-2026
+* @brief   Boot trace, record the time every boot phase begins and ends in a
+*          ring buffer, and print it from the CLI.
+******************************************************************************
+*
+*  The MIT License
+*  Copyright (c) 2016 MXCHIP Inc.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is furnished
+*  to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in
+*  all copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+*  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+*  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+******************************************************************************
+*/
+
+#include "MICO.h"
+
+#ifndef MICO_BOOT_TRACE_RECORDS
+#define MICO_BOOT_TRACE_RECORDS     (48)
+#endif
+
+typedef enum
+{
+  BOOT_TRACE_BEGIN,
+  BOOT_TRACE_END,
+  BOOT_TRACE_MARK,
+} boot_trace_type_t;
+
+typedef struct
+{
+  const char *  phase;
+  uint32_t      time;
+  uint8_t       type;
+} boot_trace_record_t;
+
+static mico_mutex_t         boot_trace_mutex = NULL;
+static boot_trace_record_t  boot_trace[MICO_BOOT_TRACE_RECORDS];
+static uint32_t             boot_trace_count = 0;   // Records written, the oldest are overwritten
+
+/* The first phase begins before mico_system_init( ), when no other thread is running yet */
+static void boot_trace_lock( void )
+{
+  if( boot_trace_mutex == NULL )
+    mico_rtos_init_mutex( &boot_trace_mutex );
+  mico_rtos_lock_mutex( &boot_trace_mutex );
+}
+
+static void boot_trace_record( const char *phase, boot_trace_type_t type )
+{
+  boot_trace_record_t *record;
+
+  boot_trace_lock( );
+  record = &boot_trace[boot_trace_count % MICO_BOOT_TRACE_RECORDS];
+  record->phase = phase;
+  record->time = mico_get_time( );
+  record->type = type;
+  boot_trace_count++;
+  mico_rtos_unlock_mutex( &boot_trace_mutex );
+}
+
+void mico_system_boot_trace_begin( const char *phase )
+{
+  boot_trace_record( phase, BOOT_TRACE_BEGIN );
+}
+
+void mico_system_boot_trace_end( const char *phase )
+{
+  boot_trace_record( phase, BOOT_TRACE_END );
+}
+
+void mico_system_boot_trace_mark( const char *phase )
+{
+  boot_trace_record( phase, BOOT_TRACE_MARK );
+}
+
+/* One line for every phase: begin, end and duration in ms. An end is found by
+ * its phase name, phases running in other threads can end in any order. */
+void system_boot_trace_print( int (*print)( const char *format, ... ) )
+{
+  boot_trace_record_t *record, *end;
+  uint32_t first, i, j;
+
+  boot_trace_lock( );
+  first = boot_trace_count > MICO_BOOT_TRACE_RECORDS ? boot_trace_count - MICO_BOOT_TRACE_RECORDS : 0;
+  print( "Boot trace at %d ms, %d records:\r\n", (int)mico_get_time( ), (int)( boot_trace_count - first ) );
+  print( " begin    end   time  phase\r\n" );
+
+  for( i = first; i < boot_trace_count; i++ ){
+    record = &boot_trace[i % MICO_BOOT_TRACE_RECORDS];
+    switch( record->type ){
+      case BOOT_TRACE_BEGIN:
+        for( j = i + 1, end = NULL; j < boot_trace_count && end == NULL; j++ ){
+          end = &boot_trace[j % MICO_BOOT_TRACE_RECORDS];
+          if( end->type != BOOT_TRACE_END || strcmp( end->phase, record->phase ) )
+            end = NULL;
+        }
+        if( end )
+          print( "%6d %6d %6d  %s\r\n", (int)record->time, (int)end->time, (int)( end->time - record->time ), record->phase );
+        else
+          print( "%6d %6s %6s  %s\r\n", (int)record->time, "-", "-", record->phase );
+        break;
+      case BOOT_TRACE_MARK:
+        print( "%6d %6s %6s  %s\r\n", (int)record->time, "", "mark", record->phase );
+        break;
+      default:
+        /* Printed with its begin, or the begin is overwritten */
+        break;
+    }
+  }
+  mico_rtos_unlock_mutex( &boot_trace_mutex );
+}
+
+void mico_system_boot_trace_print( void )
+{
+  system_boot_trace_print( printf );
+}
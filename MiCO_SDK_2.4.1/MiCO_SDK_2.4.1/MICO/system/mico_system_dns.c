@@ -0,0 +1,752 @@
+/**
+******************************************************************************
+* @file    mico_system_dns.c
+* @author  William Xu
+* @version V1.0.0
+* @date    17-Oct-2026
+* @brief   DNS resolver with a cache of addresses and negative answers, one
+*          query for every name however many threads look it up.
+******************************************************************************
+*
+*  The MIT License
+*  Copyright (c) 2016 MXCHIP Inc.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is furnished
+*  to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in
+*  all copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+*  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+*  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+******************************************************************************
+*/
+
+#include "MICO.h"
+#include "SocketUtils.h"
+
+#define dns_log(M, ...) custom_log("DNS", M, ##__VA_ARGS__)
+
+#ifndef MICO_DNS_CACHE_ENTRIES
+#define MICO_DNS_CACHE_ENTRIES      (8)
+#endif
+
+#define DNS_PORT                    (53)
+#define DNS_PACKET_LEN              (512)
+#define DNS_HEADER_LEN              (12)
+#define DNS_RETRY_DELAY             (1000)      // ms to the first retransmission, doubled for every other one
+#define DNS_TRIES                   (3)
+#define DNS_MAX_TTL                 (24*3600)   // s, longer TTLs are cut
+#define DNS_NEGATIVE_TTL            (60)        // s, for a name without address and without a SOA record
+#define DNS_NEGATIVE_MAX_TTL        (300)       // s
+#define DNS_FAILURE_TTL             (5)         // s, for no answer or a server failure
+#define DNS_MAX_POINTERS            (16)        // Compression pointers followed in one name
+
+#define DNS_TYPE_A                  (1)
+#define DNS_TYPE_CNAME              (5)
+#define DNS_TYPE_SOA                (6)
+#define DNS_CLASS_IN                (1)
+#define DNS_FLAG_RESPONSE           (0x8000)
+#define DNS_FLAG_RECURSION          (0x0100)
+#define DNS_RCODE_MASK              (0x000F)
+#define DNS_RCODE_NXDOMAIN          (3)
+
+typedef enum
+{
+  DNS_ENTRY_FREE,
+  DNS_ENTRY_RESOLVING,      // Query in flight, the waiters are called when it is done
+  DNS_ENTRY_VALID,          // Address, expired ones are the last known address
+  DNS_ENTRY_NEGATIVE,       // Name does not exist, or the server failed, until expire
+} dns_entry_state_t;
+
+/* A thread in mico_system_dns_resolve( ) waits on its semaphore, on its own
+ * stack. The others are allocated and called by the resolver thread. */
+typedef struct _dns_waiter_t
+{
+  mico_dns_callback_t       callback;
+  void *                    arg;
+  mico_semaphore_t          sem;
+  bool                      done;
+  uint32_t                  ip;
+  OSStatus                  err;
+  char                      name[MICO_DNS_NAME_LEN];
+  struct _dns_waiter_t *    next;
+} dns_waiter_t;
+
+typedef struct
+{
+  dns_entry_state_t   state;
+  char                name[MICO_DNS_NAME_LEN];
+  uint32_t            ip;           // Last known address, 0 if none
+  OSStatus            err;          // Answer of a negative entry
+  uint32_t            expire;       // mico_get_time( ) when the answer runs out
+  uint32_t            last_used;
+  uint32_t            hits;         // Lookups answered from the cache
+  uint16_t            id;           // Query in flight
+  uint8_t             tries;
+  uint32_t            retry_at;
+  dns_waiter_t *      waiters;
+} dns_entry_t;
+
+static mico_mutex_t         dns_mutex = NULL;
+static mico_semaphore_t     dns_wakeup_sem = NULL;
+static bool                 dns_running = false;
+static dns_entry_t          dns_cache[MICO_DNS_CACHE_ENTRIES];
+static dns_waiter_t *       dns_done = NULL;            // Callbacks left to call
+static uint32_t             dns_server_ip = 0;
+static uint16_t             dns_server_port = 0;
+static mico_dns_persist_t * dns_persist_entries = NULL;
+static uint32_t             dns_persist_count = 0;
+static uint32_t             dns_queries = 0;
+static uint8_t              dns_packet[DNS_PACKET_LEN]; // Resolver thread only
+
+/* The first lookup may come before mico_system_init( ), when no other thread is running yet */
+static void dns_lock( void )
+{
+  if( dns_mutex == NULL )
+    mico_rtos_init_mutex( &dns_mutex );
+  mico_rtos_lock_mutex( &dns_mutex );
+}
+
+static void dns_unlock( void )
+{
+  mico_rtos_unlock_mutex( &dns_mutex );
+}
+
+static bool dns_expired( dns_entry_t *entry, uint32_t now )
+{
+  return (int32_t)( entry->expire - now ) <= 0;
+}
+
+/* Dotted decimal addresses are returned as they are, without a query */
+static bool dns_ip_literal( const char *hostname, uint32_t *ip )
+{
+  unsigned int part[4];
+  char tail;
+
+  if( sscanf( hostname, "%u.%u.%u.%u%c", &part[0], &part[1], &part[2], &part[3], &tail ) != 4 )
+    return false;
+  if( part[0] > 255 || part[1] > 255 || part[2] > 255 || part[3] > 255 )
+    return false;
+  *ip = inet_addr( (char *)hostname );
+  return true;
+}
+
+/* In the byte order of inet_addr( ), whatever the stack uses */
+static uint32_t dns_ip_from_bytes( const uint8_t *bytes )
+{
+  char ipstr[16];
+
+  sprintf( ipstr, "%d.%d.%d.%d", bytes[0], bytes[1], bytes[2], bytes[3] );
+  return inet_addr( ipstr );
+}
+
+static dns_entry_t *dns_entry_find( const char *hostname )
+{
+  int i;
+
+  for( i = 0; i < MICO_DNS_CACHE_ENTRIES; i++ ){
+    if( dns_cache[i].state != DNS_ENTRY_FREE && strcasecmp( dns_cache[i].name, hostname ) == 0 )
+      return &dns_cache[i];
+  }
+  return NULL;
+}
+
+/* A free entry, or the one used longest ago that no query is in flight for */
+static dns_entry_t *dns_entry_alloc( const char *hostname )
+{
+  dns_entry_t *entry = NULL;
+  int i;
+
+  for( i = 0; i < MICO_DNS_CACHE_ENTRIES; i++ ){
+    if( dns_cache[i].state == DNS_ENTRY_FREE ){
+      entry = &dns_cache[i];
+      break;
+    }
+    if( dns_cache[i].state == DNS_ENTRY_RESOLVING ) continue;
+    if( entry == NULL || (int32_t)( dns_cache[i].last_used - entry->last_used ) < 0 )
+      entry = &dns_cache[i];
+  }
+  require_quiet( entry, exit );
+
+  memset( entry, 0x0, sizeof(dns_entry_t) );
+  strncpy( entry->name, hostname, MICO_DNS_NAME_LEN - 1 );
+  entry->last_used = mico_get_time( );
+
+exit:
+  return entry;
+}
+
+/* Called locked. Blocking waiters get the answer at once, the callbacks are
+ * queued on dns_done and called by dns_run_callbacks( ) after unlocking. */
+static void dns_entry_done( dns_entry_t *entry, uint32_t ip, OSStatus err, uint32_t ttl )
+{
+  dns_waiter_t *waiter, *next, **done;
+
+  if( ttl > DNS_MAX_TTL ) ttl = DNS_MAX_TTL;
+  entry->state = ( err == kNoErr ) ? DNS_ENTRY_VALID : DNS_ENTRY_NEGATIVE;
+  entry->err = err;
+  entry->expire = mico_get_time( ) + ttl * 1000;
+  if( err == kNoErr ) entry->ip = ip;
+
+  for( done = &dns_done; *done; done = &(*done)->next );
+  for( waiter = entry->waiters; waiter; waiter = next ){
+    next = waiter->next;
+    waiter->next = NULL;
+    waiter->done = true;
+    waiter->ip = ( err == kNoErr ) ? ip : 0;
+    waiter->err = err;
+    if( waiter->callback == NULL ){
+      mico_rtos_set_semaphore( &waiter->sem );
+    }else{
+      *done = waiter;
+      done = &waiter->next;
+    }
+  }
+  entry->waiters = NULL;
+}
+
+static void dns_run_callbacks( void )
+{
+  dns_waiter_t *waiter;
+
+  while( 1 ){
+    dns_lock( );
+    waiter = dns_done;
+    if( waiter ) dns_done = waiter->next;
+    dns_unlock( );
+    if( waiter == NULL ) break;
+
+    waiter->callback( waiter->name, waiter->ip, waiter->err, waiter->arg );
+    free( waiter );
+  }
+}
+
+/* Only the addresses of the names the application has put in the entries are kept */
+static void dns_persist_update( const char *hostname, uint32_t ip )
+{
+  bool changed = false;
+  uint32_t i;
+
+  dns_lock( );
+  for( i = 0; i < dns_persist_count; i++ ){
+    if( strcasecmp( dns_persist_entries[i].name, hostname ) == 0 && dns_persist_entries[i].ip != ip ){
+      dns_persist_entries[i].ip = ip;
+      changed = true;
+    }
+  }
+  dns_unlock( );
+
+  if( changed )
+    mico_system_context_update( mico_system_context_get( ) );
+}
+
+static int dns_build_query( uint8_t *packet, uint16_t id, const char *hostname )
+{
+  uint8_t *p = packet, *label;
+  const char *c;
+
+  memset( p, 0x0, DNS_HEADER_LEN );
+  WriteBig16( p, id );
+  WriteBig16( p + 2, DNS_FLAG_RECURSION );
+  WriteBig16( p + 4, 1 );
+  p += DNS_HEADER_LEN;
+
+  /* Labels are written behind their length byte, which is filled in at the next dot */
+  for( label = p++, c = hostname; ; c++ ){
+    if( *c == '.' || *c == 0 ){
+      if( p - label - 1 == 0 || p - label - 1 > 63 ) return -1;
+      *label = (uint8_t)( p - label - 1 );
+      if( *c == 0 ) break;
+      label = p++;
+    }else{
+      *p++ = (uint8_t)*c;
+    }
+  }
+  *p++ = 0;
+
+  WriteBig16( p, DNS_TYPE_A );
+  WriteBig16( p + 2, DNS_CLASS_IN );
+  return p + 4 - packet;
+}
+
+/* Read a possibly compressed name at offset into name, returns the offset behind it */
+static int dns_read_name( const uint8_t *msg, int len, int offset, char *name, int name_len )
+{
+  int end = -1, out = 0, pointers = 0, label;
+
+  while( 1 ){
+    if( offset >= len ) return -1;
+    label = msg[offset];
+    if( label == 0 ){
+      offset++;
+      break;
+    }
+    if( ( label & 0xC0 ) == 0xC0 ){
+      if( offset + 1 >= len || ++pointers > DNS_MAX_POINTERS ) return -1;
+      if( end < 0 ) end = offset + 2;
+      offset = ( ( label & 0x3F ) << 8 ) | msg[offset + 1];
+      continue;
+    }
+    if( offset + 1 + label > len || out + label + 1 >= name_len ) return -1;
+    if( out ) name[out++] = '.';
+    memcpy( &name[out], &msg[offset + 1], label );
+    out += label;
+    offset += label + 1;
+  }
+
+  name[out] = 0;
+  return ( end < 0 ) ? offset : end;
+}
+
+/* kNoErr with the address, kNotFoundErr when there is none, kResponseErr for a
+ * server failure, all with a TTL in s. kMalformedErr when it is not an answer
+ * to the question about hostname. */
+static OSStatus dns_parse_response( const uint8_t *msg, int len, const char *hostname, uint32_t *ip, uint32_t *ttl )
+{
+  char name[MICO_DNS_NAME_LEN], target[MICO_DNS_NAME_LEN];
+  uint16_t flags, qdcount, ancount, nscount, type, rdlen, i;
+  uint32_t rr_ttl, min_ttl = DNS_MAX_TTL;
+  int offset, rdata;
+
+  if( len < DNS_HEADER_LEN ) return kMalformedErr;
+  flags = ReadBig16( msg + 2 );
+  qdcount = ReadBig16( msg + 4 );
+  ancount = ReadBig16( msg + 6 );
+  nscount = ReadBig16( msg + 8 );
+  if( !( flags & DNS_FLAG_RESPONSE ) || qdcount != 1 ) return kMalformedErr;
+
+  offset = dns_read_name( msg, len, DNS_HEADER_LEN, name, sizeof(name) );
+  if( offset < 0 || offset + 4 > len || strcasecmp( name, hostname ) ) return kMalformedErr;
+  offset += 4;
+
+  *ttl = DNS_FAILURE_TTL;
+  if( ( flags & DNS_RCODE_MASK ) != 0 && ( flags & DNS_RCODE_MASK ) != DNS_RCODE_NXDOMAIN )
+    return kResponseErr;
+
+  /* Follow the CNAME records to the address, they come in order */
+  strcpy( target, hostname );
+  for( i = 0; i < ancount + nscount; i++ ){
+    offset = dns_read_name( msg, len, offset, name, sizeof(name) );
+    if( offset < 0 || offset + 10 > len ) break;
+    type = ReadBig16( msg + offset );
+    rr_ttl = ReadBig32( msg + offset + 4 );
+    rdlen = ReadBig16( msg + offset + 8 );
+    rdata = offset + 10;
+    offset = rdata + rdlen;
+    if( offset > len ) break;
+    if( ReadBig16( msg + rdata - 8 ) != DNS_CLASS_IN ) continue;
+
+    if( i < ancount ){
+      if( strcasecmp( name, target ) ) continue;
+      if( rr_ttl < min_ttl ) min_ttl = rr_ttl;
+      if( type == DNS_TYPE_A && rdlen == 4 ){
+        *ip = dns_ip_from_bytes( msg + rdata );
+        *ttl = min_ttl;
+        return kNoErr;
+      }
+      if( type == DNS_TYPE_CNAME && dns_read_name( msg, len, rdata, target, sizeof(target) ) < 0 )
+        break;
+    }
+    else if( type == DNS_TYPE_SOA ){
+      /* RFC 2308: negative answers are kept for the smaller of the SOA TTL and minimum */
+      if( ( rdata = dns_read_name( msg, len, rdata, name, sizeof(name) ) ) < 0 ) break;
+      if( ( rdata = dns_read_name( msg, len, rdata, name, sizeof(name) ) ) < 0 || rdata + 20 > offset ) break;
+      *ttl = Min( rr_ttl, ReadBig32( msg + rdata + 16 ) );
+      if( *ttl > DNS_NEGATIVE_MAX_TTL ) *ttl = DNS_NEGATIVE_MAX_TTL;
+      return kNotFoundErr;
+    }
+  }
+
+  *ttl = DNS_NEGATIVE_TTL;
+  return kNotFoundErr;
+}
+
+static bool dns_server( struct sockaddr_t *addr )
+{
+  IPStatusTypedef para;
+
+  addr->s_port = dns_server_port ? dns_server_port : DNS_PORT;
+  addr->s_ip = dns_server_ip;
+  if( addr->s_ip == 0 && micoWlanGetIPStatus( &para, Station ) == kNoErr )
+    addr->s_ip = inet_addr( para.dns );
+  return addr->s_ip != 0 && addr->s_ip != 0xFFFFFFFF;
+}
+
+/* Send the queries that are due, and fail those tried often enough.
+ * Returns the ms until the next retransmission. */
+static uint32_t dns_send_queries( int fd, struct sockaddr_t *server )
+{
+  dns_entry_t *entry;
+  uint32_t now, wait = MICO_WAIT_FOREVER;
+  int32_t left;
+  int i, len;
+
+  dns_lock( );
+  now = mico_get_time( );
+  for( i = 0; i < MICO_DNS_CACHE_ENTRIES; i++ ){
+    entry = &dns_cache[i];
+    if( entry->state != DNS_ENTRY_RESOLVING ) continue;
+
+    if( (int32_t)( entry->retry_at - now ) <= 0 ){
+      if( entry->tries >= DNS_TRIES ){
+        dns_log( "No answer for %s", entry->name );
+        dns_entry_done( entry, 0, kTimeoutErr, DNS_FAILURE_TTL );
+        continue;
+      }
+      MicoRandomNumberRead( &entry->id, sizeof(entry->id) );
+      len = dns_build_query( dns_packet, entry->id, entry->name );
+      if( len < 0 ){
+        dns_entry_done( entry, 0, kNotFoundErr, DNS_NEGATIVE_TTL );
+        continue;
+      }
+      if( server->s_ip )
+        sendto( fd, dns_packet, len, 0, server, sizeof(struct sockaddr_t) );
+      dns_queries++;
+      entry->retry_at = now + ( DNS_RETRY_DELAY << entry->tries );
+      entry->tries++;
+    }
+
+    left = (int32_t)( entry->retry_at - now );
+    if( (uint32_t)left < wait ) wait = left;
+  }
+  dns_unlock( );
+  return wait;
+}
+
+static void dns_receive( int fd, struct sockaddr_t *server )
+{
+  struct sockaddr_t addr;
+  socklen_t addr_len = sizeof(addr);
+  dns_entry_t *entry = NULL;
+  char name[MICO_DNS_NAME_LEN];
+  uint32_t ip = 0, ttl = 0;
+  OSStatus err = kMalformedErr;
+  int len, i;
+
+  len = recvfrom( fd, dns_packet, sizeof(dns_packet), 0, &addr, &addr_len );
+  if( len < DNS_HEADER_LEN || addr.s_ip != server->s_ip || addr.s_port != server->s_port ) return;
+
+  dns_lock( );
+  for( i = 0; i < MICO_DNS_CACHE_ENTRIES && entry == NULL; i++ ){
+    if( dns_cache[i].state == DNS_ENTRY_RESOLVING && dns_cache[i].tries && dns_cache[i].id == ReadBig16( dns_packet ) )
+      entry = &dns_cache[i];
+  }
+  if( entry ) strcpy( name, entry->name );
+  dns_unlock( );
+  if( entry == NULL ) return;
+
+  err = dns_parse_response( dns_packet, len, name, &ip, &ttl );
+  if( err == kMalformedErr ) return;
+
+  /* The configuration holds the new address before the waiters wake up */
+  if( err == kNoErr ){
+    /* Delivers mico_notify_DNS_RESOLVE_COMPLETED like the stack's own lookups */
+    dns_ip_set( (uint8_t *)name, ip );
+    dns_persist_update( name, ip );
+  }
+
+  /* Unless the cache was flushed in the meantime */
+  dns_lock( );
+  if( entry->state == DNS_ENTRY_RESOLVING && entry->id == ReadBig16( dns_packet ) && strcmp( entry->name, name ) == 0 )
+    dns_entry_done( entry, ip, err, ttl );
+  dns_unlock( );
+}
+
+static void dns_resolver_thread( void *arg )
+{
+  struct sockaddr_t server;
+  struct timeval_t t;
+  fd_set readfds;
+  uint32_t wait;
+  int fd, wakeup_fd;
+
+  UNUSED_PARAMETER( arg );
+
+  fd = socket( AF_INET, SOCK_DGRM, IPPROTO_UDP );
+  wakeup_fd = mico_create_event_fd( dns_wakeup_sem );
+  require_action( IsValidSocket( fd ) && wakeup_fd >= 0, exit, dns_log( "Resolver has no socket" ) );
+
+  while( 1 ){
+    /* The station's DNS server changes with every DHCP lease */
+    dns_server( &server );
+    wait = dns_send_queries( fd, &server );
+    dns_run_callbacks( );
+
+    FD_ZERO( &readfds );
+    FD_SET( fd, &readfds );
+    FD_SET( wakeup_fd, &readfds );
+    t.tv_sec = ( wait == MICO_WAIT_FOREVER ) ? 3600 : wait / 1000;
+    t.tv_usec = ( wait == MICO_WAIT_FOREVER ) ? 0 : ( wait % 1000 ) * 1000;
+    select( Max( fd, wakeup_fd ) + 1, &readfds, NULL, NULL, &t );
+
+    if( FD_ISSET( wakeup_fd, &readfds ) )
+      mico_rtos_get_semaphore( &dns_wakeup_sem, 0 );
+    if( FD_ISSET( fd, &readfds ) ){
+      dns_receive( fd, &server );
+      dns_run_callbacks( );
+    }
+  }
+
+exit:
+  SocketClose( &fd );
+  dns_lock( );
+  dns_running = false;
+  dns_unlock( );
+  mico_rtos_delete_thread( NULL );
+}
+
+static OSStatus dns_start( void )
+{
+  OSStatus err = kNoErr;
+
+  dns_lock( );
+  require_quiet( !dns_running, exit );
+  if( dns_wakeup_sem == NULL ){
+    err = mico_rtos_init_semaphore( &dns_wakeup_sem, 1 );
+    require_noerr( err, exit );
+  }
+  err = mico_rtos_create_thread( NULL, MICO_APPLICATION_PRIORITY, "DNS Resolver", dns_resolver_thread,
+                                 STACK_SIZE_DNS_RESOLVER_THREAD, NULL );
+  require_noerr( err, exit );
+  dns_running = true;
+
+exit:
+  dns_unlock( );
+  return err;
+}
+
+/* Called locked. Answers from the cache, or adds waiter to the entry of the
+ * name and returns kInProgressErr. */
+static OSStatus dns_lookup( const char *hostname, dns_waiter_t *waiter, uint32_t *ip )
+{
+  OSStatus err = kNoErr;
+  dns_entry_t *entry;
+  uint32_t now = mico_get_time( );
+
+  entry = dns_entry_find( hostname );
+  if( entry && entry->state == DNS_ENTRY_VALID && !dns_expired( entry, now ) ){
+    *ip = entry->ip;
+    goto hit;
+  }
+  if( entry && entry->state == DNS_ENTRY_NEGATIVE && !dns_expired( entry, now ) ){
+    err = entry->err;
+    goto hit;
+  }
+
+  if( entry == NULL ){
+    entry = dns_entry_alloc( hostname );
+    require_action( entry, exit, err = kNoResourcesErr );
+  }
+  entry->last_used = now;
+  if( entry->state != DNS_ENTRY_RESOLVING ){
+    entry->state = DNS_ENTRY_RESOLVING;
+    entry->tries = 0;
+    entry->retry_at = now;
+  }
+  if( waiter ){
+    waiter->next = entry->waiters;
+    entry->waiters = waiter;
+  }
+  err = kInProgressErr;
+  goto exit;
+
+hit:
+  entry->last_used = now;
+  entry->hits++;
+exit:
+  return err;
+}
+
+OSStatus mico_system_dns_resolve( const char *hostname, uint32_t *ip, uint32_t timeout_ms )
+{
+  OSStatus err = kNoErr;
+  dns_waiter_t waiter;
+  dns_waiter_t **pwaiter;
+  int i;
+
+  require_action( hostname && ip && strlen( hostname ) < MICO_DNS_NAME_LEN, exit, err = kParamErr );
+  require_quiet( !dns_ip_literal( hostname, ip ), exit );
+
+  err = dns_start( );
+  require_noerr( err, exit );
+
+  memset( &waiter, 0x0, sizeof(waiter) );
+  err = mico_rtos_init_semaphore( &waiter.sem, 1 );
+  require_noerr( err, exit );
+
+  dns_lock( );
+  err = dns_lookup( hostname, &waiter, ip );
+  dns_unlock( );
+
+  if( err == kInProgressErr ){
+    mico_rtos_set_semaphore( &dns_wakeup_sem );
+    mico_rtos_get_semaphore( &waiter.sem, timeout_ms );
+
+    /* The answer may come between the timeout and here */
+    dns_lock( );
+    if( waiter.done ){
+      *ip = waiter.ip;
+      err = waiter.err;
+    }else{
+      for( i = 0; i < MICO_DNS_CACHE_ENTRIES; i++ ){
+        for( pwaiter = &dns_cache[i].waiters; *pwaiter && *pwaiter != &waiter; pwaiter = &(*pwaiter)->next );
+        if( *pwaiter ) *pwaiter = waiter.next;
+      }
+      err = kTimeoutErr;
+    }
+    dns_unlock( );
+  }
+
+  mico_rtos_deinit_semaphore( &waiter.sem );
+
+exit:
+  return err;
+}
+
+OSStatus mico_system_dns_resolve_async( const char *hostname, mico_dns_callback_t callback, void *arg )
+{
+  OSStatus err = kNoErr;
+  dns_waiter_t *waiter = NULL;
+  uint32_t ip = 0;
+
+  require_action( hostname && strlen( hostname ) < MICO_DNS_NAME_LEN, exit, err = kParamErr );
+
+  if( dns_ip_literal( hostname, &ip ) ){
+    if( callback ) callback( hostname, ip, kNoErr, arg );
+    goto exit;
+  }
+
+  err = dns_start( );
+  require_noerr( err, exit );
+
+  if( callback ){
+    waiter = calloc( 1, sizeof(dns_waiter_t) );
+    require_action( waiter, exit, err = kNoMemoryErr );
+    waiter->callback = callback;
+    waiter->arg = arg;
+    strcpy( waiter->name, hostname );
+  }
+
+  dns_lock( );
+  err = dns_lookup( hostname, waiter, &ip );
+  dns_unlock( );
+
+  if( err == kInProgressErr ){
+    mico_rtos_set_semaphore( &dns_wakeup_sem );
+    waiter = NULL;
+    err = kNoErr;
+  }else if( err != kNoResourcesErr ){
+    if( callback ) callback( hostname, ( err == kNoErr ) ? ip : 0, err, arg );
+    err = kNoErr;
+  }
+
+exit:
+  if( waiter ) free( waiter );
+  return err;
+}
+
+OSStatus mico_system_dns_last_known( const char *hostname, uint32_t *ip )
+{
+  OSStatus err = kNoErr;
+  dns_entry_t *entry;
+
+  require_action( hostname && ip, exit, err = kParamErr );
+  require_quiet( !dns_ip_literal( hostname, ip ), exit );
+
+  dns_lock( );
+  entry = dns_entry_find( hostname );
+  if( entry && entry->ip )
+    *ip = entry->ip;
+  else
+    err = kNotFoundErr;
+  dns_unlock( );
+
+exit:
+  return err;
+}
+
+OSStatus mico_system_dns_persist( mico_dns_persist_t *entries, uint32_t count )
+{
+  OSStatus err = kNoErr;
+  dns_entry_t *entry;
+  uint32_t i;
+
+  require_action( entries || count == 0, exit, err = kParamErr );
+
+  dns_lock( );
+  dns_persist_entries = entries;
+  dns_persist_count = count;
+
+  /* Loaded as expired addresses, a lookup still asks the server */
+  for( i = 0; i < count; i++ ){
+    entries[i].name[MICO_DNS_NAME_LEN - 1] = 0;
+    if( entries[i].name[0] == 0 || entries[i].ip == 0 || dns_entry_find( entries[i].name ) ) continue;
+    entry = dns_entry_alloc( entries[i].name );
+    if( entry == NULL ) break;
+    entry->state = DNS_ENTRY_VALID;
+    entry->ip = entries[i].ip;
+    entry->expire = mico_get_time( );
+  }
+  dns_unlock( );
+
+exit:
+  return err;
+}
+
+void mico_system_dns_set_server( uint32_t ip, uint16_t port )
+{
+  dns_lock( );
+  dns_server_ip = ip;
+  dns_server_port = port;
+  dns_unlock( );
+}
+
+void mico_system_dns_flush( void )
+{
+  int i;
+
+  dns_lock( );
+  for( i = 0; i < MICO_DNS_CACHE_ENTRIES; i++ ){
+    if( dns_cache[i].state != DNS_ENTRY_RESOLVING )
+      dns_cache[i].state = DNS_ENTRY_FREE;
+  }
+  dns_unlock( );
+}
+
+/* One line for every cached name: state, seconds left, lookups from the cache, address */
+void system_dns_print( int (*print)( const char *format, ... ) )
+{
+  static const char * const state_names[] = { "free", "query", "valid", "negative" };
+  struct sockaddr_t server;
+  dns_entry_t entry;
+  char ipstr[16];
+  uint32_t now;
+  int i;
+
+  dns_lock( );
+  dns_server( &server );
+  print( "DNS server %s:%d, %d queries sent\r\n", inet_ntoa( ipstr, server.s_ip ), server.s_port, (int)dns_queries );
+  print( "   state    ttl   hits  address          name\r\n" );
+  now = mico_get_time( );
+  for( i = 0; i < MICO_DNS_CACHE_ENTRIES; i++ ){
+    entry = dns_cache[i];
+    if( entry.state == DNS_ENTRY_FREE ) continue;
+    if( entry.state != DNS_ENTRY_RESOLVING && dns_expired( &entry, now ) )
+      print( "%8s %6s %6d  %-15s  %s\r\n", "expired", "-", (int)entry.hits,
+             entry.ip ? inet_ntoa( ipstr, entry.ip ) : "-", entry.name );
+    else
+      print( "%8s %6d %6d  %-15s  %s\r\n", state_names[entry.state],
+             entry.state == DNS_ENTRY_RESOLVING ? 0 : (int)( ( entry.expire - now ) / 1000 ), (int)entry.hits,
+             entry.ip ? inet_ntoa( ipstr, entry.ip ) : "-", entry.name );
+  }
+  dns_unlock( );
+}
@@ -77,36 +77,43 @@ void* mico_system_context_get_user_data( mico_Context_t* const in_context )
 }
 
 
-OSStatus mico_system_init( mico_Context_t* in_context )
-{
-  OSStatus err = kNoErr;
+/* mico_system_init( ) runs every step below when the readiness events it waits
+ * for are set, a step with a stack size runs in its own thread, concurrently
+ * with the steps that do not depend on it. Steps without a stack size run in
+ * the thread that calls mico_system_init( ), in the order of this table. */
+typedef OSStatus (*system_init_function_t)( mico_Context_t * const in_context );
 
-  require_action( in_context, exit, err = kNotPreparedErr );
-
-  /* Initialize power management daemen */
-  err = mico_system_power_daemon_start( in_context );
-  require_noerr( err, exit ); 
-
-  /* Initialize mico notify system */
-  err = system_notification_init( in_context );
-  require_noerr( err, exit ); 
+typedef struct
+{
+  const char *            name;
+  system_init_function_t  start;
+  uint32_t                after;        // Readiness events the step waits for
+  uint32_t                ready;        // Readiness event set when the step is done
+  uint32_t                stack_size;   // 0: Run in the thread of mico_system_init( )
+} system_init_step_t;
 
 #ifdef MICO_SYSTEM_MONITOR_ENABLE
-  /* MiCO system monitor */
-  err = mico_system_monitor_daemen_start( );
-  require_noerr( err, exit ); 
+static OSStatus system_init_monitor( mico_Context_t * const in_context )
+{
+  UNUSED_PARAMETER( in_context );
+  return mico_system_monitor_daemen_start( );
+}
 #endif
 
 #ifdef MICO_CLI_ENABLE
-  /* MiCO command line interface */
+static OSStatus system_init_cli( mico_Context_t * const in_context )
+{
+  UNUSED_PARAMETER( in_context );
   cli_init();
+  return kNoErr;
+}
 #endif
 
-  /* Network PHY driver and tcp/ip static init */
-  err = system_network_daemen_start( in_context );
-  require_noerr( err, exit ); 
-
 #ifdef MICO_WLAN_CONNECTION_ENABLE
+static OSStatus system_init_wlan( mico_Context_t * const in_context )
+{
+  OSStatus err = kNoErr;
+
   if( in_context->flashContentInRam.micoSystemConfig.configured == wLanUnConfigured ||
       in_context->flashContentInRam.micoSystemConfig.configured == unConfigured){
     system_log("Empty configuration. Starting configuration mode...");
@@ -134,27 +141,160 @@ OSStatus mico_system_init( mico_Context_t* in_context )
     system_log("Available configuration. Starting Wi-Fi connection...");
     system_connect_wifi_fast( in_context );
   }
+
+exit:
+  return err;
+}
 #endif
-  
-  /* System discovery */
+
 #ifdef MICO_SYSTEM_DISCOVERY_ENABLE
+static OSStatus system_init_discovery( mico_Context_t * const in_context )
+{
   system_discovery_init( in_context );
+  return kNoErr;
+}
 #endif
-  
-  /*Local configuration server*/
+
 #ifdef MICO_CONFIG_SERVER_ENABLE
+static OSStatus system_init_config_server( mico_Context_t * const in_context )
+{
   config_server_start( in_context );
+  return kNoErr;
+}
+#endif
+
+#ifdef AIRKISS_DISCOVERY_ENABLE
+static OSStatus system_init_airkiss( mico_Context_t * const in_context )
+{
+  UNUSED_PARAMETER( in_context );
+  return airkiss_discovery_start( AIRKISS_APP_ID, AIRKISS_DEVICE_ID );
+}
+#endif
+
+static const system_init_step_t system_init_steps[] =
+{
+  /* Initialize power management daemen */
+  { "power daemon",   mico_system_power_daemon_start, 0, 0, 0 },
+  /* Initialize mico notify system, before anything can send a notification */
+  { "notification",   system_notification_init, 0, mico_ready_NOTIFICATION, 0 },
+  /* Network PHY driver and tcp/ip static init, the longest step */
+  { "network",        system_network_daemen_start, mico_ready_NOTIFICATION, mico_ready_NETWORK, 0 },
+#ifdef MICO_SYSTEM_MONITOR_ENABLE
+  /* MiCO system monitor */
+  { "monitor",        system_init_monitor, 0, mico_ready_MONITOR, STACK_SIZE_SYSTEM_INIT_THREAD },
+#endif
+#ifdef MICO_CLI_ENABLE
+  /* MiCO command line interface */
+  { "cli",            system_init_cli, 0, mico_ready_CLI, STACK_SIZE_SYSTEM_INIT_THREAD },
+#endif
+#ifdef MICO_WLAN_CONNECTION_ENABLE
+  { "wlan",           system_init_wlan, mico_ready_NETWORK, mico_ready_WLAN_STARTED, 0 },
+#endif
+#ifdef MICO_SYSTEM_DISCOVERY_ENABLE
+  /* System discovery, the mDNS service is started by the first record, which may be EasyLink's */
+  { "discovery",      system_init_discovery, mico_ready_NETWORK | mico_ready_WLAN_STARTED, mico_ready_DISCOVERY, STACK_SIZE_SYSTEM_INIT_THREAD },
+#endif
+#ifdef MICO_CONFIG_SERVER_ENABLE
+  /*Local configuration server*/
+  /* It registers CLI commands, after cli_init( ) */
+#ifdef MICO_CLI_ENABLE
+  { "config server",  system_init_config_server, mico_ready_NETWORK | mico_ready_CLI, mico_ready_CONFIG_SERVER, STACK_SIZE_SYSTEM_INIT_THREAD },
+#else
+  { "config server",  system_init_config_server, mico_ready_NETWORK, mico_ready_CONFIG_SERVER, STACK_SIZE_SYSTEM_INIT_THREAD },
+#endif
 #endif
-  
 #ifdef AIRKISS_DISCOVERY_ENABLE
-  err = airkiss_discovery_start( AIRKISS_APP_ID, AIRKISS_DEVICE_ID );
-  require_noerr( err, exit );
+  { "airkiss",        system_init_airkiss, mico_ready_NETWORK, mico_ready_AIRKISS, STACK_SIZE_SYSTEM_INIT_THREAD },
 #endif
+};
+
+#define SYSTEM_INIT_STEPS   ( sizeof(system_init_steps) / sizeof(system_init_steps[0]) )
+
+static mico_mutex_t     system_init_mutex = NULL;
+static mico_Context_t * system_init_context;
+static uint32_t         system_init_remaining;
+static OSStatus         system_init_err;
+
+/* The event of a step that failed is not set, the steps waiting for it are
+ * released by SYSTEM_READY_INIT_FAILED instead, and skipped */
+static void system_init_step_done( const system_init_step_t *step, OSStatus err )
+{
+  uint32_t events = step->ready;
+
+  mico_rtos_lock_mutex( &system_init_mutex );
+  if( err != kNoErr ){
+    if( system_init_err == kNoErr ){
+      system_log( "%s start failed, err = %d", step->name, err );
+      system_init_err = err;
+    }
+    events = SYSTEM_READY_INIT_FAILED;
+  }
+  if( --system_init_remaining == 0 )
+    events |= SYSTEM_READY_INIT_DONE;
+  mico_rtos_unlock_mutex( &system_init_mutex );
+
+  mico_system_ready_set( events );
+}
+
+static void system_init_step_run( const system_init_step_t *step )
+{
+  OSStatus err = kNoErr;
+
+  system_ready_wait( step->after, SYSTEM_READY_INIT_FAILED, MICO_NEVER_TIMEOUT );
+
+  /* Nothing is started after a step has failed, as when the steps were run one by one */
+  if( system_init_err == kNoErr ){
+    mico_system_boot_trace_begin( step->name );
+    err = step->start( system_init_context );
+    mico_system_boot_trace_end( step->name );
+  }
+  system_init_step_done( step, err );
+}
+
+static void system_init_step_thread( void *arg )
+{
+  system_init_step_run( (const system_init_step_t *)arg );
+  mico_rtos_delete_thread( NULL );
+}
+
+OSStatus mico_system_init( mico_Context_t* in_context )
+{
+  OSStatus err = kNoErr;
+  uint32_t i;
+
+  require_action( in_context, exit, err = kNotPreparedErr );
+
+  mico_system_boot_trace_begin( "system init" );
+  if( system_init_mutex == NULL )
+    mico_rtos_init_mutex( &system_init_mutex );
+  system_init_context = in_context;
+  system_init_remaining = SYSTEM_INIT_STEPS;
+  system_init_err = kNoErr;
+  mico_system_ready_clear( mico_ready_SYSTEM | SYSTEM_READY_INIT_DONE | SYSTEM_READY_INIT_FAILED );
+
+  /* Threads first, so they start as soon as the events they wait for are set */
+  for( i = 0; i < SYSTEM_INIT_STEPS; i++ ){
+    if( system_init_steps[i].stack_size == 0 )
+      continue;
+    err = mico_rtos_create_thread( NULL, MICO_APPLICATION_PRIORITY, system_init_steps[i].name, system_init_step_thread,
+                                   system_init_steps[i].stack_size, (void *)&system_init_steps[i] );
+    if( err != kNoErr )
+      system_init_step_done( &system_init_steps[i], err );
+  }
+
+  for( i = 0; i < SYSTEM_INIT_STEPS; i++ ){
+    if( system_init_steps[i].stack_size == 0 )
+      system_init_step_run( &system_init_steps[i] );
+  }
+
+  mico_system_ready_wait( SYSTEM_READY_INIT_DONE, MICO_NEVER_TIMEOUT );
+  mico_system_boot_trace_end( "system init" );
+  err = system_init_err;
+  if( err == kNoErr )
+    mico_system_ready_set( mico_ready_SYSTEM );
 
   require_noerr_action( err, exit, system_log("Closing main thread with err num: %d.", err) );
 exit:
   
   return err;
 }
-
-
@@ -114,7 +114,8 @@ OSStatus mico_system_monitor_update(mico_system_monitor_t* system_monitor, uint3
   return kNoErr;
 }
 
-static mico_timer_t _watchdog_reload_timer;
+/* Reloaded by a system timer, the watchdog also resets the system when the timer service is stuck */
+static mico_system_timer_t _watchdog_reload_timer;
 
 static mico_system_monitor_t mico_monitor;
 
@@ -135,8 +136,9 @@ OSStatus mico_system_monitor_daemen_start( void )
   /* Register first monitor */
   err = mico_system_monitor_register(&mico_monitor, APPLICATION_WATCHDOG_TIMEOUT_SECONDS*1000);
   require_noerr( err, exit );
-  mico_init_timer(&_watchdog_reload_timer,APPLICATION_WATCHDOG_TIMEOUT_SECONDS*1000/2, _watchdog_reload_timer_handler, NULL);
-  mico_start_timer(&_watchdog_reload_timer);  
+  mico_system_timer_init(&_watchdog_reload_timer, _watchdog_reload_timer_handler, NULL);
+  err = mico_system_timer_start(&_watchdog_reload_timer, APPLICATION_WATCHDOG_TIMEOUT_SECONDS*1000/2, APPLICATION_WATCHDOG_TIMEOUT_SECONDS*1000/2);
+  require_noerr( err, exit );
 exit:
   return err;
 }
@@ -0,0 +1,323 @@
+/**
+******************************************************************************
+* @file    mico_system_ota.c
+* @author  William Xu
+* @version V1.0.0
+* @date    17-Oct-2026
+* @brief   This file provides the writer that stores a firmware image into the
+*          OTA partition while it is received.
+******************************************************************************
+*
+*  The MIT License
+*  Copyright (c) 2016 MXCHIP Inc.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy 
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights 
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is furnished
+*  to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in
+*  all copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+*  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR 
+*  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+******************************************************************************
+*/ 
+
+#include "MICO.h"
+#include "mico_system.h"
+#include "system.h"
+#include "CheckSumUtils.h"
+
+#define ota_log(M, ...) custom_log("OTA", M, ##__VA_ARGS__)
+#define ota_log_trace() custom_log_trace("OTA")
+
+/* Size of each of the two buffers between the receiver and the flash thread */
+#ifndef OTA_WRITER_BUFFER_SIZE
+#define OTA_WRITER_BUFFER_SIZE      ( 2048 )
+#endif
+
+/* The partition is erased in units of this size, it must not exceed the
+ * smallest sector of any flash an OTA partition is placed on. */
+#ifndef OTA_WRITER_ERASE_UNIT
+#define OTA_WRITER_ERASE_UNIT       ( 0x1000 )
+#endif
+
+/* How far the flash thread erases ahead of the write pointer while it waits for data */
+#ifndef OTA_WRITER_ERASE_AHEAD
+#define OTA_WRITER_ERASE_AHEAD      ( 2 * OTA_WRITER_ERASE_UNIT )
+#endif
+
+#define OTA_WRITER_BLANK_CHECK_SIZE ( 64 )
+
+typedef struct _ota_writer_buffer_t {
+  uint8_t             data[OTA_WRITER_BUFFER_SIZE];
+  uint32_t            len;
+} ota_writer_buffer_t;
+
+/* Chunks are copied into buffer[fill] by the receiver. A full buffer is handed
+ * to the flash thread through full_sem, and comes back through free_sem once it
+ * is programmed, so one buffer can be filled while the other is written. A
+ * buffer handed over with len 0 stops the flash thread. */
+struct _mico_ota_writer_t {
+  uint32_t            partition_length;
+  uint32_t            limit;          /* Bytes the image may take */
+  uint32_t            received;       /* Bytes accepted from the receiver */
+  uint32_t            offset;         /* Flash thread: next byte to program */
+  uint32_t            erased;         /* Flash thread: end of the erased area */
+  volatile uint32_t   submitted;      /* Buffers handed to the flash thread */
+  volatile uint32_t   programmed;     /* Flash thread: buffers given back */
+  volatile OSStatus   err;            /* First flash error, reported to the receiver */
+  volatile bool       abort;
+  CRC16_Context       crc16_contex;
+  uint8_t             fill;
+  uint8_t             drain;
+  mico_semaphore_t    full_sem;
+  mico_semaphore_t    free_sem;
+  mico_semaphore_t    done_sem;
+  ota_writer_buffer_t buffer[2];
+};
+
+static bool ota_writer_is_blank( uint32_t offset, uint32_t size )
+{
+  uint8_t data[OTA_WRITER_BLANK_CHECK_SIZE];
+  uint32_t len, i;
+
+  while( size ){
+    len = Min( size, sizeof(data) );
+    if( MicoFlashRead( MICO_PARTITION_OTA_TEMP, &offset, data, len ) != kNoErr )
+      return false;
+    for( i = 0; i < len; i++ ){
+      if( data[i] != 0xFF )
+        return false;
+    }
+    size -= len;
+  }
+  return true;
+}
+
+/* Erase the next unit. A unit found blank is left alone, this also skips the
+ * units already wiped together with a previous one on flash with larger sectors. */
+static OSStatus ota_writer_erase_next( mico_ota_writer_t *writer )
+{
+  OSStatus err = kNoErr;
+  uint32_t size = Min( OTA_WRITER_ERASE_UNIT, writer->partition_length - writer->erased );
+
+  if( ota_writer_is_blank( writer->erased, size ) == false ){
+    err = MicoFlashErase( MICO_PARTITION_OTA_TEMP, writer->erased, size );
+    require_noerr( err, exit );
+  }
+  writer->erased += size;
+
+exit:
+  return err;
+}
+
+static OSStatus ota_writer_program( mico_ota_writer_t *writer, uint8_t *data, uint32_t len )
+{
+  OSStatus err = kNoErr;
+
+  while( writer->erased < writer->offset + len ){
+    err = ota_writer_erase_next( writer );
+    require_noerr( err, exit );
+  }
+
+  CRC16_Update( &writer->crc16_contex, data, len );
+  err = MicoFlashWrite( MICO_PARTITION_OTA_TEMP, &writer->offset, data, len );
+  require_noerr( err, exit );
+
+exit:
+  return err;
+}
+
+static void ota_writer_thread( void *arg )
+{
+  mico_ota_writer_t *writer = arg;
+  ota_writer_buffer_t *buffer;
+
+  while( 1 ){
+    if( mico_rtos_get_semaphore( &writer->full_sem, 0 ) != kNoErr ){
+      /* Nothing to program, get the next sectors ready while the receiver waits for data */
+      if( writer->err == kNoErr && writer->abort == false
+         && writer->erased < writer->limit
+         && writer->erased < writer->offset + OTA_WRITER_ERASE_AHEAD ){
+        writer->err = ota_writer_erase_next( writer );
+        continue;
+      }
+      mico_rtos_get_semaphore( &writer->full_sem, MICO_WAIT_FOREVER );
+    }
+
+    buffer = &writer->buffer[writer->drain];
+    if( buffer->len == 0 )
+      break;
+
+    if( writer->err == kNoErr && writer->abort == false )
+      writer->err = ota_writer_program( writer, buffer->data, buffer->len );
+
+    writer->drain ^= 1;
+    writer->programmed++;
+    mico_rtos_set_semaphore( &writer->free_sem );
+  }
+
+  mico_rtos_set_semaphore( &writer->done_sem );
+  mico_rtos_delete_thread( NULL );
+}
+
+/* Hand buffer[fill] to the flash thread and wait for the other one */
+static void ota_writer_submit( mico_ota_writer_t *writer )
+{
+  writer->submitted++;
+  mico_rtos_set_semaphore( &writer->full_sem );
+  writer->fill ^= 1;
+  mico_rtos_get_semaphore( &writer->free_sem, MICO_WAIT_FOREVER );
+  writer->buffer[writer->fill].len = 0;
+}
+
+/* Stop the flash thread after it has drained the submitted buffers, and release the writer */
+static void ota_writer_stop( mico_ota_writer_t *writer )
+{
+  writer->buffer[writer->fill].len = 0;
+  mico_rtos_set_semaphore( &writer->full_sem );
+  mico_rtos_get_semaphore( &writer->done_sem, MICO_WAIT_FOREVER );
+
+  mico_rtos_deinit_semaphore( &writer->full_sem );
+  mico_rtos_deinit_semaphore( &writer->free_sem );
+  mico_rtos_deinit_semaphore( &writer->done_sem );
+  free( writer );
+}
+
+OSStatus mico_ota_writer_start( mico_ota_writer_t **outWriter, uint32_t length )
+{
+  OSStatus err = kNoErr;
+  mico_ota_writer_t *writer = NULL;
+  mico_logic_partition_t* ota_partition = MicoFlashGetInfo( MICO_PARTITION_OTA_TEMP );
+
+  require_action( outWriter, exit, err = kParamErr );
+  *outWriter = NULL;
+  require_action( ota_partition->partition_owner != MICO_FLASH_NONE, exit, err = kUnsupportedErr );
+  require_action( length <= ota_partition->partition_length, exit, err = kSizeErr );
+
+  writer = calloc( 1, sizeof(mico_ota_writer_t) );
+  require_action( writer, exit, err = kNoMemoryErr );
+
+  writer->partition_length = ota_partition->partition_length;
+  writer->limit = length ? length : ota_partition->partition_length;
+  CRC16_Init( &writer->crc16_contex );
+
+  err = mico_rtos_init_semaphore( &writer->full_sem, 2 );
+  require_noerr( err, exit );
+  err = mico_rtos_init_semaphore( &writer->free_sem, 2 );
+  require_noerr( err, exit );
+  err = mico_rtos_init_semaphore( &writer->done_sem, 1 );
+  require_noerr( err, exit );
+
+  /* buffer[0] is filled first, only buffer[1] starts out free */
+  mico_rtos_set_semaphore( &writer->free_sem );
+
+  err = mico_rtos_create_thread( NULL, MICO_APPLICATION_PRIORITY, "OTA writer", ota_writer_thread,
+                                 STACK_SIZE_OTA_WRITER_THREAD, writer );
+  require_noerr( err, exit );
+
+  ota_log( "Write %u bytes to %s", (unsigned int)writer->limit, ota_partition->partition_description );
+  *outWriter = writer;
+
+exit:
+  if( err != kNoErr && writer ){
+    if( writer->full_sem ) mico_rtos_deinit_semaphore( &writer->full_sem );
+    if( writer->free_sem ) mico_rtos_deinit_semaphore( &writer->free_sem );
+    if( writer->done_sem ) mico_rtos_deinit_semaphore( &writer->done_sem );
+    free( writer );
+  }
+  return err;
+}
+
+OSStatus mico_ota_writer_write( mico_ota_writer_t *writer, const uint8_t *data, uint32_t len )
+{
+  OSStatus err = kNoErr;
+  ota_writer_buffer_t *buffer;
+  uint32_t copy;
+
+  require_action( writer, exit, err = kParamErr );
+  err = writer->err;
+  require_noerr( err, exit );
+  require_action( len <= writer->limit - writer->received, exit, err = kSizeErr );
+
+  writer->received += len;
+  while( len ){
+    buffer = &writer->buffer[writer->fill];
+    copy = Min( len, OTA_WRITER_BUFFER_SIZE - buffer->len );
+    memcpy( buffer->data + buffer->len, data, copy );
+    buffer->len += copy;
+    data += copy;
+    len -= copy;
+    if( buffer->len == OTA_WRITER_BUFFER_SIZE )
+      ota_writer_submit( writer );
+  }
+
+exit:
+  return err;
+}
+
+bool mico_ota_writer_ready( mico_ota_writer_t *writer )
+{
+  /* A write fills at most the current buffer and the other one, which has to be back */
+  return writer == NULL || writer->err != kNoErr || writer->submitted == writer->programmed;
+}
+
+OSStatus mico_ota_writer_finish( mico_ota_writer_t **inWriter, uint32_t *outLength, uint16_t *outCrc )
+{
+  OSStatus err = kNoErr;
+  mico_ota_writer_t *writer;
+
+  require_action( inWriter && *inWriter, exit, err = kParamErr );
+  writer = *inWriter;
+  *inWriter = NULL;
+
+  if( writer->buffer[writer->fill].len )
+    ota_writer_submit( writer );
+  /* The flash thread has taken the last buffer once both are free again */
+  mico_rtos_get_semaphore( &writer->free_sem, MICO_WAIT_FOREVER );
+  mico_rtos_set_semaphore( &writer->free_sem );
+
+  err = writer->err;
+  if( err == kNoErr && writer->offset != writer->received )
+    err = kWriteErr;
+  if( outLength ) *outLength = writer->received;
+  if( outCrc ) CRC16_Final( &writer->crc16_contex, outCrc );
+  ota_log( "%u bytes written, err = %d", (unsigned int)writer->offset, err );
+
+  ota_writer_stop( writer );
+
+exit:
+  return err;
+}
+
+void mico_ota_writer_abort( mico_ota_writer_t **inWriter )
+{
+  if( inWriter == NULL || *inWriter == NULL )
+    return;
+
+  (*inWriter)->abort = true;
+  ota_writer_stop( *inWriter );
+  *inWriter = NULL;
+}
+
+OSStatus mico_ota_switch_to_new_fw( uint32_t length, uint16_t crc )
+{
+  mico_Context_t *context = mico_system_context_get( );
+  mico_logic_partition_t* ota_partition = MicoFlashGetInfo( MICO_PARTITION_OTA_TEMP );
+
+  memset( &context->flashContentInRam.bootTable, 0, sizeof(boot_table_t) );
+  context->flashContentInRam.bootTable.length = length;
+  context->flashContentInRam.bootTable.start_address = ota_partition->partition_start_addr;
+  context->flashContentInRam.bootTable.type = 'A';
+  context->flashContentInRam.bootTable.upgrade_type = 'U';
+  context->flashContentInRam.bootTable.crc = crc;
+  return mico_system_context_update( context );
+}
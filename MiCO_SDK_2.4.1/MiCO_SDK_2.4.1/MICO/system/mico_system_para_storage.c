@@ -40,15 +40,74 @@ static int32_t seedNum = 0;
 #define SYS_CONFIG_OFFSET   ( sizeof( boot_table_t ) )
 #define SYS_CONFIG_SIZE     ( sizeof( mico_sys_config_t ) )
 
+/* Layout written before the log, only read to convert old devices */
 #define USER_CONFIG_OFFSET  ( 0x400 )
 
 #define CRC_OFFSET    ( 0xE00 )
 #define CRC_SIZE      ( 2 )
 
+/* The config image, system config followed by user config, is kept as a log of
+ * fixed size blocks in one parameter partition at a time:
+ *
+ *   0x00                      boot table, PARAMETER_1 only, read by the bootloader
+ *   PARA_LOG_OFFSET           para_log_header_t, written last when a log is started
+ *   PARA_LOG_FIRST_RECORD     para_record_t + data, ... , commit record, ... , 0xFF
+ *
+ * An update appends the changed blocks and a commit record carrying the same
+ * sequence number, blocks without a commit behind them are ignored. When the
+ * partition is full, every block is copied into the other partition under a
+ * header with a higher generation, so one complete copy is always on flash. */
+#define PARA_LOG_OFFSET         ( 0x20 )
+#define PARA_LOG_FIRST_RECORD   ( PARA_LOG_OFFSET + sizeof( para_log_header_t ) )
+#define PARA_LOG_MAGIC          ( 0x474F4C50 )  /* "PLOG" */
+
+#define PARA_BLOCK_SIZE         ( 64 )
+#define PARA_RECORD_COMMIT      ( 0xFFFE )
+#define PARA_NO_RECORD          ( 0xFFFF )
+#define PARA_RECORD_SIZE( len ) ( sizeof( para_record_t ) + ( ( ( len ) + 3 ) & ~3 ) )
+
 //#define para_log(M, ...) custom_log("MiCO Settting", M, ##__VA_ARGS__)
 
 #define para_log(M, ...)
 
+typedef struct _para_log_header_t {
+  uint32_t magic;
+  uint32_t generation;
+  uint16_t sys_size;
+  uint16_t user_size;
+  uint16_t block_size;
+  uint16_t crc;
+} para_log_header_t;
+
+typedef struct _para_record_t {
+  uint16_t block;       /* block number, or PARA_RECORD_COMMIT */
+  uint16_t seq;
+  uint16_t length;
+  uint16_t crc;         /* over block, seq, length and data */
+} para_record_t;
+
+typedef struct _para_record_buf_t {
+  para_record_t header;
+  uint8_t       data[PARA_BLOCK_SIZE];
+} para_record_buf_t;
+
+typedef struct _para_store_t {
+  bool              valid;          /* partition holds a complete log */
+  bool              loaded;         /* partition holds a log, maybe of a smaller user config */
+  mico_partition_t  partition;
+  uint32_t          generation;
+  uint32_t          length;         /* usable length of each partition */
+  uint32_t          write_offset;   /* next record, length if nothing may be appended */
+  uint16_t          seq;
+  uint16_t          block_num;
+  uint16_t          *index;         /* offset of the last committed record of each block */
+  uint8_t           *changed;
+} para_store_t;
+
+static para_store_t para_store;
+
+static OSStatus internal_update_config( mico_Context_t * const inContext );
+
 __weak void appRestoreDefault_callback(void *user_data, uint32_t size)
 {
 
@@ -58,69 +117,497 @@ static bool is_crc_match( uint16_t crc_1, uint16_t crc_2)
 {
   if( crc_1 == 0 || crc_2 == 0)
     return false;
-  
+
   if( crc_1 != crc_2 )
     return false;
-      
+
   return true;
 }
 
-static OSStatus internal_update_config( mico_Context_t * const inContext )
+static bool para_is_erased( const uint8_t *data, uint32_t len )
+{
+  while( len-- )
+    if( *data++ != 0xFF ) return false;
+  return true;
+}
+
+static uint16_t para_crc( const void *head, size_t head_len, const void *data, size_t data_len )
 {
-  OSStatus err = kNoErr;
-  uint32_t para_offset;
   CRC16_Context crc_context;
   uint16_t crc_result;
-  
-  uint16_t crc_readback;;
-
-  para_log("Flash write!");
 
   CRC16_Init( &crc_context );
-  CRC16_Update( &crc_context, &inContext->flashContentInRam.micoSystemConfig, SYS_CONFIG_SIZE );
-  CRC16_Update( &crc_context, inContext->user_config_data, inContext->user_config_data_size );
-
+  CRC16_Update( &crc_context, head, head_len );
+  CRC16_Update( &crc_context, data, data_len );
   CRC16_Final( &crc_context, &crc_result );
+  return crc_result;
+}
 
-  err = MicoFlashErase( MICO_PARTITION_PARAMETER_1, 0x0, sizeof(flash_content_t) );
-  require_noerr(err, exit);
+static uint16_t para_block_length( mico_Context_t * const inContext, uint16_t block )
+{
+  uint32_t image_size = SYS_CONFIG_SIZE + inContext->user_config_data_size;
+
+  return Min( PARA_BLOCK_SIZE, image_size - block * PARA_BLOCK_SIZE );
+}
+
+/* Copy part of the config image from RAM, or into RAM if load is set */
+static void para_image_access( mico_Context_t * const inContext, uint32_t offset, uint8_t *data, uint32_t len, bool load )
+{
+  uint8_t *area;
+  uint32_t chunk;
+
+  while( len > 0 ){
+    if( offset < SYS_CONFIG_SIZE ){
+      area = (uint8_t *)&inContext->flashContentInRam.micoSystemConfig + offset;
+      chunk = Min( len, SYS_CONFIG_SIZE - offset );
+    } else {
+      area = (uint8_t *)inContext->user_config_data + offset - SYS_CONFIG_SIZE;
+      chunk = len;
+    }
+    if( load )
+      memcpy( area, data, chunk );
+    else
+      memcpy( data, area, chunk );
+    offset += chunk;
+    data += chunk;
+    len -= chunk;
+  }
+}
+
+static OSStatus para_store_init( mico_Context_t * const inContext )
+{
+  mico_logic_partition_t *partition_1 = MicoFlashGetInfo( MICO_PARTITION_PARAMETER_1 );
+  mico_logic_partition_t *partition_2 = MicoFlashGetInfo( MICO_PARTITION_PARAMETER_2 );
+  uint32_t image_size = SYS_CONFIG_SIZE + inContext->user_config_data_size;
+  uint16_t block_num = ( image_size + PARA_BLOCK_SIZE - 1 ) / PARA_BLOCK_SIZE;
+  uint32_t snapshot_size;
+  OSStatus err = kNoErr;
+
+  if( para_store.index != NULL && para_store.block_num == block_num )
+    goto exit;
+
+  if( para_store.index != NULL ) free( para_store.index );
+  if( para_store.changed != NULL ) free( para_store.changed );
+  memset( &para_store, 0x0, sizeof(para_store) );
+
+  para_store.length = Min( partition_1->partition_length, partition_2->partition_length );
+  require_action( para_store.length < PARA_NO_RECORD, exit, err = kUnsupportedErr );
+
+  /* A full copy of the image must fit in one partition */
+  snapshot_size = PARA_LOG_FIRST_RECORD + ( block_num - 1 ) * PARA_RECORD_SIZE( PARA_BLOCK_SIZE )
+                + PARA_RECORD_SIZE( image_size - ( block_num - 1 ) * PARA_BLOCK_SIZE ) + PARA_RECORD_SIZE( 0 );
+  require_action( snapshot_size <= para_store.length, exit, err = kNoSpaceErr );
+
+  para_store.index = malloc( block_num * sizeof(uint16_t) );
+  require_action( para_store.index, exit, err = kNoMemoryErr );
+  para_store.changed = malloc( block_num );
+  require_action( para_store.changed, exit, err = kNoMemoryErr );
+  para_store.block_num = block_num;
+
+exit:
+  return err;
+}
+
+/* Returns the size of the record at offset, 0 where the log ends, -1 if it is damaged */
+static int para_record_read( mico_partition_t partition, uint32_t offset, para_record_buf_t *record )
+{
+  uint32_t para_offset = offset;
+  uint32_t size;
+
+  if( offset + sizeof(para_record_t) > para_store.length )
+    return 0;
+  if( MicoFlashRead( partition, &para_offset, (uint8_t *)&record->header, sizeof(para_record_t) ) != kNoErr )
+    return -1;
+  if( para_is_erased( (uint8_t *)&record->header, sizeof(para_record_t) ) )
+    return 0;
+
+  if( record->header.block == PARA_RECORD_COMMIT ){
+    if( record->header.length != 0 ) return -1;
+  } else {
+    if( record->header.block >= para_store.block_num ) return -1;
+    if( record->header.length != PARA_BLOCK_SIZE
+     && record->header.block != para_store.block_num - 1 ) return -1;
+    if( record->header.length == 0 || record->header.length > PARA_BLOCK_SIZE ) return -1;
+  }
+
+  size = PARA_RECORD_SIZE( record->header.length );
+  if( offset + size > para_store.length )
+    return -1;
+  if( MicoFlashRead( partition, &para_offset, record->data, record->header.length ) != kNoErr )
+    return -1;
+  if( para_crc( &record->header, offsetof( para_record_t, crc ), record->data, record->header.length ) != record->header.crc )
+    return -1;
+  return size;
+}
+
+static OSStatus para_record_write( mico_partition_t partition, uint32_t *offset, uint16_t block, uint16_t seq,
+                                   const uint8_t *data, uint16_t len )
+{
+  para_record_buf_t record;
+  uint32_t size = PARA_RECORD_SIZE( len );
+
+  memset( &record, 0xFF, size );
+  record.header.block = block;
+  record.header.seq = seq;
+  record.header.length = len;
+  if( len > 0 )
+    memcpy( record.data, data, len );
+  record.header.crc = para_crc( &record.header, offsetof( para_record_t, crc ), record.data, len );
+
+  return MicoFlashWrite( partition, offset, (uint8_t *)&record, size );
+}
+
+/* kNoErr if the partition starts a log of the current image layout, or of an
+ * older firmware whose user config was shorter */
+static OSStatus para_log_header_read( mico_Context_t * const inContext, mico_partition_t partition, para_log_header_t *header )
+{
+  uint32_t para_offset = PARA_LOG_OFFSET;
+  OSStatus err;
+
+  err = MicoFlashRead( partition, &para_offset, (uint8_t *)header, sizeof(para_log_header_t) );
+  require_noerr( err, exit );
+
+  require_action_quiet( header->magic == PARA_LOG_MAGIC, exit, err = kNotFoundErr );
+  require_action_quiet( header->crc == para_crc( header, offsetof( para_log_header_t, crc ), NULL, 0 ), exit, err = kChecksumErr );
+  /* Fields are only added to the end of a user config, other images are dropped */
+  require_action_quiet( header->sys_size == SYS_CONFIG_SIZE && header->user_size <= inContext->user_config_data_size
+                     && header->block_size == PARA_BLOCK_SIZE, exit, err = kFormatErr );
+
+exit:
+  return err;
+}
+
+/* Build the index of a partition and load its image into RAM. A shorter
+ * image is scanned with its own number of blocks, the user config after it
+ * keeps its default values and the next update starts a log of the current size. */
+static OSStatus para_log_scan( mico_Context_t * const inContext, mico_partition_t partition, const para_log_header_t *header )
+{
+  para_record_buf_t record;
+  uint16_t *pending = NULL;
+  uint16_t pending_seq = 0, block, block_num = para_store.block_num;
+  uint32_t offset = PARA_LOG_FIRST_RECORD, para_offset;
+  uint8_t blank[32];
+  int size;
+  OSStatus err = kNoErr;
+
+  para_store.block_num = ( header->sys_size + header->user_size + PARA_BLOCK_SIZE - 1 ) / PARA_BLOCK_SIZE;
+
+  pending = malloc( para_store.block_num * sizeof(uint16_t) );
+  require_action( pending, exit, err = kNoMemoryErr );
+  memset( pending, 0xFF, para_store.block_num * sizeof(uint16_t) );
+  memset( para_store.index, 0xFF, para_store.block_num * sizeof(uint16_t) );
+
+  while( ( size = para_record_read( partition, offset, &record ) ) > 0 ){
+    if( record.header.seq != pending_seq )
+      memset( pending, 0xFF, para_store.block_num * sizeof(uint16_t) );
+    pending_seq = record.header.seq;
+
+    if( record.header.block == PARA_RECORD_COMMIT ){
+      for( block = 0; block < para_store.block_num; block++ )
+        if( pending[block] != PARA_NO_RECORD ) para_store.index[block] = pending[block];
+      memset( pending, 0xFF, para_store.block_num * sizeof(uint16_t) );
+    } else {
+      pending[record.header.block] = offset;
+    }
+    offset += size;
+  }
+
+  for( block = 0; block < para_store.block_num; block++ )
+    require_action( para_store.index[block] != PARA_NO_RECORD, exit, err = kNotFoundErr );
+
+  /* Nothing is appended after a damaged record or into bytes that are not erased */
+  for( para_offset = offset; size == 0 && para_offset < para_store.length; ){
+    uint32_t chunk = Min( sizeof(blank), para_store.length - para_offset );
+    if( MicoFlashRead( partition, &para_offset, blank, chunk ) != kNoErr || !para_is_erased( blank, chunk ) )
+      size = -1;
+  }
+  if( size < 0 ){
+    para_log("Log damaged at 0x%x", offset);
+    offset = para_store.length;
+  }
+
+  for( block = 0; block < para_store.block_num; block++ ){
+    size = para_record_read( partition, para_store.index[block], &record );
+    require_action( size > 0, exit, err = kReadErr );
+    para_image_access( inContext, block * PARA_BLOCK_SIZE, record.data, record.header.length, true );
+  }
+
+  para_store.loaded = true;
+  para_store.partition = partition;
+  para_store.write_offset = offset;
+  para_store.seq = pending_seq;
+  para_store.valid = ( header->user_size == inContext->user_config_data_size );
+
+exit:
+  para_store.block_num = block_num;
+  if( pending != NULL ) free( pending );
+  return err;
+}
+
+/* Defaults for the user config fields an older firmware did not have */
+static OSStatus para_user_defaults( mico_Context_t * const inContext, uint32_t from )
+{
+  uint8_t *defaults;
+  OSStatus err = kNoErr;
+
+  defaults = calloc( 1, inContext->user_config_data_size );
+  require_action( defaults, exit, err = kNoMemoryErr );
+  appRestoreDefault_callback( defaults, inContext->user_config_data_size );
+  memcpy( (uint8_t *)inContext->user_config_data + from, defaults + from, inContext->user_config_data_size - from );
+  free( defaults );
+
+exit:
+  return err;
+}
+
+static OSStatus para_log_load( mico_Context_t * const inContext )
+{
+  para_log_header_t header_1, header_2, *header = NULL;
+  bool valid_1, valid_2;
+  OSStatus err = kNotFoundErr;
+
+  para_store.valid = false;
+  para_store.loaded = false;
+  valid_1 = para_log_header_read( inContext, MICO_PARTITION_PARAMETER_1, &header_1 ) == kNoErr;
+  valid_2 = para_log_header_read( inContext, MICO_PARTITION_PARAMETER_2, &header_2 ) == kNoErr;
+
+  /* The next log started must be newer than both */
+  para_store.generation = Max( valid_1 ? header_1.generation : 0, valid_2 ? header_2.generation : 0 );
+
+  /* Newest log first, the other one is an older but complete copy */
+  if( valid_1 && ( !valid_2 || header_1.generation > header_2.generation ) ){
+    err = para_log_scan( inContext, MICO_PARTITION_PARAMETER_1, header = &header_1 );
+    if( err != kNoErr && valid_2 )
+      err = para_log_scan( inContext, MICO_PARTITION_PARAMETER_2, header = &header_2 );
+  } else if( valid_2 ){
+    err = para_log_scan( inContext, MICO_PARTITION_PARAMETER_2, header = &header_2 );
+    if( err != kNoErr && valid_1 )
+      err = para_log_scan( inContext, MICO_PARTITION_PARAMETER_1, header = &header_1 );
+  }
+
+  if( err == kNoErr && header->user_size < inContext->user_config_data_size ){
+    para_log("User config grew from %d to %d bytes, convert!", header->user_size, inContext->user_config_data_size);
+    err = para_user_defaults( inContext, header->user_size );
+    if( err == kNoErr )
+      err = internal_update_config( inContext );
+  }
+
+  para_log("Log loaded from %d, generation %d, err %d", para_store.partition, para_store.generation, err);
+  return err;
+}
+
+/* Start a new log holding the whole image in partition */
+static OSStatus para_log_compact( mico_Context_t * const inContext, mico_partition_t partition )
+{
+  para_log_header_t header;
+  para_record_buf_t record;
+  uint32_t para_offset, offset;
+  uint16_t block, len, seq = para_store.seq + 1;
+  OSStatus err = kNoErr;
+
+  para_log("Compact log into %d", partition);
+
+  err = MicoFlashErase( partition, 0x0, para_store.length );
+  require_noerr( err, exit );
+
+  if( partition == MICO_PARTITION_PARAMETER_1 ){
+    para_offset = 0x0;
+    err = MicoFlashWrite( partition, &para_offset, (uint8_t *)&inContext->flashContentInRam.bootTable, sizeof(boot_table_t) );
+    require_noerr( err, exit );
+  }
+
+  para_offset = PARA_LOG_FIRST_RECORD;
+  for( block = 0; block < para_store.block_num; block++ ){
+    len = para_block_length( inContext, block );
+    para_image_access( inContext, block * PARA_BLOCK_SIZE, record.data, len, false );
+    err = para_record_write( partition, &para_offset, block, seq, record.data, len );
+    require_noerr( err, exit );
+  }
+  err = para_record_write( partition, &para_offset, PARA_RECORD_COMMIT, seq, NULL, 0 );
+  require_noerr( err, exit );
+
+  /* Until the header is on flash the partition is not a log, the old one stays in use */
+  memset( &header, 0x0, sizeof(header) );
+  header.magic = PARA_LOG_MAGIC;
+  header.generation = para_store.generation + 1;
+  header.sys_size = SYS_CONFIG_SIZE;
+  header.user_size = inContext->user_config_data_size;
+  header.block_size = PARA_BLOCK_SIZE;
+  header.crc = para_crc( &header, offsetof( para_log_header_t, crc ), NULL, 0 );
+
+  offset = PARA_LOG_OFFSET;
+  err = MicoFlashWrite( partition, &offset, (uint8_t *)&header, sizeof(header) );
+  require_noerr( err, exit );
+
+  /* Read back */
+  err = para_log_header_read( inContext, partition, &header );
+  require_noerr_action( err, exit, err = kWriteErr );
+
+  para_store.valid = true;
+  para_store.loaded = true;
+  para_store.partition = partition;
+  para_store.generation = header.generation;
+  para_store.write_offset = para_offset;
+  para_store.seq = seq;
+
+  offset = PARA_LOG_FIRST_RECORD;
+  for( block = 0; block < para_store.block_num; block++ ){
+    para_store.index[block] = offset;
+    offset += PARA_RECORD_SIZE( para_block_length( inContext, block ) );
+  }
+
+exit:
+  return err;
+}
+
+/* Append the blocks that differ from flash, start a new log if they do not fit */
+static OSStatus para_log_append( mico_Context_t * const inContext )
+{
+  para_record_buf_t record;
+  uint8_t flash_data[PARA_BLOCK_SIZE];
+  uint32_t para_offset, offset, need = 0;
+  uint16_t block, len, seq;
+  OSStatus err = kNoErr;
+
+  for( block = 0; block < para_store.block_num; block++ ){
+    len = para_block_length( inContext, block );
+    para_image_access( inContext, block * PARA_BLOCK_SIZE, record.data, len, false );
+    para_offset = para_store.index[block] + sizeof(para_record_t);
+    para_store.changed[block] = MicoFlashRead( para_store.partition, &para_offset, flash_data, len ) != kNoErr
+                             || memcmp( flash_data, record.data, len ) != 0;
+    if( para_store.changed[block] )
+      need += PARA_RECORD_SIZE( len );
+  }
+
+  if( need == 0 )
+    goto exit;
+  need += PARA_RECORD_SIZE( 0 );
+
+  if( para_store.write_offset + need > para_store.length ){
+    err = para_log_compact( inContext, para_store.partition == MICO_PARTITION_PARAMETER_1 ?
+                            MICO_PARTITION_PARAMETER_2 : MICO_PARTITION_PARAMETER_1 );
+    goto exit;
+  }
+
+  /* Until the commit is read back nothing else is appended */
+  seq = para_store.seq + 1;
+  offset = para_offset = para_store.write_offset;
+  para_store.write_offset = para_store.length;
+
+  for( block = 0; block < para_store.block_num; block++ ){
+    if( !para_store.changed[block] ) continue;
+    len = para_block_length( inContext, block );
+    para_image_access( inContext, block * PARA_BLOCK_SIZE, record.data, len, false );
+    err = para_record_write( para_store.partition, &para_offset, block, seq, record.data, len );
+    require_noerr( err, exit );
+  }
+
+  err = para_record_write( para_store.partition, &para_offset, PARA_RECORD_COMMIT, seq, NULL, 0 );
+  require_noerr( err, exit );
+
+  /* Read back */
+  require_action( para_record_read( para_store.partition, para_offset - PARA_RECORD_SIZE( 0 ), &record ) > 0
+               && record.header.block == PARA_RECORD_COMMIT && record.header.seq == seq, exit, err = kWriteErr );
+
+  for( block = 0; block < para_store.block_num; block++ ){
+    if( !para_store.changed[block] ) continue;
+    para_store.index[block] = offset;
+    offset += PARA_RECORD_SIZE( para_block_length( inContext, block ) );
+  }
+  para_store.write_offset = para_offset;
+  para_store.seq = seq;
+
+exit:
+  return err;
+}
+
+/* The bootloader reads the boot table at the start of PARAMETER_1 and, after an
+ * update, rewrites that partition with the table cleared. The log is moved out of
+ * PARAMETER_1 before a table is written, so a reset during that rewrite cannot
+ * damage the only copy of the config. */
+static OSStatus para_boot_table_update( mico_Context_t * const inContext )
+{
+  boot_table_t boot_table;
+  uint32_t para_offset = 0x0;
+  OSStatus err = kNoErr;
+
+  err = MicoFlashRead( MICO_PARTITION_PARAMETER_1, &para_offset, (uint8_t *)&boot_table, sizeof(boot_table_t) );
+  require_noerr( err, exit );
+
+  if( memcmp( &boot_table, &inContext->flashContentInRam.bootTable, sizeof(boot_table_t) ) == 0 )
+    goto exit;
+
+  if( para_store.partition == MICO_PARTITION_PARAMETER_1 ){
+    err = para_log_compact( inContext, MICO_PARTITION_PARAMETER_2 );
+    require_noerr( err, exit );
+  }
+
+  if( !para_is_erased( (uint8_t *)&boot_table, sizeof(boot_table_t) ) ){
+    err = MicoFlashErase( MICO_PARTITION_PARAMETER_1, 0x0, para_store.length );
+    require_noerr( err, exit );
+  }
 
   para_offset = 0x0;
-  err = MicoFlashWrite( MICO_PARTITION_PARAMETER_1, &para_offset, (uint8_t *)&inContext->flashContentInRam, sizeof(flash_content_t));
-  require_noerr(err, exit);
+  err = MicoFlashWrite( MICO_PARTITION_PARAMETER_1, &para_offset, (uint8_t *)&inContext->flashContentInRam.bootTable, sizeof(boot_table_t) );
+  require_noerr( err, exit );
 
-  para_offset = USER_CONFIG_OFFSET;
-  err = MicoFlashWrite( MICO_PARTITION_PARAMETER_1, &para_offset, inContext->user_config_data, inContext->user_config_data_size );
-  require_noerr(err, exit);
+exit:
+  return err;
+}
 
-  para_offset = CRC_OFFSET;
-  err = MicoFlashWrite( MICO_PARTITION_PARAMETER_1, &para_offset, (uint8_t *)&crc_result, CRC_SIZE );
+static OSStatus internal_update_config( mico_Context_t * const inContext )
+{
+  OSStatus err = kNoErr;
+
+  para_log("Flash write!");
+
+  err = para_store_init( inContext );
   require_noerr(err, exit);
-  
-  /* Read back*/
-  para_offset = CRC_OFFSET;
-  err = MicoFlashRead( MICO_PARTITION_PARAMETER_1, &para_offset, (uint8_t *)&crc_readback, CRC_SIZE );
-  para_log( "crc_readback = %d", crc_readback);
-  if( crc_readback == 0x0)
-    return kWriteErr;
-  
-
-  /* Write backup data*/
-  err = MicoFlashErase( MICO_PARTITION_PARAMETER_2, 0x0, sizeof(flash_content_t) );
+
+  /* Never erase the partition holding the log loaded for a smaller user config, after an
+   * update that is PARAMETER_2 and PARAMETER_1 only has the boot table */
+  if( para_store.valid == false ){
+    err = para_log_compact( inContext, para_store.loaded && para_store.partition == MICO_PARTITION_PARAMETER_2 ?
+                                       MICO_PARTITION_PARAMETER_1 : MICO_PARTITION_PARAMETER_2 );
+    require_noerr(err, exit);
+  }
+
+  err = para_boot_table_update( inContext );
   require_noerr(err, exit);
 
-  para_offset = 0x0;
-  err = MicoFlashWrite( MICO_PARTITION_PARAMETER_2, &para_offset, (uint8_t *)&inContext->flashContentInRam, sizeof(flash_content_t));
+  err = para_log_append( inContext );
   require_noerr(err, exit);
 
+exit:
+  return err;
+}
+
+/* Config written before the log: flash_content_t, user config and CRC in each partition */
+static OSStatus para_legacy_read( mico_Context_t * const inContext, mico_partition_t partition )
+{
+  uint32_t para_offset;
+  CRC16_Context crc_context;
+  uint16_t crc_result, crc_target;
+  OSStatus err = kNoErr;
+
+  para_offset = SYS_CONFIG_OFFSET;
+  err = MicoFlashRead( partition, &para_offset, (uint8_t *)&inContext->flashContentInRam.micoSystemConfig, SYS_CONFIG_SIZE );
+  require_noerr(err, exit);
   para_offset = USER_CONFIG_OFFSET;
-  err = MicoFlashWrite( MICO_PARTITION_PARAMETER_2, &para_offset, inContext->user_config_data, inContext->user_config_data_size );
+  err = MicoFlashRead( partition, &para_offset, (uint8_t *)inContext->user_config_data, inContext->user_config_data_size );
   require_noerr(err, exit);
-
   para_offset = CRC_OFFSET;
-  err = MicoFlashWrite( MICO_PARTITION_PARAMETER_2, &para_offset, (uint8_t *)&crc_result, CRC_SIZE );
+  err = MicoFlashRead( partition, &para_offset, (uint8_t *)&crc_target, CRC_SIZE );
   require_noerr(err, exit);
 
+  CRC16_Init( &crc_context );
+  CRC16_Update( &crc_context, (uint8_t *)&inContext->flashContentInRam.micoSystemConfig, SYS_CONFIG_SIZE );
+  CRC16_Update( &crc_context, inContext->user_config_data, inContext->user_config_data_size );
+  CRC16_Final( &crc_context, &crc_result );
+  para_log( "crc_result = %d, crc_target = %d", crc_result, crc_target);
+
+  require_action_quiet( is_crc_match( crc_result, crc_target ), exit, err = kChecksumErr );
+
 exit:
   return err;
 }
@@ -178,110 +665,26 @@ exit:
 OSStatus MICOReadConfiguration(mico_Context_t *inContext)
 {
   uint32_t para_offset = 0x0;
-  //uint32_t config_offset = CONFIG_OFFSET;
-  uint32_t crc_offset = CRC_OFFSET;
-  CRC16_Context crc_context;
-  uint16_t crc_result, crc_target;
-  uint16_t crc_backup_result, crc_backup_target;
-  mico_logic_partition_t *partition; 
-  uint8_t *sys_backup_data = NULL;
-  uint8_t *user_backup_data = NULL;
-
   OSStatus err = kNoErr;
 
-  sys_backup_data = malloc( SYS_CONFIG_SIZE );
-  require_action( sys_backup_data, exit, err = kNoMemoryErr );
-
-  user_backup_data = malloc( inContext->user_config_data_size );
-  require_action( user_backup_data, exit, err = kNoMemoryErr );
-
-
-  /* Load data and crc from main partition */
-  para_offset = 0x0;
-  err = MicoFlashRead( MICO_PARTITION_PARAMETER_1, &para_offset, (uint8_t *)&inContext->flashContentInRam, sizeof( flash_content_t ) );
-  para_offset = USER_CONFIG_OFFSET;
-  err = MicoFlashRead( MICO_PARTITION_PARAMETER_1, &para_offset, (uint8_t *)inContext->user_config_data, inContext->user_config_data_size );
-
-  CRC16_Init( &crc_context );
-  CRC16_Update( &crc_context, (uint8_t *)&inContext->flashContentInRam.micoSystemConfig, SYS_CONFIG_SIZE );
-  CRC16_Update( &crc_context, inContext->user_config_data, inContext->user_config_data_size );
-  CRC16_Final( &crc_context, &crc_result );
-  para_log( "crc_result = %d", crc_result);
-
-  crc_offset = CRC_OFFSET;
-  err = MicoFlashRead( MICO_PARTITION_PARAMETER_1, &crc_offset, (uint8_t *)&crc_target, CRC_SIZE );
-  para_log( "crc_target = %d", crc_target);
+  err = para_store_init( inContext );
+  require_noerr(err, exit);
 
-  /* Load data and crc from backup partition */
-  para_offset = SYS_CONFIG_OFFSET;
-  err = MicoFlashRead( MICO_PARTITION_PARAMETER_2, &para_offset, sys_backup_data, SYS_CONFIG_SIZE );
-  para_offset = USER_CONFIG_OFFSET;
-  err = MicoFlashRead( MICO_PARTITION_PARAMETER_2, &para_offset, user_backup_data, inContext->user_config_data_size );
+  /* The boot table is kept apart from the config image */
+  err = MicoFlashRead( MICO_PARTITION_PARAMETER_1, &para_offset, (uint8_t *)&inContext->flashContentInRam.bootTable, sizeof(boot_table_t) );
+  require_noerr(err, exit);
 
-  CRC16_Init( &crc_context );
-  CRC16_Update( &crc_context, sys_backup_data,  SYS_CONFIG_SIZE );
-  CRC16_Update( &crc_context, user_backup_data, inContext->user_config_data_size );
-  CRC16_Final( &crc_context, &crc_backup_result );
-  para_log( "crc_backup_result = %d", crc_backup_result);
-
-  crc_offset = CRC_OFFSET;
-  err = MicoFlashRead( MICO_PARTITION_PARAMETER_2, &crc_offset, (uint8_t *)&crc_backup_target, CRC_SIZE );  
-  para_log( "crc_backup_target = %d", crc_backup_target);
-  
-  /* Data collapsed at main partition */
-  if( is_crc_match( crc_result, crc_target ) == false ){
-    /* Data collapsed at main partition and backup partition both, restore to default */
-    if( is_crc_match( crc_backup_result, crc_backup_target ) == false ){
-      para_log("Config failed on both partition, restore to default settings!");
-      err = mico_system_context_restore( inContext );
+  if( para_log_load( inContext ) != kNoErr ){
+    /* Convert the config of an older firmware, main partition first */
+    if( para_legacy_read( inContext, MICO_PARTITION_PARAMETER_1 ) == kNoErr
+     || para_legacy_read( inContext, MICO_PARTITION_PARAMETER_2 ) == kNoErr ){
+      para_log("Config found in old format, convert!");
+      err = internal_update_config( inContext );
       require_noerr(err, exit);
     }
-    /* main collapsed, backup correct, copy data from back up to main */
     else {
-      para_log("Config failed on main, recover!");
-
-      memset(&inContext->flashContentInRam, 0x0, sizeof(inContext->flashContentInRam));
-      memcpy( (uint8_t *)&inContext->flashContentInRam.micoSystemConfig, sys_backup_data, SYS_CONFIG_SIZE);
-
-      partition = MicoFlashGetInfo( MICO_PARTITION_PARAMETER_1 );
-
-      err = MicoFlashErase( MICO_PARTITION_PARAMETER_1 ,0x0, partition->partition_length );
-      require_noerr(err, exit);
-
-      para_offset = 0x0;
-      err = MicoFlashWrite( MICO_PARTITION_PARAMETER_1, &para_offset, (uint8_t *)&inContext->flashContentInRam, sizeof(flash_content_t) );
-      require_noerr(err, exit);
-
-      para_offset = USER_CONFIG_OFFSET;
-      err = MicoFlashWrite( MICO_PARTITION_PARAMETER_1, &para_offset, inContext->user_config_data, inContext->user_config_data_size );
-      require_noerr(err, exit);
-
-      crc_offset = CRC_OFFSET;
-      err = MicoFlashWrite( MICO_PARTITION_PARAMETER_1, &crc_offset, (uint8_t *)&crc_backup_result, CRC_SIZE );
-      require_noerr(err, exit);
-    }
-  }   
-  /* main correct */
-  else { 
-      /* main correct , backup collapsed, or main!=backup, copy data from main to back up */
-    if( is_crc_match( crc_result, crc_backup_result ) == false || is_crc_match( crc_backup_result, crc_backup_target ) == false ){
-      para_log("Config failed on backup, recover!");
-
-      partition = MicoFlashGetInfo( MICO_PARTITION_PARAMETER_2 );
-
-      err = MicoFlashErase( MICO_PARTITION_PARAMETER_2 ,0x0, partition->partition_length );
-      require_noerr(err, exit);
-  
-      para_offset = 0x0;
-      err = MicoFlashWrite( MICO_PARTITION_PARAMETER_2, &para_offset, (uint8_t *)&inContext->flashContentInRam, sizeof(flash_content_t) );
-      require_noerr(err, exit);
-
-      para_offset = USER_CONFIG_OFFSET;
-      err = MicoFlashWrite( MICO_PARTITION_PARAMETER_2, &para_offset, inContext->user_config_data, inContext->user_config_data_size );
-      require_noerr(err, exit);
-
-      crc_offset = CRC_OFFSET;
-      err = MicoFlashWrite( MICO_PARTITION_PARAMETER_2, &crc_offset, (uint8_t *)&crc_target, CRC_SIZE );
+      para_log("Config failed on both partition, restore to default settings!");
+      err = mico_system_context_restore( inContext );
       require_noerr(err, exit);
     }
   }
@@ -310,8 +713,6 @@ OSStatus MICOReadConfiguration(mico_Context_t *inContext)
   }
 
 exit: 
-  if( sys_backup_data!= NULL) free( sys_backup_data );
-  if( user_backup_data!= NULL) free( user_backup_data );
   return err;
 }
 
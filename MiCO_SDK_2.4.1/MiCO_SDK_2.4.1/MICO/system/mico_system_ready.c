@@ -0,0 +1,331 @@
+/**
+******************************************************************************
+* @file    mico_system_ready.c
+* @author  William Xu
+* @version V1.0.0
+* @date    17-Oct-2026
+* @brief   System readiness events, threads wait for MiCO services and the
+*          network to be ready instead of polling them.
+******************************************************************************
+*
+*  The MIT License
+*  Copyright (c) 2016 MXCHIP Inc.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is furnished
+*  to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in
+*  all copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+*  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+*  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+******************************************************************************
+*/
+
+#include "MICO.h"
+
+#ifndef MICO_DNS_PROBE_HOST
+#define MICO_DNS_PROBE_HOST         "www.mxchip.com"  // Resolved once the station has an IP address, to set mico_ready_DNS
+#endif
+
+#define DNS_PROBE_MIN_DELAY         (1000)
+#define DNS_PROBE_MAX_DELAY         (60*1000)
+
+#define READY_EVENTS                (32)
+
+/* Every waiting thread has its own semaphore, on the stack of mico_system_ready_wait( ) */
+typedef struct _ready_waiter_t
+{
+  uint32_t                  events;
+  uint32_t                  abort_events;
+  mico_semaphore_t          sem;
+  struct _ready_waiter_t *  next;
+} ready_waiter_t;
+
+static mico_mutex_t         ready_mutex = NULL;
+static uint32_t             ready_events = 0;
+static ready_waiter_t *     ready_waiters = NULL;
+static mico_ready_metrics_t ready_metrics[READY_EVENTS];
+static bool                 dns_probe_running = false;
+
+/* Names of the events in the boot trace and the CLI, by bit number */
+static const char * const ready_event_names[] =
+{
+  "notification ready", "monitor ready", "cli ready", "network ready",
+  "wlan started", "discovery ready", "config server ready", "airkiss ready",
+  "system ready", NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+  "station up", "ip ready", "dns ready", "time synced",
+};
+
+#define READY_EVENT_NAMES           ( sizeof(ready_event_names) / sizeof(ready_event_names[0]) )
+
+/* The first event may be set before mico_system_init( ), when no other thread is running yet */
+static void ready_lock( void )
+{
+  if( ready_mutex == NULL )
+    mico_rtos_init_mutex( &ready_mutex );
+  mico_rtos_lock_mutex( &ready_mutex );
+}
+
+static void ready_unlock( void )
+{
+  mico_rtos_unlock_mutex( &ready_mutex );
+}
+
+void mico_system_ready_set( uint32_t events )
+{
+  ready_waiter_t *waiter;
+  uint32_t new_events, now = mico_get_time( ), i;
+
+  ready_lock( );
+  new_events = events & ~ready_events;
+  ready_events |= events;
+  for( i = 0; i < READY_EVENTS; i++ ){
+    if( ( new_events & ( 1UL << i ) ) == 0 ) continue;
+    if( ready_metrics[i].set_count++ == 0 )
+      ready_metrics[i].first_set = now;
+    ready_metrics[i].last_set = now;
+  }
+  for( waiter = ready_waiters; waiter != NULL; waiter = waiter->next ){
+    if( ( ready_events & waiter->events ) == waiter->events || ( ready_events & waiter->abort_events ) )
+      mico_rtos_set_semaphore( &waiter->sem );
+  }
+  ready_unlock( );
+
+  for( i = 0; i < READY_EVENT_NAMES; i++ ){
+    if( ( new_events & ( 1UL << i ) ) && ready_event_names[i] )
+      mico_system_boot_trace_mark( ready_event_names[i] );
+  }
+}
+
+void mico_system_ready_clear( uint32_t events )
+{
+  uint32_t now = mico_get_time( ), i;
+
+  ready_lock( );
+  for( i = 0; i < READY_EVENTS; i++ ){
+    if( events & ready_events & ( 1UL << i ) )
+      ready_metrics[i].last_clear = now;
+  }
+  ready_events &= ~events;
+  ready_unlock( );
+}
+
+uint32_t mico_system_ready_get( void )
+{
+  return ready_events;
+}
+
+OSStatus mico_system_ready_wait( uint32_t events, uint32_t timeout_ms )
+{
+  return system_ready_wait( events, 0, timeout_ms );
+}
+
+OSStatus system_ready_wait( uint32_t events, uint32_t abort_events, uint32_t timeout_ms )
+{
+  OSStatus err = kNoErr;
+  ready_waiter_t waiter, **pwaiter;
+  uint32_t start = mico_get_time( ), waited;
+
+  ready_lock( );
+  require_quiet( ( ready_events & events ) != events, exit );
+  require_action_quiet( ( ready_events & abort_events ) == 0, exit, err = kStateErr );
+
+  waiter.events = events;
+  waiter.abort_events = abort_events;
+  err = mico_rtos_init_semaphore( &waiter.sem, 1 );
+  require_noerr( err, exit );
+  waiter.next = ready_waiters;
+  ready_waiters = &waiter;
+
+  /* An event may be cleared again before this thread runs, so check it after every wake up */
+  while( ( ready_events & events ) != events ){
+    if( ready_events & abort_events ){
+      err = kStateErr;
+      break;
+    }
+    waited = mico_get_time( ) - start;
+    if( timeout_ms != MICO_NEVER_TIMEOUT && waited >= timeout_ms ){
+      err = kTimeoutErr;
+      break;
+    }
+    ready_unlock( );
+    mico_rtos_get_semaphore( &waiter.sem, timeout_ms == MICO_NEVER_TIMEOUT ? MICO_NEVER_TIMEOUT : timeout_ms - waited );
+    ready_lock( );
+  }
+
+  for( pwaiter = &ready_waiters; *pwaiter != &waiter; pwaiter = &(*pwaiter)->next );
+  *pwaiter = waiter.next;
+  mico_rtos_deinit_semaphore( &waiter.sem );
+
+exit:
+  ready_unlock( );
+  return err;
+}
+
+static int ready_event_index( uint32_t event )
+{
+  int i;
+
+  for( i = 0; i < READY_EVENTS; i++ ){
+    if( event == ( 1UL << i ) )
+      return i;
+  }
+  return -1;
+}
+
+uint32_t mico_system_ready_since( mico_ready_events_t event )
+{
+  uint32_t since = 0;
+  int i = ready_event_index( event );
+
+  ready_lock( );
+  if( i >= 0 && ( ready_events & event ) )
+    since = mico_get_time( ) - ready_metrics[i].last_set;
+  ready_unlock( );
+  return since;
+}
+
+OSStatus mico_system_ready_metrics( mico_ready_events_t event, mico_ready_metrics_t *metrics )
+{
+  OSStatus err = kNoErr;
+  int i = ready_event_index( event );
+
+  require_action( i >= 0 && metrics, exit, err = kParamErr );
+  ready_lock( );
+  *metrics = ready_metrics[i];
+  ready_unlock( );
+  require_action_quiet( metrics->set_count, exit, err = kNotFoundErr );
+
+exit:
+  return err;
+}
+
+/* One line for every named event: set or not, how long, and when it was first set */
+void system_ready_print( int (*print)( const char *format, ... ) )
+{
+  mico_ready_metrics_t metrics[READY_EVENT_NAMES];
+  uint32_t events, now, i;
+
+  ready_lock( );
+  events = ready_events;
+  now = mico_get_time( );
+  memcpy( metrics, ready_metrics, sizeof(metrics) );
+  ready_unlock( );
+
+  print( "Readiness at %d ms:\r\n", (int)now );
+  print( "   since  first set  sets  event\r\n" );
+  for( i = 0; i < READY_EVENT_NAMES; i++ ){
+    if( ready_event_names[i] == NULL || metrics[i].set_count == 0 ) continue;
+    if( events & ( 1UL << i ) )
+      print( "%8d %10d %5d  %s\r\n", (int)( now - metrics[i].last_set ), (int)metrics[i].first_set, (int)metrics[i].set_count, ready_event_names[i] );
+    else
+      print( "%8s %10d %5d  %s\r\n", "down", (int)metrics[i].first_set, (int)metrics[i].set_count, ready_event_names[i] );
+  }
+}
+
+/* Nothing tells that a DNS server answers but a lookup. The probe ends as
+ * soon as any lookup has succeeded, or the station has lost its address. */
+static void ready_dns_probe_thread( void *arg )
+{
+  uint32_t delay = DNS_PROBE_MIN_DELAY, ip;
+
+  UNUSED_PARAMETER( arg );
+
+  while( 1 ){
+    ready_lock( );
+    if( ( ready_events & ( mico_ready_IP | mico_ready_DNS ) ) != mico_ready_IP ){
+      dns_probe_running = false;
+      ready_unlock( );
+      break;
+    }
+    ready_unlock( );
+
+    if( mico_system_dns_resolve( MICO_DNS_PROBE_HOST, &ip, MICO_NEVER_TIMEOUT ) == kNoErr ){
+      mico_system_ready_set( mico_ready_DNS );
+      continue;
+    }
+    system_log( "DNS probe %s failed, retry in %d ms", MICO_DNS_PROBE_HOST, (int)delay );
+    mico_system_ready_wait( mico_ready_DNS, delay );
+    delay = ( delay < DNS_PROBE_MAX_DELAY / 2 ) ? delay * 2 : DNS_PROBE_MAX_DELAY;
+  }
+
+  mico_rtos_delete_thread( NULL );
+}
+
+static void ready_ip_acquired( void )
+{
+  bool start;
+
+  mico_system_ready_set( mico_ready_IP );
+
+  ready_lock( );
+  start = !dns_probe_running && !( ready_events & mico_ready_DNS );
+  if( start )
+    dns_probe_running = true;
+  ready_unlock( );
+
+  if( start && mico_rtos_create_thread( NULL, MICO_APPLICATION_PRIORITY, "DNS probe", ready_dns_probe_thread,
+                                        STACK_SIZE_DNS_PROBE_THREAD, NULL ) != kNoErr ){
+    ready_lock( );
+    dns_probe_running = false;
+    ready_unlock( );
+  }
+}
+
+static void readyNotify_WifiStatusHandler( WiFiEvent event, mico_Context_t * const inContext )
+{
+  switch ( event ) {
+  case NOTIFY_STATION_UP:
+    mico_system_ready_set( mico_ready_STATION_UP );
+    /* No DHCP_COMPLETED notification comes with a static address */
+    if( inContext && inContext->flashContentInRam.micoSystemConfig.dhcpEnable == false )
+      ready_ip_acquired( );
+    break;
+  case NOTIFY_STATION_DOWN:
+    mico_system_ready_clear( mico_ready_STATION_UP | mico_ready_IP | mico_ready_DNS );
+    break;
+  default:
+    break;
+  }
+}
+
+static void readyNotify_DHCPCompleteHandler( IPStatusTypedef *pnet, mico_Context_t * const inContext )
+{
+  UNUSED_PARAMETER( pnet );
+  UNUSED_PARAMETER( inContext );
+  ready_ip_acquired( );
+}
+
+static void readyNotify_DNSResolveHandler( uint8_t *hostname, uint32_t ip, mico_Context_t * const inContext )
+{
+  UNUSED_PARAMETER( hostname );
+  UNUSED_PARAMETER( inContext );
+  if( ip != 0 && ( ready_events & mico_ready_IP ) )
+    mico_system_ready_set( mico_ready_DNS );
+}
+
+OSStatus system_ready_notification_init( mico_Context_t * const inContext )
+{
+  OSStatus err = kNoErr;
+
+  err = mico_system_notify_register( mico_notify_WIFI_STATUS_CHANGED, (void *)readyNotify_WifiStatusHandler, inContext );
+  require_noerr( err, exit );
+
+  err = mico_system_notify_register( mico_notify_DHCP_COMPLETED, (void *)readyNotify_DHCPCompleteHandler, inContext );
+  require_noerr( err, exit );
+
+  err = mico_system_notify_register( mico_notify_DNS_RESOLVE_COMPLETED, (void *)readyNotify_DNSResolveHandler, inContext );
+  require_noerr( err, exit );
+
+exit:
+  return err;
+}
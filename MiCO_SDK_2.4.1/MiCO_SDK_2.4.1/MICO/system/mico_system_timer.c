@@ -0,0 +1,376 @@
+/**
+******************************************************************************
+* @file    mico_system_timer.c
+* @author  William Xu
+* @version V1.0.0
+* @date    17-Oct-2026
+* @brief   System timer service, timers on a hierarchical timer wheel whose
+*          handlers run in one service thread.
+******************************************************************************
+*
+*  The MIT License
+*  Copyright (c) 2016 MXCHIP Inc.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is furnished
+*  to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in
+*  all copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+*  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+*  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+******************************************************************************
+*/
+
+#include "MICO.h"
+
+#ifndef MICO_SYSTEM_TIMER_TICK
+#define MICO_SYSTEM_TIMER_TICK      (10)        // ms, resolution of the system timers
+#endif
+
+/* The fine wheel has a slot for every tick of the next TIMER_SLOTS ticks,
+ * each coarse wheel a slot for TIMER_SLOTS slots of the wheel below it. A
+ * timer is put in the wheel its expiry falls in, and moved down one wheel
+ * when the wheel below has turned to its slot (a cascade). Starting and
+ * stopping a timer is a list insertion or removal, the wheels are only
+ * scanned when the service thread goes to sleep. */
+#define TIMER_WHEEL_BITS            (6)
+#define TIMER_SLOTS                 (1 << TIMER_WHEEL_BITS)
+#define TIMER_SLOT_MASK             (TIMER_SLOTS - 1)
+#define TIMER_WHEELS                (4)
+#define TIMER_MAX_TICKS             (1UL << ( TIMER_WHEEL_BITS * TIMER_WHEELS ))
+
+#define TIMER_ENDLESS_WAIT          (3600*1000) // ms the service sleeps with no timer pending
+
+static mico_mutex_t           timer_mutex = NULL;
+static mico_semaphore_t       timer_wakeup_sem = NULL;
+static bool                   timer_running = false;
+static mico_system_timer_t *  timer_wheel[TIMER_WHEELS][TIMER_SLOTS];
+static mico_system_timer_t *  timer_work = NULL;        // Expired timers whose handlers are left to call
+static uint32_t               timer_base = 0;           // Next tick the wheels are turned to
+static uint32_t               timer_now = 0;            // Current tick
+static uint32_t               timer_now_ms = 0;         // mico_get_time( ) at the start of the current tick
+static uint32_t               timer_wakeup = 0;         // Tick the service thread sleeps until
+static bool                   timer_sleeping = false;
+static uint32_t               timer_pending = 0;
+static uint32_t               timer_expired = 0;
+static uint32_t               timer_cascaded = 0;
+static uint32_t               timer_late_max = 0;       // ticks
+
+/* The first timer may be started before mico_system_init( ), when no other thread is running yet */
+static void timer_lock( void )
+{
+  if( timer_mutex == NULL )
+    mico_rtos_init_mutex( &timer_mutex );
+  mico_rtos_lock_mutex( &timer_mutex );
+}
+
+static void timer_unlock( void )
+{
+  mico_rtos_unlock_mutex( &timer_mutex );
+}
+
+/* Called locked. Counts whole ticks of mico_get_time( ), which wraps after 49 days */
+static uint32_t timer_tick_update( void )
+{
+  uint32_t elapsed = mico_get_time( ) - timer_now_ms;
+
+  timer_now += elapsed / MICO_SYSTEM_TIMER_TICK;
+  timer_now_ms += elapsed - elapsed % MICO_SYSTEM_TIMER_TICK;
+  return timer_now;
+}
+
+/* Called locked */
+static void timer_list_add( mico_system_timer_t **head, mico_system_timer_t *timer )
+{
+  timer->next = *head;
+  if( timer->next )
+    timer->next->pprev = &timer->next;
+  timer->pprev = head;
+  *head = timer;
+}
+
+/* Called locked */
+static void timer_list_remove( mico_system_timer_t *timer )
+{
+  *timer->pprev = timer->next;
+  if( timer->next )
+    timer->next->pprev = timer->pprev;
+  timer->next = NULL;
+  timer->pprev = NULL;
+}
+
+/* Called locked. An expiry that has passed goes to the slot of the next tick,
+ * one beyond the last wheel to its last slot, and cascaded there again. */
+static void timer_insert( mico_system_timer_t *timer )
+{
+  uint32_t ticks = timer->expires - timer_base;
+  mico_system_timer_t **slot;
+
+  if( (int32_t)ticks < 0 )
+    slot = &timer_wheel[0][timer_base & TIMER_SLOT_MASK];
+  else if( ticks < TIMER_SLOTS )
+    slot = &timer_wheel[0][timer->expires & TIMER_SLOT_MASK];
+  else if( ticks < ( 1UL << ( 2 * TIMER_WHEEL_BITS ) ) )
+    slot = &timer_wheel[1][( timer->expires >> TIMER_WHEEL_BITS ) & TIMER_SLOT_MASK];
+  else if( ticks < ( 1UL << ( 3 * TIMER_WHEEL_BITS ) ) )
+    slot = &timer_wheel[2][( timer->expires >> ( 2 * TIMER_WHEEL_BITS ) ) & TIMER_SLOT_MASK];
+  else if( ticks < TIMER_MAX_TICKS )
+    slot = &timer_wheel[3][( timer->expires >> ( 3 * TIMER_WHEEL_BITS ) ) & TIMER_SLOT_MASK];
+  else
+    slot = &timer_wheel[3][( ( timer_base + TIMER_MAX_TICKS - 1 ) >> ( 3 * TIMER_WHEEL_BITS ) ) & TIMER_SLOT_MASK];
+  timer_list_add( slot, timer );
+}
+
+/* Called locked. Moves the timers of a coarse slot down, returns the slot */
+static uint32_t timer_cascade( int wheel, uint32_t slot )
+{
+  mico_system_timer_t *timer;
+
+  while( ( timer = timer_wheel[wheel][slot] ) != NULL ){
+    timer_list_remove( timer );
+    timer_insert( timer );
+    timer_cascaded++;
+  }
+  return slot;
+}
+
+/* Called locked. First tick a timer expires or a coarse slot is cascaded at,
+ * returns false when no timer is pending. A timer may have been put in a
+ * coarse wheel long ago, so every wheel is looked at. */
+static bool timer_next( uint32_t *next )
+{
+  uint32_t start, base_slot, at, k;
+  int wheel, shift;
+  bool found = false;
+
+  if( timer_pending == 0 )
+    return false;
+
+  for( wheel = 0; wheel < TIMER_WHEELS; wheel++ ){
+    shift = wheel * TIMER_WHEEL_BITS;
+    /* The slots of a coarse wheel are cascaded when the wheel below has turned a full round */
+    start = ( timer_base + ( 1UL << shift ) - 1 ) & ~( ( 1UL << shift ) - 1 );
+    base_slot = start >> shift;
+    for( k = 0; k < TIMER_SLOTS; k++ ){
+      if( timer_wheel[wheel][( base_slot + k ) & TIMER_SLOT_MASK] == NULL ) continue;
+      at = start + ( k << shift );
+      if( !found || (int32_t)( at - *next ) < 0 )
+        *next = at;
+      found = true;
+      break;
+    }
+  }
+  return found;
+}
+
+/* Called locked. Turns the wheels to the current tick and calls the handlers
+ * of the expired timers, unlocked, so that they may start or stop any timer. */
+static void timer_run( void )
+{
+  mico_system_timer_t *timer;
+  mico_system_timer_handler_t handler;
+  void *arg;
+  uint32_t slot, late, next;
+
+  /* After a long sleep, skip the ticks with nothing to expire or cascade */
+  if( (int32_t)( timer_tick_update( ) - timer_base ) > TIMER_SLOTS && timer_next( &next ) &&
+      (int32_t)( next - timer_base ) > 0 )
+    timer_base = ( (int32_t)( next - timer_now ) > 0 ) ? timer_now + 1 : next;
+
+  while( (int32_t)( timer_tick_update( ) - timer_base ) >= 0 ){
+    /* Nothing to turn to, jump to the current tick */
+    if( timer_pending == 0 ){
+      timer_base = timer_now + 1;
+      break;
+    }
+
+    slot = timer_base & TIMER_SLOT_MASK;
+    if( slot == 0 &&
+        timer_cascade( 1, ( timer_base >> TIMER_WHEEL_BITS ) & TIMER_SLOT_MASK ) == 0 &&
+        timer_cascade( 2, ( timer_base >> ( 2 * TIMER_WHEEL_BITS ) ) & TIMER_SLOT_MASK ) == 0 )
+      timer_cascade( 3, ( timer_base >> ( 3 * TIMER_WHEEL_BITS ) ) & TIMER_SLOT_MASK );
+
+    /* A timer started by a handler for this tick goes to the next slot, not to the list being run */
+    timer_work = timer_wheel[0][slot];
+    if( timer_work )
+      timer_work->pprev = &timer_work;
+    timer_wheel[0][slot] = NULL;
+    timer_base++;
+
+    while( ( timer = timer_work ) != NULL ){
+      timer_list_remove( timer );
+      timer_expired++;
+      late = timer_now - timer->expires;
+      if( (int32_t)late > (int32_t)timer_late_max )
+        timer_late_max = late;
+
+      /* Re-armed before the handler, which may stop or restart its own timer */
+      if( timer->period ){
+        timer->expires += timer->period;
+        if( (int32_t)( timer->expires - timer_now ) <= 0 )
+          timer->expires = timer_now + timer->period;
+        timer_insert( timer );
+      } else {
+        timer_pending--;
+      }
+
+      handler = timer->handler;
+      arg = timer->arg;
+      timer_unlock( );
+      handler( arg );
+      timer_lock( );
+    }
+  }
+}
+
+static void timer_service_thread( void *arg )
+{
+  uint32_t next, wait;
+
+  UNUSED_PARAMETER( arg );
+
+  timer_lock( );
+  while( 1 ){
+    timer_run( );
+
+    if( timer_next( &next ) ){
+      timer_tick_update( );
+      wait = ( (int32_t)( next - timer_now ) > 0 ) ? ( next - timer_now ) * MICO_SYSTEM_TIMER_TICK : 0;
+      wait -= Min( wait, mico_get_time( ) - timer_now_ms );
+      timer_wakeup = next;
+    } else {
+      wait = TIMER_ENDLESS_WAIT;
+      timer_wakeup = timer_now + TIMER_ENDLESS_WAIT / MICO_SYSTEM_TIMER_TICK;
+    }
+    timer_sleeping = true;
+    timer_unlock( );
+
+    if( wait )
+      mico_rtos_get_semaphore( &timer_wakeup_sem, wait );
+
+    timer_lock( );
+    timer_sleeping = false;
+  }
+}
+
+/* Called locked */
+static OSStatus timer_service_start( void )
+{
+  OSStatus err = kNoErr;
+
+  require_quiet( !timer_running, exit );
+  if( timer_wakeup_sem == NULL ){
+    err = mico_rtos_init_semaphore( &timer_wakeup_sem, 1 );
+    require_noerr( err, exit );
+  }
+  timer_now_ms = mico_get_time( );
+  timer_base = timer_now + 1;
+  err = mico_rtos_create_thread( NULL, MICO_APPLICATION_PRIORITY, "Timer Service", timer_service_thread,
+                                 STACK_SIZE_TIMER_SERVICE_THREAD, NULL );
+  require_noerr( err, exit );
+  timer_running = true;
+
+exit:
+  return err;
+}
+
+void mico_system_timer_init( mico_system_timer_t *timer, mico_system_timer_handler_t handler, void *arg )
+{
+  memset( timer, 0, sizeof(mico_system_timer_t) );
+  timer->handler = handler;
+  timer->arg = arg;
+}
+
+OSStatus mico_system_timer_start( mico_system_timer_t *timer, uint32_t delay_ms, uint32_t period_ms )
+{
+  OSStatus err = kNoErr;
+  uint32_t ticks, period;
+
+  require_action( timer && timer->handler, exit, err = kParamErr );
+  period = ( period_ms + MICO_SYSTEM_TIMER_TICK - 1 ) / MICO_SYSTEM_TIMER_TICK;
+  require_action( delay_ms / MICO_SYSTEM_TIMER_TICK < TIMER_MAX_TICKS - 2 && period < TIMER_MAX_TICKS, exit, err = kRangeErr );
+
+  timer_lock( );
+  err = timer_service_start( );
+  require_noerr_action( err, exit, timer_unlock( ) );
+
+  if( timer->pprev )
+    timer_list_remove( timer );
+  else
+    timer_pending++;
+
+  /* Never expires early: counted from the time in the current tick */
+  timer_tick_update( );
+  ticks = ( mico_get_time( ) - timer_now_ms + delay_ms + MICO_SYSTEM_TIMER_TICK - 1 ) / MICO_SYSTEM_TIMER_TICK;
+  timer->expires = timer_now + ticks;
+  timer->period = period;
+  timer_insert( timer );
+
+  /* The service thread is woken up only when this timer is due before it would wake up */
+  if( timer_sleeping && (int32_t)( timer->expires - timer_wakeup ) < 0 ){
+    timer_wakeup = timer->expires;
+    mico_rtos_set_semaphore( &timer_wakeup_sem );
+  }
+  timer_unlock( );
+
+exit:
+  return err;
+}
+
+/* Locked even for a timer that is not pending, it is only unlinked for a
+ * moment by a cascade in the service thread */
+void mico_system_timer_stop( mico_system_timer_t *timer )
+{
+  if( timer == NULL )
+    return;
+
+  timer_lock( );
+  if( timer->pprev ){
+    timer_list_remove( timer );
+    timer_pending--;
+  }
+  timer_unlock( );
+}
+
+bool mico_system_timer_pending( mico_system_timer_t *timer )
+{
+  bool pending;
+
+  if( timer == NULL )
+    return false;
+  timer_lock( );
+  pending = ( timer->pprev != NULL );
+  timer_unlock( );
+  return pending;
+}
+
+void system_timer_print( int (*print)( const char *format, ... ) )
+{
+  uint32_t pending, expired, cascaded, late_max, next = 0;
+  bool next_found;
+
+  timer_lock( );
+  timer_tick_update( );
+  pending = timer_pending;
+  expired = timer_expired;
+  cascaded = timer_cascaded;
+  late_max = timer_late_max;
+  next_found = timer_next( &next );
+  next -= timer_now;
+  timer_unlock( );
+
+  print( "Timer service, tick %d ms, %d wheels of %d slots\r\n", MICO_SYSTEM_TIMER_TICK, TIMER_WHEELS, TIMER_SLOTS );
+  print( "%d pending, %d expired, %d cascaded, up to %d ms late\r\n",
+         (int)pending, (int)expired, (int)cascaded, (int)( late_max * MICO_SYSTEM_TIMER_TICK ) );
+  if( next_found )
+    print( "Service thread wakes up in %d ms\r\n", (int)( (int32_t)next > 0 ? next * MICO_SYSTEM_TIMER_TICK : 0 ) );
+}
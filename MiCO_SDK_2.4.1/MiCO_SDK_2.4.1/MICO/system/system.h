@@ -47,10 +47,14 @@ extern "C" {
 #define system_log_trace() custom_log_trace("SYSTEM")
 
 /* Define MICO service thread stack size */
-#define STACK_SIZE_LOCAL_CONFIG_SERVER_THREAD   0x300
-#define STACK_SIZE_LOCAL_CONFIG_CLIENT_THREAD   0x450
-#define STACK_SIZE_NTP_CLIENT_THREAD            0x450
+#define STACK_SIZE_LOCAL_CONFIG_SERVER_THREAD   0x500
+#define STACK_SIZE_NTP_CLIENT_THREAD            0x500
 #define STACK_SIZE_mico_system_MONITOR_THREAD   0x300
+#define STACK_SIZE_OTA_WRITER_THREAD            0x400
+#define STACK_SIZE_SYSTEM_INIT_THREAD           0x800
+#define STACK_SIZE_DNS_PROBE_THREAD             0x500
+#define STACK_SIZE_DNS_RESOLVER_THREAD          0x500
+#define STACK_SIZE_TIMER_SERVICE_THREAD         0x500
 
 #define EASYLINK_BYPASS_NO                      (0)
 #define EASYLINK_BYPASS                         (1)
@@ -205,6 +209,26 @@ OSStatus MICOReadConfiguration          ( system_context_t * const inContext );
 
 void mico_mfg_test( system_context_t * const inContext );
 
+void system_boot_trace_print( int (*print)( const char *format, ... ) );
+
+OSStatus system_ready_notification_init( system_context_t * const inContext );
+
+/* Readiness events of mico_system_init( ) itself, in the bits mico_ready_events_t leaves unused */
+#define SYSTEM_READY_INIT_DONE      (1<<14)     // Every step has returned
+#define SYSTEM_READY_INIT_FAILED    (1<<15)     // A step has failed, the steps waiting for it are skipped
+
+/* As mico_system_ready_wait( ), but returns kStateErr as soon as any of abort_events is set */
+OSStatus system_ready_wait( uint32_t events, uint32_t abort_events, uint32_t timeout_ms );
+
+void system_ready_print( int (*print)( const char *format, ... ) );
+
+void system_dns_print( int (*print)( const char *format, ... ) );
+
+void system_timer_print( int (*print)( const char *format, ... ) );
+
+/* Delivers mico_notify_DNS_RESOLVE_COMPLETED, called by the stack and the resolver */
+void dns_ip_set( uint8_t *hostname, uint32_t ip );
+
 
 #ifdef __cplusplus
 } /*extern "C" */
@@ -168,6 +168,10 @@ OSStatus system_notification_init( mico_Context_t * const inContext )
   err = mico_system_notify_register( mico_notify_WiFI_PARA_CHANGED, (void *)micoNotify_WiFIParaChangedHandler, inContext );
   require_noerr( err, exit ); 
 
+  /* Readiness events: link up, IP address and DNS */
+  err = system_ready_notification_init( inContext );
+  require_noerr( err, exit );
+
 exit:
   return err;
 }
@@ -86,7 +86,6 @@ void tftp_ota(void)
     mico_logic_partition_t* ota_partition = MicoFlashGetInfo( MICO_PARTITION_OTA_TEMP );
     uint16_t crc = 0;
     CRC16_Context contex;
-    mico_Context_t* context = NULL;
     
 #define TMP_BUF_LEN 1024
 
@@ -196,14 +195,7 @@ void tftp_ota(void)
 
     fota_log("OTA bin md5 check success, CRC %x. upgrading...", crc);
 
-    context = mico_system_context_get( );
-    memset(&context->flashContentInRam.bootTable, 0, sizeof(boot_table_t));
-    context->flashContentInRam.bootTable.length = filelen;
-    context->flashContentInRam.bootTable.start_address = ota_partition->partition_start_addr;
-    context->flashContentInRam.bootTable.type = 'A';
-    context->flashContentInRam.bootTable.upgrade_type = 'U';
-    context->flashContentInRam.bootTable.crc = crc;
-    mico_system_context_update( mico_system_context_get( ) );
+    mico_ota_switch_to_new_fw( filelen, crc );
     
     mico_ota_finished(OTA_SUCCESS, NULL);
     while(1)
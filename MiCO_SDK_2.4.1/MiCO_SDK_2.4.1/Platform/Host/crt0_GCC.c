@@ -0,0 +1,61 @@
+/**
+******************************************************************************
+* @file    crt0_GCC.c
+* @author  William Xu
+* @version V1.0.0
+* @date    17-Oct-2026
+* @brief   Process entry of the host platform, it stands in for the reset
+*          handler of a Cortex-M: bring up the platform, then start MiCO.
+******************************************************************************
+*
+*  The MIT License
+*  Copyright (c) 2016 MXCHIP Inc.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy 
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights 
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is furnished
+*  to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in
+*  all copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+*  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR 
+*  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+******************************************************************************
+*/ 
+
+#include <signal.h>
+
+#include "Common.h"
+#include "platform.h"
+#include "crt0.h"
+
+char** host_argv = NULL;
+
+WEAK void init_memory( void )
+{
+
+}
+
+int main( int argc, char* argv[] )
+{
+  (void) argc;
+  host_argv = argv;
+
+  /* A peer closing a socket must show up as a send() error, not kill us */
+  signal( SIGPIPE, SIG_IGN );
+  setvbuf( stdout, NULL, _IONBF, 0 );
+
+  init_memory( );
+  init_architecture( );
+  init_platform( );
+
+  mico_main( );
+  return 0;
+}
@@ -416,7 +416,7 @@ void platform_uart_irq( platform_uart_driver_t* driver )
    */
   if ( ( mask & US_IMR_RXRDY )  )
   {
-    driver->rx_ring_buffer->tail = driver->rx_ring_buffer->size - pdc_register->PERIPH_RCR;
+    ring_buffer_dma_update( driver->rx_ring_buffer, driver->rx_ring_buffer->size - pdc_register->PERIPH_RCR );
 
     // Notify thread if sufficient data are available
     if ( ( driver->rx_size > 0 ) && ( ring_buffer_used_space( driver->rx_ring_buffer ) >= driver->rx_size ) )
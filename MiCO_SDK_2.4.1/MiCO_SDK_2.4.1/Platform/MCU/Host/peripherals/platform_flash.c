@@ -0,0 +1,312 @@
+/**
+******************************************************************************
+* @file    platform_flash.c
+* @author  William Xu
+* @version V1.0.0
+* @date    17-Oct-2026
+* @brief   This file provides flash operation functions. Every flash device
+*          is emulated as NOR flash in a file on the host.
+******************************************************************************
+*
+*  The MIT License
+*  Copyright (c) 2016 MXCHIP Inc.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy 
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights 
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is furnished
+*  to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in
+*  all copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+*  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR 
+*  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+******************************************************************************
+*/ 
+
+/* Includes ------------------------------------------------------------------*/
+#include "PlatformLogging.h"
+#include "platform_peripheral.h"
+#include "platform.h"
+#include "platform_config.h"
+#include "stdio.h"
+#include "stdlib.h"
+
+/* Private constants --------------------------------------------------------*/
+#define HOST_FLASH_MAX_DEVICES  (4)
+#define HOST_FLASH_PATH_LEN     (256)
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  const platform_flash_t* peripheral;
+  FILE*                   file;
+  uint32_t                erase_count;
+} host_flash_file_t;
+
+/* Private variables ---------------------------------------------------------*/
+static host_flash_file_t host_flash_files[HOST_FLASH_MAX_DEVICES];
+static uint32_t host_flash_power_cut;     /* Erases and writes left until the power fails, 0 never */
+static uint32_t host_flash_erase_ns;      /* Time a sector erase takes, set by platform_flash_timing() */
+static uint32_t host_flash_page_ns;       /* Time programming a page takes */
+
+/* Private function prototypes -----------------------------------------------*/
+static FILE* hostFlashFile( const platform_flash_t *peripheral );
+static host_flash_file_t* hostFlashEntry( const platform_flash_t *peripheral );
+static OSStatus hostFlashOpen( const platform_flash_t *peripheral, FILE** file );
+static OSStatus hostFlashProgram( FILE* file, uint32_t offset, uint8_t* data, uint32_t length );
+static bool hostFlashPowerFails( void );
+static void hostFlashPowerOff( FILE* file );
+
+
+OSStatus platform_flash_init( const platform_flash_t *peripheral )
+{
+  OSStatus err = kNoErr;
+  FILE* file;
+
+  require_action_quiet( peripheral != NULL, exit, err = kParamErr);
+  require_action_quiet( peripheral->flash_file != NULL, exit, err = kTypeErr);
+
+  if( hostFlashFile( peripheral ) != NULL )
+    goto exit;
+
+  err = hostFlashOpen( peripheral, &file );
+  require_noerr(err, exit);
+
+exit:
+  return err;
+}
+
+OSStatus platform_flash_erase( const platform_flash_t *peripheral, uint32_t start_address, uint32_t end_address )
+{
+  OSStatus err = kNoErr;
+  FILE* file;
+  uint8_t blank[HOST_FLASH_SECTOR_SIZE];
+  uint32_t sector, i;
+  bool power_fails = hostFlashPowerFails( );
+
+  require_action_quiet( peripheral != NULL, exit, err = kParamErr);
+  require_action( start_address >= peripheral->flash_start_addr 
+               && end_address   <= peripheral->flash_start_addr + peripheral->flash_length - 1, exit, err = kParamErr);
+  file = hostFlashFile( peripheral );
+  require_action( file, exit, err = kNotInitializedErr );
+
+  /* Whole sectors covering the range are erased, as a real NOR device does */
+  memset( blank, 0xFF, sizeof(blank) );
+  start_address -= peripheral->flash_start_addr;
+  end_address -= peripheral->flash_start_addr;
+  for( sector = start_address / HOST_FLASH_SECTOR_SIZE; sector <= end_address / HOST_FLASH_SECTOR_SIZE; sector++ ){
+    /* An erase cut short leaves random bits of its first sector programmed */
+    if( power_fails ){
+      for( i = 0; i < HOST_FLASH_SECTOR_SIZE; i++ )
+        blank[i] = (uint8_t)( rand( ) | rand( ) );
+    }
+    require_action( fseek( file, (long)( sector * HOST_FLASH_SECTOR_SIZE ), SEEK_SET ) == 0, exit, err = kWriteErr );
+    require_action( fwrite( blank, 1, HOST_FLASH_SECTOR_SIZE, file ) == HOST_FLASH_SECTOR_SIZE, exit, err = kWriteErr );
+    hostFlashEntry( peripheral )->erase_count++;
+    if( host_flash_erase_ns )
+      platform_nanosecond_delay( host_flash_erase_ns );
+    if( power_fails )
+      hostFlashPowerOff( file );
+  }
+  fflush( file );
+
+exit:
+  return err;
+}
+
+OSStatus platform_flash_write( const platform_flash_t *peripheral, volatile uint32_t* start_address, uint8_t* data ,uint32_t length  )
+{
+  OSStatus err = kNoErr;
+  FILE* file;
+  uint32_t offset, done;
+  uint8_t partial;
+
+  require_action_quiet( peripheral != NULL, exit, err = kParamErr);
+  require_action( *start_address >= peripheral->flash_start_addr 
+               && *start_address + length <= peripheral->flash_start_addr + peripheral->flash_length, exit, err = kParamErr);
+  file = hostFlashFile( peripheral );
+  require_action( file, exit, err = kNotInitializedErr );
+  offset = *start_address - peripheral->flash_start_addr;
+
+  /* A write cut short programs the first bytes, and the next one only partly */
+  if( hostFlashPowerFails( ) ){
+    done = (uint32_t)rand( ) % ( length + 1 );
+    hostFlashProgram( file, offset, data, done );
+    if( done < length ){
+      partial = data[done] | (uint8_t)rand( );
+      hostFlashProgram( file, offset + done, &partial, 1 );
+    }
+    hostFlashPowerOff( file );
+  }
+
+  err = hostFlashProgram( file, offset, data, length );
+  require_noerr( err, exit );
+  *start_address += length;
+
+exit:
+  return err;
+}
+
+OSStatus platform_flash_read( const platform_flash_t *peripheral, volatile uint32_t* start_address, uint8_t* data ,uint32_t length  )
+{
+  OSStatus err = kNoErr;
+  FILE* file;
+
+  require_action_quiet( peripheral != NULL, exit, err = kParamErr);
+  require_action( (*start_address >= peripheral->flash_start_addr) 
+               && (*start_address + length) <= ( peripheral->flash_start_addr + peripheral->flash_length), exit, err = kParamErr);
+  file = hostFlashFile( peripheral );
+  require_action( file, exit, err = kNotInitializedErr );
+
+  require_action( fseek( file, (long)( *start_address - peripheral->flash_start_addr ), SEEK_SET ) == 0, exit, err = kReadErr );
+  require_action( fread( data, 1, length, file ) == length, exit, err = kReadErr );
+  *start_address += length;
+
+exit:
+  return err;
+}
+
+OSStatus platform_flash_enable_protect( const platform_flash_t *peripheral, uint32_t start_address, uint32_t end_address )
+{
+  UNUSED_PARAMETER( peripheral );
+  UNUSED_PARAMETER( start_address );
+  UNUSED_PARAMETER( end_address );
+  return kNoErr;
+}
+
+OSStatus platform_flash_disable_protect( const platform_flash_t *peripheral, uint32_t start_address, uint32_t end_address )
+{
+  UNUSED_PARAMETER( peripheral );
+  UNUSED_PARAMETER( start_address );
+  UNUSED_PARAMETER( end_address );
+  return kNoErr;
+}
+
+uint32_t platform_flash_erase_count( const platform_flash_t *peripheral )
+{
+  host_flash_file_t* entry = hostFlashEntry( peripheral );
+
+  return entry ? entry->erase_count : 0;
+}
+
+void platform_flash_power_cut( uint32_t operations )
+{
+  host_flash_power_cut = operations;
+}
+
+void platform_flash_timing( uint32_t erase_us, uint32_t page_us )
+{
+  host_flash_erase_ns = erase_us * 1000;
+  host_flash_page_ns = page_us * 1000;
+}
+
+static host_flash_file_t* hostFlashEntry( const platform_flash_t *peripheral )
+{
+  int i;
+
+  for( i = 0; i < HOST_FLASH_MAX_DEVICES; i++ ){
+    if( host_flash_files[i].peripheral == peripheral )
+      return &host_flash_files[i];
+  }
+  return NULL;
+}
+
+static FILE* hostFlashFile( const platform_flash_t *peripheral )
+{
+  host_flash_file_t* entry = hostFlashEntry( peripheral );
+
+  return entry ? entry->file : NULL;
+}
+
+static OSStatus hostFlashProgram( FILE* file, uint32_t offset, uint8_t* data, uint32_t length )
+{
+  OSStatus err = kNoErr;
+  uint8_t buffer[HOST_FLASH_PAGE_SIZE];
+  uint32_t chunk, i;
+
+  while( length > 0 ){
+    chunk = HOST_FLASH_PAGE_SIZE - ( offset % HOST_FLASH_PAGE_SIZE );
+    if( chunk > length )
+      chunk = length;
+
+    /* Programming can only clear bits */
+    require_action( fseek( file, (long)offset, SEEK_SET ) == 0, exit, err = kWriteErr );
+    require_action( fread( buffer, 1, chunk, file ) == chunk, exit, err = kReadErr );
+    for( i = 0; i < chunk; i++ )
+      buffer[i] &= data[i];
+    require_action( fseek( file, (long)offset, SEEK_SET ) == 0, exit, err = kWriteErr );
+    require_action( fwrite( buffer, 1, chunk, file ) == chunk, exit, err = kWriteErr );
+    if( host_flash_page_ns )
+      platform_nanosecond_delay( host_flash_page_ns );
+
+    data += chunk;
+    length -= chunk;
+    offset += chunk;
+  }
+  fflush( file );
+
+exit:
+  return err;
+}
+
+/* Counts down the erases and writes set by platform_flash_power_cut() */
+static bool hostFlashPowerFails( void )
+{
+  if( host_flash_power_cut == 0 )
+    return false;
+  return --host_flash_power_cut == 0;
+}
+
+/* The device stops here, with nothing flushed but the flash */
+static void hostFlashPowerOff( FILE* file )
+{
+  fflush( file );
+  _Exit( PLATFORM_FLASH_POWER_CUT_STATUS );
+}
+
+/* Open the backing file, a new file is created as a blank (erased) device */
+static OSStatus hostFlashOpen( const platform_flash_t *peripheral, FILE** file )
+{
+  OSStatus err = kNoErr;
+  char path[HOST_FLASH_PATH_LEN];
+  const char* dir = getenv( "MICO_HOST_FLASH_DIR" );
+  uint8_t blank[HOST_FLASH_SECTOR_SIZE];
+  long size = 0;
+  int i;
+
+  *file = NULL;
+  for( i = 0; i < HOST_FLASH_MAX_DEVICES && host_flash_files[i].peripheral != NULL; i++ );
+  require_action( i < HOST_FLASH_MAX_DEVICES, exit, err = kNoResourcesErr );
+
+  snprintf( path, sizeof(path), "%s/%s", dir ? dir : HOST_FLASH_DIR, peripheral->flash_file );
+  *file = fopen( path, "r+b" );
+  if( *file == NULL )
+    *file = fopen( path, "w+b" );
+  require_action( *file, exit, platform_log( "Open flash file %s failed", path ); err = kOpenErr );
+
+  fseek( *file, 0, SEEK_END );
+  size = ftell( *file );
+  memset( blank, 0xFF, sizeof(blank) );
+  while( size < (long)peripheral->flash_length ){
+    require_action( fwrite( blank, 1, HOST_FLASH_SECTOR_SIZE, *file ) == HOST_FLASH_SECTOR_SIZE, exit, err = kWriteErr );
+    size += HOST_FLASH_SECTOR_SIZE;
+  }
+  fflush( *file );
+
+  host_flash_files[i].peripheral = peripheral;
+  host_flash_files[i].file = *file;
+
+exit:
+  if( err != kNoErr && *file != NULL ){
+    fclose( *file );
+    *file = NULL;
+  }
+  return err;
+}
@@ -0,0 +1,124 @@
+/**
+******************************************************************************
+* @file    platform_gpio.c
+* @author  William Xu
+* @version V1.0.0
+* @date    17-Oct-2026
+* @brief   This file provide GPIO driver functions. The host has no pins,
+*          output levels are kept in memory and inputs read their pull level.
+******************************************************************************
+*
+*  The MIT License
+*  Copyright (c) 2016 MXCHIP Inc.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy 
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights 
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is furnished
+*  to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in
+*  all copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+*  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR 
+*  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+******************************************************************************
+*/ 
+
+#include "platform.h"
+#include "platform_peripheral.h"
+
+/******************************************************
+*               Variables Definitions
+******************************************************/
+
+extern const platform_gpio_t platform_gpio_pins[];
+
+static bool gpio_levels[MICO_GPIO_MAX];
+
+/******************************************************
+*               Function Definitions
+******************************************************/
+
+static int gpio_index( const platform_gpio_t* gpio )
+{
+  int index = (int)( gpio - platform_gpio_pins );
+
+  if ( index < 0 || index >= MICO_GPIO_MAX )
+    return -1;
+  return index;
+}
+
+OSStatus platform_gpio_init( const platform_gpio_t* gpio, platform_pin_config_t config )
+{
+  int index = gpio_index( gpio );
+
+  if ( index < 0 )
+    return kParamErr;
+
+  /* Inputs settle to their pull level, nothing ever drives them */
+  gpio_levels[index] = ( config != INPUT_PULL_DOWN );
+  return kNoErr;
+}
+
+OSStatus platform_gpio_deinit( const platform_gpio_t* gpio )
+{
+  return ( gpio_index( gpio ) < 0 ) ? kParamErr : kNoErr;
+}
+
+OSStatus platform_gpio_output_high( const platform_gpio_t* gpio )
+{
+  int index = gpio_index( gpio );
+
+  if ( index < 0 )
+    return kParamErr;
+  gpio_levels[index] = true;
+  return kNoErr;
+}
+
+OSStatus platform_gpio_output_low( const platform_gpio_t* gpio )
+{
+  int index = gpio_index( gpio );
+
+  if ( index < 0 )
+    return kParamErr;
+  gpio_levels[index] = false;
+  return kNoErr;
+}
+
+OSStatus platform_gpio_output_trigger( const platform_gpio_t* gpio )
+{
+  int index = gpio_index( gpio );
+
+  if ( index < 0 )
+    return kParamErr;
+  gpio_levels[index] = !gpio_levels[index];
+  return kNoErr;
+}
+
+bool platform_gpio_input_get( const platform_gpio_t* gpio )
+{
+  int index = gpio_index( gpio );
+
+  if ( index < 0 )
+    return false;
+  return gpio_levels[index];
+}
+
+OSStatus platform_gpio_irq_enable( const platform_gpio_t* gpio, platform_gpio_irq_trigger_t trigger, platform_gpio_irq_callback_t handler, void* arg )
+{
+  UNUSED_PARAMETER( trigger );
+  UNUSED_PARAMETER( handler );
+  UNUSED_PARAMETER( arg );
+  return ( gpio_index( gpio ) < 0 ) ? kParamErr : kNoErr;
+}
+
+OSStatus platform_gpio_irq_disable( const platform_gpio_t* gpio )
+{
+  return ( gpio_index( gpio ) < 0 ) ? kParamErr : kNoErr;
+}
@@ -0,0 +1,180 @@
+/**
+******************************************************************************
+* @file    platform_mcu_peripheral.h
+* @author  William Xu
+* @version V1.0.0
+* @date    17-Oct-2026
+* @brief   This file provides the MCU specific peripheral types of the host (POSIX)
+*          simulation platform.
+******************************************************************************
+*
+*  The MIT License
+*  Copyright (c) 2016 MXCHIP Inc.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy 
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights 
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is furnished
+*  to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in
+*  all copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+*  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR 
+*  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+******************************************************************************
+*/ 
+
+#pragma once
+
+#include "mico_rtos.h"
+#include "RingBufferUtils.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/******************************************************
+ *                      Macros
+ ******************************************************/
+
+/* CMSIS qualifier, used by drivers shared with the Cortex-M platforms */
+#ifndef __IO
+#define __IO    volatile
+#endif
+
+/******************************************************
+ *                    Constants
+ ******************************************************/
+
+/* Flash devices are emulated as NOR flash: erase sets a whole sector to 0xFF,
+ * program can only clear bits, programming crosses no page boundary. */
+#define HOST_FLASH_SECTOR_SIZE    (0x1000)
+#define HOST_FLASH_PAGE_SIZE      (0x100)
+
+/******************************************************
+ *                   Enumerations
+ ******************************************************/
+
+typedef enum
+{
+    FLASH_TYPE_EMBEDDED, 
+    FLASH_TYPE_SPI,
+} platform_flash_type_t;
+
+/******************************************************
+ *                 Type Definitions
+ ******************************************************/
+
+/******************************************************
+ *                    Structures
+ ******************************************************/
+
+typedef struct
+{
+    const char*           name;
+} platform_gpio_t;
+
+typedef struct
+{
+    uint8_t               unimplemented;
+} platform_adc_t;
+
+typedef struct
+{
+    uint8_t               unimplemented;
+} platform_pwm_t;
+
+typedef struct
+{
+    uint8_t               unimplemented;
+} platform_spi_t;
+
+typedef struct
+{
+    platform_spi_t*       peripheral;
+    mico_mutex_t          spi_mutex;
+} platform_spi_driver_t;
+
+typedef struct
+{
+    uint8_t               unimplemented;
+} platform_spi_slave_driver_t;
+
+typedef struct
+{
+    uint8_t               unimplemented;
+} platform_i2c_t;
+
+typedef struct
+{
+    mico_mutex_t          i2c_mutex;
+} platform_i2c_driver_t;
+
+typedef struct
+{
+    const char*           device;   /* NULL: stdin/stdout, otherwise a tty/pty path */
+} platform_uart_t;
+
+typedef struct
+{
+    platform_uart_t*           peripheral;
+    ring_buffer_t*             rx_buffer;
+    int                        fd_in;
+    int                        fd_out;
+    mico_thread_t              rx_thread;
+    mico_semaphore_t           rx_complete;
+    mico_mutex_t               tx_mutex;
+    volatile uint32_t          rx_size;
+    volatile bool              initialized;
+} platform_uart_driver_t;
+
+typedef struct
+{
+    platform_flash_type_t      flash_type;
+    uint32_t                   flash_start_addr;
+    uint32_t                   flash_length;
+    uint32_t                   flash_protect_opt;
+    const char*                flash_file;   /* Backing file, relative to HOST_FLASH_DIR */
+} platform_flash_t;
+
+typedef struct
+{
+    const platform_flash_t*    peripheral;
+    mico_mutex_t               flash_mutex;
+    volatile bool              initialized;
+} platform_flash_driver_t;
+
+/******************************************************
+ *                 Global Variables
+ ******************************************************/
+
+/******************************************************
+ *               Function Declarations
+ ******************************************************/
+
+OSStatus platform_rtc_init ( void );
+
+/* Host only: sectors erased on a flash device since start, to measure wear */
+uint32_t platform_flash_erase_count( const platform_flash_t *peripheral );
+
+/* Host only: the power fails during the given erase or write from now on, counted over all
+   flash devices, 0 never. That operation is left half done and the process exits with
+   PLATFORM_FLASH_POWER_CUT_STATUS. */
+#define PLATFORM_FLASH_POWER_CUT_STATUS   ( 99 )
+void platform_flash_power_cut( uint32_t operations );
+
+/* Host only: from now on every sector erase takes erase_us and every page programmed
+   (HOST_FLASH_PAGE_SIZE or the part of it written) takes page_us, like a real device. 0, 0 is
+   the default and does not wait. */
+void platform_flash_timing( uint32_t erase_us, uint32_t page_us );
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
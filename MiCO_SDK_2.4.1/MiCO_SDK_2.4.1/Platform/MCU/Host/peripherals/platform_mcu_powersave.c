@@ -0,0 +1,59 @@
+/**
+******************************************************************************
+* @file    platform_mcu_powersave.c
+* @author  William Xu
+* @version V1.0.0
+* @date    17-Oct-2026
+* @brief   This file provide MCU powersave functions, which are no-ops on
+*          the host.
+******************************************************************************
+*
+*  The MIT License
+*  Copyright (c) 2016 MXCHIP Inc.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy 
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights 
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is furnished
+*  to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in
+*  all copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+*  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR 
+*  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+******************************************************************************
+*/ 
+
+#include "platform.h"
+#include "platform_peripheral.h"
+
+/******************************************************
+*               Function Definitions
+******************************************************/
+
+OSStatus platform_mcu_powersave_enable( void )
+{
+  return kNoErr;
+}
+
+OSStatus platform_mcu_powersave_disable( void )
+{
+  return kNoErr;
+}
+
+void platform_mcu_powersave_exit_notify( void )
+{
+}
+
+void platform_mcu_enter_standby( uint32_t secondsToWakeup )
+{
+  platform_log( "Standby for %u seconds", (unsigned int)secondsToWakeup );
+  mico_thread_sleep( secondsToWakeup );
+  platform_mcu_reset( );
+}
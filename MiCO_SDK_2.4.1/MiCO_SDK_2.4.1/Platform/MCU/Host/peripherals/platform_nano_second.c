@@ -0,0 +1,83 @@
+/**
+******************************************************************************
+* @file    platform_nano_second.c
+* @author  William Xu
+* @version V1.0.0
+* @date    17-Oct-2026
+* @brief   This file provide nanosecond clock functions on the host
+*          monotonic clock.
+******************************************************************************
+*
+*  The MIT License
+*  Copyright (c) 2016 MXCHIP Inc.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy 
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights 
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is furnished
+*  to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in
+*  all copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+*  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR 
+*  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+******************************************************************************
+*/ 
+
+#include <time.h>
+
+#include "platform.h"
+#include "platform_peripheral.h"
+
+/******************************************************
+*               Variables Definitions
+******************************************************/
+
+static uint64_t nanosecond_base = 0;
+
+/******************************************************
+*               Function Definitions
+******************************************************/
+
+static uint64_t host_nanoseconds( void )
+{
+  struct timespec ts;
+
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+uint64_t platform_get_nanosecond_clock_value( void )
+{
+  return host_nanoseconds( ) - nanosecond_base;
+}
+
+void platform_deinit_nanosecond_clock( void )
+{
+  nanosecond_base = 0;
+}
+
+void platform_reset_nanosecond_clock( void )
+{
+  nanosecond_base = host_nanoseconds( );
+}
+
+void platform_init_nanosecond_clock( void )
+{
+  nanosecond_base = host_nanoseconds( );
+}
+
+void platform_nanosecond_delay( uint64_t delayns )
+{
+  struct timespec ts;
+
+  ts.tv_sec = (time_t)( delayns / 1000000000ULL );
+  ts.tv_nsec = (long)( delayns % 1000000000ULL );
+  nanosleep( &ts, NULL );
+}
@@ -0,0 +1,55 @@
+/**
+******************************************************************************
+* @file    platform_rng.c
+* @author  William Xu
+* @version V1.0.0
+* @date    17-Oct-2026
+* @brief   This file provide random number generater functions from the
+*          host entropy source.
+******************************************************************************
+*
+*  The MIT License
+*  Copyright (c) 2016 MXCHIP Inc.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy 
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights 
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is furnished
+*  to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in
+*  all copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+*  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR 
+*  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+******************************************************************************
+*/ 
+
+#include "platform.h"
+#include "platform_peripheral.h"
+
+/******************************************************
+*               Function Definitions
+******************************************************/
+
+OSStatus platform_random_number_read( void *inBuffer, int inByteCount )
+{
+  OSStatus err = kNoErr;
+  FILE* urandom;
+
+  require_action_quiet( inBuffer != NULL && inByteCount >= 0, exit, err = kParamErr );
+
+  urandom = fopen( "/dev/urandom", "rb" );
+  require_action( urandom, exit, err = kOpenErr );
+  if ( fread( inBuffer, 1, (size_t)inByteCount, urandom ) != (size_t)inByteCount )
+    err = kReadErr;
+  fclose( urandom );
+
+exit:
+  return err;
+}
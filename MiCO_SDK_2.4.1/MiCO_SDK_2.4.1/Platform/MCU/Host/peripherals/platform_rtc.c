@@ -0,0 +1,106 @@
+/**
+******************************************************************************
+* @file    platform_rtc.c
+* @author  William Xu
+* @version V1.0.0
+* @date    17-Oct-2026
+* @brief   This file provide RTC driver functions, a software clock that
+*          runs on the host wall clock.
+******************************************************************************
+*
+*  The MIT License
+*  Copyright (c) 2016 MXCHIP Inc.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy 
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights 
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is furnished
+*  to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in
+*  all copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+*  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR 
+*  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+******************************************************************************
+*/ 
+
+#include <time.h>
+
+#include "platform.h"
+#include "platform_peripheral.h"
+
+/******************************************************
+*               Variables Definitions
+******************************************************/
+
+/* Seconds added to the host UTC time by platform_rtc_set_time() */
+static int64_t rtc_offset = 0;
+
+/******************************************************
+*               Function Definitions
+******************************************************/
+
+/* Days since 1970-01-01 of a proleptic Gregorian date */
+static int64_t days_from_civil( int64_t y, unsigned m, unsigned d )
+{
+  int64_t era;
+  unsigned yoe, doy, doe;
+
+  y -= m <= 2;
+  era = ( y >= 0 ? y : y - 399 ) / 400;
+  yoe = (unsigned)( y - era * 400 );
+  doy = ( 153 * ( m + ( m > 2 ? -3 : 9 ) ) + 2 ) / 5 + d - 1;
+  doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + (int64_t)doe - 719468;
+}
+
+/* The parameters below are named "time" like on every other MCU */
+static int64_t host_time( void )
+{
+  return (int64_t) time( NULL );
+}
+
+OSStatus platform_rtc_init( void )
+{
+  rtc_offset = 0;
+  return kNoErr;
+}
+
+OSStatus platform_rtc_get_time( platform_rtc_time_t* time )
+{
+  time_t now;
+  struct tm tm;
+
+  if ( time == NULL )
+    return kParamErr;
+
+  now = (time_t)( host_time( ) + rtc_offset );
+  gmtime_r( &now, &tm );
+  time->sec     = (uint8_t) tm.tm_sec;
+  time->min     = (uint8_t) tm.tm_min;
+  time->hr      = (uint8_t) tm.tm_hour;
+  time->weekday = (uint8_t)( tm.tm_wday + 1 );
+  time->date    = (uint8_t) tm.tm_mday;
+  time->month   = (uint8_t)( tm.tm_mon + 1 );
+  time->year    = (uint8_t)( ( tm.tm_year + 1900 ) % 100 );
+  return kNoErr;
+}
+
+OSStatus platform_rtc_set_time( const platform_rtc_time_t* time )
+{
+  int64_t seconds;
+
+  if ( time == NULL )
+    return kParamErr;
+
+  seconds = days_from_civil( 2000 + time->year, time->month, time->date ) * 86400
+          + time->hr * 3600 + time->min * 60 + time->sec;
+  rtc_offset = seconds - host_time( );
+  return kNoErr;
+}
@@ -0,0 +1,235 @@
+/**
+******************************************************************************
+* @file    platform_uart.c
+* @author  William Xu
+* @version V1.0.0
+* @date    17-Oct-2026
+* @brief   This file provide UART driver functions. UARTs are host file
+*          descriptors, stdin/stdout or a tty/named pipe.
+******************************************************************************
+*
+*  The MIT License
+*  Copyright (c) 2016 MXCHIP Inc.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy 
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights 
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is furnished
+*  to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in
+*  all copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+*  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR 
+*  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+******************************************************************************
+*/ 
+
+#include "platform.h"
+#include "platform_peripheral.h"
+#include "host_sys.h"
+
+/******************************************************
+*                    Constants
+******************************************************/
+
+#define UART_RX_THREAD_STACK_SIZE   (0x400)
+#define UART_RX_CHUNK_SIZE          (64)
+
+/******************************************************
+*               Function Declarations
+******************************************************/
+
+static void uart_rx_thread( void* arg );
+
+/******************************************************
+*               Function Definitions
+******************************************************/
+
+OSStatus platform_uart_init( platform_uart_driver_t* driver, const platform_uart_t* peripheral, const platform_uart_config_t* config, ring_buffer_t* optional_ring_buffer )
+{
+  OSStatus err = kNoErr;
+
+  require_action_quiet( ( driver != NULL ) && ( peripheral != NULL ) && ( config != NULL ), exit, err = kParamErr);
+  require_action_quiet( driver->initialized == false, exit, err = kNoErr );
+
+  driver->peripheral = (platform_uart_t*)peripheral;
+  driver->rx_size = 0;
+
+  if ( peripheral->device == NULL )
+  {
+    driver->fd_in = 0;
+    driver->fd_out = 1;
+  }
+  else
+  {
+    driver->fd_in = host_sys_open( peripheral->device );
+    require_action_quiet( driver->fd_in >= 0, exit, err = kUnsupportedErr );
+    driver->fd_out = driver->fd_in;
+  }
+
+  mico_rtos_init_semaphore( &driver->rx_complete, 1 );
+  mico_rtos_init_mutex( &driver->tx_mutex );
+
+  driver->rx_buffer = optional_ring_buffer;
+  /* The RX thread runs as long as the driver is initialized */
+  driver->initialized = true;
+  if ( optional_ring_buffer != NULL )
+  {
+    err = mico_rtos_create_thread( &driver->rx_thread, MICO_DEFAULT_WORKER_PRIORITY, "UART RX", uart_rx_thread, UART_RX_THREAD_STACK_SIZE, driver );
+    require_noerr_action( err, exit, driver->initialized = false );
+  }
+
+exit:
+  return err;
+}
+
+OSStatus platform_uart_deinit( platform_uart_driver_t* driver )
+{
+  OSStatus err = kNoErr;
+
+  require_action_quiet( ( driver != NULL ) && driver->initialized, exit, err = kParamErr);
+
+  driver->initialized = false;
+  if ( driver->rx_thread != NULL )
+  {
+    mico_rtos_delete_thread( &driver->rx_thread );
+    driver->rx_thread = NULL;
+  }
+  if ( driver->peripheral->device != NULL )
+    host_sys_close( driver->fd_in );
+
+  mico_rtos_deinit_semaphore( &driver->rx_complete );
+  mico_rtos_deinit_mutex( &driver->tx_mutex );
+  driver->rx_size = 0;
+
+exit:
+  return err;
+}
+
+OSStatus platform_uart_transmit_bytes( platform_uart_driver_t* driver, const uint8_t* data_out, uint32_t size )
+{
+  OSStatus err = kNoErr;
+  int ret;
+
+  require_action_quiet( ( driver != NULL ) && ( data_out != NULL ) && ( size != 0 ), exit, err = kParamErr);
+
+  mico_rtos_lock_mutex( &driver->tx_mutex );
+  while ( size > 0 )
+  {
+    ret = host_sys_write( driver->fd_out, data_out, size );
+    require_action_quiet( ret > 0, exit_with_mutex, err = kWriteErr );
+    data_out += ret;
+    size -= ret;
+  }
+
+exit_with_mutex:
+  mico_rtos_unlock_mutex( &driver->tx_mutex );
+exit:
+  return err;
+}
+
+OSStatus platform_uart_receive_bytes( platform_uart_driver_t* driver, uint8_t* data_in, uint32_t expected_data_size, uint32_t timeout_ms )
+{
+  OSStatus err = kNoErr;
+  host_poll_t poll_fd;
+  int ret;
+
+  require_action_quiet( ( driver != NULL ) && ( data_in != NULL ) && ( expected_data_size != 0 ), exit, err = kParamErr);
+
+  if ( driver->rx_buffer != NULL )
+  {
+    while ( expected_data_size != 0 )
+    {
+      uint32_t transfer_size = MIN( driver->rx_buffer->size / 2, expected_data_size );
+
+      /* Check if ring buffer already contains the required amount of data. */
+      if ( transfer_size > ring_buffer_used_space( driver->rx_buffer ) )
+      {
+        /* Set rx_size and wait in rx_complete semaphore until data reaches rx_size or timeout occurs */
+        driver->rx_size = transfer_size;
+        if ( transfer_size <= ring_buffer_used_space( driver->rx_buffer ) )
+          err = kNoErr;
+        else
+          err = mico_rtos_get_semaphore( &driver->rx_complete, timeout_ms );
+
+        /* Reset rx_size to prevent semaphore being set while nothing waits for the data */
+        driver->rx_size = 0;
+        mico_rtos_get_semaphore( &driver->rx_complete, 0 );
+
+        if( err != kNoErr )
+          goto exit;
+      }
+      expected_data_size -= transfer_size;
+
+      // Grab data from the buffer
+      data_in += ring_buffer_read( driver->rx_buffer, data_in, transfer_size );
+    }
+  }
+  else
+  {
+    while ( expected_data_size != 0 )
+    {
+      poll_fd.fd = driver->fd_in;
+      poll_fd.events = HOST_POLL_IN;
+      ret = host_sys_poll( &poll_fd, 1, ( timeout_ms == MICO_WAIT_FOREVER ) ? -1 : (int)timeout_ms );
+      require_action_quiet( ret > 0, exit, err = kTimeoutErr );
+
+      ret = host_sys_read( driver->fd_in, data_in, expected_data_size );
+      require_action_quiet( ret > 0, exit, err = kReadErr );
+      data_in += ret;
+      expected_data_size -= ret;
+    }
+  }
+
+exit:
+  return err;
+}
+
+uint32_t platform_uart_get_length_in_buffer( platform_uart_driver_t* driver )
+{
+  if ( driver == NULL || driver->rx_buffer == NULL )
+    return 0;
+  return ring_buffer_used_space( driver->rx_buffer );
+}
+
+/* Stands in for the RX DMA/interrupt: moves host input into the ring buffer
+ * and wakes up the receiver once rx_size bytes are there */
+static void uart_rx_thread( void* arg )
+{
+  platform_uart_driver_t* driver = (platform_uart_driver_t*) arg;
+  ring_buffer_span_t span[2];
+  int ret;
+
+  while ( driver->initialized || driver->rx_thread != NULL )
+  {
+    /* Like the DMA, read straight into the free space of the ring */
+    if ( ring_buffer_get_write_spans( driver->rx_buffer, span ) == 0 )
+    {
+      mico_thread_msleep( 1 );
+      continue;
+    }
+
+    ret = host_sys_read( driver->fd_in, span[0].data, MIN( span[0].length, UART_RX_CHUNK_SIZE ) );
+    if ( ret <= 0 )
+    {
+      /* stdin closed, keep the thread but stop spinning */
+      mico_thread_msleep( 100 );
+      continue;
+    }
+    ring_buffer_commit_write( driver->rx_buffer, ret );
+
+    if ( driver->rx_size > 0 && ring_buffer_used_space( driver->rx_buffer ) >= driver->rx_size )
+    {
+      /* Cleared first, the woken receiver may already wait for its next packet */
+      driver->rx_size = 0;
+      mico_rtos_set_semaphore( &driver->rx_complete );
+    }
+  }
+  mico_rtos_delete_thread( NULL );
+}
@@ -0,0 +1,181 @@
+/**
+******************************************************************************
+* @file    platform_unsupported.c
+* @author  William Xu
+* @version V1.0.0
+* @date    17-Oct-2026
+* @brief   ADC, PWM, SPI and I2C drivers of the host platform. The host
+*          has none of these buses, every call returns kUnsupportedErr.
+******************************************************************************
+*
+*  The MIT License
+*  Copyright (c) 2016 MXCHIP Inc.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy 
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights 
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is furnished
+*  to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in
+*  all copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+*  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR 
+*  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+******************************************************************************
+*/ 
+
+#include "platform.h"
+#include "platform_peripheral.h"
+
+/******************************************************
+*                 ADC Function Definitions
+******************************************************/
+
+OSStatus platform_adc_init( const platform_adc_t* adc, uint32_t sample_cycle )
+{
+  UNUSED_PARAMETER( adc );
+  UNUSED_PARAMETER( sample_cycle );
+  return kUnsupportedErr;
+}
+
+OSStatus platform_adc_deinit( const platform_adc_t* adc )
+{
+  UNUSED_PARAMETER( adc );
+  return kUnsupportedErr;
+}
+
+OSStatus platform_adc_take_sample( const platform_adc_t* adc, uint16_t* output )
+{
+  UNUSED_PARAMETER( adc );
+  UNUSED_PARAMETER( output );
+  return kUnsupportedErr;
+}
+
+OSStatus platform_adc_take_sample_stream( const platform_adc_t* adc, void* buffer, uint16_t buffer_length )
+{
+  UNUSED_PARAMETER( adc );
+  UNUSED_PARAMETER( buffer );
+  UNUSED_PARAMETER( buffer_length );
+  return kUnsupportedErr;
+}
+
+/******************************************************
+*                 PWM Function Definitions
+******************************************************/
+
+OSStatus platform_pwm_init( const platform_pwm_t* pwm, uint32_t frequency, float duty_cycle )
+{
+  UNUSED_PARAMETER( pwm );
+  UNUSED_PARAMETER( frequency );
+  UNUSED_PARAMETER( duty_cycle );
+  return kUnsupportedErr;
+}
+
+OSStatus platform_pwm_start( const platform_pwm_t* pwm )
+{
+  UNUSED_PARAMETER( pwm );
+  return kUnsupportedErr;
+}
+
+OSStatus platform_pwm_stop( const platform_pwm_t* pwm )
+{
+  UNUSED_PARAMETER( pwm );
+  return kUnsupportedErr;
+}
+
+/******************************************************
+*                 SPI Function Definitions
+******************************************************/
+
+OSStatus platform_spi_init( platform_spi_driver_t* driver, const platform_spi_t* peripheral, const platform_spi_config_t* config )
+{
+  UNUSED_PARAMETER( driver );
+  UNUSED_PARAMETER( peripheral );
+  UNUSED_PARAMETER( config );
+  return kUnsupportedErr;
+}
+
+OSStatus platform_spi_deinit( platform_spi_driver_t* driver )
+{
+  UNUSED_PARAMETER( driver );
+  return kUnsupportedErr;
+}
+
+OSStatus platform_spi_transfer( platform_spi_driver_t* driver, const platform_spi_config_t* config, const platform_spi_message_segment_t* segments, uint16_t number_of_segments )
+{
+  UNUSED_PARAMETER( driver );
+  UNUSED_PARAMETER( config );
+  UNUSED_PARAMETER( segments );
+  UNUSED_PARAMETER( number_of_segments );
+  return kUnsupportedErr;
+}
+
+/******************************************************
+*                 I2C Function Definitions
+******************************************************/
+
+OSStatus platform_i2c_init( const platform_i2c_t* i2c, const platform_i2c_config_t* config )
+{
+  UNUSED_PARAMETER( i2c );
+  UNUSED_PARAMETER( config );
+  return kUnsupportedErr;
+}
+
+OSStatus platform_i2c_deinit( const platform_i2c_t* i2c, const platform_i2c_config_t* config )
+{
+  UNUSED_PARAMETER( i2c );
+  UNUSED_PARAMETER( config );
+  return kUnsupportedErr;
+}
+
+bool platform_i2c_probe_device( const platform_i2c_t* i2c, const platform_i2c_config_t* config, int retries )
+{
+  UNUSED_PARAMETER( i2c );
+  UNUSED_PARAMETER( config );
+  UNUSED_PARAMETER( retries );
+  return false;
+}
+
+OSStatus platform_i2c_init_tx_message( platform_i2c_message_t* message, const void* tx_buffer, uint16_t tx_buffer_length, uint16_t retries )
+{
+  UNUSED_PARAMETER( message );
+  UNUSED_PARAMETER( tx_buffer );
+  UNUSED_PARAMETER( tx_buffer_length );
+  UNUSED_PARAMETER( retries );
+  return kUnsupportedErr;
+}
+
+OSStatus platform_i2c_init_rx_message( platform_i2c_message_t* message, void* rx_buffer, uint16_t rx_buffer_length, uint16_t retries )
+{
+  UNUSED_PARAMETER( message );
+  UNUSED_PARAMETER( rx_buffer );
+  UNUSED_PARAMETER( rx_buffer_length );
+  UNUSED_PARAMETER( retries );
+  return kUnsupportedErr;
+}
+
+OSStatus platform_i2c_init_combined_message( platform_i2c_message_t* message, const void* tx_buffer, void* rx_buffer, uint16_t tx_buffer_length, uint16_t rx_buffer_length, uint16_t retries )
+{
+  UNUSED_PARAMETER( message );
+  UNUSED_PARAMETER( tx_buffer );
+  UNUSED_PARAMETER( rx_buffer );
+  UNUSED_PARAMETER( tx_buffer_length );
+  UNUSED_PARAMETER( rx_buffer_length );
+  UNUSED_PARAMETER( retries );
+  return kUnsupportedErr;
+}
+
+OSStatus platform_i2c_transfer( const platform_i2c_t* i2c, const platform_i2c_config_t* config, platform_i2c_message_t* messages, uint16_t number_of_messages )
+{
+  UNUSED_PARAMETER( i2c );
+  UNUSED_PARAMETER( config );
+  UNUSED_PARAMETER( messages );
+  UNUSED_PARAMETER( number_of_messages );
+  return kUnsupportedErr;
+}
@@ -0,0 +1,110 @@
+/**
+******************************************************************************
+* @file    platform_init.c
+* @author  William Xu
+* @version V1.0.0
+* @date    17-Oct-2026
+* @brief   This file provide functions called by MICO to drive the host
+*          platform: architecture init, stdio and reset.
+******************************************************************************
+*
+*  The MIT License
+*  Copyright (c) 2016 MXCHIP Inc.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy 
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights 
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is furnished
+*  to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in
+*  all copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+*  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR 
+*  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+******************************************************************************
+*/ 
+
+#include "platform_peripheral.h"
+#include "platform.h"
+#include "platform_config.h"
+#include "PlatformLogging.h"
+#include "crt0.h"
+#include "mico_rtos.h"
+#include "host_sys.h"
+
+/******************************************************
+*                      Macros
+******************************************************/
+
+/******************************************************
+*                    Constants
+******************************************************/
+
+#ifndef STDIO_BUFFER_SIZE
+#define STDIO_BUFFER_SIZE   64
+#endif
+
+/******************************************************
+*               Variables Definitions
+******************************************************/
+extern platform_uart_t platform_uart_peripherals[];
+extern platform_uart_driver_t platform_uart_drivers[];
+
+#ifndef MICO_DISABLE_STDIO
+static const platform_uart_config_t stdio_uart_config =
+{
+  .baud_rate    = STDIO_UART_BAUDRATE,
+  .data_width   = DATA_WIDTH_8BIT,
+  .parity       = NO_PARITY,
+  .stop_bits    = STOP_BITS_1,
+  .flow_control = FLOW_CONTROL_DISABLED,
+  .flags        = 0,
+};
+
+static volatile ring_buffer_t stdio_rx_buffer;
+static volatile uint8_t             stdio_rx_data[STDIO_BUFFER_SIZE];
+mico_mutex_t        stdio_rx_mutex;
+mico_mutex_t        stdio_tx_mutex;
+#endif /* #ifndef MICO_DISABLE_STDIO */
+
+/******************************************************
+*               Function Definitions
+******************************************************/
+
+void platform_mcu_reset( void )
+{
+  platform_log( "Restarting..." );
+  host_sys_restart( host_argv );
+}
+
+void init_architecture( void )
+{
+#ifndef MICO_DISABLE_STDIO
+  mico_rtos_init_mutex( &stdio_tx_mutex );
+  mico_rtos_unlock_mutex ( &stdio_tx_mutex );
+  mico_rtos_init_mutex( &stdio_rx_mutex );
+  mico_rtos_unlock_mutex ( &stdio_rx_mutex );
+
+  ring_buffer_init  ( (ring_buffer_t*)&stdio_rx_buffer, (uint8_t*)stdio_rx_data, STDIO_BUFFER_SIZE );
+  platform_uart_init( &platform_uart_drivers[STDIO_UART], &platform_uart_peripherals[STDIO_UART], &stdio_uart_config, (ring_buffer_t*)&stdio_rx_buffer );
+#endif
+
+  /* Initialise RTC */
+  platform_rtc_init( );
+
+  platform_mcu_powersave_disable( );
+}
+
+OSStatus stdio_hardfault( char* data, uint32_t size )
+{
+#ifndef MICO_DISABLE_STDIO
+  host_sys_write( 2, data, size );
+#endif
+  return kNoErr;
+}
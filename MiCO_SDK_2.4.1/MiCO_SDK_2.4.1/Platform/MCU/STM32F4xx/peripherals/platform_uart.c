@@ -596,7 +596,7 @@ void platform_uart_irq( platform_uart_driver_t* driver )
   uart->SR = (uint16_t) ( uart->SR | 0xffff );
 
   // Update tail
-  driver->rx_buffer->tail = driver->rx_buffer->size - driver->peripheral->rx_dma_config.stream->NDTR;
+  ring_buffer_dma_update( driver->rx_buffer, driver->rx_buffer->size - driver->peripheral->rx_dma_config.stream->NDTR );
 
   // Notify thread if sufficient data are available
   if ( ( driver->rx_size > 0 ) && ( ring_buffer_used_space( driver->rx_buffer ) >= driver->rx_size ) )
@@ -122,6 +122,8 @@ void appRestoreDefault_callback(void * const user_config_data, uint32_t size);
 
 /**
   * @brief  Write config data hosted by cote data to non-volatile storage
+  * @note   Only the parts that changed since the last write are appended to a
+  *         log in the parameter partitions, flash is erased once the log is full.
   * @param  in_context: The address of the core data.
   * @retval kNoErr is returned on success, otherwise, kXXXErr is returned.
   */
@@ -202,6 +204,289 @@ OSStatus mico_system_delegate_config_recv_auth_data( char * userInfo );
   */
 void mico_system_delegate_config_success( mico_config_source_t source );
 
+/** @} */
+/*****************************************************************************/
+/** \defgroup system_ready System Readiness Events
+  * @brief Wait for MiCO services and the network to be ready instead of polling them.
+  *        mico_system_init( ) starts the services that do not depend on each
+  *        other concurrently, and sets an event as each of them is ready. The
+  *        network events follow the MiCO notifications: link up, IP address,
+  *        DNS and time, and are cleared again when the station is down.
+  * @{
+  */
+/*****************************************************************************/
+
+/** @brief MICO system readiness events, an event stays set until it is cleared */
+typedef enum{
+  mico_ready_NOTIFICATION   = (1<<0),   /**< System notification handlers are registered */
+  mico_ready_MONITOR        = (1<<1),   /**< System monitor daemon is running */
+  mico_ready_CLI            = (1<<2),   /**< Command line interface is running */
+  mico_ready_NETWORK        = (1<<3),   /**< Wi-Fi driver and TCP/IP stack are initialized, sockets can be created */
+  mico_ready_WLAN_STARTED   = (1<<4),   /**< Wi-Fi connection or configuration mode is started */
+  mico_ready_DISCOVERY      = (1<<5),   /**< mDNS discovery service is running */
+  mico_ready_CONFIG_SERVER  = (1<<6),   /**< Local configuration server is running */
+  mico_ready_AIRKISS        = (1<<7),   /**< Airkiss LAN discovery is running */
+  mico_ready_SYSTEM         = (1<<8),   /**< Every service started by mico_system_init( ) is running, not set when one has failed */
+  mico_ready_STATION_UP     = (1<<16),  /**< Connected to the AP, cleared when the station is down */
+  mico_ready_IP             = (1<<17),  /**< Station has an IP address from DHCP or the static configuration */
+  mico_ready_DNS            = (1<<18),  /**< A DNS server has answered, host names can be resolved */
+  mico_ready_TIME           = (1<<19),  /**< RTC is synchronized by SNTP, stays set when the station is down */
+  mico_ready_USER           = (1<<24),  /**< First of the events left to the application: mico_ready_USER<<0 ... mico_ready_USER<<7 */
+} mico_ready_events_t;
+
+/**
+  * @brief  Set readiness events, and wake up the threads waiting for them.
+  * @param  events: Events to set, see mico_ready_events_t.
+  * @retval None
+  */
+void mico_system_ready_set( uint32_t events );
+
+/**
+  * @brief  Clear readiness events.
+  * @param  events: Events to clear, see mico_ready_events_t.
+  * @retval None
+  */
+void mico_system_ready_clear( uint32_t events );
+
+/**
+  * @brief  Get the readiness events that are set.
+  * @retval Events that are set, see mico_ready_events_t.
+  */
+uint32_t mico_system_ready_get( void );
+
+/**
+  * @brief  Wait until all of the readiness events are set.
+  * @param  events: Events to wait for, see mico_ready_events_t.
+  * @param  timeout_ms: Longest time to wait, or MICO_NEVER_TIMEOUT.
+  * @retval kNoErr is returned when all events are set, kTimeoutErr when timeout.
+  */
+OSStatus mico_system_ready_wait( uint32_t events, uint32_t timeout_ms );
+
+/** @brief When a readiness event was set, all times are mico_get_time( ) in ms */
+typedef struct _mico_ready_metrics_t
+{
+  uint32_t first_set;       /**< The first time the event was set, time to ready from boot */
+  uint32_t last_set;        /**< The last time the event was set */
+  uint32_t last_clear;      /**< The last time the event was cleared, 0 when it has never been cleared */
+  uint32_t set_count;       /**< Times the event has been set, e.g. reconnections for mico_ready_IP */
+} mico_ready_metrics_t;
+
+/**
+  * @brief  Get the time since a readiness event is set.
+  * @param  event: One event, see mico_ready_events_t.
+  * @retval ms since the event is set, 0 when it is not set.
+  */
+uint32_t mico_system_ready_since( mico_ready_events_t event );
+
+/**
+  * @brief  Get when a readiness event was set and cleared.
+  * @param  event: One event, see mico_ready_events_t.
+  * @param  metrics: Filled with the metrics of the event.
+  * @retval kNoErr is returned on success, kNotFoundErr when the event has never been set.
+  */
+OSStatus mico_system_ready_metrics( mico_ready_events_t event, mico_ready_metrics_t *metrics );
+
+/** @} */
+/*****************************************************************************/
+/** \defgroup system_boot_trace System Boot Trace
+  * @brief Record when every boot phase begins and ends, in a ring buffer of
+  *        MICO_BOOT_TRACE_RECORDS records. The trace is printed by the CLI
+  *        command "boottrace". mico_system_init( ) records its own phases.
+  * @{
+  */
+/*****************************************************************************/
+
+/**
+  * @brief  Record the beginning of a boot phase.
+  * @param  phase: Phase name, a string that is never freed.
+  * @retval None
+  */
+void mico_system_boot_trace_begin( const char *phase );
+
+/**
+  * @brief  Record the end of a boot phase.
+  * @param  phase: Phase name passed to mico_system_boot_trace_begin( ).
+  * @retval None
+  */
+void mico_system_boot_trace_end( const char *phase );
+
+/**
+  * @brief  Record a point in time, like the first message from a cloud service.
+  * @param  phase: Mark name, a string that is never freed.
+  * @retval None
+  */
+void mico_system_boot_trace_mark( const char *phase );
+
+/**
+  * @brief  Print the boot trace to the standard output.
+  * @retval None
+  */
+void mico_system_boot_trace_print( void );
+
+/** @} */
+/*****************************************************************************/
+/** \defgroup system_dns System DNS Resolver
+  * @brief Resolve host names through a cache of MICO_DNS_CACHE_ENTRIES names.
+  *        Addresses are kept as long as the DNS server's TTL allows, names
+  *        that do not exist are remembered too (negative caching), and the
+  *        least recently used name makes room for a new one. Lookups of a
+  *        name that is being resolved wait for the same query. The queries
+  *        are sent by one resolver thread to the station's DNS server.
+  * @{
+  */
+/*****************************************************************************/
+
+#define MICO_DNS_NAME_LEN   (64)    /**< Longest host name + 1 */
+
+/**
+  * @brief  Called once the lookup of a host name is done.
+  * @note   Runs in the resolver thread, or in the calling thread when the
+  *         answer is in the cache. It must not block.
+  * @param  hostname: Name that was looked up.
+  * @param  ip: Address in the same byte order as inet_addr( ), 0 on error.
+  * @param  err: kNoErr, kNotFoundErr when the name does not exist, or
+  *         kTimeoutErr when the DNS server has not answered.
+  * @param  arg: Argument passed to mico_system_dns_resolve_async( ).
+  */
+typedef void (*mico_dns_callback_t)( const char *hostname, uint32_t ip, OSStatus err, void *arg );
+
+/** @brief Last known address of a host name, kept in flash by the application */
+typedef struct _mico_dns_persist_t
+{
+  char      name[MICO_DNS_NAME_LEN];    /**< Host name, empty when unused */
+  uint32_t  ip;                         /**< Its last address */
+} mico_dns_persist_t;
+
+/**
+  * @brief  Resolve a host name, from the cache if possible.
+  * @param  hostname: Host name, or an IP address in dotted decimal notation.
+  * @param  ip: Filled with the address, in the same byte order as inet_addr( ).
+  * @param  timeout_ms: Longest time to wait for the DNS server, or MICO_NEVER_TIMEOUT.
+  * @retval kNoErr is returned on success, kNotFoundErr when the name does
+  *         not exist, kTimeoutErr when the DNS server has not answered.
+  */
+OSStatus mico_system_dns_resolve( const char *hostname, uint32_t *ip, uint32_t timeout_ms );
+
+/**
+  * @brief  Resolve a host name without waiting.
+  * @param  hostname: Host name, or an IP address in dotted decimal notation.
+  * @param  callback: Called with the result, NULL to only refresh the cache.
+  * @param  arg: Passed to the callback.
+  * @retval kNoErr is returned when the callback has been called or will be
+  *         called, otherwise the callback is never called.
+  */
+OSStatus mico_system_dns_resolve_async( const char *hostname, mico_dns_callback_t callback, void *arg );
+
+/**
+  * @brief  Get the last address a host name had, even when its TTL has run
+  *         out or it was loaded by mico_system_dns_persist( ) after a reboot.
+  *         A connection can be started with it while the name is resolved again.
+  * @param  hostname: Host name.
+  * @param  ip: Filled with the address, in the same byte order as inet_addr( ).
+  * @retval kNoErr is returned on success, kNotFoundErr when the name is unknown.
+  */
+OSStatus mico_system_dns_last_known( const char *hostname, uint32_t *ip );
+
+/**
+  * @brief  Keep the last known addresses of some host names in flash. The
+  *         application fills in the names, their addresses are loaded into
+  *         the cache, and written by mico_system_context_update( ) when a
+  *         lookup returns another address. Other names are not kept.
+  * @note   The entries must be in the application's configuration data, see
+  *         mico_system_context_get_user_data( ), and zeroed by
+  *         appRestoreDefault_callback( ).
+  * @param  entries: Entries in the application's configuration data.
+  * @param  count: Number of entries.
+  * @retval kNoErr is returned on success, otherwise, kXXXErr is returned.
+  */
+OSStatus mico_system_dns_persist( mico_dns_persist_t *entries, uint32_t count );
+
+/**
+  * @brief  Use another DNS server than the one the station got from DHCP.
+  * @param  ip: Server address in the same byte order as inet_addr( ), 0 for
+  *         the station's DNS server again.
+  * @param  port: Server port, 0 for the DNS port 53.
+  * @retval None
+  */
+void mico_system_dns_set_server( uint32_t ip, uint16_t port );
+
+/**
+  * @brief  Remove all addresses and negative answers from the cache.
+  * @retval None
+  */
+void mico_system_dns_flush( void );
+
+/** @} */
+/*****************************************************************************/
+/** \defgroup system_timer System Timer Service
+  * @brief Timers on a hierarchical timer wheel: a fine wheel of 64 ticks of
+  *        MICO_SYSTEM_TIMER_TICK ms (10 ms by default) and three coarse
+  *        wheels of 64 slots each, which reach about 46 hours. Starting,
+  *        restarting and stopping a timer takes the same time however many
+  *        timers are pending, so a timeout can be restarted on every packet
+  *        of thousands of connections. The timers are kept by their users,
+  *        nothing is allocated, and all handlers run in one service thread,
+  *        which is started by the first timer.
+  * @{
+  */
+/*****************************************************************************/
+
+/**
+  * @brief  Called when a timer expires, in the timer service thread.
+  * @note   It may start or stop any timer, but must not block: the handlers
+  *         of the other timers wait for it.
+  * @param  arg: Argument passed to mico_system_timer_init( ).
+  */
+typedef void (*mico_system_timer_handler_t)( void *arg );
+
+/** @brief A system timer, its fields are private to the timer service */
+typedef struct _mico_system_timer_t
+{
+  struct _mico_system_timer_t *   next;
+  struct _mico_system_timer_t **  pprev;      /**< NULL when the timer is not pending */
+  uint32_t                        expires;    /**< Tick */
+  uint32_t                        period;     /**< Ticks, 0 for a one-shot timer */
+  mico_system_timer_handler_t     handler;
+  void *                          arg;
+} mico_system_timer_t;
+
+/**
+  * @brief  Initialize a timer that is not pending, before it is started. A
+  *         zeroed timer may be stopped without being initialized.
+  * @param  timer: Timer, kept by the caller until it is stopped or has expired.
+  * @param  handler: Called when the timer expires.
+  * @param  arg: Passed to the handler.
+  * @retval None
+  */
+void mico_system_timer_init( mico_system_timer_t *timer, mico_system_timer_handler_t handler, void *arg );
+
+/**
+  * @brief  Start a timer, or restart it if it is pending.
+  * @param  timer: Timer initialized by mico_system_timer_init( ).
+  * @param  delay_ms: ms to the first expiry, the timer never expires earlier.
+  * @param  period_ms: ms between the following expiries, 0 for a one-shot timer.
+  * @retval kNoErr is returned on success, kRangeErr when the delay or the
+  *         period is beyond the last wheel, otherwise, kXXXErr is returned.
+  */
+OSStatus mico_system_timer_start( mico_system_timer_t *timer, uint32_t delay_ms, uint32_t period_ms );
+
+/**
+  * @brief  Stop a timer, nothing is done if it is not pending.
+  * @note   The handler may be running in the service thread when this
+  *         returns, unless it is called by a timer handler.
+  * @param  timer: Timer.
+  * @retval None
+  */
+void mico_system_timer_stop( mico_system_timer_t *timer );
+
+/**
+  * @brief  Check if a timer is started and has not expired yet.
+  * @param  timer: Timer.
+  * @retval true for a started one-shot timer or a periodic timer that has
+  *         not been stopped, otherwise false.
+  */
+bool mico_system_timer_pending( mico_system_timer_t *timer );
+
 /** @} */
 /*****************************************************************************/
 /** \defgroup system_monitor System Monitor Functions
@@ -475,7 +760,8 @@ typedef struct _mdns_init_t
 } mdns_init_t;
 
 /**
-  * @brief  Add a new mDNS record, a mDNS service daemon will be start if necessary
+  * @brief  Add a new mDNS record, a mDNS service daemon will be start if necessary.
+  *         The number of records is only limited by the free memory.
   * @param  record: mDNS record data.
   * @param  interface: Which network interface, the IP info will be read from when response a nDNS request.
   * @param  time_to_live: The TTL of a mDNS record.
@@ -510,6 +796,69 @@ void mdns_resume_record( char *service_name, WiFi_Interface interface );
   */
 void mdns_update_txt_record( char *service_name, WiFi_Interface interface, char *txt_record );
 
+/** @} */
+/*****************************************************************************/
+/** \defgroup ota_writer Firmware Image Writer
+  * @brief Store a firmware image into the OTA partition while it is received.
+  *        The partition is erased sector by sector just ahead of the data, and
+  *        a flash thread programs one buffer while the caller fills the other.
+  * @{
+  */
+/*****************************************************************************/
+
+typedef struct _mico_ota_writer_t mico_ota_writer_t;
+
+/**
+  * @brief  Start writing a new image to MICO_PARTITION_OTA_TEMP.
+  * @param  outWriter: Receives the writer.
+  * @param  length: Image length if known, otherwise 0. Nothing beyond it is erased.
+  * @retval kNoErr is returned on success, otherwise, kXXXErr is returned.
+  */
+OSStatus mico_ota_writer_start( mico_ota_writer_t **outWriter, uint32_t length );
+
+/**
+  * @brief  Append data to the image. Only blocks while both buffers wait for flash.
+  * @param  writer: The writer from mico_ota_writer_start( ).
+  * @param  data: Image data.
+  * @param  len: Length of data.
+  * @retval kNoErr is returned on success, otherwise, kXXXErr is returned, also
+  *         if programming an earlier chunk has failed.
+  */
+OSStatus mico_ota_writer_write( mico_ota_writer_t *writer, const uint8_t *data, uint32_t len );
+
+/**
+  * @brief  Check if a write of up to OTA_WRITER_BUFFER_SIZE (2 KB) bytes would return
+  *         without waiting for flash, for a receiver that serves other sockets as well.
+  * @param  writer: The writer from mico_ota_writer_start( ).
+  * @retval true if mico_ota_writer_write( ) does not block, also if it fails at once.
+  */
+bool mico_ota_writer_ready( mico_ota_writer_t *writer );
+
+/**
+  * @brief  Wait until every byte is programmed, and release the writer.
+  * @param  inWriter: The writer, set to NULL.
+  * @param  outLength: Receives the image length, can be NULL.
+  * @param  outCrc: Receives the CRC16 of the image, can be NULL.
+  * @retval kNoErr is returned on success, otherwise, kXXXErr is returned.
+  */
+OSStatus mico_ota_writer_finish( mico_ota_writer_t **inWriter, uint32_t *outLength, uint16_t *outCrc );
+
+/**
+  * @brief  Drop the rest of the image and release the writer.
+  * @param  inWriter: The writer, set to NULL. Nothing is done if it is NULL.
+  * @retval None.
+  */
+void mico_ota_writer_abort( mico_ota_writer_t **inWriter );
+
+/**
+  * @brief  Write the boot table, so the bootloader installs the image in the
+  *         OTA partition on the next reboot.
+  * @param  length: Image length.
+  * @param  crc: CRC16 of the image.
+  * @retval kNoErr is returned on success, otherwise, kXXXErr is returned.
+  */
+OSStatus mico_ota_switch_to_new_fw( uint32_t length, uint16_t crc );
+
 /** @} */
 /*****************************************************************************/
 /** \defgroup tftp_ota Firmware Update From a TFTP Server
@@ -320,8 +320,9 @@ static int __httpd_parse_hdr_tags(char *data_p, int len,
     httpd_parse_useragent(data_p + sizeof(http_user_agent) + 1,
                           &req_p->agent);
   } else if (strncasecmp(data_p, http_content_type, sizeof(http_content_type) - 1) == 0) {
-    memcpy(req_p->content_type, data_p + strlen(http_content_type),
-           strlen(data_p));
+    strncpy(req_p->content_type, data_p + strlen(http_content_type),
+            HTTPD_MAX_CONTENT_TYPE_LENGTH - 1);
+    req_p->content_type[HTTPD_MAX_CONTENT_TYPE_LENGTH - 1] = 0;
   } else if (strncasecmp(data_p, "If-None-Match", sizeof("If-None-Match") - 1) == 0) {
     /*
     * We use the FTFS CRC to generate ETag. Hence, the ETag we
@@ -345,21 +346,23 @@ static int __httpd_parse_hdr_tags(char *data_p, int len,
 }
 
 /* One-by-one read lines terminated by CR-LF from the socket, and
-* parse the headers contained in them. */
+* parse the headers contained in them. Lines are parsed in place in the
+* connection receive buffer, the scratch buffer is no longer needed. */
 int httpd_parse_hdr_tags(httpd_request_t *req, int sock, char *buffer, int len)
 {
   int req_line_len;
   int err;
   uint8_t done = 0;
+  char *line;
   
   while (TRUE) {
-    req_line_len = htsys_getln_soc(sock, buffer, len);
+    req_line_len = htsys_getln(sock, &line);
     if (req_line_len == -kInProgressErr) {
       httpd_d("Could not read line from socket");
       return -kInProgressErr;
     }
     
-    err = __httpd_parse_hdr_tags(buffer, req_line_len, req, &done);
+    err = __httpd_parse_hdr_tags(line, req_line_len, req, &done);
     if (err != kNoErr)
       return err;
     if (done == 1) {
@@ -58,9 +58,30 @@ static mico_thread_t httpd_main_thread;
 */
 static bool httpd_stop_req;
 
+/* A client connection idle for this long, in seconds, is closed */
 #define HTTPD_CLIENT_SOCK_TIMEOUT 10
 #define HTTPD_TIMEOUT_EVENT 0
 
+/** Client connection states
+*
+*  Requests are only handed to the handlers once their whole header is in the
+*  receive buffer, so a slow client never holds up the others while its
+*  header trickles in. The handler then reads the body and sends the response
+*  itself, after which a kept-alive connection goes back to reading headers.
+*/
+typedef enum {
+  HTTPD_CONN_FREE = 0,
+  HTTPD_CONN_READING_HDR,
+  HTTPD_CONN_HANDLING,
+} httpd_conn_state_t;
+
+typedef struct {
+  int sock;
+  httpd_conn_state_t state;
+  /* Time of the last activity, for the idle timeout */
+  uint32_t last_active;
+} httpd_conn_t;
+
 /** Maximum number of backlogged http connections
 *
 *  httpd has a single listening socket from which it accepts connections.
@@ -84,7 +105,7 @@ static bool httpd_stop_req;
 
 static int http_sockfd;
 
-int client_sockfd;
+static httpd_conn_t httpd_conns[HTTPD_MAX_CLIENT_CONN];
 static bool https_active;
 
 bool httpd_is_https_active()
@@ -99,7 +120,7 @@ static int net_get_sock_error( int sock)
 
 static int httpd_close_sockets()
 {
-  int ret, status = kNoErr;
+  int i, ret, status = kNoErr;
   
   if (http_sockfd != -1) {
     ret = close(http_sockfd);
@@ -110,13 +131,17 @@ static int httpd_close_sockets()
   http_sockfd = -1;
   }
   
-  if (client_sockfd != -1) {
-    ret = close(client_sockfd);
+  for (i = 0; i < HTTPD_MAX_CLIENT_CONN; i++) {
+    if (httpd_conns[i].state == HTTPD_CONN_FREE)
+      continue;
+    htsys_recv_buf_detach(httpd_conns[i].sock);
+    ret = close(httpd_conns[i].sock);
     if (ret != 0) {
-      httpd_d("Failed to close client socket: %d", net_get_sock_error(client_sockfd));
+      httpd_d("Failed to close client socket: %d", net_get_sock_error(httpd_conns[i].sock));
       status = -kInProgressErr;
     }
-    client_sockfd = -1;
+    httpd_conns[i].sock = -1;
+    httpd_conns[i].state = HTTPD_CONN_FREE;
   }
   
   return status;
@@ -184,23 +209,24 @@ static int httpd_setup_main_sockets()
 }
 
 static int httpd_select(int max_sock, const fd_set *readfds,
-                        fd_set *active_readfds, int timeout_secs)
+                        fd_set *active_readfds, int timeout_ms)
 {
   int activefds_cnt;
   struct timeval_t timeout;
   
   fd_set local_readfds;
   
-  if (timeout_secs >= 0)
-    timeout.tv_sec = timeout_secs;
-  timeout.tv_usec = 0;
+  if (timeout_ms >= 0) {
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_usec = (timeout_ms % 1000) * 1000;
+  }
   
   memcpy(&local_readfds, readfds, sizeof(fd_set));
   httpd_d("WAITING for activity");
   
-  activefds_cnt = select(1, &local_readfds, NULL, NULL, timeout_secs >= 0 ? &timeout : NULL);
+  activefds_cnt = select(max_sock + 1, &local_readfds, NULL, NULL, timeout_ms >= 0 ? &timeout : NULL);
   if (activefds_cnt < 0) {
-    httpd_d("Select failed: %d", timeout_secs);
+    httpd_d("Select failed: %d", timeout_ms);
     httpd_suspend_thread(true);
   }
   
@@ -222,17 +248,49 @@ static int httpd_select(int max_sock, const fd_set *readfds,
   return HTTPD_TIMEOUT_EVENT;
 }
 
-static int  httpd_accept_client_socket(const fd_set *active_readfds)
+static httpd_conn_t *httpd_get_free_conn(void)
+{
+  int i;
+  
+  for (i = 0; i < HTTPD_MAX_CLIENT_CONN; i++) {
+    if (httpd_conns[i].state == HTTPD_CONN_FREE)
+      return &httpd_conns[i];
+  }
+  return NULL;
+}
+
+static void httpd_close_conn(httpd_conn_t *conn)
+{
+  int status;
+  
+  htsys_recv_buf_detach(conn->sock);
+  status = close(conn->sock);
+  if (status != kNoErr) {
+    status = net_get_sock_error(conn->sock);
+    httpd_d("Failed to close socket %d", status);
+    httpd_suspend_thread(true);
+  }
+  conn->sock = -1;
+  conn->state = HTTPD_CONN_FREE;
+}
+
+static int httpd_accept_client_socket(const fd_set *active_readfds)
 {
   int main_sockfd = -1;
+  int client_sockfd;
   struct sockaddr_t addr_from;
   int addr_from_len;
+  httpd_conn_t *conn;
   
   if (FD_ISSET(http_sockfd, active_readfds)) {
     main_sockfd = http_sockfd;
     https_active  = FALSE;
   }
   
+  conn = httpd_get_free_conn();
+  if (main_sockfd < 0 || conn == NULL)
+    return -kInProgressErr;
+  
   addr_from_len = sizeof(addr_from);
   
   client_sockfd = accept(main_sockfd, &addr_from, &addr_from_len);
@@ -279,15 +337,46 @@ static int  httpd_accept_client_socket(const fd_set *active_readfds)
     httpd_d("Unsupported option TCP_KEEPINTVL: %d", net_get_sock_error(client_sockfd));
   }
   
+  if (htsys_recv_buf_attach(client_sockfd) != kNoErr) {
+    close(client_sockfd);
+    return -kInProgressErr;
+  }
+  
   httpd_d("connecting %d to %d.", client_sockfd, addr_from.s_port);
   
+  conn->sock = client_sockfd;
+  conn->state = HTTPD_CONN_READING_HDR;
+  conn->last_active = mico_get_time();
   return kNoErr;
 }
 
-static void httpd_handle_client_connection(const fd_set *active_readfds)
+/* Pull whatever arrived on a readable client socket into its receive buffer */
+static void httpd_read_client_connection(httpd_conn_t *conn)
+{
+  int len;
+  
+  len = htsys_recv_buf_fill(conn->sock);
+  if (len == kNoSpaceErr) {
+    /* Header larger than the buffer, the handler takes it from here */
+    return;
+  }
+  
+  if (len <= 0) {
+    httpd_d("Close socket %d.  %s: %d", conn->sock, len == 0 ? "Peer closed" : "Read failed", len);
+    httpd_close_conn(conn);
+    return;
+  }
+  
+  conn->last_active = mico_get_time();
+}
+
+static void httpd_handle_client_connection(httpd_conn_t *conn)
 {
-  int activefds_cnt, status;
-  fd_set readfds;
+  int status;
+  
+  httpd_d("Handling %d", conn->sock);
+  conn->state = HTTPD_CONN_HANDLING;
+  status = httpd_handle_message(conn->sock);
   
   if (httpd_stop_req) {
     httpd_d("HTTPD stop request received");
@@ -295,97 +384,87 @@ static void httpd_handle_client_connection(const fd_set *active_readfds)
     httpd_suspend_thread(false);
   }
   
-  status = httpd_accept_client_socket(active_readfds);
-  if (status != kNoErr)
+  if (status == kNoErr) {
+    /* Keep-alive, wait for the next request on this connection */
+    conn->state = HTTPD_CONN_READING_HDR;
+    conn->last_active = mico_get_time();
     return;
+  }
+  
+  /* Either there was some error or the client asked to close */
+  httpd_d("Close socket %d.  %s: %d", conn->sock, status == HTTPD_DONE ? "Handler done" : "Handler failed", status);
+  httpd_close_conn(conn);
+}
+
+static void httpd_main(void *arg)
+{
+  int i, status, max_sockfd, timeout_ms, idle_ms;
+  fd_set readfds, active_readfds;
+  uint32_t now;
+  httpd_conn_t *conn;
   
-  httpd_d("Client socket accepted: %d", client_sockfd);
-  FD_ZERO(&readfds);
-  FD_SET(client_sockfd, &readfds);
+  status = httpd_setup_main_sockets();
+  if (status != kNoErr)
+    httpd_suspend_thread(true);
   
   while (1) {
-    if (httpd_stop_req) {
-      httpd_d("HTTPD stop request received");
-      httpd_stop_req = FALSE;
-      httpd_suspend_thread(false);
+    /* Serve every connection that has a complete request buffered,
+    * including pipelined requests left over from the last round */
+    for (i = 0; i < HTTPD_MAX_CLIENT_CONN; i++) {
+      conn = &httpd_conns[i];
+      if (conn->state == HTTPD_CONN_READING_HDR && htsys_recv_buf_hdr_ready(conn->sock))
+        httpd_handle_client_connection(conn);
     }
     
-    httpd_d("Waiting on client socket");
-    activefds_cnt = httpd_select(client_sockfd, &readfds, NULL, HTTPD_CLIENT_SOCK_TIMEOUT);
-    
-    if (httpd_stop_req) {
-      httpd_d("HTTPD stop request received");
-      httpd_stop_req = FALSE;
-      httpd_suspend_thread(false);
-    }
-    
-    if (activefds_cnt == HTTPD_TIMEOUT_EVENT) {
-      /* Timeout has occured */
-      httpd_d("Client socket timeout occurred. " "Force closing socket");
-
-      status = close(client_sockfd);
-      if (status != kNoErr) {
-        status = net_get_sock_error(client_sockfd);
-        httpd_d("Failed to close socket %d", status);
-        httpd_suspend_thread(true);
+    /* Close idle connections and find out how long we may wait */
+    FD_ZERO(&readfds);
+    max_sockfd = -1;
+    timeout_ms = -1;
+    now = mico_get_time();
+    for (i = 0; i < HTTPD_MAX_CLIENT_CONN; i++) {
+      conn = &httpd_conns[i];
+      if (conn->state == HTTPD_CONN_FREE)
+        continue;
+      
+      idle_ms = now - conn->last_active;
+      if (idle_ms >= HTTPD_CLIENT_SOCK_TIMEOUT * 1000) {
+        httpd_d("Client socket timeout occurred. " "Force closing socket");
+        httpd_close_conn(conn);
+        continue;
       }
       
-      client_sockfd = -1;
-      break;
+      if (htsys_recv_buf_hdr_ready(conn->sock)) {
+        timeout_ms = 0;
+      } else if (timeout_ms != 0 &&
+                 (timeout_ms < 0 || HTTPD_CLIENT_SOCK_TIMEOUT * 1000 - idle_ms < timeout_ms)) {
+        timeout_ms = HTTPD_CLIENT_SOCK_TIMEOUT * 1000 - idle_ms;
+      }
+      
+      FD_SET(conn->sock, &readfds);
+      max_sockfd = Max(max_sockfd, conn->sock);
     }
     
-    httpd_d("Handling %d", client_sockfd);
-    /* Note:
-    * Connection will be handled with call to
-    * httpd_handle_message twice, first for
-    * handling request (kNoErr) and second
-    * time as there is no more data to receive
-    * (client closed connection) and hence
-    * will return with status HTTPD_DONE
-    * closing socket.
-    */
-    /* FIXME: remove this memset if all is working well */
-    /* memset(&httpd_message_in[0], 0, sizeof(httpd_message_in)); */
-    status = httpd_handle_message(client_sockfd);
-    if (status == kNoErr) {
-      /* The handlers are expected more data on the
-      socket */
-      continue;
+    /* Leave new connections in the backlog while all slots are taken */
+    if (httpd_get_free_conn()) {
+      FD_SET(http_sockfd, &readfds);
+      max_sockfd = Max(max_sockfd, http_sockfd);
     }
     
-    /* Either there was some error or everything went well */
-    httpd_d("Close socket %d.  %s: %d", client_sockfd, status == HTTPD_DONE ? "Handler done" : "Handler failed", status);
+    httpd_d("Waiting on sockets");
+    if (httpd_select(max_sockfd, &readfds, &active_readfds, timeout_ms) == HTTPD_TIMEOUT_EVENT)
+      continue;
     
-    status = close(client_sockfd);
-    if (status != kNoErr) {
-      status = net_get_sock_error(client_sockfd);
-      httpd_d("Failed to close socket %d", status);
-      httpd_suspend_thread(true);
+    for (i = 0; i < HTTPD_MAX_CLIENT_CONN; i++) {
+      conn = &httpd_conns[i];
+      if (conn->state != HTTPD_CONN_FREE && FD_ISSET(conn->sock, &active_readfds))
+        httpd_read_client_connection(conn);
     }
-    client_sockfd = -1;
     
-    break;
-  }
-}
-
-static void httpd_main(void *arg)
-{
-  int status, max_sockfd = -1;
-  fd_set readfds, active_readfds;
-  
-  status = httpd_setup_main_sockets();
-  if (status != kNoErr)
-    httpd_suspend_thread(true);
-  
-  FD_ZERO(&readfds);
-  
-  FD_SET(http_sockfd, &readfds);
-  max_sockfd = http_sockfd;
-  
-  while (1) {
-    httpd_d("Waiting on main socket");
-    httpd_select(max_sockfd, &readfds, &active_readfds, -1);
-    httpd_handle_client_connection(&active_readfds);
+    if (FD_ISSET(http_sockfd, &readfds) && FD_ISSET(http_sockfd, &active_readfds)) {
+      status = httpd_accept_client_socket(&active_readfds);
+      if (status == kNoErr)
+        httpd_d("Client socket accepted");
+    }
   }
   
   /*
@@ -553,14 +632,16 @@ int httpd_shutdown(void)
 /* This pairs with httpd_shutdown() */
 int httpd_init()
 {
-  int status;
+  int i, status;
   
   if (httpd_state != HTTPD_INACTIVE)
     return kNoErr;
   
   httpd_d("Initializing");
   
-  client_sockfd = -1;
+  memset(httpd_conns, 0, sizeof(httpd_conns));
+  for (i = 0; i < HTTPD_MAX_CLIENT_CONN; i++)
+    httpd_conns[i].sock = -1;
   http_sockfd  = -1;
   
   status = httpd_wsgi_init();
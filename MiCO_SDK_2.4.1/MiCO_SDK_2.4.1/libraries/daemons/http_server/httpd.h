@@ -1113,8 +1113,9 @@ int httpd_purge_headers(int sock);
  *
  *  \param[in] req The incoming HTTP request \ref httpd_request_t
  *  \param[in] sock The socket of the incoming HTTP request
- *  \param[in] scratch Buffer used to read the HTTP headers
- *  \param[in] len Length of the scratch buffer
+ *  \param[in] scratch Unused, headers are parsed in place in the connection
+ *  receive buffer. Kept for compatibility, may be NULL.
+ *  \param[in] len Unused
  *
  *  \return WM_SUCCESS if successful
  *  \return -WM_FAIL otherwise
@@ -129,9 +129,17 @@ int httpd_send_chunk(int conn, const char *buf, int len)
 	return err;
 }
 
-/*Helper function to send a buffer over a connection.
+/* Response bytes not sent yet. A handler writes its response in many small
+ * pieces. On a kept connection each piece in its own segment would wait for
+ * the delayed ACK of the client under Nagle's algorithm, so they are sent
+ * when the buffer is full, before the socket is read and when the request
+ * is done. httpd serves one request at a time, one buffer is enough.
  */
-int httpd_send(int conn, const char *buf, int len)
+static char httpd_send_buf[HTTPD_SEND_BUF_SIZE];
+static int httpd_send_buf_len;
+static int httpd_send_buf_sock = -1;
+
+static int httpd_sock_send(int conn, const char *buf, int len)
 {
 	int num;
 	do {
@@ -153,8 +161,55 @@ int httpd_send(int conn, const char *buf, int len)
 	return kNoErr;
 }
 
-int httpd_recv(int fd, void *buf, size_t n, int flags)
+/* Send what httpd_send() has buffered. The buffer is emptied even if the
+ * connection failed, its data can not go anywhere else.
+ */
+int httpd_send_flush(void)
+{
+	int len = httpd_send_buf_len;
+
+	if (len == 0)
+		return kNoErr;
+	httpd_send_buf_len = 0;
+	return httpd_sock_send(httpd_send_buf_sock, httpd_send_buf, len);
+}
+
+/*Helper function to send a buffer over a connection.
+ */
+int httpd_send(int conn, const char *buf, int len)
+{
+	int err, num;
+
+	if (conn != httpd_send_buf_sock) {
+		err = httpd_send_flush();
+		if (err != kNoErr)
+			return err;
+		httpd_send_buf_sock = conn;
+	}
+
+	/* Full buffers go out as full segments, which Nagle never holds */
+	while (len > 0) {
+		num = Min(len, HTTPD_SEND_BUF_SIZE - httpd_send_buf_len);
+		memcpy(httpd_send_buf + httpd_send_buf_len, buf, num);
+		httpd_send_buf_len += num;
+		len -= num;
+		buf += num;
+		if (httpd_send_buf_len == HTTPD_SEND_BUF_SIZE) {
+			err = httpd_send_flush();
+			if (err != kNoErr)
+				return err;
+		}
+	}
+
+	return kNoErr;
+}
+
+int httpd_sock_recv(int fd, void *buf, size_t n, int flags)
 {
+	/* The client may wait for the response before it sends more */
+	if (httpd_send_flush() != kNoErr)
+		return -kInProgressErr;
+
 #ifdef CONFIG_ENABLE_HTTPS
 	if (httpd_is_https_active())
 		return tls_recv(httpd_tls_handle, buf, n);
@@ -163,6 +218,17 @@ int httpd_recv(int fd, void *buf, size_t n, int flags)
 		return recv(fd, buf, n, flags);
 }
 
+/* Bytes already pulled into the receive buffer by the header reader come
+ * first, the socket is only read once they are consumed. */
+int httpd_recv(int fd, void *buf, size_t n, int flags)
+{
+	int len = htsys_recv(fd, buf, n);
+
+	if (len > 0)
+		return len;
+	return httpd_sock_recv(fd, buf, n, flags);
+}
+
 int httpd_send_hdr_from_code(int sock, int stat_code,
 			     enum http_content_type content_type)
 {
@@ -289,41 +355,93 @@ int httpd_send_error(int conn, int http_error)
 /*
  * @pre Only first line of HTTP header (which has the resource name) has
  * been read from the socket. We need to read the remaining header and the
- * data after that.
+ * data after that. A chunked body is not decoded, so it is left unread.
+ * req->remaining_bytes tells how much of the body could not be read.
  */
 void httpd_purge_socket_data(httpd_request_t *req, char *msg_in,
 			     int msg_in_len, int conn)
 {
-	int status = httpd_parse_hdr_tags(req, conn, msg_in, msg_in_len);
-	if (status != kNoErr) {
-		/* We were unsuccessful in purging the socket.*/
-		httpd_d("Unable to purge socket: %d", status);
-		return;
+	int status, actually_read;
+	unsigned to_read;
+
+	if (!req->hdr_parsed) {
+		status = httpd_parse_hdr_tags(req, conn, NULL, 0);
+		if (status != kNoErr) {
+			/* We were unsuccessful in purging the socket.*/
+			httpd_d("Unable to purge socket: %d", status);
+			return;
+		}
+		req->hdr_parsed = 1;
 	}
 
-	unsigned data_remaining = req->body_nbytes;
-
-	while (data_remaining) {
-		unsigned to_read = msg_in_len >= data_remaining ?
-			data_remaining : msg_in_len;
-		int actually_read = httpd_recv(conn, msg_in, to_read, 0);
-		if (actually_read < 0) {
+	while (req->remaining_bytes > 0) {
+		to_read = msg_in_len >= req->remaining_bytes ?
+			req->remaining_bytes : msg_in_len;
+		actually_read = httpd_recv(conn, msg_in, to_read, 0);
+		if (actually_read <= 0) {
+			/* Error or connection closed by the client */
 			httpd_d("Unable to read content."
 				"Was purging socket data");
 			return;
 		}
-		data_remaining -= actually_read;
+		req->remaining_bytes -= actually_read;
 	}
 }
 
-/* Handle an incoming message (request) from the client. This is the
- * main processing function of the HTTPD.
- */
-int httpd_handle_message(int conn)
+/* The next request on the connection starts after the body of this one,
+ * so it can only be read once that body has been read in full. */
+static bool httpd_body_consumed(const httpd_request_t *req, bool has_body)
+{
+	return !has_body || (req->hdr_parsed && !req->chunked &&
+			     req->remaining_bytes == 0);
+}
+
+/* Decide from the request line and the header block still waiting in the
+ * receive buffer whether the client wants the connection kept open.
+ * HTTP/1.1 connections are persistent unless "Connection: close" is given,
+ * HTTP/1.0 ones only with "Connection: keep-alive". A request carrying a body
+ * is noted in body_p, as the handler might not read all of it. */
+static bool httpd_req_keep_alive(int conn, const char *req_line, bool *body_p)
+{
+	bool keep_alive = (strstr(req_line, "HTTP/1.0") == NULL);
+	const char *line, *val;
+	int len;
+
+	*body_p = FALSE;
+	line = htsys_recv_buf_peek(conn, &len);
+	while (line && *line != ISO_cr && *line != ISO_nl && *line != 0) {
+		if (strncasecmp(line, http_content_len,
+				sizeof(http_content_len) - 1) == 0) {
+			if (atol(line + sizeof(http_content_len) - 1) > 0)
+				*body_p = TRUE;
+		} else if (strncasecmp(line, "Connection:", 11) == 0) {
+			val = line + 11;
+			while (*val == ' ')
+				val++;
+			if (strncasecmp(val, "close", 5) == 0)
+				keep_alive = FALSE;
+			else if (strncasecmp(val, "keep-alive", 10) == 0)
+				keep_alive = TRUE;
+		} else if (strncasecmp(line, http_encoding,
+				       sizeof(http_encoding) - 1) == 0) {
+			*body_p = TRUE;
+		}
+
+		line = strchr(line, ISO_nl);
+		if (line)
+			line++;
+	}
+
+	return keep_alive;
+}
+
+static int httpd_handle_request(int conn)
 {
 	int err;
 	int req_line_len;
-	char msg_in[128];
+	char *msg_in;
+	char scratch[128];
+	bool keep_alive, has_body;
 
 	/* clear out the httpd_req structure */
 	memset(&httpd_req, 0x00, sizeof(httpd_req));
@@ -331,7 +449,7 @@ int httpd_handle_message(int conn)
 	httpd_req.sock = conn;
 
 	/* Read the first line of the HTTP header */
-	req_line_len = htsys_getln_soc(conn, msg_in, sizeof(msg_in));
+	req_line_len = htsys_getln(conn, &msg_in);
 	if (req_line_len == 0)
 		return HTTPD_DONE;
 
@@ -340,14 +458,20 @@ int httpd_handle_message(int conn)
 		return -kInProgressErr;
 	}
 
+	keep_alive = httpd_req_keep_alive(conn, msg_in, &has_body);
+
 	/* Parse the first line of the header */
 	err = httpd_parse_hdr_main(msg_in, &httpd_req);
-	if (err == -WM_E_HTTPD_NOTSUPP)
+	/* The rest of a request that failed to parse is not read, so the
+	 * connection can not be used any further after the error reply */
+	if (err == -WM_E_HTTPD_NOTSUPP) {
 		/* Send 505 HTTP Version not supported */
-		return httpd_send_error(conn, HTTP_505);
-	else if (err != kNoErr) {
+		httpd_send_error(conn, HTTP_505);
+		return HTTPD_DONE;
+	} else if (err != kNoErr) {
 		/* Send 500 Internal Server Error */
-		return httpd_send_error(conn, HTTP_500);
+		httpd_send_error(conn, HTTP_500);
+		return HTTPD_DONE;
 	}
 
 	/* set a generic error that can be overridden by the wsgi handling. */
@@ -366,7 +490,15 @@ int httpd_handle_message(int conn)
 
 	if (err == HTTPD_DONE) {
 		httpd_d("Done processing request.");
-		return kNoErr;
+		/* Only reuse the connection if the response did not announce
+		 * a close and the body is known to be consumed, otherwise the
+		 * rest of it would be taken for the next request. */
+		if (httpd_req.wsgi &&
+		    (httpd_req.wsgi->hdr_fields & HTTPD_HDR_ADD_CONN_CLOSE))
+			keep_alive = FALSE;
+		if (!httpd_body_consumed(&httpd_req, has_body))
+			keep_alive = FALSE;
+		return keep_alive ? kNoErr : HTTPD_DONE;
 	} else if (err == -WM_E_HTTPD_NO_HANDLER) {
 		httpd_d("No handler for the given URL %s was found",
 			httpd_req.filename);
@@ -375,18 +507,40 @@ int httpd_handle_message(int conn)
 		 * request, from the socket. We are in an error state and
 		 * we wish to cancel this HTTP transaction. We sent
 		 * appropriate message to the client and read (flush) out
-		 * all the pending data in the socket. We let the client
-		 * close the socket for us, if necessary.
+		 * all the pending data in the socket. If that fails, or the
+		 * body is chunked, the connection is closed after the reply.
 		 */
-		httpd_purge_socket_data(&httpd_req, msg_in,
-				sizeof(msg_in), conn);
+		httpd_purge_socket_data(&httpd_req, scratch,
+				sizeof(scratch), conn);
+		if (!httpd_req.hdr_parsed ||
+		    !httpd_body_consumed(&httpd_req, has_body))
+			keep_alive = FALSE;
 		httpd_set_error("File %s not_found", httpd_req.filename);
-		httpd_send_error(conn, HTTP_404);
-		return kNoErr;
+		err = httpd_send_error(conn, HTTP_404);
+		if (err != kNoErr)
+			return err;
+		return keep_alive ? kNoErr : HTTPD_DONE;
 	} else {
 		httpd_d("WSGI handler failed.");
 		/* Send 500 Internal Server Error */
-		return httpd_send_error(conn, HTTP_500);
+		httpd_send_error(conn, HTTP_500);
+		return HTTPD_DONE;
 	}
 
 }
+
+/* Handle an incoming message (request) from the client. This is the
+ * main processing function of the HTTPD.
+ *
+ * Returns kNoErr when the connection can be kept open for the next request,
+ * HTTPD_DONE when it has to be closed.
+ */
+int httpd_handle_message(int conn)
+{
+	int status = httpd_handle_request(conn);
+
+	/* The end of the response is still in the buffer */
+	if (httpd_send_flush() != kNoErr && status == kNoErr)
+		return -kInProgressErr;
+	return status;
+}
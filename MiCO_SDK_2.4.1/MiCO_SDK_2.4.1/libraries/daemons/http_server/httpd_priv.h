@@ -80,6 +80,44 @@ httpd_ssifunction httpd_ssi(char *);
 int httpd_ssi_init(void);
 int htsys_getln_soc(int sd, char *data_p, int buflen);
 
+/* Number of client connections served at the same time. Further connections
+ * wait in the listen backlog until one of them is closed. */
+#ifndef HTTPD_MAX_CLIENT_CONN
+#define HTTPD_MAX_CLIENT_CONN 4
+#endif
+
+/* Size of the per-connection receive buffer, one TCP segment by default.
+ * It also bounds the longest header line that is parsed without truncation. */
+#ifndef HTTPD_RECV_BUF_SIZE
+#define HTTPD_RECV_BUF_SIZE 1460
+#endif
+
+/* Request bytes received but not consumed yet, data[start..end) is pending */
+typedef struct {
+	int sock;
+	int start;
+	int end;
+	bool skip_line;
+	char data[HTTPD_RECV_BUF_SIZE + 1];
+} httpd_recv_buf_t;
+
+/* Size of the response buffer. Small writes of a handler are collected into
+ * one segment, see httpd_send(). */
+#ifndef HTTPD_SEND_BUF_SIZE
+#define HTTPD_SEND_BUF_SIZE HTTPD_RECV_BUF_SIZE
+#endif
+
+int htsys_recv_buf_attach(int sd);
+void htsys_recv_buf_detach(int sd);
+int htsys_recv_buf_pending(int sd);
+char *htsys_recv_buf_peek(int sd, int *len);
+int htsys_recv_buf_fill(int sd);
+bool htsys_recv_buf_hdr_ready(int sd);
+int htsys_getln(int sd, char **line_p);
+int htsys_recv(int sd, void *buf, size_t n);
+int httpd_sock_recv(int sd, void *buf, size_t n, int flags);
+int httpd_send_flush(void);
+
 void httpd_parse_useragent(char *hdrline, httpd_useragent_t *agent);
 
 int httpd_send_last_chunk(int conn);
@@ -48,7 +48,50 @@
 #include "httpd_priv.h"
 
 static int ssi_ready;
-static struct httpd_ssi_call *calls[MAX_REGISTERED_SSIS];
+
+/* Registered handlers are kept in an open addressing hash table keyed on the
+ * function name, twice the size of the maximum number of handlers so that
+ * probe sequences stay short. Must be a power of two. */
+#define SSI_HASH_SIZE (MAX_REGISTERED_SSIS * 2)
+
+static struct httpd_ssi_call *calls[SSI_HASH_SIZE];
+static int calls_no;
+
+/* Length of the function name at the start of a script directive, which is
+ * followed by the optional argument */
+static int httpd_ssi_name_len(const char *name)
+{
+	int len = 0;
+
+	while (name[len] && name[len] != ISO_space && name[len] != ISO_tab &&
+	       name[len] != ISO_cr && name[len] != ISO_nl)
+		len++;
+	return len;
+}
+
+static unsigned int httpd_ssi_hash(const char *name, int len)
+{
+	unsigned int hash = 5381;
+
+	while (len--)
+		hash = hash * 33 + (unsigned char)*name++;
+	return hash & (SSI_HASH_SIZE - 1);
+}
+
+/* Slot holding the handler called name[0..len), or the free slot where it
+ * would go */
+static int httpd_ssi_slot(const char *name, int len)
+{
+	int i = httpd_ssi_hash(name, len);
+
+	while (calls[i]) {
+		if (strncmp(calls[i]->name, name, len) == 0 &&
+		    calls[i]->name[len] == 0)
+			break;
+		i = (i + 1) & (SSI_HASH_SIZE - 1);
+	}
+	return i;
+}
 
 /* Register an SSI handler */
 int httpd_register_ssi(struct httpd_ssi_call *ssi_call)
@@ -59,25 +102,16 @@ int httpd_register_ssi(struct httpd_ssi_call *ssi_call)
 		return -kInProgressErr;
 
 	/* Verify that the ssi is not already registered */
-	for (i = 0; i < MAX_REGISTERED_SSIS; i++) {
-		if (!calls[i]) {
-			continue;
-		}
-		if (strncmp(calls[i]->name, ssi_call->name,
-			    strlen(calls[i]->name)) == 0) {
-			return -kInProgressErr;
-		}
-	}
-
-	/* Find an unoccupied slot in the table */
-	for (i = 0; i < MAX_REGISTERED_SSIS && calls[i]; i++)
-			;
+	i = httpd_ssi_slot(ssi_call->name, strlen(ssi_call->name));
+	if (calls[i])
+		return -kInProgressErr;
 
 	/* Check that we're not overrunning the table */
-	if (i == MAX_REGISTERED_SSIS)
+	if (calls_no == MAX_REGISTERED_SSIS)
 		return -WM_E_HTTPD_SSI_MAX;
 
 	calls[i] = ssi_call;
+	calls_no++;
 	httpd_d("Register ssi %s at %d", ssi_call->name, i);
 
 	return kNoErr;
@@ -86,24 +120,28 @@ int httpd_register_ssi(struct httpd_ssi_call *ssi_call)
 /* Unregister an SSI handler */
 void httpd_unregister_ssi(struct httpd_ssi_call *ssi_call)
 {
+	struct httpd_ssi_call *moved;
 	int i;
 
 	if (!ssi_ready)
 		return;
 
-	for (i = 0; i < MAX_REGISTERED_SSIS; i++) {
-		if (!calls[i]) {
-			continue;
-		}
-		if (strncmp(calls[i]->name, ssi_call->name,
-			    strlen(calls[i]->name)) == 0) {
-			calls[i] = NULL;
-			httpd_d("Unregister ssi %s at %d", ssi_call->name, i);
-			return;
-		}
-	}
+	i = httpd_ssi_slot(ssi_call->name, strlen(ssi_call->name));
+	if (!calls[i])
+		return;
 
-	return;
+	calls[i] = NULL;
+	calls_no--;
+	httpd_d("Unregister ssi %s at %d", ssi_call->name, i);
+
+	/* Re-insert the rest of the probe run so no entry is cut off from its
+	 * hash slot by the hole just made */
+	for (i = (i + 1) & (SSI_HASH_SIZE - 1); calls[i];
+	     i = (i + 1) & (SSI_HASH_SIZE - 1)) {
+		moved = calls[i];
+		calls[i] = NULL;
+		calls[httpd_ssi_slot(moved->name, strlen(moved->name))] = moved;
+	}
 }
 
 /* The null function is returned if no match is found */
@@ -117,18 +155,14 @@ int nullfunction(const httpd_request_t *req, const char *args, int conn,
 httpd_ssifunction httpd_ssi(char *name)
 {
 	struct httpd_ssi_call *f;
-	int i;
 
 	if (!ssi_ready)
 		return nullfunction;
 
-	/* Find the matching name in the table, return the function. */
-	for (i = 0; i < MAX_REGISTERED_SSIS; i++) {
-		f = calls[i];
-		if (f && strncmp(f->name, name, strlen(f->name)) == 0) {
-			httpd_d("Found function: %s", (f)->name);
-			return f->function;
-		}
+	f = calls[httpd_ssi_slot(name, httpd_ssi_name_len(name))];
+	if (f) {
+		httpd_d("Found function: %s", (f)->name);
+		return f->function;
 	}
 
 	httpd_d("Did not find function %s returning nullfunc", name);
@@ -139,7 +173,8 @@ httpd_ssifunction httpd_ssi(char *name)
 /** Initialize the SSI handling data structures */
 int httpd_ssi_init(void)
 {
-	memset(calls, 0, sizeof(struct httpd_ssi_call *) * MAX_REGISTERED_SSIS);
+	memset(calls, 0, sizeof(calls));
+	calls_no = 0;
 	ssi_ready = 1;
 	return kNoErr;
 }
@@ -35,44 +35,230 @@
 
 #include "httpd_priv.h"
 
-int htsys_getln_soc(int sd, char *data_p, int buflen)
+/* Receive buffers of the open client connections, allocated on accept and
+ * released when the connection is closed. */
+static httpd_recv_buf_t *htsys_rbuf[HTTPD_MAX_CLIENT_CONN];
+
+static httpd_recv_buf_t *htsys_recv_buf(int sd)
 {
-	int len = 0;
-	char *c_p;
-	int result;
+	int i;
+
+	for (i = 0; i < HTTPD_MAX_CLIENT_CONN; i++) {
+		if (htsys_rbuf[i] && htsys_rbuf[i]->sock == sd)
+			return htsys_rbuf[i];
+	}
+	return NULL;
+}
+
+int htsys_recv_buf_attach(int sd)
+{
+	int i;
+
+	for (i = 0; i < HTTPD_MAX_CLIENT_CONN; i++) {
+		if (!htsys_rbuf[i])
+			break;
+	}
+	if (i == HTTPD_MAX_CLIENT_CONN) {
+		httpd_d("No free receive buffer");
+		return kNoResourcesErr;
+	}
 
-//	ASSERT(data_p != NULL);
-	c_p = data_p;
+	htsys_rbuf[i] = malloc(sizeof(httpd_recv_buf_t));
+	if (!htsys_rbuf[i]) {
+		httpd_d("Failed to allocate receive buffer");
+		return kNoMemoryErr;
+	}
 
-	/* Read one byte at a time */
-	while ((result = httpd_recv(sd, c_p, 1, 0)) != 0) {
-		/* error on recv */
-		if (result == -1) {
-			*c_p = 0;
-			httpd_d("recv failed len: %d, err: 0x%x", len, serr);
-			return -kInProgressErr;
+	htsys_rbuf[i]->sock = sd;
+	htsys_rbuf[i]->start = 0;
+	htsys_rbuf[i]->end = 0;
+	htsys_rbuf[i]->skip_line = FALSE;
+	return kNoErr;
+}
+
+void htsys_recv_buf_detach(int sd)
+{
+	int i;
+
+	for (i = 0; i < HTTPD_MAX_CLIENT_CONN; i++) {
+		if (htsys_rbuf[i] && htsys_rbuf[i]->sock == sd) {
+			free(htsys_rbuf[i]);
+			htsys_rbuf[i] = NULL;
 		}
+	}
+}
+
+int htsys_recv_buf_pending(int sd)
+{
+	httpd_recv_buf_t *rb = htsys_recv_buf(sd);
+
+	return rb ? rb->end - rb->start : 0;
+}
+
+char *htsys_recv_buf_peek(int sd, int *len)
+{
+	httpd_recv_buf_t *rb = htsys_recv_buf(sd);
+
+	if (!rb) {
+		*len = 0;
+		return NULL;
+	}
+
+	rb->data[rb->end] = 0;
+	*len = rb->end - rb->start;
+	return rb->data + rb->start;
+}
+
+/* Hand out bytes already sitting in the receive buffer, if any. Returns 0
+ * when the buffer is empty and the caller has to go to the socket. */
+int htsys_recv(int sd, void *buf, size_t n)
+{
+	httpd_recv_buf_t *rb = htsys_recv_buf(sd);
+	int len;
+
+	if (!rb || rb->start == rb->end)
+		return 0;
+
+	len = rb->end - rb->start;
+	if (len > n)
+		len = n;
+	memcpy(buf, rb->data + rb->start, len);
+	rb->start += len;
+	return len;
+}
 
-		/* If new line... */
-		if ((*c_p == ISO_nl) || (*c_p == ISO_cr)) {
-			result = httpd_recv(sd, c_p, 1, 0);
-			if ((*c_p != ISO_nl) && (*c_p != ISO_cr)) {
-				httpd_d("should get double CR LF: %d, %d",
-				      (int)*c_p, result);
-			}
+/* Fill the receive buffer with whatever the socket has, up to the free
+ * space. Consumed bytes are dropped first to make room. */
+static int htsys_fill(httpd_recv_buf_t *rb)
+{
+	int result;
+
+	if (rb->start > 0) {
+		memmove(rb->data, rb->data + rb->start, rb->end - rb->start);
+		rb->end -= rb->start;
+		rb->start = 0;
+	}
+
+	result = httpd_sock_recv(rb->sock, rb->data + rb->end,
+				 HTTPD_RECV_BUF_SIZE - rb->end, 0);
+	if (result < 0) {
+		httpd_d("recv failed, buffered: %d", rb->end);
+		return -kInProgressErr;
+	}
+
+	rb->end += result;
+	return result;
+}
+
+int htsys_recv_buf_fill(int sd)
+{
+	httpd_recv_buf_t *rb = htsys_recv_buf(sd);
+
+	if (!rb)
+		return -kInProgressErr;
+	if (rb->start == 0 && rb->end == HTTPD_RECV_BUF_SIZE)
+		return kNoSpaceErr;
+	return htsys_fill(rb);
+}
+
+bool htsys_recv_buf_hdr_ready(int sd)
+{
+	httpd_recv_buf_t *rb = htsys_recv_buf(sd);
+	char *p, *end;
+
+	if (!rb || rb->start == rb->end)
+		return FALSE;
+
+	/* A header that does not fit is handed to the parser anyway, which
+	 * truncates the long lines and reads the rest from the socket */
+	if (rb->end - rb->start == HTTPD_RECV_BUF_SIZE)
+		return TRUE;
+
+	p = rb->data + rb->start;
+	end = rb->data + rb->end;
+	while ((p = memchr(p, ISO_nl, end - p)) != NULL) {
+		p++;
+		if (p < end && *p == ISO_nl)
+			return TRUE;
+		if (p + 1 < end && p[0] == ISO_cr && p[1] == ISO_nl)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/* Get the next line from the socket as a view into the receive buffer.
+ * The CR LF is replaced with a null termination, the line stays valid until
+ * the next read from this socket. Lines that do not fit in the buffer are
+ * truncated and the rest is discarded. Returns the length of the line, 0 for
+ * an empty line or a closed connection.
+ */
+int htsys_getln(int sd, char **line_p)
+{
+	httpd_recv_buf_t *rb = htsys_recv_buf(sd);
+	char *line, *nl;
+	int len, result;
+
+	if (!rb)
+		return -kInProgressErr;
+
+	while (TRUE) {
+		line = rb->data + rb->start;
+		nl = memchr(line, ISO_nl, rb->end - rb->start);
+
+		if (rb->skip_line) {
+			/* Still dropping the tail of an over-long line */
+			rb->start = nl ? nl + 1 - rb->data : rb->end;
+			rb->skip_line = (nl == NULL);
+			if (nl)
+				continue;
+		} else if (nl) {
+			len = nl - line;
+			rb->start += len + 1;
+			break;
+		} else if (rb->start == 0 && rb->end == HTTPD_RECV_BUF_SIZE) {
+			httpd_d("buf full: line truncated.");
+			len = rb->end;
+			rb->start = rb->end;
+			rb->skip_line = TRUE;
 			break;
 		}
-		len++;
-		c_p++;
 
-		/* give up here since we'll at least need 3 more chars to
-		 * finish off the line */
-		if (len >= buflen - 1) {
-			httpd_d("buf full: recv didn't read complete line.");
+		result = htsys_fill(rb);
+		if (result < 0) {
+			*line_p = rb->data;
+			rb->data[0] = 0;
+			return result;
+		}
+		if (result == 0) {
+			/* Peer closed, whatever is left is the last line */
+			line = rb->data + rb->start;
+			len = rb->end - rb->start;
+			rb->start = rb->end;
 			break;
 		}
 	}
 
-	*c_p = 0;
+	if (len > 0 && line[len - 1] == ISO_cr)
+		len--;
+	line[len] = 0;
+	*line_p = line;
+	return len;
+}
+
+int htsys_getln_soc(int sd, char *data_p, int buflen)
+{
+	char *line;
+	int len;
+
+	len = htsys_getln(sd, &line);
+	if (len < 0) {
+		*data_p = 0;
+		return len;
+	}
+
+	if (len >= buflen)
+		len = buflen - 1;
+	memcpy(data_p, line, len);
+	data_p[len] = 0;
 	return len;
 }
@@ -42,7 +42,108 @@
 
 #define MAX_WSGI_HANDLERS 32
 
-static struct httpd_wsgi_call *calls[MAX_WSGI_HANDLERS];
+/* Registered handlers, kept sorted by URI so that a request is dispatched
+ * with a binary search. Handlers that match on a URI prefix only live in
+ * their own table as they are looked up differently. */
+typedef struct {
+	struct httpd_wsgi_call *calls[MAX_WSGI_HANDLERS];
+	int count;
+} httpd_wsgi_table_t;
+
+static httpd_wsgi_table_t exact_calls;
+static httpd_wsgi_table_t prefix_calls;
+
+/* Compare a registered URI with the first len characters of a request */
+static int httpd_wsgi_uri_cmp(const char *uri, const char *req, int len)
+{
+	int ret = strncmp(uri, req, len);
+
+	if (ret == 0 && uri[len] != 0)
+		return 1;
+	return ret;
+}
+
+/* Number of handlers whose URI sorts before or equal to req[0..len) */
+static int httpd_wsgi_upper_bound(const httpd_wsgi_table_t *table,
+				  const char *req, int len)
+{
+	int lo = 0, hi = table->count, mid;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (httpd_wsgi_uri_cmp(table->calls[mid]->uri, req, len) <= 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/* Find the handler registered for exactly req[0..len) */
+static struct httpd_wsgi_call *httpd_wsgi_find(const httpd_wsgi_table_t *table,
+					       const char *req, int len)
+{
+	int pos = httpd_wsgi_upper_bound(table, req, len);
+
+	if (pos > 0 &&
+	    httpd_wsgi_uri_cmp(table->calls[pos - 1]->uri, req, len) == 0)
+		return table->calls[pos - 1];
+	return NULL;
+}
+
+/* Find the handler with the longest URI that is a prefix of req[0..len).
+ * Every such URI sorts between itself and the request, so the nearest entry
+ * below the request either is the answer or shares with the request the
+ * longest part any answer can have. */
+static struct httpd_wsgi_call *
+httpd_wsgi_find_prefix(const httpd_wsgi_table_t *table, const char *req, int len)
+{
+	const char *uri;
+	int pos, match;
+
+	while (len > 0) {
+		pos = httpd_wsgi_upper_bound(table, req, len);
+		if (pos == 0)
+			return NULL;
+
+		uri = table->calls[pos - 1]->uri;
+		for (match = 0; match < len && uri[match] == req[match]; match++)
+			;
+		if (uri[match] == 0)
+			return table->calls[pos - 1];
+		len = match;
+	}
+	return NULL;
+}
+
+static int httpd_wsgi_table_insert(httpd_wsgi_table_t *table,
+				   struct httpd_wsgi_call *wsgi_call)
+{
+	int pos = httpd_wsgi_upper_bound(table, wsgi_call->uri,
+					 strlen(wsgi_call->uri));
+
+	memmove(&table->calls[pos + 1], &table->calls[pos],
+		(table->count - pos) * sizeof(table->calls[0]));
+	table->calls[pos] = wsgi_call;
+	table->count++;
+	return pos;
+}
+
+static int httpd_wsgi_table_remove(httpd_wsgi_table_t *table,
+				   struct httpd_wsgi_call *wsgi_call)
+{
+	int i;
+
+	for (i = 0; i < table->count; i++) {
+		if (table->calls[i] == wsgi_call) {
+			table->count--;
+			memmove(&table->calls[i], &table->calls[i + 1],
+				(table->count - i) * sizeof(table->calls[0]));
+			return kNoErr;
+		}
+	}
+	return -kInProgressErr;
+}
 
 /** This is the maximum size of a POST response */
 #define MAX_HTTP_POST_RESPONSE 256
@@ -51,33 +152,29 @@ char http_response[MAX_HTTP_POST_RESPONSE];
 /* Register a WSGI call in the list of handlers */
 int httpd_register_wsgi_handler(struct httpd_wsgi_call *wsgi_call)
 {
-	int i, store_index = -1;
+	int len, pos;
 
 	if (!wsgi_call->uri)
 		return kNoErr;
 
-	for (i = 0; i < MAX_WSGI_HANDLERS; i++) {
-		/*Find the first empty location in the calls array */
-		if (!calls[i] && store_index == -1) {
-			httpd_d("Found empty location %d", i);
-			store_index = i;
-			continue;
-		}
-		if (strcmp(calls[i]->uri, wsgi_call->uri) == 0) {
-			httpd_d("Found wsgi %s at slot %d",
-			      wsgi_call->uri, i);
-			return kNoErr;
-		}
+	len = strlen(wsgi_call->uri);
+	if (httpd_wsgi_find(&exact_calls, wsgi_call->uri, len) ||
+	    httpd_wsgi_find(&prefix_calls, wsgi_call->uri, len)) {
+		httpd_d("Found wsgi %s", wsgi_call->uri);
+		return kNoErr;
 	}
-	if (store_index == -1) {
+
+	if (exact_calls.count + prefix_calls.count == MAX_WSGI_HANDLERS) {
 		httpd_d("Array full.. Cannot register wsgi %s", wsgi_call->uri);
 		return -kInProgressErr;
 	}
 
-	httpd_d("Register wsgi %s at %d", wsgi_call->uri,
-	      store_index);
+	if (wsgi_call->http_flags & APP_HTTP_FLAGS_NO_EXACT_MATCH)
+		pos = httpd_wsgi_table_insert(&prefix_calls, wsgi_call);
+	else
+		pos = httpd_wsgi_table_insert(&exact_calls, wsgi_call);
 
-	calls[store_index] = wsgi_call;
+	httpd_d("Register wsgi %s at %d", wsgi_call->uri, pos);
 	return kNoErr;
 }
 
@@ -104,14 +201,8 @@ int httpd_register_wsgi_handlers(struct httpd_wsgi_call *wsgi_call_list, int
 /* Unregister a WSGI call */
 int httpd_unregister_wsgi_handler(struct httpd_wsgi_call *wsgi_call)
 {
-	int i;
-
-	for (i = 0; i < MAX_WSGI_HANDLERS; i++) {
-		if (calls[i] && (calls[i] == wsgi_call)) {
-			calls[i] = NULL;
-			return 0;
-		}
-	}
+	if (httpd_wsgi_table_remove(&exact_calls, wsgi_call) != kNoErr)
+		httpd_wsgi_table_remove(&prefix_calls, wsgi_call);
 
 	return 0;
 }
@@ -134,45 +225,17 @@ int httpd_unregister_wsgi_handlers(struct httpd_wsgi_call *wsgi_call_list,
 		return kNoErr;
 }
 
-typedef enum {
-	ANY_OTHER_CHAR = 0,
-	/* First \r found */
-	FIRST_CR_FOUND,
-	/* First \n found */
-	FIRST_LF_FOUND,
-	/* Second \r found */
-	SECOND_CR_FOUND,
-	/* Second \n found */
-	SECOND_LF_FOUND,
-} httpd_purge_state_t;
-
-
+/* Read and drop header lines up to and including the empty line that ends
+ * the header block. */
 int httpd_purge_headers(int sock)
 {
-	unsigned char ch;
-	httpd_purge_state_t purge_state = ANY_OTHER_CHAR;
-	while (httpd_recv(sock, &ch, 1, 0) != 0) {
-		switch (ch) {
-		case '\r':
-			if (purge_state == ANY_OTHER_CHAR)
-				purge_state = FIRST_CR_FOUND;
-			if (purge_state == FIRST_LF_FOUND)
-				purge_state = SECOND_CR_FOUND;
-			break;
-		case '\n':
-			if (purge_state == FIRST_CR_FOUND)
-				purge_state = FIRST_LF_FOUND;
-			if (purge_state == SECOND_CR_FOUND)
-				purge_state = SECOND_LF_FOUND;
-			break;
-		default:
-			purge_state = ANY_OTHER_CHAR;
+	char *line;
+	int len;
 
-		}
-		if (purge_state == SECOND_LF_FOUND)
-			return kNoErr;
-	}
-	return -kInProgressErr;
+	while ((len = htsys_getln(sock, &line)) > 0)
+		;
+
+	return len < 0 ? -kInProgressErr : kNoErr;
 }
 
 int httpd_send_header(int sock, const char *name, const char *value)
@@ -500,61 +563,45 @@ int httpd_send_response(httpd_request_t *req, const char *first_line,
 int httpd_get_data(httpd_request_t *req, char *content, int length)
 {
 	int ret;
-	char *buf;
 
 	/* Is this condition required? */
 	if (req->body_nbytes >= HTTPD_MAX_MESSAGE - 2)
 		return -kInProgressErr;
 
-
-	buf = malloc(HTTPD_MAX_MESSAGE);
-	if (!buf) {
-		httpd_d("Failed to allocate memory for buffer");
-		return -kInProgressErr;
-	}
-
 	if (!req->hdr_parsed) {
-		ret = httpd_parse_hdr_tags(req, req->sock, buf,
-			HTTPD_MAX_MESSAGE);
+		ret = httpd_parse_hdr_tags(req, req->sock, NULL, 0);
 
 		if (ret != kNoErr) {
 			httpd_d("Unable to parse header tags");
-			goto out;
+			return req->remaining_bytes;
 		} else {
 			httpd_d("Headers parsed successfully\r\n");
 			req->hdr_parsed = 1;
 		}
 	}
 
+	/* Leave room for the null termination and do not read into the next
+	 * request on a kept-alive connection */
+	if (length - 1 < req->remaining_bytes)
+		length = length - 1;
+	else
+		length = req->remaining_bytes;
+
 	/* handle here */
 	ret = httpd_recv(req->sock, content,
 			length, 0);
-	if (ret == -1) {
+	if (ret < 0) {
 		httpd_d("Failed to read POST data");
-		goto out;
+		return req->remaining_bytes;
 	}
 	/* scratch will now have the JSON data */
 	content[ret] = '\0';
 	req->remaining_bytes -= ret;
 	httpd_d("Read %d bytes and remaining %d bytes",
 		ret, req->remaining_bytes);
-out:
-	free(buf);
 	return req->remaining_bytes;
 }
 
-static int get_matching_chars(const char *s1, const char *s2)
-{
-	int match = 0;
-
-	if (s1 != NULL && s2 != NULL) {
-		while (*s1++ == *s2++)
-			match++;
-	}
-	return match;
-
-}
-
 /* Function to skip the initial ipaddress/hostname path in a URL */
 char *httpd_skip_absolute_http_path(char *request)
 {
@@ -620,84 +667,63 @@ int httpd_validate_uri(char *req, const char *api, int flags)
 /* Check if there are any matching WSGI calls, and if so, execute them. */
 int httpd_wsgi(httpd_request_t *req_p)
 {
-	struct httpd_wsgi_call *f;
+	struct httpd_wsgi_call *f = NULL;
 	int err = -WM_E_HTTPD_NO_HANDLER;
-	int index, ret = 0;
-	int match_index = -1, cur_char_match = 0;
-	bool found;
+	int len, path_len;
+	char *query;
 
-	char *ptr, *request = httpd_skip_absolute_http_path(req_p->filename);
+	char *request = httpd_skip_absolute_http_path(req_p->filename);
 
 	httpd_d("httpd_wsgi: looking for %s", request);
-        
-	/* IMP: fixme: Need to check for ? at the end or any forward slashes /
-	 * httpd_validate URI? */
-	for (index = 0; index < MAX_WSGI_HANDLERS; index++) {
-		f = calls[index];
-		if (f == NULL)
-			continue;
-		if (f->http_flags & APP_HTTP_FLAGS_NO_EXACT_MATCH) {
-			ret = get_matching_chars(request,
-						f->uri);
-			if (ret > cur_char_match) {
-				cur_char_match = ret;
-				match_index = index;
-			}
-		} else {
-			if (!strncmp(request, f->uri, strlen(f->uri))) {
-				found = 0;
-				ptr = request;
-				ptr += strlen(f->uri);
-				/* '?' terminates a filename */
-				if (*ptr == '?')
-					found = 1;
-				else {
-					/* Check for any number of
-					 * forward slashes */
-					while (*ptr && (*ptr == '/')) {
-						ptr++;
-					}
-					if (!*ptr)
-						found = 1;
-				}
-				if (found) {
-					httpd_d("Anchored pattern match: %s",
-						f->uri);
-					match_index = index;
-					/* Break if there is an exact match */
-					break;
-				}
-			}
-		}
+
+	/* An exact match is a registered URI followed by either a '?' that
+	 * starts the query or any number of trailing forward slashes. */
+	query = strchr(request, '?');
+	if (query) {
+		f = httpd_wsgi_find(&exact_calls, request, query - request);
+	} else {
+		len = path_len = strlen(request);
+		while (len > 0 && request[len - 1] == '/')
+			len--;
+		for (; !f && len <= path_len; len++)
+			f = httpd_wsgi_find(&exact_calls, request, len);
+	}
+
+	if (f) {
+		httpd_d("Anchored pattern match: %s", f->uri);
+	} else {
+		f = httpd_wsgi_find_prefix(&prefix_calls, request,
+					   strlen(request));
 	}
-	if (match_index == -1)
+
+	if (f == NULL)
 		return err;
 
 	/* Match found. So map the wsgi to this request */
-	req_p->wsgi = calls[match_index];
+	req_p->wsgi = f;
 	switch (req_p->type) {
 	case HTTPD_REQ_TYPE_HEAD:
 	case HTTPD_REQ_TYPE_GET:
-		if (calls[match_index]->get_handler)
-			err = calls[match_index]->get_handler(req_p);
+		if (f->get_handler)
+			err = f->get_handler(req_p);
 		else
 			return err;
 		break;
 	case HTTPD_REQ_TYPE_POST:
-		if (calls[match_index]->set_handler)
-			err = calls[match_index]->set_handler(req_p);
+		if (f->set_handler)
+			err = f->set_handler(req_p);
 		else
 			return err;
 		break;
 	case HTTPD_REQ_TYPE_PUT:
-		if (calls[match_index]->put_handler)
-			err = calls[match_index]->put_handler(req_p);
+		if (f->put_handler)
+			err = f->put_handler(req_p);
 		else
 			return err;
 		break;
 	case HTTPD_REQ_TYPE_DELETE:
-		if (calls[match_index]->delete_handler)
-			err = calls[match_index]->delete_handler(req_p);
+		if (f->delete_handler)
+			err = f->delete_handler(req_p);
 		else
 			return err;
 		break;
@@ -715,7 +741,8 @@ int httpd_wsgi(httpd_request_t *req_p)
 /* Initialise the WSGI handler data structures */
 int httpd_wsgi_init(void)
 {
-	memset(calls, 0, sizeof(calls));
+	memset(&exact_calls, 0, sizeof(exact_calls));
+	memset(&prefix_calls, 0, sizeof(prefix_calls));
 
 	return kNoErr;
 }
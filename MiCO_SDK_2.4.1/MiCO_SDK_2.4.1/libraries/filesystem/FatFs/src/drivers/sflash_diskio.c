@@ -31,6 +31,8 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include <string.h>
+#include <stddef.h>
+#include <stdlib.h>
 #include "ff_gen_drv.h"
 
 /* Private typedef -----------------------------------------------------------*/
@@ -41,9 +43,80 @@
 //#define SECTOR_COUNT              2048
 #define FLASH_SECTOR              4096
 
+/* SFLASHDISK_Driver uses the direct layout: sector n is stored at offset
+ * n * SECTOR_SIZE, and every write erases its flash sector.
+ *
+ * SFLASHDISK_FTL_Driver is an opt-in prototype that writes sectors through a
+ * flash translation layer instead, linked by applications that choose it. It
+ * is not a drop-in replacement:
+ *  - The layouts are not compatible and there is no migration, the FTL holds
+ *    fewer sectors than a direct volume. It refuses to mount a partition that
+ *    holds a volume in the direct layout, which has to be erased and formatted
+ *    again, losing its files.
+ *  - Garbage is only collected inside a write that runs out of free blocks and
+ *    on CTRL_SYNC, there is no collection while the disk is idle.
+ *  - CTRL_TRIM only unmaps sectors in RAM, see below.
+ *
+ * Every flash sector is an FTL block of 8 pages. Page 0 holds the block summary,
+ * pages 1..7 hold FatFs sectors in the order they were written. A sector that is
+ * written again goes to the next free page, and the copy with the newest block
+ * sequence number and page wins when the map is rebuilt at mount.
+ *
+ * CTRL_TRIM only unmaps sectors in RAM. After a reset a trimmed sector maps to
+ * its last copy again, which is harmless as FatFs does not read the sectors of
+ * free clusters, but collection moves that copy until the sector is written. */
+#define FTL_PAGES_PER_BLOCK       ( FLASH_SECTOR / SECTOR_SIZE )
+#define FTL_DATA_PAGES            ( FTL_PAGES_PER_BLOCK - 1 )
+#define FTL_MAGIC                 ( 0x4C54464D )  /* "MFTL" */
+#define FTL_UNMAPPED              ( 0xFFFF )
+#define FTL_NO_BLOCK              ( 0xFFFF )
+#define FTL_FAT_SIGNATURE         ( 0xAA55 )  /* Last word of a boot sector */
+
+/* Blocks kept out of the logical size, so collection always finds garbage */
+#define FTL_RESERVED_BLOCKS       4
+/* Collection runs inside a write below FTL_GC_LOW free blocks, and on
+ * CTRL_SYNC until FTL_GC_HIGH blocks are free */
+#define FTL_GC_LOW                2
+#define FTL_GC_HIGH               4
+
+typedef struct
+{
+  uint16_t lsn;
+  uint16_t lsn_check;           /* ~lsn, tells a complete entry from a torn one */
+} ftl_page_entry_t;
+
+typedef struct
+{
+  uint32_t magic;
+  uint32_t erase_count;
+  uint32_t seq;
+  uint32_t check;               /* ~( erase_count ^ seq ) */
+  ftl_page_entry_t page[FTL_DATA_PAGES];
+} ftl_summary_t;
+
+typedef struct
+{
+  uint32_t erase_count;
+  uint32_t seq;                 /* when the block was opened, 0 if it holds no summary */
+  uint8_t  valid;               /* pages that are still mapped */
+} ftl_block_t;
+
+typedef struct
+{
+  bool          mounted;
+  uint16_t      block_count;
+  uint16_t      sector_count;
+  uint16_t      open_block;     /* block receiving writes */
+  uint8_t       open_page;      /* next data page of open_block */
+  uint32_t      next_seq;
+  ftl_block_t   *blocks;
+  uint16_t      *map;           /* logical sector to block * FTL_PAGES_PER_BLOCK + page */
+} ftl_t;
+
 /* Private variables ---------------------------------------------------------*/
 /* Disk status */
 static volatile DSTATUS Stat = STA_NOINIT;
+static ftl_t ftl;
 static void MicoFlashEraseWrite( mico_partition_t partition, volatile uint32_t* off_set, uint8_t* data_addr ,uint32_t size );
 mico_logic_partition_t *fatfs_partition;
 
@@ -57,6 +130,14 @@ DRESULT SFLASHDISK_read (BYTE*, DWORD, BYTE);
 #if _USE_IOCTL == 1
   DRESULT SFLASHDISK_ioctl (BYTE, void*);
 #endif /* _USE_IOCTL == 1 */
+DSTATUS SFLASHFTL_initialize (void);
+DRESULT SFLASHFTL_read (BYTE*, DWORD, BYTE);
+#if _USE_WRITE == 1
+  DRESULT SFLASHFTL_write (const BYTE*, DWORD, BYTE);
+#endif /* _USE_WRITE == 1 */
+#if _USE_IOCTL == 1
+  DRESULT SFLASHFTL_ioctl (BYTE, void*);
+#endif /* _USE_IOCTL == 1 */
   
 Diskio_drvTypeDef  SFLASHDISK_Driver =
 {
@@ -71,8 +152,261 @@ Diskio_drvTypeDef  SFLASHDISK_Driver =
 #endif /* _USE_IOCTL == 1 */
 };
 
+Diskio_drvTypeDef  SFLASHDISK_FTL_Driver =
+{
+  SFLASHFTL_initialize,
+  SFLASHDISK_status,
+  SFLASHFTL_read, 
+#if  _USE_WRITE
+  SFLASHFTL_write,
+#endif  /* _USE_WRITE == 1 */  
+#if  _USE_IOCTL == 1
+  SFLASHFTL_ioctl,
+#endif /* _USE_IOCTL == 1 */
+};
+
 /* Private functions ---------------------------------------------------------*/
 
+static uint32_t ftl_page_offset( uint16_t block, uint8_t page )
+{
+  return (uint32_t)block * FLASH_SECTOR + (uint32_t)page * SECTOR_SIZE;
+}
+
+static uint16_t ftl_free_blocks( void )
+{
+  uint16_t block, count = 0;
+
+  for( block = 0; block < ftl.block_count; block++ )
+    if( ftl.blocks[block].valid == 0 && block != ftl.open_block ) count++;
+  return count;
+}
+
+static int ftl_seq_compare( const void *a, const void *b )
+{
+  uint32_t seq_a = ftl.blocks[*(const uint16_t *)a].seq;
+  uint32_t seq_b = ftl.blocks[*(const uint16_t *)b].seq;
+
+  return ( seq_a > seq_b ) - ( seq_a < seq_b );
+}
+
+/* Rebuild the map from the block summaries, on every mount as the partition
+ * may have been erased or formatted by the other driver in the meantime */
+static DRESULT ftl_mount( void )
+{
+  ftl_summary_t summary;
+  uint16_t *order = NULL;
+  uint16_t block, used = 0, i, lsn, ppn;
+  uint32_t offset, erase_total = 0, known = 0;
+  uint8_t page;
+  DRESULT res = RES_OK;
+
+  if( ftl.blocks != NULL ) free( ftl.blocks );
+  if( ftl.map != NULL ) free( ftl.map );
+  memset( &ftl, 0x0, sizeof(ftl) );
+
+  ftl.block_count = fatfs_partition->partition_length / FLASH_SECTOR;
+  require_action( ftl.block_count > FTL_RESERVED_BLOCKS + FTL_GC_LOW, exit, res = RES_ERROR );
+  require_action( ftl.block_count <= FTL_UNMAPPED / FTL_PAGES_PER_BLOCK, exit, res = RES_ERROR );
+  ftl.sector_count = ( ftl.block_count - FTL_RESERVED_BLOCKS ) * FTL_DATA_PAGES;
+
+  ftl.blocks = calloc( ftl.block_count, sizeof(ftl_block_t) );
+  ftl.map = malloc( ftl.sector_count * sizeof(uint16_t) );
+  order = malloc( ftl.block_count * sizeof(uint16_t) );
+  require_action( ftl.blocks && ftl.map && order, exit, res = RES_ERROR );
+  memset( ftl.map, 0xFF, ftl.sector_count * sizeof(uint16_t) );
+
+  ftl.next_seq = 1;
+  for( block = 0; block < ftl.block_count; block++ ){
+    offset = ftl_page_offset( block, 0 );
+    require_action( MicoFlashRead( MICO_PARTITION_FILESYS, &offset, (uint8_t *)&summary, sizeof(summary) ) == kNoErr,
+                    exit, res = RES_ERROR );
+    if( summary.magic != FTL_MAGIC || summary.check != ~( summary.erase_count ^ summary.seq ) || summary.seq == 0 )
+      continue;
+    ftl.blocks[block].seq = summary.seq;
+    ftl.blocks[block].erase_count = summary.erase_count;
+    erase_total += summary.erase_count;
+    known++;
+    if( summary.seq >= ftl.next_seq ) ftl.next_seq = summary.seq + 1;
+    order[used++] = block;
+  }
+
+  /* Without any summary the partition is blank, or holds a volume in the direct
+   * layout, starting with its boot sector. Mounting would lose that volume. */
+  if( known == 0 ){
+    offset = SECTOR_SIZE - sizeof(uint16_t);
+    require_action( MicoFlashRead( MICO_PARTITION_FILESYS, &offset, (uint8_t *)&lsn, sizeof(lsn) ) == kNoErr,
+                    exit, res = RES_ERROR );
+    require_action( lsn != FTL_FAT_SIGNATURE, exit, res = RES_ERROR );
+  }
+
+  /* Blocks without a summary were never used or lost it in a reset, give them an average count */
+  for( block = 0; block < ftl.block_count; block++ )
+    if( ftl.blocks[block].seq == 0 ) ftl.blocks[block].erase_count = known ? erase_total / known : 0;
+
+  /* Oldest block first, so later copies of a sector replace earlier ones */
+  qsort( order, used, sizeof(uint16_t), ftl_seq_compare );
+
+  for( i = 0; i < used; i++ ){
+    block = order[i];
+    offset = ftl_page_offset( block, 0 );
+    require_action( MicoFlashRead( MICO_PARTITION_FILESYS, &offset, (uint8_t *)&summary, sizeof(summary) ) == kNoErr,
+                    exit, res = RES_ERROR );
+    for( page = 0; page < FTL_DATA_PAGES; page++ ){
+      lsn = summary.page[page].lsn;
+      if( (uint16_t)~summary.page[page].lsn_check != lsn ) break;
+      if( lsn >= ftl.sector_count ) continue;
+      ppn = block * FTL_PAGES_PER_BLOCK + page + 1;
+      if( ftl.map[lsn] != FTL_UNMAPPED ) ftl.blocks[ftl.map[lsn] / FTL_PAGES_PER_BLOCK].valid--;
+      ftl.map[lsn] = ppn;
+      ftl.blocks[block].valid++;
+    }
+  }
+
+  /* Free pages left in the last open block may have been half written, start a new one */
+  ftl.open_block = FTL_NO_BLOCK;
+  ftl.open_page = FTL_DATA_PAGES;
+  ftl.mounted = true;
+
+exit:
+  if( order != NULL ) free( order );
+  if( res != RES_OK ){
+    if( ftl.blocks != NULL ) free( ftl.blocks );
+    if( ftl.map != NULL ) free( ftl.map );
+    memset( &ftl, 0x0, sizeof(ftl) );
+  }
+  return res;
+}
+
+static bool ftl_block_is_blank( uint16_t block )
+{
+  uint32_t data[16];
+  uint32_t offset = ftl_page_offset( block, 0 );
+  uint8_t i;
+
+  while( offset < ftl_page_offset( block + 1, 0 ) ){
+    if( MicoFlashRead( MICO_PARTITION_FILESYS, &offset, (uint8_t *)data, sizeof(data) ) != kNoErr )
+      return false;
+    for( i = 0; i < 16; i++ )
+      if( data[i] != 0xFFFFFFFF ) return false;
+  }
+  return true;
+}
+
+/* Erase the least worn free block and make it the open block */
+static DRESULT ftl_open_block( void )
+{
+  ftl_summary_t summary;
+  uint16_t block, best = FTL_NO_BLOCK;
+  uint32_t offset;
+  DRESULT res = RES_OK;
+
+  for( block = 0; block < ftl.block_count; block++ ){
+    if( ftl.blocks[block].valid != 0 || block == ftl.open_block ) continue;
+    if( best == FTL_NO_BLOCK || ftl.blocks[block].erase_count < ftl.blocks[best].erase_count ) best = block;
+  }
+  require_action( best != FTL_NO_BLOCK, exit, res = RES_ERROR );
+
+  /* A block that never held a summary is often still blank */
+  if( ftl.blocks[best].seq != 0 || !ftl_block_is_blank( best ) ){
+    require_action( MicoFlashErase( MICO_PARTITION_FILESYS, ftl_page_offset( best, 0 ), FLASH_SECTOR ) == kNoErr,
+                    exit, res = RES_ERROR );
+    ftl.blocks[best].erase_count++;
+  }
+  ftl.blocks[best].seq = ftl.next_seq++;
+
+  memset( &summary, 0xFF, sizeof(summary) );
+  summary.magic = FTL_MAGIC;
+  summary.erase_count = ftl.blocks[best].erase_count;
+  summary.seq = ftl.blocks[best].seq;
+  summary.check = ~( summary.erase_count ^ summary.seq );
+  offset = ftl_page_offset( best, 0 );
+  require_action( MicoFlashWrite( MICO_PARTITION_FILESYS, &offset, (uint8_t *)&summary, offsetof( ftl_summary_t, page ) ) == kNoErr,
+                  exit, res = RES_ERROR );
+
+  ftl.open_block = best;
+  ftl.open_page = 0;
+
+exit:
+  return res;
+}
+
+/* Append one sector to the open block, opening another one if it is full */
+static DRESULT ftl_write_page( uint16_t lsn, const uint8_t *data )
+{
+  ftl_page_entry_t entry;
+  uint32_t offset;
+  uint16_t old;
+  DRESULT res = RES_OK;
+
+  if( ftl.open_page >= FTL_DATA_PAGES ){
+    res = ftl_open_block( );
+    require_noerr( res, exit );
+  }
+
+  /* Data first, a page is only found at mount once its entry is complete */
+  offset = ftl_page_offset( ftl.open_block, ftl.open_page + 1 );
+  require_action( MicoFlashWrite( MICO_PARTITION_FILESYS, &offset, (uint8_t *)data, SECTOR_SIZE ) == kNoErr,
+                  exit, res = RES_ERROR );
+
+  entry.lsn = lsn;
+  entry.lsn_check = ~lsn;
+  offset = ftl_page_offset( ftl.open_block, 0 ) + offsetof( ftl_summary_t, page ) + ftl.open_page * sizeof(ftl_page_entry_t);
+  require_action( MicoFlashWrite( MICO_PARTITION_FILESYS, &offset, (uint8_t *)&entry, sizeof(entry) ) == kNoErr,
+                  exit, res = RES_ERROR );
+
+  old = ftl.map[lsn];
+  if( old != FTL_UNMAPPED ) ftl.blocks[old / FTL_PAGES_PER_BLOCK].valid--;
+  ftl.map[lsn] = ftl.open_block * FTL_PAGES_PER_BLOCK + ftl.open_page + 1;
+  ftl.blocks[ftl.open_block].valid++;
+  ftl.open_page++;
+
+exit:
+  return res;
+}
+
+/* Move the live pages of the block with the least of them to the open block */
+static DRESULT ftl_collect( void )
+{
+  ftl_summary_t summary;
+  uint8_t *buffer = NULL;
+  uint16_t block, victim = FTL_NO_BLOCK, lsn;
+  uint32_t offset;
+  uint8_t page;
+  DRESULT res = RES_OK;
+
+  for( block = 0; block < ftl.block_count; block++ ){
+    if( ftl.blocks[block].valid == 0 || block == ftl.open_block ) continue;
+    if( victim == FTL_NO_BLOCK || ftl.blocks[block].valid < ftl.blocks[victim].valid
+     || ( ftl.blocks[block].valid == ftl.blocks[victim].valid
+       && ftl.blocks[block].erase_count < ftl.blocks[victim].erase_count ) )
+      victim = block;
+  }
+  require_action( victim != FTL_NO_BLOCK && ftl.blocks[victim].valid < FTL_DATA_PAGES, exit, res = RES_ERROR );
+
+  buffer = malloc( SECTOR_SIZE );
+  require_action( buffer, exit, res = RES_ERROR );
+
+  offset = ftl_page_offset( victim, 0 );
+  require_action( MicoFlashRead( MICO_PARTITION_FILESYS, &offset, (uint8_t *)&summary, sizeof(summary) ) == kNoErr,
+                  exit, res = RES_ERROR );
+
+  for( page = 0; page < FTL_DATA_PAGES && ftl.blocks[victim].valid > 0; page++ ){
+    lsn = summary.page[page].lsn;
+    if( lsn >= ftl.sector_count || ftl.map[lsn] != victim * FTL_PAGES_PER_BLOCK + page + 1 ) continue;
+    offset = ftl_page_offset( victim, page + 1 );
+    require_action( MicoFlashRead( MICO_PARTITION_FILESYS, &offset, buffer, SECTOR_SIZE ) == kNoErr,
+                    exit, res = RES_ERROR );
+    res = ftl_write_page( lsn, buffer );
+    require_noerr( res, exit );
+  }
+
+  /* The block is erased when it is opened again */
+
+exit:
+  if( buffer != NULL ) free( buffer );
+  return res;
+}
+
 /**
   * @brief  Initializes a Drive
   * @param  None
@@ -205,6 +539,144 @@ DRESULT SFLASHDISK_ioctl(BYTE cmd, void *buff)
 }
 #endif /* _USE_IOCTL == 1 */
 
+/**
+  * @brief  Initializes the drive of the flash translation layer
+  * @param  None
+  * @retval DSTATUS: Operation status
+  */
+DSTATUS SFLASHFTL_initialize(void)
+{
+  Stat = STA_NOINIT;
+  fatfs_partition = MicoFlashGetInfo( MICO_PARTITION_FILESYS );
+  if( ftl_mount( ) != RES_OK )
+    return Stat;
+  Stat &= ~STA_NOINIT;
+  return RES_OK;
+}
+
+/**
+  * @brief  Reads Sector(s) through the flash translation layer
+  * @param  *buff: Data buffer to store read data
+  * @param  sector: Sector address (LBA)
+  * @param  count: Number of sectors to read (1..128)
+  * @retval DRESULT: Operation result
+  */
+DRESULT SFLASHFTL_read(BYTE *buff, DWORD sector, BYTE count)
+{
+  DRESULT res = RES_OK;
+  uint32_t offset;
+
+  for(; count>0; count--)
+  {
+    if( sector >= ftl.sector_count )
+      return RES_PARERR;
+    /* Never written or trimmed */
+    if( ftl.map[sector] == FTL_UNMAPPED ){
+      memset( buff, 0xFF, SECTOR_SIZE );
+    }else{
+      offset = (uint32_t)ftl.map[sector]*SECTOR_SIZE;
+      MicoFlashRead( MICO_PARTITION_FILESYS, &offset, (uint8_t *)buff, SECTOR_SIZE);
+    }
+    sector++;
+    buff += SECTOR_SIZE;
+  }
+  return res;
+}
+
+/**
+  * @brief  Writes Sector(s) through the flash translation layer
+  * @param  *buff: Data to be written
+  * @param  sector: Sector address (LBA)
+  * @param  count: Number of sectors to write (1..128)
+  * @retval DRESULT: Operation result
+  */
+#if _USE_WRITE == 1
+DRESULT SFLASHFTL_write(const BYTE *buff, DWORD sector, BYTE count)
+{ 
+  DRESULT res = RES_OK;
+
+  if( sector + count > ftl.sector_count )
+    return RES_PARERR;
+
+  /* Consecutive sectors fill the pages of one block, one erase per FTL_DATA_PAGES sectors */
+  for(; count>0; count--)
+  {
+    while( ftl.open_page >= FTL_DATA_PAGES && ftl_free_blocks( ) < FTL_GC_LOW ){
+      res = ftl_collect( );
+      if( res != RES_OK ) return res;
+    }
+    res = ftl_write_page( (uint16_t)sector, buff );
+    if( res != RES_OK ) return res;
+    sector++;
+    buff += SECTOR_SIZE;
+  }
+  
+  return res;
+}
+#endif /* _USE_WRITE == 1 */
+
+/**
+  * @brief  I/O control operation of the flash translation layer
+  * @param  cmd: Control code
+  * @param  *buff: Buffer to send/receive control data
+  * @retval DRESULT: Operation result
+  */
+#if _USE_IOCTL == 1
+DRESULT SFLASHFTL_ioctl(BYTE cmd, void *buff)
+{
+  DRESULT res = RES_OK;
+  DWORD nFrom,nTo;
+  DWORD i;
+  
+  if (Stat & STA_NOINIT) return RES_NOTRDY;
+  
+  switch (cmd)
+  {
+    /* Writes are on flash already, use the pause to collect garbage ahead of the next burst */
+    case CTRL_SYNC :
+      res = RES_OK;
+      while( res == RES_OK && ftl_free_blocks( ) < FTL_GC_HIGH )
+        res = ftl_collect( );
+      break;
+
+    /* Unmapped sectors are left behind by collection, in RAM only, see above */
+    case CTRL_TRIM:
+      nFrom = *((DWORD*)buff);
+      nTo = *(((DWORD*)buff)+1);
+      for(i = nFrom;i <= nTo && i < ftl.sector_count;i ++){
+        if( ftl.map[i] == FTL_UNMAPPED ) continue;
+        ftl.blocks[ftl.map[i] / FTL_PAGES_PER_BLOCK].valid--;
+        ftl.map[i] = FTL_UNMAPPED;
+      }
+      res = RES_OK;
+      break;
+    
+    /* Get number of sectors on the disk (DWORD) */
+    case GET_SECTOR_COUNT :
+      *(DWORD*)buff = ftl.sector_count;
+      res = RES_OK;
+      break;
+    
+    /* Get R/W sector size (WORD) */
+    case GET_SECTOR_SIZE :
+      *(WORD*)buff = SECTOR_SIZE;   
+      res = RES_OK;
+      break;
+    
+    /* Get erase block size in unit of sector (DWORD) */
+    case GET_BLOCK_SIZE :
+      *(DWORD*)buff = BLOCK_SIZE; 
+      res = RES_OK;
+      break;
+    
+    default:
+      res = RES_PARERR;
+    }
+  
+  return res;
+}
+#endif /* _USE_IOCTL == 1 */
+
 void MicoFlashEraseWrite( mico_partition_t partition, volatile uint32_t* off_set, uint8_t* data_addr ,uint32_t size )
 {
   uint32_t f_sector;
@@ -38,6 +38,9 @@
 /* Exported constants --------------------------------------------------------*/
 /* Exported functions ------------------------------------------------------- */
 extern Diskio_drvTypeDef  SFLASHDISK_Driver;
+/* Opt-in prototype with a flash translation layer, its volumes are not
+ * compatible with SFLASHDISK_Driver, see sflash_diskio.c */
+extern Diskio_drvTypeDef  SFLASHDISK_FTL_Driver;
 
 #endif /* __SDRAM_DISKIO_H */
 
@@ -4,7 +4,8 @@
 * @author  William Xu
 * @version V1.0.0
 * @date    05-May-2014
-* @brief   Create a NTP client thread, and synchronize RTC with NTP server.
+* @brief   NTP time service, poll NTP servers and discipline a UTC clock based
+*          on mico_get_time( ), and the RTC.
 ******************************************************************************
 *
 *  The MIT License
@@ -32,179 +33,519 @@
 
 #include "mico.h"
 #include "SocketUtils.h"
+#include "sntp.h"
 
 
 #define ntp_log(M, ...) custom_log("NTP client", M, ##__VA_ARGS__)
 #define ntp_log_trace() custom_log_trace("NTP client")
 
 
-#define UNIX_OFFSET 		         2208960000U
-#define NTP_Server               "time.asia.apple.com"
-#define NTP_Port                 123
-#define NTP_Flags                0xdb 
-#define NTP_Stratum              0x0
-#define NTP_Poll                 0x0a
-#define NTP_Precision            0xfa
-#define NTP_Root_Delay           0x8000
-#define NTP_Root_Dispersion      0xa00b0000
-
-static volatile bool _wifiConnected = false;
-static mico_semaphore_t  _wifiConnected_sem = NULL;
-
-
-struct NtpPacket
-{
-	uint8_t flags;
-	uint8_t stratum;
-	uint8_t poll;
-	uint8_t precision;
-	uint32_t root_delay;
-	uint32_t root_dispersion;
-	uint8_t referenceID;
-	uint32_t ref_ts_sec;
-	uint32_t ref_ts_frac;
-	uint32_t origin_ts_sec;
-	uint32_t origin_ts_frac;
-	uint32_t recv_ts_sec;
-	uint32_t recv_ts_frac;
-	uint32_t trans_ts_sec;
-	uint32_t trans_ts_frac;
+#define NTP_UNIX_OFFSET          2208988800U    // s from 1900 to 1970
+#define NTP_PACKET_LEN           48
+#define NTP_Flags                0x23           // No leap warning, version 4, client
+#define NTP_MODE_SERVER          4
+#define NTP_LEAP_UNSYNCHRONIZED  3
+#define NTP_MAX_STRATUM          15
+
+/* The RTC keeps the local time of this zone, Beijing time as it always has */
+#ifndef SNTP_RTC_UTC_OFFSET
+#define SNTP_RTC_UTC_OFFSET      (8*3600)
+#endif
+
+#ifndef SNTP_POLL_MIN
+#define SNTP_POLL_MIN            (64*1000)      // ms between two polls of a server, while the clock is not steady
+#endif
+#ifndef SNTP_POLL_MAX
+#define SNTP_POLL_MAX            (1024*1000)    // ms, the interval doubles up to this while the clock is steady
+#endif
+
+#define SNTP_RETRY_MIN           (1000)         // ms to the first retry of a server that has not answered, doubled for every other one
+#define SNTP_TIMEOUT             (1000)         // ms to wait for an answer
+#define SNTP_DNS_TIMEOUT         (5000)
+#define SNTP_BURST               (4)            // Queries on the first poll of a server
+#define SNTP_FILTER_SAMPLES      (8)            // Samples kept for every server, the one with the least delay is used
+#define SNTP_MAX_DELAY           (3000)         // ms, samples with a longer round trip are dropped
+#define SNTP_AGREE               (100)          // ms, two servers agree when their offsets are closer than this and half their delays
+#define SNTP_STEADY              (20)           // ms, the poll interval grows while the offsets are smaller
+#define SNTP_STEP                (128)          // ms, larger offsets set the clock at once, smaller ones are slewed
+#define SNTP_SLEW_RATE           (500000)       // ppb the clock runs faster or slower while an offset is slewed
+#define SNTP_MAX_FREQ            (500000)       // ppb
+#define SNTP_FREQ_INTERVAL       (256*1000)     // ms between two updates, at least, to correct the frequency
+
+typedef struct
+{
+  int64_t   offset;     // Server UTC - monotonic time, ms
+  uint32_t  delay;      // Round trip, ms
+  uint64_t  mono;       // When it was taken
+} sntp_sample_t;
+
+typedef struct
+{
+  sntp_server_t server;
+  uint64_t      next_poll;
+  uint32_t      fails;      // Polls without an answer in a row
+  uint32_t      samples;    // Samples in filter, up to SNTP_FILTER_SAMPLES
+  bool          fresh;      // A sample came since the last clock update
+  sntp_sample_t filter[SNTP_FILTER_SAMPLES];
+} sntp_peer_t;
+
+static const sntp_server_t sntp_default_servers[] =
+{
+  { "time.asia.apple.com", SNTP_PORT },
+  { "cn.pool.ntp.org",     SNTP_PORT },
+  { "pool.ntp.org",        SNTP_PORT },
 };
 
-void ntpNotify_WifiStatusHandler(int event, void *arg)
+static sntp_peer_t    sntp_peers[SNTP_MAX_SERVERS];
+static uint32_t       sntp_peer_count = 0;
+static bool           sntp_running = false;
+static uint32_t       sntp_poll = SNTP_POLL_MIN;
+
+/* The clock, guarded by the mutex: UTC = clock_base at clock_ref, and runs
+ * with the monotonic time, corrected by clock_freq and, until clock_slew_end,
+ * by clock_slew */
+static mico_mutex_t   sntp_mutex = NULL;
+static uint32_t       mono_last = 0;
+static uint64_t       mono_high = 0;
+static uint64_t       clock_ref = 0;
+static int64_t        clock_base = 0;
+static int32_t        clock_freq = 0;
+static int32_t        clock_slew = 0;
+static uint64_t       clock_slew_end = 0;
+static sntp_status_t  sntp_status;
+
+/* The first time may be read before sntp_client_start( ), when no other thread is running yet */
+static void sntp_lock( void )
 {
-  ntp_log_trace();
-  UNUSED_PARAMETER(arg);
-  switch (event) {
-  case NOTIFY_STATION_UP:
-    _wifiConnected = true;
-    if(_wifiConnected_sem)
-      mico_rtos_set_semaphore(&_wifiConnected_sem);
-    break;
-  case NOTIFY_STATION_DOWN:
-    break;
-  default:
+  if( sntp_mutex == NULL )
+    mico_rtos_init_mutex( &sntp_mutex );
+  mico_rtos_lock_mutex( &sntp_mutex );
+}
+
+static void sntp_unlock( void )
+{
+  mico_rtos_unlock_mutex( &sntp_mutex );
+}
+
+/* Called locked. mico_get_time( ) wraps after 49 days, the NTP client thread
+ * reads it often enough to count the wraps. */
+static uint64_t sntp_mono( void )
+{
+  uint32_t now = mico_get_time( );
+
+  if( now < mono_last ) mono_high += 0x100000000ULL;
+  mono_last = now;
+  return mono_high | now;
+}
+
+/* Called locked */
+static int64_t sntp_clock_at( uint64_t mono )
+{
+  int64_t elapsed = (int64_t)( mono - clock_ref );
+  int64_t slewed = (int64_t)( ( mono < clock_slew_end ? mono : clock_slew_end ) - clock_ref );
+
+  if( slewed < 0 ) slewed = 0;
+  return clock_base + elapsed + elapsed * clock_freq / 1000000000 + slewed * clock_slew / 1000000000;
+}
+
+/* Called locked. Where the clock will be once the slew is done */
+static int64_t sntp_clock_target( uint64_t mono )
+{
+  int64_t elapsed = (int64_t)( mono - clock_ref );
+
+  return clock_base + elapsed + elapsed * clock_freq / 1000000000 + (int64_t)( clock_slew_end - clock_ref ) * clock_slew / 1000000000;
+}
+
+/* NTP timestamps are seconds since 1900 and a binary fraction, the ones
+ * below 0x80000000 are after the wrap in 2036 */
+static int64_t sntp_ntp_to_ms( const uint8_t *timestamp )
+{
+  uint32_t sec = ReadBig32( timestamp );
+  uint32_t frac = ReadBig32( timestamp + 4 );
+  int64_t ms = ( (int64_t)sec - NTP_UNIX_OFFSET ) * 1000 + (int64_t)( ( (uint64_t)frac * 1000 ) >> 32 );
+
+  if( sec < 0x80000000 ) ms += 0x100000000LL * 1000;
+  return ms;
+}
+
+static void sntp_ms_to_ntp( int64_t ms, uint8_t *timestamp )
+{
+  WriteBig32( timestamp, (uint32_t)( ms / 1000 + NTP_UNIX_OFFSET ) );
+  WriteBig32( timestamp + 4, (uint32_t)( ( (uint64_t)( ms % 1000 ) << 32 ) / 1000 ) );
+}
+
+static void sntp_rtc_set( int64_t utc )
+{
+  time_t local = (time_t)( utc / 1000 ) + SNTP_RTC_UTC_OFFSET;
+  struct tm *currentTime = gmtime( &local );
+  mico_rtc_time_t time;
+
+  time.sec = currentTime->tm_sec;
+  time.min = currentTime->tm_min;
+  time.hr = currentTime->tm_hour;
+  time.date = currentTime->tm_mday;
+  time.weekday = currentTime->tm_wday;
+  time.month = currentTime->tm_mon + 1;
+  time.year = ( currentTime->tm_year + 1900 ) % 100;
+  MicoRtcSetTime( &time );
+}
+
+/* The sample with the least delay, the one the least disturbed by the network */
+static sntp_sample_t *sntp_filter_best( sntp_peer_t *peer )
+{
+  sntp_sample_t *best = NULL;
+  uint32_t i, count = Min( peer->samples, SNTP_FILTER_SAMPLES );
+
+  for( i = 0; i < count; i++ ){
+    if( best == NULL || peer->filter[i].delay < best->delay )
+      best = &peer->filter[i];
+  }
+  return best;
+}
+
+/* Send one query and take a sample from the answer, the four timestamps give
+ * the round trip without the time the server has taken, and the offset as if
+ * the way there and back took the same time */
+static OSStatus sntp_query( int fd, sntp_peer_t *peer, uint32_t ip )
+{
+  OSStatus err = kTimeoutErr;
+  struct sockaddr_t addr, from;
+  socklen_t from_len;
+  struct timeval_t t;
+  fd_set readfds;
+  uint8_t packet[NTP_PACKET_LEN], origin[8];
+  uint64_t t1, t4;
+  uint32_t random, waited;
+  int64_t t2, t3, delay, offset;
+  sntp_sample_t *sample, *best;
+  int len;
+
+  memset( packet, 0x0, sizeof(packet) );
+  packet[0] = NTP_Flags;
+
+  /* The server echoes the transmit timestamp, the random low bits tell an old or forged answer */
+  MicoRandomNumberRead( &random, sizeof(random) );
+  sntp_lock( );
+  t1 = sntp_mono( );
+  sntp_ms_to_ntp( sntp_clock_at( t1 ), origin );
+  sntp_unlock( );
+  WriteBig32( origin + 4, ( ReadBig32( origin + 4 ) & 0xFFC00000 ) | ( random & 0x003FFFFF ) );
+  memcpy( &packet[40], origin, sizeof(origin) );
+
+  addr.s_ip = ip;
+  addr.s_port = peer->server.port ? peer->server.port : SNTP_PORT;
+  require_action( sendto( fd, packet, sizeof(packet), 0, &addr, sizeof(addr) ) == sizeof(packet), exit, err = kNotWritableErr );
+
+  while( 1 ){
+    waited = mico_get_time( ) - (uint32_t)t1;
+    require_quiet( waited < SNTP_TIMEOUT, exit );
+    t.tv_sec = ( SNTP_TIMEOUT - waited ) / 1000;
+    t.tv_usec = ( ( SNTP_TIMEOUT - waited ) % 1000 ) * 1000;
+    FD_ZERO( &readfds );
+    FD_SET( fd, &readfds );
+    select( fd + 1, &readfds, NULL, NULL, &t );
+    if( !FD_ISSET( fd, &readfds ) ) continue;
+
+    from_len = sizeof(from);
+    len = recvfrom( fd, packet, sizeof(packet), 0, &from, &from_len );
+    sntp_lock( );
+    t4 = sntp_mono( );
+    sntp_unlock( );
+    if( len < NTP_PACKET_LEN || from.s_ip != addr.s_ip || from.s_port != addr.s_port ) continue;
+    if( memcmp( &packet[24], origin, sizeof(origin) ) ) continue;
     break;
   }
+
+  /* Servers that are not synchronized, and kiss-o'-death answers with stratum 0 */
+  require_action_quiet( ( packet[0] & 0x7 ) == NTP_MODE_SERVER && ( packet[0] >> 6 ) != NTP_LEAP_UNSYNCHRONIZED
+                        && packet[1] >= 1 && packet[1] <= NTP_MAX_STRATUM, exit, err = kResponseErr );
+  require_action_quiet( ReadBig32( &packet[40] ), exit, err = kMalformedErr );
+
+  t2 = sntp_ntp_to_ms( &packet[32] );
+  t3 = sntp_ntp_to_ms( &packet[40] );
+  delay = (int64_t)( t4 - t1 ) - ( t3 - t2 );
+  if( delay < 0 ) delay = 0;
+  require_action_quiet( delay <= SNTP_MAX_DELAY, exit, err = kResponseErr );
+
+  /* The server's time has jumped, the older samples would hide it behind their smaller delays */
+  offset = ( ( t2 - (int64_t)t1 ) + ( t3 - (int64_t)t4 ) ) / 2;
+  best = sntp_filter_best( peer );
+  if( best && llabs( offset - best->offset ) > SNTP_STEP )
+    peer->samples = 0;
+
+  sample = &peer->filter[peer->samples % SNTP_FILTER_SAMPLES];
+  sample->offset = offset;
+  sample->delay = (uint32_t)delay;
+  sample->mono = ( t1 + t4 ) / 2;
+  peer->samples++;
+  peer->fresh = true;
+  err = kNoErr;
+
+exit:
+  return err;
+}
+
+/* A burst of queries the first time, to fill the filter, one query after */
+static void sntp_poll_peer( int fd, sntp_peer_t *peer, uint64_t now )
+{
+  OSStatus err;
+  uint32_t ip, answers = 0, retry, i;
+
+  err = mico_system_dns_resolve( peer->server.hostname, &ip, SNTP_DNS_TIMEOUT );
+  require_noerr_quiet( err, exit );
+
+  for( i = 0; i < ( peer->samples ? 1 : SNTP_BURST ); i++ ){
+    err = sntp_query( fd, peer, ip );
+    if( err != kNoErr ) break;
+    answers++;
+  }
+
+exit:
+  if( answers ){
+    peer->fails = 0;
+    peer->next_poll = now + sntp_poll;
+  }else{
+    retry = ( peer->fails < 16 ) ? SNTP_RETRY_MIN << peer->fails : SNTP_POLL_MAX;
+    if( retry > SNTP_POLL_MAX ) retry = SNTP_POLL_MAX;
+    if( peer->fails++ == 0 )
+      ntp_log( "No time from %s, err = %d", peer->server.hostname, err );
+    peer->next_poll = now + retry;
+  }
+}
+
+/* Called locked. The best sample of every server, as an offset to the clock
+ * after the slew, the samples are kept apart from the clock's history */
+static bool sntp_peer_best( sntp_peer_t *peer, int64_t *offset, uint32_t *delay )
+{
+  sntp_sample_t *best = sntp_filter_best( peer );
+
+  if( best == NULL ) return false;
+  *offset = best->offset + (int64_t)best->mono - sntp_clock_target( best->mono );
+  *delay = best->delay;
+  return true;
+}
+
+/* Called locked. Set the clock at once, or slew it, and correct its frequency.
+ * The slew still to do is added to the offset and slewed again. */
+static void sntp_clock_adjust( int64_t offset, uint64_t now )
+{
+  int64_t elapsed = (int64_t)( now - clock_ref ), freq;
+  int64_t utc = sntp_clock_at( now );
+  int64_t correction = offset + sntp_clock_target( now ) - utc;
+  bool step = !sntp_status.synced || correction > SNTP_STEP || correction < -SNTP_STEP;
+
+  if( !step && elapsed >= SNTP_FREQ_INTERVAL ){
+    /* The offset has grown in elapsed ms, a quarter of that rate is corrected */
+    freq = clock_freq + offset * 1000000000 / elapsed / 4;
+    if( freq > SNTP_MAX_FREQ ) freq = SNTP_MAX_FREQ;
+    if( freq < -SNTP_MAX_FREQ ) freq = -SNTP_MAX_FREQ;
+    clock_freq = (int32_t)freq;
+  }
+
+  clock_ref = now;
+  if( step ){
+    clock_base = utc + correction;
+    clock_slew = 0;
+    clock_slew_end = now;
+    sntp_status.steps++;
+  }else{
+    /* Slewed at a fixed rate, the time never runs backwards */
+    clock_base = utc;
+    clock_slew = ( correction < 0 ) ? -SNTP_SLEW_RATE : SNTP_SLEW_RATE;
+    clock_slew_end = now + (uint64_t)( ( correction < 0 ? -correction : correction ) * 1000000000 / SNTP_SLEW_RATE );
+  }
+}
+
+/* The servers that most others agree with are used, a server with a wrong
+ * time is outvoted. Without a majority the clock is left alone until more
+ * samples come. The offsets are averaged, weighted by 1/delay. */
+static void sntp_clock_update( void )
+{
+  int64_t offset[SNTP_MAX_SERVERS], sum = 0, weights = 0, weight, combined;
+  uint32_t delay[SNTP_MAX_SERVERS], agree[SNTP_MAX_SERVERS], used = 0, min_delay = 0;
+  bool valid[SNTP_MAX_SERVERS];
+  uint32_t i, j, pick = 0, count = 0;
+  uint64_t now;
+  bool first;
+
+  sntp_lock( );
+  now = sntp_mono( );
+  for( i = 0; i < sntp_peer_count; i++ ){
+    delay[i] = 0;
+    valid[i] = sntp_peer_best( &sntp_peers[i], &offset[i], &delay[i] );
+    sntp_peers[i].fresh = false;
+    if( valid[i] ) count++;
+  }
+
+  for( i = 0; i < sntp_peer_count; i++ ){
+    agree[i] = 0;
+    for( j = 0; j < sntp_peer_count && valid[i]; j++ ){
+      if( valid[j] && llabs( offset[i] - offset[j] ) <= SNTP_AGREE + ( delay[i] + delay[j] ) / 2 )
+        agree[i]++;
+    }
+    if( agree[i] > agree[pick] || ( agree[i] == agree[pick] && valid[i] && delay[i] < delay[pick] ) )
+      pick = i;
+  }
+  require_quiet( agree[pick] * 2 > count, exit );
+
+  for( i = 0; i < sntp_peer_count; i++ ){
+    if( !valid[i] || llabs( offset[i] - offset[pick] ) > SNTP_AGREE + ( delay[i] + delay[pick] ) / 2 ) continue;
+    weight = 1000000 / ( delay[i] + 1 );
+    sum += offset[i] * weight;
+    weights += weight;
+    if( used++ == 0 || delay[i] < min_delay ) min_delay = delay[i];
+  }
+  combined = sum / weights;
+
+  first = !sntp_status.synced;
+  sntp_clock_adjust( combined, now );
+
+  /* The poll interval grows while the clock is steady, and starts over after a step */
+  if( combined > SNTP_STEP || combined < -SNTP_STEP )
+    sntp_poll = SNTP_POLL_MIN;
+  else if( combined <= SNTP_STEADY && combined >= -SNTP_STEADY && sntp_poll < SNTP_POLL_MAX )
+    sntp_poll = Min( sntp_poll * 2, SNTP_POLL_MAX );
+
+  sntp_status.synced = true;
+  sntp_status.updates++;
+  sntp_status.offset = (int32_t)combined;
+  sntp_status.delay = min_delay;
+  sntp_status.freq = clock_freq;
+  sntp_status.poll = sntp_poll;
+  sntp_status.last_update = (uint32_t)now;
+  sntp_status.servers_used = used;
+  sntp_unlock( );
+
+  sntp_rtc_set( sntp_clock_at( now ) );
+  if( first )
+    ntp_log( "Time set by %d servers, delay %d ms", (int)used, (int)min_delay );
+  else if( combined > SNTP_STEP || combined < -SNTP_STEP )
+    ntp_log( "Time stepped by %d servers, offset %d ms, delay %d ms", (int)used, (int)combined, (int)min_delay );
+  if( first )
+    mico_system_ready_set( mico_ready_TIME );
   return;
+
+exit:
+  sntp_unlock( );
 }
 
 void NTPClient_thread(void *arg)
 {
   ntp_log_trace();
-  OSStatus err = kUnknownErr;
+  OSStatus err = kNoErr;
   UNUSED_PARAMETER( arg );
-  
-  int  Ntp_fd = -1;
-  fd_set readfds;
-  struct timeval_t t ;
-  struct sockaddr_t addr;
-  socklen_t addrLen;	
-  char ipstr[16];
-  unsigned int trans_sec, current;
-  struct NtpPacket outpacket ,inpacket;
-  struct tm *currentTime;
-  mico_rtc_time_t time;
-  LinkStatusTypeDef wifi_link;
-  
-  /* Regisist notifications */
-  err = mico_system_notify_register( mico_notify_WIFI_STATUS_CHANGED, (void *)ntpNotify_WifiStatusHandler, NULL );
-  require_noerr( err, exit ); 
- 
-  memset(&outpacket,0x0,sizeof(outpacket));
-  memset(&inpacket,0x0,sizeof(inpacket));
-
-  outpacket.flags = NTP_Flags;
-  outpacket.stratum = NTP_Stratum;
-  outpacket.poll = NTP_Poll;
-  outpacket.precision = NTP_Precision;
-  outpacket.root_delay = NTP_Root_Delay;
-  outpacket.root_dispersion = NTP_Root_Dispersion;
-  
-  err = micoWlanGetLinkStatus( &wifi_link );
-  require_noerr( err, exit );
 
-  if( wifi_link.is_connected == true )
-    _wifiConnected = true;
-  
-  if(_wifiConnected == false)
-    mico_rtos_get_semaphore(&_wifiConnected_sem, MICO_WAIT_FOREVER);
-  
+  int Ntp_fd = -1;
+  uint64_t now, next;
+  uint32_t i;
+  bool fresh;
+
+  /* Not bound, every client gets a port of its own */
   Ntp_fd = socket(AF_INET, SOCK_DGRM, IPPROTO_UDP);
   require_action(IsValidSocket( Ntp_fd ), exit, err = kNoResourcesErr );
-  addr.s_ip = INADDR_ANY; 
-  addr.s_port = 45000;
-  err = bind(Ntp_fd, &addr, sizeof(addr));
-  err = kNoErr;
-  require_noerr(err, exit);
 
-   while(1) {
-     err = gethostbyname(NTP_Server, (uint8_t *)ipstr, 16);
-     require_noerr(err, ReConnWithDelay);
-     ntp_log("NTP server address: %s",ipstr);
-     break;
+  while(1) {
+    /* Servers are only polled while the station has an address */
+    mico_system_ready_wait( mico_ready_IP, MICO_WAIT_FOREVER );
 
-   ReConnWithDelay:
-     mico_thread_sleep(5);
-   }
+    sntp_lock( );
+    now = sntp_mono( );
+    sntp_unlock( );
 
-  addr.s_ip = inet_addr(ipstr);
-  addr.s_port = NTP_Port;
+    fresh = false;
+    for( i = 0; i < sntp_peer_count; i++ ){
+      if( (int64_t)( sntp_peers[i].next_poll - now ) > 0 ) continue;
+      sntp_poll_peer( Ntp_fd, &sntp_peers[i], now );
+      fresh |= sntp_peers[i].fresh;
+    }
+    if( fresh )
+      sntp_clock_update( );
 
-  t.tv_sec = 5;
-  t.tv_usec = 0;
-  
-  while(1) {
-    require_action(sendto(Ntp_fd, &outpacket,sizeof(outpacket), 0, &addr, sizeof(addr)), exit, err = kNotWritableErr);
-
-    FD_ZERO(&readfds);
-    FD_SET(Ntp_fd, &readfds);
-
-    select(1, &readfds, NULL, NULL, &t);
-    
-    if(FD_ISSET(Ntp_fd, &readfds))
-    {
-      require_action(recvfrom(Ntp_fd, &inpacket, sizeof(struct NtpPacket), 0, &addr, &addrLen)>=0, exit, err = kNotReadableErr);
-
-      trans_sec = inpacket.trans_ts_sec;
-      trans_sec = ntohl(trans_sec);
-      current = trans_sec - UNIX_OFFSET;
-      ntp_log("Time Synchronoused, %s",asctime(localtime(&current)));
-
-      currentTime = localtime(&current);
-      time.sec = currentTime->tm_sec;
-      time.min = currentTime->tm_min ;
-      time.hr = currentTime->tm_hour;
-
-      time.date = currentTime->tm_mday;
-      time.weekday = currentTime->tm_wday;
-      time.month = currentTime->tm_mon + 1;
-      time.year = (currentTime->tm_year + 1900)%100;
-
-      MicoRtcSetTime( &time );
-      goto exit;
+    sntp_lock( );
+    now = sntp_mono( );
+    sntp_unlock( );
+    for( i = 0, next = now + SNTP_POLL_MAX; i < sntp_peer_count; i++ ){
+      if( sntp_peers[i].next_poll < next ) next = sntp_peers[i].next_poll;
     }
+    if( next > now )
+      mico_thread_msleep( (uint32_t)( next - now ) );
   }
+
 exit:
-    if( err!=kNoErr )ntp_log("Exit: NTP client exit with err = %d", err);
-    mico_system_notify_remove( mico_notify_WIFI_STATUS_CHANGED, (void *)ntpNotify_WifiStatusHandler );
-    if(_wifiConnected_sem) mico_rtos_deinit_semaphore(&_wifiConnected_sem);
-    SocketClose(&Ntp_fd);
-    mico_rtos_delete_thread(NULL);
-    return;
+  if( err!=kNoErr )ntp_log("Exit: NTP client exit with err = %d", err);
+  SocketClose(&Ntp_fd);
+  sntp_running = false;
+  mico_rtos_delete_thread(NULL);
+  return;
+}
+
+OSStatus sntp_client_set_servers( const sntp_server_t *servers, uint32_t count )
+{
+  OSStatus err = kNoErr;
+  uint32_t i;
+
+  require_action( servers && count && count <= SNTP_MAX_SERVERS, exit, err = kParamErr );
+  require_action( !sntp_running, exit, err = kStateErr );
+
+  memset( sntp_peers, 0x0, sizeof(sntp_peers) );
+  for( i = 0; i < count; i++ )
+    sntp_peers[i].server = servers[i];
+  sntp_peer_count = count;
+
+exit:
+  return err;
 }
 
 OSStatus sntp_client_start( void )
 {
-  mico_rtos_init_semaphore(&_wifiConnected_sem, 1);
-  return mico_rtos_create_thread(NULL, MICO_APPLICATION_PRIORITY, "NTP Client", NTPClient_thread, STACK_SIZE_NTP_CLIENT_THREAD, NULL );
+  OSStatus err = kNoErr;
+
+  require_quiet( !sntp_running, exit );
+  if( sntp_peer_count == 0 )
+    sntp_client_set_servers( sntp_default_servers, sizeof(sntp_default_servers) / sizeof(sntp_default_servers[0]) );
+
+  err = mico_rtos_create_thread(NULL, MICO_APPLICATION_PRIORITY, "NTP Client", NTPClient_thread, STACK_SIZE_NTP_CLIENT_THREAD, NULL );
+  require_noerr( err, exit );
+  sntp_running = true;
+
+exit:
+  return err;
 }
 
+OSStatus sntp_time_get( struct timeval_t *utc )
+{
+  OSStatus err = kNoErr;
+  int64_t now;
+
+  require_action( utc, exit, err = kParamErr );
 
+  sntp_lock( );
+  if( sntp_status.synced )
+    now = sntp_clock_at( sntp_mono( ) );
+  else
+    err = kNotPreparedErr;
+  sntp_unlock( );
+  require_noerr_quiet( err, exit );
+
+  utc->tv_sec = (unsigned long)( now / 1000 );
+  utc->tv_usec = (unsigned long)( now % 1000 ) * 1000;
+
+exit:
+  return err;
+}
 
 OSStatus sntp_current_time_get( struct tm* time )
 {
   mico_rtc_time_t mico_time;
+  struct timeval_t utc;
+  time_t local;
+
+  if( sntp_time_get( &utc ) == kNoErr ){
+    local = (time_t)utc.tv_sec + SNTP_RTC_UTC_OFFSET;
+    *time = *gmtime( &local );
+    return kNoErr;
+  }
+
   /*Read current time from RTC.*/
   if( MicoRtcGetTime(&mico_time) == kNoErr ){
     time->tm_sec = mico_time.sec;
@@ -218,3 +559,16 @@ OSStatus sntp_current_time_get( struct tm* time )
   }else
     return kGeneralErr;
 }
+
+OSStatus sntp_client_status( sntp_status_t *status )
+{
+  OSStatus err = kNoErr;
+
+  require_action( status, exit, err = kParamErr );
+  sntp_lock( );
+  *status = sntp_status;
+  sntp_unlock( );
+
+exit:
+  return err;
+}
@@ -31,10 +31,72 @@
 
 #pragma once
 
+#include <time.h>
 #include "common.h"
+#include "mico_socket.h"
 
+#define SNTP_PORT                   (123)
+#define SNTP_MAX_SERVERS            (4)
 
+/** @brief A NTP server to poll */
+typedef struct
+{
+  const char *  hostname;   /**< Host name or IP address, must stay valid */
+  uint16_t      port;       /**< 0 for the NTP port 123 */
+} sntp_server_t;
+
+/** @brief State of the time service */
+typedef struct
+{
+  bool          synced;       /**< The clock has been set from a server */
+  uint32_t      updates;      /**< Clock updates, steps and slews */
+  uint32_t      steps;        /**< Updates that set the clock at once */
+  int32_t       offset;       /**< Error of the clock found by the last update, ms */
+  uint32_t      delay;        /**< Round trip delay to the servers used by the last update, ms */
+  int32_t       freq;         /**< Frequency correction of mico_get_time( ), ppb */
+  uint32_t      poll;         /**< Interval between two polls of a server, ms */
+  uint32_t      last_update;  /**< mico_get_time( ) of the last update */
+  uint32_t      servers_used; /**< Servers that agreed in the last update */
+} sntp_status_t;
+
+/**
+  * @brief  Set the NTP servers to poll, before sntp_client_start( ). Three
+  *         or more servers let a server with a wrong time be outvoted.
+  * @param  servers: Servers, the host names are not copied.
+  * @param  count: Number of servers, up to SNTP_MAX_SERVERS.
+  * @retval kNoErr is returned on success, otherwise, kXXXErr is returned.
+  */
+OSStatus sntp_client_set_servers( const sntp_server_t *servers, uint32_t count );
+
+/**
+  * @brief  Start the time service. The servers are polled as long as the
+  *         station has an IP address, the clock is disciplined from their
+  *         answers and mico_ready_TIME is set after the first update.
+  * @retval kNoErr is returned on success, otherwise, kXXXErr is returned.
+  */
 OSStatus sntp_client_start( void );
 
+/**
+  * @brief  Read the UTC time, without a RTC access.
+  * @param  utc: Seconds and microseconds since 1970-01-01 00:00:00 UTC, the
+  *         resolution is the ms of mico_get_time( ).
+  * @retval kNoErr is returned on success, kNotPreparedErr before the first
+  *         update from a NTP server.
+  */
+OSStatus sntp_time_get( struct timeval_t *utc );
+
+/**
+  * @brief  Read the local time, from the clock of the time service once it
+  *         is synchronized, from the RTC before.
+  * @param  time: Filled with the time, in the time zone of SNTP_RTC_UTC_OFFSET.
+  * @retval kNoErr is returned on success, otherwise, kXXXErr is returned.
+  */
 OSStatus sntp_current_time_get( struct tm* time );
 
+/**
+  * @brief  Read the state of the time service.
+  * @param  status: Filled with the state.
+  * @retval kNoErr is returned on success, otherwise, kXXXErr is returned.
+  */
+OSStatus sntp_client_status( sntp_status_t *status );
+
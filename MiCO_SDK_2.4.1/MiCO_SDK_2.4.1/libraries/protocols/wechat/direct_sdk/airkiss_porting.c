@@ -126,31 +126,42 @@ int airkiss_mutex_delete(ak_mutex_t *mutex_ptr)
 }
 #endif
 
+/* The SDK polls airkiss_dns_checkstate( ) while the lookup is AK_DNS_WAITING */
+static volatile int airkiss_dns_status = AK_DNS_FAILED;
+static volatile uint32_t airkiss_dns_ip = 0;
+
+static void airkiss_dns_resolved(const char *hostname, uint32_t ip, OSStatus err, void *arg)
+{
+  UNUSED_PARAMETER(arg);
+  if(err != kNoErr)
+    airkiss_porting_log("ERROR: resolve %s err=%d.", hostname, err);
+  airkiss_dns_ip = ip;
+  airkiss_dns_status = (err == kNoErr) ? AK_DNS_SUCCESS : AK_DNS_FAILED;
+}
+
 int airkiss_dns_gethost(char* url, uint32_t* ipaddr)
 {
-  int8_t ret = -1;
-  uint8_t ip[16] = {0};
-  
   if((NULL == url) || (NULL == ipaddr)){
     airkiss_porting_log("ERROR: airkiss_dns_gethost: invalid params!");
     return AK_DNS_FAILED;
   }
   
-  ret = gethostbyname(url, ip, 16);
-  if(0 != ret){
-    airkiss_porting_log("ERROR: gethostbyname err=%d.", ret);
+  airkiss_dns_status = AK_DNS_WAITING;
+  if(mico_system_dns_resolve_async(url, airkiss_dns_resolved, NULL) != kNoErr){
+    airkiss_porting_log("ERROR: airkiss_dns_gethost: no resolver!");
     return AK_DNS_FAILED;
   }
-  else{ //got ipaddr 192.168.1.1 = (uint32_t)(192<<24)|(168<<16)|(1<<8)|(1)
-    *ipaddr = inet_addr((char*)(&ip[0]));
-    airkiss_porting_log("INFO: gethostbyname:[%s] => [%s] => %x.", url, ip, *ipaddr);
-    return AK_DNS_SUCCESS;
-  }
+  return airkiss_dns_checkstate(ipaddr);
 }
 
 int airkiss_dns_checkstate(uint32_t* ipaddr)
 {
-  return AK_DNS_SUCCESS;
+  int state = airkiss_dns_status;
+
+  //got ipaddr 192.168.1.1 = (uint32_t)(192<<24)|(168<<16)|(1<<8)|(1)
+  if(state == AK_DNS_SUCCESS)
+    *ipaddr = airkiss_dns_ip;
+  return state;
 }
 
 ak_socket airkiss_tcp_socket_create()
@@ -25,6 +25,17 @@
 
 #include "Common.h"
 
+/* CRC engine behind CRC8_Update( ) and CRC16_Update( ), all of them give the
+ * same results. Define CRC_ENGINE in the project settings to trade code size
+ * for speed, the table size is for CRC8 plus CRC16. */
+#define CRC_ENGINE_BITWISE    0   /* One bit per step, no table */
+#define CRC_ENGINE_NIBBLE     1   /* One nibble per step, 48 bytes */
+#define CRC_ENGINE_TABLE      2   /* One byte per step, 768 bytes */
+#define CRC_ENGINE_SLICE4     3   /* Four bytes per step, 3 KB */
+
+#ifndef CRC_ENGINE
+#define CRC_ENGINE            CRC_ENGINE_TABLE
+#endif
 
 
 /*********************  CRC8 MiCO Check **************************************
@@ -0,0 +1,1143 @@
+/**
+******************************************************************************
+* @file    HTTPClientUtils.c
+* @author  William Xu
+* @version V1.0.0
+* @date    17-Oct-2026
+* @brief   This file contains an asynchronous HTTP/1.1 client. All requests are
+  served by one thread over a pool of kept connections. HTTPS requests go through
+  a blocking connection in the caller's thread.
+******************************************************************************
+* @attention
+*
+* THE PRESENT FIRMWARE WHICH IS FOR GUIDANCE ONLY AIMS AT PROVIDING CUSTOMERS
+* WITH CODING INFORMATION REGARDING THEIR PRODUCTS IN ORDER FOR THEM TO SAVE
+* TIME. AS A RESULT, MXCHIP Inc. SHALL NOT BE HELD LIABLE FOR ANY
+* DIRECT, INDIRECT OR CONSEQUENTIAL DAMAGES WITH RESPECT TO ANY CLAIMS ARISING
+* FROM THE CONTENT OF SUCH FIRMWARE AND/OR THE USE MADE BY CUSTOMERS OF THE
+* CODING INFORMATION CONTAINED HEREIN IN CONNECTION WITH THEIR PRODUCTS.
+*
+* <h2><center>&copy; COPYRIGHT 2014 MXCHIP Inc.</center></h2>
+******************************************************************************
+*/
+
+#include "HTTPClientUtils.h"
+#include "SocketUtils.h"
+#include "StringUtils.h"
+
+#include <ctype.h>
+
+#define http_client_log(M, ...) custom_log("HTTPClient", M, ##__VA_ARGS__)
+
+/* Room in front of a streamed body piece for its chunk size line */
+#define HTTP_CLIENT_CHUNK_PREFIX_LEN  8
+
+/* Bytes gathered for one write, one TCP segment on the WLAN */
+#define HTTP_CLIENT_TX_LEN            1460
+
+#define HTTP_CLIENT_READ_LEN          1500
+
+/* HTTPClientRequest_t.state */
+enum
+{
+  kRequestState_Pending,        // Waiting for a connection
+  kRequestState_Header,         // Request line and header are sent next
+  kRequestState_Body,           // Body is sent next
+  kRequestState_Sent,           // Everything is handed to the connection
+};
+
+typedef enum
+{
+  kConnState_Free,
+  kConnState_Resolving,         // Waiting for the address of the host
+  kConnState_Connecting,
+  kConnState_Open,
+} http_client_conn_state_t;
+
+/* What the next response bytes on a connection are */
+typedef enum
+{
+  kResponse_Header,
+  kResponse_Body,               // contentLeft more bytes
+  kResponse_BodyUntilClose,     // No length given, the body ends with the connection
+  kResponse_ChunkSize,
+  kResponse_ChunkData,
+  kResponse_ChunkEnd,           // CRLF behind the chunk data
+  kResponse_Trailer,
+} http_client_response_state_t;
+
+typedef struct
+{
+  http_client_conn_state_t      state;
+  int                           fd;
+  char                          host[HTTP_CLIENT_HOST_LEN];
+  uint16_t                      port;
+  uint32_t                      resolveId;      // Lookup started for this connection
+  bool                          pipelining;     // The server keeps HTTP/1.1 connections, more than one request may be sent
+  bool                          closing;        // Close once the current read is processed
+  uint32_t                      lastActive;
+  uint32_t                      responseCount;  // Responses read on this connection
+
+  HTTPClientRequest_t *         queue;          // Started requests, the next response belongs to the first one
+  HTTPClientRequest_t *         sending;        // Request in queue that is written now, NULL when all is written
+  const uint8_t *               txPtr;          // Bytes handed out that are not written yet
+  size_t                        txLen;
+  size_t                        partSent;       // Bytes of the header or body of sending handed out so far
+  uint8_t *                     txBuf;          // HTTP_CLIENT_TX_LEN bytes gathered from the requests
+
+  HTTPHeader_t *                header;
+  http_client_response_state_t  responseState;
+  bool                          responseStarted; // Some bytes of the response to the first queued request arrived
+  bool                          chunkExtension;
+  uint64_t                      contentLeft;
+  size_t                        lineLen;
+} http_client_conn_t;
+
+/* Address of a host, passed from the DNS resolver to the client thread */
+typedef struct _http_client_resolved_t
+{
+  uint32_t                          resolveId;
+  uint32_t                          ip;
+  OSStatus                          err;
+  struct _http_client_resolved_t *  next;
+} http_client_resolved_t;
+
+static http_client_conn_t       http_client_conns[HTTP_CLIENT_MAX_CONNECTIONS];
+static HTTPClientRequest_t *    http_client_incoming = NULL;  // Queued by HTTPClientSend, guarded by the mutex
+static bool                     http_client_close_idle = false;
+static HTTPClientRequest_t *    http_client_pending = NULL;   // Waiting for a connection
+static HTTPClientRequest_t *    http_client_retry = NULL;     // Lost with a kept connection, sent again first
+static http_client_resolved_t * http_client_resolved = NULL;  // Lookups done, guarded by the mutex
+static uint32_t                 http_client_resolve_id = 0;
+static mico_mutex_t             http_client_mutex = NULL;
+static mico_semaphore_t         http_client_wakeup_sem = NULL;
+static bool                     http_client_running = false;
+static uint8_t                  http_client_rx[HTTP_CLIENT_READ_LEN];
+
+static void http_client_append( HTTPClientRequest_t **list, HTTPClientRequest_t *request )
+{
+  request->next = NULL;
+  while( *list ) list = &(*list)->next;
+  *list = request;
+}
+
+static bool http_client_is_idempotent( HTTPClientRequest_t *request )
+{
+  return strcasecmp( request->method, "GET" ) == 0 || strcasecmp( request->method, "HEAD" ) == 0;
+}
+
+/* The client forgets the request before the application hears about it, so the
+   callback may free it or send it again */
+static void http_client_finish( HTTPClientRequest_t *request, HTTPClientEvent_t event, OSStatus err )
+{
+  if( request->message ) free( request->message );
+  request->message = NULL;
+  request->next = NULL;
+  request->err = err;
+  if( event == kHTTPClientEvent_Error ){
+    request->response = NULL;
+    http_client_log( "%s %s%s failed, err = %d", request->method, request->host, request->path, err );
+  }
+  request->onEvent( request, event, NULL, 0 );
+}
+
+static OSStatus http_client_build_message( HTTPClientRequest_t *request )
+{
+  OSStatus err = kNoErr;
+  char port[8] = "";
+  char length[40] = "";
+  int len;
+
+  if( request->port != 80 )
+    sprintf( port, ":%d", request->port );
+
+  if( request->body || ( request->onSendBody && request->bodyLen ) )
+    sprintf( length, "Content-Length: %lu\r\n", (unsigned long)request->bodyLen );
+  else if( request->onSendBody )
+    strcpy( length, "Transfer-Encoding: chunked\r\n" );
+  else if( !http_client_is_idempotent( request ) )
+    strcpy( length, "Content-Length: 0\r\n" );
+
+#define HTTP_CLIENT_MESSAGE_FORMAT "%s %s HTTP/1.1\r\nHost: %s%s\r\n%s%s\r\n"
+  len = snprintf( NULL, 0, HTTP_CLIENT_MESSAGE_FORMAT, request->method, request->path, request->host, port,
+                  length, request->headers ? request->headers : "" );
+  require_action( len > 0, exit, err = kParamErr );
+  request->message = malloc( len + 1 );
+  require_action( request->message, exit, err = kNoMemoryErr );
+  sprintf( request->message, HTTP_CLIENT_MESSAGE_FORMAT, request->method, request->path, request->host, port,
+           length, request->headers ? request->headers : "" );
+  request->messageLen = len;
+
+exit:
+  return err;
+}
+
+static bool http_client_would_block( int fd )
+{
+  int so_error = 0;
+  socklen_t len = sizeof(so_error);
+
+  getsockopt( fd, SOL_SOCKET, SO_ERROR, &so_error, &len );
+  /* lwIP reports a full send buffer as ENOMEM */
+  return so_error == EAGAIN || so_error == EWOULDBLOCK || so_error == ENOMEM;
+}
+
+/* A request that never got an answer is sent again once on a new connection, as
+   long as that cannot do anything twice on the server */
+static bool http_client_can_retry( http_client_conn_t *conn, HTTPClientRequest_t *request, OSStatus err )
+{
+  if( err == kTimeoutErr || request->retried || request->onSendBody ) return false;
+  if( !http_client_is_idempotent( request ) ) return false;
+  if( conn->state != kConnState_Open ) return false;
+  return !( request == conn->queue && conn->responseStarted );
+}
+
+static void http_client_conn_close( http_client_conn_t *conn, OSStatus err )
+{
+  HTTPClientRequest_t *request, *next;
+  HTTPClientRequest_t **retry = &http_client_retry;
+
+  while( *retry ) retry = &(*retry)->next;
+
+  for( request = conn->queue; request; request = next ){
+    next = request->next;
+    if( http_client_can_retry( conn, request, request->err ? request->err : err ) ){
+      request->retried = true;
+      request->state = kRequestState_Pending;
+      request->next = NULL;
+      *retry = request;
+      retry = &request->next;
+    }else{
+      http_client_finish( request, kHTTPClientEvent_Error, request->err ? request->err : err );
+    }
+  }
+
+  SocketClose( &conn->fd );
+  HTTPHeaderDestory( &conn->header );
+  if( conn->txBuf ) free( conn->txBuf );
+  memset( conn, 0x0, sizeof(http_client_conn_t) );
+  conn->fd = -1;
+  conn->state = kConnState_Free;
+}
+
+/* Runs in the DNS resolver thread, or in the client thread when the address is cached */
+static void http_client_host_resolved( const char *hostname, uint32_t ip, OSStatus err, void *arg )
+{
+  http_client_resolved_t *resolved, **tail;
+
+  UNUSED_PARAMETER( hostname );
+
+  /* The connection times out with its requests if this is lost */
+  resolved = malloc( sizeof(http_client_resolved_t) );
+  require( resolved, exit );
+  resolved->resolveId = (uint32_t)(uintptr_t)arg;
+  resolved->ip = ip;
+  resolved->err = err;
+  resolved->next = NULL;
+
+  mico_rtos_lock_mutex( &http_client_mutex );
+  for( tail = &http_client_resolved; *tail; tail = &(*tail)->next );
+  *tail = resolved;
+  mico_rtos_unlock_mutex( &http_client_mutex );
+  mico_rtos_set_semaphore( &http_client_wakeup_sem );
+
+exit:
+  return;
+}
+
+/* The connection is used at once, the host is looked up while requests queue on it */
+static OSStatus http_client_conn_open( http_client_conn_t *conn, HTTPClientRequest_t *request )
+{
+  OSStatus err = kNoErr;
+
+  memset( conn, 0x0, sizeof(http_client_conn_t) );
+  conn->fd = -1;
+  strcpy( conn->host, request->host );
+  conn->port = request->port;
+  conn->state = kConnState_Resolving;
+  conn->resolveId = ++http_client_resolve_id;
+  conn->lastActive = mico_get_time();
+
+  conn->header = HTTPHeaderCreate( HTTP_CLIENT_HEADER_LEN );
+  require_action( conn->header, exit, err = kNoMemoryErr );
+
+  err = mico_system_dns_resolve_async( request->host, http_client_host_resolved, (void *)(uintptr_t)conn->resolveId );
+  require_noerr( err, exit );
+
+exit:
+  if( err != kNoErr ){
+    http_client_log( "Connect %s:%d failed, err = %d", request->host, request->port, err );
+    HTTPHeaderDestory( &conn->header );
+    conn->state = kConnState_Free;
+  }
+  return err;
+}
+
+static OSStatus http_client_conn_connect( http_client_conn_t *conn, uint32_t ip )
+{
+  OSStatus err = kNoErr;
+  struct sockaddr_t addr;
+  int opt = 1;
+  int so_error = 0;
+  socklen_t len = sizeof(so_error);
+
+  conn->fd = socket( AF_INET, SOCK_STREAM, IPPROTO_TCP );
+  require_action( IsValidSocket( conn->fd ), exit, err = kNoResourcesErr );
+  setsockopt( conn->fd, SOL_SOCKET, SO_BLOCKMODE, &opt, sizeof(opt) );
+
+  addr.s_ip = ip;
+  addr.s_port = conn->port;
+  if( connect( conn->fd, &addr, sizeof(addr) ) < 0 ){
+    getsockopt( conn->fd, SOL_SOCKET, SO_ERROR, &so_error, &len );
+    require_action( so_error == EINPROGRESS, exit, err = kConnectionErr );
+  }
+  conn->state = kConnState_Connecting;
+
+exit:
+  if( err != kNoErr )
+    http_client_log( "Connect %s:%d failed, err = %d", conn->host, conn->port, err );
+  return err;
+}
+
+/* Connect the connections whose host has been looked up */
+static void http_client_connect_resolved( http_client_resolved_t *resolved )
+{
+  http_client_resolved_t *next;
+  http_client_conn_t *conn;
+  OSStatus err;
+  int i;
+
+  for( ; resolved; resolved = next ){
+    next = resolved->next;
+    for( i = 0; i < HTTP_CLIENT_MAX_CONNECTIONS; i++ ){
+      conn = &http_client_conns[i];
+      if( conn->state != kConnState_Resolving || conn->resolveId != resolved->resolveId ) continue;
+      err = resolved->err;
+      if( err == kNoErr )
+        err = http_client_conn_connect( conn, resolved->ip );
+      else
+        http_client_log( "Resolve %s failed, err = %d", conn->host, err );
+      if( err != kNoErr )
+        http_client_conn_close( conn, err );
+    }
+    free( resolved );
+  }
+}
+
+/* The socket got writable while connecting */
+static OSStatus http_client_conn_established( http_client_conn_t *conn )
+{
+  OSStatus err = kNoErr;
+  int so_error = 0;
+  socklen_t len = sizeof(so_error);
+
+  getsockopt( conn->fd, SOL_SOCKET, SO_ERROR, &so_error, &len );
+  require_action( so_error == 0, exit, err = kConnectionErr );
+
+  conn->state = kConnState_Open;
+  conn->lastActive = mico_get_time();
+
+exit:
+  if( err != kNoErr )
+    http_client_log( "Connect %s:%d failed, err = %d", conn->host, conn->port, so_error );
+  return err;
+}
+
+/* Gather the next bytes of conn->sending and the requests behind it in txBuf. A request
+   that fits goes out in one write: a small piece written on its own is held back by the
+   Nagle algorithm until the last one is acked, and the server may delay that ack. */
+static OSStatus http_client_next_piece( http_client_conn_t *conn )
+{
+  OSStatus err = kNoErr;
+  HTTPClientRequest_t *request;
+  size_t room, len;
+  int n, prefixLen;
+  char prefix[HTTP_CLIENT_CHUNK_PREFIX_LEN];
+
+  /* A long body is written from where it is */
+  request = conn->sending;
+  if( request->state == kRequestState_Body && request->body && request->bodyLen - conn->partSent >= HTTP_CLIENT_TX_LEN ){
+    conn->txPtr = request->body + conn->partSent;
+    conn->txLen = request->bodyLen - conn->partSent;
+    request->state = kRequestState_Sent;
+    goto exit;
+  }
+
+  if( conn->txBuf == NULL ){
+    conn->txBuf = malloc( HTTP_CLIENT_TX_LEN );
+    require_action( conn->txBuf, exit, err = kNoMemoryErr );
+  }
+  conn->txPtr = conn->txBuf;
+
+  while( conn->sending && conn->txLen < HTTP_CLIENT_TX_LEN ){
+    request = conn->sending;
+    room = HTTP_CLIENT_TX_LEN - conn->txLen;
+
+    if( request->state == kRequestState_Header ){
+      len = request->messageLen - conn->partSent;
+      if( len > room ) len = room;
+      memcpy( conn->txBuf + conn->txLen, request->message + conn->partSent, len );
+      conn->txLen += len;
+      conn->partSent += len;
+      if( conn->partSent == request->messageLen ){
+        conn->partSent = 0;
+        request->state = ( request->body || request->onSendBody ) ? kRequestState_Body : kRequestState_Sent;
+      }
+    }else if( request->state == kRequestState_Body && request->body ){
+      len = request->bodyLen - conn->partSent;
+      if( len > room ) len = room;
+      memcpy( conn->txBuf + conn->txLen, request->body + conn->partSent, len );
+      conn->txLen += len;
+      conn->partSent += len;
+      if( conn->partSent == request->bodyLen )
+        request->state = kRequestState_Sent;
+    }else if( request->state == kRequestState_Body && request->bodyLen ){
+      len = request->bodyLen - conn->partSent;
+      if( len > room ) len = room;
+      n = request->onSendBody( request, conn->txBuf + conn->txLen, len );
+      require_action( n > 0 && (size_t)n <= len, exit, err = ( n == 0 ) ? kUnderrunErr : kReadErr );
+      conn->txLen += n;
+      conn->partSent += n;
+      if( conn->partSent == request->bodyLen )
+        request->state = kRequestState_Sent;
+    }else if( request->state == kRequestState_Body ){
+      /* Chunked: the data is read behind the room for its size line, which is put in front of it after */
+      if( room < HTTP_CLIENT_CHUNK_PREFIX_LEN + 2 + 5 + 1 ) break;
+      len = room - HTTP_CLIENT_CHUNK_PREFIX_LEN - 2 - 5;
+      n = request->onSendBody( request, conn->txBuf + conn->txLen + HTTP_CLIENT_CHUNK_PREFIX_LEN, len );
+      require_action( n >= 0 && (size_t)n <= len, exit, err = kReadErr );
+      if( n > 0 ){
+        prefixLen = sprintf( prefix, "%x\r\n", n );
+        memmove( conn->txBuf + conn->txLen + prefixLen, conn->txBuf + conn->txLen + HTTP_CLIENT_CHUNK_PREFIX_LEN, n );
+        memcpy( conn->txBuf + conn->txLen, prefix, prefixLen );
+        memcpy( conn->txBuf + conn->txLen + prefixLen + n, "\r\n", 2 );
+        conn->txLen += prefixLen + n + 2;
+        conn->partSent += n;
+      }else{
+        memcpy( conn->txBuf + conn->txLen, "0\r\n\r\n", 5 );
+        conn->txLen += 5;
+        request->state = kRequestState_Sent;
+      }
+    }
+
+    if( request->state == kRequestState_Sent ){
+      conn->partSent = 0;
+      conn->sending = request->next;
+    }
+  }
+
+exit:
+  return err;
+}
+
+static OSStatus http_client_conn_send( http_client_conn_t *conn )
+{
+  OSStatus err = kNoErr;
+  int n;
+
+  while( conn->sending || conn->txLen ){
+    if( conn->txLen == 0 ){
+      err = http_client_next_piece( conn );
+      require_noerr( err, exit );
+      continue;
+    }
+
+    n = send( conn->fd, conn->txPtr, conn->txLen, 0 );
+    if( n < 0 && http_client_would_block( conn->fd ) ) break;
+    require_action( n > 0, exit, err = kConnectionErr );
+    conn->txPtr += n;
+    conn->txLen -= n;
+    conn->lastActive = mico_get_time();
+  }
+
+exit:
+  return err;
+}
+
+static void http_client_response_done( http_client_conn_t *conn )
+{
+  HTTPClientRequest_t *request = conn->queue;
+
+  conn->queue = request->next;
+  conn->responseCount++;
+  conn->responseState = kResponse_Header;
+  conn->responseStarted = false;
+  if( !conn->header->persistent )
+    conn->closing = true;
+
+  request->response = conn->header;
+  http_client_finish( request, kHTTPClientEvent_Done, kNoErr );
+
+  conn->header->len = 0;
+  conn->header->scanOffset = 0;
+}
+
+static void http_client_deliver( http_client_conn_t *conn, const uint8_t *data, size_t len )
+{
+  HTTPClientRequest_t *request = conn->queue;
+
+  if( len == 0 ) return;
+  request->response = conn->header;
+  request->onEvent( request, kHTTPClientEvent_Body, data, len );
+}
+
+static OSStatus http_client_header_done( http_client_conn_t *conn )
+{
+  OSStatus err = kNoErr;
+  HTTPHeader_t *header = conn->header;
+  HTTPClientRequest_t *request = conn->queue;
+
+  err = HTTPHeaderParse( header );
+  require_noerr( err, exit );
+
+  /* 100 Continue and the like are followed by the real response */
+  if( header->statusCode >= 100 && header->statusCode < 200 ){
+    header->len = 0;
+    header->scanOffset = 0;
+    goto exit;
+  }
+
+  conn->pipelining = header->persistent && strnicmpx( header->protocolPtr, header->protocolLen, "HTTP/1.1" ) == 0;
+  request->response = header;
+  request->onEvent( request, kHTTPClientEvent_Header, NULL, 0 );
+
+  if( strcasecmp( request->method, "HEAD" ) == 0 || header->statusCode == 204 || header->statusCode == 304 ){
+    http_client_response_done( conn );
+  }else if( header->chunkedData ){
+    conn->responseState = kResponse_ChunkSize;
+    conn->contentLeft = 0;
+    conn->chunkExtension = false;
+  }else if( header->fields[kHTTPHeaderField_ContentLength].valuePtr ){
+    conn->responseState = kResponse_Body;
+    conn->contentLeft = header->contentLength;
+    if( conn->contentLeft == 0 )
+      http_client_response_done( conn );
+  }else{
+    conn->responseState = kResponse_BodyUntilClose;
+    conn->pipelining = false;
+  }
+
+exit:
+  return err;
+}
+
+/* Feed bytes read from the connection to the response parser, a read may end one response and start the next */
+static OSStatus http_client_conn_receive( http_client_conn_t *conn, const uint8_t *data, size_t len )
+{
+  OSStatus err = kNoErr;
+  HTTPHeader_t *header = conn->header;
+  char *end;
+  size_t n, extra;
+  uint8_t c;
+
+  while( len > 0 && !conn->closing ){
+    require_action( conn->queue, exit, err = kResponseErr );
+    conn->responseStarted = true;
+
+    switch( conn->responseState )
+    {
+      case kResponse_Header:
+        n = header->bufLen - 1 - header->len;
+        require_action( n > 0, exit, err = kNoSpaceErr );
+        if( n > len ) n = len;
+        memcpy( header->buf + header->len, data, n );
+        header->len += n;
+        if( !findHeader( header, &end ) ){
+          data += n;
+          len -= n;
+          break;
+        }
+        /* Whatever follows the header came with this read */
+        extra = header->buf + header->len - end;
+        data += n - extra;
+        len -= n - extra;
+        header->len = end - header->buf;
+        err = http_client_header_done( conn );
+        require_noerr( err, exit );
+        break;
+
+      case kResponse_Body:
+        n = ( conn->contentLeft < len ) ? (size_t)conn->contentLeft : len;
+        http_client_deliver( conn, data, n );
+        data += n;
+        len -= n;
+        conn->contentLeft -= n;
+        if( conn->contentLeft == 0 )
+          http_client_response_done( conn );
+        break;
+
+      case kResponse_BodyUntilClose:
+        http_client_deliver( conn, data, len );
+        len = 0;
+        break;
+
+      case kResponse_ChunkSize:
+        c = *data++;
+        len--;
+        if( c == '\n' ){
+          conn->chunkExtension = false;
+          if( conn->contentLeft ){
+            conn->responseState = kResponse_ChunkData;
+          }else{
+            conn->responseState = kResponse_Trailer;
+            conn->lineLen = 0;
+          }
+        }else if( !conn->chunkExtension && isxdigit( c ) ){
+          require_action( conn->contentLeft < 0x10000000, exit, err = kMalformedErr );
+          conn->contentLeft = conn->contentLeft * 16 + ( isdigit( c ) ? c - '0' : ( tolower( c ) - 'a' + 10 ) );
+        }else if( c != '\r' ){
+          conn->chunkExtension = true;
+        }
+        break;
+
+      case kResponse_ChunkData:
+        n = ( conn->contentLeft < len ) ? (size_t)conn->contentLeft : len;
+        http_client_deliver( conn, data, n );
+        data += n;
+        len -= n;
+        conn->contentLeft -= n;
+        if( conn->contentLeft == 0 )
+          conn->responseState = kResponse_ChunkEnd;
+        break;
+
+      case kResponse_ChunkEnd:
+        c = *data++;
+        len--;
+        if( c == '\n' )
+          conn->responseState = kResponse_ChunkSize;
+        break;
+
+      case kResponse_Trailer:
+        c = *data++;
+        len--;
+        if( c == '\n' ){
+          if( conn->lineLen == 0 )
+            http_client_response_done( conn );
+          conn->lineLen = 0;
+        }else if( c != '\r' ){
+          conn->lineLen++;
+        }
+        break;
+    }
+  }
+
+  /* Bytes behind a response that asked to close belong to nothing */
+  if( len > 0 ) conn->closing = true;
+
+exit:
+  return err;
+}
+
+static OSStatus http_client_conn_read( http_client_conn_t *conn )
+{
+  OSStatus err = kNoErr;
+  int n;
+
+  n = recv( conn->fd, http_client_rx, sizeof(http_client_rx), 0 );
+  if( n > 0 ){
+    conn->lastActive = mico_get_time();
+    err = http_client_conn_receive( conn, http_client_rx, n );
+  }else if( n == 0 || !http_client_would_block( conn->fd ) ){
+    /* A body without a length ends here */
+    if( conn->queue && conn->responseState == kResponse_BodyUntilClose )
+      http_client_response_done( conn );
+    err = kConnectionErr;
+  }
+
+  return err;
+}
+
+static bool http_client_conn_matches( http_client_conn_t *conn, HTTPClientRequest_t *request )
+{
+  return conn->port == request->port && strcasecmp( conn->host, request->host ) == 0;
+}
+
+static bool http_client_conn_can_take( http_client_conn_t *conn, HTTPClientRequest_t *request )
+{
+  HTTPClientRequest_t *queued;
+  int depth = 0;
+
+  if( conn->queue == NULL ) return true;
+  if( conn->state != kConnState_Open || !conn->pipelining || !http_client_is_idempotent( request ) )
+    return false;
+  for( queued = conn->queue; queued; queued = queued->next ){
+    if( !http_client_is_idempotent( queued ) ) return false;
+    depth++;
+  }
+  return depth < HTTP_CLIENT_PIPELINE_DEPTH;
+}
+
+static int http_client_conn_depth( http_client_conn_t *conn )
+{
+  HTTPClientRequest_t *queued;
+  int depth = 0;
+
+  for( queued = conn->queue; queued; queued = queued->next ) depth++;
+  return depth;
+}
+
+/* Pick a connection for the request: an idle kept one, a new one, or one to pipeline
+   on. *outConn is NULL when the request has to wait. */
+static OSStatus http_client_conn_for( HTTPClientRequest_t *request, http_client_conn_t **outConn )
+{
+  OSStatus err = kNoErr;
+  http_client_conn_t *conn, *best = NULL, *slot = NULL, *victim = NULL;
+  int i, count = 0;
+
+  for( i = 0; i < HTTP_CLIENT_MAX_CONNECTIONS; i++ ){
+    conn = &http_client_conns[i];
+    if( conn->state == kConnState_Free ){
+      if( slot == NULL ) slot = conn;
+      continue;
+    }
+    if( !http_client_conn_matches( conn, request ) ){
+      if( conn->queue == NULL && conn->state == kConnState_Open
+         && ( victim == NULL || (int32_t)( conn->lastActive - victim->lastActive ) < 0 ) )
+        victim = conn;
+      continue;
+    }
+    count++;
+    if( http_client_conn_can_take( conn, request )
+       && ( best == NULL || http_client_conn_depth( conn ) < http_client_conn_depth( best ) ) )
+      best = conn;
+  }
+
+  if( ( best == NULL || best->queue ) && count < HTTP_CLIENT_MAX_HOST_CONNECTIONS ){
+    /* Make room by closing the connection to another host that was unused for the longest time */
+    if( slot == NULL && victim ){
+      http_client_conn_close( victim, kNoErr );
+      slot = victim;
+    }
+    if( slot ){
+      err = http_client_conn_open( slot, request );
+      if( err == kNoErr )
+        best = slot;
+      else if( best )
+        err = kNoErr;  // Pipeline on the busy one instead
+    }
+  }
+
+  *outConn = best;
+  return err;
+}
+
+static void http_client_dispatch( void )
+{
+  OSStatus err;
+  HTTPClientRequest_t **prev = &http_client_pending;
+  HTTPClientRequest_t *request;
+  http_client_conn_t *conn;
+
+  while( ( request = *prev ) != NULL ){
+    err = http_client_conn_for( request, &conn );
+    if( err == kNoErr && conn == NULL ){
+      prev = &request->next;
+      continue;
+    }
+
+    *prev = request->next;
+    if( err != kNoErr ){
+      http_client_finish( request, kHTTPClientEvent_Error, err );
+      continue;
+    }
+
+    request->state = kRequestState_Header;
+    http_client_append( &conn->queue, request );
+    if( conn->sending == NULL )
+      conn->sending = request;
+    if( conn->state == kConnState_Open ){
+      err = http_client_conn_send( conn );
+      if( err != kNoErr )
+        http_client_conn_close( conn, err );
+    }
+  }
+}
+
+static void http_client_check_timeouts( void )
+{
+  HTTPClientRequest_t **prev = &http_client_pending;
+  HTTPClientRequest_t *request;
+  http_client_conn_t *conn;
+  uint32_t now = mico_get_time();
+  bool expired;
+  int i;
+
+  while( ( request = *prev ) != NULL ){
+    if( (int32_t)( request->deadline - now ) > 0 ){
+      prev = &request->next;
+      continue;
+    }
+    *prev = request->next;
+    http_client_finish( request, kHTTPClientEvent_Error, kTimeoutErr );
+  }
+
+  for( i = 0; i < HTTP_CLIENT_MAX_CONNECTIONS; i++ ){
+    conn = &http_client_conns[i];
+    if( conn->state == kConnState_Free ) continue;
+
+    if( conn->queue == NULL ){
+      if( now - conn->lastActive >= HTTP_CLIENT_IDLE_TIMEOUT )
+        http_client_conn_close( conn, kNoErr );
+      continue;
+    }
+
+    /* The answers behind an expired request can only come after it, so the connection
+       goes and the other requests are sent again or fail with it */
+    expired = false;
+    for( request = conn->queue; request; request = request->next ){
+      if( (int32_t)( request->deadline - now ) <= 0 ){
+        request->err = kTimeoutErr;
+        expired = true;
+      }
+    }
+    if( expired )
+      http_client_conn_close( conn, kConnectionErr );
+  }
+}
+
+/* ms until the next deadline or idle connection expires */
+static uint32_t http_client_next_timeout( void )
+{
+  HTTPClientRequest_t *request;
+  http_client_conn_t *conn;
+  uint32_t now = mico_get_time();
+  int32_t wait = HTTP_CLIENT_IDLE_TIMEOUT;
+  int32_t left;
+  int i;
+
+  if( http_client_retry ) return 0;
+
+  for( request = http_client_pending; request; request = request->next ){
+    left = (int32_t)( request->deadline - now );
+    if( left < wait ) wait = left;
+  }
+
+  for( i = 0; i < HTTP_CLIENT_MAX_CONNECTIONS; i++ ){
+    conn = &http_client_conns[i];
+    if( conn->state == kConnState_Free ) continue;
+    if( conn->queue == NULL ){
+      left = (int32_t)( conn->lastActive + HTTP_CLIENT_IDLE_TIMEOUT - now );
+      if( left < wait ) wait = left;
+    }
+    for( request = conn->queue; request; request = request->next ){
+      left = (int32_t)( request->deadline - now );
+      if( left < wait ) wait = left;
+    }
+  }
+
+  return ( wait > 0 ) ? wait : 0;
+}
+
+static void http_client_thread( void *arg )
+{
+  UNUSED_PARAMETER( arg );
+  OSStatus err;
+  http_client_conn_t *conn;
+  HTTPClientRequest_t *incoming, **tail;
+  http_client_resolved_t *resolved;
+  fd_set readfds, writefds;
+  struct timeval_t t;
+  uint32_t wait;
+  bool close_idle;
+  int wakeup_fd, max_fd, i;
+
+  wakeup_fd = mico_create_event_fd( http_client_wakeup_sem );
+
+  while( 1 ){
+    mico_rtos_lock_mutex( &http_client_mutex );
+    incoming = http_client_incoming;
+    http_client_incoming = NULL;
+    close_idle = http_client_close_idle;
+    http_client_close_idle = false;
+    resolved = http_client_resolved;
+    http_client_resolved = NULL;
+    mico_rtos_unlock_mutex( &http_client_mutex );
+
+    http_client_connect_resolved( resolved );
+
+    /* Requests lost with a connection go before everything that waits */
+    if( http_client_retry ){
+      for( tail = &http_client_retry; *tail; tail = &(*tail)->next );
+      *tail = http_client_pending;
+      http_client_pending = http_client_retry;
+      http_client_retry = NULL;
+    }
+    for( tail = &http_client_pending; *tail; tail = &(*tail)->next );
+    *tail = incoming;
+
+    if( close_idle ){
+      for( i = 0; i < HTTP_CLIENT_MAX_CONNECTIONS; i++ ){
+        if( http_client_conns[i].state == kConnState_Open && http_client_conns[i].queue == NULL )
+          http_client_conn_close( &http_client_conns[i], kNoErr );
+      }
+    }
+
+    http_client_dispatch( );
+
+    FD_ZERO( &readfds );
+    FD_ZERO( &writefds );
+    FD_SET( wakeup_fd, &readfds );
+    max_fd = wakeup_fd;
+    for( i = 0; i < HTTP_CLIENT_MAX_CONNECTIONS; i++ ){
+      conn = &http_client_conns[i];
+      if( conn->state == kConnState_Free || conn->state == kConnState_Resolving ) continue;
+      if( conn->state == kConnState_Connecting || conn->sending || conn->txLen )
+        FD_SET( conn->fd, &writefds );
+      if( conn->state == kConnState_Open )
+        FD_SET( conn->fd, &readfds );
+      if( conn->fd > max_fd ) max_fd = conn->fd;
+    }
+
+    wait = http_client_next_timeout( );
+    t.tv_sec = wait / 1000;
+    t.tv_usec = ( wait % 1000 ) * 1000;
+    select( max_fd + 1, &readfds, &writefds, NULL, &t );
+
+    if( FD_ISSET( wakeup_fd, &readfds ) )
+      mico_rtos_get_semaphore( &http_client_wakeup_sem, 0 );
+
+    for( i = 0; i < HTTP_CLIENT_MAX_CONNECTIONS; i++ ){
+      conn = &http_client_conns[i];
+      err = kNoErr;
+
+      if( conn->state == kConnState_Connecting && FD_ISSET( conn->fd, &writefds ) ){
+        err = http_client_conn_established( conn );
+        if( err == kNoErr ) err = http_client_conn_send( conn );
+      }
+      else if( conn->state == kConnState_Open ){
+        if( FD_ISSET( conn->fd, &readfds ) )
+          err = http_client_conn_read( conn );
+        if( err == kNoErr && !conn->closing && ( conn->sending || conn->txLen ) && FD_ISSET( conn->fd, &writefds ) )
+          err = http_client_conn_send( conn );
+      }
+
+      if( err != kNoErr )
+        http_client_conn_close( conn, err );
+      else if( conn->closing )
+        http_client_conn_close( conn, kConnectionErr );
+    }
+
+    http_client_check_timeouts( );
+  }
+}
+
+OSStatus HTTPClientStart( void )
+{
+  OSStatus err = kNoErr;
+  int i;
+
+  require_quiet( !http_client_running, exit );
+
+  for( i = 0; i < HTTP_CLIENT_MAX_CONNECTIONS; i++ ){
+    http_client_conns[i].state = kConnState_Free;
+    http_client_conns[i].fd = -1;
+  }
+
+  err = mico_rtos_init_mutex( &http_client_mutex );
+  require_noerr( err, exit );
+  err = mico_rtos_init_semaphore( &http_client_wakeup_sem, 1 );
+  require_noerr( err, exit );
+  err = mico_rtos_create_thread( NULL, MICO_APPLICATION_PRIORITY, "HTTP Client", http_client_thread, HTTP_CLIENT_THREAD_STACK_SIZE, NULL );
+  require_noerr( err, exit );
+  http_client_running = true;
+
+exit:
+  return err;
+}
+
+void HTTPClientRequestInit( HTTPClientRequest_t *request, const char *host, uint16_t port, bool useSSL, const char *method, const char *path, HTTPClientEventCallback onEvent, void *userContext )
+{
+  memset( request, 0x0, sizeof(HTTPClientRequest_t) );
+  request->host = host;
+  request->port = port;
+  request->useSSL = useSSL;
+  request->method = method;
+  request->path = path;
+  request->onEvent = onEvent;
+  request->userContext = userContext;
+  request->timeout = HTTP_CLIENT_DEFAULT_TIMEOUT;
+}
+
+OSStatus HTTPClientSend( HTTPClientRequest_t *request )
+{
+  OSStatus err = kNoErr;
+
+  require_action( request && request->host && request->method && request->path && request->onEvent, exit, err = kParamErr );
+  require_action( strlen( request->host ) < HTTP_CLIENT_HOST_LEN, exit, err = kParamErr );
+  /* ssl_connect() and ssl_recv() block, and would stall every other connection, see HTTPClientConnection_t */
+  require_action( !request->useSSL, exit, err = kUnsupportedErr );
+
+  err = HTTPClientStart( );
+  require_noerr( err, exit );
+
+  request->message = NULL;
+  err = http_client_build_message( request );
+  require_noerr( err, exit );
+
+  request->response = NULL;
+  request->err = kNoErr;
+  request->state = kRequestState_Pending;
+  request->retried = false;
+  request->deadline = mico_get_time() + ( request->timeout ? request->timeout : HTTP_CLIENT_DEFAULT_TIMEOUT );
+
+  mico_rtos_lock_mutex( &http_client_mutex );
+  http_client_append( &http_client_incoming, request );
+  mico_rtos_unlock_mutex( &http_client_mutex );
+  mico_rtos_set_semaphore( &http_client_wakeup_sem );
+
+exit:
+  return err;
+}
+
+void HTTPClientCloseIdleConnections( void )
+{
+  if( !http_client_running ) return;
+  mico_rtos_lock_mutex( &http_client_mutex );
+  http_client_close_idle = true;
+  mico_rtos_unlock_mutex( &http_client_mutex );
+  mico_rtos_set_semaphore( &http_client_wakeup_sem );
+}
+
+void HTTPClientConnectionInit( HTTPClientConnection_t *conn, const char *host, uint16_t port, bool useSSL )
+{
+  memset( conn, 0x0, sizeof(HTTPClientConnection_t) );
+  conn->host = host;
+  conn->port = port;
+  conn->useSSL = useSSL;
+  conn->fd = -1;
+}
+
+void HTTPClientConnectionClose( HTTPClientConnection_t *conn )
+{
+  if( conn->ssl ){
+    ssl_close( conn->ssl );
+    conn->ssl = NULL;
+  }
+  SocketClose( &conn->fd );
+  conn->fd = -1;
+  conn->requestCount = 0;
+}
+
+static OSStatus http_client_connection_connect( HTTPClientConnection_t *conn )
+{
+  OSStatus err = kNoErr;
+  struct sockaddr_t addr;
+  char ipstr[16];
+  int ssl_errno = 0;
+
+  /* The address is kept in the system DNS cache as long as its TTL allows */
+  err = mico_system_dns_resolve( conn->host, &addr.s_ip, HTTP_CLIENT_RESPONSE_TIMEOUT );
+  require_noerr( err, exit );
+
+  conn->fd = socket( AF_INET, SOCK_STREAM, IPPROTO_TCP );
+  require_action( IsValidSocket( conn->fd ), exit, err = kNoResourcesErr );
+  addr.s_port = conn->port;
+  err = connect( conn->fd, &addr, sizeof(addr) );
+  require_noerr( err, exit );
+
+  if( conn->useSSL ){
+    ssl_version_set( TLS_V1_2_MODE );
+    conn->ssl = ssl_connect( conn->fd, 0, NULL, &ssl_errno );
+    require_action( conn->ssl != NULL, exit, err = kConnectionErr );
+  }
+  http_client_log( "Connected to %s:%d", inet_ntoa( ipstr, addr.s_ip ), conn->port );
+
+exit:
+  if( err != kNoErr ){
+    http_client_log( "Connect %s:%d failed, err = %d, ssl errno = %d", conn->host, conn->port, err, ssl_errno );
+    HTTPClientConnectionClose( conn );
+  }
+  return err;
+}
+
+static OSStatus http_client_connection_exchange( HTTPClientConnection_t *conn, const char *request, size_t len, HTTPHeader_t *httpHeader )
+{
+  OSStatus err = kNoErr;
+  fd_set readfds;
+  struct timeval_t t;
+
+  if( conn->ssl )
+    require_action( ssl_send( conn->ssl, (void *)request, len ) == (int)len, exit, err = kConnectionErr );
+  else{
+    err = SocketSend( conn->fd, (const uint8_t *)request, len );
+    require_noerr( err, exit );
+  }
+
+  FD_ZERO( &readfds );
+  FD_SET( conn->fd, &readfds );
+  t.tv_sec = HTTP_CLIENT_RESPONSE_TIMEOUT / 1000;
+  t.tv_usec = 0;
+  select( conn->fd + 1, &readfds, NULL, NULL, &t );
+  require_action( FD_ISSET( conn->fd, &readfds ), exit, err = kTimeoutErr );
+
+  if( conn->ssl ){
+    err = SocketReadHTTPSHeader( conn->ssl, httpHeader );
+    require_noerr( err, exit );
+    err = SocketReadHTTPSBody( conn->ssl, httpHeader );
+    require_noerr( err, exit );
+  }else{
+    err = SocketReadHTTPHeader( conn->fd, httpHeader );
+    require_noerr( err, exit );
+    err = SocketReadHTTPBody( conn->fd, httpHeader );
+    require_noerr( err, exit );
+  }
+
+exit:
+  return err;
+}
+
+/* Doubles the delay on every failure */
+static void http_client_connection_backoff( HTTPClientConnection_t *conn )
+{
+  if( conn->retryDelay == 0 )
+    conn->retryDelay = HTTP_CLIENT_RETRY_MIN_DELAY;
+  else if( conn->retryDelay < HTTP_CLIENT_RETRY_MAX_DELAY / 2 )
+    conn->retryDelay *= 2;
+  else
+    conn->retryDelay = HTTP_CLIENT_RETRY_MAX_DELAY;
+}
+
+OSStatus HTTPClientConnectionRequest( HTTPClientConnection_t *conn, const char *request, size_t len, HTTPHeader_t *httpHeader )
+{
+  OSStatus err = kUnknownErr;
+  int attempt = 0;
+  bool reused;
+
+  while( attempt < HTTP_CLIENT_MAX_ATTEMPTS ){
+    if( conn->retryDelay ){
+      /* A little jitter from the tick keeps devices that lost the server at
+         the same time from coming back together */
+      http_client_log( "Retry %s after %d ms", conn->host, conn->retryDelay );
+      mico_thread_msleep( conn->retryDelay + mico_get_time() % ( conn->retryDelay / 4 + 1 ) );
+    }
+
+    reused = ( conn->fd >= 0 );
+    err = reused ? kNoErr : http_client_connection_connect( conn );
+    HTTPHeaderClear( httpHeader );
+    if( !reused ){
+      /* Nothing left over from an old connection belongs to this one */
+      httpHeader->len = 0;
+    }
+    if( err == kNoErr )
+      err = http_client_connection_exchange( conn, request, len, httpHeader );
+
+    if( err == kNoErr ){
+      conn->retryDelay = 0;
+      conn->requestCount++;
+      if( !httpHeader->persistent || httpHeader->dataEndedbyClose )
+        HTTPClientConnectionClose( conn );
+      break;
+    }
+
+    http_client_log( "Request to %s failed on %s connection, err = %d", conn->host, reused ? "kept" : "new", err );
+    HTTPClientConnectionClose( conn );
+    /* The server may drop a kept connection while it is idle, that is answered
+       by connecting again at once and does not count as an attempt */
+    if( reused )
+      continue;
+    http_client_connection_backoff( conn );
+    attempt++;
+  }
+
+  return err;
+}
@@ -0,0 +1,137 @@
+/**
+******************************************************************************
+* @file    HTTPClientUtils.h
+* @author  William Xu
+* @version V1.0.0
+* @date    17-Oct-2026
+* @brief   This header contains function prototypes of an asynchronous HTTP/1.1
+  client. All requests are served by one thread over a pool of kept connections.
+  HTTPS requests go through a blocking connection in the caller's thread.
+******************************************************************************
+* @attention
+*
+* THE PRESENT FIRMWARE WHICH IS FOR GUIDANCE ONLY AIMS AT PROVIDING CUSTOMERS
+* WITH CODING INFORMATION REGARDING THEIR PRODUCTS IN ORDER FOR THEM TO SAVE
+* TIME. AS A RESULT, MXCHIP Inc. SHALL NOT BE HELD LIABLE FOR ANY
+* DIRECT, INDIRECT OR CONSEQUENTIAL DAMAGES WITH RESPECT TO ANY CLAIMS ARISING
+* FROM THE CONTENT OF SUCH FIRMWARE AND/OR THE USE MADE BY CUSTOMERS OF THE
+* CODING INFORMATION CONTAINED HEREIN IN CONNECTION WITH THEIR PRODUCTS.
+*
+* <h2><center>&copy; COPYRIGHT 2014 MXCHIP Inc.</center></h2>
+******************************************************************************
+*/
+
+
+#ifndef __HTTPClientUtils_h__
+#define __HTTPClientUtils_h__
+
+#include "Common.h"
+#include "mico.h"
+#include "HTTPUtils.h"
+
+#define HTTP_CLIENT_MAX_CONNECTIONS     4             // Connections kept open at the same time, for all hosts
+#define HTTP_CLIENT_MAX_HOST_CONNECTIONS 2            // Connections opened to one host:port
+#define HTTP_CLIENT_PIPELINE_DEPTH      4             // Requests sent on one connection before its first response is back
+#define HTTP_CLIENT_HOST_LEN            64
+#define HTTP_CLIENT_HEADER_LEN          1024          // Longest response header
+#define HTTP_CLIENT_DEFAULT_TIMEOUT     (30*1000)     // ms for a request, from HTTPClientSend to the end of the response
+#define HTTP_CLIENT_IDLE_TIMEOUT        (30*1000)     // ms an unused connection is kept open
+
+#define HTTP_CLIENT_RESPONSE_TIMEOUT    (10*1000)     // ms a blocking connection waits for the response header
+#define HTTP_CLIENT_RETRY_MIN_DELAY     500           // ms before its first retry, doubled on each failure
+#define HTTP_CLIENT_RETRY_MAX_DELAY     (32*1000)
+#define HTTP_CLIENT_MAX_ATTEMPTS        5             // attempts made by one HTTPClientConnectionRequest
+
+#ifndef HTTP_CLIENT_THREAD_STACK_SIZE
+#define HTTP_CLIENT_THREAD_STACK_SIZE   0x1000
+#endif
+
+typedef enum
+{
+  kHTTPClientEvent_Header,      //! The response header is parsed, see request->response.
+  kHTTPClientEvent_Body,        //! A piece of the response body, chunked bodies arrive decoded.
+  kHTTPClientEvent_Done,        //! The response is complete. The request is no longer used by the client.
+  kHTTPClientEvent_Error,       //! The request failed with request->err. The request is no longer used by the client.
+} HTTPClientEvent_t;
+
+struct _HTTPClientRequest_t;
+
+/* Called on the client thread for everything that happens to a request. data and len are only
+   set for kHTTPClientEvent_Body. The request may be freed or sent again from the last event. */
+typedef void (*HTTPClientEventCallback) ( struct _HTTPClientRequest_t *request, HTTPClientEvent_t event, const uint8_t *data, size_t len );
+
+/* Called on the client thread when the connection can take more of a streamed request body.
+   Copies up to len bytes to buf and returns their number, 0 at the end of the body, or a
+   negative value to fail the request. It must not wait for the data. */
+typedef int (*HTTPClientBodyCallback) ( struct _HTTPClientRequest_t *request, uint8_t *buf, size_t len );
+
+typedef struct _HTTPClientRequest_t
+{
+    /* Filled in by the application, HTTPClientRequestInit sets the defaults */
+    const char *            host;               //! Host name or dotted IP address.
+    uint16_t                port;
+    bool                    useSSL;             //! TLS is not supported, HTTPClientSend returns kUnsupportedErr. Use HTTPClientConnection_t.
+    const char *            method;             //! e.g. "GET", only GET and HEAD requests are pipelined.
+    const char *            path;               //! e.g. "/index.html?a=1".
+    const char *            headers;            //! Extra header lines, each ending with CRLF, or NULL.
+    const uint8_t *         body;               //! Request body sent as it is, or NULL.
+    size_t                  bodyLen;            //! Content-Length of body, or of a streamed body. 0 streams a body in chunks.
+    HTTPClientBodyCallback  onSendBody;         //! Produces the body piece by piece when body is NULL, or NULL for no body.
+    HTTPClientEventCallback onEvent;
+    void *                  userContext;
+    uint32_t                timeout;            //! ms until the request fails with kTimeoutErr.
+
+    /* Set by the client */
+    HTTPHeader_t *          response;           //! Parsed response header, valid during the events.
+    OSStatus                err;
+
+    /* Private */
+    struct _HTTPClientRequest_t *next;
+    char *                  message;            //! Request line and header.
+    size_t                  messageLen;
+    uint32_t                deadline;
+    uint8_t                 state;
+    bool                    retried;
+} HTTPClientRequest_t;
+
+/* A connection used by one thread. The ssl_* calls block, so an HTTPS request is sent and
+   answered in the caller's thread instead of the client thread. Define a stack of 0x3000
+   for a thread that uses TLS. */
+typedef struct _HTTPClientConnection_t
+{
+    const char *            host;
+    uint16_t                port;
+    bool                    useSSL;
+    int                     fd;
+    mico_ssl_t              ssl;
+    uint32_t                retryDelay;         //! ms to wait before the next attempt, 0 after a success.
+    uint32_t                requestCount;       //! Requests answered on the current connection.
+} HTTPClientConnection_t;
+
+/* Start the client thread, HTTPClientSend calls it when it is not running yet */
+OSStatus HTTPClientStart( void );
+
+/* Set up a request with no body, the default timeout and every other field zero */
+void HTTPClientRequestInit( HTTPClientRequest_t *request, const char *host, uint16_t port, bool useSSL, const char *method, const char *path, HTTPClientEventCallback onEvent, void *userContext );
+
+/* Queue a request and return at once, the result comes through request->onEvent. The request
+   and every buffer it points to stay untouched by the application until the last event. */
+OSStatus HTTPClientSend( HTTPClientRequest_t *request );
+
+/* Close every kept connection that has no request on it */
+void HTTPClientCloseIdleConnections( void );
+
+/* Set up a blocking connection, nothing is sent before the first request. host must stay valid. */
+void HTTPClientConnectionInit( HTTPClientConnection_t *conn, const char *host, uint16_t port, bool useSSL );
+
+/* Send a complete request and read the response into httpHeader, the body goes through its
+   onReceivedData callback. The connection is kept open for the next request unless the server
+   asks to close it. A failed attempt is retried on a new connection after an exponential
+   backoff, up to HTTP_CLIENT_MAX_ATTEMPTS times. The delay keeps growing over the following
+   calls until a request succeeds. */
+OSStatus HTTPClientConnectionRequest( HTTPClientConnection_t *conn, const char *request, size_t len, HTTPHeader_t *httpHeader );
+
+/* Close a blocking connection */
+void HTTPClientConnectionClose( HTTPClientConnection_t *conn );
+
+#endif // __HTTPClientUtils_h__
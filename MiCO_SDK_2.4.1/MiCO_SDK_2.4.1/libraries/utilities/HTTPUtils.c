@@ -33,33 +33,23 @@
 
 #define READ_LENGTH 1500
 
+// Names of the fields in HTTPHeader_t.fields, in HTTPHeaderField_t order.
+static const char * const kHTTPHeaderFieldNames[ kHTTPHeaderField_Count ] =
+{
+  "Content-Length",
+  "Transfer-Encoding",
+  "Content-Type",
+  "Connection",
+};
+
 extern int CyaSSL_get_fd( mico_ssl_t ssl);
 
-int SocketReadHTTPHeader( int inSock, HTTPHeader_t *inHeader )
+/* Header ends at end, the bytes up to dst that follow it are the start of the body */
+static int HTTPHeaderDidReceive( HTTPHeader_t *inHeader, char *end, char *dst )
 {
   int        err =0;
-  char *          buf;
-  char *          dst;
-  char *          lim;
-  char *          end;
-  size_t          len;
-  ssize_t         n;
-  
-  buf = inHeader->buf;
-  dst = buf + inHeader->len;
-  lim = buf + inHeader->bufLen;
-  for( ;; )
-  {
-    if(findHeader( inHeader,  &end ))
-      break ;
-    n = read( inSock, dst, (size_t)( lim - dst ) );
-    if(      n  > 0 ) len = (size_t) n;
-    else  { err = kConnectionErr; goto exit; }
-    dst += len;
-    inHeader->len += len;
-  }
-  
-  inHeader->len = (size_t)( end - buf );
+
+  inHeader->len = (size_t)( end - inHeader->buf );
   err = HTTPHeaderParse( inHeader );
   require_noerr( err, exit );
   inHeader->extraDataLen = (size_t)( dst - end );
@@ -87,6 +77,7 @@ int SocketReadHTTPHeader( int inSock, HTTPHeader_t *inHeader )
       require_action(inHeader->extraDataPtr, exit, err = kNoMemoryErr);
     }else{
       inHeader->isCallbackSupported = false;
+      require_action( inHeader->maxBodyLen == 0 || inHeader->contentLength <= inHeader->maxBodyLen, exit, err = kSizeErr );
       inHeader->extraDataPtr = calloc(inHeader->contentLength , sizeof(uint8_t));
       require_action(inHeader->extraDataPtr, exit, err = kNoMemoryErr);
       memcpy((uint8_t *)inHeader->extraDataPtr, end, copyDataLen);
@@ -109,6 +100,36 @@ exit:
   return err;
 }
 
+int SocketReadHTTPHeader( int inSock, HTTPHeader_t *inHeader )
+{
+  int        err =0;
+  char *          buf;
+  char *          dst;
+  char *          lim;
+  char *          end;
+  size_t          len;
+  ssize_t         n;
+  
+  buf = inHeader->buf;
+  dst = buf + inHeader->len;
+  lim = buf + inHeader->bufLen;
+  for( ;; )
+  {
+    if(findHeader( inHeader,  &end ))
+      break ;
+    n = read( inSock, dst, (size_t)( lim - dst ) );
+    if(      n  > 0 ) len = (size_t) n;
+    else  { err = kConnectionErr; goto exit; }
+    dst += len;
+    inHeader->len += len;
+  }
+  
+  err = HTTPHeaderDidReceive( inHeader, end, dst );
+
+exit:
+  return err;
+}
+
 
 OSStatus SocketReadHTTPBody( int inSock, HTTPHeader_t *inHeader )
 {
@@ -305,7 +326,55 @@ OSStatus SocketReadHTTPBody( int inSock, HTTPHeader_t *inHeader )
   err = kNoErr;
   
 exit:
-  if(err != kNoErr) inHeader->len = 0;
+  if(err != kNoErr) inHeader->len = inHeader->scanOffset = 0;
+  return err;
+}
+
+/* Same as SocketReadHTTPHeader and SocketReadHTTPBody for one message, but never waits: each call
+   does at most one read, so it is only called when select() reports the socket readable. */
+OSStatus SocketReadHTTPMessageStep( int inSock, HTTPHeader_t *inHeader )
+{
+  OSStatus err = kParamErr;
+  ssize_t readResult;
+  size_t readLength;
+  char *end;
+
+  require( inHeader, exit );
+
+  if( inHeader->headerReceived == false ){
+    /* The previous message may have left a whole header in the buffer, use it before reading */
+    if( findHeader( inHeader, &end ) == false ){
+      require_action( inHeader->len < inHeader->bufLen, exit, err = kNoSpaceErr );
+      readResult = read( inSock, inHeader->buf + inHeader->len, inHeader->bufLen - inHeader->len );
+      require_action( readResult > 0, exit, err = kConnectionErr );
+      inHeader->len += readResult;
+      if( findHeader( inHeader, &end ) == false )
+        return kInProgressErr;
+    }
+    err = HTTPHeaderDidReceive( inHeader, end, inHeader->buf + inHeader->len );
+    require_noerr( err, exit );
+    require_action( inHeader->chunkedData == false, exit, err = kUnsupportedErr );
+    inHeader->headerReceived = true;
+  }
+  else if( inHeader->extraDataLen < inHeader->contentLength ){
+    if( inHeader->isCallbackSupported == true ){
+      readLength = inHeader->contentLength - inHeader->extraDataLen > READ_LENGTH? READ_LENGTH:inHeader->contentLength - inHeader->extraDataLen;
+      readResult = read( inSock, (uint8_t*)( inHeader->extraDataPtr ), readLength );
+      require_action( readResult > 0, exit, err = kConnectionErr );
+      inHeader->extraDataLen += readResult;
+      (inHeader->onReceivedDataCallback)(inHeader, inHeader->extraDataLen - readResult, (uint8_t *)inHeader->extraDataPtr, readResult, inHeader->userContext);
+    }else{
+      readResult = read( inSock,
+                        (uint8_t*)( inHeader->extraDataPtr + inHeader->extraDataLen ),
+                        ( inHeader->contentLength - inHeader->extraDataLen ) );
+      require_action( readResult > 0, exit, err = kConnectionErr );
+      inHeader->extraDataLen += readResult;
+    }
+  }
+
+  err = ( inHeader->extraDataLen < inHeader->contentLength )? kInProgressErr : kNoErr;
+
+exit:
   return err;
 }
 
@@ -505,7 +574,7 @@ OSStatus SocketReadHTTPSBody( mico_ssl_t ssl, HTTPHeader_t *inHeader )
   err = kNoErr;
   
 exit:
-  if(err != kNoErr) inHeader->len = 0;
+  if(err != kNoErr) inHeader->len = inHeader->scanOffset = 0;
   return err;
 }
 
@@ -534,52 +603,8 @@ int SocketReadHTTPSHeader( mico_ssl_t ssl, HTTPHeader_t *inHeader )
     inHeader->len += len;
   }
   
-  inHeader->len = (size_t)( end - buf );
-  err = HTTPHeaderParse( inHeader );
-  require_noerr( err, exit );
-  inHeader->extraDataLen = (size_t)( dst - end );
-  if(inHeader->extraDataPtr) {
-    free((uint8_t *)inHeader->extraDataPtr);
-    inHeader->extraDataPtr = 0;
-  }
-
-  /* For chunked extra data without content length */
-  if(inHeader->chunkedData == true){
-    inHeader->chunkedDataBufferLen = (inHeader->extraDataLen > READ_LENGTH)? inHeader->extraDataLen:READ_LENGTH;
-    inHeader->chunkedDataBufferPtr = calloc(inHeader->chunkedDataBufferLen, sizeof(uint8_t)); //Make extra data buffer larger than chunk length
-    require_action(inHeader->chunkedDataBufferPtr, exit, err = kNoMemoryErr);
-    memcpy((uint8_t *)inHeader->chunkedDataBufferPtr, end, inHeader->extraDataLen);
-    inHeader->extraDataPtr = inHeader->chunkedDataBufferPtr;
-    return kNoErr;
-  }
-
-  /* Extra data with content length */
-  if (inHeader->contentLength != 0){ //Content length >0, create a memory buffer (Content length) and store extra data
-    size_t copyDataLen = (inHeader->contentLength >= inHeader->extraDataLen)? inHeader->extraDataLen : inHeader->contentLength;
-    if(inHeader->onReceivedDataCallback && (inHeader->onReceivedDataCallback)(inHeader, 0, (uint8_t *)end, copyDataLen, inHeader->userContext)==kNoErr){
-      inHeader->isCallbackSupported = true;
-      inHeader->extraDataPtr = calloc(READ_LENGTH, sizeof(uint8_t));
-      require_action(inHeader->extraDataPtr, exit, err = kNoMemoryErr);
-    }else{
-      inHeader->isCallbackSupported = false;
-      inHeader->extraDataPtr = calloc(inHeader->contentLength , sizeof(uint8_t));
-      require_action(inHeader->extraDataPtr, exit, err = kNoMemoryErr);
-      memcpy((uint8_t *)inHeader->extraDataPtr, end, copyDataLen);
-    }
-    err = kNoErr;
-  }/* Extra data without content length, data is ended by conntection close */
-  // else if(inHeader->extraDataLen != 0){ //Content length =0, but extra data length >0, create a memory buffer (1500)and store extra data
-  //   inHeader->dataEndedbyClose = true;
-  //   inHeader->extraDataPtr = calloc(1500, sizeof(uint8_t));
-  //   require_action(inHeader->extraDataPtr, exit, err = kNoMemoryErr);
-  //   memcpy((uint8_t *)inHeader->extraDataPtr, end, inHeader->extraDataLen);
-  //   (inHeader->onReceivedDataCallback)(inHeader, 0, (uint8_t *)inHeader->extraDataPtr, inHeader->extraDataLen, inHeader->userContext);
+  err = HTTPHeaderDidReceive( inHeader, end, dst );
 
-  //   err = kNoErr;
-  // }
-  else
-    return kNoErr;
-  
 exit:
   return err;
 }
@@ -589,7 +614,7 @@ bool findHeader ( HTTPHeader_t *inHeader,  char **  outHeaderEnd)
 {
   char *dst = inHeader->buf + inHeader->len;
   char *buf = (char *)inHeader->buf;
-  char *src = (char *)inHeader->buf;
+  char *src;
   size_t          len;
   
   // Check for interleaved binary data (4 byte header that begins with $). See RFC 2326 section 10.12.
@@ -599,15 +624,20 @@ bool findHeader ( HTTPHeader_t *inHeader,  char **  outHeaderEnd)
     return true;
   }
   
+  // Bytes before scanOffset hold no end of header, so each byte is only looked at once however the
+  // header is split up between reads. The offset is left on a LF that needs more data to decide.
+  if( inHeader->scanOffset > inHeader->len ) inHeader->scanOffset = 0;
+  src = buf + inHeader->scanOffset;
+  
   // Find an empty line (separates the header and body). The HTTP spec defines it as CRLFCRLF, but some
   // use LFLF or weird combos like CRLFLF so this handles CRLFCRLF, LFLF, and CRLFLF (but not CRCR).
   *outHeaderEnd = dst;
   for( ;; )
   {
-    while( ( src < *outHeaderEnd ) && ( *src != '\n' ) ) ++src;
-    if( src >= *outHeaderEnd ) break;
+    while( ( src < dst ) && ( *src != '\n' ) ) ++src;
+    if( src >= dst ) break;
     
-    len = (size_t)( *outHeaderEnd - src );
+    len = (size_t)( dst - src );
     if( ( len >= 3 ) && ( src[ 1 ] == '\r' ) && ( src[ 2 ] == '\n' ) ) // CRLFCRLF or LFCRLF.
     {
       *outHeaderEnd = src + 3;
@@ -618,12 +648,13 @@ bool findHeader ( HTTPHeader_t *inHeader,  char **  outHeaderEnd)
       *outHeaderEnd = src + 2;
       return true;
     }
-    else if( len <= 1 )
+    else if( ( len <= 1 ) || ( ( len == 2 ) && ( src[ 1 ] == '\r' ) ) )
     {
       break;
     }
     ++src;
   }
+  inHeader->scanOffset = (size_t)( src - buf );
   return false;
 }
 
@@ -640,6 +671,8 @@ OSStatus HTTPHeaderParse( HTTPHeader_t *ioHeader )
   const char *        end;
   const char *        ptr;
   char                c;
+  const char *        name;
+  size_t              nameSize;
   const char *        value;
   size_t              valueSize;
   int                 x;
@@ -661,6 +694,7 @@ OSStatus HTTPHeaderParse( HTTPHeader_t *ioHeader )
   ioHeader->channelID         = 0;
   ioHeader->contentLength     = 0;
   ioHeader->persistent        = false;
+  memset( ioHeader->fields, 0, sizeof( ioHeader->fields ) );
   
   // Check for a 4-byte interleaved binary data header (see RFC 2326 section 10.12). It has the following format:
   //
@@ -745,17 +779,36 @@ OSStatus HTTPHeaderParse( HTTPHeader_t *ioHeader )
   // There should at least be a blank line after the start line so make sure there's more data.
   require_action( ptr < end, exit, err = kMalformedErr );
   
+  // Walk the header fields once and remember where the well known ones are. The first one of each wins.
+  while( HTTPGetHeaderField( ptr, (size_t)( end - ptr ), NULL, &name, &nameSize, &value, &valueSize, &ptr ) == kNoErr )
+  {
+    for( x = 0; x < kHTTPHeaderField_Count; ++x )
+    {
+      if( ( ioHeader->fields[ x ].valuePtr == NULL ) && ( strnicmpx( name, nameSize, kHTTPHeaderFieldNames[ x ] ) == 0 ) )
+      {
+        ioHeader->fields[ x ].valuePtr = value;
+        ioHeader->fields[ x ].valueLen = valueSize;
+        break;
+      }
+    }
+  }
+  
   // Determine persistence. Note: HTTP 1.0 defaults to non-persistent if a Connection header field is not present.
-  err = HTTPGetHeaderField( ioHeader->buf, ioHeader->len, "Connection", NULL, NULL, &value, &valueSize, NULL );
+  err = HTTPHeaderGetField( ioHeader, kHTTPHeaderField_Connection, &value, &valueSize );
   if( err )   ioHeader->persistent = (Boolean)( strnicmpx( ioHeader->protocolPtr, ioHeader->protocolLen, "HTTP/1.0" ) != 0 );
   else        ioHeader->persistent = (Boolean)( strnicmpx( value, valueSize, "close" ) != 0 );
 
-  err = HTTPGetHeaderField( ioHeader->buf, ioHeader->len, "Transfer-Encoding", NULL, NULL, &value, &valueSize, NULL );
+  err = HTTPHeaderGetField( ioHeader, kHTTPHeaderField_TransferEncoding, &value, &valueSize );
   if( err )   ioHeader->chunkedData = false;
   else        ioHeader->chunkedData = (Boolean)( strnicmpx( value, valueSize, kTransferrEncodingType_CHUNKED ) == 0 );
   
   // Content-Length is such a common field that we get it here during general parsing.
-  HTTPScanFHeaderValue( ioHeader->buf, ioHeader->len, "Content-Length", "%llu", &ioHeader->contentLength );
+  err = HTTPHeaderGetField( ioHeader, kHTTPHeaderField_ContentLength, &value, &valueSize );
+  if( !err )
+  {
+    for( ; ( valueSize > 0 ) && ( ( c = *value ) >= '0' ) && ( c <= '9' ); ++value, --valueSize )
+      ioHeader->contentLength = ( ioHeader->contentLength * 10 ) + (uint64_t)( c - '0' );
+  }
 
   err = kNoErr;
   
@@ -925,6 +978,19 @@ exit:
   return( n );
 }
 
+OSStatus HTTPHeaderGetField( HTTPHeader_t *inHeader, HTTPHeaderField_t inField, const char **outValuePtr, size_t *outValueLen )
+{
+  const HTTPHeaderFieldValue_t *field;
+  
+  if( ( (int) inField < 0 ) || ( inField >= kHTTPHeaderField_Count ) ) return kParamErr;
+  field = &inHeader->fields[ inField ];
+  if( field->valuePtr == NULL ) return kNotFoundErr;
+  
+  if( outValuePtr )   *outValuePtr    = field->valuePtr;
+  if( outValueLen )   *outValueLen    = field->valueLen;
+  return kNoErr;
+}
+
 OSStatus HTTPHeaderMatchMethod( HTTPHeader_t *inHeader, const char *method )
 {
   if( strnicmpx( inHeader->methodPtr, inHeader->methodLen, method ) == 0 )
@@ -1003,10 +1069,11 @@ void HTTPHeaderClear( HTTPHeader_t *inHeader )
   }else{
 
     /* We get some data belongs to next http package, this only could happen two or more
-      packages are received by SocketReadHTTPHeader */ 
+      packages are received by SocketReadHTTPHeader. The body was not read from the socket
+      then, so the next package still follows this one in buf. */ 
     if( inHeader->extraDataLen > inHeader->contentLength ){ 
+      memmove(inHeader->buf, inHeader->buf + inHeader->len + inHeader->contentLength, inHeader->extraDataLen - inHeader->contentLength);
       inHeader->len = inHeader->extraDataLen - inHeader->contentLength;
-      memcpy(inHeader->buf, inHeader->extraDataPtr + inHeader->contentLength, inHeader->len);
     } else
       inHeader->len = 0;
 
@@ -1018,7 +1085,9 @@ void HTTPHeaderClear( HTTPHeader_t *inHeader )
     inHeader->dataEndedbyClose = false;
   }
 
+  inHeader->scanOffset = 0;
   inHeader->isCallbackSupported = false;
+  inHeader->headerReceived = false;
 }
 
 void HTTPHeaderDestory( HTTPHeader_t **inHeader )
@@ -1031,6 +1100,17 @@ void HTTPHeaderDestory( HTTPHeader_t **inHeader )
   }
 }
 
+size_t HTTPHeaderMemoryUsage( HTTPHeader_t *inHeader )
+{
+  size_t usage = sizeof(HTTPHeader_t) + inHeader->bufLen;
+
+  if( inHeader->chunkedDataBufferPtr )
+    usage += inHeader->chunkedDataBufferLen;
+  else if( inHeader->extraDataPtr )
+    usage += inHeader->isCallbackSupported? READ_LENGTH : (size_t)inHeader->contentLength;
+  return usage;
+}
+
 OSStatus CreateSimpleHTTPOKMessage( uint8_t **outMessage, size_t *outMessageSize )
 {
   OSStatus err = kNoMemoryErr;
@@ -1129,6 +1209,8 @@ char * getStatusString(int status)
     return "Authentication Error";
   else if(status == kStatusInternalServerErr)
     return "Internal Server Error";
+  else if(status == kStatusServiceUnavailable)
+    return "Service Unavailable";
   else
     return "OK";
 }
@@ -69,6 +69,7 @@
 #define kStatusForbidden            403  
 #define kStatusAuthenticationErr    470  
 #define kStatusInternalServerErr    500      
+#define kStatusServiceUnavailable   503
 
 #define kMIMEType_Binary                "application/octet-stream"
 #define kMIMEType_DMAP                  "application/x-dmap-tagged"
@@ -86,12 +87,29 @@
 
 #define OTA_Data_Length_per_read        1024
 
+// Header fields located once by HTTPHeaderParse, read back with HTTPHeaderGetField.
+typedef enum
+{
+    kHTTPHeaderField_ContentLength,
+    kHTTPHeaderField_TransferEncoding,
+    kHTTPHeaderField_ContentType,
+    kHTTPHeaderField_Connection,
+    kHTTPHeaderField_Count
+} HTTPHeaderField_t;
+
+typedef struct
+{
+    const char *        valuePtr;           //! Value with leading whitespace skipped, NULL if the field is absent.
+    size_t              valueLen;           //! Number of bytes in the value.
+} HTTPHeaderFieldValue_t;
+
 
 typedef struct _HTTPHeader_t
 {
     char *              buf;                //! Buffer holding the start line and all headers.
     size_t              bufLen;             //! The size of the buffer.
     size_t              len;                //! Number of bytes in the header.
+    size_t              scanOffset;         //! Bytes of buf already searched for the end of the header.
     char *              extraDataPtr;       //! Ptr for any extra data beyond the header, it is alloced when http header is received.
     char *              otaDataPtr;         //! Ptr for any OTA data beyond the header, it is alloced when one OTA package is received.
     size_t              extraDataLen;       //! Length of any extra data beyond the header.
@@ -110,10 +128,13 @@ typedef struct _HTTPHeader_t
     uint8_t             channelID;          //! Interleaved binary data channel ID. 0 for other message types.
     uint64_t            contentLength;      //! Number of bytes following the header. May be 0.
     bool                persistent;         //! true=Do not close the connection after this message.
+    HTTPHeaderFieldValue_t fields[kHTTPHeaderField_Count]; //! Well known fields, indexed by HTTPHeaderField_t.
 
     int                 firstErr;           //! First error that occurred or kNoErr.
 
     bool                dataEndedbyClose;
+    bool                headerReceived;     //! true=Header is parsed and SocketReadHTTPMessageStep is reading the body.
+    size_t              maxBodyLen;         //! Largest body that is buffered in RAM as a whole, 0 for no limit.
     bool                chunkedData;        //! true=Application should read the next chunked data.
     char *              chunkedDataBufferPtr;     //! Ptr for any extra data beyond the header, it is alloced when http header is received.
     size_t              chunkedDataBufferLen; //! Total buffer length that stores the chunkedData, private use only
@@ -145,12 +166,18 @@ int SocketReadHTTPHeader( int inSock, HTTPHeader_t *inHeader );
 
 int SocketReadHTTPBody( int inSock, HTTPHeader_t *inHeader );
 
+/* Reads a message without waiting, for sockets served from a select() loop. Call it whenever the socket
+   is readable: returns kInProgressErr until the header and the whole body are in, then kNoErr. */
+OSStatus SocketReadHTTPMessageStep( int inSock, HTTPHeader_t *inHeader );
+
 int SocketReadHTTPSHeader( mico_ssl_t ssl, HTTPHeader_t *inHeader );
 
 int SocketReadHTTPSBody( mico_ssl_t ssl, HTTPHeader_t *inHeader );
 
 int HTTPHeaderParse( HTTPHeader_t *ioHeader );
 
+int HTTPHeaderGetField( HTTPHeader_t *inHeader, HTTPHeaderField_t inField, const char **outValuePtr, size_t *outValueLen );
+
 int HTTPHeaderMatchMethod( HTTPHeader_t *inHeader, const char *method );
 
 int HTTPHeaderMatchURL( HTTPHeader_t *inHeader, const char *url );
@@ -175,6 +202,9 @@ void HTTPHeaderClear( HTTPHeader_t *inHeader );
 
 void HTTPHeaderDestory( HTTPHeader_t **inHeader );
 
+/* RAM held by the header and its body buffer, in bytes */
+size_t HTTPHeaderMemoryUsage( HTTPHeader_t *inHeader );
+
 int CreateSimpleHTTPOKMessage( uint8_t **outMessage, size_t *outMessageSize );
 
 OSStatus CreateSimpleHTTPMessage      ( const char *contentType, uint8_t *inData, size_t inDataLen, uint8_t **outMessage, size_t *outMessageSize );
@@ -26,12 +26,63 @@
 #define ring_buffer_utils_log(M, ...) custom_log("RingBufferUtils", M, ##__VA_ARGS__)
 #define ring_buffer_utils_log_trace() custom_log_trace("RingBufferUtils")
 
+/* The index that hands bytes over to the other side is loaded with acquire and
+ * stored with release semantics, so the bytes are in memory before the index
+ * moves. On a single Cortex-M core a DMB is enough for the ISRs and the DMA. */
+#if defined ( __GNUC__ )
+#define ring_buffer_load_acquire( index )           __atomic_load_n( (index), __ATOMIC_ACQUIRE )
+#define ring_buffer_store_release( index, value )   __atomic_store_n( (index), (value), __ATOMIC_RELEASE )
+#else
+#if defined ( __ICCARM__ )
+#include <intrinsics.h>
+#define ring_buffer_barrier()   __DMB()
+#elif defined ( __CC_ARM ) //KEIL
+#define ring_buffer_barrier()   __dmb( 0xF )
+#endif
+
+static inline uint32_t ring_buffer_load_acquire( volatile uint32_t* index )
+{
+  uint32_t value = *index;
+  ring_buffer_barrier();
+  return value;
+}
+
+static inline void ring_buffer_store_release( volatile uint32_t* index, uint32_t value )
+{
+  ring_buffer_barrier();
+  *index = value;
+}
+#endif
+
+/* index is below 2 * size, no division is needed to bring it back into the ring */
+static inline uint32_t ring_buffer_wrap( ring_buffer_t* ring_buffer, uint32_t index )
+{
+  if ( ring_buffer->mask != 0 )
+    return index & ring_buffer->mask;
+  return ( index >= ring_buffer->size ) ? index - ring_buffer->size : index;
+}
+
+static inline uint32_t ring_buffer_used( ring_buffer_t* ring_buffer, uint32_t head, uint32_t tail )
+{
+  return ring_buffer_wrap( ring_buffer, ring_buffer->size + tail - head );
+}
+
+/* Called by the producer only, after it moved tail */
+static inline void ring_buffer_update_high_watermark( ring_buffer_t* ring_buffer, uint32_t head, uint32_t tail )
+{
+  uint32_t used = ring_buffer_used( ring_buffer, head, tail );
+  if ( used > ring_buffer->high_watermark )
+    ring_buffer->high_watermark = used;
+}
+
 OSStatus ring_buffer_init( ring_buffer_t* ring_buffer, uint8_t* buffer, uint32_t size )
 {
-    ring_buffer->buffer     = (uint8_t*)buffer;
-    ring_buffer->size       = size;
-    ring_buffer->head       = 0;
-    ring_buffer->tail       = 0;
+    ring_buffer->buffer         = (uint8_t*)buffer;
+    ring_buffer->size           = size;
+    ring_buffer->head           = 0;
+    ring_buffer->tail           = 0;
+    ring_buffer->mask           = ( ( size & ( size - 1 ) ) == 0 ) ? size - 1 : 0;
+    ring_buffer->high_watermark = 0;
     return kNoErr;
 }
 
@@ -43,50 +94,132 @@ OSStatus ring_buffer_deinit( ring_buffer_t* ring_buffer )
 
 uint32_t ring_buffer_free_space( ring_buffer_t* ring_buffer )
 {
-  uint32_t tail_to_end = ring_buffer->size - ring_buffer->tail;
-  return ((tail_to_end + ring_buffer->head) % ring_buffer->size);
+  return ring_buffer->size - 1 - ring_buffer_used_space( ring_buffer );
 }
 
 uint32_t ring_buffer_used_space( ring_buffer_t* ring_buffer )
 {
-  uint32_t head_to_end = ring_buffer->size - ring_buffer->head;
-  return ((head_to_end + ring_buffer->tail) % ring_buffer->size);
+  uint32_t head = ring_buffer_load_acquire( &ring_buffer->head );
+  uint32_t tail = ring_buffer_load_acquire( &ring_buffer->tail );
+  return ring_buffer_used( ring_buffer, head, tail );
 }
 
 uint8_t ring_buffer_get_data( ring_buffer_t* ring_buffer, uint8_t** data, uint32_t* contiguous_bytes )
 {
-  uint32_t head_to_end = ring_buffer->size - ring_buffer->head;
-  
-  *data = &(ring_buffer->buffer[ring_buffer->head]);
-  
-  *contiguous_bytes = MIN(head_to_end, (head_to_end + ring_buffer->tail) % ring_buffer->size);
+  ring_buffer_span_t span[2];
+
+  ring_buffer_get_read_spans( ring_buffer, span );
+  *data = span[0].data;
+  *contiguous_bytes = span[0].length;
   return 0;
 }
 
 uint8_t ring_buffer_consume( ring_buffer_t* ring_buffer, uint32_t bytes_consumed )
 {
-  ring_buffer->head = (ring_buffer->head + bytes_consumed) % ring_buffer->size;
+  uint32_t head = ring_buffer->head;
+  uint32_t used = ring_buffer_used( ring_buffer, head, ring_buffer_load_acquire( &ring_buffer->tail ) );
+
+  bytes_consumed = MIN( bytes_consumed, used );
+  ring_buffer_store_release( &ring_buffer->head, ring_buffer_wrap( ring_buffer, head + bytes_consumed ) );
   return 0;
 }
 
 uint32_t ring_buffer_write( ring_buffer_t* ring_buffer, const uint8_t* data, uint32_t data_length )
 {
-  uint32_t tail_to_end = ring_buffer->size - ring_buffer->tail;
-  
-  /* Calculate the maximum amount we can copy */
-  uint32_t amount_to_copy = MIN(data_length, (ring_buffer->tail == ring_buffer->head) ? ring_buffer->size : (tail_to_end + ring_buffer->head) % ring_buffer->size);
-  
-  /* Copy as much as we can until we fall off the end of the buffer */
-  memcpy(&ring_buffer->buffer[ring_buffer->tail], data, MIN(amount_to_copy, tail_to_end));
-  
-  /* Check if we have more to copy to the front of the buffer */
-  if (tail_to_end < amount_to_copy)
+  ring_buffer_span_t span[2];
+  uint32_t amount_to_copy = MIN( data_length, ring_buffer_get_write_spans( ring_buffer, span ) );
+
+  /* Copy as much as we can until we fall off the end of the buffer, then the rest to the front */
+  memcpy( span[0].data, data, MIN( amount_to_copy, span[0].length ) );
+  if ( amount_to_copy > span[0].length )
+    memcpy( span[1].data, data + span[0].length, amount_to_copy - span[0].length );
+
+  ring_buffer_commit_write( ring_buffer, amount_to_copy );
+  return amount_to_copy;
+}
+
+uint32_t ring_buffer_get_read_spans( ring_buffer_t* ring_buffer, ring_buffer_span_t span[2] )
+{
+  uint32_t head = ring_buffer->head;
+  uint32_t used = ring_buffer_used( ring_buffer, head, ring_buffer_load_acquire( &ring_buffer->tail ) );
+
+  span[0].data   = &ring_buffer->buffer[head];
+  span[0].length = MIN( used, ring_buffer->size - head );
+  span[1].data   = ring_buffer->buffer;
+  span[1].length = used - span[0].length;
+  return used;
+}
+
+uint32_t ring_buffer_peek( ring_buffer_t* ring_buffer, uint32_t offset, uint8_t* data, uint32_t data_length )
+{
+  ring_buffer_span_t span[2];
+  uint32_t used = ring_buffer_get_read_spans( ring_buffer, span );
+  uint32_t copied = 0, len;
+  int i;
+
+  if ( offset >= used )
+    return 0;
+  data_length = MIN( data_length, used - offset );
+
+  for ( i = 0; i < 2 && copied < data_length; i++ )
   {
-    memcpy(ring_buffer->buffer, data + tail_to_end, amount_to_copy - tail_to_end);
+    if ( offset >= span[i].length )
+    {
+      offset -= span[i].length;
+      continue;
+    }
+    len = MIN( span[i].length - offset, data_length - copied );
+    memcpy( data + copied, span[i].data + offset, len );
+    copied += len;
+    offset = 0;
   }
-  
-  /* Update the tail */
-  ring_buffer->tail = (ring_buffer->tail + amount_to_copy) % ring_buffer->size;
-  
-  return amount_to_copy;
+  return copied;
+}
+
+uint32_t ring_buffer_read( ring_buffer_t* ring_buffer, uint8_t* data, uint32_t data_length )
+{
+  uint32_t copied = ring_buffer_peek( ring_buffer, 0, data, data_length );
+  ring_buffer_consume( ring_buffer, copied );
+  return copied;
+}
+
+uint32_t ring_buffer_get_write_spans( ring_buffer_t* ring_buffer, ring_buffer_span_t span[2] )
+{
+  uint32_t tail = ring_buffer->tail;
+  uint32_t space = ring_buffer->size - 1 - ring_buffer_used( ring_buffer, ring_buffer_load_acquire( &ring_buffer->head ), tail );
+
+  span[0].data   = &ring_buffer->buffer[tail];
+  span[0].length = MIN( space, ring_buffer->size - tail );
+  span[1].data   = ring_buffer->buffer;
+  span[1].length = space - span[0].length;
+  return space;
+}
+
+OSStatus ring_buffer_commit_write( ring_buffer_t* ring_buffer, uint32_t bytes_written )
+{
+  OSStatus err = kNoErr;
+  uint32_t head = ring_buffer_load_acquire( &ring_buffer->head );
+  uint32_t tail = ring_buffer->tail;
+
+  require_action_quiet( bytes_written <= ring_buffer->size - 1 - ring_buffer_used( ring_buffer, head, tail ), exit, err = kParamErr );
+
+  tail = ring_buffer_wrap( ring_buffer, tail + bytes_written );
+  ring_buffer_update_high_watermark( ring_buffer, head, tail );
+  ring_buffer_store_release( &ring_buffer->tail, tail );
+
+exit:
+  return err;
+}
+
+void ring_buffer_dma_update( ring_buffer_t* ring_buffer, uint32_t tail )
+{
+  /* The DMA counter reads the buffer size at the end of a lap */
+  tail = ring_buffer_wrap( ring_buffer, tail );
+  ring_buffer_update_high_watermark( ring_buffer, ring_buffer_load_acquire( &ring_buffer->head ), tail );
+  ring_buffer_store_release( &ring_buffer->tail, tail );
+}
+
+uint32_t ring_buffer_high_watermark( ring_buffer_t* ring_buffer )
+{
+  return ring_buffer->high_watermark;
 }
@@ -25,14 +25,26 @@
 
 #include "Common.h"
 
+/* A single producer, single consumer ring. The producer (a thread, an ISR or a DMA
+ * stream) only moves tail, the consumer only moves head, so neither needs a lock.
+ * One byte is always left free, so a full ring is told apart from an empty one. */
 typedef struct
 {
-  uint32_t  size;
-  uint32_t  head;
-  uint32_t  tail;
-  uint8_t*  buffer;
+  uint32_t           size;
+  volatile uint32_t  head;            /* Next byte the consumer reads */
+  volatile uint32_t  tail;            /* Next byte the producer writes */
+  uint8_t*           buffer;
+  uint32_t           mask;            /* size - 1 if size is a power of two, otherwise 0 */
+  uint32_t           high_watermark;  /* Most bytes the ring has held, updated by the producer */
 } ring_buffer_t;
 
+/* One contiguous part of the data or of the free space, a view has up to two of them */
+typedef struct
+{
+  uint8_t*  data;
+  uint32_t  length;
+} ring_buffer_span_t;
+
 #ifndef MIN
 #define MIN(x,y)  ((x) < (y) ? (x) : (y))
 #endif /* ifndef MIN */
@@ -47,10 +59,36 @@ uint32_t ring_buffer_used_space( ring_buffer_t* ring_buffer );
 
 uint8_t ring_buffer_get_data( ring_buffer_t* ring_buffer, uint8_t** data, uint32_t* contiguous_bytes );
 
+/* Takes bytes_consumed bytes out of the ring, e.g. after ring_buffer_get_read_spans() */
 uint8_t ring_buffer_consume( ring_buffer_t* ring_buffer, uint32_t bytes_consumed );
 
 uint32_t ring_buffer_write( ring_buffer_t* ring_buffer, const uint8_t* data, uint32_t data_length );
 
+/* Consumer side */
+
+/* Points spans at the data in the ring without taking it out, span[1] is used
+ * when the data wraps around. Returns the number of bytes in both spans. */
+uint32_t ring_buffer_get_read_spans( ring_buffer_t* ring_buffer, ring_buffer_span_t span[2] );
+
+/* Copies up to data_length bytes that start offset bytes after head, the data stays in the ring */
+uint32_t ring_buffer_peek( ring_buffer_t* ring_buffer, uint32_t offset, uint8_t* data, uint32_t data_length );
+
+/* Copies up to data_length bytes out of the ring and returns their number */
+uint32_t ring_buffer_read( ring_buffer_t* ring_buffer, uint8_t* data, uint32_t data_length );
+
+/* Producer side */
+
+/* Points spans at the free space, e.g. as a DMA or read() target. Returns the
+ * number of bytes in both spans, ring_buffer_commit_write() hands them over. */
+uint32_t ring_buffer_get_write_spans( ring_buffer_t* ring_buffer, ring_buffer_span_t span[2] );
+
+OSStatus ring_buffer_commit_write( ring_buffer_t* ring_buffer, uint32_t bytes_written );
+
+/* Called by an RX ISR with the position a circular DMA stream has written up to */
+void ring_buffer_dma_update( ring_buffer_t* ring_buffer, uint32_t tail );
+
+uint32_t ring_buffer_high_watermark( ring_buffer_t* ring_buffer );
+
 #endif // __RingBufferUtils_h__
 
 
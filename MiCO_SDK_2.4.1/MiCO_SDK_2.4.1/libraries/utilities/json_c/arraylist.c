@@ -22,32 +22,40 @@
 
 #include "bits.h"
 #include "arraylist.h"
+#include "json_arena.h"
 
 struct array_list*
-array_list_new(array_list_free_fn *free_fn)
+array_list_new_arena(array_list_free_fn *free_fn, struct json_arena *arena)
 {
   struct array_list *arr;
 
-  arr = (struct array_list*)calloc(1, sizeof(struct array_list));
+  arr = (struct array_list*)json_arena_alloc(arena, sizeof(struct array_list));
   if(!arr) return NULL;
   arr->size = ARRAY_LIST_DEFAULT_SIZE;
   arr->length = 0;
   arr->free_fn = free_fn;
-  if(!(arr->array = (void**)calloc(sizeof(void*), arr->size))) {
-    free(arr);
+  arr->arena = arena;
+  if(!(arr->array = (void**)json_arena_alloc(arena, sizeof(void*) * arr->size))) {
+    json_arena_free(arena, arr);
     return NULL;
   }
   return arr;
 }
 
+struct array_list*
+array_list_new(array_list_free_fn *free_fn)
+{
+  return array_list_new_arena(free_fn, NULL);
+}
+
 extern void
 array_list_free(struct array_list *arr)
 {
   int i;
   for(i = 0; i < arr->length; i++)
     if(arr->array[i]) arr->free_fn(arr->array[i]);
-  free(arr->array);
-  free(arr);
+  json_arena_free(arr->arena, arr->array);
+  json_arena_free(arr->arena, arr);
 }
 
 void*
@@ -60,12 +68,16 @@ array_list_get_idx(struct array_list *arr, int i)
 static int array_list_expand_internal(struct array_list *arr, int max)
 {
   void *t;
-  int new_size;
+  int new_size, grow;
 
   if(max < arr->size) return 0;
-  //new_size = json_max(arr->size << 1, max);
-  new_size = json_max(arr->size + 1, max);
-  if(!(t = realloc(arr->array, new_size*sizeof(void*)))) return -1;
+  grow = arr->size > 0 ? arr->size : 1;
+#if ARRAY_LIST_MAX_GROW > 0
+  if(grow > ARRAY_LIST_MAX_GROW) grow = ARRAY_LIST_MAX_GROW;
+#endif
+  new_size = json_max(arr->size + grow, max + 1);
+  if(!(t = json_arena_realloc(arr->arena, arr->array, arr->size*sizeof(void*),
+                               new_size*sizeof(void*)))) return -1;
   arr->array = (void**)t;
   (void)memset(arr->array + arr->size, 0, (new_size-arr->size)*sizeof(void*));
   arr->size = new_size;
@@ -16,21 +16,35 @@
 extern "C" {
 #endif
 
-#define ARRAY_LIST_DEFAULT_SIZE 3  //Default is 32
+#ifndef ARRAY_LIST_DEFAULT_SIZE
+#define ARRAY_LIST_DEFAULT_SIZE 4  //Default is 32
+#endif
+
+/* Arrays double in size when they grow. On small RAM targets this caps the
+ * number of elements added by one expansion, 0 means no cap */
+#ifndef ARRAY_LIST_MAX_GROW
+#define ARRAY_LIST_MAX_GROW 0
+#endif
 
 typedef void (array_list_free_fn) (void *data);
 
+struct json_arena;
+
 struct array_list
 {
   void **array;
   int length;
   int size;
   array_list_free_fn *free_fn;
+  struct json_arena *arena; /* NULL for the heap */
 };
 
 extern struct array_list*
 array_list_new(array_list_free_fn *free_fn);
 
+extern struct array_list*
+array_list_new_arena(array_list_free_fn *free_fn, struct json_arena *arena);
+
 extern void
 array_list_free(struct array_list *al);
 
@@ -23,6 +23,8 @@ extern "C" {
 #include "json_util.h"
 #include "json_object.h"
 #include "json_tokener.h"
+#include "json_path.h"
+#include "json_writer.h"
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,124 @@
+/*
+ * Bump allocator used to parse a JSON text without touching the heap.
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See COPYING for details.
+ *
+ */
+
+#ifndef _json_arena_h_
+#define _json_arena_h_
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * every block handed out by an arena starts on this boundary
+ */
+#define JSON_ARENA_ALIGN 8
+
+#define json_arena_align(n) (((n) + JSON_ARENA_ALIGN - 1) & ~(size_t)(JSON_ARENA_ALIGN - 1))
+
+/**
+ * A caller supplied buffer that json objects, strings and tables are carved
+ * from. Blocks are never freed one by one, the whole arena is dropped at
+ * once with json_arena_reset() or by reusing the buffer.
+ *
+ * Every helper below takes a NULL arena to mean the C heap, so code paths
+ * shared by both kinds of objects do not need to test for it.
+ */
+struct json_arena {
+  char *buf;
+  size_t size;
+  size_t used;
+  /* offset of the most recent block, which can grow in place */
+  size_t last;
+};
+
+static inline void json_arena_init(struct json_arena *a, void *buf, size_t size)
+{
+  size_t pad = (JSON_ARENA_ALIGN - ((size_t)buf & (JSON_ARENA_ALIGN - 1))) & (JSON_ARENA_ALIGN - 1);
+
+  if(pad > size) pad = size;
+  a->buf = (char*)buf + pad;
+  a->size = size - pad;
+  a->used = 0;
+  a->last = 0;
+}
+
+static inline void json_arena_reset(struct json_arena *a)
+{
+  a->used = 0;
+  a->last = 0;
+}
+
+static inline size_t json_arena_used(struct json_arena *a)
+{
+  return a->used;
+}
+
+/* Zeroed like calloc() */
+static inline void* json_arena_alloc(struct json_arena *a, size_t size)
+{
+  size_t n = json_arena_align(size);
+  void *p;
+
+  if(!a) return calloc(1, size);
+  if(n > a->size - a->used) return NULL;
+  p = a->buf + a->used;
+  a->last = a->used;
+  a->used += n;
+  memset(p, 0, size);
+  return p;
+}
+
+/* Only the last block grows in place, any other one is copied to the end */
+static inline void* json_arena_realloc(struct json_arena *a, void *ptr,
+				       size_t old_size, size_t size)
+{
+  void *p;
+
+  if(!a) return realloc(ptr, size);
+  if(ptr && (char*)ptr == a->buf + a->last &&
+     json_arena_align(size) <= a->size - a->last) {
+    a->used = a->last + json_arena_align(size);
+    return ptr;
+  }
+  if(!(p = json_arena_alloc(a, size))) return NULL;
+  if(ptr) memcpy(p, ptr, old_size < size ? old_size : size);
+  return p;
+}
+
+/* Scratch blocks are taken from the top of the arena, below anything handed
+ * out by json_arena_alloc(), and given back in reverse order */
+static inline void* json_arena_alloc_top(struct json_arena *a, size_t size)
+{
+  size_t n = json_arena_align(size);
+
+  if(n > a->size - a->used) return NULL;
+  a->size -= n;
+  memset(a->buf + a->size, 0, size);
+  return a->buf + a->size;
+}
+
+static inline void json_arena_release_top(struct json_arena *a, size_t size)
+{
+  a->size += json_arena_align(size);
+}
+
+/* Blocks of an arena are released with the arena itself */
+static inline void json_arena_free(struct json_arena *a, void *ptr)
+{
+  if(!a) free(ptr);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
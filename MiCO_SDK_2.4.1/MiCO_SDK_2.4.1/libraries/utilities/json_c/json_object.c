@@ -23,6 +23,7 @@
 #include "json_inttypes.h"
 #include "json_object.h"
 #include "json_object_private.h"
+#include "json_arena.h"
 #include "json_util.h"
 
 #include "StringUtils.h"
@@ -37,7 +38,8 @@ const char *json_number_chars = "0123456789.+-eE";
 const char *json_hex_chars = "0123456789abcdef";
 
 static void json_object_generic_delete(struct json_object* jso);
-static struct json_object* json_object_new(enum json_type o_type);
+static struct json_object* json_object_new(enum json_type o_type,
+					   struct json_arena *arena);
 
 
 /* ref count debugging */
@@ -129,7 +131,8 @@ extern void json_object_put(struct json_object *jso)
 {
   if(jso) {
     jso->_ref_count--;
-    if(!jso->_ref_count) jso->_delete(jso);
+    /* arena objects go away with their arena */
+    if(!jso->_ref_count && !jso->_arena) jso->_delete(jso);
   }
 }
 
@@ -144,16 +147,18 @@ static void json_object_generic_delete(struct json_object* jso)
   lh_table_delete(json_object_table, jso);
 #endif /* REFCOUNT_DEBUG */
   printbuf_free(jso->_pb);
-  free(jso);
+  json_arena_free(jso->_arena, jso);
 }
 
-static struct json_object* json_object_new(enum json_type o_type)
+static struct json_object* json_object_new(enum json_type o_type,
+					   struct json_arena *arena)
 {
   struct json_object *jso;
 
-  jso = (struct json_object*)calloc(sizeof(struct json_object), 1);
+  jso = (struct json_object*)json_arena_alloc(arena, sizeof(struct json_object));
   if(!jso) return NULL;
   jso->o_type = o_type;
+  jso->_arena = arena;
   jso->_ref_count = 1;
   jso->_delete = &json_object_generic_delete;
 #ifdef REFCOUNT_DEBUG
@@ -182,7 +187,7 @@ const char* json_object_to_json_string(struct json_object *jso)
 {
   if(!jso) return "null";
   if(!jso->_pb) {
-    if(!(jso->_pb = printbuf_new())) return NULL;
+    if(!(jso->_pb = printbuf_new_arena(jso->_arena))) return NULL;
   } else {
     printbuf_reset(jso->_pb);
   }
@@ -238,17 +243,28 @@ static void json_object_object_delete(struct json_object* jso)
   json_object_generic_delete(jso);
 }
 
-struct json_object* json_object_new_object(void)
+struct json_object* json_object_arena_new_object(struct json_arena *arena)
 {
-  struct json_object *jso = json_object_new(json_type_object);
+  struct json_object *jso = json_object_new(json_type_object, arena);
   if(!jso) return NULL;
   jso->_delete = &json_object_object_delete;
   jso->_to_json_string = &json_object_object_to_json_string;
-  jso->o.c_object = lh_kchar_table_new(JSON_OBJECT_DEF_HASH_ENTRIES,
-					NULL, &json_object_lh_entry_free);
+  /* keys of an arena table are in the arena as well, nothing to free */
+  jso->o.c_object = lh_table_new_arena(JSON_OBJECT_DEF_HASH_ENTRIES, NULL,
+				       arena ? NULL : &json_object_lh_entry_free,
+				       lh_char_hash, lh_char_equal, arena);
+  if(!jso->o.c_object) {
+    json_object_generic_delete(jso);
+    return NULL;
+  }
   return jso;
 }
 
+struct json_object* json_object_new_object(void)
+{
+  return json_object_arena_new_object(NULL);
+}
+
 struct lh_table* json_object_get_object(struct json_object *jso)
 {
   if(!jso) return NULL;
@@ -260,11 +276,38 @@ struct lh_table* json_object_get_object(struct json_object *jso)
   }
 }
 
+int json_object_object_insert(struct json_object* jso, char *key,
+			      struct json_object *val, int copy_key)
+{
+  struct lh_entry *existing;
+  char *k = key;
+  size_t len;
+
+  /* Replace the value of an existing key in place, deleting it first would
+   * leave a freed slot behind and copy the key again */
+  existing = lh_table_lookup_entry(jso->o.c_object, key);
+  if(existing) {
+    json_object_put((struct json_object*)existing->v);
+    existing->v = val;
+    if(!copy_key) json_arena_free(jso->_arena, key);
+    return 0;
+  }
+  if(copy_key) {
+    len = strlen(key);
+    if(!(k = (char*)json_arena_alloc(jso->_arena, len + 1))) return -1;
+    memcpy(k, key, len + 1);
+  }
+  if(lh_table_insert(jso->o.c_object, k, val) < 0) {
+    if(copy_key) json_arena_free(jso->_arena, k);
+    return -1;
+  }
+  return 0;
+}
+
 void json_object_object_add(struct json_object* jso, const char *key,
 			    struct json_object *val)
 {
-  lh_table_delete(jso->o.c_object, key);
-  lh_table_insert(jso->o.c_object, strdup(key), val);
+  json_object_object_insert(jso, (char*)key, val, 1);
 }
 
 struct json_object* json_object_object_get(struct json_object* jso, const char *key)
@@ -288,15 +331,21 @@ static int json_object_boolean_to_json_string(struct json_object* jso,
   else return sprintbuf(pb, "false");
 }
 
-struct json_object* json_object_new_boolean(boolean b)
+struct json_object* json_object_arena_new_boolean(struct json_arena *arena,
+						  boolean b)
 {
-  struct json_object *jso = json_object_new(json_type_boolean);
+  struct json_object *jso = json_object_new(json_type_boolean, arena);
   if(!jso) return NULL;
   jso->_to_json_string = &json_object_boolean_to_json_string;
   jso->o.c_boolean = b;
   return jso;
 }
 
+struct json_object* json_object_new_boolean(boolean b)
+{
+  return json_object_arena_new_boolean(NULL, b);
+}
+
 boolean json_object_get_boolean(struct json_object *jso)
 {
   if(!jso) return FALSE;
@@ -325,11 +374,7 @@ static int json_object_int_to_json_string(struct json_object* jso,
 
 struct json_object* json_object_new_int(int32_t i)
 {
-  struct json_object *jso = json_object_new(json_type_int);
-  if(!jso) return NULL;
-  jso->_to_json_string = &json_object_int_to_json_string;
-  jso->o.c_int64 = i;
-  return jso;
+  return json_object_arena_new_int64(NULL, i);
 }
 
 int32_t json_object_get_int(struct json_object *jso)
@@ -368,15 +413,21 @@ int32_t json_object_get_int(struct json_object *jso)
   }
 }
 
-struct json_object* json_object_new_int64(int64_t i)
+struct json_object* json_object_arena_new_int64(struct json_arena *arena,
+						int64_t i)
 {
-  struct json_object *jso = json_object_new(json_type_int);
+  struct json_object *jso = json_object_new(json_type_int, arena);
   if(!jso) return NULL;
   jso->_to_json_string = &json_object_int_to_json_string;
   jso->o.c_int64 = i;
   return jso;
 }
 
+struct json_object* json_object_new_int64(int64_t i)
+{
+  return json_object_arena_new_int64(NULL, i);
+}
+
 int64_t json_object_get_int64(struct json_object *jso)
 {
    int64_t cint;
@@ -405,15 +456,21 @@ static int json_object_double_to_json_string(struct json_object* jso,
   return sprintbuf(pb, "%g", jso->o.c_double);
 }
 
-struct json_object* json_object_new_double(double d)
+struct json_object* json_object_arena_new_double(struct json_arena *arena,
+						 double d)
 {
-  struct json_object *jso = json_object_new(json_type_double);
+  struct json_object *jso = json_object_new(json_type_double, arena);
   if(!jso) return NULL;
   jso->_to_json_string = &json_object_double_to_json_string;
   jso->o.c_double = d;
   return jso;
 }
 
+struct json_object* json_object_new_double(double d)
+{
+  return json_object_arena_new_double(NULL, d);
+}
+
 double json_object_get_double(struct json_object *jso)
 {
   double cdouble;
@@ -451,27 +508,31 @@ static void json_object_string_delete(struct json_object* jso)
   json_object_generic_delete(jso);
 }
 
-struct json_object* json_object_new_string(const char *s)
+struct json_object* json_object_arena_new_string_len(struct json_arena *arena,
+						     const char *s, int len)
 {
-  struct json_object *jso = json_object_new(json_type_string);
+  struct json_object *jso = json_object_new(json_type_string, arena);
   if(!jso) return NULL;
   jso->_delete = &json_object_string_delete;
   jso->_to_json_string = &json_object_string_to_json_string;
-  jso->o.c_string.str = strdup(s);
-  jso->o.c_string.len = strlen(s);
+  if(!(jso->o.c_string.str = (char*)json_arena_alloc(arena, len + 1))) {
+    json_arena_free(arena, jso);
+    return NULL;
+  }
+  memcpy(jso->o.c_string.str, (void *)s, len);
+  jso->o.c_string.str[len] = '\0';
+  jso->o.c_string.len = len;
   return jso;
 }
 
+struct json_object* json_object_new_string(const char *s)
+{
+  return json_object_arena_new_string_len(NULL, s, strlen(s));
+}
+
 struct json_object* json_object_new_string_len(const char *s, int len)
 {
-  struct json_object *jso = json_object_new(json_type_string);
-  if(!jso) return NULL;
-  jso->_delete = &json_object_string_delete;
-  jso->_to_json_string = &json_object_string_to_json_string;
-  jso->o.c_string.str = malloc(len);
-  memcpy(jso->o.c_string.str, (void *)s, len);
-  jso->o.c_string.len = len;
-  return jso;
+  return json_object_arena_new_string_len(NULL, s, len);
 }
 
 const char* json_object_get_string(struct json_object *jso)
@@ -526,16 +587,25 @@ static void json_object_array_delete(struct json_object* jso)
   json_object_generic_delete(jso);
 }
 
-struct json_object* json_object_new_array(void)
+struct json_object* json_object_arena_new_array(struct json_arena *arena)
 {
-  struct json_object *jso = json_object_new(json_type_array);
+  struct json_object *jso = json_object_new(json_type_array, arena);
   if(!jso) return NULL;
   jso->_delete = &json_object_array_delete;
   jso->_to_json_string = &json_object_array_to_json_string;
-  jso->o.c_array = array_list_new(&json_object_array_entry_free);
+  jso->o.c_array = array_list_new_arena(&json_object_array_entry_free, arena);
+  if(!jso->o.c_array) {
+    json_object_generic_delete(jso);
+    return NULL;
+  }
   return jso;
 }
 
+struct json_object* json_object_new_array(void)
+{
+  return json_object_arena_new_array(NULL);
+}
+
 struct array_list* json_object_get_array(struct json_object *jso)
 {
   if(!jso) return NULL;
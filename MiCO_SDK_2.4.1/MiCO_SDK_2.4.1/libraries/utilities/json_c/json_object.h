@@ -20,7 +20,11 @@ extern "C" {
 
 
 
-#define JSON_OBJECT_DEF_HASH_ENTRIES 1 //default is 16
+/* Most objects carry a handful of keys, start with a small flat table that
+ * grows geometrically, see LH_FLAT_SIZE */
+#ifndef JSON_OBJECT_DEF_HASH_ENTRIES
+#define JSON_OBJECT_DEF_HASH_ENTRIES 4 //default is 16
+#endif
 
 #undef FALSE
 #define FALSE ((boolean)0)
@@ -16,6 +16,8 @@
 extern "C" {
 #endif
 
+struct json_arena;
+
 typedef void (json_object_delete_fn)(struct json_object *o);
 typedef int (json_object_to_json_string_fn)(struct json_object *o,
 					    struct printbuf *pb);
@@ -27,6 +29,9 @@ struct json_object
   json_object_to_json_string_fn *_to_json_string;
   int _ref_count;
   struct printbuf *_pb;
+  /* set on objects built by json_tokener_parse_arena(), which are never
+   * deleted one by one but dropped together with their arena */
+  struct json_arena *_arena;
   union data {
     boolean c_boolean;
     double c_double;
@@ -40,6 +45,25 @@ struct json_object
   } o;
 };
 
+/* Constructors behind json_object_new_*(), allocating the object and all of
+ * its storage from arena, or from the heap if arena is NULL */
+extern struct json_object* json_object_arena_new_object(struct json_arena *arena);
+extern struct json_object* json_object_arena_new_array(struct json_arena *arena);
+extern struct json_object* json_object_arena_new_boolean(struct json_arena *arena,
+							 boolean b);
+extern struct json_object* json_object_arena_new_int64(struct json_arena *arena,
+						       int64_t i);
+extern struct json_object* json_object_arena_new_double(struct json_arena *arena,
+							double d);
+extern struct json_object* json_object_arena_new_string_len(struct json_arena *arena,
+							    const char *s, int len);
+
+/* json_object_object_add() that reports failure. With copy_key 0 the object
+ * takes over key, which must come from the same arena (or the heap), and
+ * the caller keeps it if -1 is returned */
+extern int json_object_object_insert(struct json_object* jso, char *key,
+				     struct json_object *val, int copy_key);
+
 #ifdef __cplusplus
 }
 #endif
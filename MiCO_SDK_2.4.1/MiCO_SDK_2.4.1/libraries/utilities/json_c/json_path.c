@@ -0,0 +1,479 @@
+/*
+ * Streaming extraction of a few values from a JSON text by path.
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See COPYING for details.
+ *
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bits.h"
+#include "json_inttypes.h"
+#include "json_object.h"
+#include "json_util.h"
+#include "json_path.h"
+
+/* Stuff for decoding unicode sequences, as in json_tokener.c */
+#define IS_HIGH_SURROGATE(uc) (((uc) & 0xFC00) == 0xD800)
+#define IS_LOW_SURROGATE(uc)  (((uc) & 0xFC00) == 0xDC00)
+#define DECODE_SURROGATE_PAIR(hi,lo) ((((hi) & 0x3FF) << 10) + ((lo) & 0x3FF) + 0x10000)
+static const char utf8_replacement_char[3] = { (char)0xEF, (char)0xBF, (char)0xBD };
+
+static const char* json_path_literals[] = { "true", "false", "null" };
+
+void json_path_init(struct json_path_scanner *s,
+		    struct json_path_slot *slots, int slot_count)
+{
+  int i;
+
+  memset(s, 0, sizeof(struct json_path_scanner));
+  s->slots = slots;
+  s->slot_count = slot_count;
+  s->state = json_path_state_value;
+  for(i = 0; i < slot_count; i++) {
+    slots[i].found = FALSE;
+    slots[i].found_type = json_type_null;
+    slots[i].c_int64 = 0;
+    slots[i].c_boolean = FALSE;
+    slots[i].len = 0;
+    slots[i].offset = -1;
+    slots[i].path_len = strlen(slots[i].path);
+  }
+}
+
+/* An overflowed path is marked by path_len == JSON_PATH_MAX_LEN, which no
+ * slot can match, until it is cut back to a shorter one */
+static void json_path_append(struct json_path_scanner *s, const char *str, int len)
+{
+  if(s->path_len + len >= JSON_PATH_MAX_LEN) {
+    s->path_len = JSON_PATH_MAX_LEN;
+    return;
+  }
+  memcpy(s->path + s->path_len, str, len);
+  s->path_len += len;
+}
+
+static int json_path_push(struct json_path_scanner *s, char type)
+{
+  struct json_path_level *level;
+
+  if(s->depth >= JSON_PATH_MAX_DEPTH) return -1;
+  level = &s->stack[s->depth++];
+  level->type = type;
+  level->path_len = (unsigned char)s->path_len;
+  level->index = 0;
+  return 0;
+}
+
+static void json_path_set_index(struct json_path_scanner *s)
+{
+  struct json_path_level *level = &s->stack[s->depth - 1];
+  char index[14];
+
+  s->path_len = level->path_len;
+  if(s->path_len == JSON_PATH_MAX_LEN) return;
+  json_path_append(s, index, sprintf(index, "[%d]", level->index));
+}
+
+static void json_path_set_key(struct json_path_scanner *s)
+{
+  s->path_len = s->stack[s->depth - 1].path_len;
+  if(s->path_len > 0) json_path_append(s, ".", 1);
+}
+
+/* Look up the slot a value at the current path goes to */
+static void json_path_value_start(struct json_path_scanner *s)
+{
+  struct json_path_slot *slot;
+  int i;
+
+  s->target = NULL;
+  s->lit_len = 0;
+  s->lit[0] = '\0';
+  for(i = 0; i < s->slot_count; i++) {
+    slot = &s->slots[i];
+    if(!slot->found && slot->path_len == s->path_len &&
+       memcmp(slot->path, s->path, s->path_len) == 0) {
+      s->target = slot;
+      slot->offset = s->offset;
+      return;
+    }
+  }
+}
+
+static void json_path_found(struct json_path_scanner *s, enum json_type type)
+{
+  struct json_path_slot *slot = s->target;
+
+  if(!slot) return;
+  slot->found = TRUE;
+  slot->found_type = type;
+  s->found_count++;
+  s->target = NULL;
+}
+
+/* Store a scalar whose text is in lit, or a string whose text is in lit
+ * for int slots and already in buf for string slots */
+static void json_path_value_end(struct json_path_scanner *s, enum json_type type)
+{
+  struct json_path_slot *slot = s->target;
+  double numd;
+
+  if(!slot) return;
+  s->lit[s->lit_len] = '\0';
+  switch(type) {
+  case json_type_int:
+  case json_type_double:
+    numd = 0;
+    if(type == json_type_int) {
+      if(json_parse_int64(s->lit, &slot->c_int64)) slot->c_int64 = 0;
+      numd = (double)slot->c_int64;
+    } else {
+      numd = strtod(s->lit, NULL);
+      slot->c_int64 = (int64_t)numd;
+    }
+    slot->c_boolean = (numd != 0);
+    break;
+  case json_type_boolean:
+    slot->c_boolean = (s->lit[0] == 't');
+    slot->c_int64 = slot->c_boolean;
+    break;
+  case json_type_string:
+    slot->len = s->str_len;
+    slot->c_boolean = (s->str_len != 0);
+    if(slot->type == json_type_int &&
+       json_parse_int64(s->lit, &slot->c_int64)) slot->c_int64 = 0;
+    break;
+  default:
+    break;
+  }
+  if(slot->type == json_type_string && type != json_type_string &&
+     slot->buf && slot->size > 0) {
+    /* non-string scalars read back as their JSON text */
+    slot->len = s->lit_len;
+    memcpy(slot->buf, s->lit, json_min(s->lit_len, slot->size - 1));
+    slot->buf[json_min(s->lit_len, slot->size - 1)] = '\0';
+  }
+  json_path_found(s, type);
+}
+
+static void json_path_after_value(struct json_path_scanner *s)
+{
+  if(s->depth == 0)
+    s->state = json_path_state_done;
+  else if(s->stack[s->depth - 1].type == '{')
+    s->state = json_path_state_object_next;
+  else
+    s->state = json_path_state_array_next;
+}
+
+/* Bytes of a decoded string go to the path for keys, or to the slot */
+static void json_path_string_put(struct json_path_scanner *s, const char *str, int len)
+{
+  struct json_path_slot *slot = s->target;
+  int n;
+
+  if(s->in_key) {
+    if(s->path_len != JSON_PATH_MAX_LEN) json_path_append(s, str, len);
+    return;
+  }
+  if(slot) {
+    if(slot->type == json_type_string && slot->buf) {
+      n = json_min(len, slot->size - 1 - s->str_len);
+      if(n > 0) memcpy(slot->buf + s->str_len, str, n);
+    } else if(slot->type == json_type_int) {
+      n = json_min(len, JSON_PATH_LIT_LEN - 1 - s->lit_len);
+      if(n > 0) {
+	memcpy(s->lit + s->lit_len, str, n);
+	s->lit_len += n;
+      }
+    }
+  }
+  s->str_len += len;
+}
+
+static void json_path_string_put_ucs(struct json_path_scanner *s, unsigned int uc)
+{
+  char utf8[4];
+
+  if(uc < 0x80) {
+    utf8[0] = uc;
+    json_path_string_put(s, utf8, 1);
+  } else if(uc < 0x800) {
+    utf8[0] = 0xc0 | (uc >> 6);
+    utf8[1] = 0x80 | (uc & 0x3f);
+    json_path_string_put(s, utf8, 2);
+  } else if(uc < 0x10000) {
+    utf8[0] = 0xe0 | (uc >> 12);
+    utf8[1] = 0x80 | ((uc >> 6) & 0x3f);
+    utf8[2] = 0x80 | (uc & 0x3f);
+    json_path_string_put(s, utf8, 3);
+  } else {
+    utf8[0] = 0xf0 | (uc >> 18);
+    utf8[1] = 0x80 | ((uc >> 12) & 0x3f);
+    utf8[2] = 0x80 | ((uc >> 6) & 0x3f);
+    utf8[3] = 0x80 | (uc & 0x3f);
+    json_path_string_put(s, utf8, 4);
+  }
+}
+
+/* A high surrogate not followed by a low one */
+static void json_path_flush_surrogate(struct json_path_scanner *s)
+{
+  if(!s->high_surrogate) return;
+  json_path_string_put(s, utf8_replacement_char, 3);
+  s->high_surrogate = 0;
+}
+
+static void json_path_string_end(struct json_path_scanner *s)
+{
+  struct json_path_slot *slot = s->target;
+
+  json_path_flush_surrogate(s);
+  if(s->in_key) {
+    s->state = json_path_state_object_colon;
+    return;
+  }
+  if(slot && slot->type == json_type_string && slot->buf && slot->size > 0)
+    slot->buf[json_min(s->str_len, slot->size - 1)] = '\0';
+  json_path_value_end(s, json_type_string);
+  json_path_after_value(s);
+}
+
+static int json_path_is_space(char c)
+{
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static int json_path_is_number(char c)
+{
+  return (c >= '0' && c <= '9') || c == '-' || c == '+' ||
+    c == '.' || c == 'e' || c == 'E';
+}
+
+/* First character of a value */
+static void json_path_begin_value(struct json_path_scanner *s, char c)
+{
+  json_path_value_start(s);
+  switch(c) {
+  case '{':
+    if(s->target) json_path_found(s, json_type_object);
+    if(json_path_push(s, '{')) s->state = json_path_state_error;
+    else s->state = json_path_state_object_first;
+    break;
+  case '[':
+    if(s->target) json_path_found(s, json_type_array);
+    if(json_path_push(s, '[')) s->state = json_path_state_error;
+    else s->state = json_path_state_array_first;
+    break;
+  case '"':
+    s->in_key = FALSE;
+    s->str_len = 0;
+    if(s->target) s->target->offset = s->offset + 1;
+    s->state = json_path_state_string;
+    break;
+  case 't':
+  case 'f':
+  case 'n':
+    s->literal = json_path_literals[c == 't' ? 0 : c == 'f' ? 1 : 2];
+    s->lit[0] = c;
+    s->lit_len = 1;
+    s->state = json_path_state_literal;
+    break;
+  default:
+    if(c == '-' || (c >= '0' && c <= '9')) {
+      s->lit[0] = c;
+      s->lit_len = 1;
+      s->state = json_path_state_number;
+    } else {
+      s->state = json_path_state_error;
+    }
+    break;
+  }
+}
+
+enum json_path_status json_path_scan(struct json_path_scanner *s,
+				     const char *data, int len)
+{
+  const char *end = data + len;
+  char c;
+
+  for(; data < end; data++, s->offset++) {
+    if(s->found_count == s->slot_count) s->state = json_path_state_done;
+    c = *data;
+
+  redo_char:
+    switch(s->state) {
+
+    case json_path_state_value:
+      if(!json_path_is_space(c)) json_path_begin_value(s, c);
+      break;
+
+    case json_path_state_object_first:
+    case json_path_state_object_next:
+      if(json_path_is_space(c)) break;
+      if(c == '}') {
+	s->path_len = s->stack[--s->depth].path_len;
+	json_path_after_value(s);
+      } else if(c == ',' && s->state == json_path_state_object_next) {
+	/* like json_tokener, a '}' right after the ',' is tolerated */
+	s->state = json_path_state_object_first;
+      } else if(c == '"') {
+	json_path_set_key(s);
+	s->in_key = TRUE;
+	s->str_len = 0;
+	s->state = json_path_state_string;
+      } else {
+	s->state = json_path_state_error;
+      }
+      break;
+
+    case json_path_state_object_colon:
+      if(json_path_is_space(c)) break;
+      if(c == ':') s->state = json_path_state_value;
+      else s->state = json_path_state_error;
+      break;
+
+    case json_path_state_array_first:
+      if(json_path_is_space(c)) break;
+      if(c == ']') {
+	s->path_len = s->stack[--s->depth].path_len;
+	json_path_after_value(s);
+      } else {
+	json_path_set_index(s);
+	json_path_begin_value(s, c);
+      }
+      break;
+
+    case json_path_state_array_next:
+      if(json_path_is_space(c)) break;
+      if(c == ']') {
+	s->path_len = s->stack[--s->depth].path_len;
+	json_path_after_value(s);
+      } else if(c == ',') {
+	s->stack[s->depth - 1].index++;
+	json_path_set_index(s);
+	s->state = json_path_state_value;
+      } else {
+	s->state = json_path_state_error;
+      }
+      break;
+
+    case json_path_state_string:
+      {
+	/* Hand over the run of plain characters at once */
+	const char *run = data;
+	while(data < end && *data != '"' && *data != '\\') data++;
+	if(data > run) {
+	  json_path_flush_surrogate(s);
+	  json_path_string_put(s, run, data - run);
+	}
+	s->offset += data - run;
+	if(data == end) return json_path_continue;
+	c = *data;
+	if(c == '"') json_path_string_end(s);
+	else s->state = json_path_state_string_escape;
+      }
+      break;
+
+    case json_path_state_string_escape:
+      s->state = json_path_state_string;
+      switch(c) {
+      case '"':
+      case '\\':
+      case '/':
+	json_path_flush_surrogate(s);
+	json_path_string_put(s, &c, 1);
+	break;
+      case 'b': c = '\b'; goto put_escape;
+      case 'f': c = '\f'; goto put_escape;
+      case 'n': c = '\n'; goto put_escape;
+      case 'r': c = '\r'; goto put_escape;
+      case 't': c = '\t';
+      put_escape:
+	json_path_flush_surrogate(s);
+	json_path_string_put(s, &c, 1);
+	break;
+      case 'u':
+	s->ucs_char = 0;
+	s->ucs_digits = 0;
+	s->state = json_path_state_string_unicode;
+	break;
+      default:
+	s->state = json_path_state_error;
+	break;
+      }
+      break;
+
+    case json_path_state_string_unicode:
+      if(c >= '0' && c <= '9') s->ucs_char = (s->ucs_char << 4) | (c - '0');
+      else if((c | 0x20) >= 'a' && (c | 0x20) <= 'f') s->ucs_char = (s->ucs_char << 4) | ((c | 0x20) - 'a' + 10);
+      else {
+	s->state = json_path_state_error;
+	break;
+      }
+      if(++s->ucs_digits < 4) break;
+      s->state = json_path_state_string;
+      if(IS_HIGH_SURROGATE(s->ucs_char)) {
+	json_path_flush_surrogate(s);
+	s->high_surrogate = s->ucs_char;
+      } else if(IS_LOW_SURROGATE(s->ucs_char) && s->high_surrogate) {
+	json_path_string_put_ucs(s, DECODE_SURROGATE_PAIR(s->high_surrogate, s->ucs_char));
+	s->high_surrogate = 0;
+      } else {
+	json_path_flush_surrogate(s);
+	json_path_string_put_ucs(s, s->ucs_char);
+      }
+      break;
+
+    case json_path_state_number:
+      if(json_path_is_number(c)) {
+	if(s->lit_len >= JSON_PATH_LIT_LEN - 1) s->state = json_path_state_error;
+	else s->lit[s->lit_len++] = c;
+	break;
+      }
+      s->lit[s->lit_len] = '\0';
+      json_path_value_end(s, strpbrk(s->lit, ".eE") ? json_type_double : json_type_int);
+      json_path_after_value(s);
+      goto redo_char;
+
+    case json_path_state_literal:
+      if(c != s->literal[s->lit_len]) {
+	s->state = json_path_state_error;
+	break;
+      }
+      s->lit[s->lit_len++] = c;
+      if(s->literal[s->lit_len]) break;
+      json_path_value_end(s, s->lit[0] == 'n' ? json_type_null : json_type_boolean);
+      json_path_after_value(s);
+      break;
+
+    case json_path_state_done:
+      return json_path_done;
+
+    case json_path_state_error:
+      return json_path_error;
+    }
+  }
+
+  if(s->found_count == s->slot_count) s->state = json_path_state_done;
+  if(s->state == json_path_state_done) return json_path_done;
+  if(s->state == json_path_state_error) return json_path_error;
+  return json_path_continue;
+}
+
+int json_path_extract(const char *str,
+		      struct json_path_slot *slots, int slot_count)
+{
+  struct json_path_scanner s;
+
+  json_path_init(&s, slots, slot_count);
+  /* the NUL ends a number at the top level */
+  if(json_path_scan(&s, str, strlen(str) + 1) != json_path_done) return -1;
+  return s.found_count;
+}
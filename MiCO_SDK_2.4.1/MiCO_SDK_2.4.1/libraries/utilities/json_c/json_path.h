@@ -0,0 +1,148 @@
+/*
+ * Streaming extraction of a few values from a JSON text by path.
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See COPYING for details.
+ *
+ */
+
+#ifndef _json_path_h_
+#define _json_path_h_
+
+#include "json_inttypes.h"
+#include "json_object.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * deepest nesting of objects and arrays the scanner follows
+ */
+#define JSON_PATH_MAX_DEPTH 16
+
+/**
+ * longest path, including keys and array indexes, that can be matched
+ */
+#define JSON_PATH_MAX_LEN 64
+
+/**
+ * longest number, or string converted to a number, that is kept
+ */
+#define JSON_PATH_LIT_LEN 32
+
+/**
+ * One value wanted from the text.
+ *
+ * The path names object members by key, separated by dots, and array
+ * elements by index in brackets, e.g. "services.outlet.port_on_off[0]".
+ * The first value met at that path fills the slot, converted to the
+ * wanted type the way json_object_get_int64(), json_object_get_boolean()
+ * and json_object_get_string() would.
+ */
+struct json_path_slot
+{
+  /* set by the caller */
+  const char *path;
+  enum json_type type;   /* json_type_int, json_type_boolean or json_type_string */
+  char *buf;             /* string slots: copy of the value, NUL terminated,
+                            left alone if the value is not found */
+  int size;              /* string slots: size of buf */
+
+  /* set by the scanner */
+  boolean found;
+  enum json_type found_type;
+  int64_t c_int64;
+  boolean c_boolean;
+  int len;               /* string slots: length of the value, may exceed size-1 */
+  int offset;            /* offset of the value in the text */
+  int path_len;
+};
+
+#define JSON_PATH_SLOT_INT(path)              { (path), json_type_int, NULL, 0 }
+#define JSON_PATH_SLOT_BOOLEAN(path)          { (path), json_type_boolean, NULL, 0 }
+#define JSON_PATH_SLOT_STRING(path, buf, size) { (path), json_type_string, (buf), (size) }
+
+enum json_path_status {
+  json_path_continue,    /* more text is needed */
+  json_path_done,        /* the text is complete or every slot is filled */
+  json_path_error        /* malformed or too deeply nested text */
+};
+
+enum json_path_state {
+  json_path_state_value,
+  json_path_state_object_first,
+  json_path_state_object_colon,
+  json_path_state_object_next,
+  json_path_state_array_first,
+  json_path_state_array_next,
+  json_path_state_string,
+  json_path_state_string_escape,
+  json_path_state_string_unicode,
+  json_path_state_number,
+  json_path_state_literal,
+  json_path_state_done,
+  json_path_state_error
+};
+
+struct json_path_level
+{
+  char type;             /* '{' or '[' */
+  unsigned char path_len;
+  int index;
+};
+
+/**
+ * Scanner state, kept by the caller between chunks of text.
+ * Needs no heap and holds no pointer into the text.
+ */
+struct json_path_scanner
+{
+  struct json_path_slot *slots;
+  int slot_count, found_count;
+  enum json_path_state state;
+  int depth, path_len, lit_len, str_len, offset;
+  boolean in_key;
+  const char *literal;
+  unsigned int ucs_char, high_surrogate;
+  int ucs_digits;
+  struct json_path_slot *target;
+  struct json_path_level stack[JSON_PATH_MAX_DEPTH];
+  char path[JSON_PATH_MAX_LEN];
+  char lit[JSON_PATH_LIT_LEN];
+};
+
+/** Prepare a scanner and clear the outputs of its slots
+ * @param s the scanner
+ * @param slots the values to look for, must outlive the scan
+ * @param slot_count number of slots
+ */
+extern void json_path_init(struct json_path_scanner *s,
+			   struct json_path_slot *slots, int slot_count);
+
+/** Feed the next chunk of text to the scanner
+ *
+ * The text is looked at once, byte by byte, and no part of it is kept, so
+ * chunks can come straight from a receive callback. A number at the top
+ * level only ends with the character after it.
+ *
+ * @param s the scanner
+ * @param data the chunk
+ * @param len length of the chunk
+ * @returns json_path_continue until the top level value is complete or
+ * every slot is filled, then json_path_done. Later chunks are ignored.
+ */
+extern enum json_path_status json_path_scan(struct json_path_scanner *s,
+					    const char *data, int len);
+
+/** Fill slots from a complete, NUL terminated JSON text
+ * @returns the number of slots filled, or -1 if the text is malformed
+ */
+extern int json_path_extract(const char *str,
+			     struct json_path_slot *slots, int slot_count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
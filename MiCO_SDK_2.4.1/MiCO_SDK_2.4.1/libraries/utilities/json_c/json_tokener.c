@@ -28,6 +28,8 @@
 #include "arraylist.h"
 #include "json_inttypes.h"
 #include "json_object.h"
+#include "json_object_private.h"
+#include "json_arena.h"
 #include "json_tokener.h"
 #include "json_util.h"
 
@@ -60,6 +62,7 @@ const char* json_tokener_errors[] = {
   "object value separator ',' expected",
   "invalid string sequence",
   "expected comment",
+  "out of memory",
 };
 
 /* Stuff for decoding unicode sequences */
@@ -93,7 +96,7 @@ static void json_tokener_reset_level(struct json_tokener *tok, int depth)
   tok->stack[depth].saved_state = json_tokener_state_start;
   json_object_put(tok->stack[depth].current);
   tok->stack[depth].current = NULL;
-  free(tok->stack[depth].obj_field_name);
+  json_arena_free(tok->arena, tok->stack[depth].obj_field_name);
   tok->stack[depth].obj_field_name = NULL;
 }
 
@@ -138,6 +141,37 @@ struct json_object* json_tokener_parse_verbose(const char *str, enum json_tokene
     return obj;
 }
 
+struct json_object* json_tokener_parse_arena(const char *str,
+					     struct json_arena *arena)
+{
+  struct json_tokener *tok;
+  struct json_object *obj;
+  struct printbuf pb;
+  int len = strlen(str);
+  size_t tok_size = json_arena_align(sizeof(struct json_tokener));
+  size_t scratch;
+
+  /* A token is never longer than the text, so a buffer of that size never
+   * grows and the tokener can work from the top of the arena */
+  scratch = tok_size + len + 1;
+  tok = (struct json_tokener*)json_arena_alloc_top(arena, scratch);
+  if(!tok) return NULL;
+  pb.buf = (char*)tok + tok_size;
+  pb.bpos = 0;
+  pb.size = len + 1;
+  pb.arena = arena;
+  tok->pb = &pb;
+  tok->arena = arena;
+  json_tokener_reset(tok);
+
+  obj = json_tokener_parse_ex(tok, str, len);
+  if(tok->err != json_tokener_success)
+    obj = NULL;
+  json_tokener_reset(tok);
+  json_arena_release_top(arena, scratch);
+  return obj;
+}
+
 
 #if !HAVE_STRNDUP
 /* CAW: compliant version of strndup() */
@@ -241,12 +275,20 @@ struct json_object* json_tokener_parse_ex(struct json_tokener *tok,
       case '{':
 	state = json_tokener_state_eatws;
 	saved_state = json_tokener_state_object_field_start;
-	current = json_object_new_object();
+	current = json_object_arena_new_object(tok->arena);
+	if(!current) {
+	  tok->err = json_tokener_error_memory;
+	  goto out;
+	}
 	break;
       case '[':
 	state = json_tokener_state_eatws;
 	saved_state = json_tokener_state_array;
-	current = json_object_new_array();
+	current = json_object_arena_new_array(tok->arena);
+	if(!current) {
+	  tok->err = json_tokener_error_memory;
+	  goto out;
+	}
 	break;
       case 'N':
       case 'n':
@@ -377,7 +419,12 @@ struct json_object* json_tokener_parse_ex(struct json_tokener *tok,
 	while(1) {
 	  if(c == tok->quote_char) {
 	    printbuf_memappend_fast(tok->pb, case_start, str-case_start);
-	    current = json_object_new_string(tok->pb->buf);
+	    current = json_object_arena_new_string_len(tok->arena, tok->pb->buf,
+						       tok->pb->bpos);
+	    if(!current) {
+	      tok->err = json_tokener_error_memory;
+	      goto out;
+	    }
 	    saved_state = json_tokener_state_finish;
 	    state = json_tokener_state_eatws;
 	    break;
@@ -525,7 +572,11 @@ struct json_object* json_tokener_parse_ex(struct json_tokener *tok,
       if(strncasecmp(json_true_str, tok->pb->buf,
 		     json_min(tok->st_pos+1, strlen(json_true_str))) == 0) {
 	if(tok->st_pos == strlen(json_true_str)) {
-	  current = json_object_new_boolean(1);
+	  current = json_object_arena_new_boolean(tok->arena, 1);
+	  if(!current) {
+	    tok->err = json_tokener_error_memory;
+	    goto out;
+	  }
 	  saved_state = json_tokener_state_finish;
 	  state = json_tokener_state_eatws;
 	  goto redo_char;
@@ -533,7 +584,11 @@ struct json_object* json_tokener_parse_ex(struct json_tokener *tok,
       } else if(strncasecmp(json_false_str, tok->pb->buf,
 			    json_min(tok->st_pos+1, strlen(json_false_str))) == 0) {
 	if(tok->st_pos == strlen(json_false_str)) {
-	  current = json_object_new_boolean(0);
+	  current = json_object_arena_new_boolean(tok->arena, 0);
+	  if(!current) {
+	    tok->err = json_tokener_error_memory;
+	    goto out;
+	  }
 	  saved_state = json_tokener_state_finish;
 	  state = json_tokener_state_eatws;
 	  goto redo_char;
@@ -565,13 +620,17 @@ struct json_object* json_tokener_parse_ex(struct json_tokener *tok,
 	int64_t num64;
 	double  numd;
 	if (!tok->is_double && json_parse_int64(tok->pb->buf, &num64) == 0) {
-		current = json_object_new_int64(num64);
+		current = json_object_arena_new_int64(tok->arena, num64);
 	} else if(tok->is_double && sscanf(tok->pb->buf, "%lf", &numd) == 1) {
-          current = json_object_new_double(numd);
+          current = json_object_arena_new_double(tok->arena, numd);
         } else {
           tok->err = json_tokener_error_parse_number;
           goto out;
         }
+        if(!current) {
+          tok->err = json_tokener_error_memory;
+          goto out;
+        }
         saved_state = json_tokener_state_finish;
         state = json_tokener_state_eatws;
         goto redo_char;
@@ -594,7 +653,11 @@ struct json_object* json_tokener_parse_ex(struct json_tokener *tok,
       break;
 
     case json_tokener_state_array_add:
-      json_object_array_add(current, obj);
+      if(json_object_array_add(current, obj) < 0) {
+	json_object_put(obj);
+	tok->err = json_tokener_error_memory;
+	goto out;
+      }
       saved_state = json_tokener_state_array_sep;
       state = json_tokener_state_eatws;
       goto redo_char;
@@ -633,7 +696,12 @@ struct json_object* json_tokener_parse_ex(struct json_tokener *tok,
 	while(1) {
 	  if(c == tok->quote_char) {
 	    printbuf_memappend_fast(tok->pb, case_start, str-case_start);
-	    obj_field_name = strdup(tok->pb->buf);
+	    obj_field_name = (char*)json_arena_alloc(tok->arena, tok->pb->bpos + 1);
+	    if(!obj_field_name) {
+	      tok->err = json_tokener_error_memory;
+	      goto out;
+	    }
+	    memcpy(obj_field_name, tok->pb->buf, tok->pb->bpos + 1);
 	    saved_state = json_tokener_state_object_field_end;
 	    state = json_tokener_state_eatws;
 	    break;
@@ -672,8 +740,12 @@ struct json_object* json_tokener_parse_ex(struct json_tokener *tok,
       goto redo_char;
 
     case json_tokener_state_object_value_add:
-      json_object_object_add(current, obj_field_name, obj);
-      free(obj_field_name);
+      /* the object takes over the field name */
+      if(json_object_object_insert(current, obj_field_name, obj, 0) < 0) {
+	json_object_put(obj);
+	tok->err = json_tokener_error_memory;
+	goto out;
+      }
       obj_field_name = NULL;
       saved_state = json_tokener_state_object_sep;
       state = json_tokener_state_eatws;
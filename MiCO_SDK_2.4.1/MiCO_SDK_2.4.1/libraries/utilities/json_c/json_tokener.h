@@ -33,7 +33,8 @@ enum json_tokener_error {
   json_tokener_error_parse_object_key_sep,
   json_tokener_error_parse_object_value_sep,
   json_tokener_error_parse_string,
-  json_tokener_error_parse_comment
+  json_tokener_error_parse_comment,
+  json_tokener_error_memory
 };
 
 enum json_tokener_state {
@@ -71,6 +72,8 @@ struct json_tokener_srec
 
 #define JSON_TOKENER_MAX_DEPTH 32
 
+struct json_arena;
+
 struct json_tokener
 {
   char *str;
@@ -80,6 +83,7 @@ struct json_tokener
   unsigned int ucs_char;
   char quote_char;
   struct json_tokener_srec stack[JSON_TOKENER_MAX_DEPTH];
+  struct json_arena *arena;
 };
 
 extern const char* json_tokener_errors[];
@@ -92,6 +96,27 @@ extern struct json_object* json_tokener_parse_verbose(const char *str, enum json
 extern struct json_object* json_tokener_parse_ex(struct json_tokener *tok,
 						 const char *str, int len);
 
+/** Parse a JSON text into objects that live in a caller supplied arena
+ *
+ * Every object, string, table and array of the result is carved from
+ * arena, and the tokener works at the top of it for the duration of the
+ * call, so nothing is taken from the heap. The result is read with the
+ * usual json_object_* calls. json_object_put() on it is harmless but frees
+ * nothing: the whole tree is dropped at once by resetting or reusing the
+ * arena, which must outlive every use of the result.
+ *
+ * Heap objects must not be added to an arena tree, they would never be
+ * freed. Besides the tree the arena needs room for the tokener and a copy
+ * of str while parsing, size it with json_arena_used() on a typical text.
+ *
+ * @param str the NUL terminated JSON text
+ * @param arena the arena, set up with json_arena_init()
+ * @returns the parsed object, or NULL on a parse error or when the arena
+ * runs out of room. The arena may be partly used in that case.
+ */
+extern struct json_object* json_tokener_parse_arena(const char *str,
+						    struct json_arena *arena);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,296 @@
+/*
+ * Streaming JSON text writer with a fixed output window.
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See COPYING for details.
+ *
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bits.h"
+#include "json_inttypes.h"
+#include "linkhash.h"
+#include "json_object.h"
+#include "json_writer.h"
+
+static const char json_writer_hex_chars[] = "0123456789abcdef";
+
+void json_writer_init(struct json_writer *w, char *buf, int size,
+		      json_writer_flush_fn *flush, void *userdata)
+{
+  memset(w, 0, sizeof(struct json_writer));
+  w->buf = buf;
+  w->size = size;
+  w->flush = flush;
+  w->userdata = userdata;
+  if(buf == NULL || size < 2) w->error = TRUE;
+}
+
+static int json_writer_put(struct json_writer *w, const char *data, int len)
+{
+  int room;
+
+  if(w->error) return -1;
+  while(len > 0) {
+    /* Without a flush callback one byte is kept for the terminating NUL */
+    room = w->size - w->len - (w->flush ? 0 : 1);
+    if(room == 0) {
+      if(w->flush == NULL || w->flush(w->userdata, w->buf, w->len) < 0) {
+	w->error = TRUE;
+	return -1;
+      }
+      w->len = 0;
+      continue;
+    }
+    if(room > len) room = len;
+    memcpy(w->buf + w->len, data, room);
+    w->len += room;
+    w->total += room;
+    data += room;
+    len -= room;
+  }
+  return 0;
+}
+
+/* Separator in front of a value, as json_object_to_json_string() puts it */
+static int json_writer_begin_value(struct json_writer *w)
+{
+  unsigned int bit;
+
+  if(w->error) return -1;
+  if(w->depth == 0 || w->after_key) {
+    w->after_key = FALSE;
+    return 0;
+  }
+  bit = 1u << (w->depth - 1);
+  if(!(w->is_array & bit)) {
+    /* Object members need a key first */
+    w->error = TRUE;
+    return -1;
+  }
+  if(w->has_items & bit) return json_writer_put(w, ", ", 2);
+  w->has_items |= bit;
+  return json_writer_put(w, " ", 1);
+}
+
+static int json_writer_begin(struct json_writer *w, char c, boolean is_array)
+{
+  unsigned int bit;
+
+  if(json_writer_begin_value(w) < 0) return -1;
+  if(w->depth == JSON_WRITER_MAX_DEPTH) {
+    w->error = TRUE;
+    return -1;
+  }
+  bit = 1u << w->depth++;
+  w->has_items &= ~bit;
+  if(is_array) w->is_array |= bit;
+  else w->is_array &= ~bit;
+  return json_writer_put(w, &c, 1);
+}
+
+static int json_writer_end(struct json_writer *w, const char *str, boolean is_array)
+{
+  unsigned int bit;
+
+  if(w->error) return -1;
+  bit = w->depth ? 1u << (w->depth - 1) : 0;
+  if(w->depth == 0 || w->after_key || !(w->is_array & bit) != !is_array) {
+    w->error = TRUE;
+    return -1;
+  }
+  w->depth--;
+  return json_writer_put(w, str, 2);
+}
+
+int json_writer_begin_object(struct json_writer *w)
+{
+  return json_writer_begin(w, '{', FALSE);
+}
+
+int json_writer_end_object(struct json_writer *w)
+{
+  return json_writer_end(w, " }", FALSE);
+}
+
+int json_writer_begin_array(struct json_writer *w)
+{
+  return json_writer_begin(w, '[', TRUE);
+}
+
+int json_writer_end_array(struct json_writer *w)
+{
+  return json_writer_end(w, " ]", TRUE);
+}
+
+/* Same escapes as json_escape_str() */
+static int json_writer_escape(struct json_writer *w, const char *str, int len)
+{
+  int pos = 0, start_offset = 0;
+  unsigned char c;
+  char esc[6];
+
+  for(; pos < len; pos++) {
+    c = str[pos];
+    switch(c) {
+    case '\b': esc[1] = 'b'; break;
+    case '\n': esc[1] = 'n'; break;
+    case '\r': esc[1] = 'r'; break;
+    case '\t': esc[1] = 't'; break;
+    case '"':
+    case '\\':
+    case '/': esc[1] = c; break;
+    default:
+      if(c >= ' ') continue;
+      esc[1] = 'u';
+      break;
+    }
+    json_writer_put(w, str + start_offset, pos - start_offset);
+    esc[0] = '\\';
+    if(esc[1] == 'u') {
+      esc[2] = '0';
+      esc[3] = '0';
+      esc[4] = json_writer_hex_chars[c >> 4];
+      esc[5] = json_writer_hex_chars[c & 0xf];
+      json_writer_put(w, esc, 6);
+    } else {
+      json_writer_put(w, esc, 2);
+    }
+    start_offset = pos + 1;
+  }
+  return json_writer_put(w, str + start_offset, pos - start_offset);
+}
+
+int json_writer_key(struct json_writer *w, const char *key)
+{
+  unsigned int bit;
+
+  if(w->error) return -1;
+  bit = w->depth ? 1u << (w->depth - 1) : 0;
+  if(w->depth == 0 || w->after_key || (w->is_array & bit)) {
+    w->error = TRUE;
+    return -1;
+  }
+  if(w->has_items & bit) json_writer_put(w, ",", 1);
+  w->has_items |= bit;
+  json_writer_put(w, " \"", 2);
+  json_writer_escape(w, key, strlen(key));
+  w->after_key = TRUE;
+  return json_writer_put(w, "\": ", 3);
+}
+
+int json_writer_string_len(struct json_writer *w, const char *str, int len)
+{
+  if(json_writer_begin_value(w) < 0) return -1;
+  json_writer_put(w, "\"", 1);
+  json_writer_escape(w, str, len);
+  return json_writer_put(w, "\"", 1);
+}
+
+int json_writer_string(struct json_writer *w, const char *str)
+{
+  if(str == NULL) return json_writer_null(w);
+  return json_writer_string_len(w, str, strlen(str));
+}
+
+int json_writer_int(struct json_writer *w, int64_t i)
+{
+  char digits[21];
+  int pos = sizeof(digits);
+  uint64_t u = (i < 0) ? -(uint64_t)i : (uint64_t)i;
+
+  /* Converted by hand, the printf of small C libraries often has no 64 bit support */
+  do {
+    digits[--pos] = '0' + (u % 10);
+    u /= 10;
+  } while(u);
+  if(i < 0) digits[--pos] = '-';
+
+  if(json_writer_begin_value(w) < 0) return -1;
+  return json_writer_put(w, digits + pos, sizeof(digits) - pos);
+}
+
+int json_writer_double(struct json_writer *w, double d)
+{
+  char str[32];
+  int len;
+
+  len = snprintf(str, sizeof(str), "%g", d);
+  if(len < 0 || len >= (int)sizeof(str)) {
+    w->error = TRUE;
+    return -1;
+  }
+  if(json_writer_begin_value(w) < 0) return -1;
+  return json_writer_put(w, str, len);
+}
+
+int json_writer_boolean(struct json_writer *w, boolean b)
+{
+  if(json_writer_begin_value(w) < 0) return -1;
+  return b ? json_writer_put(w, "true", 4) : json_writer_put(w, "false", 5);
+}
+
+int json_writer_null(struct json_writer *w)
+{
+  if(json_writer_begin_value(w) < 0) return -1;
+  return json_writer_put(w, "null", 4);
+}
+
+int json_writer_object(struct json_writer *w, struct json_object *jso)
+{
+  struct json_object_iter iter;
+  int i;
+
+  if(jso == NULL) return json_writer_null(w);
+
+  switch(json_object_get_type(jso)) {
+  case json_type_boolean:
+    return json_writer_boolean(w, json_object_get_boolean(jso));
+  case json_type_double:
+    return json_writer_double(w, json_object_get_double(jso));
+  case json_type_int:
+    return json_writer_int(w, json_object_get_int64(jso));
+  case json_type_string:
+    return json_writer_string_len(w, json_object_get_string(jso),
+				  json_object_get_string_len(jso));
+  case json_type_object:
+    json_writer_begin_object(w);
+    json_object_object_foreachC(jso, iter) {
+      json_writer_key(w, iter.key);
+      json_writer_object(w, iter.val);
+    }
+    return json_writer_end_object(w);
+  case json_type_array:
+    json_writer_begin_array(w);
+    for(i = 0; i < json_object_array_length(jso); i++)
+      json_writer_object(w, json_object_array_get_idx(jso, i));
+    return json_writer_end_array(w);
+  default:
+    return json_writer_null(w);
+  }
+}
+
+int json_writer_raw(struct json_writer *w, const char *data, int len)
+{
+  return json_writer_put(w, data, len);
+}
+
+int json_writer_finish(struct json_writer *w)
+{
+  if(w->error || w->depth || w->after_key) return -1;
+  if(w->flush) {
+    if(w->len && w->flush(w->userdata, w->buf, w->len) < 0) {
+      w->error = TRUE;
+      return -1;
+    }
+    w->len = 0;
+  } else {
+    w->buf[w->len] = '\0';
+  }
+  return w->total;
+}
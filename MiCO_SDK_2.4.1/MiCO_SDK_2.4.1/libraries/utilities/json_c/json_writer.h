@@ -0,0 +1,91 @@
+/*
+ * Streaming JSON text writer with a fixed output window.
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See COPYING for details.
+ *
+ */
+
+#ifndef _json_writer_h_
+#define _json_writer_h_
+
+#include "json_inttypes.h"
+#include "json_object.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * deepest nesting of objects and arrays the writer follows
+ */
+#define JSON_WRITER_MAX_DEPTH 32
+
+/**
+ * Called with the window contents each time it is full, and at the end.
+ * @returns 0 on success, or -1 to stop the writer
+ */
+typedef int (json_writer_flush_fn)(void *userdata, const char *data, int len);
+
+/**
+ * Writer state, kept by the caller while the text is produced.
+ *
+ * Values are laid out the way json_object_to_json_string() does, so a text
+ * can move from a DOM to the writer without changing a byte of it.
+ */
+struct json_writer
+{
+  char *buf;
+  int size, len;
+  json_writer_flush_fn *flush;
+  void *userdata;
+  int total;             /* bytes produced so far */
+  int depth;
+  unsigned int is_array; /* one bit per level */
+  unsigned int has_items;
+  boolean after_key;
+  boolean error;
+};
+
+/** Prepare a writer
+ * @param w the writer
+ * @param buf the output window
+ * @param size size of buf
+ * @param flush called to empty the window. Without it the whole text has to
+ * fit into buf, and json_writer_finish() leaves it NUL terminated there.
+ * @param userdata passed to flush
+ */
+extern void json_writer_init(struct json_writer *w, char *buf, int size,
+			     json_writer_flush_fn *flush, void *userdata);
+
+/* Each of these returns 0, or -1 once the writer has failed. A failed writer
+ * ignores everything after it, so the result only needs checking at the end. */
+extern int json_writer_begin_object(struct json_writer *w);
+extern int json_writer_end_object(struct json_writer *w);
+extern int json_writer_begin_array(struct json_writer *w);
+extern int json_writer_end_array(struct json_writer *w);
+extern int json_writer_key(struct json_writer *w, const char *key);
+extern int json_writer_string(struct json_writer *w, const char *str);
+extern int json_writer_string_len(struct json_writer *w, const char *str, int len);
+extern int json_writer_int(struct json_writer *w, int64_t i);
+extern int json_writer_double(struct json_writer *w, double d);
+extern int json_writer_boolean(struct json_writer *w, boolean b);
+extern int json_writer_null(struct json_writer *w);
+
+/** Write an object tree built with json_object_new_*() as one value */
+extern int json_writer_object(struct json_writer *w, struct json_object *jso);
+
+/** Write bytes as they are, e.g. a protocol header in front of the text */
+extern int json_writer_raw(struct json_writer *w, const char *data, int len);
+
+/** Flush what is left in the window
+ * @returns the number of bytes produced, or -1 if the writer has failed or
+ * a value is still open
+ */
+extern int json_writer_finish(struct json_writer *w);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -19,6 +19,7 @@
 #include "common.h"
 
 #include "linkhash.h"
+#include "json_arena.h"
 
 void lh_abort(const char *msg, ...)
 {
@@ -55,20 +56,28 @@ int lh_char_equal(const void *k1, const void *k2)
 	return (strcmp((const char*)k1, (const char*)k2) == 0);
 }
 
-struct lh_table* lh_table_new(int size, const char *name,
-			      lh_entry_free_fn *free_fn,
-			      lh_hash_fn *hash_fn,
-			      lh_equal_fn *equal_fn)
+struct lh_table* lh_table_new_arena(int size, const char *name,
+				    lh_entry_free_fn *free_fn,
+				    lh_hash_fn *hash_fn,
+				    lh_equal_fn *equal_fn,
+				    struct json_arena *arena)
 {
 	int i;
 	struct lh_table *t;
 
-	t = (struct lh_table*)calloc(1, sizeof(struct lh_table));
-	if(!t) lh_abort("lh_table_new: calloc failed 1, size = %d\n", sizeof(struct lh_table));
+	t = (struct lh_table*)json_arena_alloc(arena, sizeof(struct lh_table));
+	if(!t) {
+		if(arena) return NULL;
+		lh_abort("lh_table_new: calloc failed 1, size = %d\n", sizeof(struct lh_table));
+	}
 	t->count = 0;
 	t->size = size;
-	t->table = (struct lh_entry*)calloc(size, sizeof(struct lh_entry));
-	if(!t->table) lh_abort("lh_table_new: calloc failed 2, size = %d\n", sizeof(struct lh_table));
+	t->arena = arena;
+	t->table = (struct lh_entry*)json_arena_alloc(arena, size * sizeof(struct lh_entry));
+	if(!t->table) {
+		if(arena) return NULL;
+		lh_abort("lh_table_new: calloc failed 2, size = %d\n", sizeof(struct lh_table));
+	}
 	t->free_fn = free_fn;
 	t->hash_fn = hash_fn;
 	t->equal_fn = equal_fn;
@@ -76,6 +85,14 @@ struct lh_table* lh_table_new(int size, const char *name,
 	return t;
 }
 
+struct lh_table* lh_table_new(int size, const char *name,
+			      lh_entry_free_fn *free_fn,
+			      lh_hash_fn *hash_fn,
+			      lh_equal_fn *equal_fn)
+{
+	return lh_table_new_arena(size, name, free_fn, hash_fn, equal_fn, NULL);
+}
+
 struct lh_table* lh_kchar_table_new(int size, const char *name,
 				    lh_entry_free_fn *free_fn)
 {
@@ -88,47 +105,30 @@ struct lh_table* lh_kptr_table_new(int size, const char *name,
 	return lh_table_new(size, name, free_fn, lh_ptr_hash, lh_ptr_equal);
 }
 
-void lh_table_resize(struct lh_table *t, int new_size)
+static int lh_table_full(struct lh_table *t)
 {
-	struct lh_table *new_t;
-	struct lh_entry *ent;
-
-	new_t = lh_table_new(new_size, NULL, NULL, t->hash_fn, t->equal_fn);
-	ent = t->head;
-	while(ent) {
-		lh_table_insert(new_t, ent->k, ent->v);
-		ent = ent->next;
-	}
-	free(t->table);
-	t->table = new_t->table;
-	t->size = new_size;
-	t->head = new_t->head;
-	t->tail = new_t->tail;
-	free(new_t);
+	if(t->size <= LH_FLAT_SIZE) return t->count >= t->size;
+	return t->count * 100 >= t->size * LH_LOAD_FACTOR;
 }
 
-void lh_table_free(struct lh_table *t)
+static int lh_table_grow_size(struct lh_table *t)
 {
-	struct lh_entry *c;
-	for(c = t->head; c != NULL; c = c->next) {
-		if(t->free_fn) {
-			t->free_fn(c);
-		}
-	}
-	free(t->table);
-	free(t);
-}
+	int grow = t->size > 0 ? t->size : 1;
 
+#if LH_MAX_GROW > 0
+	if(grow > LH_MAX_GROW) grow = LH_MAX_GROW;
+#endif
+	return t->size + grow;
+}
 
-int lh_table_insert(struct lh_table *t, void *k, const void *v)
+/* Place an entry without checking for room. Flat tables take the first free
+ * slot, so their empty slots always trail the used and freed ones. */
+static void lh_table_place(struct lh_table *t, void *k, const void *v)
 {
-	unsigned long h, n;
+	unsigned long n;
 
-	//if(t->count > t->size * 0.66) lh_table_resize(t, t->size * 2); 
-	if(t->count >= t->size) lh_table_resize(t, t->size + 1); 
-
-	h = t->hash_fn(k);
-	n = h % t->size;
+	if(t->size <= LH_FLAT_SIZE) n = 0;
+	else n = t->hash_fn(k) % t->size;
 
 	while( 1 ) {
 		if(t->table[n].k == LH_EMPTY || t->table[n].k == LH_FREED) break;
@@ -148,17 +148,80 @@ int lh_table_insert(struct lh_table *t, void *k, const void *v)
 		t->table[n].next = NULL;
 		t->tail = &t->table[n];
 	}
+}
+
+static int lh_table_resize_internal(struct lh_table *t, int new_size)
+{
+	struct lh_entry *old_table = t->table;
+	struct lh_entry *new_table;
+	struct lh_entry *ent;
+	int i;
+
+	new_table = (struct lh_entry*)json_arena_alloc(t->arena, new_size * sizeof(struct lh_entry));
+	if(!new_table) return -1;
+	t->table = new_table;
+	for(i = 0; i < new_size; i++) t->table[i].k = LH_EMPTY;
+	t->size = new_size;
+	t->count = 0;
+
+	/* Re-place in list order, which keeps the insertion order */
+	ent = t->head;
+	t->head = t->tail = NULL;
+	while(ent) {
+		lh_table_place(t, ent->k, ent->v);
+		ent = ent->next;
+	}
+	json_arena_free(t->arena, old_table);
+	return 0;
+}
 
+void lh_table_resize(struct lh_table *t, int new_size)
+{
+	if(lh_table_resize_internal(t, new_size) && !t->arena)
+		lh_abort("lh_table_resize: calloc failed, size = %d\n", new_size);
+}
+
+void lh_table_free(struct lh_table *t)
+{
+	struct lh_entry *c;
+	for(c = t->head; c != NULL; c = c->next) {
+		if(t->free_fn) {
+			t->free_fn(c);
+		}
+	}
+	json_arena_free(t->arena, t->table);
+	json_arena_free(t->arena, t);
+}
+
+
+int lh_table_insert(struct lh_table *t, void *k, const void *v)
+{
+	if(lh_table_full(t)) {
+		if(!t->arena) lh_table_resize(t, lh_table_grow_size(t));
+		else if(lh_table_resize_internal(t, lh_table_grow_size(t))) return -1;
+	}
+
+	lh_table_place(t, k, v);
 	return 0;
 }
 
 
 struct lh_entry* lh_table_lookup_entry(struct lh_table *t, const void *k)
 {
-	unsigned long h = t->hash_fn(k);
-	unsigned long n = h % t->size;
+	unsigned long n;
 	int count = 0;
 
+	if(t->size <= LH_FLAT_SIZE) {
+		for(n = 0; n < t->size; n++) {
+			if(t->table[n].k == LH_EMPTY) return NULL;
+			if(t->table[n].k != LH_FREED &&
+			   t->equal_fn(t->table[n].k, k)) return &t->table[n];
+		}
+		return NULL;
+	}
+
+	n = t->hash_fn(k) % t->size;
+
 	while( count < t->size ) {
 		if(t->table[n].k == LH_EMPTY) return NULL;
 		if(t->table[n].k != LH_FREED &&
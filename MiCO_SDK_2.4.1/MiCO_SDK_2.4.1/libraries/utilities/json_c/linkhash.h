@@ -21,6 +21,29 @@ extern "C" {
  */
 #define LH_PRIME 0x9e370001UL
 
+/**
+ * tables of up to this many slots are a flat array searched linearly,
+ * which is cheaper than hashing for the few keys of a typical object
+ */
+#ifndef LH_FLAT_SIZE
+#define LH_FLAT_SIZE 8
+#endif
+
+/**
+ * a hashed table is grown once it is this many percent full
+ */
+#ifndef LH_LOAD_FACTOR
+#define LH_LOAD_FACTOR 75
+#endif
+
+/**
+ * tables double in size when they grow. On small RAM targets this caps the
+ * number of slots added by one resize, 0 means no cap
+ */
+#ifndef LH_MAX_GROW
+#define LH_MAX_GROW 0
+#endif
+
 /**
  * sentinel pointer value for empty slots
  */
@@ -32,6 +55,7 @@ extern "C" {
 #define LH_FREED (void*)-2
 
 struct lh_entry;
+struct json_arena;
 
 /**
  * callback function prototypes
@@ -76,11 +100,11 @@ struct lh_table {
 	/**
 	 * Size of our hash.
 	 */
-	unsigned char size;
+	int size;
 	/**
 	 * Numbers of entries.
 	 */
-	unsigned char count;
+	int count;
 
 	/**
 	 * The first entry.
@@ -100,6 +124,11 @@ struct lh_table {
 	lh_entry_free_fn *free_fn;
 	lh_hash_fn *hash_fn;
 	lh_equal_fn *equal_fn;
+
+	/**
+	 * Arena the table and its slots live in, NULL for the heap.
+	 */
+	struct json_arena *arena;
 };
 
 
@@ -149,6 +178,19 @@ extern struct lh_table* lh_table_new(int size, const char *name,
 				     lh_hash_fn *hash_fn,
 				     lh_equal_fn *equal_fn);
 
+/**
+ * Create a new linkhash table inside an arena.
+ * Same as lh_table_new() except that the table and its slots are carved
+ * from arena, and running out of room returns NULL or makes
+ * lh_table_insert() fail instead of aborting.
+ * @param arena the arena to allocate from, NULL for the heap.
+ */
+extern struct lh_table* lh_table_new_arena(int size, const char *name,
+					   lh_entry_free_fn *free_fn,
+					   lh_hash_fn *hash_fn,
+					   lh_equal_fn *equal_fn,
+					   struct json_arena *arena);
+
 /**
  * Convenience function to create a new linkhash
  * table with char keys.
@@ -187,6 +229,7 @@ extern void lh_table_free(struct lh_table *t);
  * @param t the table to insert into.
  * @param k a pointer to the key to insert.
  * @param v a pointer to the value to insert.
+ * @return 0 on success, -1 if an arena table could not grow.
  */
 extern int lh_table_insert(struct lh_table *t, void *k, const void *v);
 
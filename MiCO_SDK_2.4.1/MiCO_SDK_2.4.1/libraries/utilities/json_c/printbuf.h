@@ -22,15 +22,21 @@ extern "C" {
 
 #undef PRINTBUF_DEBUG
 
+struct json_arena;
+
 struct printbuf {
   char *buf;
   int bpos;
   int size;
+  struct json_arena *arena; /* NULL for the heap */
 };
 
 extern struct printbuf*
 printbuf_new(void);
 
+extern struct printbuf*
+printbuf_new_arena(struct json_arena *arena);
+
 /* As an optimization, printbuf_memappend_fast is defined as a macro
  * that handles copying data if the buffer is large enough; otherwise
  * it invokes printbuf_memappend_real() which performs the heavy